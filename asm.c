@@ -0,0 +1,609 @@
+#include "asm.h"
+#include "io_handler.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_ASM
+#define ASM_DBG(fmt, ...)				printf(BOLD("ASM:\t")fmt, ##__VA_ARGS__)
+#define ASM_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("ASM:\t"))fmt, ##__VA_ARGS__)
+#define ASM_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("ASM:\t"))fmt, ##__VA_ARGS__)
+#define ASM_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("ASM:\t"))fmt, ##__VA_ARGS__)
+#else
+#define ASM_DBG(fmt, ...)
+#define ASM_GREEN(fmt, ...)
+#define ASM_WARN(fmt, ...)
+#define ASM_ERR(fmt, ...)
+#endif
+
+#define ASM_INITIAL_BUFFER_SIZE			(64)
+
+/*
+ *	Upper bounds on formatted sizes, used to size the output in one go.
+ *	An instruction is a tab, mnemonic, tab, two operands, a separator, pshufd's "$0, " and a newline
+ */
+#define ASM_MAX_MNEMONIC_LENGTH			(8)
+#define ASM_MAX_FIXED_OPERAND_LENGTH	(32)	// "%r15d", "$4294967295", "4294967295(%rsp)", "(%v4294967295,%v4294967295,8)", ...
+#define ASM_MAX_INSTRUCTION_OVERHEAD	(12)
+#define ASM_MAX_DIRECTIVE_LENGTH		(64)	// Any one line of fixed header/footer text
+
+#define ASM_APPEND_LITERAL(pc_cursor, literal)	(pc_cursor = ASM_append_string(pc_cursor, literal, sizeof(literal) - 1))
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	const char *	kpc_text;
+	uint8_t			u8_length;
+} ASM_string_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+#define ASM_STRING(text)				{ .kpc_text = text, .u8_length = sizeof(text) - 1 }
+
+static const ASM_string_t pk_mnemonics[ASM_OPCODE_NUM_OPCODES][ASM_WIDTH_NUM_WIDTHS] =
+{
+	[ASM_OPCODE_MOV]	= { ASM_STRING("movl"), 	ASM_STRING("movq"), 	ASM_STRING("movb"), 	ASM_STRING("movw") },
+	[ASM_OPCODE_ADD]	= { ASM_STRING("addl"), 	ASM_STRING("addq") },
+	[ASM_OPCODE_SUB]	= { ASM_STRING("subl"), 	ASM_STRING("subq") },
+	[ASM_OPCODE_IMUL]	= { ASM_STRING("imull"), 	ASM_STRING("imulq") },
+	[ASM_OPCODE_DIV]	= { ASM_STRING("divl"), 	ASM_STRING("divq") },
+	[ASM_OPCODE_IDIV]	= { ASM_STRING("idivl"), 	ASM_STRING("idivq") },
+	[ASM_OPCODE_CDQ]	= { ASM_STRING("cltd"), 	ASM_STRING("cqto") },
+	[ASM_OPCODE_XOR]	= { ASM_STRING("xorl"), 	ASM_STRING("xorq") },
+	[ASM_OPCODE_SHL]	= { ASM_STRING("shll"), 	ASM_STRING("shlq") },
+	[ASM_OPCODE_SHR]	= { ASM_STRING("shrl"), 	ASM_STRING("shrq") },
+	[ASM_OPCODE_LEA3]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_LEA5]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_LEA9]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_ADD_SCALED2]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_ADD_SCALED4]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_ADD_SCALED8]	= { ASM_STRING("leal"), 	ASM_STRING("leaq") },
+	[ASM_OPCODE_MOVZB]	= { ASM_STRING("movzbl"), 	ASM_STRING("movzbq") },
+	[ASM_OPCODE_MOVZW]	= { ASM_STRING("movzwl"), 	ASM_STRING("movzwq") },
+	[ASM_OPCODE_MOVZL]	= { ASM_STRING("movl"), 	ASM_STRING("movl") },
+	[ASM_OPCODE_MOVSB]	= { ASM_STRING("movsbl"), 	ASM_STRING("movsbq") },
+	[ASM_OPCODE_MOVSW]	= { ASM_STRING("movswl"), 	ASM_STRING("movswq") },
+	[ASM_OPCODE_MOVSL]	= { [ASM_WIDTH_64] = ASM_STRING("movslq") },
+	[ASM_OPCODE_PUSH]	= { ASM_STRING("pushq"), 	ASM_STRING("pushq") },
+	[ASM_OPCODE_POP]	= { ASM_STRING("popq"), 	ASM_STRING("popq") },
+	[ASM_OPCODE_RET]	= { ASM_STRING("ret"), 		ASM_STRING("ret") },
+	[ASM_OPCODE_MOVDQU]	= { [ASM_WIDTH_128] = ASM_STRING("movdqu") },
+	[ASM_OPCODE_MOVD]	= { ASM_STRING("movd") },
+	[ASM_OPCODE_PSHUFD0]	= { [ASM_WIDTH_128] = ASM_STRING("pshufd") },
+	[ASM_OPCODE_PADDD]	= { [ASM_WIDTH_128] = ASM_STRING("paddd") },
+	[ASM_OPCODE_PSUBD]	= { [ASM_WIDTH_128] = ASM_STRING("psubd") },
+};
+
+static const ASM_string_t pk_register_names[ASM_REGISTER_NUM_REGISTERS][ASM_WIDTH_NUM_WIDTHS] =
+{
+	[ASM_REGISTER_RAX]	= { ASM_STRING("%eax"), 	ASM_STRING("%rax"), 	ASM_STRING("%al"), 		ASM_STRING("%ax") },
+	[ASM_REGISTER_RCX]	= { ASM_STRING("%ecx"), 	ASM_STRING("%rcx"), 	ASM_STRING("%cl"), 		ASM_STRING("%cx") },
+	[ASM_REGISTER_RDX]	= { ASM_STRING("%edx"), 	ASM_STRING("%rdx"), 	ASM_STRING("%dl"), 		ASM_STRING("%dx") },
+	[ASM_REGISTER_RBX]	= { ASM_STRING("%ebx"), 	ASM_STRING("%rbx"), 	ASM_STRING("%bl"), 		ASM_STRING("%bx") },
+	[ASM_REGISTER_RSP]	= { ASM_STRING("%esp"), 	ASM_STRING("%rsp"), 	ASM_STRING("%spl"), 	ASM_STRING("%sp") },
+	[ASM_REGISTER_RBP]	= { ASM_STRING("%ebp"), 	ASM_STRING("%rbp"), 	ASM_STRING("%bpl"), 	ASM_STRING("%bp") },
+	[ASM_REGISTER_RSI]	= { ASM_STRING("%esi"), 	ASM_STRING("%rsi"), 	ASM_STRING("%sil"), 	ASM_STRING("%si") },
+	[ASM_REGISTER_RDI]	= { ASM_STRING("%edi"), 	ASM_STRING("%rdi"), 	ASM_STRING("%dil"), 	ASM_STRING("%di") },
+	[ASM_REGISTER_R8]	= { ASM_STRING("%r8d"), 	ASM_STRING("%r8"), 		ASM_STRING("%r8b"), 	ASM_STRING("%r8w") },
+	[ASM_REGISTER_R9]	= { ASM_STRING("%r9d"), 	ASM_STRING("%r9"), 		ASM_STRING("%r9b"), 	ASM_STRING("%r9w") },
+	[ASM_REGISTER_R10]	= { ASM_STRING("%r10d"), 	ASM_STRING("%r10"), 	ASM_STRING("%r10b"), 	ASM_STRING("%r10w") },
+	[ASM_REGISTER_R11]	= { ASM_STRING("%r11d"), 	ASM_STRING("%r11"), 	ASM_STRING("%r11b"), 	ASM_STRING("%r11w") },
+	[ASM_REGISTER_R12]	= { ASM_STRING("%r12d"), 	ASM_STRING("%r12"), 	ASM_STRING("%r12b"), 	ASM_STRING("%r12w") },
+	[ASM_REGISTER_R13]	= { ASM_STRING("%r13d"), 	ASM_STRING("%r13"), 	ASM_STRING("%r13b"), 	ASM_STRING("%r13w") },
+	[ASM_REGISTER_R14]	= { ASM_STRING("%r14d"), 	ASM_STRING("%r14"), 	ASM_STRING("%r14b"), 	ASM_STRING("%r14w") },
+	[ASM_REGISTER_R15]	= { ASM_STRING("%r15d"), 	ASM_STRING("%r15"), 	ASM_STRING("%r15b"), 	ASM_STRING("%r15w") },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static inline char * 	ASM_append_string			(char * pc_cursor, const char * kpc_text, size_t length);
+static inline char * 	ASM_append_u32				(char * pc_cursor, uint32_t u32_value);
+static char * 			ASM_append_operand			(char * pc_cursor, ASM_operand_kind_t kind, uint32_t u32_value, ASM_width_t width, const uint16_t * kpu16_name_lengths);
+static char * 			ASM_append_lea_address		(char * pc_cursor, const ASM_instruction_t * kp_instruction);
+static size_t 			ASM_get_format_bound		(const ASM_buffer_t * kp_buffer, const uint16_t * kpu16_name_lengths);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void ASM_init_buffer(ASM_buffer_t * p_buffer)
+{
+	p_buffer->u32_num_instructions = 0;
+	p_buffer->u32_capacity = ASM_INITIAL_BUFFER_SIZE;
+	p_buffer->p_instructions = malloc(sizeof(ASM_instruction_t) * p_buffer->u32_capacity);
+	ASSERT(p_buffer->p_instructions);
+}
+
+void ASM_deinit_buffer(ASM_buffer_t * p_buffer)
+{
+	free(p_buffer->p_instructions);
+	p_buffer->p_instructions = NULL;
+	p_buffer->u32_num_instructions = 0;
+	p_buffer->u32_capacity = 0;
+}
+
+void ASM_append_instruction(ASM_buffer_t * p_buffer, const ASM_instruction_t * kp_instruction)
+{
+	// Double our instruction buffer if it's full
+	if (p_buffer->u32_num_instructions == p_buffer->u32_capacity)
+	{
+		p_buffer->u32_capacity *= 2;
+		p_buffer->p_instructions = realloc(p_buffer->p_instructions, sizeof(ASM_instruction_t) * p_buffer->u32_capacity);
+		ASSERT(p_buffer->p_instructions);
+	}
+
+	p_buffer->p_instructions[p_buffer->u32_num_instructions++] = *kp_instruction;
+}
+
+/*
+ *	Inserts `u32_count` instructions in front of the one at `u32_index`
+ */
+void ASM_insert_instructions(ASM_buffer_t * p_buffer, uint32_t u32_index, const ASM_instruction_t * kp_instructions, uint32_t u32_count)
+{
+	ASSERT(u32_index <= p_buffer->u32_num_instructions);
+
+	while (p_buffer->u32_num_instructions + u32_count > p_buffer->u32_capacity)
+	{
+		p_buffer->u32_capacity *= 2;
+		p_buffer->p_instructions = realloc(p_buffer->p_instructions, sizeof(ASM_instruction_t) * p_buffer->u32_capacity);
+		ASSERT(p_buffer->p_instructions);
+	}
+
+	memmove(&p_buffer->p_instructions[u32_index + u32_count],
+			&p_buffer->p_instructions[u32_index],
+			sizeof(ASM_instruction_t) * (p_buffer->u32_num_instructions - u32_index));
+	memcpy(&p_buffer->p_instructions[u32_index], kp_instructions, sizeof(ASM_instruction_t) * u32_count);
+	p_buffer->u32_num_instructions += u32_count;
+}
+
+/*
+ *	Convenience wrapper around ASM_append_instruction
+ */
+void ASM_emit(ASM_buffer_t * p_buffer, ASM_opcode_t opcode, ASM_width_t width,
+				ASM_operand_kind_t src_kind, uint32_t u32_src,
+				ASM_operand_kind_t dst_kind, uint32_t u32_dst)
+{
+	ASM_instruction_t instruction =
+	{
+		.u8_opcode		= (uint8_t)opcode,
+		.u8_width		= (uint8_t)width,
+		.u8_src_kind	= (uint8_t)src_kind,
+		.u8_dst_kind	= (uint8_t)dst_kind,
+		.u32_src		= u32_src,
+		.u32_dst		= u32_dst,
+	};
+
+	ASM_append_instruction(p_buffer, &instruction);
+}
+
+/*
+ *	Formats the whole program (rep_main, the variable offsets and the variable name table)
+ *	as GNU assembler text, in a single pass into a single allocation. The caller frees it
+ */
+char * ASM_format_program(const ASM_buffer_t * kp_buffer, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint32_t u32_num_symbols = SYMBOL_TABLE_get_num_symbols();
+	const ASM_instruction_t * kp_instruction;
+	const ASM_string_t * kp_mnemonic;
+	const char * kpc_name;
+	uint16_t * pu16_name_lengths = malloc(sizeof(uint16_t) * (u32_num_symbols + 1));
+	char * pc_text;
+	char * pc_cursor;
+
+	ASSERT(pu16_name_lengths);
+
+	// Names get copied once per reference, so measure them up front
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		pu16_name_lengths[i] = (uint16_t)strlen(kp_symbols[i].p_token->pc_lexeme);
+	}
+
+	pc_text = malloc(ASM_get_format_bound(kp_buffer, pu16_name_lengths));
+	pc_cursor = pc_text;
+	ASSERT(pc_text);
+
+	// Variable offsets from ASM_VARIABLE_BASE_REGISTER
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		kpc_name = kp_symbols[i].p_token->pc_lexeme;
+		ASM_APPEND_LITERAL(pc_cursor, "\t.set\t" ASM_VARIABLE_SYMBOL_PREFIX);
+		pc_cursor = ASM_append_string(pc_cursor, kpc_name, pu16_name_lengths[i]);
+		ASM_APPEND_LITERAL(pc_cursor, ", ");
+		pc_cursor = ASM_append_u32(pc_cursor, ASM_get_variable_offset(i));
+		ASM_APPEND_LITERAL(pc_cursor, "\n");
+	}
+
+	ASM_APPEND_LITERAL(pc_cursor,
+		"\t.text\n"
+		"\t.globl\t" ASM_ENTRY_SYMBOL "\n"
+		"\t.type\t" ASM_ENTRY_SYMBOL ", @function\n"
+		ASM_ENTRY_SYMBOL ":\n");
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+		kp_mnemonic = &pk_mnemonics[kp_instruction->u8_opcode][kp_instruction->u8_width];
+
+		*pc_cursor++ = '\t';
+		pc_cursor = ASM_append_string(pc_cursor, kp_mnemonic->kpc_text, kp_mnemonic->u8_length);
+
+		if (ASM_IS_LEA(kp_instruction->u8_opcode))
+		{
+			*pc_cursor++ = '\t';
+			pc_cursor = ASM_append_lea_address(pc_cursor, kp_instruction);
+		}
+		else if (kp_instruction->u8_src_kind != ASM_OPERAND_NONE)
+		{
+			*pc_cursor++ = '\t';
+
+			if (kp_instruction->u8_opcode == ASM_OPCODE_PSHUFD0)
+			{
+				ASM_APPEND_LITERAL(pc_cursor, "$0, ");
+			}
+
+			pc_cursor = ASM_append_operand(pc_cursor, kp_instruction->u8_src_kind, kp_instruction->u32_src, ASM_get_src_width(kp_instruction), pu16_name_lengths);
+		}
+
+		if (kp_instruction->u8_dst_kind != ASM_OPERAND_NONE)
+		{
+			if (kp_instruction->u8_src_kind != ASM_OPERAND_NONE)
+			{
+				ASM_APPEND_LITERAL(pc_cursor, ", ");
+			}
+			else
+			{
+				*pc_cursor++ = '\t';
+			}
+			pc_cursor = ASM_append_operand(pc_cursor, kp_instruction->u8_dst_kind, kp_instruction->u32_dst, ASM_get_dst_width(kp_instruction), pu16_name_lengths);
+		}
+
+		*pc_cursor++ = '\n';
+	}
+
+	ASM_APPEND_LITERAL(pc_cursor,
+		"\t.size\t" ASM_ENTRY_SYMBOL ", .-" ASM_ENTRY_SYMBOL "\n"
+		"\t.section\t.rodata\n"
+		"\t.p2align\t2\n"
+		"\t.globl\t" ASM_NUM_VARIABLES_SYMBOL "\n"
+		ASM_NUM_VARIABLES_SYMBOL ":\n"
+		"\t.long\t");
+	pc_cursor = ASM_append_u32(pc_cursor, u32_num_symbols);
+	ASM_APPEND_LITERAL(pc_cursor,
+		"\n"
+		"\t.globl\t" ASM_VARIABLE_OFFSETS_SYMBOL "\n"
+		ASM_VARIABLE_OFFSETS_SYMBOL ":\n");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		ASM_APPEND_LITERAL(pc_cursor, "\t.long\t");
+		pc_cursor = ASM_append_u32(pc_cursor, ASM_get_variable_offset(i));
+		ASM_APPEND_LITERAL(pc_cursor, "\n");
+	}
+
+	ASM_APPEND_LITERAL(pc_cursor,
+		"\t.globl\t" ASM_VARIABLE_NAMES_SYMBOL "\n"
+		ASM_VARIABLE_NAMES_SYMBOL ":\n");
+
+	// Names are NUL-separated, in variable order
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		kpc_name = kp_symbols[i].p_token->pc_lexeme;
+		ASM_APPEND_LITERAL(pc_cursor, "\t.asciz\t\"");
+		pc_cursor = ASM_append_string(pc_cursor, kpc_name, pu16_name_lengths[i]);
+		ASM_APPEND_LITERAL(pc_cursor, "\"\n");
+	}
+
+	ASM_APPEND_LITERAL(pc_cursor,
+		"\t.globl\t" ASM_VARIABLE_TYPES_SYMBOL "\n"
+		ASM_VARIABLE_TYPES_SYMBOL ":\n");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		ASM_APPEND_LITERAL(pc_cursor, "\t.byte\t");
+		pc_cursor = ASM_append_u32(pc_cursor, ASM_VARIABLE_TYPE_BYTE(kp_symbols[i].builtin_type));
+		ASM_APPEND_LITERAL(pc_cursor, "\n");
+	}
+
+	ASM_APPEND_LITERAL(pc_cursor, "\t.section\t.note.GNU-stack,\"\",@progbits\n");
+
+	*p_size = (size_t)(pc_cursor - pc_text);
+	free(pu16_name_lengths);
+
+	return pc_text;
+}
+
+/*
+ *	Formats the program and writes it out in one go
+ */
+STATUS_t ASM_write_program(const ASM_buffer_t * kp_buffer, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_text;
+
+	if (kp_buffer == NULL || kpc_fname == NULL)
+	{
+		ASM_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	pc_text = ASM_format_program(kp_buffer, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_text, size);
+	free(pc_text);
+
+	return status;
+}
+
+/*
+ *	Register name getter
+ */
+const char * ASM_get_register_name(ASM_register_t reg, ASM_width_t width)
+{
+	ASSERT(reg < ASM_REGISTER_NUM_REGISTERS && width < ASM_WIDTH_NUM_WIDTHS);
+	return pk_register_names[reg][width].kpc_text;
+}
+
+/*
+ *	Index scale of the lea forms: lea (src,src,scale) multiplies by scale + 1, and
+ *	lea (dst,src,scale) adds src times scale
+ */
+uint8_t ASM_get_lea_scale(ASM_opcode_t opcode)
+{
+	switch (opcode)
+	{
+		case ASM_OPCODE_LEA3:
+		case ASM_OPCODE_ADD_SCALED2:
+		{
+			return 2;
+		}
+		case ASM_OPCODE_LEA5:
+		case ASM_OPCODE_ADD_SCALED4:
+		{
+			return 4;
+		}
+		case ASM_OPCODE_LEA9:
+		case ASM_OPCODE_ADD_SCALED8:
+		{
+			return 8;
+		}
+		default:
+		{
+			ASSERT(0);
+			return 0;
+		}
+	}
+}
+
+/*
+ *	Offset of a variable (by symbol table index) from ASM_VARIABLE_BASE_REGISTER
+ */
+uint32_t ASM_get_variable_offset(uint32_t u32_variable)
+{
+	return SYMBOL_TABLE_get_offset(u32_variable);
+}
+
+/*
+ *	The width that moves a value of `u8_size` bytes
+ */
+ASM_width_t ASM_get_width(uint8_t u8_size)
+{
+	switch (u8_size)
+	{
+		case 1:
+		{
+			return ASM_WIDTH_8;
+		}
+		case 2:
+		{
+			return ASM_WIDTH_16;
+		}
+		case 8:
+		{
+			return ASM_WIDTH_64;
+		}
+		default:
+		{
+			ASSERT(u8_size == 4);
+			return ASM_WIDTH_32;
+		}
+	}
+}
+
+/*
+ *	Width of the source operand. Extensions read something narrower than they write
+ */
+ASM_width_t ASM_get_src_width(const ASM_instruction_t * kp_instruction)
+{
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOVZB:
+		case ASM_OPCODE_MOVSB:
+		{
+			return ASM_WIDTH_8;
+		}
+		case ASM_OPCODE_MOVZW:
+		case ASM_OPCODE_MOVSW:
+		{
+			return ASM_WIDTH_16;
+		}
+		case ASM_OPCODE_MOVZL:
+		case ASM_OPCODE_MOVSL:
+		{
+			return ASM_WIDTH_32;
+		}
+		default:
+		{
+			return (ASM_width_t)kp_instruction->u8_width;
+		}
+	}
+}
+
+/*
+ *	Width of the destination operand. A zero extension to 64 bits is a plain 32-bit move
+ */
+ASM_width_t ASM_get_dst_width(const ASM_instruction_t * kp_instruction)
+{
+	return (kp_instruction->u8_opcode == ASM_OPCODE_MOVZL) ? ASM_WIDTH_32 : (ASM_width_t)kp_instruction->u8_width;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static inline char * ASM_append_string(char * pc_cursor, const char * kpc_text, size_t length)
+{
+	memcpy(pc_cursor, kpc_text, length);
+	return pc_cursor + length;
+}
+
+static inline char * ASM_append_u32(char * pc_cursor, uint32_t u32_value)
+{
+	char pc_digits[10];
+	uint32_t u32_num_digits = 0;
+
+	do
+	{
+		pc_digits[u32_num_digits++] = (char)('0' + (u32_value % 10));
+		u32_value /= 10;
+	}
+	while (u32_value != 0);
+
+	while (u32_num_digits > 0)
+	{
+		*pc_cursor++ = pc_digits[--u32_num_digits];
+	}
+
+	return pc_cursor;
+}
+
+static char * ASM_append_operand(char * pc_cursor, ASM_operand_kind_t kind, uint32_t u32_value, ASM_width_t width, const uint16_t * kpu16_name_lengths)
+{
+	const ASM_string_t * kp_name;
+	const char * kpc_lexeme;
+
+	switch (kind)
+	{
+		case ASM_OPERAND_REGISTER:
+		{
+			kp_name = &pk_register_names[u32_value][width];
+			pc_cursor = ASM_append_string(pc_cursor, kp_name->kpc_text, kp_name->u8_length);
+			break;
+		}
+		case ASM_OPERAND_IMMEDIATE:
+		{
+			*pc_cursor++ = '$';
+			pc_cursor = ASM_append_u32(pc_cursor, u32_value);
+			break;
+		}
+		case ASM_OPERAND_VIRTUAL:
+		{
+			// Only seen when dumping code before register allocation
+			ASM_APPEND_LITERAL(pc_cursor, "%v");
+			pc_cursor = ASM_append_u32(pc_cursor, u32_value);
+			break;
+		}
+		case ASM_OPERAND_XMM:
+		{
+			ASM_APPEND_LITERAL(pc_cursor, "%xmm");
+			pc_cursor = ASM_append_u32(pc_cursor, u32_value);
+			break;
+		}
+		case ASM_OPERAND_STACK:
+		{
+			pc_cursor = ASM_append_u32(pc_cursor, u32_value);
+			*pc_cursor++ = '(';
+			kp_name = &pk_register_names[ASM_REGISTER_RSP][ASM_WIDTH_64];
+			pc_cursor = ASM_append_string(pc_cursor, kp_name->kpc_text, kp_name->u8_length);
+			*pc_cursor++ = ')';
+			break;
+		}
+		case ASM_OPERAND_VARIABLE:
+		{
+			kpc_lexeme = SYMBOL_TABLE_get_symbol_table()[u32_value].p_token->pc_lexeme;
+			ASM_APPEND_LITERAL(pc_cursor, ASM_VARIABLE_SYMBOL_PREFIX);
+			pc_cursor = ASM_append_string(pc_cursor, kpc_lexeme, kpu16_name_lengths[u32_value]);
+			*pc_cursor++ = '(';
+			kp_name = &pk_register_names[ASM_VARIABLE_BASE_REGISTER][ASM_WIDTH_64];
+			pc_cursor = ASM_append_string(pc_cursor, kp_name->kpc_text, kp_name->u8_length);
+			*pc_cursor++ = ')';
+			break;
+		}
+		default:
+		{
+			ASSERT(0);
+		}
+	}
+
+	return pc_cursor;
+}
+
+/*
+ *	lea's source is an address: the source register scaled, on top of itself or of the destination.
+ *	Address registers always go by their full-width names
+ */
+static char * ASM_append_lea_address(char * pc_cursor, const ASM_instruction_t * kp_instruction)
+{
+	*pc_cursor++ = '(';
+
+	if (ASM_IS_SCALED_ADD(kp_instruction->u8_opcode))
+	{
+		pc_cursor = ASM_append_operand(pc_cursor, kp_instruction->u8_dst_kind, kp_instruction->u32_dst, ASM_WIDTH_64, NULL);
+	}
+	else
+	{
+		pc_cursor = ASM_append_operand(pc_cursor, kp_instruction->u8_src_kind, kp_instruction->u32_src, ASM_WIDTH_64, NULL);
+	}
+
+	*pc_cursor++ = ',';
+	pc_cursor = ASM_append_operand(pc_cursor, kp_instruction->u8_src_kind, kp_instruction->u32_src, ASM_WIDTH_64, NULL);
+	*pc_cursor++ = ',';
+	*pc_cursor++ = (char)('0' + ASM_get_lea_scale(kp_instruction->u8_opcode));
+	*pc_cursor++ = ')';
+
+	return pc_cursor;
+}
+
+/*
+ *	A safe upper bound on the size of ASM_format_program's output
+ */
+static size_t ASM_get_format_bound(const ASM_buffer_t * kp_buffer, const uint16_t * kpu16_name_lengths)
+{
+	const ASM_instruction_t * kp_instruction;
+	uint32_t u32_num_symbols = SYMBOL_TABLE_get_num_symbols();
+	size_t bound = 20 * ASM_MAX_DIRECTIVE_LENGTH;
+
+	// Each variable gets a .set line, a name table entry, and an offset and type table entry
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		bound += (2 * (size_t)kpu16_name_lengths[i]) + (4 * ASM_MAX_DIRECTIVE_LENGTH);
+	}
+
+	bound += (size_t)kp_buffer->u32_num_instructions * (ASM_MAX_MNEMONIC_LENGTH + (2 * ASM_MAX_FIXED_OPERAND_LENGTH) + ASM_MAX_INSTRUCTION_OVERHEAD);
+
+	// Variable operands also carry their name
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VARIABLE)
+		{
+			bound += kpu16_name_lengths[kp_instruction->u32_src];
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VARIABLE)
+		{
+			bound += kpu16_name_lengths[kp_instruction->u32_dst];
+		}
+	}
+
+	return bound;
+}
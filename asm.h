@@ -0,0 +1,176 @@
+#ifndef ASM_H
+#define ASM_H
+
+#include "common.h"
+#include "status.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	Generated code is a single function, `void rep_main(uint32_t * p_variables)`.
+ *	Variables live at fixed offsets from the pointer it's handed, which stays in this register.
+ *	Each takes as many bytes as its type, aligned to them. Alongside it are tables describing
+ *	the variables, in order: how many, their offsets, their NUL-separated names, and a byte each
+ *	for their types
+ */
+#define ASM_VARIABLE_BASE_REGISTER		(ASM_REGISTER_RDI)
+
+#define ASM_ENTRY_SYMBOL				"rep_main"
+#define ASM_NUM_VARIABLES_SYMBOL		"rep_num_variables"
+#define ASM_VARIABLE_OFFSETS_SYMBOL		"rep_variable_offsets"
+#define ASM_VARIABLE_NAMES_SYMBOL		"rep_variable_names"
+#define ASM_VARIABLE_TYPES_SYMBOL		"rep_variable_types"
+#define ASM_VARIABLE_SYMBOL_PREFIX		"rep_var_"
+
+#define ASM_VARIABLE_TYPE_SIGNED		(0x80)	// Set in a type byte for signed types. The rest is the size in bytes
+#define ASM_VARIABLE_TYPE_BYTE(type)	((uint8_t)(BUILTINS_get_size(type) | (BUILTINS_is_signed(type) ? ASM_VARIABLE_TYPE_SIGNED : 0)))
+
+#define ASM_VREG_NONE					(UINT32_MAX)
+
+#define ASM_NUM_XMM_REGISTERS			(16)
+#define ASM_VECTOR_SIZE					(16)	// Bytes an xmm register loads and stores
+
+#define ASM_IS_SCALED_ADD(opcode)		((opcode) == ASM_OPCODE_ADD_SCALED2 || (opcode) == ASM_OPCODE_ADD_SCALED4 || (opcode) == ASM_OPCODE_ADD_SCALED8)
+#define ASM_IS_LEA(opcode)				((opcode) == ASM_OPCODE_LEA3 || (opcode) == ASM_OPCODE_LEA5 || (opcode) == ASM_OPCODE_LEA9 || ASM_IS_SCALED_ADD(opcode))
+#define ASM_IS_ZERO_EXTENSION(opcode)	((opcode) == ASM_OPCODE_MOVZB || (opcode) == ASM_OPCODE_MOVZW || (opcode) == ASM_OPCODE_MOVZL)
+#define ASM_IS_EXTENSION(opcode)		(ASM_IS_ZERO_EXTENSION(opcode) || (opcode) == ASM_OPCODE_MOVSB || (opcode) == ASM_OPCODE_MOVSW || (opcode) == ASM_OPCODE_MOVSL)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	x86-64 general purpose registers, in hardware encoding order
+ */
+typedef enum
+{
+	ASM_REGISTER_RAX = 0,
+	ASM_REGISTER_RCX,
+	ASM_REGISTER_RDX,
+	ASM_REGISTER_RBX,
+	ASM_REGISTER_RSP,
+	ASM_REGISTER_RBP,
+	ASM_REGISTER_RSI,
+	ASM_REGISTER_RDI,
+	ASM_REGISTER_R8,
+	ASM_REGISTER_R9,
+	ASM_REGISTER_R10,
+	ASM_REGISTER_R11,
+	ASM_REGISTER_R12,
+	ASM_REGISTER_R13,
+	ASM_REGISTER_R14,
+	ASM_REGISTER_R15,
+	//////////////////////////////
+	ASM_REGISTER_NUM_REGISTERS
+} ASM_register_t;
+
+typedef enum
+{
+	ASM_OPCODE_MOV = 0,
+	ASM_OPCODE_ADD,
+	ASM_OPCODE_SUB,
+	ASM_OPCODE_IMUL,
+	ASM_OPCODE_DIV,			// Unsigned divide of edx:eax by the source operand
+	ASM_OPCODE_IDIV,		// Signed divide of edx:eax by the source operand
+	ASM_OPCODE_CDQ,			// Sign extend eax into edx:eax, as cltd (cqto at 64 bits)
+	ASM_OPCODE_XOR,
+	ASM_OPCODE_SHL,			// Shift left by an immediate count
+	ASM_OPCODE_SHR,			// Logical shift right by an immediate count
+	ASM_OPCODE_LEA3,		// dst = src * 3, as lea (src,src,2). Both operands are registers
+	ASM_OPCODE_LEA5,		// dst = src * 5, as lea (src,src,4)
+	ASM_OPCODE_LEA9,		// dst = src * 9, as lea (src,src,8)
+	ASM_OPCODE_ADD_SCALED2,	// dst += src * 2, as lea (dst,src,2). Both operands are registers
+	ASM_OPCODE_ADD_SCALED4,	// dst += src * 4, as lea (dst,src,4)
+	ASM_OPCODE_ADD_SCALED8,	// dst += src * 8, as lea (dst,src,8)
+	ASM_OPCODE_MOVZB,		// Zero extend a byte source into the register, as movzbl. Writes the whole register
+	ASM_OPCODE_MOVZW,		// Zero extend a 16-bit source, as movzwl. Writes the whole register
+	ASM_OPCODE_MOVZL,		// Zero extend a 32-bit source (or immediate) to 64 bits, as a plain movl
+	ASM_OPCODE_MOVSB,		// Sign extend a byte source to the instruction's width, as movsbl/movsbq
+	ASM_OPCODE_MOVSW,		// Sign extend a 16-bit source, as movswl/movswq
+	ASM_OPCODE_MOVSL,		// Sign extend a 32-bit source to 64 bits, as movslq
+	ASM_OPCODE_PUSH,
+	ASM_OPCODE_POP,
+	ASM_OPCODE_RET,
+	ASM_OPCODE_MOVDQU,		// Unaligned 128-bit load into, or store from, an xmm register
+	ASM_OPCODE_MOVD,		// 32-bit general register or memory into the low lane of an xmm register, zeroing the rest
+	ASM_OPCODE_PSHUFD0,		// Broadcast the source's low lane to all four, as pshufd $0
+	ASM_OPCODE_PADDD,		// Four 32-bit adds, xmm registers only
+	ASM_OPCODE_PSUBD,		// Four 32-bit subtracts, xmm registers only
+	//////////////////////////////
+	ASM_OPCODE_NUM_OPCODES
+} ASM_opcode_t;
+
+typedef enum
+{
+	ASM_OPERAND_NONE = 0,
+	ASM_OPERAND_REGISTER,		// Value is an ASM_register_t
+	ASM_OPERAND_IMMEDIATE,		// Value is the immediate itself
+	ASM_OPERAND_VARIABLE,		// Value is a symbol table index
+	ASM_OPERAND_VIRTUAL,		// Value is a virtual register, until register allocation replaces it
+	ASM_OPERAND_STACK,			// Value is a byte offset from %rsp
+	ASM_OPERAND_XMM,			// Value is an xmm register number. Selection picks them itself; allocation leaves them be
+	//////////////////////////////
+	ASM_OPERAND_NUM_KINDS
+} ASM_operand_kind_t;
+
+/*
+ *	Operand size. Arithmetic is 32 or 64-bit; 8 and 16-bit moves only store narrow variables.
+ *	Writing a 32-bit register zeroes the upper half, so 32 bits is what everything uses when it can.
+ *	128 bits is four u32 lanes of an xmm register, and a variable operand then covers the ones after it
+ */
+typedef enum
+{
+	ASM_WIDTH_32 = 0,
+	ASM_WIDTH_64,
+	ASM_WIDTH_8,
+	ASM_WIDTH_16,
+	ASM_WIDTH_128,
+	//////////////////////////////
+	ASM_WIDTH_NUM_WIDTHS
+} ASM_width_t;
+
+/*
+ *	One instruction, kept compact so that millions of them stay cheap to record.
+ *	Operands follow AT&T order: the destination is written
+ */
+typedef struct _ASM_instruction
+{
+	uint8_t		u8_opcode;			// ASM_opcode_t
+	uint8_t		u8_width;			// ASM_width_t
+	uint8_t		u8_src_kind;		// ASM_operand_kind_t
+	uint8_t		u8_dst_kind;		// ASM_operand_kind_t
+	uint32_t	u32_src;
+	uint32_t	u32_dst;
+} ASM_instruction_t;
+
+typedef struct _ASM_buffer
+{
+	ASM_instruction_t *		p_instructions;
+	uint32_t				u32_num_instructions;
+	uint32_t				u32_capacity;
+} ASM_buffer_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			ASM_init_buffer					(ASM_buffer_t * p_buffer);
+void 			ASM_deinit_buffer				(ASM_buffer_t * p_buffer);
+void 			ASM_append_instruction			(ASM_buffer_t * p_buffer, const ASM_instruction_t * kp_instruction);
+void 			ASM_insert_instructions			(ASM_buffer_t * p_buffer, uint32_t u32_index, const ASM_instruction_t * kp_instructions, uint32_t u32_count);
+void 			ASM_emit						(ASM_buffer_t * p_buffer, ASM_opcode_t opcode, ASM_width_t width,
+													ASM_operand_kind_t src_kind, uint32_t u32_src,
+													ASM_operand_kind_t dst_kind, uint32_t u32_dst);
+char * 			ASM_format_program				(const ASM_buffer_t * kp_buffer, size_t * p_size);
+STATUS_t 		ASM_write_program				(const ASM_buffer_t * kp_buffer, const char * kpc_fname);
+const char * 	ASM_get_register_name			(ASM_register_t reg, ASM_width_t width);
+uint8_t 		ASM_get_lea_scale				(ASM_opcode_t opcode);
+uint32_t 		ASM_get_variable_offset			(uint32_t u32_variable);
+ASM_width_t 	ASM_get_width					(uint8_t u8_size);
+ASM_width_t 	ASM_get_src_width				(const ASM_instruction_t * kp_instruction);
+ASM_width_t 	ASM_get_dst_width				(const ASM_instruction_t * kp_instruction);
+
+#endif
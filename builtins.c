@@ -0,0 +1,126 @@
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	const char *	kpc_name;
+	uint8_t			u8_size;			// Bytes
+	bool			b_signed;
+} BUILTINS_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const BUILTINS_info_t pk_types[BUILTINS_TYPE_NUM_TYPES] =
+{
+	[BUILTINS_TYPE_U8]	= { .kpc_name = "u8", 	.u8_size = 1, .b_signed = false },
+	[BUILTINS_TYPE_U16]	= { .kpc_name = "u16", 	.u8_size = 2, .b_signed = false },
+	[BUILTINS_TYPE_U32]	= { .kpc_name = "u32", 	.u8_size = 4, .b_signed = false },
+	[BUILTINS_TYPE_U64]	= { .kpc_name = "u64", 	.u8_size = 8, .b_signed = false },
+	[BUILTINS_TYPE_I8]	= { .kpc_name = "i8", 	.u8_size = 1, .b_signed = true },
+	[BUILTINS_TYPE_I16]	= { .kpc_name = "i16", 	.u8_size = 2, .b_signed = true },
+	[BUILTINS_TYPE_I32]	= { .kpc_name = "i32", 	.u8_size = 4, .b_signed = true },
+	[BUILTINS_TYPE_I64]	= { .kpc_name = "i64", 	.u8_size = 8, .b_signed = true },
+};
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	The type a name refers to, or BUILTINS_TYPE_NUM_TYPES if it's no type's name
+ */
+BUILTINS_type_t BUILTINS_lookup(const char * kpc_lexeme)
+{
+	for (uint32_t i = 0; i < BUILTINS_TYPE_NUM_TYPES; i++)
+	{
+		if (strcmp(pk_types[i].kpc_name, kpc_lexeme) == 0)
+		{
+			return (BUILTINS_type_t)i;
+		}
+	}
+
+	return BUILTINS_TYPE_NUM_TYPES;
+}
+
+const char * BUILTINS_get_name(BUILTINS_type_t type)
+{
+	ASSERT(type < BUILTINS_TYPE_NUM_TYPES);
+	return pk_types[type].kpc_name;
+}
+
+uint8_t BUILTINS_get_size(BUILTINS_type_t type)
+{
+	ASSERT(type < BUILTINS_TYPE_NUM_TYPES);
+	return pk_types[type].u8_size;
+}
+
+bool BUILTINS_is_signed(BUILTINS_type_t type)
+{
+	ASSERT(type < BUILTINS_TYPE_NUM_TYPES);
+	return pk_types[type].b_signed;
+}
+
+/*
+ *	Arithmetic is never narrower than 32 bits: 8 and 16-bit values widen to 32, keeping their sign
+ */
+BUILTINS_type_t BUILTINS_promote(BUILTINS_type_t type)
+{
+	switch (type)
+	{
+		case BUILTINS_TYPE_U8:
+		case BUILTINS_TYPE_U16:
+		{
+			return BUILTINS_TYPE_U32;
+		}
+		case BUILTINS_TYPE_I8:
+		case BUILTINS_TYPE_I16:
+		{
+			return BUILTINS_TYPE_I32;
+		}
+		default:
+		{
+			return type;
+		}
+	}
+}
+
+/*
+ *	The type two operands are computed in, as C would: both promoted, then the wider of the two,
+ *	or the unsigned one if they're as wide
+ */
+BUILTINS_type_t BUILTINS_combine(BUILTINS_type_t left, BUILTINS_type_t right)
+{
+	left = BUILTINS_promote(left);
+	right = BUILTINS_promote(right);
+
+	if (pk_types[left].u8_size != pk_types[right].u8_size)
+	{
+		return (pk_types[left].u8_size > pk_types[right].u8_size) ? left : right;
+	}
+
+	return pk_types[left].b_signed ? right : left;
+}
+
+/*
+ *	Reads a variable out of its storage, sign or zero extended to 64 bits
+ */
+uint64_t BUILTINS_read(BUILTINS_type_t type, const void * kp_storage)
+{
+	uint8_t u8_shift = (uint8_t)(64 - (8 * BUILTINS_get_size(type)));
+	uint64_t u64_value = 0;
+
+	// Little endian: the low bytes come first whatever the size
+	memcpy(&u64_value, kp_storage, BUILTINS_get_size(type));
+
+	if (BUILTINS_is_signed(type) && u8_shift > 0)
+	{
+		u64_value = (uint64_t)((int64_t)(u64_value << u8_shift) >> u8_shift);
+	}
+
+	return u64_value;
+}
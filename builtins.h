@@ -1,11 +1,39 @@
 #ifndef BUILTINS_H
 #define BUILTINS_H
 
+#include "common.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Integer types. u32 stays first: it's what a variable is when nothing declares it otherwise
+ */
 typedef enum
 {
-	BUILTINS_TYPE_U32,
+	BUILTINS_TYPE_U32 = 0,
+	BUILTINS_TYPE_U8,
+	BUILTINS_TYPE_U16,
+	BUILTINS_TYPE_U64,
+	BUILTINS_TYPE_I8,
+	BUILTINS_TYPE_I16,
+	BUILTINS_TYPE_I32,
+	BUILTINS_TYPE_I64,
 	//////////////////////////////
 	BUILTINS_TYPE_NUM_TYPES
 } BUILTINS_type_t;
 
-#endif
\ No newline at end of file
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+BUILTINS_type_t 	BUILTINS_lookup					(const char * kpc_lexeme);
+const char * 		BUILTINS_get_name				(BUILTINS_type_t type);
+uint8_t 			BUILTINS_get_size				(BUILTINS_type_t type);
+bool 				BUILTINS_is_signed				(BUILTINS_type_t type);
+BUILTINS_type_t 	BUILTINS_promote				(BUILTINS_type_t type);
+BUILTINS_type_t 	BUILTINS_combine				(BUILTINS_type_t left, BUILTINS_type_t right);
+uint64_t 			BUILTINS_read					(BUILTINS_type_t type, const void * kp_storage);
+
+#endif
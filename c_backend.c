@@ -0,0 +1,424 @@
+#include <unistd.h>
+#include <stdarg.h>
+#include "c_backend.h"
+#include "ir.h"
+#include "asm.h"
+#include "io_handler.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_C_BACKEND
+#define C_BACKEND_DBG(fmt, ...)			printf(BOLD("C_BACKEND:\t")fmt, ##__VA_ARGS__)
+#define C_BACKEND_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("C_BACKEND:\t"))fmt, ##__VA_ARGS__)
+#define C_BACKEND_WARN(fmt, ...)		printf(BOLD(BRIGHT_YELLOW("C_BACKEND:\t"))fmt, ##__VA_ARGS__)
+#define C_BACKEND_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("C_BACKEND:\t"))fmt, ##__VA_ARGS__)
+#else
+#define C_BACKEND_DBG(fmt, ...)
+#define C_BACKEND_GREEN(fmt, ...)
+#define C_BACKEND_WARN(fmt, ...)
+#define C_BACKEND_ERR(fmt, ...)
+#endif
+
+#define C_BACKEND_MAX_NODE_LENGTH		(64)	// Per node, less a variable's name: "((uint64_t)4294967295u + ", "rep_sdiv64(, )"
+#define C_BACKEND_MAX_STATEMENT_LENGTH	(48)	// Per statement, less the target's name: "\trep_var_ = (uint16_t)();\n"
+#define C_BACKEND_MAX_SYMBOL_LENGTH		(224)	// Per variable, less its name five times: declared, loaded, stored and named, and "4294967295, "
+#define C_BACKEND_MAX_FIXED_LENGTH		(512)	// Besides the prologue: the variable count, the tables' ends and rep_main's
+#define C_BACKEND_MAX_COMMAND_LENGTH	(1024)
+
+#define C_BACKEND_TEMP_FILE_TEMPLATE	"/tmp/rep_c_XXXXXX"
+
+#define C_BACKEND_APPEND(p_writer, fmt, ...) \
+	C_BACKEND_append((p_writer), fmt, ##__VA_ARGS__)
+
+/*
+ *	Everything the statements need ahead of rep_main. Dividing by zero, or the most negative value
+ *	by -1, traps as div does in native code rather than being undefined
+ */
+#define C_BACKEND_PROLOGUE \
+	"#include <stdint.h>\n" \
+	"#include <string.h>\n" \
+	"\n" \
+	"static inline uint32_t rep_udiv32(uint32_t a, uint32_t b)\n" \
+	"{\n" \
+	"\tif (b == 0) __builtin_trap();\n" \
+	"\treturn a / b;\n" \
+	"}\n" \
+	"\n" \
+	"static inline uint32_t rep_sdiv32(uint32_t a, uint32_t b)\n" \
+	"{\n" \
+	"\tif (b == 0 || (a == 0x80000000u && b == 0xFFFFFFFFu)) __builtin_trap();\n" \
+	"\treturn (uint32_t)((int32_t)a / (int32_t)b);\n" \
+	"}\n" \
+	"\n" \
+	"static inline uint64_t rep_udiv64(uint64_t a, uint64_t b)\n" \
+	"{\n" \
+	"\tif (b == 0) __builtin_trap();\n" \
+	"\treturn a / b;\n" \
+	"}\n" \
+	"\n" \
+	"static inline uint64_t rep_sdiv64(uint64_t a, uint64_t b)\n" \
+	"{\n" \
+	"\tif (b == 0 || (a == 0x8000000000000000u && b == 0xFFFFFFFFFFFFFFFFu)) __builtin_trap();\n" \
+	"\treturn (uint64_t)((int64_t)a / (int64_t)b);\n" \
+	"}\n" \
+	"\n"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	char *				pc_text;
+	size_t				size;
+	size_t				capacity;
+	BUILTINS_type_t		type;				// What the statement being written computes in
+	bool				b_wide;				// and whether that's 64 bits, done in uint64_t, or 32 in uint32_t
+} C_BACKEND_writer_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const char * const pk_type_names[BUILTINS_TYPE_NUM_TYPES] =
+{
+	[BUILTINS_TYPE_U32]	= "uint32_t",
+	[BUILTINS_TYPE_U8]	= "uint8_t",
+	[BUILTINS_TYPE_U16]	= "uint16_t",
+	[BUILTINS_TYPE_U64]	= "uint64_t",
+	[BUILTINS_TYPE_I8]	= "int8_t",
+	[BUILTINS_TYPE_I16]	= "int16_t",
+	[BUILTINS_TYPE_I32]	= "int32_t",
+	[BUILTINS_TYPE_I64]	= "int64_t",
+};
+
+static const char * const pk_operators[PARSE_NODE_TYPE_NUM_TYPES] =
+{
+	[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= "+",
+	[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= "-",
+	[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= "*",
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static size_t 			C_BACKEND_measure_tree			(const PARSE_node_t * kp_node);
+static void 			C_BACKEND_write_statement		(C_BACKEND_writer_t * p_writer, const PARSE_node_t * kp_tree);
+static void 			C_BACKEND_write_expression		(C_BACKEND_writer_t * p_writer, const PARSE_node_t * kp_node);
+static void 			C_BACKEND_append				(C_BACKEND_writer_t * p_writer, const char * kpc_format, ...) __attribute__ ((format (printf, 2, 3)));
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Renders the program as a C translation unit defining the same rep_main and variable tables
+ *	the native back end does, over the same storage. Variables are locals,
+ *	read from storage on entry and the ones assigned written back on return, so the compiler
+ *	keeps them in registers in between. Each statement computes in its own type, as IR_lower has
+ *	it, in unsigned arithmetic so it wraps as native code does. Bare expressions are dropped, as
+ *	the VM does, and malformed statements skipped. The caller frees the text
+ */
+char * C_BACKEND_format_program(const PARSE_tree_list_t * kp_tree_list, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint32_t u32_num_symbols = SYMBOL_TABLE_get_num_symbols();
+	bool * pb_assigned = calloc(u32_num_symbols + 1, sizeof(bool));
+	C_BACKEND_writer_t writer = { 0 };
+	size_t capacity = sizeof(C_BACKEND_PROLOGUE) + C_BACKEND_MAX_FIXED_LENGTH;
+	const PARSE_node_t * kp_tree;
+	const char * kpc_name;
+
+	ASSERT(pb_assigned);
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		capacity += C_BACKEND_MAX_SYMBOL_LENGTH + (5 * strlen(kp_symbols[i].p_token->pc_lexeme));
+	}
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		if (IR_tree_is_valid(kp_tree_list->trees[i]))
+		{
+			capacity += C_BACKEND_MAX_STATEMENT_LENGTH + C_BACKEND_measure_tree(kp_tree_list->trees[i]);
+		}
+	}
+
+	writer.pc_text = malloc(capacity);
+	writer.capacity = capacity;
+	ASSERT(writer.pc_text);
+
+	C_BACKEND_APPEND(&writer, C_BACKEND_PROLOGUE "const uint32_t " ASM_NUM_VARIABLES_SYMBOL " = %u;\n", u32_num_symbols);
+
+	// An empty initializer list isn't C, so the tables always have at least one entry
+	C_BACKEND_APPEND(&writer, "const uint32_t " ASM_VARIABLE_OFFSETS_SYMBOL "[] = { ");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		C_BACKEND_APPEND(&writer, "%u, ", SYMBOL_TABLE_get_offset(i));
+	}
+
+	// Names are NUL-separated, in variable order. Three octal digits, so a name can't run on into the escape
+	C_BACKEND_APPEND(&writer, "0 };\nconst char " ASM_VARIABLE_NAMES_SYMBOL "[] = \"");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		C_BACKEND_APPEND(&writer, "%s\\000", kp_symbols[i].p_token->pc_lexeme);
+	}
+
+	C_BACKEND_APPEND(&writer, "\";\nconst uint8_t " ASM_VARIABLE_TYPES_SYMBOL "[] = { ");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		C_BACKEND_APPEND(&writer, "%u, ", ASM_VARIABLE_TYPE_BYTE(kp_symbols[i].builtin_type));
+	}
+
+	C_BACKEND_APPEND(&writer, "0 };\n\nvoid " ASM_ENTRY_SYMBOL "(uint32_t * p_variables)\n{\n\tuint8_t * pu8_storage = (uint8_t *)p_variables;\n");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		C_BACKEND_APPEND(&writer, "\t%s " ASM_VARIABLE_SYMBOL_PREFIX "%s;\n", pk_type_names[kp_symbols[i].builtin_type],
+			kp_symbols[i].p_token->pc_lexeme);
+	}
+
+	C_BACKEND_APPEND(&writer, "\n");
+
+	// memcpy, since the storage holds every type whatever the pointer says
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		kpc_name = kp_symbols[i].p_token->pc_lexeme;
+		C_BACKEND_APPEND(&writer, "\tmemcpy(&" ASM_VARIABLE_SYMBOL_PREFIX "%s, pu8_storage + %u, sizeof(" ASM_VARIABLE_SYMBOL_PREFIX "%s));\n",
+			kpc_name, SYMBOL_TABLE_get_offset(i), kpc_name);
+	}
+
+	C_BACKEND_APPEND(&writer, "\n");
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		kp_tree = kp_tree_list->trees[i];
+
+		if (!IR_tree_is_valid(kp_tree))
+		{
+			C_BACKEND_ERR("Skipping malformed statement\n");
+			continue;
+		}
+
+		if (kp_tree->type == PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT)
+		{
+			C_BACKEND_write_statement(&writer, kp_tree);
+			pb_assigned[SYMBOL_TABLE_lookup(kp_tree->p_left->p_token->pc_lexeme)] = true;
+		}
+	}
+
+	C_BACKEND_APPEND(&writer, "\n");
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		if (pb_assigned[i])
+		{
+			kpc_name = kp_symbols[i].p_token->pc_lexeme;
+			C_BACKEND_APPEND(&writer, "\tmemcpy(pu8_storage + %u, &" ASM_VARIABLE_SYMBOL_PREFIX "%s, sizeof(" ASM_VARIABLE_SYMBOL_PREFIX "%s));\n",
+				SYMBOL_TABLE_get_offset(i), kpc_name, kpc_name);
+		}
+	}
+
+	C_BACKEND_APPEND(&writer, "}\n");
+
+	ASSERT(writer.size < capacity);
+	*p_size = writer.size;
+	free(pb_assigned);
+
+	C_BACKEND_DBG("Wrote %u statements as %zu bytes of C\n", kp_tree_list->u32_num_trees, writer.size);
+
+	return writer.pc_text;
+}
+
+/*
+ *	Writes the translation unit out, for a C compiler or for inspection
+ */
+STATUS_t C_BACKEND_write_program(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_text;
+
+	pc_text = C_BACKEND_format_program(kp_tree_list, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_text, size);
+	free(pc_text);
+
+	return status;
+}
+
+/*
+ *	Looked for once, on the PATH
+ */
+bool C_BACKEND_compiler_available(void)
+{
+	static int available = -1;
+
+	if (available < 0)
+	{
+		available = (system("command -v gcc > /dev/null 2>&1") == 0);
+	}
+
+	return available == 1;
+}
+
+/*
+ *	Compiles the translation unit to an object with the system gcc. Fails if there is none, or it
+ *	rejects the code
+ */
+STATUS_t C_BACKEND_compile_object(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname)
+{
+	char pc_c_fname[] = C_BACKEND_TEMP_FILE_TEMPLATE;
+	char pc_command[C_BACKEND_MAX_COMMAND_LENGTH];
+	STATUS_t status;
+	int fd;
+	int length;
+
+	if (!C_BACKEND_compiler_available())
+	{
+		C_BACKEND_ERR("gcc is not installed\n");
+		return STATUS_FAILED;
+	}
+
+	// The output goes to the shell single quoted
+	if (strchr(kpc_fname, '\'') != NULL)
+	{
+		C_BACKEND_ERR("Can't pass %s to gcc\n", kpc_fname);
+		return STATUS_FAILED;
+	}
+
+	fd = mkstemp(pc_c_fname);
+
+	if (fd < 0)
+	{
+		C_BACKEND_ERR("Failed to create a temporary file\n");
+		return STATUS_FILE_ERROR;
+	}
+
+	close(fd);
+	status = C_BACKEND_write_program(kp_tree_list, pc_c_fname);
+
+	if (status == STATUS_OK)
+	{
+		length = snprintf(pc_command, sizeof(pc_command), C_BACKEND_CC_COMMAND, pc_c_fname, kpc_fname);
+
+		if (length < 0 || (size_t)length >= sizeof(pc_command))
+		{
+			C_BACKEND_ERR("Path too long to pass to gcc\n");
+			status = STATUS_FAILED;
+		}
+		else
+		{
+			C_BACKEND_DBG("Running %s\n", pc_command);
+
+			if (system(pc_command) != 0)
+			{
+				C_BACKEND_ERR("gcc failed to compile %s\n", pc_c_fname);
+				status = STATUS_FAILED;
+			}
+		}
+	}
+
+	remove(pc_c_fname);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Most text a subtree is written as
+ */
+static size_t C_BACKEND_measure_tree(const PARSE_node_t * kp_node)
+{
+	if (kp_node == NULL)
+	{
+		return 0;
+	}
+
+	return C_BACKEND_MAX_NODE_LENGTH + strlen(kp_node->p_token->pc_lexeme) +
+			C_BACKEND_measure_tree(kp_node->p_left) + C_BACKEND_measure_tree(kp_node->p_right);
+}
+
+/*
+ *	Computes the right-hand side in the statement's type, then converts it to the variable's,
+ *	keeping as many low bits as that holds
+ */
+static void C_BACKEND_write_statement(C_BACKEND_writer_t * p_writer, const PARSE_node_t * kp_tree)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kp_tree->p_left->p_token->pc_lexeme);
+	BUILTINS_type_t variable_type = SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type;
+
+	p_writer->type = IR_get_statement_type(kp_tree);
+	p_writer->type = (p_writer->type == BUILTINS_TYPE_NUM_TYPES) ? BUILTINS_TYPE_U32 : p_writer->type;
+	p_writer->b_wide = (BUILTINS_get_size(p_writer->type) == sizeof(uint64_t));
+
+	C_BACKEND_APPEND(p_writer, "\t" ASM_VARIABLE_SYMBOL_PREFIX "%s = (%s)", kp_tree->p_left->p_token->pc_lexeme, pk_type_names[variable_type]);
+	C_BACKEND_write_expression(p_writer, kp_tree->p_right);
+	C_BACKEND_APPEND(p_writer, ";\n");
+}
+
+/*
+ *	Converting any variable to the unsigned statement type widens it by its own signedness.
+ *	Literals are written in full, and a 32-bit statement keeps their low half. Every operation is parenthesized, so the tree's shape is kept
+ */
+static void C_BACKEND_write_expression(C_BACKEND_writer_t * p_writer, const PARSE_node_t * kp_node)
+{
+	bool b_wide = p_writer->b_wide;
+
+	if (kp_node->type == PARSE_NODE_TYPE_ID && kp_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+	{
+		if (b_wide)
+		{
+			C_BACKEND_APPEND(p_writer, "(uint64_t)%lluu", (unsigned long long)IR_literal_value(kp_node->p_token->pc_lexeme));
+		}
+		else
+		{
+			C_BACKEND_APPEND(p_writer, "%uu", (uint32_t)IR_literal_value(kp_node->p_token->pc_lexeme));
+		}
+	}
+	else if (kp_node->type == PARSE_NODE_TYPE_ID)
+	{
+		C_BACKEND_APPEND(p_writer, "(%s)" ASM_VARIABLE_SYMBOL_PREFIX "%s", b_wide ? "uint64_t" : "uint32_t", kp_node->p_token->pc_lexeme);
+	}
+	else if (kp_node->type == PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE)
+	{
+		C_BACKEND_APPEND(p_writer, "rep_%cdiv%s(", BUILTINS_is_signed(p_writer->type) ? 's' : 'u', b_wide ? "64" : "32");
+		C_BACKEND_write_expression(p_writer, kp_node->p_left);
+		C_BACKEND_APPEND(p_writer, ", ");
+		C_BACKEND_write_expression(p_writer, kp_node->p_right);
+		C_BACKEND_APPEND(p_writer, ")");
+	}
+	else
+	{
+		C_BACKEND_APPEND(p_writer, "(");
+		C_BACKEND_write_expression(p_writer, kp_node->p_left);
+		C_BACKEND_APPEND(p_writer, " %s ", pk_operators[kp_node->type]);
+		C_BACKEND_write_expression(p_writer, kp_node->p_right);
+		C_BACKEND_APPEND(p_writer, ")");
+	}
+}
+
+/*
+ *	The text was sized for the longest the program can be written as, so it never runs out
+ */
+static void C_BACKEND_append(C_BACKEND_writer_t * p_writer, const char * kpc_format, ...)
+{
+	va_list args;
+	int length;
+
+	va_start(args, kpc_format);
+	length = vsnprintf(p_writer->pc_text + p_writer->size, p_writer->capacity - p_writer->size, kpc_format, args);
+	va_end(args);
+
+	ASSERT(length >= 0 && (size_t)length < p_writer->capacity - p_writer->size);
+	p_writer->size += (size_t)length;
+}
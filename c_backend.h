@@ -0,0 +1,27 @@
+#ifndef C_BACKEND_H
+#define C_BACKEND_H
+
+#include "common.h"
+#include "status.h"
+#include "parse.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	How the translation unit is compiled, given its file and then the object's. Position
+ *	independent, so the object can be linked either way
+ */
+#define C_BACKEND_CC_COMMAND			"gcc -O2 -fPIC -x c -c %s -o '%s'"
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+char * 			C_BACKEND_format_program		(const PARSE_tree_list_t * kp_tree_list, size_t * p_size);
+STATUS_t 		C_BACKEND_write_program			(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname);
+bool 			C_BACKEND_compiler_available	(void);
+STATUS_t 		C_BACKEND_compile_object		(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname);
+
+#endif
@@ -1,6 +1,24 @@
+#include <pthread.h>
+#include <unistd.h>
 #include "code_gen.h"
+#include "encoder.h"
+#include "elf_writer.h"
+#include "regalloc.h"
+#include "peephole.h"
+#include "schedule.h"
+#include "promote.h"
+#include "ir.h"
+#include "fold.h"
+#include "gvn.h"
+#include "dce.h"
+#include "reassoc.h"
+#include "slp.h"
+#include "layout.h"
+#include "strength.h"
+#include "tile.h"
+#include "pass.h"
+#include "symbol_table.h"
 #include "io_handler.h"
-#include "lex.h"
 
 /****************************************************************************************************
  *	D E F I N E S
@@ -18,185 +36,1197 @@
 #define CODE_GEN_ERR(fmt, ...)
 #endif
 
-#define INSTRUCTION_FMT(instruction)	BRIGHT_YELLOW(instruction)
+/*
+ *	Shorthands for the operand pairs handlers emit most
+ */
+#define CODE_GEN_VREG(u32_vreg)			ASM_OPERAND_VIRTUAL, (u32_vreg)
+#define CODE_GEN_HW_REG(asm_register)	ASM_OPERAND_REGISTER, (asm_register)
+#define CODE_GEN_NONE					ASM_OPERAND_NONE, 0
+
+#define CODE_GEN_MAX_WORKERS			(64)
+
+/*
+ *	IR instructions below which another worker costs more to start than it saves
+ */
+#define CODE_GEN_MIN_WORKER_SIZE		(1u << 14)
 
 /****************************************************************************************************
  *	T Y P E D E F S
  ****************************************************************************************************/
 
+/*
+ *	Selects instructions for a run of whole statements, on its own thread, into its own buffer.
+ *	Nothing it writes is shared except its own values' entries in pu32_vregs and the cover
+ */
+typedef struct _CODE_GEN_worker
+{
+	uint32_t			u32_start;			// IR instructions [u32_start, u32_end)
+	uint32_t			u32_end;
+	uint32_t			u32_num_vregs;		// Numbered from 0 until the join rebases them
+	uint32_t			u32_cost;			// Of the tiles covering the range
+	uint32_t			u32_free_xmm;		// A bit per xmm register no vector value holds
+	ASM_buffer_t		buffer;
+	pthread_t			thread;
+} CODE_GEN_worker_t;
+
 typedef struct
 {
-	uint32_t	u32_label_index;
+	uint32_t			u32_label_index;
+	uint32_t			u32_num_threads;	// Most workers to run at once, or 0 for one per core
+	uint32_t			u32_gvn_budget;		// Most values value numbering keeps live at once, or 0 for the default
+	uint32_t			u32_num_vregs;
+	PASS_manager_t		passes;
+	IR_program_t		ir;					// The program as lowered from the parse trees
+	IR_def_use_t		def_use;
+	TILE_cover_t		cover;				// Which tile computes each value, and what its users take it as
+	uint32_t *			pu32_vregs;			// Virtual register holding each IR value
+	ASM_buffer_t		buffer;				// Every instruction emitted so far, in program order
+	FOLD_report_t		fold_report;
+	GVN_report_t		gvn_report;
+	DCE_report_t		dce_report;
+	REASSOC_report_t	reassoc_report;
+	SLP_report_t		slp_report;
+	LAYOUT_report_t		layout_report;
+	PROMOTE_result_t	promote_result;
+	REGALLOC_result_t	regalloc_result;
+	PEEPHOLE_result_t	peephole_result;
+	SCHEDULE_result_t	schedule_result;
 } CODE_GEN_info_t;
 
 /****************************************************************************************************
  *	S T A T I C   V A R I A B L E S
  ****************************************************************************************************/
 
-// None
+static CODE_GEN_info_t code_gen_info;
+
+/*
+ *	Registers rep_main must preserve for its caller (SysV)
+ */
+static const ASM_register_t pk_callee_saved_registers[] =
+{
+	ASM_REGISTER_RBX,
+	ASM_REGISTER_RBP,
+	ASM_REGISTER_R12,
+	ASM_REGISTER_R13,
+	ASM_REGISTER_R14,
+	ASM_REGISTER_R15,
+};
 
 /****************************************************************************************************
  *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
  ****************************************************************************************************/
 
 /*
- *	Code generation handlers
+ *	Instruction selection, one handler per IR opcode
  */
-static void 					CODE_GEN_handle_node						(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_ID				(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_ADD				(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_SUBTRACT			(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_MULTIPLY			(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_DIVIDE			(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_EXPR_TYPE_ASSIGNMENT		(PARSE_node_t * p_node);
-static void 					CODE_GEN_handle_STATEMENT_TYPE_ASSIGNMENT	(PARSE_node_t * p_node);
+static void 					CODE_GEN_select_instruction					(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_CONST						(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_LOAD						(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_STORE						(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_ARITHMETIC					(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_DIV							(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+static void 					CODE_GEN_handle_VECTOR						(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction);
+
+/*
+ *	Parallel selection
+ */
+static uint32_t 				CODE_GEN_partition							(CODE_GEN_worker_t * p_workers);
+static void 					CODE_GEN_run_workers						(CODE_GEN_worker_t * p_workers, uint32_t u32_num_workers);
+static void * 					CODE_GEN_worker_main						(void * p_arg);
+static void 					CODE_GEN_join								(CODE_GEN_worker_t * p_workers, uint32_t u32_num_workers);
+static uint32_t 				CODE_GEN_get_num_threads					(void);
 
 /*
  *	Helpers
  */
-void 							CODE_GEN_create_label						(void);
+static uint32_t 				CODE_GEN_two_address_target					(CODE_GEN_worker_t * p_worker, ASM_width_t width, uint32_t u32_left);
+static uint32_t 				CODE_GEN_result_target						(CODE_GEN_worker_t * p_worker, uint32_t u32_operand);
+static void 					CODE_GEN_get_source							(uint32_t u32_value, TILE_nonterminal_t nonterminal, uint8_t * pu8_kind, uint32_t * pu32_src);
+static void 					CODE_GEN_wrap_function						(void);
+static inline uint32_t 			CODE_GEN_new_vreg							(CODE_GEN_worker_t * p_worker);
+static inline uint32_t 			CODE_GEN_new_xmm							(CODE_GEN_worker_t * p_worker);
+static inline const IR_instruction_t * CODE_GEN_get_def						(uint32_t u32_value);
+static inline ASM_width_t 		CODE_GEN_get_width							(const IR_instruction_t * kp_instruction);
+
+/*
+ *	The pipeline, one function per pass. Each takes the parse trees, though only lowering reads them
+ */
+static uint32_t 				CODE_GEN_pass_lower							(void * p_context);
+static uint32_t 				CODE_GEN_pass_fold							(void * p_context);
+static uint32_t 				CODE_GEN_pass_gvn							(void * p_context);
+static uint32_t 				CODE_GEN_pass_dce							(void * p_context);
+static uint32_t 				CODE_GEN_pass_reassoc						(void * p_context);
+static uint32_t 				CODE_GEN_pass_slp							(void * p_context);
+static uint32_t 				CODE_GEN_pass_layout						(void * p_context);
+static uint32_t 				CODE_GEN_pass_verify						(void * p_context);
+static uint32_t 				CODE_GEN_pass_def_use						(void * p_context);
+static uint32_t 				CODE_GEN_pass_select						(void * p_context);
+static uint32_t 				CODE_GEN_pass_promote						(void * p_context);
+static uint32_t 				CODE_GEN_pass_peephole						(void * p_context);
+static uint32_t 				CODE_GEN_pass_schedule						(void * p_context);
+static uint32_t 				CODE_GEN_pass_regalloc						(void * p_context);
+static uint32_t 				CODE_GEN_pass_late_peephole					(void * p_context);
+static uint32_t 				CODE_GEN_pass_wrap							(void * p_context);
+
+/*
+ *	In the order they run. Folding before allocation shortens live ranges; allocation and spilling
+ *	leave more to clean up after, so the peephole pass runs on both sides of it
+ */
+static const PASS_t pk_passes[] =
+{
+	{ "lower",			PASS_LEVEL_O0,	CODE_GEN_pass_lower },
+	{ "fold",			PASS_LEVEL_O1,	CODE_GEN_pass_fold },
+	{ "gvn",			PASS_LEVEL_O2,	CODE_GEN_pass_gvn },
+	{ "dce",			PASS_LEVEL_O1,	CODE_GEN_pass_dce },
+	{ "reassoc",		PASS_LEVEL_O2,	CODE_GEN_pass_reassoc },
+	{ "slp",			PASS_LEVEL_O2,	CODE_GEN_pass_slp },
+	{ "layout",			PASS_LEVEL_O1,	CODE_GEN_pass_layout },
+	{ "verify",			PASS_LEVEL_O0,	CODE_GEN_pass_verify },
+	{ "def-use",		PASS_LEVEL_O0,	CODE_GEN_pass_def_use },
+	{ "select",			PASS_LEVEL_O0,	CODE_GEN_pass_select },
+	{ "promote",		PASS_LEVEL_O1,	CODE_GEN_pass_promote },
+	{ "peephole",		PASS_LEVEL_O1,	CODE_GEN_pass_peephole },
+	{ "schedule",		PASS_LEVEL_O2,	CODE_GEN_pass_schedule },
+	{ "regalloc",		PASS_LEVEL_O0,	CODE_GEN_pass_regalloc },
+	{ "late-peephole",	PASS_LEVEL_O1,	CODE_GEN_pass_late_peephole },
+	{ "wrap",			PASS_LEVEL_O0,	CODE_GEN_pass_wrap },
+};
 
 /****************************************************************************************************
  *	F U N C T I O N S
  ****************************************************************************************************/
 
-void CODE_GEN_traverse_tree(PARSE_node_t *p_root)
+/*
+ *	Initializes the module
+ */
+void CODE_GEN_init(void)
+{
+	CODE_GEN_DBG("Initializing\n");
+
+	code_gen_info.u32_label_index = 0;
+	code_gen_info.u32_num_vregs = 0;
+	code_gen_info.pu32_vregs = NULL;
+	PASS_init_manager(&code_gen_info.passes, pk_passes, sizeof(pk_passes) / sizeof(pk_passes[0]));
+	IR_init_program(&code_gen_info.ir);
+	ASM_init_buffer(&code_gen_info.buffer);
+	PEEPHOLE_init_result(&code_gen_info.peephole_result);
+}
+
+/*
+ *	Deinitializes the module
+ */
+void CODE_GEN_deinit(void)
+{
+	CODE_GEN_DBG("Deinitializing\n");
+
+	free(code_gen_info.pu32_vregs);
+	code_gen_info.pu32_vregs = NULL;
+	IR_deinit_program(&code_gen_info.ir);
+	ASM_deinit_buffer(&code_gen_info.buffer);
+}
+
+/*
+ *	Caps the threads instruction selection runs on. 0, the default, is one per core
+ */
+void CODE_GEN_set_num_threads(uint32_t u32_num_threads)
+{
+	code_gen_info.u32_num_threads = u32_num_threads;
+}
+
+/*
+ *	Caps how many values value numbering may keep live at once to reuse them. 0, the default, is
+ *	GVN_DEFAULT_BUDGET
+ */
+void CODE_GEN_set_gvn_budget(uint32_t u32_budget)
+{
+	code_gen_info.u32_gvn_budget = u32_budget;
+}
+
+/*
+ *	Picks which passes run. PASS_LEVEL_O2, the default, runs them all
+ */
+void CODE_GEN_set_opt_level(PASS_level_t level)
+{
+	PASS_set_level(&code_gen_info.passes, level);
+}
+
+/*
+ *	Enables or disables an optional pass by name, whatever the level. False if there's no such pass,
+ *	or it can't be disabled
+ */
+bool CODE_GEN_set_pass_enabled(const char * kpc_name, bool b_enabled)
+{
+	return PASS_set_enabled(&code_gen_info.passes, kpc_name, b_enabled);
+}
+
+/*
+ *	Generates rep_main from every statement, in source order, by running the pipeline over them:
+ *	lowers the trees to IR and optimizes it, then tiles runs of statements and emits their
+ *	instructions on as many threads as there are runs, and allocates registers over the result
+ */
+void CODE_GEN_run(const PARSE_tree_list_t * kp_tree_list)
+{
+	// Passes left out don't report anything
+	memset(&code_gen_info.fold_report, 0, sizeof(code_gen_info.fold_report));
+	memset(&code_gen_info.gvn_report, 0, sizeof(code_gen_info.gvn_report));
+	memset(&code_gen_info.dce_report, 0, sizeof(code_gen_info.dce_report));
+	memset(&code_gen_info.reassoc_report, 0, sizeof(code_gen_info.reassoc_report));
+	memset(&code_gen_info.slp_report, 0, sizeof(code_gen_info.slp_report));
+	memset(&code_gen_info.layout_report, 0, sizeof(code_gen_info.layout_report));
+	memset(&code_gen_info.schedule_result, 0, sizeof(code_gen_info.schedule_result));
+	memset(&code_gen_info.promote_result, 0, sizeof(code_gen_info.promote_result));
+
+	PASS_run(&code_gen_info.passes, (void *)kp_tree_list);
+
+	CODE_GEN_DBG("Emitted %u instructions for %u statements in %llu ns\n", code_gen_info.buffer.u32_num_instructions,
+		kp_tree_list->u32_num_trees, (unsigned long long)PASS_get_total_ns(&code_gen_info.passes));
+	CODE_GEN_DBG(BOLD(BRIGHT_GREEN("Done\n")));
+}
+
+/*
+ *	Retrieves the emitted instructions
+ */
+const ASM_buffer_t * CODE_GEN_get_buffer(void)
 {
-    if (!p_root)
+	return &code_gen_info.buffer;
+}
+
+/*
+ *	Retrieves the IR the instructions were selected from
+ */
+const IR_program_t * CODE_GEN_get_ir(void)
+{
+	return &code_gen_info.ir;
+}
+
+/*
+ *	What constant folding and propagation rewrote in the IR
+ */
+const FOLD_report_t * CODE_GEN_get_fold_report(void)
+{
+	return &code_gen_info.fold_report;
+}
+
+/*
+ *	What value numbering found already computed
+ */
+const GVN_report_t * CODE_GEN_get_gvn_report(void)
+{
+	return &code_gen_info.gvn_report;
+}
+
+/*
+ *	What dead code elimination removed from the IR
+ */
+const DCE_report_t * CODE_GEN_get_dce_report(void)
+{
+	return &code_gen_info.dce_report;
+}
+
+/*
+ *	Which chains of adds and multiplies were rebalanced, and by how much
+ */
+const REASSOC_report_t * CODE_GEN_get_reassoc_report(void)
+{
+	return &code_gen_info.reassoc_report;
+}
+
+/*
+ *	Which statements became vector code
+ */
+const SLP_report_t * CODE_GEN_get_slp_report(void)
+{
+	return &code_gen_info.slp_report;
+}
+
+/*
+ *	Where variables went in storage, and how many cache lines the accesses now fall in
+ */
+const LAYOUT_report_t * CODE_GEN_get_layout_report(void)
+{
+	return &code_gen_info.layout_report;
+}
+
+/*
+ *	Which passes ran the last time, how long each took and what it changed
+ */
+const PASS_manager_t * CODE_GEN_get_passes(void)
+{
+	return &code_gen_info.passes;
+}
+
+/*
+ *	Which variables were given registers for the whole program
+ */
+const PROMOTE_result_t * CODE_GEN_get_promote_result(void)
+{
+	return &code_gen_info.promote_result;
+}
+
+/*
+ *	What the peephole passes removed and rewrote
+ */
+const PEEPHOLE_result_t * CODE_GEN_get_peephole_result(void)
+{
+	return &code_gen_info.peephole_result;
+}
+
+/*
+ *	How scheduling reordered the code
+ */
+const SCHEDULE_result_t * CODE_GEN_get_schedule_result(void)
+{
+	return &code_gen_info.schedule_result;
+}
+
+/*
+ *	Writes the emitted program out as assembly
+ */
+STATUS_t CODE_GEN_write_assembly(const char * kpc_fname)
+{
+	return ASM_write_program(&code_gen_info.buffer, kpc_fname);
+}
+
+/*
+ *	Encodes the emitted program and writes it out as an ELF64 object, without going through `as`
+ */
+STATUS_t CODE_GEN_write_object(const char * kpc_fname)
+{
+	ENCODER_code_t code;
+	STATUS_t status;
+
+	ENCODER_init_code(&code);
+	status = ENCODER_encode_program(&code_gen_info.buffer, &code);
+
+	if (status == STATUS_OK)
 	{
-		return;
+		status = ELF_WRITER_write_object(&code, kpc_fname);
 	}
 
-	// Handle leaves first
-    if (!p_root->p_left && !p_root->p_right)
+	ENCODER_deinit_code(&code);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static uint32_t CODE_GEN_pass_lower(void * p_context)
+{
+	IR_lower((const PARSE_tree_list_t *)p_context, &code_gen_info.ir);
+
+	return code_gen_info.ir.u32_num_instructions;
+}
+
+static uint32_t CODE_GEN_pass_fold(void * p_context)
+{
+	FOLD_report_t * p_report = &code_gen_info.fold_report;
+
+	(void)p_context;
+	FOLD_run(&code_gen_info.ir, SYMBOL_TABLE_get_num_symbols(), p_report);
+
+	return p_report->u32_num_folded + p_report->u32_num_simplified + p_report->u32_num_propagated;
+}
+
+static uint32_t CODE_GEN_pass_gvn(void * p_context)
+{
+	(void)p_context;
+	GVN_run(&code_gen_info.ir, SYMBOL_TABLE_get_num_symbols(),
+		(code_gen_info.u32_gvn_budget != 0) ? code_gen_info.u32_gvn_budget : GVN_DEFAULT_BUDGET, &code_gen_info.gvn_report);
+
+	return code_gen_info.gvn_report.u32_num_reused;
+}
+
+static uint32_t CODE_GEN_pass_dce(void * p_context)
+{
+	(void)p_context;
+	DCE_run(&code_gen_info.ir, SYMBOL_TABLE_get_num_symbols(), &code_gen_info.dce_report);
+
+	return code_gen_info.dce_report.u32_num_dead_stores + code_gen_info.dce_report.u32_num_dead_instructions;
+}
+
+static uint32_t CODE_GEN_pass_reassoc(void * p_context)
+{
+	(void)p_context;
+	REASSOC_run(&code_gen_info.ir, &code_gen_info.reassoc_report);
+
+	return code_gen_info.reassoc_report.u32_num_chains;
+}
+
+static uint32_t CODE_GEN_pass_slp(void * p_context)
+{
+	(void)p_context;
+	SLP_run(&code_gen_info.ir, SYMBOL_TABLE_get_num_symbols(), &code_gen_info.slp_report);
+
+	return code_gen_info.slp_report.u32_num_groups;
+}
+
+/*
+ *	After vectorization, which decided what has to stay consecutive, and before anything reads an offset
+ */
+static uint32_t CODE_GEN_pass_layout(void * p_context)
+{
+	(void)p_context;
+	LAYOUT_run(&code_gen_info.ir, SYMBOL_TABLE_get_num_symbols(), &code_gen_info.layout_report);
+
+	return code_gen_info.layout_report.u32_num_moved;
+}
+
+static uint32_t CODE_GEN_pass_verify(void * p_context)
+{
+	(void)p_context;
+	ASSERT(IR_verify(&code_gen_info.ir));
+
+	return 0;
+}
+
+static uint32_t CODE_GEN_pass_def_use(void * p_context)
+{
+	(void)p_context;
+	IR_build_def_use(&code_gen_info.ir, &code_gen_info.def_use);
+
+	return 0;
+}
+
+/*
+ *	Tiles runs of statements and emits their instructions on as many threads as there are runs.
+ *	Their code is joined back in order, so the output is the same however many threads there are
+ */
+static uint32_t CODE_GEN_pass_select(void * p_context)
+{
+	CODE_GEN_worker_t p_workers[CODE_GEN_MAX_WORKERS];
+	uint32_t u32_num_workers;
+
+	(void)p_context;
+	TILE_init_cover(&code_gen_info.ir, &code_gen_info.cover);
+
+	code_gen_info.pu32_vregs = malloc(sizeof(uint32_t) * (code_gen_info.ir.u32_num_values + 1));
+	ASSERT(code_gen_info.pu32_vregs);
+
+	u32_num_workers = CODE_GEN_partition(p_workers);
+	CODE_GEN_run_workers(p_workers, u32_num_workers);
+	CODE_GEN_join(p_workers, u32_num_workers);
+
+	TILE_deinit_cover(&code_gen_info.cover);
+	IR_deinit_def_use(&code_gen_info.def_use);
+
+	CODE_GEN_DBG("Selected %u instructions on %u threads\n", code_gen_info.buffer.u32_num_instructions, u32_num_workers);
+
+	return code_gen_info.buffer.u32_num_instructions;
+}
+
+static uint32_t CODE_GEN_pass_promote(void * p_context)
+{
+	(void)p_context;
+	PROMOTE_run(&code_gen_info.buffer, code_gen_info.u32_num_vregs, SYMBOL_TABLE_get_num_symbols(), &code_gen_info.promote_result);
+
+	return code_gen_info.promote_result.u32_num_rewritten;
+}
+
+static uint32_t CODE_GEN_pass_peephole(void * p_context)
+{
+	PEEPHOLE_result_t * p_result = &code_gen_info.peephole_result;
+	uint32_t u32_before = p_result->u32_num_removed + p_result->u32_num_rewritten;
+
+	(void)p_context;
+	PEEPHOLE_run(&code_gen_info.buffer, code_gen_info.u32_num_vregs, p_result);
+
+	return p_result->u32_num_removed + p_result->u32_num_rewritten - u32_before;
+}
+
+/*
+ *	Keeps within the registers the allocator has left once promotion has taken its own
+ */
+static uint32_t CODE_GEN_pass_schedule(void * p_context)
+{
+	uint32_t u32_max_live = REGALLOC_NUM_ALLOCATABLE - (uint32_t)__builtin_popcount(code_gen_info.promote_result.u32_reserved);
+
+	(void)p_context;
+	SCHEDULE_run(&code_gen_info.buffer, code_gen_info.u32_num_vregs, u32_max_live, &code_gen_info.schedule_result);
+
+	return code_gen_info.schedule_result.u32_num_moved;
+}
+
+static uint32_t CODE_GEN_pass_regalloc(void * p_context)
+{
+	(void)p_context;
+	REGALLOC_run(&code_gen_info.buffer, code_gen_info.u32_num_vregs, code_gen_info.promote_result.u32_reserved, &code_gen_info.regalloc_result);
+
+	return code_gen_info.regalloc_result.u32_num_spilled;
+}
+
+/*
+ *	Allocation has replaced every virtual register, so there are none to look through
+ */
+static uint32_t CODE_GEN_pass_late_peephole(void * p_context)
+{
+	PEEPHOLE_result_t * p_result = &code_gen_info.peephole_result;
+	uint32_t u32_before = p_result->u32_num_removed + p_result->u32_num_rewritten;
+
+	(void)p_context;
+	PEEPHOLE_run(&code_gen_info.buffer, 0, p_result);
+
+	return p_result->u32_num_removed + p_result->u32_num_rewritten - u32_before;
+}
+
+static uint32_t CODE_GEN_pass_wrap(void * p_context)
+{
+	uint32_t u32_before = code_gen_info.buffer.u32_num_instructions;
+
+	(void)p_context;
+	CODE_GEN_wrap_function();
+
+	return code_gen_info.buffer.u32_num_instructions - u32_before;
+}
+
+/*
+ *	Splits the IR into at most one run per thread, each at least CODE_GEN_MIN_WORKER_SIZE long.
+ *	A run may only end where nothing defined before is used after, which in practice is between
+ *	statements
+ */
+static uint32_t CODE_GEN_partition(CODE_GEN_worker_t * p_workers)
+{
+	const IR_def_use_t * kp_def_use = &code_gen_info.def_use;
+	uint32_t u32_num_instructions = code_gen_info.ir.u32_num_instructions;
+	uint32_t u32_max_workers = CODE_GEN_get_num_threads();
+	uint32_t u32_num_workers = 0;
+	uint32_t u32_last_use = 0;
+	uint32_t u32_run_size;
+	uint32_t u32_value;
+
+	if (u32_max_workers > u32_num_instructions / CODE_GEN_MIN_WORKER_SIZE)
 	{
-		CODE_GEN_handle_node(p_root);
-    }
-	else
+		u32_max_workers = (u32_num_instructions / CODE_GEN_MIN_WORKER_SIZE > 0) ? u32_num_instructions / CODE_GEN_MIN_WORKER_SIZE : 1;
+	}
+
+	u32_run_size = (u32_num_instructions + u32_max_workers - 1) / u32_max_workers;
+	p_workers[0].u32_start = 0;
+
+	for (uint32_t i = 0; i < u32_num_instructions; i++)
 	{
-		if (p_root->p_left)
+		u32_value = code_gen_info.ir.p_instructions[i].u32_result;
+
+		// Uses are in program order, so the last one is the furthest
+		if (u32_value != IR_VALUE_NONE && kp_def_use->pu32_use_start[u32_value + 1] > kp_def_use->pu32_use_start[u32_value] &&
+			kp_def_use->pu32_uses[kp_def_use->pu32_use_start[u32_value + 1] - 1] > u32_last_use)
 		{
-			CODE_GEN_traverse_tree(p_root->p_left);
+			u32_last_use = kp_def_use->pu32_uses[kp_def_use->pu32_use_start[u32_value + 1] - 1];
 		}
 
-		if (p_root->p_right)
+		if (u32_num_workers + 1 < u32_max_workers && u32_last_use <= i && i + 1 - p_workers[u32_num_workers].u32_start >= u32_run_size)
 		{
-			CODE_GEN_traverse_tree(p_root->p_right);
+			p_workers[u32_num_workers].u32_end = i + 1;
+			p_workers[++u32_num_workers].u32_start = i + 1;
 		}
+	}
 
-		CODE_GEN_handle_node(p_root);
+	p_workers[u32_num_workers].u32_end = u32_num_instructions;
+
+	return u32_num_workers + 1;
+}
+
+/*
+ *	The calling thread takes the first run itself
+ */
+static void CODE_GEN_run_workers(CODE_GEN_worker_t * p_workers, uint32_t u32_num_workers)
+{
+	int error;
+
+	for (uint32_t i = 1; i < u32_num_workers; i++)
+	{
+		error = pthread_create(&p_workers[i].thread, NULL, CODE_GEN_worker_main, &p_workers[i]);
+		ASSERT(error == 0);
+	}
+
+	CODE_GEN_worker_main(&p_workers[0]);
+
+	for (uint32_t i = 1; i < u32_num_workers; i++)
+	{
+		error = pthread_join(p_workers[i].thread, NULL);
+		ASSERT(error == 0);
 	}
 }
 
-static void CODE_GEN_handle_node(PARSE_node_t * p_node)
+/*
+ *	Tiles the worker's run and emits every tile in it
+ */
+static void * CODE_GEN_worker_main(void * p_arg)
 {
-	if (p_node == NULL)
+	CODE_GEN_worker_t * p_worker = (CODE_GEN_worker_t *)p_arg;
+
+	p_worker->u32_num_vregs = 0;
+	p_worker->u32_free_xmm = (1u << ASM_NUM_XMM_REGISTERS) - 1;
+	ASM_init_buffer(&p_worker->buffer);
+
+	p_worker->u32_cost = TILE_cover_range(&code_gen_info.ir, &code_gen_info.def_use, p_worker->u32_start, p_worker->u32_end, &code_gen_info.cover);
+
+	for (uint32_t i = p_worker->u32_start; i < p_worker->u32_end; i++)
 	{
+		CODE_GEN_select_instruction(p_worker, &code_gen_info.ir.p_instructions[i]);
+	}
+
+	return NULL;
+}
+
+/*
+ *	Appends every worker's code in source order, renumbering its virtual registers to follow on
+ *	from the previous worker's. That numbers them exactly as a single worker would have
+ */
+static void CODE_GEN_join(CODE_GEN_worker_t * p_workers, uint32_t u32_num_workers)
+{
+	ASM_buffer_t * p_buffer = &code_gen_info.buffer;
+	ASM_instruction_t * p_instruction;
+	uint32_t u32_first;
+
+	for (uint32_t i = 0; i < u32_num_workers; i++)
+	{
+		u32_first = p_buffer->u32_num_instructions;
+		ASM_insert_instructions(p_buffer, u32_first, p_workers[i].buffer.p_instructions, p_workers[i].buffer.u32_num_instructions);
+
+		for (uint32_t j = u32_first; j < p_buffer->u32_num_instructions; j++)
+		{
+			p_instruction = &p_buffer->p_instructions[j];
+
+			if (p_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+			{
+				p_instruction->u32_src += code_gen_info.u32_num_vregs;
+			}
+			if (p_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+			{
+				p_instruction->u32_dst += code_gen_info.u32_num_vregs;
+			}
+		}
+
+		code_gen_info.u32_num_vregs += p_workers[i].u32_num_vregs;
+		code_gen_info.cover.u32_cost += p_workers[i].u32_cost;
+		ASM_deinit_buffer(&p_workers[i].buffer);
+	}
+}
+
+static uint32_t CODE_GEN_get_num_threads(void)
+{
+	long num_cores;
+
+	if (code_gen_info.u32_num_threads != 0)
+	{
+		return (code_gen_info.u32_num_threads < CODE_GEN_MAX_WORKERS) ? code_gen_info.u32_num_threads : CODE_GEN_MAX_WORKERS;
+	}
+
+	num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (num_cores < 1) ? 1 : ((num_cores < CODE_GEN_MAX_WORKERS) ? (uint32_t)num_cores : CODE_GEN_MAX_WORKERS);
+}
+
+static void CODE_GEN_select_instruction(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
+{
+	// Values folded into all their users are emitted as part of them
+	if (kp_instruction->u32_result != IR_VALUE_NONE && !TILE_is_needed(&code_gen_info.cover, kp_instruction->u32_result, TILE_NT_REG))
+	{
+		code_gen_info.pu32_vregs[kp_instruction->u32_result] = ASM_VREG_NONE;
 		return;
 	}
 
-	switch(p_node->type)
+	switch (kp_instruction->u8_opcode)
 	{
-		case PARSE_NODE_TYPE_ID:
+		case IR_OPCODE_CONST:
 		{
-			CODE_GEN_handle_EXPR_TYPE_ID(p_node);
+			CODE_GEN_handle_CONST(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_EXPR_TYPE_ADD:
+		case IR_OPCODE_LOAD:
 		{
-			CODE_GEN_handle_EXPR_TYPE_ADD(p_node);
+			CODE_GEN_handle_LOAD(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT:
+		case IR_OPCODE_STORE:
 		{
-			CODE_GEN_handle_EXPR_TYPE_SUBTRACT(p_node);
+			CODE_GEN_handle_STORE(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY:
+		case IR_OPCODE_ADD:
+		case IR_OPCODE_SUB:
+		case IR_OPCODE_MUL:
 		{
-			CODE_GEN_handle_EXPR_TYPE_MULTIPLY(p_node);
+			CODE_GEN_handle_ARITHMETIC(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE:
+		case IR_OPCODE_DIV:
 		{
-			CODE_GEN_handle_EXPR_TYPE_DIVIDE(p_node);
+			CODE_GEN_handle_DIV(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_EXPR_TYPE_ASSIGNMENT:
+		case IR_OPCODE_VLOAD:
+		case IR_OPCODE_VSPLAT:
+		case IR_OPCODE_VADD:
+		case IR_OPCODE_VSUB:
+		case IR_OPCODE_VSTORE:
 		{
-			CODE_GEN_handle_EXPR_TYPE_ASSIGNMENT(p_node);
+			CODE_GEN_handle_VECTOR(p_worker, kp_instruction);
 			break;
 		}
-		case PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT:
+		default:
 		{
-			CODE_GEN_handle_STATEMENT_TYPE_ASSIGNMENT(p_node);
+			ASSERT(0);
+		}
+	}
+}
+
+/*
+ *	A 64-bit move sign extends its immediate from 32 bits, so a larger literal is zero extended instead
+ */
+static void CODE_GEN_handle_CONST(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
+{
+	uint32_t u32_vreg = CODE_GEN_new_vreg(p_worker);
+	ASM_width_t width = CODE_GEN_get_width(kp_instruction);
+	ASM_opcode_t opcode = (width == ASM_WIDTH_64 && kp_instruction->u32_immediate > INT32_MAX) ? ASM_OPCODE_MOVZL : ASM_OPCODE_MOV;
+
+	ASM_emit(&p_worker->buffer, opcode, width,
+		ASM_OPERAND_IMMEDIATE, kp_instruction->u32_immediate,
+		CODE_GEN_VREG(u32_vreg));
+
+	code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
+}
+
+/*
+ *	Variables narrower than the statement are widened as they're loaded, by their own signedness
+ */
+static void CODE_GEN_handle_LOAD(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
+{
+	uint32_t u32_vreg = CODE_GEN_new_vreg(p_worker);
+	ASM_width_t width = CODE_GEN_get_width(kp_instruction);
+	ASM_opcode_t opcode;
+
+	switch (kp_instruction->u8_variable_type)
+	{
+		case BUILTINS_TYPE_U8:
+		{
+			// Writing the 32-bit register clears the rest
+			opcode = ASM_OPCODE_MOVZB;
+			width = ASM_WIDTH_32;
+			break;
+		}
+		case BUILTINS_TYPE_U16:
+		{
+			opcode = ASM_OPCODE_MOVZW;
+			width = ASM_WIDTH_32;
+			break;
+		}
+		case BUILTINS_TYPE_I8:
+		{
+			opcode = ASM_OPCODE_MOVSB;
+			break;
+		}
+		case BUILTINS_TYPE_I16:
+		{
+			opcode = ASM_OPCODE_MOVSW;
+			break;
+		}
+		case BUILTINS_TYPE_U32:
+		{
+			opcode = (width == ASM_WIDTH_64) ? ASM_OPCODE_MOVZL : ASM_OPCODE_MOV;
+			break;
+		}
+		case BUILTINS_TYPE_I32:
+		{
+			opcode = (width == ASM_WIDTH_64) ? ASM_OPCODE_MOVSL : ASM_OPCODE_MOV;
 			break;
 		}
 		default:
 		{
-			ASSERT(0);
+			opcode = ASM_OPCODE_MOV;
+			break;
+		}
+	}
+
+	ASM_emit(&p_worker->buffer, opcode, width,
+		ASM_OPERAND_VARIABLE, kp_instruction->u32_immediate,
+		CODE_GEN_VREG(u32_vreg));
+
+	code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
+}
+
+/*
+ *	Stores only as many low bytes as the variable holds. Statements are never narrower than their variable
+ */
+static void CODE_GEN_handle_STORE(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
+{
+	ASM_emit(&p_worker->buffer, ASM_OPCODE_MOV, ASM_get_width(BUILTINS_get_size(kp_instruction->u8_variable_type)),
+		CODE_GEN_VREG(code_gen_info.pu32_vregs[kp_instruction->pu32_operands[0]]),
+		ASM_OPERAND_VARIABLE, kp_instruction->u32_immediate);
+}
+
+/*
+ *	add, sub and mul in whichever form their tile takes: register, immediate or memory source,
+ *	a multiply by a constant strength reduced, or an add of a scaled index as a single lea
+ */
+static void CODE_GEN_handle_ARITHMETIC(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
+{
+	static const ASM_opcode_t pk_opcodes[IR_OPCODE_NUM_OPCODES] =
+	{
+		[IR_OPCODE_ADD]	= ASM_OPCODE_ADD,
+		[IR_OPCODE_SUB]	= ASM_OPCODE_SUB,
+		// The low bits of a product are the same signed or unsigned, and imul has a two-operand form
+		[IR_OPCODE_MUL]	= ASM_OPCODE_IMUL,
+	};
+	static const ASM_opcode_t pk_scaled_adds[] =
+	{
+		[2]	= ASM_OPCODE_ADD_SCALED2,
+		[4]	= ASM_OPCODE_ADD_SCALED4,
+		[8]	= ASM_OPCODE_ADD_SCALED8,
+	};
+	uint8_t u8_rule = TILE_get_rule(&code_gen_info.cover, kp_instruction->u32_result, TILE_NT_REG);
+	ASM_width_t width = CODE_GEN_get_width(kp_instruction);
+	uint32_t u32_left = kp_instruction->pu32_operands[(u8_rule & TILE_RULE_SWAPPED) ? 1 : 0];
+	uint32_t u32_right = kp_instruction->pu32_operands[(u8_rule & TILE_RULE_SWAPPED) ? 0 : 1];
+	const IR_instruction_t * kp_index;
+	STRENGTH_multiply_t plan;
+	uint8_t u8_index_rule;
+	uint8_t u8_src_kind;
+	uint32_t u32_src;
+	uint32_t u32_vreg;
+
+	switch (u8_rule & TILE_RULE_MASK)
+	{
+		case TILE_RULE_REG_IMM:
+		{
+			// Multiplying by a constant can usually be done with shifts and lea, and otherwise takes an immediate
+			if (kp_instruction->u8_opcode == IR_OPCODE_MUL)
+			{
+				u32_vreg = CODE_GEN_result_target(p_worker, u32_left);
+
+				STRENGTH_plan_multiply(CODE_GEN_get_def(u32_right)->u32_immediate, &plan);
+				STRENGTH_emit_multiply(&p_worker->buffer, &plan, width, code_gen_info.pu32_vregs[u32_left], u32_vreg);
+
+				code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
+				return;
+			}
+
+			CODE_GEN_get_source(u32_right, TILE_NT_IMM, &u8_src_kind, &u32_src);
+			break;
+		}
+		case TILE_RULE_REG_MEM:
+		{
+			CODE_GEN_get_source(u32_right, TILE_NT_MEM, &u8_src_kind, &u32_src);
+			break;
+		}
+		case TILE_RULE_LEA:
+		{
+			// left + x * scale: the multiply was never emitted, and x is the lea's index
+			kp_index = CODE_GEN_get_def(u32_right);
+			u8_index_rule = TILE_get_rule(&code_gen_info.cover, u32_right, TILE_NT_INDEX);
+			u32_src = kp_index->pu32_operands[(u8_index_rule & TILE_RULE_SWAPPED) ? 1 : 0];
+			u32_vreg = CODE_GEN_two_address_target(p_worker, width, u32_left);
+
+			ASM_emit(&p_worker->buffer,
+				pk_scaled_adds[TILE_get_scale(CODE_GEN_get_def(kp_index->pu32_operands[(u8_index_rule & TILE_RULE_SWAPPED) ? 0 : 1])->u32_immediate)],
+				width,
+				CODE_GEN_VREG(code_gen_info.pu32_vregs[u32_src]),
+				CODE_GEN_VREG(u32_vreg));
+
+			code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
+			return;
+		}
+		default:
+		{
+			ASSERT((u8_rule & TILE_RULE_MASK) == TILE_RULE_REG_REG);
+			CODE_GEN_get_source(u32_right, TILE_NT_REG, &u8_src_kind, &u32_src);
+			break;
 		}
 	}
+
+	u32_vreg = CODE_GEN_two_address_target(p_worker, width, u32_left);
+
+	ASM_emit(&p_worker->buffer, pk_opcodes[kp_instruction->u8_opcode], width,
+		u8_src_kind, u32_src,
+		CODE_GEN_VREG(u32_vreg));
+
+	code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_ID(PARSE_node_t * p_node)
+/*
+ *	Unsigned divides zero edx first, signed ones sign extend eax into it
+ */
+static void CODE_GEN_handle_DIV(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
 {
-	p_node->scratch_register = SCRATCH_REGISTER_alloc();
-	CODE_GEN_DBG(INSTRUCTION_FMT("mov") " %s, %s\n", p_node->p_token->pc_lexeme, 
-		SCRATCH_REGISTER_get_register_name(p_node->scratch_register));
+	uint8_t u8_rule = TILE_get_rule(&code_gen_info.cover, kp_instruction->u32_result, TILE_NT_REG);
+	ASM_width_t width = CODE_GEN_get_width(kp_instruction);
+	bool b_signed = BUILTINS_is_signed(kp_instruction->u8_type);
+	STRENGTH_divide_t plan;
+	uint8_t u8_src_kind;
+	uint32_t u32_src;
+	uint32_t u32_vreg;
+
+	// Dividing by a nonzero constant is a shift or a multiply by its reciprocal, both far cheaper than div
+	if ((u8_rule & TILE_RULE_MASK) == TILE_RULE_REG_IMM)
+	{
+		u32_vreg = CODE_GEN_result_target(p_worker, kp_instruction->pu32_operands[0]);
+
+		STRENGTH_plan_divide(CODE_GEN_get_def(kp_instruction->pu32_operands[1])->u32_immediate, &plan);
+		STRENGTH_emit_divide(&p_worker->buffer, &plan, code_gen_info.pu32_vregs[kp_instruction->pu32_operands[0]], u32_vreg);
+
+		code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
+		return;
+	}
+
+	CODE_GEN_get_source(kp_instruction->pu32_operands[1], ((u8_rule & TILE_RULE_MASK) == TILE_RULE_REG_MEM) ? TILE_NT_MEM : TILE_NT_REG,
+		&u8_src_kind, &u32_src);
+	u32_vreg = CODE_GEN_new_vreg(p_worker);
+
+	// div takes its dividend in edx:eax and leaves the quotient in eax. The allocator never hands out eax, nor edx across a div
+	ASM_emit(&p_worker->buffer, ASM_OPCODE_MOV, width,
+		CODE_GEN_VREG(code_gen_info.pu32_vregs[kp_instruction->pu32_operands[0]]),
+		CODE_GEN_HW_REG(ASM_REGISTER_RAX));
+
+	if (b_signed)
+	{
+		ASM_emit(&p_worker->buffer, ASM_OPCODE_CDQ, width, CODE_GEN_NONE, CODE_GEN_NONE);
+	}
+	else
+	{
+		// Zeroing edx zeroes rdx
+		ASM_emit(&p_worker->buffer, ASM_OPCODE_XOR, ASM_WIDTH_32,
+			CODE_GEN_HW_REG(ASM_REGISTER_RDX),
+			CODE_GEN_HW_REG(ASM_REGISTER_RDX));
+	}
+
+	ASM_emit(&p_worker->buffer, b_signed ? ASM_OPCODE_IDIV : ASM_OPCODE_DIV, width,
+		u8_src_kind, u32_src,
+		CODE_GEN_NONE);
+	ASM_emit(&p_worker->buffer, ASM_OPCODE_MOV, width,
+		CODE_GEN_HW_REG(ASM_REGISTER_RAX),
+		CODE_GEN_VREG(u32_vreg));
+
+	code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_vreg;
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_ADD(PARSE_node_t * p_node)
+/*
+ *	Vector values go straight into xmm registers, which allocation leaves alone. Each is used once,
+ *	by the next vector instruction up its tree, so the result takes over the left operand's register
+ *	and the right one's is free again
+ */
+static void CODE_GEN_handle_VECTOR(CODE_GEN_worker_t * p_worker, const IR_instruction_t * kp_instruction)
 {
-	CODE_GEN_DBG(INSTRUCTION_FMT("add") " %s, %s\n", 
-		SCRATCH_REGISTER_get_register_name(p_node->p_left->scratch_register), 
-		SCRATCH_REGISTER_get_register_name(p_node->p_right->scratch_register));
+	uint32_t u32_left;
+	uint32_t u32_right;
+	uint32_t u32_vreg;
 
-	p_node->scratch_register = p_node->p_right->scratch_register;
-	SCRATCH_REGISTER_free(p_node->p_left->scratch_register);
+	switch (kp_instruction->u8_opcode)
+	{
+		case IR_OPCODE_VLOAD:
+		{
+			code_gen_info.pu32_vregs[kp_instruction->u32_result] = CODE_GEN_new_xmm(p_worker);
+			ASM_emit(&p_worker->buffer, ASM_OPCODE_MOVDQU, ASM_WIDTH_128,
+				ASM_OPERAND_VARIABLE, kp_instruction->u32_immediate,
+				ASM_OPERAND_XMM, code_gen_info.pu32_vregs[kp_instruction->u32_result]);
+			break;
+		}
+		case IR_OPCODE_VSPLAT:
+		{
+			// SSE2 can't take an immediate, so the constant goes through a general register first
+			u32_vreg = CODE_GEN_new_vreg(p_worker);
+			code_gen_info.pu32_vregs[kp_instruction->u32_result] = CODE_GEN_new_xmm(p_worker);
+
+			ASM_emit(&p_worker->buffer, ASM_OPCODE_MOV, ASM_WIDTH_32,
+				ASM_OPERAND_IMMEDIATE, kp_instruction->u32_immediate,
+				CODE_GEN_VREG(u32_vreg));
+			ASM_emit(&p_worker->buffer, ASM_OPCODE_MOVD, ASM_WIDTH_32,
+				CODE_GEN_VREG(u32_vreg),
+				ASM_OPERAND_XMM, code_gen_info.pu32_vregs[kp_instruction->u32_result]);
+			ASM_emit(&p_worker->buffer, ASM_OPCODE_PSHUFD0, ASM_WIDTH_128,
+				ASM_OPERAND_XMM, code_gen_info.pu32_vregs[kp_instruction->u32_result],
+				ASM_OPERAND_XMM, code_gen_info.pu32_vregs[kp_instruction->u32_result]);
+			break;
+		}
+		case IR_OPCODE_VSTORE:
+		{
+			u32_left = code_gen_info.pu32_vregs[kp_instruction->pu32_operands[0]];
+			ASM_emit(&p_worker->buffer, ASM_OPCODE_MOVDQU, ASM_WIDTH_128,
+				ASM_OPERAND_XMM, u32_left,
+				ASM_OPERAND_VARIABLE, kp_instruction->u32_immediate);
+			p_worker->u32_free_xmm |= 1u << u32_left;
+			break;
+		}
+		default:
+		{
+			u32_left = code_gen_info.pu32_vregs[kp_instruction->pu32_operands[0]];
+			u32_right = code_gen_info.pu32_vregs[kp_instruction->pu32_operands[1]];
+			ASM_emit(&p_worker->buffer, (kp_instruction->u8_opcode == IR_OPCODE_VADD) ? ASM_OPCODE_PADDD : ASM_OPCODE_PSUBD, ASM_WIDTH_128,
+				ASM_OPERAND_XMM, u32_right,
+				ASM_OPERAND_XMM, u32_left);
+			p_worker->u32_free_xmm |= 1u << u32_right;
+			code_gen_info.pu32_vregs[kp_instruction->u32_result] = u32_left;
+			break;
+		}
+	}
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_SUBTRACT(PARSE_node_t * p_node)
+/*
+ *	x86 arithmetic overwrites its left operand. That's free when this is the operand's only use;
+ *	otherwise the operand is copied first
+ */
+static uint32_t CODE_GEN_two_address_target(CODE_GEN_worker_t * p_worker, ASM_width_t width, uint32_t u32_left)
 {
-    CODE_GEN_DBG(INSTRUCTION_FMT("sub") " %s, %s\n", 
-        SCRATCH_REGISTER_get_register_name(p_node->p_left->scratch_register), 
-        SCRATCH_REGISTER_get_register_name(p_node->p_right->scratch_register));
-    
-    p_node->scratch_register = p_node->p_right->scratch_register;  
-    SCRATCH_REGISTER_free(p_node->p_left->scratch_register);
+	uint32_t u32_vreg;
+
+	if (IR_get_num_uses(&code_gen_info.def_use, u32_left) == 1)
+	{
+		return code_gen_info.pu32_vregs[u32_left];
+	}
+
+	u32_vreg = CODE_GEN_new_vreg(p_worker);
+	ASM_emit(&p_worker->buffer, ASM_OPCODE_MOV, width,
+		CODE_GEN_VREG(code_gen_info.pu32_vregs[u32_left]),
+		CODE_GEN_VREG(u32_vreg));
+
+	return u32_vreg;
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_MULTIPLY(PARSE_node_t * p_node)
+/*
+ *	Where to put a result computed from `u32_operand`: over the operand itself when nothing else
+ *	reads it, otherwise somewhere new
+ */
+static uint32_t CODE_GEN_result_target(CODE_GEN_worker_t * p_worker, uint32_t u32_operand)
 {
-    CODE_GEN_DBG(INSTRUCTION_FMT("mul") " %s, %s\n", 
-        SCRATCH_REGISTER_get_register_name(p_node->p_left->scratch_register), 
-        SCRATCH_REGISTER_get_register_name(p_node->p_right->scratch_register));
-    
-    p_node->scratch_register = p_node->p_right->scratch_register;  
-    SCRATCH_REGISTER_free(p_node->p_left->scratch_register);
+	if (IR_get_num_uses(&code_gen_info.def_use, u32_operand) == 1)
+	{
+		return code_gen_info.pu32_vregs[u32_operand];
+	}
+
+	return CODE_GEN_new_vreg(p_worker);
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_DIVIDE(PARSE_node_t * p_node)
+/*
+ *	A source operand as its user's tile takes it: the register holding it, the constant itself, or
+ *	the variable it was loaded from
+ */
+static void CODE_GEN_get_source(uint32_t u32_value, TILE_nonterminal_t nonterminal, uint8_t * pu8_kind, uint32_t * pu32_src)
+{
+	switch (nonterminal)
+	{
+		case TILE_NT_IMM:
+		{
+			*pu8_kind = ASM_OPERAND_IMMEDIATE;
+			*pu32_src = CODE_GEN_get_def(u32_value)->u32_immediate;
+			break;
+		}
+		case TILE_NT_MEM:
+		{
+			*pu8_kind = ASM_OPERAND_VARIABLE;
+			*pu32_src = CODE_GEN_get_def(u32_value)->u32_immediate;
+			break;
+		}
+		default:
+		{
+			ASSERT(nonterminal == TILE_NT_REG);
+			*pu8_kind = ASM_OPERAND_VIRTUAL;
+			*pu32_src = code_gen_info.pu32_vregs[u32_value];
+			break;
+		}
+	}
+}
+
+/*
+ *	Saves whichever callee-saved registers the body touched, reserves the spill slots, and returns
+ */
+static void CODE_GEN_wrap_function(void)
+{
+	ASM_buffer_t * p_buffer = &code_gen_info.buffer;
+	ASM_instruction_t p_pushes[(sizeof(pk_callee_saved_registers) / sizeof(pk_callee_saved_registers[0])) + 1];
+	uint32_t u32_frame_size = code_gen_info.regalloc_result.u32_frame_size;
+	bool pb_used[ASM_REGISTER_NUM_REGISTERS] = { false };
+	const ASM_instruction_t * kp_instruction;
+	uint32_t u32_num_pushes = 0;
+
+	for (uint32_t i = 0; i < p_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &p_buffer->p_instructions[i];
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_REGISTER)
+		{
+			pb_used[kp_instruction->u32_src] = true;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER)
+		{
+			pb_used[kp_instruction->u32_dst] = true;
+		}
+	}
+
+	for (uint32_t i = 0; i < sizeof(pk_callee_saved_registers) / sizeof(pk_callee_saved_registers[0]); i++)
+	{
+		if (pb_used[pk_callee_saved_registers[i]])
+		{
+			p_pushes[u32_num_pushes++] = (ASM_instruction_t)
+			{
+				.u8_opcode		= ASM_OPCODE_PUSH,
+				.u8_width		= ASM_WIDTH_64,
+				.u8_src_kind	= ASM_OPERAND_REGISTER,
+				.u32_src		= pk_callee_saved_registers[i],
+			};
+		}
+	}
+
+	// Spill slots sit below the saved registers
+	if (u32_frame_size > 0)
+	{
+		p_pushes[u32_num_pushes] = (ASM_instruction_t)
+		{
+			.u8_opcode		= ASM_OPCODE_SUB,
+			.u8_width		= ASM_WIDTH_64,
+			.u8_src_kind	= ASM_OPERAND_IMMEDIATE,
+			.u32_src		= u32_frame_size,
+			.u8_dst_kind	= ASM_OPERAND_REGISTER,
+			.u32_dst		= ASM_REGISTER_RSP,
+		};
+	}
+
+	ASM_insert_instructions(p_buffer, 0, p_pushes, u32_num_pushes + ((u32_frame_size > 0) ? 1 : 0));
+
+	if (u32_frame_size > 0)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_ADD, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, u32_frame_size, CODE_GEN_HW_REG(ASM_REGISTER_RSP));
+	}
+
+	for (uint32_t i = u32_num_pushes; i > 0; i--)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_POP, ASM_WIDTH_64, CODE_GEN_NONE, CODE_GEN_HW_REG(p_pushes[i - 1].u32_src));
+	}
+
+	ASM_emit(p_buffer, ASM_OPCODE_RET, ASM_WIDTH_64, CODE_GEN_NONE, CODE_GEN_NONE);
+}
+
+/*
+ *	Virtual registers are never reused; the allocator decides what shares a hardware register.
+ *	Each worker numbers its own from 0, and they're rebased when the workers' code is joined
+ */
+static inline uint32_t CODE_GEN_new_vreg(CODE_GEN_worker_t * p_worker)
 {
-    CODE_GEN_DBG(INSTRUCTION_FMT("div") " %s, %s\n", 
-        SCRATCH_REGISTER_get_register_name(p_node->p_left->scratch_register), 
-        SCRATCH_REGISTER_get_register_name(p_node->p_right->scratch_register));
-    
-    p_node->scratch_register = p_node->p_right->scratch_register;  
-    SCRATCH_REGISTER_free(p_node->p_left->scratch_register);
+	return p_worker->u32_num_vregs++;
 }
 
-static void CODE_GEN_handle_EXPR_TYPE_ASSIGNMENT(PARSE_node_t * p_node)
+/*
+ *	The lowest free xmm register. Vector trees are small enough that one is always free
+ */
+static inline uint32_t CODE_GEN_new_xmm(CODE_GEN_worker_t * p_worker)
 {
+	uint32_t u32_xmm;
+
+	ASSERT(p_worker->u32_free_xmm != 0);
+	u32_xmm = (uint32_t)__builtin_ctz(p_worker->u32_free_xmm);
+	p_worker->u32_free_xmm &= ~(1u << u32_xmm);
 
+	return u32_xmm;
 }
 
-static void CODE_GEN_handle_STATEMENT_TYPE_ASSIGNMENT(PARSE_node_t * p_node)
+static inline const IR_instruction_t * CODE_GEN_get_def(uint32_t u32_value)
+{
+	return &code_gen_info.ir.p_instructions[code_gen_info.def_use.pu32_def[u32_value]];
+}
+
+/*
+ *	Arithmetic runs at 64 bits for 64-bit statements and at 32 for everything narrower
+ */
+static inline ASM_width_t CODE_GEN_get_width(const IR_instruction_t * kp_instruction)
 {
-	p_node->scratch_register = SCRATCH_REGISTER_alloc();
-    CODE_GEN_DBG(INSTRUCTION_FMT("mov") " %s, %s\n", 
-        SCRATCH_REGISTER_get_register_name(p_node->p_right->scratch_register), 
-        SCRATCH_REGISTER_get_register_name(p_node->p_left->scratch_register));
-    
-    SCRATCH_REGISTER_free(p_node->p_right->scratch_register);
+	return (BUILTINS_get_size(kp_instruction->u8_type) == sizeof(uint64_t)) ? ASM_WIDTH_64 : ASM_WIDTH_32;
 }
@@ -3,7 +3,39 @@
 
 #include "common.h"
 #include "parse.h"
+#include "asm.h"
+#include "peephole.h"
+#include "schedule.h"
+#include "ir.h"
+#include "fold.h"
+#include "gvn.h"
+#include "dce.h"
+#include "reassoc.h"
+#include "slp.h"
+#include "layout.h"
+#include "promote.h"
+#include "pass.h"
 
-void CODE_GEN_traverse_tree	(PARSE_node_t * p_root);
+void 					CODE_GEN_init				(void);
+void 					CODE_GEN_deinit				(void);
+void 					CODE_GEN_set_num_threads	(uint32_t u32_num_threads);
+void 					CODE_GEN_set_gvn_budget		(uint32_t u32_budget);
+void 					CODE_GEN_set_opt_level		(PASS_level_t level);
+bool 					CODE_GEN_set_pass_enabled	(const char * kpc_name, bool b_enabled);
+void 					CODE_GEN_run				(const PARSE_tree_list_t * kp_tree_list);
+const ASM_buffer_t * 	CODE_GEN_get_buffer			(void);
+const IR_program_t * 	CODE_GEN_get_ir				(void);
+const FOLD_report_t * 	CODE_GEN_get_fold_report	(void);
+const GVN_report_t * 	CODE_GEN_get_gvn_report		(void);
+const DCE_report_t * 	CODE_GEN_get_dce_report		(void);
+const REASSOC_report_t * CODE_GEN_get_reassoc_report	(void);
+const SLP_report_t * 	CODE_GEN_get_slp_report		(void);
+const LAYOUT_report_t * CODE_GEN_get_layout_report	(void);
+const PROMOTE_result_t * CODE_GEN_get_promote_result	(void);
+const PASS_manager_t * 	CODE_GEN_get_passes			(void);
+const PEEPHOLE_result_t * CODE_GEN_get_peephole_result	(void);
+const SCHEDULE_result_t * CODE_GEN_get_schedule_result	(void);
+STATUS_t 				CODE_GEN_write_assembly		(const char * kpc_fname);
+STATUS_t 				CODE_GEN_write_object		(const char * kpc_fname);
 
-#endif
\ No newline at end of file
+#endif
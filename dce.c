@@ -0,0 +1,156 @@
+#include "dce.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_DCE
+#define DCE_DBG(fmt, ...)				printf(BOLD("DCE:\t")fmt, ##__VA_ARGS__)
+#define DCE_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("DCE:\t"))fmt, ##__VA_ARGS__)
+#define DCE_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("DCE:\t"))fmt, ##__VA_ARGS__)
+#define DCE_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("DCE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define DCE_DBG(fmt, ...)
+#define DCE_GREEN(fmt, ...)
+#define DCE_WARN(fmt, ...)
+#define DCE_ERR(fmt, ...)
+#endif
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static bool 		DCE_may_trap					(const IR_program_t * kp_program, const uint32_t * kpu32_def, const IR_instruction_t * kp_instruction);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Backwards liveness over the whole program, which is one straight line of every statement in
+ *	order. Every variable is live at the end, since the caller reads them all back. A store kills its
+ *	variable and is dead if nothing loads the variable before the next store to it; any other
+ *	instruction is dead if nothing uses its value, unless it can trap: a division goes on faulting
+ *	as it would have, whatever the optimization level. Dead instructions are removed in place
+ */
+void DCE_run(IR_program_t * p_program, uint32_t u32_num_variables, DCE_report_t * p_report)
+{
+	bool * pb_variable_live = malloc(sizeof(bool) * (u32_num_variables + 1));
+	bool * pb_value_used = calloc(p_program->u32_num_values + 1, sizeof(bool));
+	bool * pb_keep = malloc(sizeof(bool) * (p_program->u32_num_instructions + 1));
+	uint32_t * pu32_def = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	const IR_instruction_t * kp_instruction;
+	uint32_t u32_num_kept = 0;
+
+	ASSERT(pb_variable_live && pb_value_used && pb_keep && pu32_def);
+
+	for (uint32_t i = 0; i < p_program->u32_num_instructions; i++)
+	{
+		if (p_program->p_instructions[i].u32_result != IR_VALUE_NONE)
+		{
+			pu32_def[p_program->p_instructions[i].u32_result] = i;
+		}
+	}
+
+	p_report->u32_num_dead_stores = 0;
+	p_report->u32_num_dead_instructions = 0;
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		pb_variable_live[i] = true;
+	}
+
+	for (uint32_t i = p_program->u32_num_instructions; i > 0; i--)
+	{
+		kp_instruction = &p_program->p_instructions[i - 1];
+
+		switch (kp_instruction->u8_opcode)
+		{
+			case IR_OPCODE_STORE:
+			{
+				pb_keep[i - 1] = pb_variable_live[kp_instruction->u32_immediate];
+				pb_variable_live[kp_instruction->u32_immediate] = false;
+
+				if (!pb_keep[i - 1])
+				{
+					DCE_DBG("Dead store to %s\n", SYMBOL_TABLE_get_symbol_table()[kp_instruction->u32_immediate].p_token->pc_lexeme);
+					p_report->u32_num_dead_stores++;
+				}
+				break;
+			}
+			case IR_OPCODE_LOAD:
+			{
+				pb_keep[i - 1] = pb_value_used[kp_instruction->u32_result];
+				pb_variable_live[kp_instruction->u32_immediate] |= pb_keep[i - 1];
+				break;
+			}
+			default:
+			{
+				pb_keep[i - 1] = pb_value_used[kp_instruction->u32_result] || DCE_may_trap(p_program, pu32_def, kp_instruction);
+				break;
+			}
+		}
+
+		if (!pb_keep[i - 1])
+		{
+			continue;
+		}
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (kp_instruction->pu32_operands[j] != IR_VALUE_NONE)
+			{
+				pb_value_used[kp_instruction->pu32_operands[j]] = true;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < p_program->u32_num_instructions; i++)
+	{
+		if (pb_keep[i])
+		{
+			p_program->p_instructions[u32_num_kept++] = p_program->p_instructions[i];
+		}
+	}
+
+	p_report->u32_num_dead_instructions = p_program->u32_num_instructions - u32_num_kept - p_report->u32_num_dead_stores;
+	p_report->u32_num_live_instructions = u32_num_kept;
+	p_program->u32_num_instructions = u32_num_kept;
+
+	DCE_DBG("Removed %u dead stores and %u unused instructions, %u left\n",
+		p_report->u32_num_dead_stores, p_report->u32_num_dead_instructions, u32_num_kept);
+
+	free(pb_variable_live);
+	free(pb_value_used);
+	free(pb_keep);
+	free(pu32_def);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	A division can fault unless its divisor is a constant that's neither 0 nor, when signed, -1.
+ *	Constants are zero-extended in a 64-bit statement, so only a 32-bit one can read as -1
+ */
+static bool DCE_may_trap(const IR_program_t * kp_program, const uint32_t * kpu32_def, const IR_instruction_t * kp_instruction)
+{
+	const IR_instruction_t * kp_divisor;
+
+	if (kp_instruction->u8_opcode != IR_OPCODE_DIV)
+	{
+		return false;
+	}
+
+	kp_divisor = &kp_program->p_instructions[kpu32_def[kp_instruction->pu32_operands[1]]];
+
+	if (kp_divisor->u8_opcode != IR_OPCODE_CONST || kp_divisor->u32_immediate == 0)
+	{
+		return true;
+	}
+
+	return BUILTINS_is_signed(kp_instruction->u8_type) && BUILTINS_get_size(kp_instruction->u8_type) != sizeof(uint64_t) &&
+		kp_divisor->u32_immediate == UINT32_MAX;
+}
@@ -0,0 +1,24 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _DCE_report
+{
+	uint32_t	u32_num_dead_stores;			// Stores overwritten before anything read them
+	uint32_t	u32_num_dead_instructions;		// Everything else removed: values nothing used
+	uint32_t	u32_num_live_instructions;		// What's left
+} DCE_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			DCE_run							(IR_program_t * p_program, uint32_t u32_num_variables, DCE_report_t * p_report);
+
+#endif
@@ -0,0 +1,346 @@
+#include <elf.h>
+#include "elf_writer.h"
+#include "io_handler.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_ELF_WRITER
+#define ELF_WRITER_DBG(fmt, ...)		printf(BOLD("ELF_WRITER:\t")fmt, ##__VA_ARGS__)
+#define ELF_WRITER_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("ELF_WRITER:\t"))fmt, ##__VA_ARGS__)
+#define ELF_WRITER_WARN(fmt, ...)		printf(BOLD(BRIGHT_YELLOW("ELF_WRITER:\t"))fmt, ##__VA_ARGS__)
+#define ELF_WRITER_ERR(fmt, ...)		printf(BOLD(BRIGHT_RED("ELF_WRITER:\t"))fmt, ##__VA_ARGS__)
+#else
+#define ELF_WRITER_DBG(fmt, ...)
+#define ELF_WRITER_GREEN(fmt, ...)
+#define ELF_WRITER_WARN(fmt, ...)
+#define ELF_WRITER_ERR(fmt, ...)
+#endif
+
+#define ELF_WRITER_ALIGN(value, alignment)	(((value) + ((alignment) - 1)) & ~((size_t)(alignment) - 1))
+
+#define ELF_WRITER_TEXT_ALIGNMENT		(16)
+#define ELF_WRITER_RODATA_ALIGNMENT		(4)
+#define ELF_WRITER_TABLE_ALIGNMENT		(8)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Section header indices, in file order
+ */
+typedef enum
+{
+	ELF_WRITER_SECTION_NULL = 0,
+	ELF_WRITER_SECTION_TEXT,
+	ELF_WRITER_SECTION_RODATA,
+	ELF_WRITER_SECTION_SYMTAB,
+	ELF_WRITER_SECTION_STRTAB,
+	ELF_WRITER_SECTION_SHSTRTAB,
+	ELF_WRITER_SECTION_NOTE_GNU_STACK,	// Empty, only there to mark the stack non-executable
+	//////////////////////////////
+	ELF_WRITER_SECTION_NUM_SECTIONS
+} ELF_WRITER_section_t;
+
+/*
+ *	Symbol table indices. Locals have to come first, and there's only the null one
+ */
+typedef enum
+{
+	ELF_WRITER_SYMBOL_NULL = 0,
+	ELF_WRITER_SYMBOL_ENTRY,
+	ELF_WRITER_SYMBOL_NUM_VARIABLES,
+	ELF_WRITER_SYMBOL_VARIABLE_OFFSETS,
+	ELF_WRITER_SYMBOL_VARIABLE_NAMES,
+	ELF_WRITER_SYMBOL_VARIABLE_TYPES,
+	//////////////////////////////
+	ELF_WRITER_SYMBOL_NUM_SYMBOLS
+} ELF_WRITER_symbol_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const char * const pk_section_names[ELF_WRITER_SECTION_NUM_SECTIONS] =
+{
+	[ELF_WRITER_SECTION_NULL]				= "",
+	[ELF_WRITER_SECTION_TEXT]				= ".text",
+	[ELF_WRITER_SECTION_RODATA]				= ".rodata",
+	[ELF_WRITER_SECTION_SYMTAB]				= ".symtab",
+	[ELF_WRITER_SECTION_STRTAB]				= ".strtab",
+	[ELF_WRITER_SECTION_SHSTRTAB]			= ".shstrtab",
+	[ELF_WRITER_SECTION_NOTE_GNU_STACK]		= ".note.GNU-stack",
+};
+
+static const char * const pk_symbol_names[ELF_WRITER_SYMBOL_NUM_SYMBOLS] =
+{
+	[ELF_WRITER_SYMBOL_NULL]				= "",
+	[ELF_WRITER_SYMBOL_ENTRY]				= ASM_ENTRY_SYMBOL,
+	[ELF_WRITER_SYMBOL_NUM_VARIABLES]		= ASM_NUM_VARIABLES_SYMBOL,
+	[ELF_WRITER_SYMBOL_VARIABLE_OFFSETS]	= ASM_VARIABLE_OFFSETS_SYMBOL,
+	[ELF_WRITER_SYMBOL_VARIABLE_NAMES]		= ASM_VARIABLE_NAMES_SYMBOL,
+	[ELF_WRITER_SYMBOL_VARIABLE_TYPES]		= ASM_VARIABLE_TYPES_SYMBOL,
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static size_t 		ELF_WRITER_get_string_table_size	(const char * const * kpkc_strings, uint32_t u32_num_strings);
+static void 		ELF_WRITER_fill_string_table		(char * pc_table, const char * const * kpkc_strings, uint32_t u32_num_strings, uint32_t * pu32_offsets);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Lays out a relocatable ELF64 object holding rep_main and the variable tables, exactly as
+ *	the assembly backend would after going through `as`. The caller frees the result
+ */
+char * ELF_WRITER_format_object(const ENCODER_code_t * kp_code, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint32_t u32_num_symbols = SYMBOL_TABLE_get_num_symbols();
+	uint32_t pu32_section_name_offsets[ELF_WRITER_SECTION_NUM_SECTIONS];
+	uint32_t pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_NUM_SYMBOLS];
+	size_t names_size = 0;
+	size_t offsets_size = sizeof(uint32_t) * u32_num_symbols;
+	size_t text_offset, rodata_offset, rodata_size, symtab_offset, symtab_size;
+	size_t strtab_offset, strtab_size, shstrtab_offset, shstrtab_size, section_headers_offset, total_size;
+	Elf64_Ehdr * p_header;
+	Elf64_Shdr * p_sections;
+	Elf64_Sym * p_elf_symbols;
+	uint32_t u32_num_variables = u32_num_symbols;
+	uint8_t * pu8_object;
+	uint8_t * pu8_rodata;
+	uint32_t u32_offset;
+	char * pc_names;
+	size_t length;
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		names_size += strlen(kp_symbols[i].p_token->pc_lexeme) + 1;
+	}
+
+	// Layout: header, .text, .rodata, .symtab, .strtab, .shstrtab, section headers
+	text_offset = ELF_WRITER_ALIGN(sizeof(Elf64_Ehdr), ELF_WRITER_TEXT_ALIGNMENT);
+	rodata_offset = ELF_WRITER_ALIGN(text_offset + kp_code->u32_size, ELF_WRITER_RODATA_ALIGNMENT);
+	rodata_size = sizeof(uint32_t) + offsets_size + names_size + u32_num_symbols;
+	symtab_offset = ELF_WRITER_ALIGN(rodata_offset + rodata_size, ELF_WRITER_TABLE_ALIGNMENT);
+	symtab_size = sizeof(Elf64_Sym) * ELF_WRITER_SYMBOL_NUM_SYMBOLS;
+	strtab_offset = symtab_offset + symtab_size;
+	strtab_size = ELF_WRITER_get_string_table_size(pk_symbol_names, ELF_WRITER_SYMBOL_NUM_SYMBOLS);
+	shstrtab_offset = strtab_offset + strtab_size;
+	shstrtab_size = ELF_WRITER_get_string_table_size(pk_section_names, ELF_WRITER_SECTION_NUM_SECTIONS);
+	section_headers_offset = ELF_WRITER_ALIGN(shstrtab_offset + shstrtab_size, ELF_WRITER_TABLE_ALIGNMENT);
+	total_size = section_headers_offset + (sizeof(Elf64_Shdr) * ELF_WRITER_SECTION_NUM_SECTIONS);
+
+	// Zeroed, so padding and the null entries need no further work
+	pu8_object = calloc(1, total_size);
+	ASSERT(pu8_object);
+
+	p_header = (Elf64_Ehdr *)pu8_object;
+	p_sections = (Elf64_Shdr *)(pu8_object + section_headers_offset);
+	p_elf_symbols = (Elf64_Sym *)(pu8_object + symtab_offset);
+
+	memcpy(p_header->e_ident, ELFMAG, SELFMAG);
+	p_header->e_ident[EI_CLASS] = ELFCLASS64;
+	p_header->e_ident[EI_DATA] = ELFDATA2LSB;
+	p_header->e_ident[EI_VERSION] = EV_CURRENT;
+	p_header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	p_header->e_type = ET_REL;
+	p_header->e_machine = EM_X86_64;
+	p_header->e_version = EV_CURRENT;
+	p_header->e_shoff = section_headers_offset;
+	p_header->e_ehsize = sizeof(Elf64_Ehdr);
+	p_header->e_shentsize = sizeof(Elf64_Shdr);
+	p_header->e_shnum = ELF_WRITER_SECTION_NUM_SECTIONS;
+	p_header->e_shstrndx = ELF_WRITER_SECTION_SHSTRTAB;
+
+	// Section contents
+	memcpy(pu8_object + text_offset, kp_code->pu8_bytes, kp_code->u32_size);
+	pu8_rodata = pu8_object + rodata_offset;
+	memcpy(pu8_rodata, &u32_num_variables, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		u32_offset = ASM_get_variable_offset(i);
+		memcpy(pu8_rodata + sizeof(uint32_t) + (sizeof(uint32_t) * i), &u32_offset, sizeof(uint32_t));
+	}
+
+	pc_names = (char *)(pu8_rodata + sizeof(uint32_t) + offsets_size);
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		length = strlen(kp_symbols[i].p_token->pc_lexeme) + 1;
+		memcpy(pc_names, kp_symbols[i].p_token->pc_lexeme, length);
+		pc_names += length;
+	}
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		pu8_rodata[sizeof(uint32_t) + offsets_size + names_size + i] = ASM_VARIABLE_TYPE_BYTE(kp_symbols[i].builtin_type);
+	}
+
+	ELF_WRITER_fill_string_table((char *)(pu8_object + strtab_offset), pk_symbol_names, ELF_WRITER_SYMBOL_NUM_SYMBOLS, pu32_symbol_name_offsets);
+	ELF_WRITER_fill_string_table((char *)(pu8_object + shstrtab_offset), pk_section_names, ELF_WRITER_SECTION_NUM_SECTIONS, pu32_section_name_offsets);
+
+	// Symbols
+	p_elf_symbols[ELF_WRITER_SYMBOL_ENTRY] = (Elf64_Sym)
+	{
+		.st_name	= pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_ENTRY],
+		.st_info	= ELF64_ST_INFO(STB_GLOBAL, STT_FUNC),
+		.st_shndx	= ELF_WRITER_SECTION_TEXT,
+		.st_value	= 0,
+		.st_size	= kp_code->u32_size,
+	};
+	p_elf_symbols[ELF_WRITER_SYMBOL_NUM_VARIABLES] = (Elf64_Sym)
+	{
+		.st_name	= pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_NUM_VARIABLES],
+		.st_info	= ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT),
+		.st_shndx	= ELF_WRITER_SECTION_RODATA,
+		.st_value	= 0,
+		.st_size	= sizeof(uint32_t),
+	};
+	p_elf_symbols[ELF_WRITER_SYMBOL_VARIABLE_OFFSETS] = (Elf64_Sym)
+	{
+		.st_name	= pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_VARIABLE_OFFSETS],
+		.st_info	= ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT),
+		.st_shndx	= ELF_WRITER_SECTION_RODATA,
+		.st_value	= sizeof(uint32_t),
+		.st_size	= offsets_size,
+	};
+	p_elf_symbols[ELF_WRITER_SYMBOL_VARIABLE_NAMES] = (Elf64_Sym)
+	{
+		.st_name	= pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_VARIABLE_NAMES],
+		.st_info	= ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT),
+		.st_shndx	= ELF_WRITER_SECTION_RODATA,
+		.st_value	= sizeof(uint32_t) + offsets_size,
+		.st_size	= names_size,
+	};
+	p_elf_symbols[ELF_WRITER_SYMBOL_VARIABLE_TYPES] = (Elf64_Sym)
+	{
+		.st_name	= pu32_symbol_name_offsets[ELF_WRITER_SYMBOL_VARIABLE_TYPES],
+		.st_info	= ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT),
+		.st_shndx	= ELF_WRITER_SECTION_RODATA,
+		.st_value	= sizeof(uint32_t) + offsets_size + names_size,
+		.st_size	= u32_num_symbols,
+	};
+
+	// Section headers
+	p_sections[ELF_WRITER_SECTION_TEXT] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_PROGBITS,
+		.sh_flags		= SHF_ALLOC | SHF_EXECINSTR,
+		.sh_offset		= text_offset,
+		.sh_size		= kp_code->u32_size,
+		.sh_addralign	= ELF_WRITER_TEXT_ALIGNMENT,
+	};
+	p_sections[ELF_WRITER_SECTION_RODATA] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_PROGBITS,
+		.sh_flags		= SHF_ALLOC,
+		.sh_offset		= rodata_offset,
+		.sh_size		= rodata_size,
+		.sh_addralign	= ELF_WRITER_RODATA_ALIGNMENT,
+	};
+	p_sections[ELF_WRITER_SECTION_SYMTAB] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_SYMTAB,
+		.sh_offset		= symtab_offset,
+		.sh_size		= symtab_size,
+		.sh_link		= ELF_WRITER_SECTION_STRTAB,
+		.sh_info		= ELF_WRITER_SYMBOL_ENTRY,			// One past the last local
+		.sh_addralign	= ELF_WRITER_TABLE_ALIGNMENT,
+		.sh_entsize		= sizeof(Elf64_Sym),
+	};
+	p_sections[ELF_WRITER_SECTION_STRTAB] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_STRTAB,
+		.sh_offset		= strtab_offset,
+		.sh_size		= strtab_size,
+		.sh_addralign	= 1,
+	};
+	p_sections[ELF_WRITER_SECTION_SHSTRTAB] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_STRTAB,
+		.sh_offset		= shstrtab_offset,
+		.sh_size		= shstrtab_size,
+		.sh_addralign	= 1,
+	};
+	p_sections[ELF_WRITER_SECTION_NOTE_GNU_STACK] = (Elf64_Shdr)
+	{
+		.sh_type		= SHT_PROGBITS,
+		.sh_offset		= section_headers_offset,
+		.sh_addralign	= 1,
+	};
+
+	for (uint32_t i = 0; i < ELF_WRITER_SECTION_NUM_SECTIONS; i++)
+	{
+		p_sections[i].sh_name = pu32_section_name_offsets[i];
+	}
+
+	*p_size = total_size;
+
+	return (char *)pu8_object;
+}
+
+/*
+ *	Formats the object and writes it out in one go
+ */
+STATUS_t ELF_WRITER_write_object(const ENCODER_code_t * kp_code, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_object;
+
+	if (kp_code == NULL || kpc_fname == NULL)
+	{
+		ELF_WRITER_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	pc_object = ELF_WRITER_format_object(kp_code, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_object, size);
+	free(pc_object);
+
+	ELF_WRITER_DBG("Wrote %zu byte object (%u bytes of code)\n", size, kp_code->u32_size);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static size_t ELF_WRITER_get_string_table_size(const char * const * kpkc_strings, uint32_t u32_num_strings)
+{
+	size_t size = 0;
+
+	for (uint32_t i = 0; i < u32_num_strings; i++)
+	{
+		size += strlen(kpkc_strings[i]) + 1;
+	}
+
+	return size;
+}
+
+/*
+ *	Packs NUL-terminated strings back to back, recording where each one starts
+ */
+static void ELF_WRITER_fill_string_table(char * pc_table, const char * const * kpkc_strings, uint32_t u32_num_strings, uint32_t * pu32_offsets)
+{
+	uint32_t u32_offset = 0;
+	size_t length;
+
+	for (uint32_t i = 0; i < u32_num_strings; i++)
+	{
+		length = strlen(kpkc_strings[i]) + 1;
+		memcpy(pc_table + u32_offset, kpkc_strings[i], length);
+		pu32_offsets[i] = u32_offset;
+		u32_offset += (uint32_t)length;
+	}
+}
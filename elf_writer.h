@@ -0,0 +1,15 @@
+#ifndef ELF_WRITER_H
+#define ELF_WRITER_H
+
+#include "common.h"
+#include "status.h"
+#include "encoder.h"
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+char * 			ELF_WRITER_format_object		(const ENCODER_code_t * kp_code, size_t * p_size);
+STATUS_t 		ELF_WRITER_write_object			(const ENCODER_code_t * kp_code, const char * kpc_fname);
+
+#endif
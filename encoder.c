@@ -0,0 +1,857 @@
+#include "encoder.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_ENCODER
+#define ENCODER_DBG(fmt, ...)			printf(BOLD("ENCODER:\t")fmt, ##__VA_ARGS__)
+#define ENCODER_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("ENCODER:\t"))fmt, ##__VA_ARGS__)
+#define ENCODER_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("ENCODER:\t"))fmt, ##__VA_ARGS__)
+#define ENCODER_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("ENCODER:\t"))fmt, ##__VA_ARGS__)
+#else
+#define ENCODER_DBG(fmt, ...)
+#define ENCODER_GREEN(fmt, ...)
+#define ENCODER_WARN(fmt, ...)
+#define ENCODER_ERR(fmt, ...)
+#endif
+
+#define ENCODER_INITIAL_CODE_SIZE		(256)
+#define ENCODER_MAX_INSTRUCTION_SIZE	(15)
+
+/*
+ *	Prefix and ModRM fields
+ */
+#define ENCODER_REX						(0x40)
+#define ENCODER_REX_W					(0x08)
+#define ENCODER_REX_R					(0x04)
+#define ENCODER_REX_X					(0x02)
+#define ENCODER_REX_B					(0x01)
+#define ENCODER_OPERAND_SIZE_16			(0x66)
+#define ENCODER_PREFIX_F3				(0xF3)
+
+#define ENCODER_MOD_INDIRECT			(0x00)
+#define ENCODER_MOD_DISP8				(0x40)
+#define ENCODER_MOD_DISP32				(0x80)
+#define ENCODER_MOD_DIRECT				(0xC0)
+
+#define ENCODER_RM_SIB					(0x04)	// rm of rsp/r12 means a SIB byte follows
+#define ENCODER_RM_DISP32_ONLY			(0x05)	// rm of rbp/r13 with no displacement means rip-relative
+#define ENCODER_SIB_NO_INDEX			(0x24)
+#define ENCODER_SIB_SCALE_SHIFT			(6)
+
+#define ENCODER_LOW_BITS(reg)			((uint8_t)((reg) & 0x07))
+#define ENCODER_IS_EXTENDED(reg)		(((reg) & 0x08) != 0)
+#define ENCODER_IS_MEMORY(kind)			((kind) == ASM_OPERAND_VARIABLE || (kind) == ASM_OPERAND_STACK)
+#define ENCODER_IS_RM(kind)				((kind) == ASM_OPERAND_REGISTER || ENCODER_IS_MEMORY(kind))
+#define ENCODER_FITS_IMM8(u32_value)	((int32_t)(u32_value) >= INT8_MIN && (int32_t)(u32_value) <= INT8_MAX)
+
+/*
+ *	Without a REX prefix, byte registers 4-7 are ah/ch/dh/bh. With any REX they're spl/bpl/sil/dil
+ */
+#define ENCODER_NEEDS_BYTE_REX(reg)		((reg) >= ASM_REGISTER_RSP && (reg) <= ASM_REGISTER_RDI)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Opcodes for the two-operand ALU instructions. Every one has a register/memory destination
+ *	form, a register destination form and an immediate group form with its /digit
+ */
+typedef struct
+{
+	uint8_t		u8_rm_reg;				// op r/m, reg
+	uint8_t		u8_reg_rm;				// op reg, r/m
+	uint8_t		u8_imm_digit;			// 0x81 / 0x83 /digit
+	uint8_t		u8_eax_imm;				// op eax, imm32 short form
+} ENCODER_alu_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const ENCODER_alu_t pk_alu_opcodes[ASM_OPCODE_NUM_OPCODES] =
+{
+	[ASM_OPCODE_ADD]	= { .u8_rm_reg = 0x01, .u8_reg_rm = 0x03, .u8_imm_digit = 0, .u8_eax_imm = 0x05 },
+	[ASM_OPCODE_SUB]	= { .u8_rm_reg = 0x29, .u8_reg_rm = 0x2B, .u8_imm_digit = 5, .u8_eax_imm = 0x2D },
+	[ASM_OPCODE_XOR]	= { .u8_rm_reg = 0x31, .u8_reg_rm = 0x33, .u8_imm_digit = 6, .u8_eax_imm = 0x35 },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static inline void 		ENCODER_emit_byte				(ENCODER_code_t * p_code, uint8_t u8_byte);
+static inline void 		ENCODER_emit_u32				(ENCODER_code_t * p_code, uint32_t u32_value);
+static inline void 		ENCODER_emit_immediate			(ENCODER_code_t * p_code, ASM_width_t width, uint32_t u32_value);
+static void 			ENCODER_emit_modrm_instruction	(ENCODER_code_t * p_code, ASM_width_t width, const uint8_t * kpu8_opcode, uint8_t u8_opcode_length,
+															uint8_t u8_reg_field, ASM_operand_kind_t rm_kind, uint32_t u32_rm);
+static void 			ENCODER_emit_modrm_rex			(ENCODER_code_t * p_code, uint8_t u8_rex, ASM_width_t width, const uint8_t * kpu8_opcode, uint8_t u8_opcode_length,
+															uint8_t u8_reg_field, ASM_operand_kind_t rm_kind, uint32_t u32_rm);
+static void 			ENCODER_emit_short_register		(ENCODER_code_t * p_code, ASM_width_t width, uint8_t u8_opcode, uint32_t u32_register);
+static STATUS_t 		ENCODER_encode_mov				(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_alu				(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_imul				(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_shift			(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_lea				(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_extension		(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+static STATUS_t 		ENCODER_encode_sse				(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void ENCODER_init_code(ENCODER_code_t * p_code)
+{
+	p_code->u32_size = 0;
+	p_code->u32_capacity = ENCODER_INITIAL_CODE_SIZE;
+	p_code->pu8_bytes = malloc(p_code->u32_capacity);
+	ASSERT(p_code->pu8_bytes);
+}
+
+void ENCODER_deinit_code(ENCODER_code_t * p_code)
+{
+	free(p_code->pu8_bytes);
+	p_code->pu8_bytes = NULL;
+	p_code->u32_size = 0;
+	p_code->u32_capacity = 0;
+}
+
+/*
+ *	Encodes every instruction in the buffer, appending to `p_code`.
+ *	Fails on the first instruction with no x86-64 encoding
+ */
+STATUS_t ENCODER_encode_program(const ASM_buffer_t * kp_buffer, ENCODER_code_t * p_code)
+{
+	STATUS_t status;
+
+	if (kp_buffer == NULL || p_code == NULL)
+	{
+		ENCODER_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	// Instructions never grow past ENCODER_MAX_INSTRUCTION_SIZE, so size the output once up front
+	while (p_code->u32_size + ((size_t)kp_buffer->u32_num_instructions * ENCODER_MAX_INSTRUCTION_SIZE) > p_code->u32_capacity)
+	{
+		p_code->u32_capacity *= 2;
+		p_code->pu8_bytes = realloc(p_code->pu8_bytes, p_code->u32_capacity);
+		ASSERT(p_code->pu8_bytes);
+	}
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		status = ENCODER_encode_instruction(&kp_buffer->p_instructions[i], p_code);
+
+		if (status != STATUS_OK)
+		{
+			ENCODER_ERR("Could not encode instruction %u\n", i);
+			return status;
+		}
+	}
+
+	ENCODER_DBG("Encoded %u instructions into %u bytes\n", kp_buffer->u32_num_instructions, p_code->u32_size);
+
+	return STATUS_OK;
+}
+
+/*
+ *	Encodes a single instruction. The caller guarantees room for ENCODER_MAX_INSTRUCTION_SIZE bytes
+ */
+STATUS_t ENCODER_encode_instruction(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	static const uint8_t ku8_div[] = { 0xF7 };
+	ASM_instruction_t zero_extension;
+
+	ASSERT(p_code->u32_size + ENCODER_MAX_INSTRUCTION_SIZE <= p_code->u32_capacity);
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOV:
+		{
+			return ENCODER_encode_mov(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_ADD:
+		case ASM_OPCODE_SUB:
+		case ASM_OPCODE_XOR:
+		{
+			return ENCODER_encode_alu(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_IMUL:
+		{
+			return ENCODER_encode_imul(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_SHL:
+		case ASM_OPCODE_SHR:
+		{
+			return ENCODER_encode_shift(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_LEA3:
+		case ASM_OPCODE_LEA5:
+		case ASM_OPCODE_LEA9:
+		case ASM_OPCODE_ADD_SCALED2:
+		case ASM_OPCODE_ADD_SCALED4:
+		case ASM_OPCODE_ADD_SCALED8:
+		{
+			return ENCODER_encode_lea(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_DIV:
+		case ASM_OPCODE_IDIV:
+		{
+			// div r/m is F7 /6, idiv F7 /7
+			if (!ENCODER_IS_RM(kp_instruction->u8_src_kind))
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_div, sizeof(ku8_div),
+				(kp_instruction->u8_opcode == ASM_OPCODE_DIV) ? 6 : 7, kp_instruction->u8_src_kind, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		case ASM_OPCODE_CDQ:
+		{
+			if (kp_instruction->u8_width == ASM_WIDTH_64)
+			{
+				ENCODER_emit_byte(p_code, ENCODER_REX | ENCODER_REX_W);
+			}
+			ENCODER_emit_byte(p_code, 0x99);
+			return STATUS_OK;
+		}
+		case ASM_OPCODE_MOVZL:
+		{
+			// Any 32-bit write zeroes the upper half, so this is just a 32-bit move
+			zero_extension = *kp_instruction;
+			zero_extension.u8_opcode = ASM_OPCODE_MOV;
+			zero_extension.u8_width = ASM_WIDTH_32;
+			return ENCODER_encode_mov(&zero_extension, p_code);
+		}
+		case ASM_OPCODE_MOVZB:
+		case ASM_OPCODE_MOVZW:
+		case ASM_OPCODE_MOVSB:
+		case ASM_OPCODE_MOVSW:
+		case ASM_OPCODE_MOVSL:
+		{
+			return ENCODER_encode_extension(kp_instruction, p_code);
+		}
+		case ASM_OPCODE_PUSH:
+		{
+			if (kp_instruction->u8_src_kind != ASM_OPERAND_REGISTER)
+			{
+				return STATUS_FAILED;
+			}
+
+			// push/pop are 64-bit by default and take no REX.W
+			ENCODER_emit_short_register(p_code, ASM_WIDTH_32, 0x50, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		case ASM_OPCODE_POP:
+		{
+			if (kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER)
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_short_register(p_code, ASM_WIDTH_32, 0x58, kp_instruction->u32_dst);
+			return STATUS_OK;
+		}
+		case ASM_OPCODE_RET:
+		{
+			ENCODER_emit_byte(p_code, 0xC3);
+			return STATUS_OK;
+		}
+		case ASM_OPCODE_MOVDQU:
+		case ASM_OPCODE_MOVD:
+		case ASM_OPCODE_PSHUFD0:
+		case ASM_OPCODE_PADDD:
+		case ASM_OPCODE_PSUBD:
+		{
+			return ENCODER_encode_sse(kp_instruction, p_code);
+		}
+		default:
+		{
+			return STATUS_FAILED;
+		}
+	}
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static inline void ENCODER_emit_byte(ENCODER_code_t * p_code, uint8_t u8_byte)
+{
+	p_code->pu8_bytes[p_code->u32_size++] = u8_byte;
+}
+
+static inline void ENCODER_emit_u32(ENCODER_code_t * p_code, uint32_t u32_value)
+{
+	// Little endian
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value));
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 8));
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 16));
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 24));
+}
+
+/*
+ *	An immediate as wide as the operation, up to the 32 bits every wider form sign extends
+ */
+static inline void ENCODER_emit_immediate(ENCODER_code_t * p_code, ASM_width_t width, uint32_t u32_value)
+{
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value));
+
+	if (width == ASM_WIDTH_8)
+	{
+		return;
+	}
+
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 8));
+
+	if (width == ASM_WIDTH_16)
+	{
+		return;
+	}
+
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 16));
+	ENCODER_emit_byte(p_code, (uint8_t)(u32_value >> 24));
+}
+
+/*
+ *	Emits [66] [REX] opcode ModRM [SIB] [disp] for an instruction whose r/m operand is a register,
+ *	a variable or a stack slot. `u8_reg_field` is a register or an opcode extension (/digit).
+ *	Byte operations only ever carry a register in it, which may need a bare REX
+ */
+static void ENCODER_emit_modrm_instruction(ENCODER_code_t * p_code, ASM_width_t width, const uint8_t * kpu8_opcode, uint8_t u8_opcode_length,
+											uint8_t u8_reg_field, ASM_operand_kind_t rm_kind, uint32_t u32_rm)
+{
+	uint8_t u8_rex = 0;
+
+	if (width == ASM_WIDTH_8 && (ENCODER_NEEDS_BYTE_REX(u8_reg_field) || (rm_kind == ASM_OPERAND_REGISTER && ENCODER_NEEDS_BYTE_REX(u32_rm))))
+	{
+		u8_rex = ENCODER_REX;
+	}
+
+	ENCODER_emit_modrm_rex(p_code, u8_rex, width, kpu8_opcode, u8_opcode_length, u8_reg_field, rm_kind, u32_rm);
+}
+
+/*
+ *	ENCODER_emit_modrm_instruction, with REX bits of the caller's own. ENCODER_REX alone forces a
+ *	prefix with none set
+ */
+static void ENCODER_emit_modrm_rex(ENCODER_code_t * p_code, uint8_t u8_rex, ASM_width_t width, const uint8_t * kpu8_opcode, uint8_t u8_opcode_length,
+									uint8_t u8_reg_field, ASM_operand_kind_t rm_kind, uint32_t u32_rm)
+{
+	uint8_t u8_rm_register;
+	uint32_t u32_displacement;
+	uint8_t u8_mod;
+
+	// Memory operands are a base register plus a displacement
+	switch (rm_kind)
+	{
+		case ASM_OPERAND_REGISTER:
+		{
+			u8_rm_register = (uint8_t)u32_rm;
+			u32_displacement = 0;
+			break;
+		}
+		case ASM_OPERAND_VARIABLE:
+		{
+			u8_rm_register = (uint8_t)ASM_VARIABLE_BASE_REGISTER;
+			u32_displacement = ASM_get_variable_offset(u32_rm);
+			break;
+		}
+		case ASM_OPERAND_STACK:
+		{
+			u8_rm_register = (uint8_t)ASM_REGISTER_RSP;
+			u32_displacement = u32_rm;
+			break;
+		}
+		default:
+		{
+			ASSERT(0);
+		}
+	}
+
+	u8_rex |= (width == ASM_WIDTH_64) ? ENCODER_REX_W : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u8_reg_field) ? ENCODER_REX_R : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u8_rm_register) ? ENCODER_REX_B : 0;
+
+	// The operand size prefix goes before REX, which must come right before the opcode
+	if (width == ASM_WIDTH_16)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_OPERAND_SIZE_16);
+	}
+
+	if (u8_rex != 0)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_REX | u8_rex);
+	}
+
+	for (uint8_t i = 0; i < u8_opcode_length; i++)
+	{
+		ENCODER_emit_byte(p_code, kpu8_opcode[i]);
+	}
+
+	if (rm_kind == ASM_OPERAND_REGISTER)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_MOD_DIRECT | (ENCODER_LOW_BITS(u8_reg_field) << 3) | ENCODER_LOW_BITS(u8_rm_register));
+		return;
+	}
+
+	// The shortest displacement that holds the offset
+	if (u32_displacement == 0 && ENCODER_LOW_BITS(u8_rm_register) != ENCODER_RM_DISP32_ONLY)
+	{
+		u8_mod = ENCODER_MOD_INDIRECT;
+	}
+	else if (u32_displacement <= INT8_MAX)
+	{
+		u8_mod = ENCODER_MOD_DISP8;
+	}
+	else
+	{
+		u8_mod = ENCODER_MOD_DISP32;
+	}
+
+	ENCODER_emit_byte(p_code, u8_mod | (ENCODER_LOW_BITS(u8_reg_field) << 3) | ENCODER_LOW_BITS(u8_rm_register));
+
+	if (ENCODER_LOW_BITS(u8_rm_register) == ENCODER_RM_SIB)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_SIB_NO_INDEX);
+	}
+
+	if (u8_mod == ENCODER_MOD_DISP8)
+	{
+		ENCODER_emit_byte(p_code, (uint8_t)u32_displacement);
+	}
+	else if (u8_mod == ENCODER_MOD_DISP32)
+	{
+		ENCODER_emit_u32(p_code, u32_displacement);
+	}
+}
+
+/*
+ *	Emits [66] [REX] opcode+reg, for the forms that carry their register in the opcode's low bits
+ */
+static void ENCODER_emit_short_register(ENCODER_code_t * p_code, ASM_width_t width, uint8_t u8_opcode, uint32_t u32_register)
+{
+	uint8_t u8_rex = 0;
+
+	u8_rex |= (width == ASM_WIDTH_64) ? ENCODER_REX_W : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u32_register) ? ENCODER_REX_B : 0;
+	u8_rex |= (width == ASM_WIDTH_8 && ENCODER_NEEDS_BYTE_REX(u32_register)) ? ENCODER_REX : 0;
+
+	if (width == ASM_WIDTH_16)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_OPERAND_SIZE_16);
+	}
+
+	if (u8_rex != 0)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_REX | u8_rex);
+	}
+
+	ENCODER_emit_byte(p_code, u8_opcode | ENCODER_LOW_BITS(u32_register));
+}
+
+/*
+ *	Byte moves have opcodes of their own, one below the others'
+ */
+static STATUS_t ENCODER_encode_mov(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	uint8_t u8_byte = (kp_instruction->u8_width == ASM_WIDTH_8) ? 1 : 0;
+	const uint8_t ku8_mov_rm_reg[] = { 0x89 - u8_byte };
+	const uint8_t ku8_mov_reg_rm[] = { 0x8B - u8_byte };
+	const uint8_t ku8_mov_rm_imm[] = { 0xC7 - u8_byte };
+
+	switch (kp_instruction->u8_src_kind)
+	{
+		case ASM_OPERAND_REGISTER:
+		{
+			if (!ENCODER_IS_RM(kp_instruction->u8_dst_kind))
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_mov_rm_reg, sizeof(ku8_mov_rm_reg),
+				(uint8_t)kp_instruction->u32_src, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+			return STATUS_OK;
+		}
+		case ASM_OPERAND_VARIABLE:
+		case ASM_OPERAND_STACK:
+		{
+			if (kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER)
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_mov_reg_rm, sizeof(ku8_mov_reg_rm),
+				(uint8_t)kp_instruction->u32_dst, kp_instruction->u8_src_kind, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		case ASM_OPERAND_IMMEDIATE:
+		{
+			// Moves into a register have a short form (B0+r, B8+r) at every width but 64, which
+			// would take a 64-bit immediate
+			if (kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER && kp_instruction->u8_width != ASM_WIDTH_64)
+			{
+				ENCODER_emit_short_register(p_code, kp_instruction->u8_width, 0xB8 - (8 * u8_byte), kp_instruction->u32_dst);
+			}
+			else if (ENCODER_IS_RM(kp_instruction->u8_dst_kind))
+			{
+				ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_mov_rm_imm, sizeof(ku8_mov_rm_imm),
+					0, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+			}
+			else
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_immediate(p_code, kp_instruction->u8_width, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		default:
+		{
+			return STATUS_FAILED;
+		}
+	}
+}
+
+static STATUS_t ENCODER_encode_alu(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	const ENCODER_alu_t * kp_alu = &pk_alu_opcodes[kp_instruction->u8_opcode];
+	uint8_t u8_opcode;
+
+	switch (kp_instruction->u8_src_kind)
+	{
+		case ASM_OPERAND_REGISTER:
+		{
+			if (!ENCODER_IS_RM(kp_instruction->u8_dst_kind))
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, &kp_alu->u8_rm_reg, 1,
+				(uint8_t)kp_instruction->u32_src, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+			return STATUS_OK;
+		}
+		case ASM_OPERAND_VARIABLE:
+		case ASM_OPERAND_STACK:
+		{
+			if (kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER)
+			{
+				return STATUS_FAILED;
+			}
+
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, &kp_alu->u8_reg_rm, 1,
+				(uint8_t)kp_instruction->u32_dst, kp_instruction->u8_src_kind, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		case ASM_OPERAND_IMMEDIATE:
+		{
+			if (!ENCODER_IS_RM(kp_instruction->u8_dst_kind))
+			{
+				return STATUS_FAILED;
+			}
+
+			// Sign-extended imm8 form, then the accumulator's short form, then the general one
+			if (ENCODER_FITS_IMM8(kp_instruction->u32_src))
+			{
+				u8_opcode = 0x83;
+				ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, &u8_opcode, 1,
+					kp_alu->u8_imm_digit, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+				ENCODER_emit_byte(p_code, (uint8_t)kp_instruction->u32_src);
+				return STATUS_OK;
+			}
+
+			if (kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER && kp_instruction->u32_dst == ASM_REGISTER_RAX)
+			{
+				if (kp_instruction->u8_width == ASM_WIDTH_64)
+				{
+					ENCODER_emit_byte(p_code, ENCODER_REX | ENCODER_REX_W);
+				}
+				ENCODER_emit_byte(p_code, kp_alu->u8_eax_imm);
+			}
+			else
+			{
+				u8_opcode = 0x81;
+				ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, &u8_opcode, 1,
+					kp_alu->u8_imm_digit, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+			}
+
+			ENCODER_emit_u32(p_code, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		default:
+		{
+			return STATUS_FAILED;
+		}
+	}
+}
+
+static STATUS_t ENCODER_encode_imul(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	static const uint8_t ku8_imul_reg_rm[] = { 0x0F, 0xAF };
+	static const uint8_t ku8_imul_imm8[] = { 0x6B };
+	static const uint8_t ku8_imul_imm32[] = { 0x69 };
+
+	// imul only ever writes a register
+	if (kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER)
+	{
+		return STATUS_FAILED;
+	}
+
+	switch (kp_instruction->u8_src_kind)
+	{
+		case ASM_OPERAND_REGISTER:
+		case ASM_OPERAND_VARIABLE:
+		case ASM_OPERAND_STACK:
+		{
+			ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_imul_reg_rm, sizeof(ku8_imul_reg_rm),
+				(uint8_t)kp_instruction->u32_dst, kp_instruction->u8_src_kind, kp_instruction->u32_src);
+			return STATUS_OK;
+		}
+		case ASM_OPERAND_IMMEDIATE:
+		{
+			// The three operand form, with the destination as its own source
+			if (ENCODER_FITS_IMM8(kp_instruction->u32_src))
+			{
+				ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_imul_imm8, sizeof(ku8_imul_imm8),
+					(uint8_t)kp_instruction->u32_dst, ASM_OPERAND_REGISTER, kp_instruction->u32_dst);
+				ENCODER_emit_byte(p_code, (uint8_t)kp_instruction->u32_src);
+			}
+			else
+			{
+				ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_imul_imm32, sizeof(ku8_imul_imm32),
+					(uint8_t)kp_instruction->u32_dst, ASM_OPERAND_REGISTER, kp_instruction->u32_dst);
+				ENCODER_emit_u32(p_code, kp_instruction->u32_src);
+			}
+			return STATUS_OK;
+		}
+		default:
+		{
+			return STATUS_FAILED;
+		}
+	}
+}
+
+static STATUS_t ENCODER_encode_shift(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	static const uint8_t ku8_shift_one[] = { 0xD1 };
+	static const uint8_t ku8_shift_imm8[] = { 0xC1 };
+	uint8_t u8_digit = (kp_instruction->u8_opcode == ASM_OPCODE_SHL) ? 4 : 5;
+
+	if (kp_instruction->u8_src_kind != ASM_OPERAND_IMMEDIATE || !ENCODER_IS_RM(kp_instruction->u8_dst_kind))
+	{
+		return STATUS_FAILED;
+	}
+
+	// A count of 1 has its own opcode, which `as` prefers
+	if (kp_instruction->u32_src == 1)
+	{
+		ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_shift_one, sizeof(ku8_shift_one),
+			u8_digit, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+	}
+	else
+	{
+		ENCODER_emit_modrm_instruction(p_code, kp_instruction->u8_width, ku8_shift_imm8, sizeof(ku8_shift_imm8),
+			u8_digit, kp_instruction->u8_dst_kind, kp_instruction->u32_dst);
+		ENCODER_emit_byte(p_code, (uint8_t)kp_instruction->u32_src);
+	}
+
+	return STATUS_OK;
+}
+
+/*
+ *	lea (base,src,scale), dst: ModRM points at a SIB byte with the source as index, and as base too
+ *	unless the lea adds to its destination. A base of rbp/r13 has no displacement-free form, so it
+ *	gets a zero disp8
+ */
+static STATUS_t ENCODER_encode_lea(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	uint8_t u8_scale = ASM_get_lea_scale(kp_instruction->u8_opcode);
+	uint8_t u8_scale_bits = (u8_scale == 2) ? 1 : ((u8_scale == 4) ? 2 : 3);
+	uint8_t u8_src;
+	uint8_t u8_dst;
+	uint8_t u8_base;
+	uint8_t u8_rex = 0;
+	uint8_t u8_mod;
+
+	if (kp_instruction->u8_src_kind != ASM_OPERAND_REGISTER || kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER)
+	{
+		return STATUS_FAILED;
+	}
+
+	u8_src = (uint8_t)kp_instruction->u32_src;
+	u8_dst = (uint8_t)kp_instruction->u32_dst;
+	u8_base = ASM_IS_SCALED_ADD(kp_instruction->u8_opcode) ? u8_dst : u8_src;
+
+	// rsp can't be an index
+	if (u8_src == ASM_REGISTER_RSP)
+	{
+		return STATUS_FAILED;
+	}
+
+	u8_rex |= (kp_instruction->u8_width == ASM_WIDTH_64) ? ENCODER_REX_W : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u8_dst) ? ENCODER_REX_R : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u8_src) ? ENCODER_REX_X : 0;
+	u8_rex |= ENCODER_IS_EXTENDED(u8_base) ? ENCODER_REX_B : 0;
+
+	if (u8_rex != 0)
+	{
+		ENCODER_emit_byte(p_code, ENCODER_REX | u8_rex);
+	}
+
+	u8_mod = (ENCODER_LOW_BITS(u8_base) == ENCODER_RM_DISP32_ONLY) ? ENCODER_MOD_DISP8 : ENCODER_MOD_INDIRECT;
+
+	ENCODER_emit_byte(p_code, 0x8D);
+	ENCODER_emit_byte(p_code, u8_mod | (ENCODER_LOW_BITS(u8_dst) << 3) | ENCODER_RM_SIB);
+	ENCODER_emit_byte(p_code, (u8_scale_bits << ENCODER_SIB_SCALE_SHIFT) | (ENCODER_LOW_BITS(u8_src) << 3) | ENCODER_LOW_BITS(u8_base));
+
+	if (u8_mod == ENCODER_MOD_DISP8)
+	{
+		ENCODER_emit_byte(p_code, 0);
+	}
+
+	return STATUS_OK;
+}
+
+/*
+ *	movz/movs reg, r/m: the destination is the reg field, sized by the instruction, and the
+ *	narrower source the r/m operand
+ */
+static STATUS_t ENCODER_encode_extension(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	static const uint8_t ku8_movzb[] = { 0x0F, 0xB6 };
+	static const uint8_t ku8_movzw[] = { 0x0F, 0xB7 };
+	static const uint8_t ku8_movsb[] = { 0x0F, 0xBE };
+	static const uint8_t ku8_movsw[] = { 0x0F, 0xBF };
+	static const uint8_t ku8_movsl[] = { 0x63 };
+	const uint8_t * kpu8_opcode;
+	uint8_t u8_opcode_length = 2;
+	uint8_t u8_rex = 0;
+
+	if (kp_instruction->u8_dst_kind != ASM_OPERAND_REGISTER || !ENCODER_IS_RM(kp_instruction->u8_src_kind))
+	{
+		return STATUS_FAILED;
+	}
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOVZB:
+		{
+			kpu8_opcode = ku8_movzb;
+			break;
+		}
+		case ASM_OPCODE_MOVZW:
+		{
+			kpu8_opcode = ku8_movzw;
+			break;
+		}
+		case ASM_OPCODE_MOVSB:
+		{
+			kpu8_opcode = ku8_movsb;
+			break;
+		}
+		case ASM_OPCODE_MOVSW:
+		{
+			kpu8_opcode = ku8_movsw;
+			break;
+		}
+		default:
+		{
+			// movslq only exists with REX.W
+			if (kp_instruction->u8_width != ASM_WIDTH_64)
+			{
+				return STATUS_FAILED;
+			}
+
+			kpu8_opcode = ku8_movsl;
+			u8_opcode_length = 1;
+			break;
+		}
+	}
+
+	if (ASM_get_src_width(kp_instruction) == ASM_WIDTH_8 && kp_instruction->u8_src_kind == ASM_OPERAND_REGISTER &&
+		ENCODER_NEEDS_BYTE_REX(kp_instruction->u32_src))
+	{
+		u8_rex = ENCODER_REX;
+	}
+
+	ENCODER_emit_modrm_rex(p_code, u8_rex, kp_instruction->u8_width, kpu8_opcode, u8_opcode_length,
+		(uint8_t)kp_instruction->u32_dst, kp_instruction->u8_src_kind, kp_instruction->u32_src);
+
+	return STATUS_OK;
+}
+
+/*
+ *	SSE2: a mandatory prefix, then [REX] 0F op ModRM, with the xmm register in the reg field and the
+ *	other operand as r/m. An xmm r/m is encoded as a register of the same number. The prefix has to
+ *	come before REX, so it's emitted here rather than as an operand size
+ */
+static STATUS_t ENCODER_encode_sse(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code)
+{
+	uint8_t pu8_opcode[] = { 0x0F, 0x00 };
+	uint8_t u8_prefix = ENCODER_OPERAND_SIZE_16;
+	uint8_t u8_rm_kind = kp_instruction->u8_src_kind;
+	uint32_t u32_rm = kp_instruction->u32_src;
+	uint32_t u32_xmm = kp_instruction->u32_dst;
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOVDQU:
+		{
+			// movdqu xmm, m128 is F3 0F 6F; movdqu m128, xmm is F3 0F 7F
+			u8_prefix = ENCODER_PREFIX_F3;
+
+			if (kp_instruction->u8_dst_kind == ASM_OPERAND_XMM && ENCODER_IS_MEMORY(kp_instruction->u8_src_kind))
+			{
+				pu8_opcode[1] = 0x6F;
+			}
+			else if (kp_instruction->u8_src_kind == ASM_OPERAND_XMM && ENCODER_IS_MEMORY(kp_instruction->u8_dst_kind))
+			{
+				pu8_opcode[1] = 0x7F;
+				u8_rm_kind = kp_instruction->u8_dst_kind;
+				u32_rm = kp_instruction->u32_dst;
+				u32_xmm = kp_instruction->u32_src;
+			}
+			else
+			{
+				return STATUS_FAILED;
+			}
+			break;
+		}
+		case ASM_OPCODE_MOVD:
+		{
+			// movd xmm, r/m32 is 66 0F 6E
+			if (kp_instruction->u8_dst_kind != ASM_OPERAND_XMM || !ENCODER_IS_RM(kp_instruction->u8_src_kind))
+			{
+				return STATUS_FAILED;
+			}
+
+			pu8_opcode[1] = 0x6E;
+			break;
+		}
+		default:
+		{
+			// pshufd 66 0F 70 ib, paddd 66 0F FE, psubd 66 0F FA, all xmm to xmm
+			if (kp_instruction->u8_src_kind != ASM_OPERAND_XMM || kp_instruction->u8_dst_kind != ASM_OPERAND_XMM)
+			{
+				return STATUS_FAILED;
+			}
+
+			pu8_opcode[1] = (kp_instruction->u8_opcode == ASM_OPCODE_PSHUFD0) ? 0x70 : ((kp_instruction->u8_opcode == ASM_OPCODE_PADDD) ? 0xFE : 0xFA);
+			u8_rm_kind = ASM_OPERAND_REGISTER;
+			break;
+		}
+	}
+
+	ENCODER_emit_byte(p_code, u8_prefix);
+	ENCODER_emit_modrm_rex(p_code, 0, ASM_WIDTH_32, pu8_opcode, sizeof(pu8_opcode), (uint8_t)u32_xmm, u8_rm_kind, u32_rm);
+
+	if (kp_instruction->u8_opcode == ASM_OPCODE_PSHUFD0)
+	{
+		ENCODER_emit_byte(p_code, 0);
+	}
+
+	return STATUS_OK;
+}
@@ -0,0 +1,32 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "common.h"
+#include "status.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	x86-64 machine code for rep_main. Variable accesses are displacements off
+ *	ASM_VARIABLE_BASE_REGISTER, so the code needs no relocations and runs wherever it's loaded
+ */
+typedef struct _ENCODER_code
+{
+	uint8_t *	pu8_bytes;
+	uint32_t	u32_size;
+	uint32_t	u32_capacity;
+} ENCODER_code_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			ENCODER_init_code				(ENCODER_code_t * p_code);
+void 			ENCODER_deinit_code				(ENCODER_code_t * p_code);
+STATUS_t 		ENCODER_encode_program			(const ASM_buffer_t * kp_buffer, ENCODER_code_t * p_code);
+STATUS_t 		ENCODER_encode_instruction		(const ASM_instruction_t * kp_instruction, ENCODER_code_t * p_code);
+
+#endif
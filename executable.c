@@ -0,0 +1,105 @@
+#include <unistd.h>
+#include "executable.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_EXECUTABLE
+#define EXECUTABLE_DBG(fmt, ...)		printf(BOLD("EXECUTABLE:\t")fmt, ##__VA_ARGS__)
+#define EXECUTABLE_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("EXECUTABLE:\t"))fmt, ##__VA_ARGS__)
+#define EXECUTABLE_WARN(fmt, ...)		printf(BOLD(BRIGHT_YELLOW("EXECUTABLE:\t"))fmt, ##__VA_ARGS__)
+#define EXECUTABLE_ERR(fmt, ...)		printf(BOLD(BRIGHT_RED("EXECUTABLE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define EXECUTABLE_DBG(fmt, ...)
+#define EXECUTABLE_GREEN(fmt, ...)
+#define EXECUTABLE_WARN(fmt, ...)
+#define EXECUTABLE_ERR(fmt, ...)
+#endif
+
+#define EXECUTABLE_MAX_COMMAND_LENGTH	(2048)
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Looked for once, on the PATH
+ */
+bool EXECUTABLE_linker_available(void)
+{
+	static int available = -1;
+
+	if (available < 0)
+	{
+		available = (system("command -v ld > /dev/null 2>&1") == 0);
+	}
+
+	return available == 1;
+}
+
+/*
+ *	Makes an empty file for an object on its way to being linked. `pc_fname` holds
+ *	EXECUTABLE_TEMP_FILE_TEMPLATE on the way in and the file's name on the way out
+ */
+STATUS_t EXECUTABLE_create_temp_object(char * pc_fname)
+{
+	int fd = mkstemp(pc_fname);
+
+	if (fd < 0)
+	{
+		EXECUTABLE_ERR("Failed to create a temporary file\n");
+		return STATUS_FILE_ERROR;
+	}
+
+	close(fd);
+
+	return STATUS_OK;
+}
+
+/*
+ *	Links an object defining rep_main and the variable tables with the runtime, into an
+ *	executable that runs it and prints the variables. Fails if there's no linker, or no runtime
+ */
+STATUS_t EXECUTABLE_link(const char * kpc_object_fname, const char * kpc_fname)
+{
+	char pc_command[EXECUTABLE_MAX_COMMAND_LENGTH];
+	int length;
+
+	if (!EXECUTABLE_linker_available())
+	{
+		EXECUTABLE_ERR("ld is not installed\n");
+		return STATUS_FAILED;
+	}
+
+	if (access(EXECUTABLE_RUNTIME_OBJECT, R_OK) != 0)
+	{
+		EXECUTABLE_ERR("No runtime at %s\n", EXECUTABLE_RUNTIME_OBJECT);
+		return STATUS_FILE_ERROR;
+	}
+
+	// Every name goes to the shell single quoted
+	if (strchr(kpc_object_fname, '\'') != NULL || strchr(kpc_fname, '\'') != NULL)
+	{
+		EXECUTABLE_ERR("Can't pass %s or %s to ld\n", kpc_object_fname, kpc_fname);
+		return STATUS_FAILED;
+	}
+
+	length = snprintf(pc_command, sizeof(pc_command), EXECUTABLE_LINK_COMMAND, kpc_fname, kpc_object_fname, EXECUTABLE_RUNTIME_OBJECT);
+
+	if (length < 0 || (size_t)length >= sizeof(pc_command))
+	{
+		EXECUTABLE_ERR("Paths too long to link\n");
+		return STATUS_FAILED;
+	}
+
+	EXECUTABLE_DBG("Running %s\n", pc_command);
+
+	if (system(pc_command) != 0)
+	{
+		EXECUTABLE_ERR("ld failed to link %s\n", kpc_object_fname);
+		return STATUS_FAILED;
+	}
+
+	return STATUS_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef EXECUTABLE_H
+#define EXECUTABLE_H
+
+#include "common.h"
+#include "status.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	The freestanding runtime objects are linked against, built from runtime/rep_runtime.c. The
+ *	Makefile passes its absolute path in, so rep finds it from anywhere
+ */
+#ifndef EXECUTABLE_RUNTIME_OBJECT
+#define EXECUTABLE_RUNTIME_OBJECT		"runtime/rep_runtime.o"
+#endif
+
+/*
+ *	How an object is linked with the runtime, given the executable's file, the object's and the
+ *	runtime's. Static, with no libc and no dynamic loader to run at startup
+ */
+#define EXECUTABLE_LINK_COMMAND			"ld -static -nostdlib -o '%s' '%s' '%s'"
+
+#define EXECUTABLE_TEMP_FILE_TEMPLATE	"/tmp/rep_exe_XXXXXX"
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+bool 			EXECUTABLE_linker_available		(void);
+STATUS_t 		EXECUTABLE_create_temp_object	(char * pc_fname);
+STATUS_t 		EXECUTABLE_link					(const char * kpc_object_fname, const char * kpc_fname);
+
+#endif
@@ -0,0 +1,414 @@
+#include "fold.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_FOLD
+#define FOLD_DBG(fmt, ...)				printf(BOLD("FOLD:\t")fmt, ##__VA_ARGS__)
+#define FOLD_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("FOLD:\t"))fmt, ##__VA_ARGS__)
+#define FOLD_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("FOLD:\t"))fmt, ##__VA_ARGS__)
+#define FOLD_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("FOLD:\t"))fmt, ##__VA_ARGS__)
+#else
+#define FOLD_DBG(fmt, ...)
+#define FOLD_GREEN(fmt, ...)
+#define FOLD_WARN(fmt, ...)
+#define FOLD_ERR(fmt, ...)
+#endif
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What a variable is known to hold at the current point of the program
+ */
+typedef struct
+{
+	bool		b_known;
+	uint64_t	u64_constant;					// As its own type reads it back: extended to 64 bits
+	uint32_t	u32_copy;						// Value a load read it as, or IR_VALUE_NONE
+	uint32_t	u32_copy_stores;				// Stores to anything there had been by then
+} FOLD_variable_t;
+
+typedef struct
+{
+	bool *				pb_known;				// Per value: whether it's a compile-time constant
+	uint64_t *			pu64_constants;			// Per value: that constant, wrapped to its statement's type
+	uint32_t *			pu32_replacements;		// Per value: the earlier value it's equal to, or itself
+	FOLD_variable_t *	p_variables;
+	uint32_t			u32_num_stores;			// So far, which every statement but a bare expression ends with
+	FOLD_report_t *		p_report;
+} FOLD_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		FOLD_load						(FOLD_info_t * p_info, IR_instruction_t * p_instruction);
+static void 		FOLD_store						(FOLD_info_t * p_info, const IR_instruction_t * kp_instruction);
+static void 		FOLD_arithmetic					(FOLD_info_t * p_info, IR_instruction_t * p_instruction);
+static bool 		FOLD_evaluate					(const IR_instruction_t * kp_instruction, uint64_t u64_left, uint64_t u64_right, uint64_t * pu64_result);
+static void 		FOLD_replace					(FOLD_info_t * p_info, uint32_t u32_value, uint32_t u32_replacement);
+static void 		FOLD_make_constant				(FOLD_info_t * p_info, IR_instruction_t * p_instruction, uint64_t u64_constant);
+static inline uint64_t FOLD_wrap					(BUILTINS_type_t type, uint64_t u64_value);
+static inline uint64_t FOLD_narrow					(BUILTINS_type_t type, uint64_t u64_value);
+static inline bool 	FOLD_fits_immediate				(BUILTINS_type_t type, uint64_t u64_value);
+static inline bool 	FOLD_is_constant				(const FOLD_info_t * kp_info, uint32_t u32_value, uint64_t u64_constant);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Forward over the whole program, which is one straight line of every statement in order. Values
+ *	whose operands are known are computed here, with the wraparound of the type their statement is
+ *	in, and the constant each store leaves in its variable is tracked so later loads of it can use
+ *	it. Instructions are rewritten in place: the loads and arithmetic this leaves unused, and the
+ *	stores nothing reads any more, are for dead code elimination
+ */
+void FOLD_run(IR_program_t * p_program, uint32_t u32_num_variables, FOLD_report_t * p_report)
+{
+	FOLD_info_t info;
+	IR_instruction_t * p_instruction;
+
+	info.pb_known = calloc(p_program->u32_num_values + 1, sizeof(bool));
+	info.pu64_constants = malloc(sizeof(uint64_t) * (p_program->u32_num_values + 1));
+	info.pu32_replacements = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	info.p_variables = malloc(sizeof(FOLD_variable_t) * (u32_num_variables + 1));
+	info.u32_num_stores = 0;
+	info.p_report = p_report;
+	ASSERT(info.pb_known && info.pu64_constants && info.pu32_replacements && info.p_variables);
+
+	p_report->u32_num_folded = 0;
+	p_report->u32_num_simplified = 0;
+	p_report->u32_num_propagated = 0;
+
+	for (uint32_t i = 0; i < p_program->u32_num_values; i++)
+	{
+		info.pu32_replacements[i] = i;
+	}
+
+	// Nothing is known about what the caller passes in
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		info.p_variables[i].b_known = false;
+		info.p_variables[i].u64_constant = 0;
+		info.p_variables[i].u32_copy = IR_VALUE_NONE;
+		info.p_variables[i].u32_copy_stores = 0;
+	}
+
+	for (uint32_t i = 0; i < p_program->u32_num_instructions; i++)
+	{
+		p_instruction = &p_program->p_instructions[i];
+
+		// Replacements are always defined earlier, so a single lookup is already the oldest
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (p_instruction->pu32_operands[j] != IR_VALUE_NONE)
+			{
+				p_instruction->pu32_operands[j] = info.pu32_replacements[p_instruction->pu32_operands[j]];
+			}
+		}
+
+		switch (p_instruction->u8_opcode)
+		{
+			case IR_OPCODE_CONST:
+			{
+				info.pb_known[p_instruction->u32_result] = true;
+				info.pu64_constants[p_instruction->u32_result] = FOLD_wrap(p_instruction->u8_type, p_instruction->u32_immediate);
+				break;
+			}
+			case IR_OPCODE_LOAD:
+			{
+				FOLD_load(&info, p_instruction);
+				break;
+			}
+			case IR_OPCODE_STORE:
+			{
+				FOLD_store(&info, p_instruction);
+				break;
+			}
+			default:
+			{
+				FOLD_arithmetic(&info, p_instruction);
+				break;
+			}
+		}
+	}
+
+	FOLD_DBG("Folded %u instructions, simplified %u and propagated into %u loads\n",
+		p_report->u32_num_folded, p_report->u32_num_simplified, p_report->u32_num_propagated);
+
+	free(info.pb_known);
+	free(info.pu64_constants);
+	free(info.pu32_replacements);
+	free(info.p_variables);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	A known constant becomes an immediate if it fits one. Otherwise a load earlier in the same
+ *	statement is reused, as in x - x. Reusing values across statements keeps them live for longer,
+ *	so is left to value numbering, which has a budget for it
+ */
+static void FOLD_load(FOLD_info_t * p_info, IR_instruction_t * p_instruction)
+{
+	FOLD_variable_t * p_variable = &p_info->p_variables[p_instruction->u32_immediate];
+	uint64_t u64_constant = FOLD_wrap(p_instruction->u8_type, p_variable->u64_constant);
+
+	if (p_variable->b_known && FOLD_fits_immediate(p_instruction->u8_type, u64_constant))
+	{
+		FOLD_DBG("%s is %llu\n", SYMBOL_TABLE_get_symbol_table()[p_instruction->u32_immediate].p_token->pc_lexeme, (unsigned long long)u64_constant);
+		FOLD_make_constant(p_info, p_instruction, u64_constant);
+		p_info->p_report->u32_num_propagated++;
+	}
+	else if (p_variable->u32_copy != IR_VALUE_NONE && p_variable->u32_copy_stores == p_info->u32_num_stores)
+	{
+		FOLD_replace(p_info, p_instruction->u32_result, p_variable->u32_copy);
+		p_info->p_report->u32_num_propagated++;
+	}
+	else
+	{
+		p_info->pb_known[p_instruction->u32_result] = p_variable->b_known;
+		p_info->pu64_constants[p_instruction->u32_result] = u64_constant;
+
+		// Loads in a statement are all extended to its type, so read the same
+		p_variable->u32_copy = p_instruction->u32_result;
+		p_variable->u32_copy_stores = p_info->u32_num_stores;
+	}
+}
+
+/*
+ *	The variable now holds what was stored, truncated to its type
+ */
+static void FOLD_store(FOLD_info_t * p_info, const IR_instruction_t * kp_instruction)
+{
+	FOLD_variable_t * p_variable = &p_info->p_variables[kp_instruction->u32_immediate];
+	uint32_t u32_value = kp_instruction->pu32_operands[0];
+
+	p_variable->b_known = p_info->pb_known[u32_value];
+	p_variable->u64_constant = p_variable->b_known ? FOLD_narrow(kp_instruction->u8_variable_type, p_info->pu64_constants[u32_value]) : 0;
+	p_variable->u32_copy = IR_VALUE_NONE;
+	p_info->u32_num_stores++;
+}
+
+/*
+ *	Computes the instruction if both operands are known, or else drops it when an identity
+ *	makes one operand its result
+ */
+static void FOLD_arithmetic(FOLD_info_t * p_info, IR_instruction_t * p_instruction)
+{
+	uint32_t u32_left = p_instruction->pu32_operands[0];
+	uint32_t u32_right = p_instruction->pu32_operands[1];
+	uint64_t u64_constant;
+
+	if (p_info->pb_known[u32_left] && p_info->pb_known[u32_right] &&
+		FOLD_evaluate(p_instruction, p_info->pu64_constants[u32_left], p_info->pu64_constants[u32_right], &u64_constant))
+	{
+		if (FOLD_fits_immediate(p_instruction->u8_type, u64_constant))
+		{
+			FOLD_make_constant(p_info, p_instruction, u64_constant);
+			p_info->p_report->u32_num_folded++;
+		}
+		else
+		{
+			// Still worth knowing for whatever it feeds, which may fit
+			p_info->pb_known[p_instruction->u32_result] = true;
+			p_info->pu64_constants[p_instruction->u32_result] = u64_constant;
+		}
+
+		return;
+	}
+
+	switch (p_instruction->u8_opcode)
+	{
+		case IR_OPCODE_ADD:
+		{
+			if (FOLD_is_constant(p_info, u32_right, 0))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_left);
+				p_info->p_report->u32_num_simplified++;
+			}
+			else if (FOLD_is_constant(p_info, u32_left, 0))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_right);
+				p_info->p_report->u32_num_simplified++;
+			}
+			break;
+		}
+		case IR_OPCODE_SUB:
+		{
+			if (FOLD_is_constant(p_info, u32_right, 0))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_left);
+				p_info->p_report->u32_num_simplified++;
+			}
+			else if (u32_left == u32_right)
+			{
+				FOLD_make_constant(p_info, p_instruction, 0);
+				p_info->p_report->u32_num_simplified++;
+			}
+			break;
+		}
+		case IR_OPCODE_MUL:
+		{
+			if (FOLD_is_constant(p_info, u32_left, 0) || FOLD_is_constant(p_info, u32_right, 0))
+			{
+				FOLD_make_constant(p_info, p_instruction, 0);
+				p_info->p_report->u32_num_simplified++;
+			}
+			else if (FOLD_is_constant(p_info, u32_right, 1))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_left);
+				p_info->p_report->u32_num_simplified++;
+			}
+			else if (FOLD_is_constant(p_info, u32_left, 1))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_right);
+				p_info->p_report->u32_num_simplified++;
+			}
+			break;
+		}
+		case IR_OPCODE_DIV:
+		{
+			// Not x / x: that still has to fault when x is 0
+			if (FOLD_is_constant(p_info, u32_right, 1))
+			{
+				FOLD_replace(p_info, p_instruction->u32_result, u32_left);
+				p_info->p_report->u32_num_simplified++;
+			}
+			break;
+		}
+	}
+}
+
+/*
+ *	Computes what the instruction would at run time, operands and result wrapped to its type.
+ *	Divisions that would fault are left to do so
+ */
+static bool FOLD_evaluate(const IR_instruction_t * kp_instruction, uint64_t u64_left, uint64_t u64_right, uint64_t * pu64_result)
+{
+	BUILTINS_type_t type = kp_instruction->u8_type;
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case IR_OPCODE_ADD:
+		{
+			*pu64_result = u64_left + u64_right;
+			break;
+		}
+		case IR_OPCODE_SUB:
+		{
+			*pu64_result = u64_left - u64_right;
+			break;
+		}
+		case IR_OPCODE_MUL:
+		{
+			*pu64_result = u64_left * u64_right;
+			break;
+		}
+		case IR_OPCODE_DIV:
+		{
+			if (u64_right == 0)
+			{
+				return false;
+			}
+
+			if (!BUILTINS_is_signed(type))
+			{
+				*pu64_result = u64_left / u64_right;
+			}
+			else if (BUILTINS_get_size(type) == sizeof(uint64_t))
+			{
+				if ((int64_t)u64_left == INT64_MIN && (int64_t)u64_right == -1)
+				{
+					return false;
+				}
+
+				*pu64_result = (uint64_t)((int64_t)u64_left / (int64_t)u64_right);
+			}
+			else
+			{
+				if ((int32_t)u64_left == INT32_MIN && (int32_t)u64_right == -1)
+				{
+					return false;
+				}
+
+				*pu64_result = (uint64_t)((int32_t)u64_left / (int32_t)u64_right);
+			}
+			break;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+
+	*pu64_result = FOLD_wrap(type, *pu64_result);
+
+	return true;
+}
+
+/*
+ *	Every later use of the value takes the replacement instead, which is known if it was
+ */
+static void FOLD_replace(FOLD_info_t * p_info, uint32_t u32_value, uint32_t u32_replacement)
+{
+	p_info->pu32_replacements[u32_value] = u32_replacement;
+	p_info->pb_known[u32_value] = p_info->pb_known[u32_replacement];
+	p_info->pu64_constants[u32_value] = p_info->pu64_constants[u32_replacement];
+}
+
+static void FOLD_make_constant(FOLD_info_t * p_info, IR_instruction_t * p_instruction, uint64_t u64_constant)
+{
+	p_instruction->u8_opcode = IR_OPCODE_CONST;
+	p_instruction->u8_variable_type = BUILTINS_TYPE_U32;
+	p_instruction->pu32_operands[0] = IR_VALUE_NONE;
+	p_instruction->pu32_operands[1] = IR_VALUE_NONE;
+	p_instruction->u32_immediate = (uint32_t)u64_constant;
+
+	p_info->pb_known[p_instruction->u32_result] = true;
+	p_info->pu64_constants[p_instruction->u32_result] = u64_constant;
+}
+
+/*
+ *	Statements are computed in 32 or 64 bits, and wrap around at that width
+ */
+static inline uint64_t FOLD_wrap(BUILTINS_type_t type, uint64_t u64_value)
+{
+	return (BUILTINS_get_size(type) == sizeof(uint64_t)) ? u64_value : (u64_value & UINT32_MAX);
+}
+
+/*
+ *	What a variable of the type reads back after the value is stored to it: truncated, then
+ *	extended to 64 bits by its signedness
+ */
+static inline uint64_t FOLD_narrow(BUILTINS_type_t type, uint64_t u64_value)
+{
+	uint8_t u8_shift = (uint8_t)(64 - (8 * BUILTINS_get_size(type)));
+
+	if (u8_shift == 0)
+	{
+		return u64_value;
+	}
+
+	return BUILTINS_is_signed(type) ? (uint64_t)((int64_t)(u64_value << u8_shift) >> u8_shift) : ((u64_value << u8_shift) >> u8_shift);
+}
+
+/*
+ *	Constants are u32 immediates, which 64-bit statements zero extend
+ */
+static inline bool FOLD_fits_immediate(BUILTINS_type_t type, uint64_t u64_value)
+{
+	return u64_value <= UINT32_MAX || BUILTINS_get_size(type) != sizeof(uint64_t);
+}
+
+static inline bool FOLD_is_constant(const FOLD_info_t * kp_info, uint32_t u32_value, uint64_t u64_constant)
+{
+	return kp_info->pb_known[u32_value] && kp_info->pu64_constants[u32_value] == u64_constant;
+}
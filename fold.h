@@ -0,0 +1,24 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _FOLD_report
+{
+	uint32_t	u32_num_folded;					// Instructions turned into the constant they compute
+	uint32_t	u32_num_simplified;				// Identities: x + 0, x * 1, x * 0, x - x, x / 1
+	uint32_t	u32_num_propagated;				// Loads of a known constant, or of what the statement already loaded
+} FOLD_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			FOLD_run						(IR_program_t * p_program, uint32_t u32_num_variables, FOLD_report_t * p_report);
+
+#endif
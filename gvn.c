@@ -0,0 +1,424 @@
+#include "gvn.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_GVN
+#define GVN_DBG(fmt, ...)				printf(BOLD("GVN:\t")fmt, ##__VA_ARGS__)
+#define GVN_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("GVN:\t"))fmt, ##__VA_ARGS__)
+#define GVN_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("GVN:\t"))fmt, ##__VA_ARGS__)
+#define GVN_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("GVN:\t"))fmt, ##__VA_ARGS__)
+#else
+#define GVN_DBG(fmt, ...)
+#define GVN_GREEN(fmt, ...)
+#define GVN_WARN(fmt, ...)
+#define GVN_ERR(fmt, ...)
+#endif
+
+#define GVN_MAX(a, b)					(((a) > (b)) ? (a) : (b))
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What makes two instructions compute the same value
+ */
+typedef struct
+{
+	uint8_t		u8_opcode;
+	uint8_t		u8_type;
+	uint8_t		u8_variable_type;
+	uint32_t	u32_left;						// Operand's number, the constant, or the variable loaded
+	uint32_t	u32_right;						// Operand's number, or how many stores the variable loaded has seen
+} GVN_key_t;
+
+typedef struct
+{
+	GVN_key_t	key;
+	uint32_t	u32_value;						// Latest value with the key, or IR_VALUE_NONE if the slot is free
+} GVN_entry_t;
+
+/*
+ *	How many values are live at each instruction, as a segment tree so a range can be raised or
+ *	have its highest point found in log time. A node's max includes its own pending add
+ */
+typedef struct
+{
+	int32_t *	pi32_max;
+	int32_t *	pi32_add;
+	uint32_t	u32_num_leaves;					// Power of two
+} GVN_pressure_t;
+
+typedef struct
+{
+	GVN_entry_t *	p_table;					// Open addressing, linear probing
+	uint32_t		u32_table_mask;
+	uint32_t *		pu32_numbers;				// Per value: the first value found equal to it
+	uint32_t *		pu32_replacements;			// Per value: the earlier value its uses take instead, or itself
+	uint32_t *		pu32_def;					// Per value: index of the instruction defining it
+	uint32_t *		pu32_last_use;				// Per value: index of the last instruction using it, or IR_VALUE_NONE
+	uint32_t *		pu32_versions;				// Per variable: stores to it so far
+	GVN_pressure_t	pressure;
+	uint32_t		u32_budget;
+	GVN_report_t *	p_report;
+} GVN_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		GVN_init_pressure				(GVN_info_t * p_info, const IR_program_t * kp_program);
+static void 		GVN_make_key					(const GVN_info_t * kp_info, const IR_instruction_t * kp_instruction, GVN_key_t * p_key);
+static GVN_entry_t * GVN_lookup						(GVN_info_t * p_info, const GVN_key_t * kp_key);
+static bool 		GVN_try_reuse					(GVN_info_t * p_info, uint32_t u32_earlier, uint32_t u32_value, uint32_t u32_index);
+static void 		GVN_add_pressure				(GVN_pressure_t * p_pressure, uint32_t u32_node, uint32_t u32_low, uint32_t u32_high, uint32_t u32_start, uint32_t u32_end, int32_t i32_delta);
+static int32_t 		GVN_max_pressure				(const GVN_pressure_t * kp_pressure, uint32_t u32_node, uint32_t u32_low, uint32_t u32_high, uint32_t u32_start, uint32_t u32_end);
+static inline bool 	GVN_keys_equal					(const GVN_key_t * kp_left, const GVN_key_t * kp_right);
+static inline uint32_t GVN_hash						(const GVN_key_t * kp_key);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Forward over the whole program, numbering every value so equal ones share a number: constants
+ *	by type and value, loads by variable and how many times it has been stored to, so a load right
+ *	after a store has the number of what was stored, and arithmetic by its operands' numbers. When an instruction computes a number an earlier value already has, its
+ *	uses take the earlier value instead, unless keeping that live until then would mean more than
+ *	`u32_budget` values live at once somewhere in between. Constants are never reused, since an
+ *	immediate costs nothing to hold. Instructions left unused are for dead code elimination
+ */
+void GVN_run(IR_program_t * p_program, uint32_t u32_num_variables, uint32_t u32_budget, GVN_report_t * p_report)
+{
+	uint32_t u32_table_size = 1;
+	IR_instruction_t * p_instruction;
+	GVN_entry_t * p_entry;
+	GVN_info_t info;
+	GVN_key_t key;
+
+	while (u32_table_size < 2 * (p_program->u32_num_instructions + 1))
+	{
+		u32_table_size <<= 1;
+	}
+
+	info.p_table = malloc(sizeof(GVN_entry_t) * u32_table_size);
+	info.u32_table_mask = u32_table_size - 1;
+	info.pu32_numbers = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	info.pu32_replacements = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	info.pu32_def = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	info.pu32_last_use = malloc(sizeof(uint32_t) * (p_program->u32_num_values + 1));
+	info.pu32_versions = calloc(u32_num_variables + 1, sizeof(uint32_t));
+	info.u32_budget = u32_budget;
+	info.p_report = p_report;
+	ASSERT(info.p_table && info.pu32_numbers && info.pu32_replacements && info.pu32_def && info.pu32_last_use && info.pu32_versions);
+
+	p_report->u32_num_reused = 0;
+	p_report->u32_num_over_budget = 0;
+
+	for (uint32_t i = 0; i < u32_table_size; i++)
+	{
+		info.p_table[i].u32_value = IR_VALUE_NONE;
+	}
+
+	for (uint32_t i = 0; i < p_program->u32_num_values; i++)
+	{
+		info.pu32_replacements[i] = i;
+		info.pu32_last_use[i] = IR_VALUE_NONE;
+	}
+
+	GVN_init_pressure(&info, p_program);
+
+	for (uint32_t i = 0; i < p_program->u32_num_instructions; i++)
+	{
+		p_instruction = &p_program->p_instructions[i];
+
+		// Replacements are always defined earlier, so a single lookup is already the oldest
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (p_instruction->pu32_operands[j] != IR_VALUE_NONE)
+			{
+				p_instruction->pu32_operands[j] = info.pu32_replacements[p_instruction->pu32_operands[j]];
+			}
+		}
+
+		if (p_instruction->u8_opcode == IR_OPCODE_STORE)
+		{
+			info.pu32_versions[p_instruction->u32_immediate]++;
+
+			// Loading it back gives the value stored, unless the store truncated it
+			if (BUILTINS_get_size(p_instruction->u8_variable_type) == BUILTINS_get_size(p_instruction->u8_type))
+			{
+				GVN_make_key(&info, p_instruction, &key);
+				p_entry = GVN_lookup(&info, &key);
+				p_entry->key = key;
+				p_entry->u32_value = p_instruction->pu32_operands[0];
+			}
+			continue;
+		}
+
+		GVN_make_key(&info, p_instruction, &key);
+		p_entry = GVN_lookup(&info, &key);
+		info.pu32_numbers[p_instruction->u32_result] = p_instruction->u32_result;
+
+		if (p_entry->u32_value == IR_VALUE_NONE)
+		{
+			p_entry->key = key;
+			p_entry->u32_value = p_instruction->u32_result;
+		}
+		else if (p_instruction->u8_opcode == IR_OPCODE_CONST || info.pu32_last_use[p_instruction->u32_result] == IR_VALUE_NONE)
+		{
+			info.pu32_numbers[p_instruction->u32_result] = info.pu32_numbers[p_entry->u32_value];
+		}
+		else if (GVN_try_reuse(&info, p_entry->u32_value, p_instruction->u32_result, i))
+		{
+			info.pu32_replacements[p_instruction->u32_result] = p_entry->u32_value;
+			info.pu32_numbers[p_instruction->u32_result] = info.pu32_numbers[p_entry->u32_value];
+			p_report->u32_num_reused++;
+		}
+		else
+		{
+			// The nearer one is the cheaper to reuse from now on
+			info.pu32_numbers[p_instruction->u32_result] = info.pu32_numbers[p_entry->u32_value];
+			p_entry->u32_value = p_instruction->u32_result;
+			p_report->u32_num_over_budget++;
+		}
+	}
+
+	GVN_DBG("Reused %u values, %u more were over the budget of %u\n", p_report->u32_num_reused, p_report->u32_num_over_budget, u32_budget);
+
+	free(info.p_table);
+	free(info.pu32_numbers);
+	free(info.pu32_replacements);
+	free(info.pu32_def);
+	free(info.pu32_last_use);
+	free(info.pu32_versions);
+	free(info.pressure.pi32_max);
+	free(info.pressure.pi32_add);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Every value is live from its definition to its last use. Counted with a difference array, then
+ *	the tree is built bottom up
+ */
+static void GVN_init_pressure(GVN_info_t * p_info, const IR_program_t * kp_program)
+{
+	GVN_pressure_t * p_pressure = &p_info->pressure;
+	const IR_instruction_t * kp_instruction;
+	int32_t i32_live = 0;
+
+	p_pressure->u32_num_leaves = 1;
+
+	while (p_pressure->u32_num_leaves < kp_program->u32_num_instructions)
+	{
+		p_pressure->u32_num_leaves <<= 1;
+	}
+
+	p_pressure->pi32_max = calloc(2 * p_pressure->u32_num_leaves, sizeof(int32_t));
+	p_pressure->pi32_add = calloc(2 * p_pressure->u32_num_leaves, sizeof(int32_t));
+	ASSERT(p_pressure->pi32_max && p_pressure->pi32_add);
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		if (kp_instruction->u32_result != IR_VALUE_NONE)
+		{
+			p_info->pu32_def[kp_instruction->u32_result] = i;
+		}
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (kp_instruction->pu32_operands[j] != IR_VALUE_NONE)
+			{
+				p_info->pu32_last_use[kp_instruction->pu32_operands[j]] = i;
+			}
+		}
+	}
+
+	// Leaves hold the differences first: +1 where a value is defined, -1 just past its last use
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		if (kp_instruction->u32_result != IR_VALUE_NONE && p_info->pu32_last_use[kp_instruction->u32_result] != IR_VALUE_NONE)
+		{
+			p_pressure->pi32_max[p_pressure->u32_num_leaves + i]++;
+
+			if (p_info->pu32_last_use[kp_instruction->u32_result] + 1 < p_pressure->u32_num_leaves)
+			{
+				p_pressure->pi32_max[p_pressure->u32_num_leaves + p_info->pu32_last_use[kp_instruction->u32_result] + 1]--;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < p_pressure->u32_num_leaves; i++)
+	{
+		i32_live += p_pressure->pi32_max[p_pressure->u32_num_leaves + i];
+		p_pressure->pi32_max[p_pressure->u32_num_leaves + i] = i32_live;
+	}
+
+	for (uint32_t i = p_pressure->u32_num_leaves - 1; i > 0; i--)
+	{
+		p_pressure->pi32_max[i] = GVN_MAX(p_pressure->pi32_max[2 * i], p_pressure->pi32_max[(2 * i) + 1]);
+	}
+}
+
+/*
+ *	Operands are keyed by number, so equal values computed from different instructions still
+ *	match, and the operands of commutative instructions are put in order
+ */
+static void GVN_make_key(const GVN_info_t * kp_info, const IR_instruction_t * kp_instruction, GVN_key_t * p_key)
+{
+	uint32_t u32_swap;
+
+	p_key->u8_opcode = kp_instruction->u8_opcode;
+	p_key->u8_type = kp_instruction->u8_type;
+	p_key->u8_variable_type = 0;
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case IR_OPCODE_CONST:
+		{
+			p_key->u32_left = kp_instruction->u32_immediate;
+			p_key->u32_right = 0;
+			break;
+		}
+		case IR_OPCODE_STORE:
+		case IR_OPCODE_LOAD:
+		{
+			// A store is keyed as the load that would read it back
+			p_key->u8_opcode = IR_OPCODE_LOAD;
+			p_key->u8_variable_type = kp_instruction->u8_variable_type;
+			p_key->u32_left = kp_instruction->u32_immediate;
+			p_key->u32_right = kp_info->pu32_versions[kp_instruction->u32_immediate];
+			break;
+		}
+		default:
+		{
+			p_key->u32_left = kp_info->pu32_numbers[kp_instruction->pu32_operands[0]];
+			p_key->u32_right = kp_info->pu32_numbers[kp_instruction->pu32_operands[1]];
+
+			if ((kp_instruction->u8_opcode == IR_OPCODE_ADD || kp_instruction->u8_opcode == IR_OPCODE_MUL) && p_key->u32_left > p_key->u32_right)
+			{
+				u32_swap = p_key->u32_left;
+				p_key->u32_left = p_key->u32_right;
+				p_key->u32_right = u32_swap;
+			}
+			break;
+		}
+	}
+}
+
+/*
+ *	The slot holding the key, or the free one it would go in
+ */
+static GVN_entry_t * GVN_lookup(GVN_info_t * p_info, const GVN_key_t * kp_key)
+{
+	uint32_t u32_slot = GVN_hash(kp_key) & p_info->u32_table_mask;
+
+	while (p_info->p_table[u32_slot].u32_value != IR_VALUE_NONE && !GVN_keys_equal(&p_info->p_table[u32_slot].key, kp_key))
+	{
+		u32_slot = (u32_slot + 1) & p_info->u32_table_mask;
+	}
+
+	return &p_info->p_table[u32_slot];
+}
+
+/*
+ *	Reusing the earlier value keeps it live from its last use so far to wherever the later one's
+ *	last use is. From here on that's the later one's range handed over, so only the gap up to
+ *	here costs anything: one more live value, which every instruction in it must have room for
+ */
+static bool GVN_try_reuse(GVN_info_t * p_info, uint32_t u32_earlier, uint32_t u32_value, uint32_t u32_index)
+{
+	GVN_pressure_t * p_pressure = &p_info->pressure;
+	uint32_t u32_live_until = (p_info->pu32_last_use[u32_earlier] != IR_VALUE_NONE) ? p_info->pu32_last_use[u32_earlier] : p_info->pu32_def[u32_earlier];
+
+	if (u32_live_until + 1 < u32_index)
+	{
+		if (GVN_max_pressure(p_pressure, 1, 0, p_pressure->u32_num_leaves - 1, u32_live_until + 1, u32_index - 1) + 1 > (int32_t)p_info->u32_budget)
+		{
+			return false;
+		}
+
+		GVN_add_pressure(p_pressure, 1, 0, p_pressure->u32_num_leaves - 1, u32_live_until + 1, u32_index - 1, 1);
+	}
+
+	p_info->pu32_last_use[u32_earlier] = GVN_MAX(u32_live_until, p_info->pu32_last_use[u32_value]);
+
+	return true;
+}
+
+/*
+ *	Adds `i32_delta` to every instruction in [u32_start, u32_end]. The node covers [u32_low, u32_high]
+ */
+static void GVN_add_pressure(GVN_pressure_t * p_pressure, uint32_t u32_node, uint32_t u32_low, uint32_t u32_high, uint32_t u32_start, uint32_t u32_end, int32_t i32_delta)
+{
+	uint32_t u32_middle = u32_low + ((u32_high - u32_low) / 2);
+
+	if (u32_end < u32_low || u32_high < u32_start)
+	{
+		return;
+	}
+
+	if (u32_start <= u32_low && u32_high <= u32_end)
+	{
+		p_pressure->pi32_max[u32_node] += i32_delta;
+		p_pressure->pi32_add[u32_node] += i32_delta;
+		return;
+	}
+
+	GVN_add_pressure(p_pressure, 2 * u32_node, u32_low, u32_middle, u32_start, u32_end, i32_delta);
+	GVN_add_pressure(p_pressure, (2 * u32_node) + 1, u32_middle + 1, u32_high, u32_start, u32_end, i32_delta);
+
+	p_pressure->pi32_max[u32_node] = p_pressure->pi32_add[u32_node] +
+		GVN_MAX(p_pressure->pi32_max[2 * u32_node], p_pressure->pi32_max[(2 * u32_node) + 1]);
+}
+
+/*
+ *	Most values live at once anywhere in [u32_start, u32_end]
+ */
+static int32_t GVN_max_pressure(const GVN_pressure_t * kp_pressure, uint32_t u32_node, uint32_t u32_low, uint32_t u32_high, uint32_t u32_start, uint32_t u32_end)
+{
+	uint32_t u32_middle = u32_low + ((u32_high - u32_low) / 2);
+	int32_t i32_left;
+	int32_t i32_right;
+
+	if (u32_end < u32_low || u32_high < u32_start)
+	{
+		return INT32_MIN / 2;
+	}
+
+	if (u32_start <= u32_low && u32_high <= u32_end)
+	{
+		return kp_pressure->pi32_max[u32_node];
+	}
+
+	i32_left = GVN_max_pressure(kp_pressure, 2 * u32_node, u32_low, u32_middle, u32_start, u32_end);
+	i32_right = GVN_max_pressure(kp_pressure, (2 * u32_node) + 1, u32_middle + 1, u32_high, u32_start, u32_end);
+
+	return kp_pressure->pi32_add[u32_node] + GVN_MAX(i32_left, i32_right);
+}
+
+static inline bool GVN_keys_equal(const GVN_key_t * kp_left, const GVN_key_t * kp_right)
+{
+	return kp_left->u8_opcode == kp_right->u8_opcode && kp_left->u8_type == kp_right->u8_type &&
+			kp_left->u8_variable_type == kp_right->u8_variable_type &&
+			kp_left->u32_left == kp_right->u32_left && kp_left->u32_right == kp_right->u32_right;
+}
+
+static inline uint32_t GVN_hash(const GVN_key_t * kp_key)
+{
+	uint64_t u64_hash = ((uint64_t)kp_key->u32_left << 32) | kp_key->u32_right;
+
+	u64_hash ^= ((uint64_t)kp_key->u8_opcode << 16) | ((uint64_t)kp_key->u8_type << 8) | kp_key->u8_variable_type;
+	u64_hash *= 0x9E3779B97F4A7C15ull;
+
+	return (uint32_t)(u64_hash >> 32);
+}
@@ -0,0 +1,33 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	Values that may be live at once before reusing one more is left alone. The caller-saved
+ *	registers the allocator hands out, so a reuse never costs a push or a spill
+ */
+#define GVN_DEFAULT_BUDGET				(7)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _GVN_report
+{
+	uint32_t	u32_num_reused;					// Instructions whose value an earlier one already had
+	uint32_t	u32_num_over_budget;			// Ones that could have been, but keeping it live would pass the budget
+} GVN_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			GVN_run							(IR_program_t * p_program, uint32_t u32_num_variables, uint32_t u32_budget, GVN_report_t * p_report);
+
+#endif
@@ -1,3 +1,5 @@
+#include <fcntl.h>
+#include <unistd.h>
 #include "io_handler.h"
 
 /****************************************************************************************************
@@ -119,7 +121,98 @@ STATUS_t IO_HANDLER_load_source_file(const char * kpc_fname)
 	return STATUS_OK;
 }
 
+/*
+ *	Loads source straight from memory, for callers (fuzzers, tests) that have no file on disk
+ *
+ *	The buffer is copied, so the caller keeps ownership of `kpc_buffer`
+ */
+STATUS_t IO_HANDLER_load_source_buffer(const char * kpc_buffer, uint32_t u32_size)
+{
+	if (kpc_buffer == NULL)
+	{
+		IO_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	free(io_source_info.pc_source_buffer);
+
+	strncpy(io_source_info.pc_source_file_name, "<buffer>", IO_MAX_REP_FILE_NAME_LENGTH);
+	io_source_info.pc_source_buffer = NULL;
+	io_source_info.u32_size = 0;
+
+	if (u32_size == 0)
+	{
+		IO_ERR("Empty buffer\n");
+		return STATUS_EMTPY_FILE;
+	}
+
+	io_source_info.pc_source_buffer = (char *)malloc(u32_size + 1);
+
+	if (io_source_info.pc_source_buffer == NULL)
+	{
+		IO_ERR("Memory error\n");
+		return STATUS_MEMORY_ERROR;
+	}
+
+	memcpy(io_source_info.pc_source_buffer, kpc_buffer, u32_size);
+	io_source_info.pc_source_buffer[u32_size] = '\0';
+	io_source_info.u32_size = u32_size;
+
+	IO_DBG("Buffer size: %u bytes\n", io_source_info.u32_size);
+
+	return STATUS_OK;
+}
+
 const IO_HANDLER_source_info_t * IO_HANDLER_get_source_info(void)
 {
 	return &(io_source_info);
 }
+
+/*
+ *	Writes `size` bytes out to `kpc_fname`, replacing it, with as few write calls as the OS allows
+ */
+STATUS_t IO_HANDLER_write_file(const char * kpc_fname, const void * kp_data, size_t size)
+{
+	const uint8_t * kpu8_data = kp_data;
+	size_t written = 0;
+	ssize_t result;
+	int fd;
+
+	if (kpc_fname == NULL || (kp_data == NULL && size > 0))
+	{
+		IO_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	fd = open(kpc_fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+	{
+		IO_ERR("Could not open %s\n", kpc_fname);
+		return STATUS_FILE_ERROR;
+	}
+
+	while (written < size)
+	{
+		result = write(fd, kpu8_data + written, size - written);
+
+		if (result <= 0)
+		{
+			IO_ERR("File error\n");
+			close(fd);
+			return STATUS_FILE_ERROR;
+		}
+
+		written += (size_t)result;
+	}
+
+	if (close(fd) != 0)
+	{
+		IO_ERR("File error\n");
+		return STATUS_FILE_ERROR;
+	}
+
+	IO_DBG("Wrote %zu bytes to %s\n", size, kpc_fname);
+
+	return STATUS_OK;
+}
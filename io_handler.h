@@ -28,7 +28,9 @@ typedef struct _IO_HANDLER_source_info
  ****************************************************************************************************/
 
 STATUS_t 							IO_HANDLER_load_source_file 	(const char * kpc_fname);
+STATUS_t 							IO_HANDLER_load_source_buffer	(const char * kpc_buffer, uint32_t u32_size);
 const IO_HANDLER_source_info_t * 	IO_HANDLER_get_source_info		(void);
+STATUS_t 							IO_HANDLER_write_file			(const char * kpc_fname, const void * kp_data, size_t size);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "ir.h"
+#include "io_handler.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_IR
+#define IR_DBG(fmt, ...)				printf(BOLD("IR:\t")fmt, ##__VA_ARGS__)
+#define IR_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("IR:\t"))fmt, ##__VA_ARGS__)
+#define IR_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("IR:\t"))fmt, ##__VA_ARGS__)
+#define IR_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("IR:\t"))fmt, ##__VA_ARGS__)
+#else
+#define IR_DBG(fmt, ...)
+#define IR_GREEN(fmt, ...)
+#define IR_WARN(fmt, ...)
+#define IR_ERR(fmt, ...)
+#endif
+
+#define IR_INITIAL_PROGRAM_SIZE			(64)
+
+/*
+ *	Longest line IR_format_program writes, less the variable name: "%4294967295 = const 4294967295\n"
+ */
+#define IR_MAX_LINE_LENGTH				(48)
+#define IR_MAX_NAME_LENGTH				(16)	// "const.u64"
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const char * const pk_opcode_names[IR_OPCODE_NUM_OPCODES] =
+{
+	[IR_OPCODE_CONST]	= "const",
+	[IR_OPCODE_LOAD]	= "load",
+	[IR_OPCODE_STORE]	= "store",
+	[IR_OPCODE_ADD]		= "add",
+	[IR_OPCODE_SUB]		= "sub",
+	[IR_OPCODE_MUL]		= "mul",
+	[IR_OPCODE_DIV]		= "div",
+	[IR_OPCODE_VLOAD]	= "vload",
+	[IR_OPCODE_VSPLAT]	= "vsplat",
+	[IR_OPCODE_VADD]	= "vadd",
+	[IR_OPCODE_VSUB]	= "vsub",
+	[IR_OPCODE_VSTORE]	= "vstore",
+};
+
+static const IR_opcode_t pk_binary_opcodes[PARSE_NODE_TYPE_NUM_TYPES] =
+{
+	[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= IR_OPCODE_ADD,
+	[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= IR_OPCODE_SUB,
+	[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= IR_OPCODE_MUL,
+	[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= IR_OPCODE_DIV,
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static uint32_t 	IR_label_tree					(PARSE_node_t * p_node);
+static void 		IR_lower_tree					(PARSE_node_t * p_node, IR_program_t * p_program, BUILTINS_type_t type);
+static uint32_t 	IR_lower_literal				(IR_program_t * p_program, BUILTINS_type_t type, uint64_t u64_literal);
+static inline bool 	IR_is_new_use					(const IR_instruction_t * kp_instruction, uint32_t u32_operand);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void IR_init_program(IR_program_t * p_program)
+{
+	p_program->u32_num_instructions = 0;
+	p_program->u32_num_values = 0;
+	p_program->u32_capacity = IR_INITIAL_PROGRAM_SIZE;
+	p_program->p_instructions = malloc(sizeof(IR_instruction_t) * p_program->u32_capacity);
+	ASSERT(p_program->p_instructions);
+}
+
+void IR_deinit_program(IR_program_t * p_program)
+{
+	free(p_program->p_instructions);
+	p_program->p_instructions = NULL;
+	p_program->u32_num_instructions = 0;
+	p_program->u32_capacity = 0;
+	p_program->u32_num_values = 0;
+}
+
+/*
+ *	Appends an instruction, and returns the value it defines: a fresh one for everything but a store
+ */
+uint32_t IR_emit(IR_program_t * p_program, IR_opcode_t opcode, uint32_t u32_left, uint32_t u32_right, uint32_t u32_immediate)
+{
+	IR_instruction_t * p_instruction;
+
+	if (p_program->u32_num_instructions == p_program->u32_capacity)
+	{
+		p_program->u32_capacity *= 2;
+		p_program->p_instructions = realloc(p_program->p_instructions, sizeof(IR_instruction_t) * p_program->u32_capacity);
+		ASSERT(p_program->p_instructions);
+	}
+
+	p_instruction = &p_program->p_instructions[p_program->u32_num_instructions++];
+	p_instruction->u8_opcode = (uint8_t)opcode;
+	p_instruction->u8_type = BUILTINS_TYPE_U32;
+	p_instruction->u8_variable_type = BUILTINS_TYPE_U32;
+	p_instruction->u32_result = (opcode == IR_OPCODE_STORE || opcode == IR_OPCODE_VSTORE) ? IR_VALUE_NONE : p_program->u32_num_values++;
+	p_instruction->pu32_operands[0] = u32_left;
+	p_instruction->pu32_operands[1] = u32_right;
+	p_instruction->u32_immediate = u32_immediate;
+
+	return p_instruction->u32_result;
+}
+
+/*
+ *	Lowers every statement, in source order. Statements the parser left incomplete are skipped
+ */
+void IR_lower(const PARSE_tree_list_t * kp_tree_list, IR_program_t * p_program)
+{
+	uint32_t u32_first;
+	BUILTINS_type_t type;
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		if (!IR_tree_is_valid(kp_tree_list->trees[i]))
+		{
+			IR_ERR("Skipping malformed statement\n");
+			continue;
+		}
+
+		IR_label_tree(kp_tree_list->trees[i]);
+
+		type = IR_get_statement_type(kp_tree_list->trees[i]);
+		type = (type == BUILTINS_TYPE_NUM_TYPES) ? BUILTINS_TYPE_U32 : type;
+
+		// Bare expression statements are evaluated and thrown away
+		u32_first = p_program->u32_num_instructions;
+		IR_lower_tree(kp_tree_list->trees[i], p_program, type);
+
+		for (uint32_t j = u32_first; j < p_program->u32_num_instructions; j++)
+		{
+			p_program->p_instructions[j].u8_type = (uint8_t)type;
+		}
+	}
+
+	IR_DBG("Lowered %u statements to %u instructions\n", kp_tree_list->u32_num_trees, p_program->u32_num_instructions);
+}
+
+/*
+ *	Checks a tree has the shape lowering expects. The parser leaves
+ *	missing operands as NULL children rather than failing
+ */
+bool IR_tree_is_valid(const PARSE_node_t * kp_node)
+{
+	if (kp_node == NULL || kp_node->p_token == NULL)
+	{
+		return false;
+	}
+
+	switch (kp_node->type)
+	{
+		case PARSE_NODE_TYPE_ID:
+		{
+			return kp_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL || kp_node->p_token->type == LEX_TOKEN_TYPE_IDENTIFIER;
+		}
+		case PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT:
+		{
+			return kp_node->p_left != NULL &&
+					kp_node->p_left->type == PARSE_NODE_TYPE_ID &&
+					kp_node->p_left->p_token->type == LEX_TOKEN_TYPE_IDENTIFIER &&
+					IR_tree_is_valid(kp_node->p_right);
+		}
+		case PARSE_NODE_TYPE_EXPR_TYPE_ADD:
+		case PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT:
+		case PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY:
+		case PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE:
+		{
+			return IR_tree_is_valid(kp_node->p_left) && IR_tree_is_valid(kp_node->p_right);
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+/*
+ *	Integer literals are read in 64 bits, so anything bigger wraps. A 32-bit statement only
+ *	keeps the low half
+ */
+uint64_t IR_literal_value(const char * kpc_lexeme)
+{
+	uint64_t u64_value = 0;
+
+	while (*kpc_lexeme)
+	{
+		u64_value = (u64_value * 10) + (uint64_t)(*kpc_lexeme++ - '0');
+	}
+
+	return u64_value;
+}
+
+/*
+ *	Every variable a statement reads or writes, combined. Literals take whatever type the
+ *	variables around them have, so only a statement with no variables at all is left with none,
+ *	BUILTINS_TYPE_NUM_TYPES
+ */
+BUILTINS_type_t IR_get_statement_type(const PARSE_node_t * kp_node)
+{
+	BUILTINS_type_t left;
+	BUILTINS_type_t right;
+
+	if (kp_node->type == PARSE_NODE_TYPE_ID)
+	{
+		if (kp_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+		{
+			return BUILTINS_TYPE_NUM_TYPES;
+		}
+
+		return BUILTINS_promote(SYMBOL_TABLE_get_symbol_table()[SYMBOL_TABLE_lookup(kp_node->p_token->pc_lexeme)].builtin_type);
+	}
+
+	left = IR_get_statement_type(kp_node->p_left);
+	right = IR_get_statement_type(kp_node->p_right);
+
+	if (left == BUILTINS_TYPE_NUM_TYPES || right == BUILTINS_TYPE_NUM_TYPES)
+	{
+		return (left == BUILTINS_TYPE_NUM_TYPES) ? right : left;
+	}
+
+	return BUILTINS_combine(left, right);
+}
+
+/*
+ *	Checks the program is in SSA form: every value defined once, before any use
+ */
+bool IR_verify(const IR_program_t * kp_program)
+{
+	bool * pb_defined = calloc(kp_program->u32_num_values + 1, sizeof(bool));
+	const IR_instruction_t * kp_instruction;
+	bool b_valid = true;
+
+	ASSERT(pb_defined);
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions && b_valid; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (kp_instruction->pu32_operands[j] != IR_VALUE_NONE &&
+				(kp_instruction->pu32_operands[j] >= kp_program->u32_num_values || !pb_defined[kp_instruction->pu32_operands[j]]))
+			{
+				IR_ERR("Instruction %u uses %%%u before its definition\n", i, kp_instruction->pu32_operands[j]);
+				b_valid = false;
+			}
+		}
+
+		if (kp_instruction->u32_result != IR_VALUE_NONE)
+		{
+			if (kp_instruction->u32_result >= kp_program->u32_num_values || pb_defined[kp_instruction->u32_result])
+			{
+				IR_ERR("Instruction %u redefines %%%u\n", i, kp_instruction->u32_result);
+				b_valid = false;
+			}
+			else
+			{
+				pb_defined[kp_instruction->u32_result] = true;
+			}
+		}
+	}
+
+	free(pb_defined);
+
+	return b_valid;
+}
+
+/*
+ *	Builds def-use chains in two passes: count the uses of every value, then place them
+ */
+void IR_build_def_use(const IR_program_t * kp_program, IR_def_use_t * p_def_use)
+{
+	const IR_instruction_t * kp_instruction;
+	uint32_t u32_num_values = kp_program->u32_num_values;
+	uint32_t * pu32_next;
+
+	p_def_use->u32_num_values = u32_num_values;
+	p_def_use->pu32_def = malloc(sizeof(uint32_t) * (u32_num_values + 1));
+	p_def_use->pu32_use_start = calloc(u32_num_values + 2, sizeof(uint32_t));
+	ASSERT(p_def_use->pu32_def && p_def_use->pu32_use_start);
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		if (kp_instruction->u32_result != IR_VALUE_NONE)
+		{
+			p_def_use->pu32_def[kp_instruction->u32_result] = i;
+		}
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (IR_is_new_use(kp_instruction, j))
+			{
+				p_def_use->pu32_use_start[kp_instruction->pu32_operands[j] + 1]++;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < u32_num_values; i++)
+	{
+		p_def_use->pu32_use_start[i + 1] += p_def_use->pu32_use_start[i];
+	}
+
+	p_def_use->pu32_uses = malloc(sizeof(uint32_t) * (p_def_use->pu32_use_start[u32_num_values] + 1));
+	pu32_next = malloc(sizeof(uint32_t) * (u32_num_values + 1));
+	ASSERT(p_def_use->pu32_uses && pu32_next);
+	memcpy(pu32_next, p_def_use->pu32_use_start, sizeof(uint32_t) * u32_num_values);
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (IR_is_new_use(kp_instruction, j))
+			{
+				p_def_use->pu32_uses[pu32_next[kp_instruction->pu32_operands[j]]++] = i;
+			}
+		}
+	}
+
+	free(pu32_next);
+}
+
+void IR_deinit_def_use(IR_def_use_t * p_def_use)
+{
+	free(p_def_use->pu32_def);
+	free(p_def_use->pu32_use_start);
+	free(p_def_use->pu32_uses);
+	p_def_use->pu32_def = NULL;
+	p_def_use->pu32_use_start = NULL;
+	p_def_use->pu32_uses = NULL;
+	p_def_use->u32_num_values = 0;
+}
+
+uint32_t IR_get_num_uses(const IR_def_use_t * kp_def_use, uint32_t u32_value)
+{
+	ASSERT(u32_value < kp_def_use->u32_num_values);
+	return kp_def_use->pu32_use_start[u32_value + 1] - kp_def_use->pu32_use_start[u32_value];
+}
+
+/*
+ *	Renders the program one instruction per line, e.g. "%2 = add %0, %1". Statements computed in
+ *	anything but u32 have it after the opcode, e.g. "%2 = div.i64 %0, %1". The caller frees the text
+ */
+char * IR_format_program(const IR_program_t * kp_program, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	const IR_instruction_t * kp_instruction;
+	char pc_name[IR_MAX_NAME_LENGTH];
+	size_t capacity = ((size_t)kp_program->u32_num_instructions * (IR_MAX_LINE_LENGTH + LEX_MAX_LEXEME_SIZE)) + 1;
+	char * pc_text = malloc(capacity);
+	size_t size = 0;
+
+	ASSERT(pc_text);
+	pc_text[0] = '\0';
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+		snprintf(pc_name, sizeof(pc_name), (kp_instruction->u8_type == BUILTINS_TYPE_U32) ? "%s" : "%s.%s",
+			pk_opcode_names[kp_instruction->u8_opcode], BUILTINS_get_name(kp_instruction->u8_type));
+
+		switch (kp_instruction->u8_opcode)
+		{
+			case IR_OPCODE_CONST:
+			case IR_OPCODE_VSPLAT:
+			{
+				size += (size_t)sprintf(pc_text + size, "%%%u = %s %u\n", kp_instruction->u32_result, pc_name, kp_instruction->u32_immediate);
+				break;
+			}
+			case IR_OPCODE_LOAD:
+			case IR_OPCODE_VLOAD:
+			{
+				size += (size_t)sprintf(pc_text + size, "%%%u = %s %s\n", kp_instruction->u32_result, pc_name,
+					kp_symbols[kp_instruction->u32_immediate].p_token->pc_lexeme);
+				break;
+			}
+			case IR_OPCODE_STORE:
+			case IR_OPCODE_VSTORE:
+			{
+				size += (size_t)sprintf(pc_text + size, "%s %s, %%%u\n", pc_name,
+					kp_symbols[kp_instruction->u32_immediate].p_token->pc_lexeme, kp_instruction->pu32_operands[0]);
+				break;
+			}
+			default:
+			{
+				size += (size_t)sprintf(pc_text + size, "%%%u = %s %%%u, %%%u\n", kp_instruction->u32_result, pc_name,
+					kp_instruction->pu32_operands[0], kp_instruction->pu32_operands[1]);
+				break;
+			}
+		}
+	}
+
+	ASSERT(size < capacity);
+	*p_size = size;
+
+	return pc_text;
+}
+
+/*
+ *	Writes the program out as text, for inspection
+ */
+STATUS_t IR_write_program(const IR_program_t * kp_program, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_text;
+
+	pc_text = IR_format_program(kp_program, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_text, size);
+	free(pc_text);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Sethi-Ullman labeling. Every leaf is loaded into a register of its own, so needs one. An
+ *	operator needs one more than its operands only when they tie: otherwise the heavier side is
+ *	evaluated first and its result held while the lighter side reuses the rest
+ */
+static uint32_t IR_label_tree(PARSE_node_t * p_node)
+{
+	uint32_t u32_left;
+	uint32_t u32_right;
+
+	if (p_node->type == PARSE_NODE_TYPE_ID)
+	{
+		p_node->u32_num_registers = 1;
+	}
+	else if (p_node->type == PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT)
+	{
+		p_node->u32_num_registers = IR_label_tree(p_node->p_right);
+	}
+	else
+	{
+		u32_left = IR_label_tree(p_node->p_left);
+		u32_right = IR_label_tree(p_node->p_right);
+
+		if (u32_left == u32_right)
+		{
+			p_node->u32_num_registers = u32_left + 1;
+		}
+		else
+		{
+			p_node->u32_num_registers = (u32_left > u32_right) ? u32_left : u32_right;
+		}
+	}
+
+	return p_node->u32_num_registers;
+}
+
+/*
+ *	Lowers a subtree in postorder, leaving its value in p_node->u32_value. Of two operands, the one
+ *	needing more registers goes first, so the other is not held live across it. Operands keep their
+ *	places in the instruction, so the order never changes what subtract and divide compute
+ */
+static void IR_lower_tree(PARSE_node_t * p_node, IR_program_t * p_program, BUILTINS_type_t type)
+{
+	switch (p_node->type)
+	{
+		case PARSE_NODE_TYPE_ID:
+		{
+			if (p_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+			{
+				p_node->u32_value = IR_lower_literal(p_program, type, IR_literal_value(p_node->p_token->pc_lexeme));
+			}
+			else
+			{
+				p_node->u32_value = IR_emit(p_program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, SYMBOL_TABLE_lookup(p_node->p_token->pc_lexeme));
+				p_program->p_instructions[p_program->u32_num_instructions - 1].u8_variable_type =
+					(uint8_t)SYMBOL_TABLE_get_symbol_table()[SYMBOL_TABLE_lookup(p_node->p_token->pc_lexeme)].builtin_type;
+			}
+			break;
+		}
+		case PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT:
+		{
+			// The target of an assignment is stored to, never loaded. Its value is what was assigned
+			IR_lower_tree(p_node->p_right, p_program, type);
+			IR_emit(p_program, IR_OPCODE_STORE, p_node->p_right->u32_value, IR_VALUE_NONE, SYMBOL_TABLE_lookup(p_node->p_left->p_token->pc_lexeme));
+			p_program->p_instructions[p_program->u32_num_instructions - 1].u8_variable_type =
+				(uint8_t)SYMBOL_TABLE_get_symbol_table()[SYMBOL_TABLE_lookup(p_node->p_left->p_token->pc_lexeme)].builtin_type;
+			p_node->u32_value = p_node->p_right->u32_value;
+			break;
+		}
+		case PARSE_NODE_TYPE_EXPR_TYPE_ADD:
+		case PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT:
+		case PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY:
+		case PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE:
+		{
+			if (p_node->p_right->u32_num_registers > p_node->p_left->u32_num_registers)
+			{
+				IR_lower_tree(p_node->p_right, p_program, type);
+				IR_lower_tree(p_node->p_left, p_program, type);
+			}
+			else
+			{
+				IR_lower_tree(p_node->p_left, p_program, type);
+				IR_lower_tree(p_node->p_right, p_program, type);
+			}
+
+			p_node->u32_value = IR_emit(p_program, pk_binary_opcodes[p_node->type], p_node->p_left->u32_value, p_node->p_right->u32_value, 0);
+			break;
+		}
+		default:
+		{
+			ASSERT(0);
+		}
+	}
+}
+
+/*
+ *	Immediates are u32, zero extended in a 64-bit statement. A literal past that is built from
+ *	its halves as high * 65536 * 65536 + low, which folding keeps as it is since it doesn't fit
+ *	an immediate either, and the multiplies by a power of two become shifts
+ */
+static uint32_t IR_lower_literal(IR_program_t * p_program, BUILTINS_type_t type, uint64_t u64_literal)
+{
+	uint32_t u32_shift;
+	uint32_t u32_value;
+
+	if (BUILTINS_get_size(type) != sizeof(uint64_t) || u64_literal <= UINT32_MAX)
+	{
+		return IR_emit(p_program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, (uint32_t)u64_literal);
+	}
+
+	u32_shift = IR_emit(p_program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 65536);
+	u32_value = IR_emit(p_program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, (uint32_t)(u64_literal >> 32));
+	u32_value = IR_emit(p_program, IR_OPCODE_MUL, u32_value, u32_shift, 0);
+	u32_value = IR_emit(p_program, IR_OPCODE_MUL, u32_value, u32_shift, 0);
+
+	return IR_emit(p_program, IR_OPCODE_ADD, u32_value, IR_emit(p_program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, (uint32_t)u64_literal), 0);
+}
+
+/*
+ *	x + x uses x twice from the same instruction; the chains list that instruction once
+ */
+static inline bool IR_is_new_use(const IR_instruction_t * kp_instruction, uint32_t u32_operand)
+{
+	return kp_instruction->pu32_operands[u32_operand] != IR_VALUE_NONE &&
+			!(u32_operand == 1 && kp_instruction->pu32_operands[1] == kp_instruction->pu32_operands[0]);
+}
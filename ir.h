@@ -0,0 +1,97 @@
+#ifndef IR_H
+#define IR_H
+
+#include "common.h"
+#include "status.h"
+#include "parse.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define IR_VALUE_NONE					(UINT32_MAX)
+#define IR_MAX_OPERANDS					(2)
+
+/*
+ *	Vector instructions work on this many u32 variables, consecutive in the symbol table and in storage
+ */
+#define IR_VECTOR_LANES					(4)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef enum
+{
+	IR_OPCODE_CONST = 0,		// result = immediate
+	IR_OPCODE_LOAD,				// result = variable[immediate]
+	IR_OPCODE_STORE,			// variable[immediate] = operand 0, no result
+	IR_OPCODE_ADD,
+	IR_OPCODE_SUB,
+	IR_OPCODE_MUL,
+	IR_OPCODE_DIV,				// Signed or not, as the instruction's type is
+	IR_OPCODE_VLOAD,			// result = variables[immediate ..] as IR_VECTOR_LANES u32 lanes
+	IR_OPCODE_VSPLAT,			// result = immediate in every lane
+	IR_OPCODE_VADD,				// Lane by lane, on vector operands
+	IR_OPCODE_VSUB,
+	IR_OPCODE_VSTORE,			// variables[immediate ..] = operand 0, lane by lane, no result
+	//////////////////////////////
+	IR_OPCODE_NUM_OPCODES
+} IR_opcode_t;
+
+/*
+ *	Three-address instruction in SSA form: every value is the result of exactly one instruction,
+ *	which comes before all of its uses. Code is straight-line, so no phis are needed.
+ *	A statement is computed in one type, u32, i32, u64 or i64, that all of its variables fit in:
+ *	loads extend to it, and stores truncate from it
+ */
+typedef struct _IR_instruction
+{
+	uint8_t		u8_opcode;							// IR_opcode_t
+	uint8_t		u8_type;							// BUILTINS_type_t the statement is computed in
+	uint8_t		u8_variable_type;					// BUILTINS_type_t of the variable loaded or stored
+	uint32_t	u32_result;							// Value defined, or IR_VALUE_NONE
+	uint32_t	pu32_operands[IR_MAX_OPERANDS];		// Values used, or IR_VALUE_NONE
+	uint32_t	u32_immediate;						// Constant, or symbol table index for loads and stores
+} IR_instruction_t;
+
+typedef struct _IR_program
+{
+	IR_instruction_t *	p_instructions;
+	uint32_t			u32_num_instructions;
+	uint32_t			u32_capacity;
+	uint32_t			u32_num_values;
+} IR_program_t;
+
+/*
+ *	Def-use chains. The uses of value v are instruction indices
+ *	pu32_uses[pu32_use_start[v]] up to pu32_uses[pu32_use_start[v + 1]], in program order
+ */
+typedef struct _IR_def_use
+{
+	uint32_t *	pu32_def;							// Index of the defining instruction, per value
+	uint32_t *	pu32_use_start;						// u32_num_values + 1 entries
+	uint32_t *	pu32_uses;
+	uint32_t	u32_num_values;
+} IR_def_use_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			IR_init_program					(IR_program_t * p_program);
+void 			IR_deinit_program				(IR_program_t * p_program);
+uint32_t 		IR_emit							(IR_program_t * p_program, IR_opcode_t opcode, uint32_t u32_left, uint32_t u32_right, uint32_t u32_immediate);
+void 			IR_lower						(const PARSE_tree_list_t * kp_tree_list, IR_program_t * p_program);
+bool 			IR_tree_is_valid				(const PARSE_node_t * kp_node);
+uint64_t 		IR_literal_value				(const char * kpc_lexeme);
+BUILTINS_type_t IR_get_statement_type			(const PARSE_node_t * kp_node);
+bool 			IR_verify						(const IR_program_t * kp_program);
+void 			IR_build_def_use				(const IR_program_t * kp_program, IR_def_use_t * p_def_use);
+void 			IR_deinit_def_use				(IR_def_use_t * p_def_use);
+uint32_t 		IR_get_num_uses					(const IR_def_use_t * kp_def_use, uint32_t u32_value);
+char * 			IR_format_program				(const IR_program_t * kp_program, size_t * p_size);
+STATUS_t 		IR_write_program				(const IR_program_t * kp_program, const char * kpc_fname);
+
+#endif
@@ -0,0 +1,103 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include "jit.h"
+#include "encoder.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_JIT
+#define JIT_DBG(fmt, ...)				printf(BOLD("JIT:\t")fmt, ##__VA_ARGS__)
+#define JIT_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("JIT:\t"))fmt, ##__VA_ARGS__)
+#define JIT_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("JIT:\t"))fmt, ##__VA_ARGS__)
+#define JIT_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("JIT:\t"))fmt, ##__VA_ARGS__)
+#else
+#define JIT_DBG(fmt, ...)
+#define JIT_GREEN(fmt, ...)
+#define JIT_WARN(fmt, ...)
+#define JIT_ERR(fmt, ...)
+#endif
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Encodes the program into a fresh mapping and seals it read + execute
+ */
+STATUS_t JIT_compile(const ASM_buffer_t * kp_buffer, JIT_program_t * p_program)
+{
+	ENCODER_code_t code;
+	STATUS_t status;
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+	if (kp_buffer == NULL || p_program == NULL)
+	{
+		JIT_ERR("NULL input\n");
+		return STATUS_FAILED;
+	}
+
+	p_program->p_memory = NULL;
+	p_program->size = 0;
+	p_program->entry = NULL;
+
+	ENCODER_init_code(&code);
+	status = ENCODER_encode_program(kp_buffer, &code);
+
+	if (status != STATUS_OK)
+	{
+		ENCODER_deinit_code(&code);
+		return status;
+	}
+
+	p_program->size = ((size_t)code.u32_size + page_size - 1) & ~(page_size - 1);
+	p_program->p_memory = mmap(NULL, p_program->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (p_program->p_memory == MAP_FAILED)
+	{
+		JIT_ERR("Could not map %zu bytes\n", p_program->size);
+		p_program->p_memory = NULL;
+		p_program->size = 0;
+		ENCODER_deinit_code(&code);
+		return STATUS_MEMORY_ERROR;
+	}
+
+	memcpy(p_program->p_memory, code.pu8_bytes, code.u32_size);
+	ENCODER_deinit_code(&code);
+
+	// W^X: drop write before allowing execute
+	if (mprotect(p_program->p_memory, p_program->size, PROT_READ | PROT_EXEC) != 0)
+	{
+		JIT_ERR("Could not make code executable\n");
+		JIT_release(p_program);
+		return STATUS_MEMORY_ERROR;
+	}
+
+	p_program->entry = (JIT_entry_t)p_program->p_memory;
+
+	JIT_DBG("Mapped %zu bytes of code\n", p_program->size);
+
+	return STATUS_OK;
+}
+
+/*
+ *	Runs rep_main over `p_variables`, which must hold the symbol table's storage size in bytes, 8-byte aligned
+ */
+void JIT_run(const JIT_program_t * kp_program, uint32_t * p_variables)
+{
+	ASSERT(kp_program->entry);
+	kp_program->entry(p_variables);
+}
+
+void JIT_release(JIT_program_t * p_program)
+{
+	if (p_program->p_memory != NULL)
+	{
+		munmap(p_program->p_memory, p_program->size);
+	}
+
+	p_program->p_memory = NULL;
+	p_program->size = 0;
+	p_program->entry = NULL;
+}
@@ -0,0 +1,33 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "common.h"
+#include "status.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef void (*JIT_entry_t)(uint32_t * p_variables);
+
+/*
+ *	rep_main, encoded into its own mapping. The mapping is writable while the code is copied in
+ *	and executable afterwards, never both at once
+ */
+typedef struct _JIT_program
+{
+	void *			p_memory;
+	size_t			size;
+	JIT_entry_t		entry;
+} JIT_program_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+STATUS_t 		JIT_compile						(const ASM_buffer_t * kp_buffer, JIT_program_t * p_program);
+void 			JIT_run							(const JIT_program_t * kp_program, uint32_t * p_variables);
+void 			JIT_release						(JIT_program_t * p_program);
+
+#endif
@@ -0,0 +1,644 @@
+#include "layout.h"
+#include "symbol_table.h"
+#include "io_handler.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_LAYOUT
+#define LAYOUT_DBG(fmt, ...)			printf(BOLD("LAYOUT:\t")fmt, ##__VA_ARGS__)
+#define LAYOUT_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("LAYOUT:\t"))fmt, ##__VA_ARGS__)
+#define LAYOUT_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("LAYOUT:\t"))fmt, ##__VA_ARGS__)
+#define LAYOUT_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("LAYOUT:\t"))fmt, ##__VA_ARGS__)
+#else
+#define LAYOUT_DBG(fmt, ...)
+#define LAYOUT_GREEN(fmt, ...)
+#define LAYOUT_WARN(fmt, ...)
+#define LAYOUT_ERR(fmt, ...)
+#endif
+
+#define LAYOUT_NONE						(UINT32_MAX)
+#define LAYOUT_ALIGN(value, align)		(((value) + (align) - 1) & ~((align) - 1))
+
+/*
+ *	Share of all accesses the hot lines in the report hold between them
+ */
+#define LAYOUT_HOT_PERCENT				(90)
+
+/*
+ *	Blocks one statement can tie to each other. A statement naming more than this is rare, and
+ *	every pair of them would be quadratic in it
+ */
+#define LAYOUT_MAX_STATEMENT_BLOCKS		(16)
+
+/*
+ *	Gaps alignment left behind that smaller variables can still fill
+ */
+#define LAYOUT_MAX_HOLES				(64)
+
+#define LAYOUT_MAX_MAP_LINE				(96)
+
+#define LAYOUT_VECTOR_SIZE				(IR_VECTOR_LANES * sizeof(uint32_t))
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Placed as one: a variable, or consecutive u32s a vector instruction loads or stores together,
+ *	which have to stay consecutive and in order
+ */
+typedef struct
+{
+	uint32_t	u32_first;				// Variables [u32_first, u32_first + u32_count)
+	uint32_t	u32_count;
+	uint32_t	u32_size;
+	uint32_t	u32_align;
+	uint32_t	u32_accesses;
+} LAYOUT_block_t;
+
+typedef struct
+{
+	uint32_t	u32_to;
+	uint32_t	u32_weight;				// Statements that access both
+} LAYOUT_edge_t;
+
+typedef struct
+{
+	uint32_t	u32_offset;
+	uint32_t	u32_size;
+} LAYOUT_hole_t;
+
+typedef struct
+{
+	uint32_t				u32_num_variables;
+	uint32_t *				pu32_accesses;			// Per variable, loads and stores of it
+	bool *					pb_joined;				// Per variable, whether it has to follow the one before it
+	uint32_t *				pu32_block_of;			// Per variable
+	LAYOUT_block_t *		p_blocks;
+	uint32_t				u32_num_blocks;
+	uint32_t *				pu32_edge_starts;		// Per block, its first edge
+	LAYOUT_edge_t *			p_edges;
+} LAYOUT_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		LAYOUT_count_accesses			(const IR_program_t * kp_program, uint32_t * pu32_accesses, bool * pb_joined);
+static void 		LAYOUT_find_blocks				(LAYOUT_info_t * p_info);
+static void 		LAYOUT_build_affinity			(LAYOUT_info_t * p_info, const IR_program_t * kp_program);
+static void 		LAYOUT_order					(const LAYOUT_info_t * kp_info, uint32_t * pu32_order);
+static uint32_t 	LAYOUT_place					(const LAYOUT_info_t * kp_info, const uint32_t * kpu32_order, uint32_t * pu32_offsets);
+static uint32_t 	LAYOUT_count_hot_lines			(const uint32_t * kpu32_accesses, const uint32_t * kpu32_offsets, uint32_t u32_num_variables,
+														uint32_t u32_storage_size);
+static int 			LAYOUT_compare_keys				(const void * kp_left, const void * kp_right);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Gives every variable its offset in storage again, hottest first. Variables the same statements
+ *	access are packed into the same cache line where they fit, so a statement touches as few lines
+ *	as it can; when nothing left has anything in common with the line being filled, the hottest of
+ *	what's left starts it. Each variable is aligned to its size, vector runs to a whole vector so
+ *	they never straddle a line, and smaller variables fill the gaps alignment leaves
+ */
+void LAYOUT_run(const IR_program_t * kp_program, uint32_t u32_num_variables, LAYOUT_report_t * p_report)
+{
+	LAYOUT_info_t info = { .u32_num_variables = u32_num_variables };
+	uint32_t * pu32_order;
+	uint32_t * pu32_offsets_before;
+	uint32_t * pu32_offsets;
+	uint32_t u32_storage_size;
+
+	memset(p_report, 0, sizeof(LAYOUT_report_t));
+
+	if (u32_num_variables == 0)
+	{
+		return;
+	}
+
+	info.pu32_accesses = calloc(u32_num_variables + 1, sizeof(uint32_t));
+	info.pb_joined = calloc(u32_num_variables + 1, sizeof(bool));
+	info.pu32_block_of = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	info.p_blocks = malloc(sizeof(LAYOUT_block_t) * (u32_num_variables + 1));
+	pu32_order = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	pu32_offsets_before = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	pu32_offsets = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	ASSERT(info.pu32_accesses && info.pb_joined && info.pu32_block_of && info.p_blocks && pu32_order && pu32_offsets_before && pu32_offsets);
+
+	LAYOUT_count_accesses(kp_program, info.pu32_accesses, info.pb_joined);
+	LAYOUT_find_blocks(&info);
+	LAYOUT_build_affinity(&info, kp_program);
+	LAYOUT_order(&info, pu32_order);
+	u32_storage_size = LAYOUT_place(&info, pu32_order, pu32_offsets);
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		pu32_offsets_before[i] = SYMBOL_TABLE_get_offset(i);
+		p_report->u32_num_moved += (pu32_offsets[i] != pu32_offsets_before[i]) ? 1 : 0;
+	}
+
+	p_report->u32_num_blocks = info.u32_num_blocks;
+	p_report->u32_num_lines = (u32_storage_size + LAYOUT_CACHE_LINE_SIZE - 1) / LAYOUT_CACHE_LINE_SIZE;
+	p_report->u32_hot_lines_before = LAYOUT_count_hot_lines(info.pu32_accesses, pu32_offsets_before, u32_num_variables, SYMBOL_TABLE_get_storage_size());
+	p_report->u32_hot_lines_after = LAYOUT_count_hot_lines(info.pu32_accesses, pu32_offsets, u32_num_variables, u32_storage_size);
+
+	SYMBOL_TABLE_set_layout(pu32_offsets, u32_storage_size);
+
+	LAYOUT_DBG("Moved %u of %u variables in %u blocks, %u bytes over %u lines, hot lines %u down to %u\n", p_report->u32_num_moved,
+		u32_num_variables, info.u32_num_blocks, u32_storage_size, p_report->u32_num_lines, p_report->u32_hot_lines_before,
+		p_report->u32_hot_lines_after);
+
+	free(info.pu32_accesses);
+	free(info.pb_joined);
+	free(info.pu32_block_of);
+	free(info.p_blocks);
+	free(info.pu32_edge_starts);
+	free(info.p_edges);
+	free(pu32_order);
+	free(pu32_offsets_before);
+	free(pu32_offsets);
+}
+
+/*
+ *	The storage map as text: a line per variable, by offset, with the cache line it's in and how
+ *	often the program accesses it. The caller frees the result
+ */
+char * LAYOUT_format_map(const IR_program_t * kp_program, uint32_t u32_num_variables, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint32_t * pu32_accesses = calloc(u32_num_variables + 1, sizeof(uint32_t));
+	uint64_t * pu64_keys = malloc(sizeof(uint64_t) * (u32_num_variables + 1));
+	size_t capacity = ((size_t)(u32_num_variables + 2) * (LAYOUT_MAX_MAP_LINE + LEX_MAX_LEXEME_SIZE)) + 1;
+	char * pc_text = malloc(capacity);
+	uint32_t u32_storage_size = SYMBOL_TABLE_get_storage_size();
+	uint32_t u32_variable;
+	uint32_t u32_offset;
+	size_t size = 0;
+
+	ASSERT(pu32_accesses && pu64_keys && pc_text);
+
+	LAYOUT_count_accesses(kp_program, pu32_accesses, NULL);
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		pu64_keys[i] = ((uint64_t)SYMBOL_TABLE_get_offset(i) << 32) | i;
+	}
+	qsort(pu64_keys, u32_num_variables, sizeof(uint64_t), LAYOUT_compare_keys);
+
+	size += (size_t)sprintf(pc_text + size, "# %u variables in %u bytes, %u cache lines of %u bytes\n", u32_num_variables, u32_storage_size,
+		(u32_storage_size + LAYOUT_CACHE_LINE_SIZE - 1) / LAYOUT_CACHE_LINE_SIZE, LAYOUT_CACHE_LINE_SIZE);
+	size += (size_t)sprintf(pc_text + size, "# %-8s %6s %5s %10s  %-4s %s\n", "offset", "line", "size", "accesses", "type", "name");
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		u32_variable = (uint32_t)pu64_keys[i];
+		u32_offset = (uint32_t)(pu64_keys[i] >> 32);
+		size += (size_t)sprintf(pc_text + size, "0x%08x %6u %5u %10u  %-4s %s\n", u32_offset, u32_offset / LAYOUT_CACHE_LINE_SIZE,
+			BUILTINS_get_size(kp_symbols[u32_variable].builtin_type), pu32_accesses[u32_variable],
+			BUILTINS_get_name(kp_symbols[u32_variable].builtin_type), kp_symbols[u32_variable].p_token->pc_lexeme);
+	}
+
+	ASSERT(size < capacity);
+	*p_size = size;
+
+	free(pu32_accesses);
+	free(pu64_keys);
+
+	return pc_text;
+}
+
+/*
+ *	Writes the storage map out, for inspection
+ */
+STATUS_t LAYOUT_write_map(const IR_program_t * kp_program, uint32_t u32_num_variables, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_text;
+
+	pc_text = LAYOUT_format_map(kp_program, u32_num_variables, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_text, size);
+	free(pc_text);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Loads and stores of each variable; a vector access counts for every lane. Lanes after the first
+ *	are marked as having to follow the one before, when `pb_joined` is given
+ */
+static void LAYOUT_count_accesses(const IR_program_t * kp_program, uint32_t * pu32_accesses, bool * pb_joined)
+{
+	const IR_instruction_t * kp_instruction;
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		switch (kp_instruction->u8_opcode)
+		{
+			case IR_OPCODE_LOAD:
+			case IR_OPCODE_STORE:
+			{
+				pu32_accesses[kp_instruction->u32_immediate]++;
+				break;
+			}
+			case IR_OPCODE_VLOAD:
+			case IR_OPCODE_VSTORE:
+			{
+				for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+				{
+					pu32_accesses[kp_instruction->u32_immediate + j]++;
+
+					if (pb_joined != NULL && j > 0)
+					{
+						pb_joined[kp_instruction->u32_immediate + j] = true;
+					}
+				}
+				break;
+			}
+			default:
+			{
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *	Runs of joined variables become one block, anything else a block of its own
+ */
+static void LAYOUT_find_blocks(LAYOUT_info_t * p_info)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	LAYOUT_block_t * p_block = NULL;
+	uint32_t u32_size;
+
+	p_info->u32_num_blocks = 0;
+
+	for (uint32_t i = 0; i < p_info->u32_num_variables; i++)
+	{
+		u32_size = BUILTINS_get_size(kp_symbols[i].builtin_type);
+
+		if (!p_info->pb_joined[i] || p_block == NULL)
+		{
+			p_block = &p_info->p_blocks[p_info->u32_num_blocks++];
+			p_block->u32_first = i;
+			p_block->u32_count = 0;
+			p_block->u32_size = 0;
+			p_block->u32_align = u32_size;
+			p_block->u32_accesses = 0;
+		}
+
+		// Only u32s are ever joined, so lanes stay aligned without padding between them
+		p_block->u32_count++;
+		p_block->u32_size += u32_size;
+		p_block->u32_accesses += p_info->pu32_accesses[i];
+
+		if (p_block->u32_size >= LAYOUT_VECTOR_SIZE)
+		{
+			p_block->u32_align = LAYOUT_VECTOR_SIZE;
+		}
+
+		p_info->pu32_block_of[i] = p_info->u32_num_blocks - 1;
+	}
+}
+
+/*
+ *	An edge between every two blocks one statement accesses, weighted by how many statements do.
+ *	A store ends each statement, vector or not
+ */
+static void LAYOUT_build_affinity(LAYOUT_info_t * p_info, const IR_program_t * kp_program)
+{
+	const IR_instruction_t * kp_instruction;
+	uint32_t pu32_statement[LAYOUT_MAX_STATEMENT_BLOCKS];
+	uint32_t u32_num_statement = 0;
+	uint64_t * pu64_pairs = NULL;
+	uint32_t u32_num_pairs = 0;
+	uint32_t u32_capacity = 0;
+	uint32_t * pu32_cursors;
+	uint32_t * pu32_bucketed;
+	uint32_t * pu32_weights;
+	uint32_t u32_num_edges = 0;
+	uint32_t u32_first_edge;
+	uint32_t u32_block;
+	uint32_t u32_to;
+	bool b_seen;
+
+	for (uint32_t i = 0; i < kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		if (kp_instruction->u8_opcode != IR_OPCODE_LOAD && kp_instruction->u8_opcode != IR_OPCODE_STORE &&
+			kp_instruction->u8_opcode != IR_OPCODE_VLOAD && kp_instruction->u8_opcode != IR_OPCODE_VSTORE)
+		{
+			continue;
+		}
+
+		u32_block = p_info->pu32_block_of[kp_instruction->u32_immediate];
+		b_seen = false;
+
+		for (uint32_t j = 0; j < u32_num_statement && !b_seen; j++)
+		{
+			b_seen = (pu32_statement[j] == u32_block);
+		}
+		if (!b_seen && u32_num_statement < LAYOUT_MAX_STATEMENT_BLOCKS)
+		{
+			pu32_statement[u32_num_statement++] = u32_block;
+		}
+
+		if (kp_instruction->u8_opcode != IR_OPCODE_STORE && kp_instruction->u8_opcode != IR_OPCODE_VSTORE)
+		{
+			continue;
+		}
+
+		for (uint32_t j = 0; j < u32_num_statement; j++)
+		{
+			for (uint32_t k = j + 1; k < u32_num_statement; k++)
+			{
+				if (u32_num_pairs + 2 > u32_capacity)
+				{
+					u32_capacity = (u32_capacity == 0) ? LAYOUT_MAX_STATEMENT_BLOCKS * LAYOUT_MAX_STATEMENT_BLOCKS : u32_capacity * 2;
+					pu64_pairs = realloc(pu64_pairs, sizeof(uint64_t) * u32_capacity);
+					ASSERT(pu64_pairs);
+				}
+
+				// Both ways round, so each block's bucket has all of its edges
+				pu64_pairs[u32_num_pairs++] = ((uint64_t)pu32_statement[j] << 32) | pu32_statement[k];
+				pu64_pairs[u32_num_pairs++] = ((uint64_t)pu32_statement[k] << 32) | pu32_statement[j];
+			}
+		}
+
+		u32_num_statement = 0;
+	}
+
+	p_info->pu32_edge_starts = calloc(p_info->u32_num_blocks + 1, sizeof(uint32_t));
+	p_info->p_edges = malloc(sizeof(LAYOUT_edge_t) * (u32_num_pairs + 1));
+	pu32_cursors = malloc(sizeof(uint32_t) * (p_info->u32_num_blocks + 1));
+	pu32_bucketed = malloc(sizeof(uint32_t) * (u32_num_pairs + 1));
+	pu32_weights = calloc(p_info->u32_num_blocks + 1, sizeof(uint32_t));
+	ASSERT(p_info->pu32_edge_starts && p_info->p_edges && pu32_cursors && pu32_bucketed && pu32_weights);
+
+	// Bucketed by the block each pair starts from, in linear time, since there can be a lot of them
+	for (uint32_t i = 0; i < u32_num_pairs; i++)
+	{
+		p_info->pu32_edge_starts[(pu64_pairs[i] >> 32) + 1]++;
+	}
+	for (uint32_t i = 1; i <= p_info->u32_num_blocks; i++)
+	{
+		p_info->pu32_edge_starts[i] += p_info->pu32_edge_starts[i - 1];
+	}
+	memcpy(pu32_cursors, p_info->pu32_edge_starts, sizeof(uint32_t) * p_info->u32_num_blocks);
+
+	for (uint32_t i = 0; i < u32_num_pairs; i++)
+	{
+		pu32_bucketed[pu32_cursors[pu64_pairs[i] >> 32]++] = (uint32_t)pu64_pairs[i];
+	}
+
+	// Repeats within a bucket merge into one edge, weighted by how many there were. Edges never
+	// outnumber pairs, so each bucket's edges can overwrite the buckets before it
+	for (uint32_t i = 0; i < p_info->u32_num_blocks; i++)
+	{
+		u32_first_edge = u32_num_edges;
+
+		for (uint32_t j = p_info->pu32_edge_starts[i]; j < p_info->pu32_edge_starts[i + 1]; j++)
+		{
+			u32_to = pu32_bucketed[j];
+
+			if (pu32_weights[u32_to]++ == 0)
+			{
+				p_info->p_edges[u32_num_edges++].u32_to = u32_to;
+			}
+		}
+		for (uint32_t j = u32_first_edge; j < u32_num_edges; j++)
+		{
+			p_info->p_edges[j].u32_weight = pu32_weights[p_info->p_edges[j].u32_to];
+			pu32_weights[p_info->p_edges[j].u32_to] = 0;
+		}
+
+		p_info->pu32_edge_starts[i] = u32_first_edge;
+	}
+	p_info->pu32_edge_starts[p_info->u32_num_blocks] = u32_num_edges;
+
+	free(pu32_cursors);
+	free(pu32_bucketed);
+	free(pu32_weights);
+	free(pu64_pairs);
+}
+
+/*
+ *	Fills a cache line at a time. The next block is the one with the most statements in common with
+ *	the line so far, hottest on a tie; with nothing in common, the hottest left
+ */
+static void LAYOUT_order(const LAYOUT_info_t * kp_info, uint32_t * pu32_order)
+{
+	uint64_t * pu64_hottest = malloc(sizeof(uint64_t) * (kp_info->u32_num_blocks + 1));
+	uint32_t * pu32_score = calloc(kp_info->u32_num_blocks + 1, sizeof(uint32_t));
+	uint32_t * pu32_candidates = malloc(sizeof(uint32_t) * (kp_info->u32_num_blocks + 1));
+	bool * pb_placed = calloc(kp_info->u32_num_blocks + 1, sizeof(bool));
+	const LAYOUT_block_t * kp_block;
+	uint32_t u32_num_candidates = 0;
+	uint32_t u32_next_hottest = 0;
+	uint32_t u32_fill = 0;
+	uint32_t u32_best;
+	uint32_t u32_to;
+
+	ASSERT(pu64_hottest && pu32_score && pu32_candidates && pb_placed);
+
+	for (uint32_t i = 0; i < kp_info->u32_num_blocks; i++)
+	{
+		pu64_hottest[i] = ((uint64_t)(UINT32_MAX - kp_info->p_blocks[i].u32_accesses) << 32) | i;
+	}
+	qsort(pu64_hottest, kp_info->u32_num_blocks, sizeof(uint64_t), LAYOUT_compare_keys);
+
+	for (uint32_t n = 0; n < kp_info->u32_num_blocks; n++)
+	{
+		u32_best = LAYOUT_NONE;
+
+		for (uint32_t i = 0; i < u32_num_candidates; i++)
+		{
+			kp_block = &kp_info->p_blocks[pu32_candidates[i]];
+
+			if (pb_placed[pu32_candidates[i]])
+			{
+				continue;
+			}
+			if (u32_best == LAYOUT_NONE || pu32_score[pu32_candidates[i]] > pu32_score[u32_best] ||
+				(pu32_score[pu32_candidates[i]] == pu32_score[u32_best] && (kp_block->u32_accesses > kp_info->p_blocks[u32_best].u32_accesses ||
+				(kp_block->u32_accesses == kp_info->p_blocks[u32_best].u32_accesses && pu32_candidates[i] < u32_best))))
+			{
+				u32_best = pu32_candidates[i];
+			}
+		}
+
+		if (u32_best == LAYOUT_NONE)
+		{
+			while (pb_placed[(uint32_t)pu64_hottest[u32_next_hottest]])
+			{
+				u32_next_hottest++;
+			}
+			u32_best = (uint32_t)pu64_hottest[u32_next_hottest];
+		}
+
+		pb_placed[u32_best] = true;
+		pu32_order[n] = u32_best;
+		u32_fill = LAYOUT_ALIGN(u32_fill, kp_info->p_blocks[u32_best].u32_align) + kp_info->p_blocks[u32_best].u32_size;
+
+		// A full line starts over with only what the block spilling into the next one has in common
+		if (u32_fill >= LAYOUT_CACHE_LINE_SIZE)
+		{
+			u32_fill %= LAYOUT_CACHE_LINE_SIZE;
+
+			for (uint32_t i = 0; i < u32_num_candidates; i++)
+			{
+				pu32_score[pu32_candidates[i]] = 0;
+			}
+			u32_num_candidates = 0;
+
+			if (u32_fill == 0)
+			{
+				continue;
+			}
+		}
+
+		for (uint32_t i = kp_info->pu32_edge_starts[u32_best]; i < kp_info->pu32_edge_starts[u32_best + 1]; i++)
+		{
+			u32_to = kp_info->p_edges[i].u32_to;
+
+			if (pb_placed[u32_to])
+			{
+				continue;
+			}
+			if (pu32_score[u32_to] == 0)
+			{
+				pu32_candidates[u32_num_candidates++] = u32_to;
+			}
+			pu32_score[u32_to] += kp_info->p_edges[i].u32_weight;
+		}
+	}
+
+	free(pu64_hottest);
+	free(pu32_score);
+	free(pu32_candidates);
+	free(pb_placed);
+}
+
+/*
+ *	Offsets for every variable, placing blocks in order. A block goes in the first gap an earlier
+ *	alignment left that it fits, otherwise at the end. Returns the bytes of storage needed
+ */
+static uint32_t LAYOUT_place(const LAYOUT_info_t * kp_info, const uint32_t * kpu32_order, uint32_t * pu32_offsets)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	LAYOUT_hole_t p_holes[LAYOUT_MAX_HOLES];
+	const LAYOUT_block_t * kp_block;
+	uint32_t u32_num_holes = 0;
+	uint32_t u32_end = 0;
+	uint32_t u32_offset;
+	uint32_t u32_hole_end;
+
+	for (uint32_t n = 0; n < kp_info->u32_num_blocks; n++)
+	{
+		kp_block = &kp_info->p_blocks[kpu32_order[n]];
+		u32_offset = LAYOUT_NONE;
+
+		for (uint32_t i = 0; i < u32_num_holes && u32_offset == LAYOUT_NONE; i++)
+		{
+			u32_hole_end = p_holes[i].u32_offset + p_holes[i].u32_size;
+
+			if (LAYOUT_ALIGN(p_holes[i].u32_offset, kp_block->u32_align) + kp_block->u32_size > u32_hole_end)
+			{
+				continue;
+			}
+
+			u32_offset = LAYOUT_ALIGN(p_holes[i].u32_offset, kp_block->u32_align);
+
+			// What's left after the block stays a hole; what alignment skipped before it becomes one
+			if (u32_offset > p_holes[i].u32_offset && u32_num_holes < LAYOUT_MAX_HOLES)
+			{
+				p_holes[u32_num_holes].u32_offset = p_holes[i].u32_offset;
+				p_holes[u32_num_holes++].u32_size = u32_offset - p_holes[i].u32_offset;
+			}
+			p_holes[i].u32_offset = u32_offset + kp_block->u32_size;
+			p_holes[i].u32_size = u32_hole_end - p_holes[i].u32_offset;
+
+			if (p_holes[i].u32_size == 0)
+			{
+				p_holes[i] = p_holes[--u32_num_holes];
+			}
+		}
+
+		if (u32_offset == LAYOUT_NONE)
+		{
+			u32_offset = LAYOUT_ALIGN(u32_end, kp_block->u32_align);
+
+			if (u32_offset > u32_end && u32_num_holes < LAYOUT_MAX_HOLES)
+			{
+				p_holes[u32_num_holes].u32_offset = u32_end;
+				p_holes[u32_num_holes++].u32_size = u32_offset - u32_end;
+			}
+			u32_end = u32_offset + kp_block->u32_size;
+		}
+
+		for (uint32_t i = kp_block->u32_first; i < kp_block->u32_first + kp_block->u32_count; i++)
+		{
+			pu32_offsets[i] = u32_offset;
+			u32_offset += BUILTINS_get_size(kp_symbols[i].builtin_type);
+		}
+	}
+
+	return u32_end;
+}
+
+/*
+ *	Fewest cache lines that between them hold LAYOUT_HOT_PERCENT of the accesses
+ */
+static uint32_t LAYOUT_count_hot_lines(const uint32_t * kpu32_accesses, const uint32_t * kpu32_offsets, uint32_t u32_num_variables,
+										uint32_t u32_storage_size)
+{
+	uint32_t u32_num_lines = (u32_storage_size + LAYOUT_CACHE_LINE_SIZE - 1) / LAYOUT_CACHE_LINE_SIZE;
+	uint64_t * pu64_lines = malloc(sizeof(uint64_t) * (u32_num_lines + 1));
+	uint64_t u64_total = 0;
+	uint64_t u64_covered = 0;
+	uint32_t u32_hot_lines = 0;
+
+	ASSERT(pu64_lines);
+
+	// Counted down from the top, so sorting puts the busiest line first
+	for (uint32_t i = 0; i < u32_num_lines; i++)
+	{
+		pu64_lines[i] = UINT64_MAX;
+	}
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		pu64_lines[kpu32_offsets[i] / LAYOUT_CACHE_LINE_SIZE] -= kpu32_accesses[i];
+		u64_total += kpu32_accesses[i];
+	}
+	qsort(pu64_lines, u32_num_lines, sizeof(uint64_t), LAYOUT_compare_keys);
+
+	while (u64_covered * 100 < u64_total * LAYOUT_HOT_PERCENT)
+	{
+		u64_covered += UINT64_MAX - pu64_lines[u32_hot_lines++];
+	}
+
+	free(pu64_lines);
+
+	return u32_hot_lines;
+}
+
+static int LAYOUT_compare_keys(const void * kp_left, const void * kp_right)
+{
+	uint64_t u64_left = *(const uint64_t *)kp_left;
+	uint64_t u64_right = *(const uint64_t *)kp_right;
+
+	return (u64_left > u64_right) - (u64_left < u64_right);
+}
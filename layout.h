@@ -0,0 +1,35 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "common.h"
+#include "status.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define LAYOUT_CACHE_LINE_SIZE			(64)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _LAYOUT_report
+{
+	uint32_t	u32_num_blocks;					// Variables, or runs of them vector code needs kept in order
+	uint32_t	u32_num_moved;					// Variables now at another offset
+	uint32_t	u32_num_lines;					// Cache lines the storage spans
+	uint32_t	u32_hot_lines_before;			// Fewest cache lines holding LAYOUT_HOT_PERCENT of the accesses
+	uint32_t	u32_hot_lines_after;
+} LAYOUT_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			LAYOUT_run						(const IR_program_t * kp_program, uint32_t u32_num_variables, LAYOUT_report_t * p_report);
+char * 			LAYOUT_format_map				(const IR_program_t * kp_program, uint32_t u32_num_variables, size_t * p_size);
+STATUS_t 		LAYOUT_write_map				(const IR_program_t * kp_program, uint32_t u32_num_variables, const char * kpc_fname);
+
+#endif
@@ -72,7 +72,7 @@ typedef struct _LEX_fsm_info
 	LEX_token_t				current_token;
 	LEX_token_list_t		token_list;
 	uint32_t				u32_token_buffer_capacity;
-	char					p_current_lexeme[LEX_MAX_LEXEME_SIZE];
+	char					p_current_lexeme[LEX_MAX_LEXEME_SIZE + 1];
 	uint16_t				u16_current_lexeme_index;
 	uint32_t				u32_num_statements;
 } LEX_info_t;
@@ -316,11 +316,11 @@ static void LEX_flush_to_token(void)
 	// Copy the lexeme over if we can. Otherwise, set it as invalid
 	if (lex_info.u16_current_lexeme_index <= LEX_MAX_LEXEME_SIZE)
 	{
-		strncpy(lex_info.current_token.pc_lexeme, lex_info.p_current_lexeme, LEX_MAX_LEXEME_SIZE);
+		strncpy(lex_info.current_token.pc_lexeme, lex_info.p_current_lexeme, LEX_MAX_LEXEME_SIZE + 1);
 	}
 	else
 	{
-		strncpy(lex_info.current_token.pc_lexeme, LEX_MAX_LEXEME_SIZE_EXCEEDED, LEX_MAX_LEXEME_SIZE);
+		strncpy(lex_info.current_token.pc_lexeme, LEX_MAX_LEXEME_SIZE_EXCEEDED, LEX_MAX_LEXEME_SIZE + 1);
 		lex_info.current_token.type = LEX_TOKEN_TYPE_UNKNOWN;
 	}
 
@@ -329,18 +329,22 @@ static void LEX_flush_to_token(void)
 
 	// Zero lexeme tracking members
 	lex_info.u16_current_lexeme_index = 0;
-	memset(lex_info.p_current_lexeme, 0, LEX_MAX_LEXEME_SIZE);
+	lex_info.p_current_lexeme[0] = '\0';
 }
 
 static LEX_token_type_t LEX_token_type_from_lexeme(void)
 {
     LEX_token_type_t type = LEX_TOKEN_TYPE_UNKNOWN;
     bool b_is_numeric;
+	uint32_t u32_lexeme_length;
 
     ASSERT(lex_info.u16_current_lexeme_index > 0);
+
+	// The lexeme stops growing once it's full, so measure it once rather than on every loop iteration
+	u32_lexeme_length = strlen(lex_info.p_current_lexeme);
     
     // We can get some of the easy ones out of the way here
-    if (strlen(lex_info.p_current_lexeme) == 1)
+    if (u32_lexeme_length == 1)
     {
         char c = lex_info.p_current_lexeme[0];
 
@@ -373,7 +377,7 @@ static LEX_token_type_t LEX_token_type_from_lexeme(void)
 		// If any character is not a number, the lexeme is not an int literal
 		b_is_numeric = true;
 
-        for (uint32_t i = 0; i < strlen(lex_info.p_current_lexeme); i++)
+        for (uint32_t i = 0; i < u32_lexeme_length; i++)
         {
             if (!isdigit(lex_info.p_current_lexeme[i]))
             {
@@ -392,7 +396,7 @@ static LEX_token_type_t LEX_token_type_from_lexeme(void)
             {
 				type = LEX_TOKEN_TYPE_IDENTIFIER;
 
-		        for (uint32_t i = 0; i < strlen(lex_info.p_current_lexeme); i++)
+		        for (uint32_t i = 0; i < u32_lexeme_length; i++)
 				{
 					if (LEX_SCANNING_SPECIAL_CHAR(lex_info.p_current_lexeme[i]))
 					{
@@ -413,8 +417,16 @@ static LEX_token_type_t LEX_token_type_from_lexeme(void)
 
 static inline void LEX_push_to_current_lexeme(char c)
 {
+	// Past the max size we only keep counting (up to one over) so the flush can flag the lexeme as too long
+	if (lex_info.u16_current_lexeme_index < LEX_MAX_LEXEME_SIZE)
+	{
 		lex_info.p_current_lexeme[lex_info.u16_current_lexeme_index++] = c;
 		lex_info.p_current_lexeme[lex_info.u16_current_lexeme_index] = '\0';
+	}
+	else
+	{
+		lex_info.u16_current_lexeme_index = LEX_MAX_LEXEME_SIZE + 1;
+	}
 }
 
 static bool LEX_handle_STATE_START(void)
@@ -625,6 +637,13 @@ static bool LEX_handle_STATE_WAIT_SCANNING_OPERATOR(void)
 		LEX_go_to_state(LEX_FSM_STATE_ID_WAIT_SCANNING_DELIM);
 		b_res = true;
 	}
+	else if (LEX_SCANNING_ALPHA(c))
+	{
+		LEX_flush_to_token();
+		LEX_push_to_current_lexeme(c);
+		LEX_go_to_state(LEX_FSM_STATE_ID_WAIT_SCANNING_IDENTIFIER);
+		b_res = true;
+	}
 	else if (LEX_SCANNING_NUMBER(c))
 	{
 		LEX_flush_to_token();
@@ -679,6 +698,13 @@ static bool LEX_handle_STATE_WAIT_SCANNING_CONTROL_CHAR(void)
 		LEX_go_to_state(LEX_FSM_STATE_ID_WAIT_SCANNING_DELIM);
 		b_res = true;
 	}
+	else if (LEX_SCANNING_ALPHA(c))
+	{
+		LEX_flush_to_token();
+		LEX_push_to_current_lexeme(c);
+		LEX_go_to_state(LEX_FSM_STATE_ID_WAIT_SCANNING_IDENTIFIER);
+		b_res = true;
+	}
 	else if (LEX_SCANNING_NUMBER(c))
 	{
 		LEX_flush_to_token();
@@ -731,7 +757,7 @@ static void LEX_restore_defaults (void)
 {
 	lex_info.u16_current_lexeme_index = 0;
 	lex_info.u32_num_statements = 0;
-	memset(lex_info.p_current_lexeme, 0, LEX_MAX_LEXEME_SIZE);
+	memset(lex_info.p_current_lexeme, 0, LEX_MAX_LEXEME_SIZE + 1);
 	lex_info.token_list.u32_num_tokens = 0;
 	lex_info.u32_token_buffer_capacity = LEX_INITIAL_TOKEN_BUFFER_SIZE;
 	lex_info.p_state = &p_fsm_states[LEX_FSM_STATE_ID_START];	
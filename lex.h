@@ -35,7 +35,7 @@ typedef enum
 typedef struct _LEX_token
 {
 	LEX_token_type_t 	type;
-	char 				pc_lexeme[LEX_MAX_LEXEME_SIZE];
+	char 				pc_lexeme[LEX_MAX_LEXEME_SIZE + 1];	// Plus one for the null terminator
 	uint32_t			u32_row;
 	uint32_t			u32_column;
 } LEX_token_t;
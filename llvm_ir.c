@@ -0,0 +1,561 @@
+#include <unistd.h>
+#include <stdarg.h>
+#include "llvm_ir.h"
+#include "ir.h"
+#include "asm.h"
+#include "io_handler.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_LLVM_IR
+#define LLVM_IR_DBG(fmt, ...)			printf(BOLD("LLVM_IR:\t")fmt, ##__VA_ARGS__)
+#define LLVM_IR_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("LLVM_IR:\t"))fmt, ##__VA_ARGS__)
+#define LLVM_IR_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("LLVM_IR:\t"))fmt, ##__VA_ARGS__)
+#define LLVM_IR_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("LLVM_IR:\t"))fmt, ##__VA_ARGS__)
+#else
+#define LLVM_IR_DBG(fmt, ...)
+#define LLVM_IR_GREEN(fmt, ...)
+#define LLVM_IR_WARN(fmt, ...)
+#define LLVM_IR_ERR(fmt, ...)
+#endif
+
+/*
+ *	Longest text one node lowers to, every number at its longest: a variable's address, cast, load
+ *	and extension, or a signed divide's checks, branch and new block
+ */
+#define LLVM_IR_MAX_NODE_LENGTH			(512)
+#define LLVM_IR_MAX_SYMBOL_LENGTH		(80)	// Per variable, less its name twice: "module asm ...", "i32 4294967295, ", "name\00", "i8 129, "
+#define LLVM_IR_MAX_FIXED_LENGTH		(1024)	// Declarations, the function's ends and the trap block
+#define LLVM_IR_MAX_COMMAND_LENGTH		(1024)
+
+#define LLVM_IR_TEMP_FILE_TEMPLATE		"/tmp/rep_llvm_XXXXXX"
+
+#define LLVM_IR_APPEND(p_writer, fmt, ...) \
+	LLVM_IR_append((p_writer), fmt, ##__VA_ARGS__)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Which of LLVM's tools compile the IR, best first
+ */
+typedef enum
+{
+	LLVM_IR_TOOLCHAIN_UNKNOWN = 0,		// Not looked for yet
+	LLVM_IR_TOOLCHAIN_CLANG,
+	LLVM_IR_TOOLCHAIN_OPT_LLC,
+	LLVM_IR_TOOLCHAIN_LLC,				// Back end only: no optimizer
+	LLVM_IR_TOOLCHAIN_NONE,
+} LLVM_IR_toolchain_t;
+
+/*
+ *	Where a lowered subtree left its value: a %v register, or a literal LLVM takes inline
+ */
+typedef struct
+{
+	bool		b_constant;
+	uint32_t	u32_value;
+	uint64_t	u64_constant;						// The literal, if it is one
+} LLVM_IR_operand_t;
+
+typedef struct
+{
+	char *				pc_text;
+	size_t				size;
+	size_t				capacity;
+	uint32_t			u32_num_values;		// %vN handed out
+	uint32_t			u32_num_blocks;		// %bN divisions have split the function into
+	bool				b_traps;			// Some division branches to the trap block
+	BUILTINS_type_t		type;				// What the statement being lowered computes in
+	uint32_t			u32_bits;
+} LLVM_IR_writer_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static const char * const pk_binary_instructions[PARSE_NODE_TYPE_NUM_TYPES][2] =
+{
+	[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= { "add", "add" },
+	[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= { "sub", "sub" },
+	[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= { "mul", "mul" },
+	[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= { "udiv", "sdiv" },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static uint32_t 			LLVM_IR_count_nodes				(const PARSE_node_t * kp_node);
+static void 				LLVM_IR_lower_statement			(LLVM_IR_writer_t * p_writer, const PARSE_node_t * kp_tree);
+static LLVM_IR_operand_t 	LLVM_IR_lower_expression		(LLVM_IR_writer_t * p_writer, const PARSE_node_t * kp_node);
+static void 				LLVM_IR_check_divisor			(LLVM_IR_writer_t * p_writer, LLVM_IR_operand_t dividend, LLVM_IR_operand_t divisor);
+static uint32_t 			LLVM_IR_address					(LLVM_IR_writer_t * p_writer, uint32_t u32_symbol);
+static void 				LLVM_IR_append_operand			(LLVM_IR_writer_t * p_writer, LLVM_IR_operand_t operand);
+static LLVM_IR_toolchain_t 	LLVM_IR_find_toolchain			(void);
+static bool 				LLVM_IR_has_tool				(const char * kpc_name);
+static void 				LLVM_IR_append					(LLVM_IR_writer_t * p_writer, const char * kpc_format, ...) __attribute__ ((format (printf, 2, 3)));
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Renders the program as an LLVM module defining the same rep_main and variable tables the
+ *	native back end does, over the same storage. Each statement computes
+ *	in its own type, as IR_lower has it. Bare expressions are dropped, as the VM does, and
+ *	malformed statements skipped. The caller frees the text
+ */
+char * LLVM_IR_format_program(const PARSE_tree_list_t * kp_tree_list, size_t * p_size)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint32_t u32_num_symbols = SYMBOL_TABLE_get_num_symbols();
+	LLVM_IR_writer_t writer = { 0 };
+	size_t capacity = LLVM_IR_MAX_FIXED_LENGTH;
+	size_t names_size = 0;
+
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		names_size += strlen(kp_symbols[i].p_token->pc_lexeme) + 1;
+	}
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		if (IR_tree_is_valid(kp_tree_list->trees[i]))
+		{
+			capacity += LLVM_IR_count_nodes(kp_tree_list->trees[i]) * LLVM_IR_MAX_NODE_LENGTH;
+		}
+	}
+
+	capacity += (u32_num_symbols * LLVM_IR_MAX_SYMBOL_LENGTH) + (names_size * 2);
+	writer.pc_text = malloc(capacity);
+	writer.capacity = capacity;
+	ASSERT(writer.pc_text);
+
+	// The offsets as assembler symbols, for a debugger or linker map to find the variables by
+	for (uint32_t i = 0; i < u32_num_symbols; i++)
+	{
+		LLVM_IR_APPEND(&writer, "module asm \"\\09.set\\09" ASM_VARIABLE_SYMBOL_PREFIX "%s, %u\"\n",
+			kp_symbols[i].p_token->pc_lexeme, SYMBOL_TABLE_get_offset(i));
+	}
+
+	LLVM_IR_APPEND(&writer, "\n@" ASM_NUM_VARIABLES_SYMBOL " = constant i32 %u\n", u32_num_symbols);
+
+	if (u32_num_symbols == 0)
+	{
+		LLVM_IR_APPEND(&writer,
+			"@" ASM_VARIABLE_OFFSETS_SYMBOL " = constant [0 x i32] zeroinitializer\n"
+			"@" ASM_VARIABLE_NAMES_SYMBOL " = constant [0 x i8] zeroinitializer\n"
+			"@" ASM_VARIABLE_TYPES_SYMBOL " = constant [0 x i8] zeroinitializer\n");
+	}
+	else
+	{
+		LLVM_IR_APPEND(&writer, "@" ASM_VARIABLE_OFFSETS_SYMBOL " = constant [%u x i32] [", u32_num_symbols);
+
+		for (uint32_t i = 0; i < u32_num_symbols; i++)
+		{
+			LLVM_IR_APPEND(&writer, "%si32 %u", (i == 0) ? "" : ", ", SYMBOL_TABLE_get_offset(i));
+		}
+
+		// Names are NUL-separated, in variable order
+		LLVM_IR_APPEND(&writer, "]\n@" ASM_VARIABLE_NAMES_SYMBOL " = constant [%zu x i8] c\"", names_size);
+
+		for (uint32_t i = 0; i < u32_num_symbols; i++)
+		{
+			LLVM_IR_APPEND(&writer, "%s\\00", kp_symbols[i].p_token->pc_lexeme);
+		}
+
+		LLVM_IR_APPEND(&writer, "\"\n@" ASM_VARIABLE_TYPES_SYMBOL " = constant [%u x i8] [", u32_num_symbols);
+
+		for (uint32_t i = 0; i < u32_num_symbols; i++)
+		{
+			LLVM_IR_APPEND(&writer, "%si8 %u", (i == 0) ? "" : ", ", ASM_VARIABLE_TYPE_BYTE(kp_symbols[i].builtin_type));
+		}
+
+		LLVM_IR_APPEND(&writer, "]\n");
+	}
+
+	LLVM_IR_APPEND(&writer,
+		"\n"
+		"declare void @llvm.trap() cold noreturn nounwind\n"
+		"\n"
+		"define void @" ASM_ENTRY_SYMBOL "(i8* noalias nocapture %%vars) nounwind {\n"
+		"entry:\n");
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		if (!IR_tree_is_valid(kp_tree_list->trees[i]))
+		{
+			LLVM_IR_ERR("Skipping malformed statement\n");
+			continue;
+		}
+
+		if (kp_tree_list->trees[i]->type == PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT)
+		{
+			LLVM_IR_lower_statement(&writer, kp_tree_list->trees[i]);
+		}
+	}
+
+	LLVM_IR_APPEND(&writer, "  ret void\n");
+
+	// Dividing by zero, or the most negative value by -1, traps as div does in native code, rather
+	// than being undefined and letting the optimizer assume it away
+	if (writer.b_traps)
+	{
+		LLVM_IR_APPEND(&writer,
+			"trap:\n"
+			"  call void @llvm.trap()\n"
+			"  unreachable\n");
+	}
+
+	LLVM_IR_APPEND(&writer, "}\n");
+
+	ASSERT(writer.size < capacity);
+	*p_size = writer.size;
+
+	LLVM_IR_DBG("Lowered %u statements to %zu bytes of IR\n", kp_tree_list->u32_num_trees, writer.size);
+
+	return writer.pc_text;
+}
+
+/*
+ *	Writes the module out as text, for LLVM's own tools or for inspection
+ */
+STATUS_t LLVM_IR_write_program(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname)
+{
+	STATUS_t status;
+	size_t size;
+	char * pc_text;
+
+	pc_text = LLVM_IR_format_program(kp_tree_list, &size);
+	status = IO_HANDLER_write_file(kpc_fname, pc_text, size);
+	free(pc_text);
+
+	return status;
+}
+
+bool LLVM_IR_tools_available(void)
+{
+	return LLVM_IR_find_toolchain() != LLVM_IR_TOOLCHAIN_NONE;
+}
+
+/*
+ *	Compiles the module to an object through whichever LLVM tools are installed. Fails if there
+ *	are none, or they reject it
+ */
+STATUS_t LLVM_IR_compile_object(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname)
+{
+	char pc_ir_fname[] = LLVM_IR_TEMP_FILE_TEMPLATE;
+	char pc_command[LLVM_IR_MAX_COMMAND_LENGTH];
+	LLVM_IR_toolchain_t toolchain = LLVM_IR_find_toolchain();
+	STATUS_t status;
+	int fd;
+	int length;
+
+	if (toolchain == LLVM_IR_TOOLCHAIN_NONE)
+	{
+		LLVM_IR_ERR("Neither clang nor llc is installed\n");
+		return STATUS_FAILED;
+	}
+
+	// The output goes to the shell single quoted
+	if (strchr(kpc_fname, '\'') != NULL)
+	{
+		LLVM_IR_ERR("Can't pass %s to LLVM\n", kpc_fname);
+		return STATUS_FAILED;
+	}
+
+	fd = mkstemp(pc_ir_fname);
+
+	if (fd < 0)
+	{
+		LLVM_IR_ERR("Failed to create a temporary file\n");
+		return STATUS_FILE_ERROR;
+	}
+
+	close(fd);
+	status = LLVM_IR_write_program(kp_tree_list, pc_ir_fname);
+
+	if (status == STATUS_OK)
+	{
+		switch (toolchain)
+		{
+			case LLVM_IR_TOOLCHAIN_CLANG:
+			{
+				length = snprintf(pc_command, sizeof(pc_command), LLVM_IR_CLANG_COMMAND, pc_ir_fname, kpc_fname);
+				break;
+			}
+			case LLVM_IR_TOOLCHAIN_OPT_LLC:
+			{
+				length = snprintf(pc_command, sizeof(pc_command), LLVM_IR_OPT_LLC_COMMAND, pc_ir_fname, kpc_fname);
+				break;
+			}
+			default:
+			{
+				length = snprintf(pc_command, sizeof(pc_command), LLVM_IR_LLC_COMMAND, pc_ir_fname, kpc_fname);
+				break;
+			}
+		}
+
+		if (length < 0 || (size_t)length >= sizeof(pc_command))
+		{
+			LLVM_IR_ERR("Path too long to pass to LLVM\n");
+			status = STATUS_FAILED;
+		}
+		else
+		{
+			LLVM_IR_DBG("Running %s\n", pc_command);
+
+			if (system(pc_command) != 0)
+			{
+				LLVM_IR_ERR("LLVM failed to compile %s\n", pc_ir_fname);
+				status = STATUS_FAILED;
+			}
+		}
+	}
+
+	remove(pc_ir_fname);
+
+	return status;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static uint32_t LLVM_IR_count_nodes(const PARSE_node_t * kp_node)
+{
+	if (kp_node == NULL)
+	{
+		return 0;
+	}
+
+	return 1 + LLVM_IR_count_nodes(kp_node->p_left) + LLVM_IR_count_nodes(kp_node->p_right);
+}
+
+/*
+ *	Computes the right-hand side in the statement's type and stores as many low bits as the variable holds
+ */
+static void LLVM_IR_lower_statement(LLVM_IR_writer_t * p_writer, const PARSE_node_t * kp_tree)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kp_tree->p_left->p_token->pc_lexeme);
+	BUILTINS_type_t variable_type = SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type;
+	uint32_t u32_variable_bits = BUILTINS_get_size(variable_type) * 8;
+	LLVM_IR_operand_t value;
+	uint32_t u32_address;
+
+	p_writer->type = IR_get_statement_type(kp_tree);
+	p_writer->type = (p_writer->type == BUILTINS_TYPE_NUM_TYPES) ? BUILTINS_TYPE_U32 : p_writer->type;
+	p_writer->u32_bits = BUILTINS_get_size(p_writer->type) * 8;
+
+	value = LLVM_IR_lower_expression(p_writer, kp_tree->p_right);
+
+	if (u32_variable_bits < p_writer->u32_bits)
+	{
+		LLVM_IR_APPEND(p_writer, "  %%v%u = trunc i%u ", p_writer->u32_num_values, p_writer->u32_bits);
+		LLVM_IR_append_operand(p_writer, value);
+		LLVM_IR_APPEND(p_writer, " to i%u\n", u32_variable_bits);
+
+		value.b_constant = false;
+		value.u32_value = p_writer->u32_num_values++;
+	}
+
+	u32_address = LLVM_IR_address(p_writer, u32_symbol);
+
+	LLVM_IR_APPEND(p_writer, "  store i%u ", u32_variable_bits);
+	LLVM_IR_append_operand(p_writer, value);
+	LLVM_IR_APPEND(p_writer, ", i%u* %%v%u, align %u\n", u32_variable_bits, u32_address, u32_variable_bits / 8);
+}
+
+/*
+ *	Lowers a subtree in postorder. Variables narrower than the statement are widened as they're
+ *	loaded, by their own signedness
+ */
+static LLVM_IR_operand_t LLVM_IR_lower_expression(LLVM_IR_writer_t * p_writer, const PARSE_node_t * kp_node)
+{
+	BUILTINS_type_t variable_type;
+	LLVM_IR_operand_t left;
+	LLVM_IR_operand_t right;
+	LLVM_IR_operand_t result = { .b_constant = false };
+	uint32_t u32_variable_bits;
+	uint32_t u32_symbol;
+	uint32_t u32_address;
+
+	if (kp_node->type == PARSE_NODE_TYPE_ID && kp_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+	{
+		result.b_constant = true;
+		result.u64_constant = IR_literal_value(kp_node->p_token->pc_lexeme);
+	}
+	else if (kp_node->type == PARSE_NODE_TYPE_ID)
+	{
+		u32_symbol = SYMBOL_TABLE_lookup(kp_node->p_token->pc_lexeme);
+		variable_type = SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type;
+		u32_variable_bits = BUILTINS_get_size(variable_type) * 8;
+		u32_address = LLVM_IR_address(p_writer, u32_symbol);
+
+		result.u32_value = p_writer->u32_num_values++;
+		LLVM_IR_APPEND(p_writer, "  %%v%u = load i%u, i%u* %%v%u, align %u\n", result.u32_value,
+			u32_variable_bits, u32_variable_bits, u32_address, u32_variable_bits / 8);
+
+		if (u32_variable_bits < p_writer->u32_bits)
+		{
+			LLVM_IR_APPEND(p_writer, "  %%v%u = %s i%u %%v%u to i%u\n", p_writer->u32_num_values,
+				BUILTINS_is_signed(variable_type) ? "sext" : "zext", u32_variable_bits, result.u32_value, p_writer->u32_bits);
+			result.u32_value = p_writer->u32_num_values++;
+		}
+	}
+	else
+	{
+		left = LLVM_IR_lower_expression(p_writer, kp_node->p_left);
+		right = LLVM_IR_lower_expression(p_writer, kp_node->p_right);
+
+		if (kp_node->type == PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE)
+		{
+			LLVM_IR_check_divisor(p_writer, left, right);
+		}
+
+		// Everything wraps, so no nsw or nuw
+		result.u32_value = p_writer->u32_num_values++;
+		LLVM_IR_APPEND(p_writer, "  %%v%u = %s i%u ", result.u32_value,
+			pk_binary_instructions[kp_node->type][BUILTINS_is_signed(p_writer->type) ? 1 : 0], p_writer->u32_bits);
+		LLVM_IR_append_operand(p_writer, left);
+		LLVM_IR_APPEND(p_writer, ", ");
+		LLVM_IR_append_operand(p_writer, right);
+		LLVM_IR_APPEND(p_writer, "\n");
+	}
+
+	return result;
+}
+
+/*
+ *	Branches to the trap block on a divisor div would fault on, and carries on in a new block
+ */
+static void LLVM_IR_check_divisor(LLVM_IR_writer_t * p_writer, LLVM_IR_operand_t dividend, LLVM_IR_operand_t divisor)
+{
+	uint32_t u32_condition = p_writer->u32_num_values++;
+
+	LLVM_IR_APPEND(p_writer, "  %%v%u = icmp eq i%u ", u32_condition, p_writer->u32_bits);
+	LLVM_IR_append_operand(p_writer, divisor);
+	LLVM_IR_APPEND(p_writer, ", 0\n");
+
+	if (BUILTINS_is_signed(p_writer->type))
+	{
+		LLVM_IR_APPEND(p_writer, "  %%v%u = icmp eq i%u ", p_writer->u32_num_values, p_writer->u32_bits);
+		LLVM_IR_append_operand(p_writer, divisor);
+		LLVM_IR_APPEND(p_writer, ", -1\n");
+		LLVM_IR_APPEND(p_writer, "  %%v%u = icmp eq i%u ", p_writer->u32_num_values + 1, p_writer->u32_bits);
+		LLVM_IR_append_operand(p_writer, dividend);
+		LLVM_IR_APPEND(p_writer, (p_writer->u32_bits == 64) ? ", -9223372036854775808\n" : ", -2147483648\n");
+		LLVM_IR_APPEND(p_writer, "  %%v%u = and i1 %%v%u, %%v%u\n", p_writer->u32_num_values + 2,
+			p_writer->u32_num_values, p_writer->u32_num_values + 1);
+		LLVM_IR_APPEND(p_writer, "  %%v%u = or i1 %%v%u, %%v%u\n", p_writer->u32_num_values + 3,
+			u32_condition, p_writer->u32_num_values + 2);
+
+		u32_condition = p_writer->u32_num_values + 3;
+		p_writer->u32_num_values += 4;
+	}
+
+	LLVM_IR_APPEND(p_writer, "  br i1 %%v%u, label %%trap, label %%b%u\n", u32_condition, p_writer->u32_num_blocks);
+	LLVM_IR_APPEND(p_writer, "b%u:\n", p_writer->u32_num_blocks++);
+
+	p_writer->b_traps = true;
+}
+
+/*
+ *	A pointer to the variable, typed as it's stored, returned as the %v holding it
+ */
+static uint32_t LLVM_IR_address(LLVM_IR_writer_t * p_writer, uint32_t u32_symbol)
+{
+	uint32_t u32_bits = BUILTINS_get_size(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type) * 8;
+	uint32_t u32_offset = SYMBOL_TABLE_get_offset(u32_symbol);
+
+	if (u32_offset == 0)
+	{
+		LLVM_IR_APPEND(p_writer, "  %%v%u = bitcast i8* %%vars to i%u*\n", p_writer->u32_num_values, u32_bits);
+	}
+	else
+	{
+		LLVM_IR_APPEND(p_writer, "  %%v%u = getelementptr inbounds i8, i8* %%vars, i64 %u\n", p_writer->u32_num_values, u32_offset);
+		LLVM_IR_APPEND(p_writer, "  %%v%u = bitcast i8* %%v%u to i%u*\n", p_writer->u32_num_values + 1, p_writer->u32_num_values, u32_bits);
+		p_writer->u32_num_values++;
+	}
+
+	return p_writer->u32_num_values++;
+}
+
+/*
+ *	A literal is written as the statement's type reads it: an i32 holds 4294967295 as -1, and a
+ *	32-bit statement keeps the low half of anything bigger
+ */
+static void LLVM_IR_append_operand(LLVM_IR_writer_t * p_writer, LLVM_IR_operand_t operand)
+{
+	if (!operand.b_constant)
+	{
+		LLVM_IR_APPEND(p_writer, "%%v%u", operand.u32_value);
+	}
+	else if (p_writer->u32_bits == 32)
+	{
+		LLVM_IR_APPEND(p_writer, "%d", (int32_t)operand.u64_constant);
+	}
+	else
+	{
+		LLVM_IR_APPEND(p_writer, "%lld", (long long)(int64_t)operand.u64_constant);
+	}
+}
+
+/*
+ *	Looked for once, on the PATH
+ */
+static LLVM_IR_toolchain_t LLVM_IR_find_toolchain(void)
+{
+	static LLVM_IR_toolchain_t toolchain = LLVM_IR_TOOLCHAIN_UNKNOWN;
+
+	if (toolchain == LLVM_IR_TOOLCHAIN_UNKNOWN)
+	{
+		if (LLVM_IR_has_tool("clang"))
+		{
+			toolchain = LLVM_IR_TOOLCHAIN_CLANG;
+		}
+		else if (LLVM_IR_has_tool("llc"))
+		{
+			toolchain = LLVM_IR_has_tool("opt") ? LLVM_IR_TOOLCHAIN_OPT_LLC : LLVM_IR_TOOLCHAIN_LLC;
+		}
+		else
+		{
+			toolchain = LLVM_IR_TOOLCHAIN_NONE;
+		}
+
+		LLVM_IR_DBG("Toolchain %u\n", toolchain);
+	}
+
+	return toolchain;
+}
+
+static bool LLVM_IR_has_tool(const char * kpc_name)
+{
+	char pc_command[LLVM_IR_MAX_COMMAND_LENGTH];
+
+	snprintf(pc_command, sizeof(pc_command), "command -v %s > /dev/null 2>&1", kpc_name);
+
+	return system(pc_command) == 0;
+}
+
+/*
+ *	The text was sized for the longest the program can lower to, so it never runs out
+ */
+static void LLVM_IR_append(LLVM_IR_writer_t * p_writer, const char * kpc_format, ...)
+{
+	va_list args;
+	int length;
+
+	va_start(args, kpc_format);
+	length = vsnprintf(p_writer->pc_text + p_writer->size, p_writer->capacity - p_writer->size, kpc_format, args);
+	va_end(args);
+
+	ASSERT(length >= 0 && (size_t)length < p_writer->capacity - p_writer->size);
+	p_writer->size += (size_t)length;
+}
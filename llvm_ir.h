@@ -0,0 +1,30 @@
+#ifndef LLVM_IR_H
+#define LLVM_IR_H
+
+#include "common.h"
+#include "status.h"
+#include "parse.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	How each toolchain is run, given the IR file and then the object's. clang runs LLVM's whole
+ *	optimizer and back end; opt piped into llc is the same in two steps, for installs with no clang.
+ *	Objects are position independent, so they can be linked either way
+ */
+#define LLVM_IR_CLANG_COMMAND			"clang -O3 -fPIC -x ir -c %s -o '%s'"
+#define LLVM_IR_OPT_LLC_COMMAND			"opt -O3 %s | llc -O3 -relocation-model=pic -filetype=obj -o '%s'"
+#define LLVM_IR_LLC_COMMAND				"llc -O3 -relocation-model=pic -filetype=obj %s -o '%s'"
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+char * 			LLVM_IR_format_program			(const PARSE_tree_list_t * kp_tree_list, size_t * p_size);
+STATUS_t 		LLVM_IR_write_program			(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname);
+bool 			LLVM_IR_tools_available			(void);
+STATUS_t 		LLVM_IR_compile_object			(const PARSE_tree_list_t * kp_tree_list, const char * kpc_fname);
+
+#endif
@@ -1,9 +1,17 @@
+#include <time.h>
 #include "common.h"
 #include "status.h"
 #include "io_handler.h"
 #include "lex.h"
 #include "parse.h"
 #include "code_gen.h"
+#include "layout.h"
+#include "llvm_ir.h"
+#include "c_backend.h"
+#include "executable.h"
+#include "symbol_table.h"
+#include "jit.h"
+#include "vm.h"
 
 /****************************************************************************************************
  *	D E F I N E S
@@ -14,6 +22,324 @@
 #define MAIN_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("MAIN:\t"))fmt, ##__VA_ARGS__)
 #define MAIN_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("MAIN:\t"))fmt, ##__VA_ARGS__)
 
+#define MAIN_DEBUG_SOURCE_FILE			"debug.rep"
+#define MAIN_ASSEMBLY_EXT				".s"
+#define MAIN_OBJECT_EXT					".o"
+#define MAIN_IR_EXT						".ir"
+#define MAIN_LLVM_EXT					".ll"
+#define MAIN_C_EXT						".c"
+#define MAIN_EXECUTABLE_EXT				""
+
+#define MAIN_MAX_PASS_FLAGS				(32)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	const char *	kpc_source_fname;
+	const char *	kpc_output_fname;
+	const char *	kpc_map_fname;		// Where to write the storage layout, or NULL
+	bool			b_object;			// Write an ELF object directly instead of assembly
+	bool			b_jit;				// Run in-process and print the variables instead of writing anything
+	bool			b_ir;				// Write the IR out instead of assembly
+	bool			b_vm;				// Interpret bytecode and print the variables, skipping native code generation
+	bool			b_llvm;				// Hand the program to LLVM instead: its IR, or with -c an object compiled by it
+	bool			b_gcc;				// Or to gcc: C source, or with -c an object compiled by it
+	bool			b_executable;		// Link the object with the freestanding runtime into a program that prints the variables
+	uint32_t		u32_num_threads;	// Code generation threads, 0 for one per core
+	uint32_t		u32_gvn_budget;		// Values value numbering may keep live at once, 0 for the default
+	PASS_level_t	level;
+	bool			b_time_passes;		// Print what each pass took and changed
+	const char *	pkpc_pass_names[MAIN_MAX_PASS_FLAGS];	// Passes enabled or disabled whatever the level, in order
+	bool			pb_pass_enabled[MAIN_MAX_PASS_FLAGS];
+	uint32_t		u32_num_pass_flags;
+} MAIN_options_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Usage: rep [-c | --exe | --ir | --jit | --vm] [--llvm | --gcc] [-O0 | -O1 | -O2] [--enable-pass name] [--disable-pass name]
+ *		[--time-passes] [-j threads] [--gvn-budget values] [--map layout.map] [-o output] source.rep
+ */
+static bool MAIN_parse_arguments(int argc, char ** argv, MAIN_options_t * p_options)
+{
+	p_options->kpc_source_fname = NULL;
+	p_options->kpc_output_fname = NULL;
+	p_options->kpc_map_fname = NULL;
+	p_options->b_object = false;
+	p_options->b_jit = false;
+	p_options->b_ir = false;
+	p_options->b_vm = false;
+	p_options->b_llvm = false;
+	p_options->b_gcc = false;
+	p_options->b_executable = false;
+	p_options->u32_num_threads = 0;
+	p_options->u32_gvn_budget = 0;
+	p_options->level = PASS_LEVEL_O2;
+	p_options->b_time_passes = false;
+	p_options->u32_num_pass_flags = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			p_options->kpc_output_fname = argv[++i];
+		}
+		else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+		{
+			p_options->kpc_map_fname = argv[++i];
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+		{
+			p_options->u32_num_threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--gvn-budget") == 0 && i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+		{
+			p_options->u32_gvn_budget = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (argv[i][0] == '-' && argv[i][1] == 'O' && argv[i][2] >= '0' && argv[i][2] < '0' + PASS_LEVEL_NUM_LEVELS && argv[i][3] == '\0')
+		{
+			p_options->level = (PASS_level_t)(argv[i][2] - '0');
+		}
+		else if ((strcmp(argv[i], "--enable-pass") == 0 || strcmp(argv[i], "--disable-pass") == 0) && i + 1 < argc &&
+				p_options->u32_num_pass_flags < MAIN_MAX_PASS_FLAGS)
+		{
+			p_options->pb_pass_enabled[p_options->u32_num_pass_flags] = (strcmp(argv[i], "--enable-pass") == 0);
+			p_options->pkpc_pass_names[p_options->u32_num_pass_flags++] = argv[++i];
+		}
+		else if (strcmp(argv[i], "--time-passes") == 0)
+		{
+			p_options->b_time_passes = true;
+		}
+		else if (strcmp(argv[i], "-c") == 0)
+		{
+			p_options->b_object = true;
+		}
+		else if (strcmp(argv[i], "--exe") == 0)
+		{
+			p_options->b_executable = true;
+		}
+		else if (strcmp(argv[i], "--jit") == 0)
+		{
+			p_options->b_jit = true;
+		}
+		else if (strcmp(argv[i], "--ir") == 0)
+		{
+			p_options->b_ir = true;
+		}
+		else if (strcmp(argv[i], "--vm") == 0)
+		{
+			p_options->b_vm = true;
+		}
+		else if (strcmp(argv[i], "--llvm") == 0)
+		{
+			p_options->b_llvm = true;
+		}
+		else if (strcmp(argv[i], "--gcc") == 0)
+		{
+			p_options->b_gcc = true;
+		}
+		else if (argv[i][0] != '-' && p_options->kpc_source_fname == NULL)
+		{
+			p_options->kpc_source_fname = argv[i];
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+#ifdef BUILD_DEBUG
+	if (p_options->kpc_source_fname == NULL)
+	{
+		p_options->kpc_source_fname = MAIN_DEBUG_SOURCE_FILE;
+	}
+#endif // BUILD_DEBUG
+
+	return p_options->kpc_source_fname != NULL && !(p_options->b_object && p_options->b_ir) &&
+			!(p_options->b_jit && (p_options->b_object || p_options->b_ir || p_options->kpc_output_fname != NULL)) &&
+			!(p_options->b_vm && (p_options->b_jit || p_options->b_object || p_options->b_ir || p_options->kpc_output_fname != NULL ||
+				p_options->kpc_map_fname != NULL)) &&
+			!(p_options->b_llvm && (p_options->b_jit || p_options->b_ir || p_options->b_vm || p_options->kpc_map_fname != NULL)) &&
+			!(p_options->b_gcc && (p_options->b_llvm || p_options->b_jit || p_options->b_ir || p_options->b_vm || p_options->kpc_map_fname != NULL)) &&
+			!(p_options->b_executable && (p_options->b_object || p_options->b_jit || p_options->b_ir || p_options->b_vm));
+}
+
+/*
+ *	Swaps the .rep extension for `kpc_ext`. The caller frees the result
+ */
+static char * MAIN_replace_extension(const char * kpc_fname, const char * kpc_ext)
+{
+	size_t stem_length = strlen(kpc_fname) - IO_REP_EXT_LENGTH;
+	char * pc_fname = malloc(stem_length + strlen(kpc_ext) + 1);
+
+	ASSERT(pc_fname);
+	memcpy(pc_fname, kpc_fname, stem_length);
+	strcpy(pc_fname + stem_length, kpc_ext);
+
+	return pc_fname;
+}
+
+/*
+ *	Links the object written in place of an executable with the runtime, then removes it
+ */
+static STATUS_t MAIN_link_executable(STATUS_t status, const char * kpc_object_fname, const char * kpc_fname)
+{
+	if (status == STATUS_OK)
+	{
+		status = EXECUTABLE_link(kpc_object_fname, kpc_fname);
+	}
+
+	remove(kpc_object_fname);
+
+	return status;
+}
+
+/*
+ *	Prints every variable from the storage generated code ran over, each as its type reads
+ */
+static void MAIN_print_variables(const uint8_t * kpu8_storage)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint64_t u64_value;
+
+	for (uint32_t i = 0; i < SYMBOL_TABLE_get_num_symbols(); i++)
+	{
+		u64_value = BUILTINS_read(kp_symbols[i].builtin_type, kpu8_storage + SYMBOL_TABLE_get_offset(i));
+
+		if (BUILTINS_is_signed(kp_symbols[i].builtin_type))
+		{
+			printf("%s = %lld\n", kp_symbols[i].p_token->pc_lexeme, (long long)(int64_t)u64_value);
+		}
+		else
+		{
+			printf("%s = %llu\n", kp_symbols[i].p_token->pc_lexeme, (unsigned long long)u64_value);
+		}
+	}
+}
+
+/*
+ *	Compiles rep_main into memory, runs it over zeroed variables and prints them
+ */
+static STATUS_t MAIN_run_jit(void)
+{
+	uint64_t * pu64_variables;
+	JIT_program_t program;
+	struct timespec start, end;
+	STATUS_t status;
+	size_t size;
+
+	status = JIT_compile(CODE_GEN_get_buffer(), &program);
+
+	if (status != STATUS_OK)
+	{
+		return status;
+	}
+
+	// Aligned to a cache line, which layout packs hot variables into, plus a spare slot so that a
+	// program with no variables still gets a valid pointer
+	size = (SYMBOL_TABLE_get_storage_size() + sizeof(uint64_t) + LAYOUT_CACHE_LINE_SIZE - 1) & ~(size_t)(LAYOUT_CACHE_LINE_SIZE - 1);
+	pu64_variables = aligned_alloc(LAYOUT_CACHE_LINE_SIZE, size);
+	ASSERT(pu64_variables);
+	memset(pu64_variables, 0, size);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	JIT_run(&program, (uint32_t *)pu64_variables);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	MAIN_print_variables((const uint8_t *)pu64_variables);
+
+	MAIN_DBG("Ran in %.3f us\n", ((double)(end.tv_sec - start.tv_sec) * 1e6) + ((double)(end.tv_nsec - start.tv_nsec) / 1e3));
+
+	free(pu64_variables);
+	JIT_release(&program);
+
+	return STATUS_OK;
+}
+
+/*
+ *	Compiles the trees to bytecode, interprets it over zeroed variables and prints them
+ */
+static STATUS_t MAIN_run_vm(const PARSE_tree_list_t * kp_tree_list)
+{
+	uint64_t * pu64_variables;
+	VM_program_t program;
+	struct timespec start, end;
+	STATUS_t status;
+
+	status = VM_compile(kp_tree_list, SYMBOL_TABLE_get_num_symbols(), &program);
+
+	if (status != STATUS_OK)
+	{
+		return status;
+	}
+
+	// Plus a spare slot so that a program with no variables still gets a valid pointer
+	pu64_variables = calloc((SYMBOL_TABLE_get_storage_size() / sizeof(uint64_t)) + 2, sizeof(uint64_t));
+	ASSERT(pu64_variables);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	status = VM_run(&program, (uint32_t *)pu64_variables);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (status == STATUS_OK)
+	{
+		MAIN_print_variables((const uint8_t *)pu64_variables);
+
+		MAIN_DBG("Interpreted %u instructions in %.3f us\n", program.u32_num_instructions,
+			((double)(end.tv_sec - start.tv_sec) * 1e6) + ((double)(end.tv_nsec - start.tv_nsec) / 1e3));
+	}
+
+	free(pu64_variables);
+	VM_release(&program);
+
+	return status;
+}
+
+/*
+ *	One line per pass in the order they ran, slowest marked, so it's clear where compile time goes
+ */
+static void MAIN_print_passes(const PASS_manager_t * kp_manager)
+{
+	const PASS_record_t * kp_record;
+	uint64_t u64_total = PASS_get_total_ns(kp_manager);
+	uint64_t u64_slowest = 0;
+
+	for (uint32_t i = 0; i < kp_manager->u32_num_passes; i++)
+	{
+		if (kp_manager->p_records[i].u64_ns > u64_slowest)
+		{
+			u64_slowest = kp_manager->p_records[i].u64_ns;
+		}
+	}
+
+	for (uint32_t i = 0; i < kp_manager->u32_num_passes; i++)
+	{
+		kp_record = &kp_manager->p_records[i];
+
+		if (!kp_record->b_ran)
+		{
+			MAIN_DBG("%-14s skipped\n", kp_manager->kp_passes[i].kpc_name);
+		}
+		else if (kp_record->u64_ns == u64_slowest)
+		{
+			MAIN_WARN("%-14s %10.3f ms %5.1f%% %10u changed\n", kp_manager->kp_passes[i].kpc_name, (double)kp_record->u64_ns / 1e6,
+				(u64_total > 0) ? 100.0 * (double)kp_record->u64_ns / (double)u64_total : 0.0, kp_record->u32_changed);
+		}
+		else
+		{
+			MAIN_DBG("%-14s %10.3f ms %5.1f%% %10u changed\n", kp_manager->kp_passes[i].kpc_name, (double)kp_record->u64_ns / 1e6,
+				(u64_total > 0) ? 100.0 * (double)kp_record->u64_ns / (double)u64_total : 0.0, kp_record->u32_changed);
+		}
+	}
+
+	MAIN_DBG("%-14s %10.3f ms\n", "total", (double)u64_total / 1e6);
+}
+
 /****************************************************************************************************
  *	M A I N
  ****************************************************************************************************/
@@ -21,24 +347,25 @@
 int main(int argc, char** argv)
 {
 	STATUS_t status;
-#ifdef BUILD_DEBUG
-	status = IO_HANDLER_load_source_file("debug.rep");
-#else
-	if (argc != 2)
+	MAIN_options_t options;
+	char * pc_default_output_fname = NULL;
+	char pc_object_fname[] = EXECUTABLE_TEMP_FILE_TEMPLATE;
+	const char * kpc_executable_fname = NULL;
+
+	if (!MAIN_parse_arguments(argc, argv, &options))
 	{
 		MAIN_ERR("Invalid arguments\n");
-		return 0;
+		MAIN_ERR("Usage: %s [-c | --exe | --ir | --jit | --vm] [--llvm | --gcc] [-O0 | -O1 | -O2] [--enable-pass name] [--disable-pass name] "
+			"[--time-passes] [-j threads] [--gvn-budget values] [--map layout.map] [-o output] source.rep\n", argv[0]);
+		return EXIT_FAILURE;
 	}
 
-	const char * fname = argv[1];
-
-	status = IO_HANDLER_load_source_file(fname);
-#endif // BUILD_DEBUG
+	status = IO_HANDLER_load_source_file(options.kpc_source_fname);
 
 	if (status != STATUS_OK)
 	{
 		MAIN_ERR("Error (status: %u). Aborting\n", status);
-		return 0;
+		return EXIT_FAILURE;
 	}
 
 	status = LEX_init();
@@ -46,15 +373,234 @@ int main(int argc, char** argv)
 	if (status != STATUS_OK)
 	{
 		MAIN_ERR("Error (status: %u). Aborting\n", status);
-		return 0;
+		return EXIT_FAILURE;
 	}
 
 	LEX_run_fsm();
 
 	PARSE_init();
-	PARSE_run_rdp();
+	status = PARSE_run_rdp();
+
+	if (status != STATUS_OK)
+	{
+		MAIN_ERR("Error (status: %u). Aborting\n", status);
+		PARSE_deinit();
+		LEX_deinit();
+		return EXIT_FAILURE;
+	}
 
 	PARSE_tree_list_t * p_tree_list = PARSE_get_tree_list();
 
-	CODE_GEN_traverse_tree(p_tree_list->trees[0]);
-}
\ No newline at end of file
+	// An executable starts out as an object, whichever back end writes it
+	if (options.b_executable)
+	{
+		if (options.kpc_output_fname == NULL)
+		{
+			pc_default_output_fname = MAIN_replace_extension(options.kpc_source_fname, MAIN_EXECUTABLE_EXT);
+			options.kpc_output_fname = pc_default_output_fname;
+		}
+
+		status = EXECUTABLE_create_temp_object(pc_object_fname);
+
+		if (status != STATUS_OK)
+		{
+			MAIN_ERR("Error (status: %u). Aborting\n", status);
+			free(pc_default_output_fname);
+			PARSE_deinit();
+			LEX_deinit();
+			return EXIT_FAILURE;
+		}
+
+		kpc_executable_fname = options.kpc_output_fname;
+		options.kpc_output_fname = pc_object_fname;
+		options.b_object = true;
+	}
+
+	// The interpreter starts from the trees, so none of the native pipeline runs
+	if (options.b_vm)
+	{
+		status = MAIN_run_vm(p_tree_list);
+
+		if (status != STATUS_OK)
+		{
+			MAIN_ERR("Error (status: %u). Aborting\n", status);
+		}
+
+		PARSE_deinit();
+		LEX_deinit();
+
+		return (status == STATUS_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// So does LLVM's: it optimizes the program itself, from the trees
+	if (options.b_llvm)
+	{
+		if (options.kpc_output_fname == NULL)
+		{
+			pc_default_output_fname = MAIN_replace_extension(options.kpc_source_fname, options.b_object ? MAIN_OBJECT_EXT : MAIN_LLVM_EXT);
+			options.kpc_output_fname = pc_default_output_fname;
+		}
+
+		if (options.b_object)
+		{
+			status = LLVM_IR_compile_object(p_tree_list, options.kpc_output_fname);
+		}
+		else
+		{
+			status = LLVM_IR_write_program(p_tree_list, options.kpc_output_fname);
+		}
+
+		if (options.b_executable)
+		{
+			status = MAIN_link_executable(status, pc_object_fname, kpc_executable_fname);
+		}
+
+		if (status != STATUS_OK)
+		{
+			MAIN_ERR("Error (status: %u). Aborting\n", status);
+		}
+
+		free(pc_default_output_fname);
+		PARSE_deinit();
+		LEX_deinit();
+
+		return (status == STATUS_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// And gcc's, from C written from the trees
+	if (options.b_gcc)
+	{
+		if (options.kpc_output_fname == NULL)
+		{
+			pc_default_output_fname = MAIN_replace_extension(options.kpc_source_fname, options.b_object ? MAIN_OBJECT_EXT : MAIN_C_EXT);
+			options.kpc_output_fname = pc_default_output_fname;
+		}
+
+		if (options.b_object)
+		{
+			status = C_BACKEND_compile_object(p_tree_list, options.kpc_output_fname);
+		}
+		else
+		{
+			status = C_BACKEND_write_program(p_tree_list, options.kpc_output_fname);
+		}
+
+		if (options.b_executable)
+		{
+			status = MAIN_link_executable(status, pc_object_fname, kpc_executable_fname);
+		}
+
+		if (status != STATUS_OK)
+		{
+			MAIN_ERR("Error (status: %u). Aborting\n", status);
+		}
+
+		free(pc_default_output_fname);
+		PARSE_deinit();
+		LEX_deinit();
+
+		return (status == STATUS_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	CODE_GEN_init();
+	CODE_GEN_set_num_threads(options.u32_num_threads);
+	CODE_GEN_set_gvn_budget(options.u32_gvn_budget);
+	CODE_GEN_set_opt_level(options.level);
+
+	for (uint32_t i = 0; i < options.u32_num_pass_flags; i++)
+	{
+		if (!CODE_GEN_set_pass_enabled(options.pkpc_pass_names[i], options.pb_pass_enabled[i]))
+		{
+			MAIN_ERR("No pass named %s can be %s\n", options.pkpc_pass_names[i], options.pb_pass_enabled[i] ? "enabled" : "disabled");
+
+			if (options.b_executable)
+			{
+				remove(pc_object_fname);
+			}
+
+			free(pc_default_output_fname);
+			CODE_GEN_deinit();
+			PARSE_deinit();
+			LEX_deinit();
+			return EXIT_FAILURE;
+		}
+	}
+
+	CODE_GEN_run(p_tree_list);
+
+	if (options.b_time_passes)
+	{
+		MAIN_print_passes(CODE_GEN_get_passes());
+	}
+
+	MAIN_DBG("Folding computed %u instructions, simplified %u and propagated into %u loads\n",
+		CODE_GEN_get_fold_report()->u32_num_folded, CODE_GEN_get_fold_report()->u32_num_simplified,
+		CODE_GEN_get_fold_report()->u32_num_propagated);
+	MAIN_DBG("Value numbering reused %u values, %u more were over budget\n",
+		CODE_GEN_get_gvn_report()->u32_num_reused, CODE_GEN_get_gvn_report()->u32_num_over_budget);
+	MAIN_DBG("Dead code elimination removed %u stores and %u other instructions, %u left\n",
+		CODE_GEN_get_dce_report()->u32_num_dead_stores, CODE_GEN_get_dce_report()->u32_num_dead_instructions,
+		CODE_GEN_get_dce_report()->u32_num_live_instructions);
+	MAIN_DBG("Reassociation rebalanced %u chains of %u operands, %u estimated cycles down to %u, folding %u constants\n",
+		CODE_GEN_get_reassoc_report()->u32_num_chains, CODE_GEN_get_reassoc_report()->u32_num_operands,
+		CODE_GEN_get_reassoc_report()->u32_height_before, CODE_GEN_get_reassoc_report()->u32_height_after,
+		CODE_GEN_get_reassoc_report()->u32_num_folded);
+	MAIN_DBG("SLP vectorized %u groups of statements, kept %u scalar as unprofitable\n",
+		CODE_GEN_get_slp_report()->u32_num_groups, CODE_GEN_get_slp_report()->u32_num_unprofitable);
+	MAIN_DBG("Layout moved %u variables, 90%% of accesses now in %u cache lines, down from %u\n",
+		CODE_GEN_get_layout_report()->u32_num_moved, CODE_GEN_get_layout_report()->u32_hot_lines_after,
+		CODE_GEN_get_layout_report()->u32_hot_lines_before);
+	MAIN_DBG("Promoted %u variables to registers, rewriting %u memory operands\n",
+		CODE_GEN_get_promote_result()->u32_num_promoted, CODE_GEN_get_promote_result()->u32_num_rewritten);
+	MAIN_DBG("Peephole removed %u instructions and rewrote %u\n",
+		CODE_GEN_get_peephole_result()->u32_num_removed, CODE_GEN_get_peephole_result()->u32_num_rewritten);
+	MAIN_DBG("Scheduling moved %u of %u units, estimated cycles %u down to %u\n",
+		CODE_GEN_get_schedule_result()->u32_num_moved, CODE_GEN_get_schedule_result()->u32_num_units,
+		CODE_GEN_get_schedule_result()->u32_cycles_before, CODE_GEN_get_schedule_result()->u32_cycles_after);
+
+	if (options.kpc_output_fname == NULL && !options.b_jit)
+	{
+		pc_default_output_fname = MAIN_replace_extension(options.kpc_source_fname,
+			options.b_object ? MAIN_OBJECT_EXT : (options.b_ir ? MAIN_IR_EXT : MAIN_ASSEMBLY_EXT));
+		options.kpc_output_fname = pc_default_output_fname;
+	}
+
+	if (options.b_jit)
+	{
+		status = MAIN_run_jit();
+	}
+	else if (options.b_object)
+	{
+		status = CODE_GEN_write_object(options.kpc_output_fname);
+	}
+	else if (options.b_ir)
+	{
+		status = IR_write_program(CODE_GEN_get_ir(), options.kpc_output_fname);
+	}
+	else
+	{
+		status = CODE_GEN_write_assembly(options.kpc_output_fname);
+	}
+
+	if (status == STATUS_OK && options.kpc_map_fname != NULL)
+	{
+		status = LAYOUT_write_map(CODE_GEN_get_ir(), SYMBOL_TABLE_get_num_symbols(), options.kpc_map_fname);
+	}
+
+	if (options.b_executable)
+	{
+		status = MAIN_link_executable(status, pc_object_fname, kpc_executable_fname);
+	}
+
+	if (status != STATUS_OK)
+	{
+		MAIN_ERR("Error (status: %u). Aborting\n", status);
+	}
+
+	free(pc_default_output_fname);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+
+	return (status == STATUS_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
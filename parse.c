@@ -1,5 +1,6 @@
 #include "parse.h"
-#include "scratch_register.h"
+#include "ir.h"
+#include "symbol_table.h"
 
 /****************************************************************************************************
  *	D E F I N E S
@@ -17,6 +18,15 @@
 #define PARSE_ERR(fmt, ...)
 #endif
 
+#define PARSE_INITIAL_TREE_BUFFER_SIZE	(4)
+
+/*
+ *	Bounds the nesting of parentheses, the only thing the grammar rules recurse on, so that
+ *	deeply nested input can't exhaust the stack. Chains of operators are parsed in a loop and
+ *	have no limit. Past this depth the statement is an error
+ */
+#define PARSE_MAX_RECURSION_DEPTH		(1024)
+
 /****************************************************************************************************
  *	T Y P E D E F S
  ****************************************************************************************************/
@@ -27,6 +37,10 @@ typedef struct
 	uint32_t 					u32_current_token_index;	// The index of the token currently being parsed
 	uint32_t					u32_num_statements;			// The number of statements found
 	PARSE_tree_list_t			tree_list;					// A container of parse trees
+	uint32_t					u32_tree_buffer_capacity;	// The number of trees `tree_list` has room for
+	uint32_t					u32_recursion_depth;		// How deep the grammar rules currently are
+	bool						b_failed;					// Whether the statement being parsed is in error
+	BUILTINS_type_t				declared_type;				// Type the next identifier is declared as, or BUILTINS_TYPE_NUM_TYPES
 } PARSE_info_t;
 
 typedef enum
@@ -58,6 +72,15 @@ static const char * const pk_node_type_descriptors[PARSE_NODE_TYPE_NUM_TYPES] =
  */
 static PARSE_info_t parse_info;
 
+/*
+ *	Handed out when the parser looks past the last token
+ */
+static LEX_token_t parse_end_of_input_token =
+{
+	.type		= LEX_TOKEN_TYPE_UNKNOWN,
+	.pc_lexeme	= "",
+};
+
 /****************************************************************************************************
  *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
  ****************************************************************************************************/
@@ -65,6 +88,7 @@ static PARSE_info_t parse_info;
 /*
  *	Parsing rules
  */
+static PARSE_node_t * 				PARSE_declaration		(void);
 static PARSE_node_t * 				PARSE_statement			(void);
 static PARSE_node_t * 				PARSE_expression		(void);
 static PARSE_node_t * 				PARSE_term				(void);
@@ -78,6 +102,9 @@ static inline LEX_token_t * 		PARSE_get_current_token	(void);
 static inline LEX_token_t * 		PARSE_get_next_token	(void);
 static inline PARSE_node_t *		PARSE_create_node		(PARSE_node_type_t type, LEX_token_t * p_token, PARSE_node_t * p_left, PARSE_node_t * p_right);
 static void 						PARSE_append_tree		(PARSE_node_t * p_root);
+static void 						PARSE_free_tree			(PARSE_node_t * p_root);
+static inline bool 					PARSE_enter_rule		(void);
+static inline void 					PARSE_leave_rule		(void);
 
 /****************************************************************************************************
  *	F U N C T I O N S
@@ -93,27 +120,86 @@ void PARSE_init(void)
 	parse_info.p_token_list = LEX_get_token_list();
 	parse_info.u32_num_statements = LEX_get_num_statements();
 	parse_info.u32_current_token_index = 0;
+	parse_info.u32_recursion_depth = 0;
+	parse_info.b_failed = false;
+	parse_info.declared_type = BUILTINS_TYPE_NUM_TYPES;
 	parse_info.tree_list.u32_num_trees = 0;
-	parse_info.tree_list.trees = malloc(sizeof(PARSE_node_t *));
+	parse_info.u32_tree_buffer_capacity = PARSE_INITIAL_TREE_BUFFER_SIZE;
+	parse_info.tree_list.trees = malloc(sizeof(PARSE_node_t *) * PARSE_INITIAL_TREE_BUFFER_SIZE);
+
+	SYMBOL_TABLE_init();
 }
 
 /*
- *	Runs the recursive descent parser
+ *	Deinitializes the module, releasing every parse tree
  */
-void PARSE_run_rdp(void)
+void PARSE_deinit(void)
+{
+	PARSE_DBG("Deinitializing\n");
+
+	for (uint32_t i = 0; i < parse_info.tree_list.u32_num_trees; i++)
+	{
+		PARSE_free_tree(parse_info.tree_list.trees[i]);
+	}
+
+	free(parse_info.tree_list.trees);
+	parse_info.tree_list.trees = NULL;
+	parse_info.tree_list.u32_num_trees = 0;
+	parse_info.u32_tree_buffer_capacity = 0;
+
+	// Symbols point at tokens owned by the trees
+	SYMBOL_TABLE_deinit();
+}
+
+/*
+ *	Runs the recursive descent parser. Fails if a statement couldn't be parsed, after carrying on
+ *	with the next one so that every error is reported
+ */
+STATUS_t PARSE_run_rdp(void)
 {
 	PARSE_node_t *p_root;
+	bool b_failed = false;
 
 	for (uint32_t i = 0; i < LEX_get_num_statements(); i++)
 	{
-		p_root = PARSE_statement();
+		parse_info.b_failed = false;
+		p_root = PARSE_declaration();
 		PARSE_append_tree(p_root);
+#ifdef DEBUG_PARSE
 		PARSE_DBG("Tree:\n");
 		PARSE_traverse_tree(p_root, 0, PARSE_NODE_SIDE_ROOT);
+#endif
+		if (!parse_info.b_failed && PARSE_get_current_token()->type != LEX_TOKEN_TYPE_DELIM)
+		{
+			PARSE_ERR("Unexpected [%s]\n", PARSE_get_current_token()->pc_lexeme);
+			parse_info.b_failed = true;
+		}
+
+		// Whatever an error left unparsed belongs to the same statement
+		while (PARSE_get_current_token()->type != LEX_TOKEN_TYPE_DELIM && PARSE_get_current_token() != &parse_end_of_input_token)
+		{
+			PARSE_consume_token();
+		}
+
+		b_failed = b_failed || parse_info.b_failed;
 		PARSE_consume_token();
 	}
 
+	if (PARSE_get_current_token() != &parse_end_of_input_token)
+	{
+		PARSE_ERR("Expected ; after [%s]\n", parse_info.p_token_list->p_tokens[parse_info.p_token_list->u32_num_tokens - 1].pc_lexeme);
+		b_failed = true;
+	}
+
+	if (b_failed)
+	{
+		PARSE_ERR("Failed\n");
+		return STATUS_FAILED;
+	}
+
 	PARSE_DBG(BOLD(BRIGHT_GREEN("Done\n")));
+
+	return STATUS_OK;
 }
 
 /*
@@ -140,7 +226,7 @@ void PARSE_traverse_tree(const PARSE_node_t *p_node, uint32_t u32_level, uint8_t
 
 	printf("%-30s", pk_node_type_descriptors[p_node->type]);
 
-	for (uint8_t i = 0; i < u32_level; i++)
+	for (uint32_t i = 0; i < u32_level; i++)
 	{
 		if (i == u32_level - 1)
 		{
@@ -175,12 +261,16 @@ static void PARSE_consume_token(void)
  */
 static inline LEX_token_t * PARSE_get_current_token(void)
 {
+	if (parse_info.u32_current_token_index >= parse_info.p_token_list->u32_num_tokens)
+	{
+		return &parse_end_of_input_token;
+	}
 	return &parse_info.p_token_list->p_tokens[parse_info.u32_current_token_index];
 }
 
 static inline LEX_token_t * PARSE_get_next_token(void)
 {
-	if (parse_info.p_token_list->u32_num_tokens == parse_info.u32_current_token_index)
+	if (parse_info.u32_current_token_index + 1 >= parse_info.p_token_list->u32_num_tokens)
 	{
 		return NULL;
 	}
@@ -194,13 +284,14 @@ static inline PARSE_node_t * PARSE_create_node (PARSE_node_type_t type, LEX_toke
 {
 	PARSE_node_t * p_node = (PARSE_node_t *)malloc(sizeof(PARSE_node_t));
 	p_node->type = type;
-	p_node->scratch_register = SCRATCH_REGISTER_ID_NONE;
+	p_node->u32_value = IR_VALUE_NONE;
+	p_node->u32_num_registers = 0;
 
 	// Lexemes are static arrays, do a deep copy
 	if (p_token != NULL)
 	{
         p_node->p_token = (LEX_token_t *)malloc(sizeof(LEX_token_t));
-        strncpy(p_node->p_token->pc_lexeme, p_token->pc_lexeme, LEX_MAX_LEXEME_SIZE);
+        strncpy(p_node->p_token->pc_lexeme, p_token->pc_lexeme, LEX_MAX_LEXEME_SIZE + 1);
         p_node->p_token->u32_row = p_token->u32_row;
         p_node->p_token->u32_column = p_token->u32_column;
         p_node->p_token->type = p_token->type;
@@ -218,11 +309,84 @@ static inline PARSE_node_t * PARSE_create_node (PARSE_node_type_t type, LEX_toke
 
 static void PARSE_append_tree(PARSE_node_t * p_root)
 {
-	ASSERT(p_root);
-	parse_info.tree_list.trees = realloc(parse_info.tree_list.trees, sizeof(PARSE_node_t *) * parse_info.tree_list.u32_num_trees + 1);
+	// Double our tree buffer if it's full
+	if (parse_info.tree_list.u32_num_trees == parse_info.u32_tree_buffer_capacity)
+	{
+		parse_info.u32_tree_buffer_capacity *= 2;
+		parse_info.tree_list.trees = realloc(parse_info.tree_list.trees, sizeof(PARSE_node_t *) * parse_info.u32_tree_buffer_capacity);
+		ASSERT(parse_info.tree_list.trees);
+	}
+
 	parse_info.tree_list.trees[parse_info.tree_list.u32_num_trees++] = p_root;
 }
 
+/*
+ *	Frees a tree without recursing, since chains of left-associative operators can be arbitrarily deep
+ */
+static void PARSE_free_tree(PARSE_node_t * p_root)
+{
+	PARSE_node_t ** pp_stack;
+	uint32_t u32_stack_size = 0;
+	uint32_t u32_stack_capacity = PARSE_INITIAL_TREE_BUFFER_SIZE;
+	PARSE_node_t * p_node;
+
+	if (p_root == NULL)
+	{
+		return;
+	}
+
+	pp_stack = malloc(sizeof(PARSE_node_t *) * u32_stack_capacity);
+	ASSERT(pp_stack);
+	pp_stack[u32_stack_size++] = p_root;
+
+	while (u32_stack_size > 0)
+	{
+		p_node = pp_stack[--u32_stack_size];
+
+		// Each pop pushes at most two children
+		if (u32_stack_size + 2 > u32_stack_capacity)
+		{
+			u32_stack_capacity *= 2;
+			pp_stack = realloc(pp_stack, sizeof(PARSE_node_t *) * u32_stack_capacity);
+			ASSERT(pp_stack);
+		}
+
+		if (p_node->p_left)
+		{
+			pp_stack[u32_stack_size++] = p_node->p_left;
+		}
+		if (p_node->p_right)
+		{
+			pp_stack[u32_stack_size++] = p_node->p_right;
+		}
+
+		free(p_node->p_token);
+		free(p_node);
+	}
+
+	free(pp_stack);
+}
+
+/*
+ *	Guards entry into a recursive grammar rule. Returns false if we're already too deep
+ */
+static inline bool PARSE_enter_rule(void)
+{
+	if (parse_info.u32_recursion_depth >= PARSE_MAX_RECURSION_DEPTH)
+	{
+		PARSE_ERR("Maximum nesting depth (%u) exceeded at [%s]\n", PARSE_MAX_RECURSION_DEPTH, PARSE_get_current_token()->pc_lexeme);
+		parse_info.b_failed = true;
+		return false;
+	}
+	parse_info.u32_recursion_depth++;
+	return true;
+}
+
+static inline void PARSE_leave_rule(void)
+{
+	parse_info.u32_recursion_depth--;
+}
+
 /****************************************************************************************************
  *	G R A M M A R   R U L E S
  ****************************************************************************************************/
@@ -242,8 +406,22 @@ static PARSE_node_t * PARSE_factor(void)
 	{
 		case LEX_TOKEN_TYPE_OPEN_PAREN:
 		{
+			if (!PARSE_enter_rule())
+			{
+				return NULL;
+			}
+
 			PARSE_consume_token();
-			p_node = PARSE_statement();
+			p_node = PARSE_expression();
+			PARSE_leave_rule();
+
+			if (PARSE_get_current_token()->type != LEX_TOKEN_TYPE_CLOSE_PAREN)
+			{
+				PARSE_ERR("Expected ) at [%s]\n", PARSE_get_current_token()->pc_lexeme);
+				parse_info.b_failed = true;
+				return p_node;
+			}
+
 			PARSE_consume_token();
 			return p_node;
 		}
@@ -257,15 +435,38 @@ static PARSE_node_t * PARSE_factor(void)
 		{
 			memcpy(&saved_token, p_token, sizeof(LEX_token_t));
 			PARSE_consume_token();
-			return PARSE_create_node(PARSE_NODE_TYPE_ID, &saved_token, NULL, NULL);
+			p_node = PARSE_create_node(PARSE_NODE_TYPE_ID, &saved_token, NULL, NULL);
+
+			// Every variable is in the global scope, and a u32 unless it was declared as something else where it first appears
+			SYMBOL_TABLE_entry_t symbol =
+			{
+				.p_token		= p_node->p_token,
+				.builtin_type	= (parse_info.declared_type != BUILTINS_TYPE_NUM_TYPES) ? parse_info.declared_type : BUILTINS_TYPE_U32,
+				.u32_scope_id	= 0,
+			};
+
+			if (parse_info.declared_type != BUILTINS_TYPE_NUM_TYPES && SYMBOL_TABLE_lookup(p_node->p_token->pc_lexeme) != SYMBOL_TABLE_INDEX_NONE &&
+				SYMBOL_TABLE_get_symbol_table()[SYMBOL_TABLE_lookup(p_node->p_token->pc_lexeme)].builtin_type != parse_info.declared_type)
+			{
+				PARSE_ERR("[%s] redeclared as %s, keeping the type it first had\n", p_node->p_token->pc_lexeme, BUILTINS_get_name(parse_info.declared_type));
+			}
+
+			parse_info.declared_type = BUILTINS_TYPE_NUM_TYPES;
+			SYMBOL_TABLE_append_symbol(&symbol);
+
+			return p_node;
 		}
 	}
 
-	return NULL; // Unreached
+	PARSE_ERR("Unexpected [%s]\n", p_token->pc_lexeme);
+	parse_info.b_failed = true;
+
+	return NULL;
 }
 
 /*
- *	Term grammar rule
+ *	Term grammar rule: factors joined by * and /, in a loop and left to right, so a * b / c is
+ *	(a * b) / c
  */
 static PARSE_node_t * PARSE_term(void)
 {
@@ -280,15 +481,9 @@ static PARSE_node_t * PARSE_term(void)
 		memcpy(&saved_token, p_token, sizeof(LEX_token_t));
 		PARSE_consume_token();
 
-		if (p_token->type == LEX_TOKEN_TYPE_OP_DIVIDE)
-		{
-			p_node = PARSE_create_node(PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE, &saved_token, p_node, PARSE_factor());
-		}
-		else if (p_token->type == LEX_TOKEN_TYPE_OP_MULTIPLY)
-		{
-			p_node = PARSE_create_node(PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY, &saved_token, p_node, PARSE_term());
-		}
-		
+		p_node = PARSE_create_node((saved_token.type == LEX_TOKEN_TYPE_OP_DIVIDE) ? PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE : PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY,
+			&saved_token, p_node, PARSE_factor());
+
 		p_token = PARSE_get_current_token();
 	}
 
@@ -296,7 +491,7 @@ static PARSE_node_t * PARSE_term(void)
 }
 
 /*
- *	Expression grammar rule
+ *	Expression grammar rule: terms joined by + and -, in a loop and left to right
  */
 static PARSE_node_t * PARSE_expression(void)
 {
@@ -311,14 +506,8 @@ static PARSE_node_t * PARSE_expression(void)
 		memcpy(&saved_token, p_token, sizeof(LEX_token_t));
 		PARSE_consume_token();
 
-		if (p_token->type == LEX_TOKEN_TYPE_OP_ADD)
-		{
-			p_node = PARSE_create_node(PARSE_NODE_TYPE_EXPR_TYPE_ADD, &saved_token, p_node, PARSE_expression());
-		}
-		else if (p_token->type == LEX_TOKEN_TYPE_OP_SUBTRACT)
-		{
-			p_node = PARSE_create_node(PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT, &saved_token, p_node, PARSE_term());
-		}
+		p_node = PARSE_create_node((saved_token.type == LEX_TOKEN_TYPE_OP_ADD) ? PARSE_NODE_TYPE_EXPR_TYPE_ADD : PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT,
+			&saved_token, p_node, PARSE_term());
 
 		p_token = PARSE_get_current_token();
 	}
@@ -327,7 +516,30 @@ static PARSE_node_t * PARSE_expression(void)
 }
 
 /*
- *	Statement grammar rule
+ *	Declaration grammar rule: a statement, optionally led by a type name that its first
+ *	identifier is declared as, e.g. "u8 x = 5;" or "i64 y;"
+ */
+static PARSE_node_t * PARSE_declaration(void)
+{
+	LEX_token_t *	p_token = PARSE_get_current_token();
+	LEX_token_t *	p_next_token = PARSE_get_next_token();
+	BUILTINS_type_t	type = BUILTINS_lookup(p_token->pc_lexeme);
+
+	// A type name alone is just a variable that happens to be called that
+	if (p_token->type == LEX_TOKEN_TYPE_IDENTIFIER && type != BUILTINS_TYPE_NUM_TYPES &&
+		p_next_token != NULL && p_next_token->type == LEX_TOKEN_TYPE_IDENTIFIER)
+	{
+		PARSE_DBG("[%s] DECLARATION\n", p_token->pc_lexeme);
+		PARSE_consume_token();
+		parse_info.declared_type = type;
+	}
+
+	return PARSE_statement();
+}
+
+/*
+ *	Statement grammar rule: an expression, assigned to another if there's an =. Chains aren't:
+ *	whatever follows is left for the caller to report
  */
 static PARSE_node_t * PARSE_statement(void)
 {
@@ -337,16 +549,11 @@ static PARSE_node_t * PARSE_statement(void)
 
 	PARSE_DBG("[%s] STATEMENT\n", p_token->pc_lexeme);
 
-	while (	p_token->type == LEX_TOKEN_TYPE_OP_ASSIGNMENT)
+	if (p_token->type == LEX_TOKEN_TYPE_OP_ASSIGNMENT)
 	{
 		memcpy(&saved_token, p_token, sizeof(LEX_token_t));
 		PARSE_consume_token();
 		p_node = PARSE_create_node(PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT, &saved_token, p_node, PARSE_expression());
-
-		if (PARSE_get_current_token()->type == LEX_TOKEN_TYPE_DELIM)
-		{
-			break;
-		}
 	}
 
 	return p_node;
@@ -2,7 +2,6 @@
 #define PARSE_H
 
 #include "lex.h"
-#include "scratch_register.h"
 
 /****************************************************************************************************
  *	T Y P E D E F S
@@ -34,7 +33,8 @@ typedef struct _PARSE_node
 {
 	PARSE_node_type_t		type;
 	LEX_token_t *			p_token;
-	SCRATCH_REGISTER_id_t	scratch_register;
+	uint32_t				u32_value;			// IR value holding the node's result, during lowering
+	uint32_t				u32_num_registers;	// Sethi-Ullman label: registers needed to evaluate the subtree
 	struct _PARSE_node *	p_left;
 	struct _PARSE_node *	p_right;
 } PARSE_node_t;
@@ -52,7 +52,8 @@ typedef struct _PARSE_tree_list
  ****************************************************************************************************/
 
 void 							PARSE_init				(void);
-void 							PARSE_run_rdp			(void);
+void 							PARSE_deinit			(void);
+STATUS_t 						PARSE_run_rdp			(void);
 PARSE_tree_list_t *				PARSE_get_tree_list		(void);
 void 							PARSE_traverse_tree		(const PARSE_node_t *p_node, uint32_t u32_level, uint8_t side);
 
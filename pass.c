@@ -0,0 +1,127 @@
+#include <time.h>
+#include "pass.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_PASS
+#define PASS_DBG(fmt, ...)				printf(BOLD("PASS:\t")fmt, ##__VA_ARGS__)
+#define PASS_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("PASS:\t"))fmt, ##__VA_ARGS__)
+#define PASS_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("PASS:\t"))fmt, ##__VA_ARGS__)
+#define PASS_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("PASS:\t"))fmt, ##__VA_ARGS__)
+#else
+#define PASS_DBG(fmt, ...)
+#define PASS_GREEN(fmt, ...)
+#define PASS_WARN(fmt, ...)
+#define PASS_ERR(fmt, ...)
+#endif
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Starts at PASS_LEVEL_O2 with nothing overridden. The manager keeps the pass list, not a copy
+ */
+void PASS_init_manager(PASS_manager_t * p_manager, const PASS_t * kp_passes, uint32_t u32_num_passes)
+{
+	ASSERT(u32_num_passes <= PASS_MAX_PASSES);
+
+	p_manager->kp_passes = kp_passes;
+	p_manager->u32_num_passes = u32_num_passes;
+	p_manager->level = PASS_LEVEL_O2;
+	memset(p_manager->pi8_overrides, 0, sizeof(p_manager->pi8_overrides));
+	memset(p_manager->p_records, 0, sizeof(p_manager->p_records));
+}
+
+/*
+ *	Overrides set before or after still apply
+ */
+void PASS_set_level(PASS_manager_t * p_manager, PASS_level_t level)
+{
+	ASSERT(level < PASS_LEVEL_NUM_LEVELS);
+
+	p_manager->level = level;
+}
+
+/*
+ *	Enables or disables every pass named `kpc_name`, whatever the level. False if none is, or one
+ *	is required
+ */
+bool PASS_set_enabled(PASS_manager_t * p_manager, const char * kpc_name, bool b_enabled)
+{
+	bool b_found = false;
+
+	for (uint32_t i = 0; i < p_manager->u32_num_passes; i++)
+	{
+		if (strcmp(p_manager->kp_passes[i].kpc_name, kpc_name) == 0)
+		{
+			if (p_manager->kp_passes[i].level == PASS_LEVEL_O0)
+			{
+				return false;
+			}
+
+			p_manager->pi8_overrides[i] = b_enabled ? 1 : -1;
+			b_found = true;
+		}
+	}
+
+	return b_found;
+}
+
+bool PASS_is_enabled(const PASS_manager_t * kp_manager, uint32_t u32_pass)
+{
+	if (kp_manager->pi8_overrides[u32_pass] != 0)
+	{
+		return kp_manager->pi8_overrides[u32_pass] > 0;
+	}
+
+	return kp_manager->kp_passes[u32_pass].level <= kp_manager->level;
+}
+
+/*
+ *	Runs every enabled pass in order over `p_context`, timing each
+ */
+void PASS_run(PASS_manager_t * p_manager, void * p_context)
+{
+	PASS_record_t * p_record;
+	struct timespec start, end;
+
+	for (uint32_t i = 0; i < p_manager->u32_num_passes; i++)
+	{
+		p_record = &p_manager->p_records[i];
+		p_record->b_ran = PASS_is_enabled(p_manager, i);
+		p_record->u32_changed = 0;
+		p_record->u64_ns = 0;
+
+		if (!p_record->b_ran)
+		{
+			PASS_DBG("Skipping %s\n", p_manager->kp_passes[i].kpc_name);
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		p_record->u32_changed = p_manager->kp_passes[i].function(p_context);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		p_record->u64_ns = ((uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull) + (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+
+		PASS_DBG("%s changed %u in %llu ns\n", p_manager->kp_passes[i].kpc_name, p_record->u32_changed, (unsigned long long)p_record->u64_ns);
+	}
+}
+
+/*
+ *	Of every pass that ran the last time
+ */
+uint64_t PASS_get_total_ns(const PASS_manager_t * kp_manager)
+{
+	uint64_t u64_total = 0;
+
+	for (uint32_t i = 0; i < kp_manager->u32_num_passes; i++)
+	{
+		u64_total += kp_manager->p_records[i].u64_ns;
+	}
+
+	return u64_total;
+}
@@ -0,0 +1,71 @@
+#ifndef PASS_H
+#define PASS_H
+
+#include "common.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PASS_MAX_PASSES					(32)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Optimization levels, each running every pass the one below it does
+ */
+typedef enum
+{
+	PASS_LEVEL_O0 = 0,				// Only what it takes to generate code
+	PASS_LEVEL_O1,					// Plus the passes that are linear and cheap
+	PASS_LEVEL_O2,					// Plus the ones that cost more compile time for better code
+	//////////////////////////////
+	PASS_LEVEL_NUM_LEVELS
+} PASS_level_t;
+
+/*
+ *	Runs a pass over whatever the manager was given, returning how many nodes it rewrote, removed
+ *	or emitted. Analyses change nothing and return 0
+ */
+typedef uint32_t (*PASS_function_t)(void * p_context);
+
+typedef struct _PASS
+{
+	const char *		kpc_name;
+	PASS_level_t		level;			// Lowest level it runs at. At PASS_LEVEL_O0 it's required and can't be disabled
+	PASS_function_t		function;
+} PASS_t;
+
+typedef struct _PASS_record
+{
+	bool				b_ran;
+	uint32_t			u32_changed;
+	uint64_t			u64_ns;			// Wall time it took
+} PASS_record_t;
+
+/*
+ *	An ordered pipeline, what's enabled in it, and what each pass did the last time it ran
+ */
+typedef struct _PASS_manager
+{
+	const PASS_t *		kp_passes;
+	uint32_t			u32_num_passes;
+	PASS_level_t		level;
+	int8_t				pi8_overrides[PASS_MAX_PASSES];		// Per pass: 1 enabled, -1 disabled, 0 as the level has it
+	PASS_record_t		p_records[PASS_MAX_PASSES];
+} PASS_manager_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			PASS_init_manager				(PASS_manager_t * p_manager, const PASS_t * kp_passes, uint32_t u32_num_passes);
+void 			PASS_set_level					(PASS_manager_t * p_manager, PASS_level_t level);
+bool 			PASS_set_enabled				(PASS_manager_t * p_manager, const char * kpc_name, bool b_enabled);
+bool 			PASS_is_enabled					(const PASS_manager_t * kp_manager, uint32_t u32_pass);
+void 			PASS_run						(PASS_manager_t * p_manager, void * p_context);
+uint64_t 		PASS_get_total_ns				(const PASS_manager_t * kp_manager);
+
+#endif
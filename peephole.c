@@ -0,0 +1,390 @@
+#include "peephole.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_PEEPHOLE
+#define PEEPHOLE_DBG(fmt, ...)			printf(BOLD("PEEPHOLE:\t")fmt, ##__VA_ARGS__)
+#define PEEPHOLE_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("PEEPHOLE:\t"))fmt, ##__VA_ARGS__)
+#define PEEPHOLE_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("PEEPHOLE:\t"))fmt, ##__VA_ARGS__)
+#define PEEPHOLE_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("PEEPHOLE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define PEEPHOLE_DBG(fmt, ...)
+#define PEEPHOLE_GREEN(fmt, ...)
+#define PEEPHOLE_WARN(fmt, ...)
+#define PEEPHOLE_ERR(fmt, ...)
+#endif
+
+#define PEEPHOLE_INDEX_NONE				(UINT32_MAX)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What the first pass learns about a virtual register, and what the second has done to it
+ */
+typedef struct
+{
+	uint32_t	u32_num_mentions;
+	uint32_t	u32_last;				// Index of the last instruction that mentions it
+	uint32_t	u32_alias;				// Virtual register it was merged into, or itself
+	uint32_t	u32_constant;
+	bool		b_foldable;				// Mentioned twice: defined, then read once by something that takes an immediate
+	bool		b_constant;				// Its definition was dropped and u32_constant stands in for it
+} PEEPHOLE_vreg_t;
+
+typedef struct
+{
+	PEEPHOLE_vreg_t *		p_vregs;
+	ASM_buffer_t *			p_buffer;
+	uint32_t				u32_num_out;		// Instructions kept so far, compacted to the front of the buffer
+	uint32_t				u32_prev_index;		// Original index of the last one kept
+	PEEPHOLE_result_t *		p_result;
+} PEEPHOLE_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		PEEPHOLE_scan_vregs				(PEEPHOLE_info_t * p_info, uint32_t u32_num_vregs);
+static void 		PEEPHOLE_note_mention			(PEEPHOLE_info_t * p_info, const ASM_instruction_t * kp_instruction, uint32_t u32_index, bool b_src);
+static bool 		PEEPHOLE_takes_immediate		(const ASM_instruction_t * kp_instruction);
+static void 		PEEPHOLE_substitute				(PEEPHOLE_info_t * p_info, ASM_instruction_t * p_instruction);
+static bool 		PEEPHOLE_fold_constant			(PEEPHOLE_info_t * p_info, const ASM_instruction_t * kp_instruction);
+static bool 		PEEPHOLE_forward_store			(PEEPHOLE_info_t * p_info, ASM_instruction_t * p_instruction);
+static bool 		PEEPHOLE_is_identity			(const ASM_instruction_t * kp_instruction);
+static bool 		PEEPHOLE_zero_with_xor			(ASM_instruction_t * p_instruction);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void PEEPHOLE_init_result(PEEPHOLE_result_t * p_result)
+{
+	p_result->u32_num_removed = 0;
+	p_result->u32_num_rewritten = 0;
+}
+
+/*
+ *	Slides a two-instruction window over straight-line code, dropping and rewriting as it goes:
+ *		- constants loaded only to be read once are folded into their reader as immediates
+ *		- a store followed by a load of the same variable reuses the stored value
+ *		- add/sub/xor of 0, imul by 1, shifts by 0 and moves onto themselves are dropped
+ *		- mov $0 into a register becomes xor
+ *	Works on virtual registers before allocation, and again on hardware registers after it.
+ *	Pass u32_num_vregs as 0 once there are none left
+ */
+void PEEPHOLE_run(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, PEEPHOLE_result_t * p_result)
+{
+	PEEPHOLE_info_t info = { 0 };
+	ASM_instruction_t instruction;
+
+	info.p_vregs = malloc(sizeof(PEEPHOLE_vreg_t) * (u32_num_vregs + 1));
+	ASSERT(info.p_vregs);
+	info.p_buffer = p_buffer;
+	info.u32_prev_index = PEEPHOLE_INDEX_NONE;
+	info.p_result = p_result;
+
+	PEEPHOLE_scan_vregs(&info, u32_num_vregs);
+
+	for (uint32_t i = 0; i < p_buffer->u32_num_instructions; i++)
+	{
+		instruction = p_buffer->p_instructions[i];
+
+		PEEPHOLE_substitute(&info, &instruction);
+
+		if (PEEPHOLE_forward_store(&info, &instruction) ||
+			PEEPHOLE_fold_constant(&info, &instruction) ||
+			PEEPHOLE_is_identity(&instruction))
+		{
+			p_result->u32_num_removed++;
+			continue;
+		}
+
+		if (PEEPHOLE_zero_with_xor(&instruction))
+		{
+			p_result->u32_num_rewritten++;
+		}
+
+		p_buffer->p_instructions[info.u32_num_out++] = instruction;
+		info.u32_prev_index = i;
+	}
+
+	p_buffer->u32_num_instructions = info.u32_num_out;
+
+	PEEPHOLE_DBG("%u instructions left, %u removed in total\n", p_buffer->u32_num_instructions, p_result->u32_num_removed);
+
+	free(info.p_vregs);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Counts mentions of every virtual register and notes which are folding candidates
+ */
+static void PEEPHOLE_scan_vregs(PEEPHOLE_info_t * p_info, uint32_t u32_num_vregs)
+{
+	const ASM_instruction_t * kp_instruction;
+
+	for (uint32_t i = 0; i < u32_num_vregs; i++)
+	{
+		p_info->p_vregs[i] = (PEEPHOLE_vreg_t)
+		{
+			.u32_num_mentions	= 0,
+			.u32_last			= PEEPHOLE_INDEX_NONE,
+			.u32_alias			= i,
+			.b_foldable			= false,
+			.b_constant			= false,
+		};
+	}
+
+	if (u32_num_vregs == 0)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < p_info->p_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &p_info->p_buffer->p_instructions[i];
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+		{
+			ASSERT(kp_instruction->u32_src < u32_num_vregs);
+			PEEPHOLE_note_mention(p_info, kp_instruction, i, true);
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+		{
+			ASSERT(kp_instruction->u32_dst < u32_num_vregs);
+			PEEPHOLE_note_mention(p_info, kp_instruction, i, false);
+		}
+	}
+}
+
+static void PEEPHOLE_note_mention(PEEPHOLE_info_t * p_info, const ASM_instruction_t * kp_instruction, uint32_t u32_index, bool b_src)
+{
+	PEEPHOLE_vreg_t * p_vreg = &p_info->p_vregs[b_src ? kp_instruction->u32_src : kp_instruction->u32_dst];
+
+	p_vreg->u32_num_mentions++;
+	p_vreg->u32_last = u32_index;
+
+	// The second mention decides it; a third undoes it
+	if (p_vreg->u32_num_mentions == 2)
+	{
+		p_vreg->b_foldable = b_src && PEEPHOLE_takes_immediate(kp_instruction) &&
+								!(kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL && kp_instruction->u32_dst == kp_instruction->u32_src);
+	}
+	else if (p_vreg->u32_num_mentions > 2)
+	{
+		p_vreg->b_foldable = false;
+	}
+}
+
+/*
+ *	Whether the source operand could be an immediate instead. div has no immediate form
+ */
+static bool PEEPHOLE_takes_immediate(const ASM_instruction_t * kp_instruction)
+{
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOV:
+		case ASM_OPCODE_ADD:
+		case ASM_OPCODE_SUB:
+		case ASM_OPCODE_XOR:
+		{
+			return true;
+		}
+		case ASM_OPCODE_IMUL:
+		{
+			return kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL || kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+/*
+ *	Applies earlier merges and folds to the instruction's virtual register operands
+ */
+static void PEEPHOLE_substitute(PEEPHOLE_info_t * p_info, ASM_instruction_t * p_instruction)
+{
+	const PEEPHOLE_vreg_t * kp_vreg;
+
+	if (p_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+	{
+		p_instruction->u32_dst = p_info->p_vregs[p_instruction->u32_dst].u32_alias;
+	}
+
+	if (p_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+	{
+		kp_vreg = &p_info->p_vregs[p_instruction->u32_src];
+
+		if (kp_vreg->b_constant)
+		{
+			// A narrow store only keeps the low bits, and its immediate can only hold those
+			p_instruction->u8_src_kind = ASM_OPERAND_IMMEDIATE;
+			p_instruction->u32_src = kp_vreg->u32_constant;
+
+			if (p_instruction->u8_width == ASM_WIDTH_8)
+			{
+				p_instruction->u32_src &= UINT8_MAX;
+			}
+			else if (p_instruction->u8_width == ASM_WIDTH_16)
+			{
+				p_instruction->u32_src &= UINT16_MAX;
+			}
+		}
+		else
+		{
+			p_instruction->u32_src = kp_vreg->u32_alias;
+		}
+	}
+}
+
+/*
+ *	mov $imm, %vN whose only reader can take the immediate itself
+ */
+static bool PEEPHOLE_fold_constant(PEEPHOLE_info_t * p_info, const ASM_instruction_t * kp_instruction)
+{
+	PEEPHOLE_vreg_t * p_vreg;
+
+	if (kp_instruction->u8_opcode != ASM_OPCODE_MOV || kp_instruction->u8_src_kind != ASM_OPERAND_IMMEDIATE ||
+		kp_instruction->u8_dst_kind != ASM_OPERAND_VIRTUAL)
+	{
+		return false;
+	}
+
+	p_vreg = &p_info->p_vregs[kp_instruction->u32_dst];
+
+	if (!p_vreg->b_foldable || p_vreg->u32_num_mentions != 2)
+	{
+		return false;
+	}
+
+	p_vreg->b_constant = true;
+	p_vreg->u32_constant = kp_instruction->u32_src;
+
+	return true;
+}
+
+/*
+ *	A load of the variable the previous instruction stored. A stored constant is loaded as that
+ *	constant; a stored register is reused as is, when it's the same hardware register or a virtual
+ *	register with nothing left to do after the store. Returns true if the load can go
+ */
+static bool PEEPHOLE_forward_store(PEEPHOLE_info_t * p_info, ASM_instruction_t * p_instruction)
+{
+	const ASM_instruction_t * kp_store;
+	PEEPHOLE_vreg_t * p_stored;
+	PEEPHOLE_vreg_t * p_loaded;
+
+	if (p_info->u32_num_out == 0 || p_instruction->u8_opcode != ASM_OPCODE_MOV ||
+		(p_instruction->u8_src_kind != ASM_OPERAND_VARIABLE && p_instruction->u8_src_kind != ASM_OPERAND_STACK))
+	{
+		return false;
+	}
+
+	kp_store = &p_info->p_buffer->p_instructions[p_info->u32_num_out - 1];
+
+	if (kp_store->u8_opcode != ASM_OPCODE_MOV || kp_store->u8_width != p_instruction->u8_width ||
+		kp_store->u8_dst_kind != p_instruction->u8_src_kind || kp_store->u32_dst != p_instruction->u32_src)
+	{
+		return false;
+	}
+
+	switch (kp_store->u8_src_kind)
+	{
+		case ASM_OPERAND_IMMEDIATE:
+		{
+			// Not removed, but now a candidate for folding
+			p_instruction->u8_src_kind = ASM_OPERAND_IMMEDIATE;
+			p_instruction->u32_src = kp_store->u32_src;
+			p_info->p_result->u32_num_rewritten++;
+			return false;
+		}
+		case ASM_OPERAND_REGISTER:
+		{
+			return p_instruction->u8_dst_kind == ASM_OPERAND_REGISTER && p_instruction->u32_dst == kp_store->u32_src;
+		}
+		case ASM_OPERAND_VIRTUAL:
+		{
+			if (p_instruction->u8_dst_kind != ASM_OPERAND_VIRTUAL)
+			{
+				return false;
+			}
+
+			p_stored = &p_info->p_vregs[kp_store->u32_src];
+			p_loaded = &p_info->p_vregs[p_instruction->u32_dst];
+
+			if (p_stored->u32_last != p_info->u32_prev_index)
+			{
+				return false;
+			}
+
+			// Every later mention of the loaded register reads the stored one instead
+			p_loaded->u32_alias = kp_store->u32_src;
+			p_stored->u32_last = p_loaded->u32_last;
+			p_stored->b_foldable = false;
+			return true;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+static bool PEEPHOLE_is_identity(const ASM_instruction_t * kp_instruction)
+{
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOV:
+		{
+			return kp_instruction->u8_src_kind == kp_instruction->u8_dst_kind && kp_instruction->u32_src == kp_instruction->u32_dst &&
+					(kp_instruction->u8_src_kind == ASM_OPERAND_REGISTER || kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL);
+		}
+		case ASM_OPCODE_ADD:
+		case ASM_OPCODE_SUB:
+		case ASM_OPCODE_XOR:
+		{
+			return kp_instruction->u8_src_kind == ASM_OPERAND_IMMEDIATE && kp_instruction->u32_src == 0;
+		}
+		case ASM_OPCODE_IMUL:
+		{
+			return kp_instruction->u8_src_kind == ASM_OPERAND_IMMEDIATE && kp_instruction->u32_src == 1;
+		}
+		case ASM_OPCODE_SHL:
+		case ASM_OPCODE_SHR:
+		{
+			return kp_instruction->u32_src == 0;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+/*
+ *	xor reg, reg is shorter than mov $0, reg and breaks the dependency on the register's old value.
+ *	Nothing generated reads the flags it clobbers
+ */
+static bool PEEPHOLE_zero_with_xor(ASM_instruction_t * p_instruction)
+{
+	if (p_instruction->u8_opcode != ASM_OPCODE_MOV || p_instruction->u8_src_kind != ASM_OPERAND_IMMEDIATE || p_instruction->u32_src != 0 ||
+		(p_instruction->u8_dst_kind != ASM_OPERAND_REGISTER && p_instruction->u8_dst_kind != ASM_OPERAND_VIRTUAL))
+	{
+		return false;
+	}
+
+	p_instruction->u8_opcode = ASM_OPCODE_XOR;
+	p_instruction->u8_src_kind = p_instruction->u8_dst_kind;
+	p_instruction->u32_src = p_instruction->u32_dst;
+
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "common.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Running totals. Each run adds to them, so one result can cover the passes before and after
+ *	register allocation
+ */
+typedef struct _PEEPHOLE_result
+{
+	uint32_t	u32_num_removed;		// Instructions dropped from the buffer
+	uint32_t	u32_num_rewritten;		// Instructions replaced by a cheaper one in place
+} PEEPHOLE_result_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			PEEPHOLE_init_result			(PEEPHOLE_result_t * p_result);
+void 			PEEPHOLE_run					(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, PEEPHOLE_result_t * p_result);
+
+#endif
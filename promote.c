@@ -0,0 +1,377 @@
+#include "promote.h"
+#include "regalloc.h"
+#include "builtins.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_PROMOTE
+#define PROMOTE_DBG(fmt, ...)			printf(BOLD("PROMOTE:\t")fmt, ##__VA_ARGS__)
+#define PROMOTE_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("PROMOTE:\t"))fmt, ##__VA_ARGS__)
+#define PROMOTE_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("PROMOTE:\t"))fmt, ##__VA_ARGS__)
+#define PROMOTE_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("PROMOTE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define PROMOTE_DBG(fmt, ...)
+#define PROMOTE_GREEN(fmt, ...)
+#define PROMOTE_WARN(fmt, ...)
+#define PROMOTE_ERR(fmt, ...)
+#endif
+
+#define PROMOTE_NUM_REGISTERS			(sizeof(pk_promotion_registers) / sizeof(pk_promotion_registers[0]))
+#define PROMOTE_NONE					(UINT32_MAX)
+
+/*
+ *	A promoted variable still costs its push and pop, on top of its load on entry and store on exit
+ */
+#define PROMOTE_SAVE_COST				(2)
+
+/*
+ *	Registers the allocator keeps clear of virtual registers live across a divide
+ */
+#define PROMOTE_DIVIDE_SLACK			(1)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What the scan learns about a variable
+ */
+typedef struct
+{
+	uint32_t	u32_num_mentions;
+	uint32_t	u32_register;				// ASM_register_t it's promoted to, or PROMOTE_NONE
+	bool		b_seen;
+	bool		b_eligible;					// Every mention reads or writes it whole
+	bool		b_read_first;				// Its value on entry is used, so has to be loaded
+	bool		b_written;					// Its value on exit changed, so has to be stored
+} PROMOTE_variable_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	Callee-saved, so the last the allocator would reach for, in the order promoted variables take them
+ */
+static const ASM_register_t pk_promotion_registers[] =
+{
+	ASM_REGISTER_RBX,
+	ASM_REGISTER_R12,
+	ASM_REGISTER_R13,
+	ASM_REGISTER_R14,
+	ASM_REGISTER_R15,
+	ASM_REGISTER_RBP,
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		PROMOTE_scan_variables			(PROMOTE_variable_t * p_variables, const ASM_buffer_t * kp_buffer, uint32_t u32_num_variables);
+static void 		PROMOTE_exclude_vector			(PROMOTE_variable_t * p_variables, uint32_t u32_num_variables, uint32_t u32_variable);
+static uint32_t 	PROMOTE_get_pressure			(const ASM_buffer_t * kp_buffer, uint32_t u32_num_vregs);
+static int32_t 		PROMOTE_get_benefit				(const PROMOTE_variable_t * kp_variable);
+static void 		PROMOTE_rewrite					(const PROMOTE_variable_t * kp_variables, ASM_buffer_t * p_buffer, uint32_t u32_num_variables, PROMOTE_result_t * p_result);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Gives the most used variables a callee-saved register for the whole of rep_main: loaded from
+ *	memory on entry if anything reads the old value, stored back on exit if anything wrote it, and
+ *	every load and store in between is that register. Only as many are promoted as leave the
+ *	allocator enough registers for the most virtual registers ever live at once, so promotion
+ *	never causes a spill. Runs before allocation, whose reserved registers are in `p_result`
+ */
+void PROMOTE_run(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_num_variables, PROMOTE_result_t * p_result)
+{
+	PROMOTE_variable_t * p_variables = malloc(sizeof(PROMOTE_variable_t) * (u32_num_variables + 1));
+	uint32_t u32_pressure = PROMOTE_get_pressure(p_buffer, u32_num_vregs);
+	uint32_t u32_num_registers = 0;
+	uint32_t u32_best;
+	int32_t i32_best_benefit;
+
+	ASSERT(p_variables);
+
+	p_result->u32_num_promoted = 0;
+	p_result->u32_num_rewritten = 0;
+	p_result->u32_reserved = 0;
+
+	if (u32_pressure + PROMOTE_DIVIDE_SLACK < REGALLOC_NUM_ALLOCATABLE)
+	{
+		u32_num_registers = REGALLOC_NUM_ALLOCATABLE - u32_pressure - PROMOTE_DIVIDE_SLACK;
+		u32_num_registers = (u32_num_registers < PROMOTE_NUM_REGISTERS) ? u32_num_registers : PROMOTE_NUM_REGISTERS;
+	}
+
+	PROMOTE_scan_variables(p_variables, p_buffer, u32_num_variables);
+
+	// Few registers to hand out, so picking the best each time is cheaper than sorting
+	while (p_result->u32_num_promoted < u32_num_registers)
+	{
+		u32_best = PROMOTE_NONE;
+		i32_best_benefit = 0;
+
+		for (uint32_t i = 0; i < u32_num_variables; i++)
+		{
+			if (p_variables[i].b_eligible && p_variables[i].u32_register == PROMOTE_NONE && PROMOTE_get_benefit(&p_variables[i]) > i32_best_benefit)
+			{
+				u32_best = i;
+				i32_best_benefit = PROMOTE_get_benefit(&p_variables[i]);
+			}
+		}
+
+		if (u32_best == PROMOTE_NONE)
+		{
+			break;
+		}
+
+		p_variables[u32_best].u32_register = pk_promotion_registers[p_result->u32_num_promoted++];
+		p_result->u32_reserved |= 1u << p_variables[u32_best].u32_register;
+
+		PROMOTE_DBG("%s lives in %s, mentioned %u times\n", SYMBOL_TABLE_get_symbol_table()[u32_best].p_token->pc_lexeme,
+			ASM_get_register_name(p_variables[u32_best].u32_register, ASM_WIDTH_64), p_variables[u32_best].u32_num_mentions);
+	}
+
+	if (p_result->u32_num_promoted > 0)
+	{
+		PROMOTE_rewrite(p_variables, p_buffer, u32_num_variables, p_result);
+	}
+
+	PROMOTE_DBG("Promoted %u variables with %u virtual registers live at most, rewrote %u operands\n",
+		p_result->u32_num_promoted, u32_pressure, p_result->u32_num_rewritten);
+
+	free(p_variables);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Counts every variable's mentions. Only 32 and 64-bit variables read and written at their own
+ *	width are eligible: a register can't stand in for memory that's partly written, and narrow
+ *	ones gain little. Code is straight-line, so the first mention says whether the entry value is read
+ */
+static void PROMOTE_scan_variables(PROMOTE_variable_t * p_variables, const ASM_buffer_t * kp_buffer, uint32_t u32_num_variables)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	const ASM_instruction_t * kp_instruction;
+	PROMOTE_variable_t * p_variable;
+	ASM_width_t width;
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		width = ASM_get_width(BUILTINS_get_size(kp_symbols[i].builtin_type));
+
+		p_variables[i] = (PROMOTE_variable_t)
+		{
+			.u32_num_mentions	= 0,
+			.u32_register		= PROMOTE_NONE,
+			.b_seen				= false,
+			.b_eligible			= (width == ASM_WIDTH_32 || width == ASM_WIDTH_64),
+			.b_read_first		= false,
+			.b_written			= false,
+		};
+	}
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VARIABLE)
+		{
+			ASSERT(kp_instruction->u32_src < u32_num_variables);
+			p_variable = &p_variables[kp_instruction->u32_src];
+			width = ASM_get_width(BUILTINS_get_size(kp_symbols[kp_instruction->u32_src].builtin_type));
+
+			p_variable->u32_num_mentions++;
+			p_variable->b_eligible = p_variable->b_eligible && (ASM_get_src_width(kp_instruction) == width);
+
+			if (kp_instruction->u8_width == ASM_WIDTH_128)
+			{
+				PROMOTE_exclude_vector(p_variables, u32_num_variables, kp_instruction->u32_src);
+			}
+			p_variable->b_read_first = p_variable->b_read_first || !p_variable->b_seen;
+			p_variable->b_seen = true;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VARIABLE)
+		{
+			ASSERT(kp_instruction->u32_dst < u32_num_variables);
+			p_variable = &p_variables[kp_instruction->u32_dst];
+			width = ASM_get_width(BUILTINS_get_size(kp_symbols[kp_instruction->u32_dst].builtin_type));
+
+			p_variable->u32_num_mentions++;
+			p_variable->b_eligible = p_variable->b_eligible && (ASM_get_dst_width(kp_instruction) == width);
+
+			if (kp_instruction->u8_width == ASM_WIDTH_128)
+			{
+				PROMOTE_exclude_vector(p_variables, u32_num_variables, kp_instruction->u32_dst);
+			}
+			// Anything but a plain store reads the destination too
+			p_variable->b_read_first = p_variable->b_read_first || (!p_variable->b_seen && kp_instruction->u8_opcode != ASM_OPCODE_MOV);
+			p_variable->b_written = true;
+			p_variable->b_seen = true;
+		}
+	}
+}
+
+/*
+ *	A vector access reads or writes every variable in the ASM_VECTOR_SIZE bytes from this one's offset,
+ *	which are the u32s declared after it. Layout keeps them there, whatever else it moves
+ */
+static void PROMOTE_exclude_vector(PROMOTE_variable_t * p_variables, uint32_t u32_num_variables, uint32_t u32_variable)
+{
+	uint32_t u32_end = SYMBOL_TABLE_get_offset(u32_variable) + ASM_VECTOR_SIZE;
+
+	for (uint32_t i = u32_variable; i < u32_num_variables && SYMBOL_TABLE_get_offset(i) >= SYMBOL_TABLE_get_offset(u32_variable) &&
+		SYMBOL_TABLE_get_offset(i) < u32_end; i++)
+	{
+		p_variables[i].b_eligible = false;
+	}
+}
+
+/*
+ *	Most virtual registers live at once, each from its first mention to its last
+ */
+static uint32_t PROMOTE_get_pressure(const ASM_buffer_t * kp_buffer, uint32_t u32_num_vregs)
+{
+	uint32_t * pu32_first = malloc(sizeof(uint32_t) * (u32_num_vregs + 1));
+	uint32_t * pu32_last = malloc(sizeof(uint32_t) * (u32_num_vregs + 1));
+	int32_t * pi32_deltas = calloc(kp_buffer->u32_num_instructions + 1, sizeof(int32_t));
+	const ASM_instruction_t * kp_instruction;
+	uint32_t pu32_vregs[2];
+	uint32_t u32_num_operands;
+	int32_t i32_live = 0;
+	int32_t i32_max = 0;
+
+	ASSERT(pu32_first && pu32_last && pi32_deltas);
+
+	for (uint32_t i = 0; i < u32_num_vregs; i++)
+	{
+		pu32_first[i] = PROMOTE_NONE;
+	}
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+		u32_num_operands = 0;
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_vregs[u32_num_operands++] = kp_instruction->u32_src;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_vregs[u32_num_operands++] = kp_instruction->u32_dst;
+		}
+
+		for (uint32_t j = 0; j < u32_num_operands; j++)
+		{
+			ASSERT(pu32_vregs[j] < u32_num_vregs);
+
+			if (pu32_first[pu32_vregs[j]] == PROMOTE_NONE)
+			{
+				pu32_first[pu32_vregs[j]] = i;
+			}
+			pu32_last[pu32_vregs[j]] = i;
+		}
+	}
+
+	for (uint32_t i = 0; i < u32_num_vregs; i++)
+	{
+		if (pu32_first[i] != PROMOTE_NONE)
+		{
+			pi32_deltas[pu32_first[i]]++;
+			pi32_deltas[pu32_last[i] + 1]--;
+		}
+	}
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		i32_live += pi32_deltas[i];
+		i32_max = (i32_live > i32_max) ? i32_live : i32_max;
+	}
+
+	free(pu32_first);
+	free(pu32_last);
+	free(pi32_deltas);
+
+	return (uint32_t)i32_max;
+}
+
+/*
+ *	Memory accesses saved, less the ones promotion adds
+ */
+static int32_t PROMOTE_get_benefit(const PROMOTE_variable_t * kp_variable)
+{
+	return (int32_t)kp_variable->u32_num_mentions - (kp_variable->b_read_first ? 1 : 0) - (kp_variable->b_written ? 1 : 0) - PROMOTE_SAVE_COST;
+}
+
+/*
+ *	Swaps promoted variables' operands for their registers, then loads them before everything
+ *	and stores them after it
+ */
+static void PROMOTE_rewrite(const PROMOTE_variable_t * kp_variables, ASM_buffer_t * p_buffer, uint32_t u32_num_variables, PROMOTE_result_t * p_result)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	ASM_instruction_t * p_loads = malloc(sizeof(ASM_instruction_t) * (p_result->u32_num_promoted + 1));
+	ASM_instruction_t * p_instruction;
+	uint32_t u32_num_loads = 0;
+	ASM_width_t width;
+
+	ASSERT(p_loads);
+
+	for (uint32_t i = 0; i < p_buffer->u32_num_instructions; i++)
+	{
+		p_instruction = &p_buffer->p_instructions[i];
+
+		if (p_instruction->u8_src_kind == ASM_OPERAND_VARIABLE && kp_variables[p_instruction->u32_src].u32_register != PROMOTE_NONE)
+		{
+			p_instruction->u8_src_kind = ASM_OPERAND_REGISTER;
+			p_instruction->u32_src = kp_variables[p_instruction->u32_src].u32_register;
+			p_result->u32_num_rewritten++;
+		}
+		if (p_instruction->u8_dst_kind == ASM_OPERAND_VARIABLE && kp_variables[p_instruction->u32_dst].u32_register != PROMOTE_NONE)
+		{
+			p_instruction->u8_dst_kind = ASM_OPERAND_REGISTER;
+			p_instruction->u32_dst = kp_variables[p_instruction->u32_dst].u32_register;
+			p_result->u32_num_rewritten++;
+		}
+	}
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		if (kp_variables[i].u32_register == PROMOTE_NONE)
+		{
+			continue;
+		}
+
+		width = ASM_get_width(BUILTINS_get_size(kp_symbols[i].builtin_type));
+
+		if (kp_variables[i].b_read_first)
+		{
+			p_loads[u32_num_loads++] = (ASM_instruction_t)
+			{
+				.u8_opcode		= ASM_OPCODE_MOV,
+				.u8_width		= width,
+				.u8_src_kind	= ASM_OPERAND_VARIABLE,
+				.u32_src		= i,
+				.u8_dst_kind	= ASM_OPERAND_REGISTER,
+				.u32_dst		= kp_variables[i].u32_register,
+			};
+		}
+
+		if (kp_variables[i].b_written)
+		{
+			ASM_emit(p_buffer, ASM_OPCODE_MOV, width, ASM_OPERAND_REGISTER, kp_variables[i].u32_register, ASM_OPERAND_VARIABLE, i);
+		}
+	}
+
+	ASM_insert_instructions(p_buffer, 0, p_loads, u32_num_loads);
+
+	free(p_loads);
+}
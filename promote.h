@@ -0,0 +1,24 @@
+#ifndef PROMOTE_H
+#define PROMOTE_H
+
+#include "common.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _PROMOTE_result
+{
+	uint32_t	u32_num_promoted;				// Variables held in a register for the whole program
+	uint32_t	u32_num_rewritten;				// Memory operands that became that register
+	uint32_t	u32_reserved;					// A bit per ASM_register_t they hold, for the allocator to leave alone
+} PROMOTE_result_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			PROMOTE_run						(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_num_variables, PROMOTE_result_t * p_result);
+
+#endif
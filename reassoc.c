@@ -0,0 +1,548 @@
+#include "reassoc.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_REASSOC
+#define REASSOC_DBG(fmt, ...)			printf(BOLD("REASSOC:\t")fmt, ##__VA_ARGS__)
+#define REASSOC_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("REASSOC:\t"))fmt, ##__VA_ARGS__)
+#define REASSOC_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("REASSOC:\t"))fmt, ##__VA_ARGS__)
+#define REASSOC_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("REASSOC:\t"))fmt, ##__VA_ARGS__)
+#else
+#define REASSOC_DBG(fmt, ...)
+#define REASSOC_GREEN(fmt, ...)
+#define REASSOC_WARN(fmt, ...)
+#define REASSOC_ERR(fmt, ...)
+#endif
+
+#define REASSOC_MAX(a, b)				(((a) > (b)) ? (a) : (b))
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	A value a chain combines: one of its leaves, or a node of the tree built from them
+ */
+typedef struct
+{
+	uint32_t	u32_value;
+	uint32_t	u32_height;						// Estimated cycles from the start of the program until it's ready
+	bool		b_constant;
+	uint64_t	u64_constant;					// Wrapped to the statement's type
+	uint32_t	u32_order;						// Among the leaves, so ties break the same way every time
+} REASSOC_operand_t;
+
+/*
+ *	One instruction of a rebuilt chain: what it combines and what that gives
+ */
+typedef struct
+{
+	REASSOC_operand_t	left;
+	REASSOC_operand_t	right;
+	REASSOC_operand_t	node;
+} REASSOC_step_t;
+
+typedef struct
+{
+	const IR_program_t *	kp_program;
+	IR_instruction_t *		p_output;			// The program as rewritten so far
+	uint32_t				u32_num_output;
+	uint32_t *				pu32_def;			// Per value: the instruction defining it in the input
+	uint32_t *				pu32_num_uses;		// Per value: operands naming it, less those folds used up
+	uint32_t *				pu32_heights;		// Per value: estimated cycles until it's ready
+	bool *					pb_interior;		// Per instruction: inside the chain its only user is in
+	bool *					pb_rebuilt;			// Per instruction: in a chain to rebuild, root or not
+	uint32_t *				pu32_stack;
+	uint32_t *				pu32_interior;		// The chain being rebuilt: its instructions but the root
+	REASSOC_operand_t *		p_leaves;
+	REASSOC_operand_t *		p_nodes;
+	REASSOC_step_t *		p_steps;
+	REASSOC_report_t *		p_report;
+} REASSOC_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		REASSOC_find_interior			(REASSOC_info_t * p_info);
+static void 		REASSOC_choose					(REASSOC_info_t * p_info);
+static void 		REASSOC_rebuild					(REASSOC_info_t * p_info, const IR_instruction_t * kp_root);
+static uint32_t 	REASSOC_collect					(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t * pu32_num_interior);
+static uint32_t 	REASSOC_original_height			(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_interior);
+static uint32_t 	REASSOC_plan					(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_leaves, uint32_t * pu32_num_folded);
+static void 		REASSOC_emit_plan				(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_leaves);
+static void 		REASSOC_measure					(REASSOC_info_t * p_info, const IR_instruction_t * kp_instruction);
+static int 			REASSOC_compare_operands		(const void * kp_left, const void * kp_right);
+static inline bool 	REASSOC_precedes				(const REASSOC_operand_t * kp_left, const REASSOC_operand_t * kp_right);
+static inline bool 	REASSOC_is_chain_opcode			(uint8_t u8_opcode);
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	The scheduler's figures for what each instruction selects to, rounded. A load is a leaf and
+ *	only its own latency matters, an L1 hit
+ */
+static const uint8_t pku8_latencies[IR_OPCODE_NUM_OPCODES] =
+{
+	[IR_OPCODE_CONST]			= 0,
+	[IR_OPCODE_LOAD]			= 5,
+	[IR_OPCODE_STORE]			= 1,
+	[IR_OPCODE_ADD]				= 1,
+	[IR_OPCODE_SUB]				= 1,
+	[IR_OPCODE_MUL]				= 3,
+	[IR_OPCODE_DIV]				= 26,
+	[IR_OPCODE_VLOAD]			= 5,
+	[IR_OPCODE_VSPLAT]			= 1,
+	[IR_OPCODE_VADD]			= 1,
+	[IR_OPCODE_VSUB]			= 1,
+	[IR_OPCODE_VSTORE]			= 1,
+};
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	The parser nests a + b + c + d to the left, so each add waits for the one before it and the
+ *	chain takes as many steps as it has operands. Adds and multiplies wrap, so they are
+ *	associative and commutative in every statement type, and a chain of either can be computed
+ *	in any order. A chain is an add or multiply with the instructions of the same opcode and type
+ *	that only it uses, transitively; shared values are its leaves, so nothing computed twice. It
+ *	is rebuilt just before its root, which is where all of its leaves are ready, by combining the
+ *	two leaves or partial results ready soonest until one is left: Huffman's algorithm on
+ *	heights, which gives log n steps when the leaves are ready together. Constants pair off first
+ *	and are folded. The rebuilt chain keeps its root's value, and is only kept if it's shorter, or
+ *	as short with fewer instructions
+ */
+void REASSOC_run(IR_program_t * p_program, REASSOC_report_t * p_report)
+{
+	uint32_t u32_num_instructions = p_program->u32_num_instructions;
+	uint32_t u32_num_values = p_program->u32_num_values;
+	REASSOC_info_t info;
+	uint32_t u32_num_kept = 0;
+
+	info.kp_program = p_program;
+	info.p_output = malloc(sizeof(IR_instruction_t) * (p_program->u32_capacity + 1));
+	info.u32_num_output = 0;
+	info.pu32_def = malloc(sizeof(uint32_t) * (u32_num_values + 1));
+	info.pu32_num_uses = calloc(u32_num_values + 1, sizeof(uint32_t));
+	info.pu32_heights = calloc(u32_num_values + 1, sizeof(uint32_t));
+	info.pb_interior = calloc(u32_num_instructions + 1, sizeof(bool));
+	info.pb_rebuilt = calloc(u32_num_instructions + 1, sizeof(bool));
+	info.pu32_stack = malloc(sizeof(uint32_t) * (u32_num_instructions + 1) * IR_MAX_OPERANDS);
+	info.pu32_interior = malloc(sizeof(uint32_t) * (u32_num_instructions + 1));
+	info.p_leaves = malloc(sizeof(REASSOC_operand_t) * (u32_num_instructions + 1) * IR_MAX_OPERANDS);
+	info.p_nodes = malloc(sizeof(REASSOC_operand_t) * (u32_num_instructions + 1));
+	info.p_steps = malloc(sizeof(REASSOC_step_t) * (u32_num_instructions + 1));
+	info.p_report = p_report;
+	ASSERT(info.p_output && info.pu32_def && info.pu32_num_uses && info.pu32_heights && info.pb_interior && info.pb_rebuilt);
+	ASSERT(info.pu32_stack && info.pu32_interior && info.p_leaves && info.p_nodes && info.p_steps);
+
+	p_report->u32_num_chains = 0;
+	p_report->u32_num_operands = 0;
+	p_report->u32_height_before = 0;
+	p_report->u32_height_after = 0;
+	p_report->u32_num_folded = 0;
+
+	REASSOC_find_interior(&info);
+	REASSOC_choose(&info);
+
+	// Chains left alone stay where they were; rebuilt ones move to their roots
+	for (uint32_t i = 0; i < u32_num_instructions; i++)
+	{
+		if (!info.pb_rebuilt[i])
+		{
+			info.p_output[info.u32_num_output++] = p_program->p_instructions[i];
+		}
+		else if (!info.pb_interior[i])
+		{
+			REASSOC_rebuild(&info, &p_program->p_instructions[i]);
+		}
+	}
+
+	ASSERT(info.u32_num_output == u32_num_instructions);
+
+	// Constants the folds used up, which dead code elimination has already been past
+	for (uint32_t i = 0; i < info.u32_num_output; i++)
+	{
+		if (info.p_output[i].u8_opcode != IR_OPCODE_CONST || info.pu32_num_uses[info.p_output[i].u32_result] > 0)
+		{
+			info.p_output[u32_num_kept++] = info.p_output[i];
+		}
+	}
+
+	free(p_program->p_instructions);
+	p_program->p_instructions = info.p_output;
+	p_program->u32_num_instructions = u32_num_kept;
+
+	free(info.pu32_def);
+	free(info.pu32_num_uses);
+	free(info.pu32_heights);
+	free(info.pb_interior);
+	free(info.pb_rebuilt);
+	free(info.pu32_stack);
+	free(info.pu32_interior);
+	free(info.p_leaves);
+	free(info.p_nodes);
+	free(info.p_steps);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	An add or multiply is inside a chain if its value has a single use, by an instruction of the
+ *	same opcode and type. Anything else of either opcode is the root of a chain, if only of itself
+ */
+static void REASSOC_find_interior(REASSOC_info_t * p_info)
+{
+	const IR_instruction_t * kp_instructions = p_info->kp_program->p_instructions;
+	const IR_instruction_t * kp_instruction;
+	const IR_instruction_t * kp_operand;
+
+	for (uint32_t i = 0; i < p_info->kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_instructions[i];
+
+		if (kp_instruction->u32_result != IR_VALUE_NONE)
+		{
+			p_info->pu32_def[kp_instruction->u32_result] = i;
+		}
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (kp_instruction->pu32_operands[j] != IR_VALUE_NONE)
+			{
+				p_info->pu32_num_uses[kp_instruction->pu32_operands[j]]++;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < p_info->kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_instructions[i];
+
+		if (!REASSOC_is_chain_opcode(kp_instruction->u8_opcode))
+		{
+			continue;
+		}
+
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			kp_operand = &kp_instructions[p_info->pu32_def[kp_instruction->pu32_operands[j]]];
+
+			if (kp_operand->u8_opcode == kp_instruction->u8_opcode && kp_operand->u8_type == kp_instruction->u8_type &&
+				p_info->pu32_num_uses[kp_operand->u32_result] == 1)
+			{
+				p_info->pb_interior[p_info->pu32_def[kp_operand->u32_result]] = true;
+			}
+		}
+	}
+}
+
+/*
+ *	Forward over the program, working out when each value is ready as rebuilding the chains
+ *	before it left them. Which chains to rebuild is settled here, before anything moves
+ */
+static void REASSOC_choose(REASSOC_info_t * p_info)
+{
+	const IR_instruction_t * kp_instruction;
+	uint32_t u32_num_leaves;
+	uint32_t u32_num_interior;
+	uint32_t u32_height_before;
+	uint32_t u32_height_after;
+	uint32_t u32_num_folded;
+
+	for (uint32_t i = 0; i < p_info->kp_program->u32_num_instructions; i++)
+	{
+		kp_instruction = &p_info->kp_program->p_instructions[i];
+
+		if (p_info->pb_interior[i])
+		{
+			// Measured with the rest of its chain at the root
+			continue;
+		}
+
+		if (!REASSOC_is_chain_opcode(kp_instruction->u8_opcode))
+		{
+			REASSOC_measure(p_info, kp_instruction);
+			continue;
+		}
+
+		u32_num_leaves = REASSOC_collect(p_info, kp_instruction, &u32_num_interior);
+		u32_height_before = REASSOC_original_height(p_info, kp_instruction, u32_num_interior);
+		u32_num_folded = 0;
+		u32_height_after = (u32_num_leaves > 2) ? REASSOC_plan(p_info, kp_instruction, u32_num_leaves, &u32_num_folded) : u32_height_before;
+
+		// No slower, and folding makes it smaller
+		if (u32_height_after < u32_height_before || (u32_height_after == u32_height_before && u32_num_folded > 0))
+		{
+			REASSOC_DBG("%%%u: %u operands, %u cycles down to %u\n", kp_instruction->u32_result, u32_num_leaves, u32_height_before, u32_height_after);
+
+			p_info->pb_rebuilt[i] = true;
+
+			for (uint32_t j = 0; j < u32_num_interior; j++)
+			{
+				p_info->pb_rebuilt[p_info->pu32_interior[j]] = true;
+			}
+
+			for (uint32_t j = 0; j + 1 < u32_num_leaves; j++)
+			{
+				p_info->pu32_heights[p_info->p_nodes[j].u32_value] = p_info->p_nodes[j].u32_height;
+			}
+
+			p_info->p_report->u32_num_chains++;
+			p_info->p_report->u32_num_operands += u32_num_leaves;
+			p_info->p_report->u32_height_before += u32_height_before;
+			p_info->p_report->u32_height_after += u32_height_after;
+			p_info->p_report->u32_num_folded += u32_num_folded;
+		}
+	}
+}
+
+/*
+ *	Plans the chain again, which comes out as it did when it was chosen: nothing since has
+ *	changed when its leaves are ready
+ */
+static void REASSOC_rebuild(REASSOC_info_t * p_info, const IR_instruction_t * kp_root)
+{
+	uint32_t u32_num_interior;
+	uint32_t u32_num_folded = 0;
+	uint32_t u32_num_leaves = REASSOC_collect(p_info, kp_root, &u32_num_interior);
+
+	REASSOC_plan(p_info, kp_root, u32_num_leaves, &u32_num_folded);
+	REASSOC_emit_plan(p_info, kp_root, u32_num_leaves);
+}
+
+/*
+ *	The chain under a root: its leaves, sorted by when they're ready with constants first, and its
+ *	other instructions in the order of the input. Returns how many leaves
+ */
+static uint32_t REASSOC_collect(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t * pu32_num_interior)
+{
+	const IR_instruction_t * kp_instructions = p_info->kp_program->p_instructions;
+	const IR_instruction_t * kp_leaf;
+	REASSOC_operand_t * p_leaf;
+	uint32_t u32_num_stacked = 0;
+	uint32_t u32_num_leaves = 0;
+	uint32_t u32_num_interior = 0;
+	uint32_t u32_value;
+	uint32_t u32_def;
+
+	for (uint32_t j = IR_MAX_OPERANDS; j > 0; j--)
+	{
+		p_info->pu32_stack[u32_num_stacked++] = kp_root->pu32_operands[j - 1];
+	}
+
+	while (u32_num_stacked > 0)
+	{
+		u32_value = p_info->pu32_stack[--u32_num_stacked];
+		u32_def = p_info->pu32_def[u32_value];
+
+		if (p_info->pb_interior[u32_def])
+		{
+			p_info->pu32_interior[u32_num_interior++] = u32_def;
+
+			for (uint32_t j = IR_MAX_OPERANDS; j > 0; j--)
+			{
+				p_info->pu32_stack[u32_num_stacked++] = kp_instructions[u32_def].pu32_operands[j - 1];
+			}
+
+			continue;
+		}
+
+		kp_leaf = &kp_instructions[u32_def];
+		p_leaf = &p_info->p_leaves[u32_num_leaves];
+		p_leaf->u32_value = u32_value;
+		p_leaf->u32_height = p_info->pu32_heights[u32_value];
+		p_leaf->b_constant = (kp_leaf->u8_opcode == IR_OPCODE_CONST);
+		p_leaf->u64_constant = kp_leaf->u32_immediate;
+		p_leaf->u32_order = u32_num_leaves++;
+	}
+
+	qsort(p_info->p_leaves, u32_num_leaves, sizeof(REASSOC_operand_t), REASSOC_compare_operands);
+
+	// Interior instructions are unique to the chain, so sorting their indices needs nothing stable
+	for (uint32_t i = 1; i < u32_num_interior; i++)
+	{
+		u32_def = p_info->pu32_interior[i];
+
+		for (u32_value = i; u32_value > 0 && p_info->pu32_interior[u32_value - 1] > u32_def; u32_value--)
+		{
+			p_info->pu32_interior[u32_value] = p_info->pu32_interior[u32_value - 1];
+		}
+
+		p_info->pu32_interior[u32_value] = u32_def;
+	}
+
+	*pu32_num_interior = u32_num_interior;
+
+	return u32_num_leaves;
+}
+
+/*
+ *	How long the chain takes as the input has it. Its instructions come in the input's order, so
+ *	each one's operands have their heights by the time it's reached
+ */
+static uint32_t REASSOC_original_height(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_interior)
+{
+	const IR_instruction_t * kp_instruction;
+
+	for (uint32_t i = 0; i <= u32_num_interior; i++)
+	{
+		kp_instruction = (i < u32_num_interior) ? &p_info->kp_program->p_instructions[p_info->pu32_interior[i]] : kp_root;
+
+		p_info->pu32_heights[kp_instruction->u32_result] = pku8_latencies[kp_instruction->u8_opcode] +
+			REASSOC_MAX(p_info->pu32_heights[kp_instruction->pu32_operands[0]], p_info->pu32_heights[kp_instruction->pu32_operands[1]]);
+	}
+
+	return p_info->pu32_heights[kp_root->u32_result];
+}
+
+/*
+ *	Combines the two operands ready soonest until one is left. The leaves are sorted, and every
+ *	node is ready no sooner than the one made before it, so the soonest is at the front of one of
+ *	the two lists. Two constants fold when the result fits an immediate. Nodes take the values the
+ *	chain's other instructions had, since nothing outside it used them, and the last takes the
+ *	root's. Returns the height of the last node
+ */
+static uint32_t REASSOC_plan(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_leaves, uint32_t * pu32_num_folded)
+{
+	uint32_t u32_latency = pku8_latencies[kp_root->u8_opcode];
+	bool b_wide = (BUILTINS_get_size(kp_root->u8_type) == sizeof(uint64_t));
+	REASSOC_operand_t * pp_picks[IR_MAX_OPERANDS];
+	REASSOC_step_t * p_step;
+	uint32_t u32_next_leaf = 0;
+	uint32_t u32_next_node = 0;
+	uint64_t u64_constant;
+
+	for (uint32_t i = 0; i + 1 < u32_num_leaves; i++)
+	{
+		for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+		{
+			if (u32_next_leaf < u32_num_leaves && (u32_next_node == i || !REASSOC_precedes(&p_info->p_nodes[u32_next_node], &p_info->p_leaves[u32_next_leaf])))
+			{
+				pp_picks[j] = &p_info->p_leaves[u32_next_leaf++];
+			}
+			else
+			{
+				pp_picks[j] = &p_info->p_nodes[u32_next_node++];
+			}
+		}
+
+		p_step = &p_info->p_steps[i];
+		p_step->left = *pp_picks[0];
+		p_step->right = *pp_picks[1];
+		p_step->node.u32_value = (i + 2 < u32_num_leaves) ? p_info->kp_program->p_instructions[p_info->pu32_interior[i]].u32_result : kp_root->u32_result;
+		p_step->node.u32_order = i;
+		p_step->node.b_constant = false;
+
+		if (p_step->left.b_constant && p_step->right.b_constant)
+		{
+			u64_constant = (kp_root->u8_opcode == IR_OPCODE_ADD) ? (p_step->left.u64_constant + p_step->right.u64_constant) :
+				(p_step->left.u64_constant * p_step->right.u64_constant);
+			u64_constant = b_wide ? u64_constant : (u64_constant & UINT32_MAX);
+
+			p_step->node.b_constant = (u64_constant <= UINT32_MAX);
+			p_step->node.u64_constant = u64_constant;
+			*pu32_num_folded += p_step->node.b_constant;
+		}
+
+		p_step->node.u32_height = p_step->node.b_constant ? 0 : u32_latency + REASSOC_MAX(p_step->left.u32_height, p_step->right.u32_height);
+		p_info->p_nodes[i] = p_step->node;
+	}
+
+	return p_info->p_nodes[u32_num_leaves - 2].u32_height;
+}
+
+/*
+ *	Writes the plan out where the root was
+ */
+static void REASSOC_emit_plan(REASSOC_info_t * p_info, const IR_instruction_t * kp_root, uint32_t u32_num_leaves)
+{
+	const REASSOC_step_t * kp_step;
+	IR_instruction_t instruction;
+
+	for (uint32_t i = 0; i + 1 < u32_num_leaves; i++)
+	{
+		kp_step = &p_info->p_steps[i];
+		instruction = *kp_root;
+		instruction.u32_result = kp_step->node.u32_value;
+
+		if (kp_step->node.b_constant)
+		{
+			instruction.u8_opcode = IR_OPCODE_CONST;
+			instruction.u8_variable_type = BUILTINS_TYPE_U32;
+			instruction.pu32_operands[0] = IR_VALUE_NONE;
+			instruction.pu32_operands[1] = IR_VALUE_NONE;
+			instruction.u32_immediate = (uint32_t)kp_step->node.u64_constant;
+			p_info->pu32_num_uses[kp_step->left.u32_value]--;
+			p_info->pu32_num_uses[kp_step->right.u32_value]--;
+		}
+		else
+		{
+			// A constant goes on the right, where it can be an immediate
+			instruction.pu32_operands[0] = kp_step->left.b_constant ? kp_step->right.u32_value : kp_step->left.u32_value;
+			instruction.pu32_operands[1] = kp_step->left.b_constant ? kp_step->left.u32_value : kp_step->right.u32_value;
+		}
+
+		p_info->p_output[p_info->u32_num_output++] = instruction;
+	}
+}
+
+/*
+ *	When an instruction outside any chain has its value ready
+ */
+static void REASSOC_measure(REASSOC_info_t * p_info, const IR_instruction_t * kp_instruction)
+{
+	uint32_t u32_height = 0;
+
+	for (uint32_t j = 0; j < IR_MAX_OPERANDS; j++)
+	{
+		if (kp_instruction->pu32_operands[j] != IR_VALUE_NONE)
+		{
+			u32_height = REASSOC_MAX(u32_height, p_info->pu32_heights[kp_instruction->pu32_operands[j]]);
+		}
+	}
+
+	if (kp_instruction->u32_result != IR_VALUE_NONE)
+	{
+		p_info->pu32_heights[kp_instruction->u32_result] = u32_height + pku8_latencies[kp_instruction->u8_opcode];
+	}
+}
+
+/*
+ *	Ready soonest first, then constants, then the order the chain had them in
+ */
+static int REASSOC_compare_operands(const void * kp_left, const void * kp_right)
+{
+	const REASSOC_operand_t * kp_left_operand = kp_left;
+	const REASSOC_operand_t * kp_right_operand = kp_right;
+
+	if (REASSOC_precedes(kp_left_operand, kp_right_operand))
+	{
+		return -1;
+	}
+
+	if (REASSOC_precedes(kp_right_operand, kp_left_operand))
+	{
+		return 1;
+	}
+
+	return (kp_left_operand->u32_order > kp_right_operand->u32_order) - (kp_left_operand->u32_order < kp_right_operand->u32_order);
+}
+
+static inline bool REASSOC_precedes(const REASSOC_operand_t * kp_left, const REASSOC_operand_t * kp_right)
+{
+	return kp_left->u32_height < kp_right->u32_height || (kp_left->u32_height == kp_right->u32_height && kp_left->b_constant && !kp_right->b_constant);
+}
+
+static inline bool REASSOC_is_chain_opcode(uint8_t u8_opcode)
+{
+	return u8_opcode == IR_OPCODE_ADD || u8_opcode == IR_OPCODE_MUL;
+}
@@ -0,0 +1,26 @@
+#ifndef REASSOC_H
+#define REASSOC_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _REASSOC_report
+{
+	uint32_t	u32_num_chains;					// Chains of adds or of multiplies rebuilt as balanced trees
+	uint32_t	u32_num_operands;				// What those chains combined
+	uint32_t	u32_height_before;				// Estimated cycles through the chains, summed over them
+	uint32_t	u32_height_after;
+	uint32_t	u32_num_folded;					// Pairs of constants they combined, brought together by the rebuild
+} REASSOC_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			REASSOC_run						(IR_program_t * p_program, REASSOC_report_t * p_report);
+
+#endif
@@ -0,0 +1,447 @@
+#include "regalloc.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_REGALLOC
+#define REGALLOC_DBG(fmt, ...)			printf(BOLD("REGALLOC:\t")fmt, ##__VA_ARGS__)
+#define REGALLOC_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("REGALLOC:\t"))fmt, ##__VA_ARGS__)
+#define REGALLOC_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("REGALLOC:\t"))fmt, ##__VA_ARGS__)
+#define REGALLOC_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("REGALLOC:\t"))fmt, ##__VA_ARGS__)
+#else
+#define REGALLOC_DBG(fmt, ...)
+#define REGALLOC_GREEN(fmt, ...)
+#define REGALLOC_WARN(fmt, ...)
+#define REGALLOC_ERR(fmt, ...)
+#endif
+
+#define REGALLOC_POSITION_NONE			(UINT32_MAX)
+#define REGALLOC_IS_MEMORY(kind)		((kind) == ASM_OPERAND_VARIABLE || (kind) == ASM_OPERAND_STACK)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef enum
+{
+	REGALLOC_LOCATION_NONE = 0,
+	REGALLOC_LOCATION_REGISTER,
+	REGALLOC_LOCATION_STACK,
+} REGALLOC_location_kind_t;
+
+/*
+ *	A virtual register's live interval (instruction indices, inclusive) and where it ended up
+ */
+typedef struct
+{
+	uint32_t					u32_start;
+	uint32_t					u32_end;
+	REGALLOC_location_kind_t	location;
+	uint32_t					u32_location;		// ASM_register_t or stack offset
+	bool						b_avoid_rdx;		// Live across something that writes rdx
+} REGALLOC_interval_t;
+
+typedef struct
+{
+	REGALLOC_interval_t *	p_intervals;
+	uint32_t *				pu32_active;						// vregs currently holding a register
+	uint32_t				u32_num_active;
+	uint32_t *				pu32_slot_ends;						// Last use of whatever is in each stack slot
+	uint32_t				u32_num_slots;
+	uint32_t				u32_slot_capacity;
+	bool					pb_register_free[ASM_REGISTER_NUM_REGISTERS];
+	uint32_t				u32_num_spilled;
+} REGALLOC_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	Everything but rsp, the variable base (rdi) and the spill register (rax), in order of preference:
+ *	caller-saved first since those cost no push/pop. rdx is fine too, except across a div
+ */
+static const ASM_register_t pk_allocatable_registers[REGALLOC_NUM_ALLOCATABLE] =
+{
+	ASM_REGISTER_RCX,
+	ASM_REGISTER_RSI,
+	ASM_REGISTER_R8,
+	ASM_REGISTER_R9,
+	ASM_REGISTER_R10,
+	ASM_REGISTER_R11,
+	ASM_REGISTER_RDX,
+	ASM_REGISTER_RBX,
+	ASM_REGISTER_RBP,
+	ASM_REGISTER_R12,
+	ASM_REGISTER_R13,
+	ASM_REGISTER_R14,
+	ASM_REGISTER_R15,
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		REGALLOC_build_intervals		(REGALLOC_info_t * p_info, const ASM_buffer_t * kp_buffer, uint32_t u32_num_vregs);
+static void 		REGALLOC_allocate				(REGALLOC_info_t * p_info, uint32_t u32_vreg);
+static void 		REGALLOC_expire					(REGALLOC_info_t * p_info, uint32_t u32_position);
+static void 		REGALLOC_spill					(REGALLOC_info_t * p_info, uint32_t u32_vreg);
+static void 		REGALLOC_rewrite				(const REGALLOC_info_t * kp_info, ASM_buffer_t * p_buffer);
+static void 		REGALLOC_map_operand			(const REGALLOC_info_t * kp_info, uint8_t * pu8_kind, uint32_t * pu32_value);
+static bool 		REGALLOC_touches_rdx			(const ASM_instruction_t * kp_instruction);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Linear scan over straight-line code: intervals are handed registers in order of their start,
+ *	and when none is left the one that lives longest goes to a stack slot. Virtual register operands
+ *	are then rewritten in place to registers or stack slots. Registers with their bit set in
+ *	`u32_reserved` are never handed out
+ */
+void REGALLOC_run(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_reserved, REGALLOC_result_t * p_result)
+{
+	REGALLOC_info_t info = { 0 };
+	const ASM_instruction_t * kp_instruction;
+
+	info.p_intervals = malloc(sizeof(REGALLOC_interval_t) * (u32_num_vregs + 1));
+	info.pu32_active = malloc(sizeof(uint32_t) * REGALLOC_NUM_ALLOCATABLE);
+	info.u32_slot_capacity = 16;
+	info.pu32_slot_ends = malloc(sizeof(uint32_t) * info.u32_slot_capacity);
+	ASSERT(info.p_intervals && info.pu32_active && info.pu32_slot_ends);
+
+	for (uint32_t i = 0; i < REGALLOC_NUM_ALLOCATABLE; i++)
+	{
+		info.pb_register_free[pk_allocatable_registers[i]] = ((u32_reserved & (1u << pk_allocatable_registers[i])) == 0);
+	}
+
+	REGALLOC_build_intervals(&info, p_buffer, u32_num_vregs);
+
+	// Walking the code in order meets every interval in order of its start
+	for (uint32_t i = 0; i < p_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &p_buffer->p_instructions[i];
+
+		REGALLOC_expire(&info, i);
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL && info.p_intervals[kp_instruction->u32_src].u32_start == i)
+		{
+			REGALLOC_allocate(&info, kp_instruction->u32_src);
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL && info.p_intervals[kp_instruction->u32_dst].u32_start == i &&
+			info.p_intervals[kp_instruction->u32_dst].location == REGALLOC_LOCATION_NONE)
+		{
+			REGALLOC_allocate(&info, kp_instruction->u32_dst);
+		}
+	}
+
+	REGALLOC_rewrite(&info, p_buffer);
+
+	p_result->u32_num_vregs = u32_num_vregs;
+	p_result->u32_num_spilled = info.u32_num_spilled;
+	p_result->u32_frame_size = info.u32_num_slots * REGALLOC_SLOT_SIZE;
+
+	REGALLOC_DBG("%u virtual registers, %u spilled to %u stack slots\n", u32_num_vregs, info.u32_num_spilled, info.u32_num_slots);
+
+	free(info.p_intervals);
+	free(info.pu32_active);
+	free(info.pu32_slot_ends);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Code is straight-line, so an interval runs from a virtual register's first mention to its last
+ */
+static void REGALLOC_build_intervals(REGALLOC_info_t * p_info, const ASM_buffer_t * kp_buffer, uint32_t u32_num_vregs)
+{
+	const ASM_instruction_t * kp_instruction;
+	uint32_t * pu32_rdx_writes = malloc(sizeof(uint32_t) * (kp_buffer->u32_num_instructions + 1));
+	uint32_t pu32_vregs[2];
+	uint32_t u32_num_operands;
+	REGALLOC_interval_t * p_interval;
+
+	ASSERT(pu32_rdx_writes);
+
+	for (uint32_t i = 0; i < u32_num_vregs; i++)
+	{
+		p_info->p_intervals[i] = (REGALLOC_interval_t)
+		{
+			.u32_start		= REGALLOC_POSITION_NONE,
+			.u32_end		= 0,
+			.location		= REGALLOC_LOCATION_NONE,
+		};
+	}
+
+	// Running count of instructions that touch rdx, so any interval can check for one in O(1)
+	pu32_rdx_writes[0] = 0;
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+		pu32_rdx_writes[i + 1] = pu32_rdx_writes[i] + (REGALLOC_touches_rdx(kp_instruction) ? 1 : 0);
+
+		u32_num_operands = 0;
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_vregs[u32_num_operands++] = kp_instruction->u32_src;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_vregs[u32_num_operands++] = kp_instruction->u32_dst;
+		}
+
+		for (uint32_t j = 0; j < u32_num_operands; j++)
+		{
+			ASSERT(pu32_vregs[j] < u32_num_vregs);
+			p_interval = &p_info->p_intervals[pu32_vregs[j]];
+
+			if (p_interval->u32_start == REGALLOC_POSITION_NONE)
+			{
+				p_interval->u32_start = i;
+			}
+			p_interval->u32_end = i;
+		}
+	}
+
+	for (uint32_t i = 0; i < u32_num_vregs; i++)
+	{
+		p_interval = &p_info->p_intervals[i];
+
+		if (p_interval->u32_start != REGALLOC_POSITION_NONE)
+		{
+			p_interval->b_avoid_rdx = (pu32_rdx_writes[p_interval->u32_end + 1] - pu32_rdx_writes[p_interval->u32_start]) > 0;
+		}
+	}
+
+	free(pu32_rdx_writes);
+}
+
+/*
+ *	Gives `u32_vreg` a free register, or makes room by spilling whichever active interval ends last
+ */
+static void REGALLOC_allocate(REGALLOC_info_t * p_info, uint32_t u32_vreg)
+{
+	REGALLOC_interval_t * p_interval = &p_info->p_intervals[u32_vreg];
+	REGALLOC_interval_t * p_victim;
+	uint32_t u32_victim_index = REGALLOC_POSITION_NONE;
+	ASM_register_t reg;
+
+	for (uint32_t i = 0; i < REGALLOC_NUM_ALLOCATABLE; i++)
+	{
+		reg = pk_allocatable_registers[i];
+
+		if (p_info->pb_register_free[reg] && !(reg == ASM_REGISTER_RDX && p_interval->b_avoid_rdx))
+		{
+			p_info->pb_register_free[reg] = false;
+			p_interval->location = REGALLOC_LOCATION_REGISTER;
+			p_interval->u32_location = reg;
+			p_info->pu32_active[p_info->u32_num_active++] = u32_vreg;
+			return;
+		}
+	}
+
+	// Out of registers: the furthest-ending active interval whose register we're allowed to take
+	for (uint32_t i = 0; i < p_info->u32_num_active; i++)
+	{
+		p_victim = &p_info->p_intervals[p_info->pu32_active[i]];
+
+		if (p_victim->u32_location == ASM_REGISTER_RDX && p_interval->b_avoid_rdx)
+		{
+			continue;
+		}
+
+		if (u32_victim_index == REGALLOC_POSITION_NONE || p_victim->u32_end > p_info->p_intervals[p_info->pu32_active[u32_victim_index]].u32_end)
+		{
+			u32_victim_index = i;
+		}
+	}
+
+	if (u32_victim_index != REGALLOC_POSITION_NONE && p_info->p_intervals[p_info->pu32_active[u32_victim_index]].u32_end > p_interval->u32_end)
+	{
+		p_victim = &p_info->p_intervals[p_info->pu32_active[u32_victim_index]];
+
+		p_interval->location = REGALLOC_LOCATION_REGISTER;
+		p_interval->u32_location = p_victim->u32_location;
+		REGALLOC_spill(p_info, p_info->pu32_active[u32_victim_index]);
+		p_info->pu32_active[u32_victim_index] = u32_vreg;
+	}
+	else
+	{
+		REGALLOC_spill(p_info, u32_vreg);
+	}
+}
+
+/*
+ *	Frees the registers of intervals that ended before `u32_position`
+ */
+static void REGALLOC_expire(REGALLOC_info_t * p_info, uint32_t u32_position)
+{
+	REGALLOC_interval_t * p_interval;
+	uint32_t i = 0;
+
+	while (i < p_info->u32_num_active)
+	{
+		p_interval = &p_info->p_intervals[p_info->pu32_active[i]];
+
+		if (p_interval->u32_end < u32_position)
+		{
+			p_info->pb_register_free[p_interval->u32_location] = true;
+			p_info->pu32_active[i] = p_info->pu32_active[--p_info->u32_num_active];
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/*
+ *	Moves an interval to a stack slot, reusing one whose previous occupant is dead
+ */
+static void REGALLOC_spill(REGALLOC_info_t * p_info, uint32_t u32_vreg)
+{
+	REGALLOC_interval_t * p_interval = &p_info->p_intervals[u32_vreg];
+	uint32_t u32_slot = p_info->u32_num_slots;
+
+	for (uint32_t i = 0; i < p_info->u32_num_slots; i++)
+	{
+		if (p_info->pu32_slot_ends[i] < p_interval->u32_start)
+		{
+			u32_slot = i;
+			break;
+		}
+	}
+
+	if (u32_slot == p_info->u32_num_slots)
+	{
+		if (p_info->u32_num_slots == p_info->u32_slot_capacity)
+		{
+			p_info->u32_slot_capacity *= 2;
+			p_info->pu32_slot_ends = realloc(p_info->pu32_slot_ends, sizeof(uint32_t) * p_info->u32_slot_capacity);
+			ASSERT(p_info->pu32_slot_ends);
+		}
+
+		p_info->u32_num_slots++;
+	}
+
+	p_info->pu32_slot_ends[u32_slot] = p_interval->u32_end;
+	p_interval->location = REGALLOC_LOCATION_STACK;
+	p_interval->u32_location = u32_slot * REGALLOC_SLOT_SIZE;
+	p_info->u32_num_spilled++;
+}
+
+/*
+ *	Replaces virtual registers with their locations. x86 allows at most one memory operand, imul and
+ *	the extensions have to write a register and lea has to use them on both sides, so spilled operands
+ *	sometimes go through REGALLOC_SPILL_REGISTER
+ */
+static void REGALLOC_rewrite(const REGALLOC_info_t * kp_info, ASM_buffer_t * p_buffer)
+{
+	ASM_buffer_t rewritten;
+	ASM_instruction_t instruction;
+	ASM_width_t width;
+	uint8_t u8_scale;
+
+	ASM_init_buffer(&rewritten);
+
+	for (uint32_t i = 0; i < p_buffer->u32_num_instructions; i++)
+	{
+		instruction = p_buffer->p_instructions[i];
+		width = instruction.u8_width;
+
+		REGALLOC_map_operand(kp_info, &instruction.u8_src_kind, &instruction.u32_src);
+		REGALLOC_map_operand(kp_info, &instruction.u8_dst_kind, &instruction.u32_dst);
+
+		if (instruction.u8_opcode == ASM_OPCODE_IMUL && REGALLOC_IS_MEMORY(instruction.u8_dst_kind))
+		{
+			// Multiply in the spill register and store back
+			ASM_emit(&rewritten, ASM_OPCODE_MOV, width, instruction.u8_dst_kind, instruction.u32_dst, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			ASM_emit(&rewritten, ASM_OPCODE_IMUL, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			ASM_emit(&rewritten, ASM_OPCODE_MOV, width, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER, instruction.u8_dst_kind, instruction.u32_dst);
+		}
+		else if (ASM_IS_EXTENSION(instruction.u8_opcode) && REGALLOC_IS_MEMORY(instruction.u8_dst_kind))
+		{
+			// Extend into the spill register and store all of what a zero extension wrote
+			ASM_emit(&rewritten, instruction.u8_opcode, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			ASM_emit(&rewritten, ASM_OPCODE_MOV, ASM_IS_ZERO_EXTENSION(instruction.u8_opcode) ? ASM_WIDTH_64 : width,
+				ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER, instruction.u8_dst_kind, instruction.u32_dst);
+		}
+		else if (ASM_IS_SCALED_ADD(instruction.u8_opcode) && REGALLOC_IS_MEMORY(instruction.u8_dst_kind))
+		{
+			// Scale in the spill register and add it to memory
+			u8_scale = ASM_get_lea_scale(instruction.u8_opcode);
+			ASM_emit(&rewritten, ASM_OPCODE_MOV, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			ASM_emit(&rewritten, ASM_OPCODE_SHL, width, ASM_OPERAND_IMMEDIATE, (u8_scale == 2) ? 1 : ((u8_scale == 4) ? 2 : 3),
+				ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			ASM_emit(&rewritten, ASM_OPCODE_ADD, width, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER, instruction.u8_dst_kind, instruction.u32_dst);
+		}
+		else if (ASM_IS_LEA(instruction.u8_opcode) && (REGALLOC_IS_MEMORY(instruction.u8_src_kind) || REGALLOC_IS_MEMORY(instruction.u8_dst_kind)))
+		{
+			// lea only works between registers, so both sides go through the spill register
+			if (REGALLOC_IS_MEMORY(instruction.u8_src_kind))
+			{
+				ASM_emit(&rewritten, ASM_OPCODE_MOV, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+				instruction.u8_src_kind = ASM_OPERAND_REGISTER;
+				instruction.u32_src = REGALLOC_SPILL_REGISTER;
+			}
+
+			if (REGALLOC_IS_MEMORY(instruction.u8_dst_kind))
+			{
+				ASM_emit(&rewritten, instruction.u8_opcode, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+				ASM_emit(&rewritten, ASM_OPCODE_MOV, width, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER, instruction.u8_dst_kind, instruction.u32_dst);
+			}
+			else
+			{
+				ASM_append_instruction(&rewritten, &instruction);
+			}
+		}
+		else if (REGALLOC_IS_MEMORY(instruction.u8_src_kind) && REGALLOC_IS_MEMORY(instruction.u8_dst_kind))
+		{
+			// Load the source first
+			ASM_emit(&rewritten, ASM_OPCODE_MOV, width, instruction.u8_src_kind, instruction.u32_src, ASM_OPERAND_REGISTER, REGALLOC_SPILL_REGISTER);
+			instruction.u8_src_kind = ASM_OPERAND_REGISTER;
+			instruction.u32_src = REGALLOC_SPILL_REGISTER;
+			ASM_append_instruction(&rewritten, &instruction);
+		}
+		else
+		{
+			ASM_append_instruction(&rewritten, &instruction);
+		}
+	}
+
+	ASM_deinit_buffer(p_buffer);
+	*p_buffer = rewritten;
+}
+
+static void REGALLOC_map_operand(const REGALLOC_info_t * kp_info, uint8_t * pu8_kind, uint32_t * pu32_value)
+{
+	const REGALLOC_interval_t * kp_interval;
+
+	if (*pu8_kind != ASM_OPERAND_VIRTUAL)
+	{
+		return;
+	}
+
+	kp_interval = &kp_info->p_intervals[*pu32_value];
+	ASSERT(kp_interval->location != REGALLOC_LOCATION_NONE);
+
+	*pu8_kind = (kp_interval->location == REGALLOC_LOCATION_REGISTER) ? ASM_OPERAND_REGISTER : ASM_OPERAND_STACK;
+	*pu32_value = kp_interval->u32_location;
+}
+
+/*
+ *	The divides and cltd write edx implicitly, anything else only by naming it
+ */
+static bool REGALLOC_touches_rdx(const ASM_instruction_t * kp_instruction)
+{
+	return kp_instruction->u8_opcode == ASM_OPCODE_DIV || kp_instruction->u8_opcode == ASM_OPCODE_IDIV ||
+			kp_instruction->u8_opcode == ASM_OPCODE_CDQ ||
+			(kp_instruction->u8_src_kind == ASM_OPERAND_REGISTER && kp_instruction->u32_src == ASM_REGISTER_RDX) ||
+			(kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER && kp_instruction->u32_dst == ASM_REGISTER_RDX);
+}
@@ -0,0 +1,40 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "common.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	Never handed out. It's the temporary for instructions whose operands both ended up in
+ *	memory, and div needs it anyway
+ */
+#define REGALLOC_SPILL_REGISTER			(ASM_REGISTER_RAX)
+#define REGALLOC_SLOT_SIZE				(sizeof(uint64_t))	// Room for a 64-bit value
+
+/*
+ *	Registers it hands out when none are reserved
+ */
+#define REGALLOC_NUM_ALLOCATABLE		(13)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _REGALLOC_result
+{
+	uint32_t	u32_num_vregs;
+	uint32_t	u32_num_spilled;		// Virtual registers that live in a stack slot
+	uint32_t	u32_frame_size;			// Bytes of stack the slots need, below the saved registers
+} REGALLOC_result_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			REGALLOC_run					(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_reserved, REGALLOC_result_t * p_result);
+
+#endif
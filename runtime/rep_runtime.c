@@ -0,0 +1,227 @@
+/*
+ *	Freestanding start-up for executables linked from rep objects, with no libc and no dynamic
+ *	loader. _start runs rep_main over zeroed storage, prints every variable as `rep --jit` does,
+ *	buffered so a short program takes a single write, and exits. Built with -ffreestanding, so
+ *	only the compiler's own headers are used
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define RUNTIME_SYS_WRITE				(1)
+#define RUNTIME_SYS_EXIT_GROUP			(231)
+#define RUNTIME_EINTR					(4)
+
+#define RUNTIME_STDOUT					(1)
+#define RUNTIME_OUTPUT_BUFFER_SIZE		(4096)
+#define RUNTIME_MAX_DIGITS				(20)	// 18446744073709551615
+#define RUNTIME_STORAGE_ALIGNMENT		(64)	// A cache line, which layout packs hot variables into
+
+#define RUNTIME_TYPE_SIGNED				(0x80)	// ASM_VARIABLE_TYPE_SIGNED. The rest of a type byte is the size
+
+/****************************************************************************************************
+ *	E X T E R N S
+ ****************************************************************************************************/
+
+extern void rep_main(uint32_t * p_variables);
+extern const uint32_t rep_num_variables;
+extern const uint32_t rep_variable_offsets[];
+extern const char rep_variable_names[];
+extern const uint8_t rep_variable_types[];
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static char pc_output[RUNTIME_OUTPUT_BUFFER_SIZE];
+static size_t output_size;
+
+/****************************************************************************************************
+ *	S T A R T - U P
+ ****************************************************************************************************/
+
+/*
+ *	The kernel enters here with the stack 16-byte aligned and nothing in registers worth keeping.
+ *	Clearing rbp ends the frame chain for a debugger, and the call leaves the stack as the ABI
+ *	expects on entry to a function
+ */
+__asm__(
+	"\t.text\n"
+	"\t.globl\t_start\n"
+	"\t.type\t_start, @function\n"
+	"_start:\n"
+	"\txorl\t%ebp, %ebp\n"
+	"\tcall\tRUNTIME_main\n"
+	"\tud2\n"
+	"\t.size\t_start, .-_start\n");
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static long RUNTIME_syscall3(long number, long arg0, long arg1, long arg2)
+{
+	long result;
+
+	__asm__ volatile ("syscall"
+		: "=a" (result)
+		: "a" (number), "D" (arg0), "S" (arg1), "d" (arg2)
+		: "rcx", "r11", "memory");
+
+	return result;
+}
+
+static __attribute__((noreturn)) void RUNTIME_exit(int status)
+{
+	for (;;)
+	{
+		RUNTIME_syscall3(RUNTIME_SYS_EXIT_GROUP, status, 0, 0);
+	}
+}
+
+/*
+ *	Writes out everything buffered, however many calls the kernel takes to accept it
+ */
+static void RUNTIME_flush(void)
+{
+	size_t written = 0;
+	long result;
+
+	while (written < output_size)
+	{
+		result = RUNTIME_syscall3(RUNTIME_SYS_WRITE, RUNTIME_STDOUT, (long)(pc_output + written), (long)(output_size - written));
+
+		if (result == -RUNTIME_EINTR)
+		{
+			continue;
+		}
+
+		if (result <= 0)
+		{
+			RUNTIME_exit(1);
+		}
+
+		written += (size_t)result;
+	}
+
+	output_size = 0;
+}
+
+static void RUNTIME_put_char(char c)
+{
+	if (output_size == RUNTIME_OUTPUT_BUFFER_SIZE)
+	{
+		RUNTIME_flush();
+	}
+
+	pc_output[output_size++] = c;
+}
+
+static void RUNTIME_put_string(const char * kpc_string)
+{
+	while (*kpc_string != '\0')
+	{
+		RUNTIME_put_char(*kpc_string++);
+	}
+}
+
+static void RUNTIME_put_u64(uint64_t u64_value)
+{
+	char pc_digits[RUNTIME_MAX_DIGITS];
+	uint32_t u32_num_digits = 0;
+
+	do
+	{
+		pc_digits[u32_num_digits++] = (char)('0' + (u64_value % 10));
+		u64_value /= 10;
+	} while (u64_value != 0);
+
+	while (u32_num_digits > 0)
+	{
+		RUNTIME_put_char(pc_digits[--u32_num_digits]);
+	}
+}
+
+/*
+ *	Reads a variable as its type byte says, widened by its signedness as BUILTINS_read does
+ */
+static uint64_t RUNTIME_read(const uint8_t * kpu8_address, uint8_t u8_type)
+{
+	uint8_t u8_size = u8_type & (uint8_t)~RUNTIME_TYPE_SIGNED;
+	uint64_t u64_value = 0;
+
+	for (uint8_t i = 0; i < u8_size; i++)
+	{
+		u64_value |= (uint64_t)kpu8_address[i] << (8 * i);
+	}
+
+	if ((u8_type & RUNTIME_TYPE_SIGNED) && u8_size < sizeof(uint64_t) && (u64_value >> ((8 * u8_size) - 1)) != 0)
+	{
+		u64_value |= ~(uint64_t)0 << (8 * u8_size);
+	}
+
+	return u64_value;
+}
+
+/*
+ *	Sized from the tables, since the objects don't record where storage ends. Zeroed by hand:
+ *	there's no memset to call
+ */
+__attribute__((used, noreturn)) void RUNTIME_main(void)
+{
+	const char * kpc_name = rep_variable_names;
+	size_t storage_size = sizeof(uint64_t);
+	volatile uint8_t * p_zero;
+	uint8_t * pu8_storage;
+	uint64_t u64_value;
+	size_t end;
+	uint8_t u8_type;
+
+	for (uint32_t i = 0; i < rep_num_variables; i++)
+	{
+		end = rep_variable_offsets[i] + (size_t)(rep_variable_types[i] & (uint8_t)~RUNTIME_TYPE_SIGNED);
+		storage_size = (end > storage_size) ? end : storage_size;
+	}
+
+	storage_size = (storage_size + RUNTIME_STORAGE_ALIGNMENT - 1) & ~(size_t)(RUNTIME_STORAGE_ALIGNMENT - 1);
+	pu8_storage = __builtin_alloca_with_align(storage_size, 8 * RUNTIME_STORAGE_ALIGNMENT);
+
+	// Through a volatile pointer, so the compiler can't turn the loop back into a memset call
+	p_zero = pu8_storage;
+
+	for (size_t i = 0; i < storage_size; i++)
+	{
+		p_zero[i] = 0;
+	}
+
+	rep_main((uint32_t *)pu8_storage);
+
+	for (uint32_t i = 0; i < rep_num_variables; i++)
+	{
+		u8_type = rep_variable_types[i];
+		u64_value = RUNTIME_read(pu8_storage + rep_variable_offsets[i], u8_type);
+
+		RUNTIME_put_string(kpc_name);
+		RUNTIME_put_string(" = ");
+
+		if ((u8_type & RUNTIME_TYPE_SIGNED) && (int64_t)u64_value < 0)
+		{
+			RUNTIME_put_char('-');
+			u64_value = 0 - u64_value;
+		}
+
+		RUNTIME_put_u64(u64_value);
+		RUNTIME_put_char('\n');
+
+		while (*kpc_name++ != '\0')
+		{
+			// Next name
+		}
+	}
+
+	RUNTIME_flush();
+	RUNTIME_exit(0);
+}
@@ -0,0 +1,1141 @@
+#include "schedule.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_SCHEDULE
+#define SCHEDULE_DBG(fmt, ...)			printf(BOLD("SCHEDULE:\t")fmt, ##__VA_ARGS__)
+#define SCHEDULE_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("SCHEDULE:\t"))fmt, ##__VA_ARGS__)
+#define SCHEDULE_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("SCHEDULE:\t"))fmt, ##__VA_ARGS__)
+#define SCHEDULE_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("SCHEDULE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define SCHEDULE_DBG(fmt, ...)
+#define SCHEDULE_GREEN(fmt, ...)
+#define SCHEDULE_WARN(fmt, ...)
+#define SCHEDULE_ERR(fmt, ...)
+#endif
+
+#define SCHEDULE_NONE					(UINT32_MAX)
+#define SCHEDULE_MAX(a, b)				(((a) > (b)) ? (a) : (b))
+#define SCHEDULE_MIN(a, b)				(((a) < (b)) ? (a) : (b))
+
+/*
+ *	Instructions a core issues per cycle, and units the scheduler picks among at once. Picking,
+ *	and checking the pick against the estimate, only ever look at one window, which keeps the cost
+ *	linear on long programs; a modern core's reorder buffer reaches a few hundred instructions, so
+ *	independent work further apart than that overlaps there anyway
+ */
+#define SCHEDULE_ISSUE_WIDTH			(4)
+#define SCHEDULE_WINDOW					(64)
+
+/*
+ *	Extra cycles when the source is a variable: an L1 hit
+ */
+#define SCHEDULE_LOAD_LATENCY			(5)
+
+/*
+ *	Divides are slower at 64 bits than the table's 32-bit figures
+ */
+#define SCHEDULE_DIV64_LATENCY			(42)
+#define SCHEDULE_DIV64_INTERVAL			(21)
+
+/*
+ *	Resources an instruction can read or write: virtual registers come first, then these, then
+ *	variables, a resource each
+ */
+#define SCHEDULE_REGISTER_BASE(vregs)	(vregs)
+#define SCHEDULE_XMM_BASE(vregs)		((vregs) + ASM_REGISTER_NUM_REGISTERS)
+#define SCHEDULE_VARIABLE_BASE(vregs)	((vregs) + ASM_REGISTER_NUM_REGISTERS + ASM_NUM_XMM_REGISTERS)
+
+/*
+ *	Registers a unit that leaves more virtual registers live than it found has to leave spare, so
+ *	the statements already started can usually go on to finish
+ */
+#define SCHEDULE_HEADROOM				(2)
+
+#define SCHEDULE_MAX_ACCESSES			(2 * (ASM_VECTOR_SIZE / sizeof(uint32_t)) + 4)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Cycles until the result can be used, and cycles before the same execution unit takes another
+ *	(0 when it's pipelined across the whole issue width)
+ */
+typedef struct
+{
+	uint8_t		u8_latency;
+	uint8_t		u8_interval;
+} SCHEDULE_timing_t;
+
+typedef struct
+{
+	uint32_t	u32_resource;
+	bool		b_write;
+} SCHEDULE_access_t;
+
+/*
+ *	What's scheduled: one instruction, or a run of them that keeps rax or rdx live from one to the
+ *	next. Those only come from divides, and allocation needs rax free between them for spill code
+ */
+typedef struct
+{
+	uint32_t	u32_first;				// Instructions [u32_first, u32_first + u32_count)
+	uint32_t	u32_count;
+	uint32_t	u32_latency;
+	uint32_t	u32_height;				// Longest latency from its issue to the end of the block
+	uint32_t	u32_num_preds;			// Not yet scheduled
+	uint32_t	u32_ready;				// Earliest cycle its operands are all there
+} SCHEDULE_unit_t;
+
+typedef struct
+{
+	uint32_t	u32_to;
+	uint32_t	u32_latency;
+} SCHEDULE_edge_t;
+
+/*
+ *	Readers of a resource since it was last written
+ */
+typedef struct
+{
+	uint32_t	u32_unit;
+	uint32_t	u32_next;
+} SCHEDULE_reader_t;
+
+typedef struct
+{
+	const ASM_buffer_t *	kp_buffer;
+	uint32_t				u32_num_vregs;
+	SCHEDULE_unit_t *		p_units;
+	uint32_t				u32_num_units;
+	uint32_t *				pu32_edge_starts;		// Per unit, its first edge to a successor
+	SCHEDULE_edge_t *		p_edges;
+	uint32_t *				pu32_vreg_starts;		// Per unit, its first entry in pu32_unit_vregs
+	uint32_t *				pu32_unit_vregs;		// Each virtual register a unit mentions, once
+	uint32_t *				pu32_remaining;			// Per virtual register, units that mention it not yet scheduled
+	bool *					pb_live;
+	uint32_t				u32_num_live;
+	bool					b_writes_rdx;			// Something does, so registers live across it can't be rdx
+	uint32_t				pu32_unit_free[ASM_OPCODE_NUM_OPCODES];	// Cycle each opcode's execution unit takes another
+} SCHEDULE_info_t;
+
+/*
+ *	A unit's ready cycle before a window moved it on, so trying another order can undo it
+ */
+typedef struct
+{
+	uint32_t	u32_unit;
+	uint32_t	u32_ready;
+} SCHEDULE_saved_t;
+
+/*
+ *	Where issuing units in order has got to, which is all that the units after depend on
+ */
+typedef struct
+{
+	uint32_t *				pu32_ready;				// Per unit, earliest cycle its operands are all there
+	SCHEDULE_saved_t *		p_saved;				// Ready cycles changed since the last snapshot, or NULL to not keep them
+	uint32_t				u32_num_saved;
+	uint32_t				u32_cycle;
+	uint32_t				u32_num_issued;			// In u32_cycle
+	uint32_t				u32_end;				// Cycle the last result so far is in
+	uint32_t				pu32_unit_free[ASM_OPCODE_NUM_OPCODES];
+} SCHEDULE_timeline_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	Register forms on a recent Intel or AMD core, rounded. Loads from memory add SCHEDULE_LOAD_LATENCY
+ */
+static const SCHEDULE_timing_t pk_timings[ASM_OPCODE_NUM_OPCODES] =
+{
+	[ASM_OPCODE_MOV]			= { 1, 0 },
+	[ASM_OPCODE_ADD]			= { 1, 0 },
+	[ASM_OPCODE_SUB]			= { 1, 0 },
+	[ASM_OPCODE_IMUL]			= { 3, 1 },
+	[ASM_OPCODE_DIV]			= { 26, 6 },
+	[ASM_OPCODE_IDIV]			= { 26, 6 },
+	[ASM_OPCODE_CDQ]			= { 1, 0 },
+	[ASM_OPCODE_XOR]			= { 1, 0 },
+	[ASM_OPCODE_SHL]			= { 1, 0 },
+	[ASM_OPCODE_SHR]			= { 1, 0 },
+	[ASM_OPCODE_LEA3]			= { 1, 0 },
+	[ASM_OPCODE_LEA5]			= { 1, 0 },
+	[ASM_OPCODE_LEA9]			= { 1, 0 },
+	[ASM_OPCODE_ADD_SCALED2]	= { 1, 0 },
+	[ASM_OPCODE_ADD_SCALED4]	= { 1, 0 },
+	[ASM_OPCODE_ADD_SCALED8]	= { 1, 0 },
+	[ASM_OPCODE_MOVZB]			= { 1, 0 },
+	[ASM_OPCODE_MOVZW]			= { 1, 0 },
+	[ASM_OPCODE_MOVZL]			= { 1, 0 },
+	[ASM_OPCODE_MOVSB]			= { 1, 0 },
+	[ASM_OPCODE_MOVSW]			= { 1, 0 },
+	[ASM_OPCODE_MOVSL]			= { 1, 0 },
+	[ASM_OPCODE_PUSH]			= { 1, 0 },
+	[ASM_OPCODE_POP]			= { 1, 0 },
+	[ASM_OPCODE_RET]			= { 1, 0 },
+	[ASM_OPCODE_MOVDQU]			= { 1, 0 },
+	[ASM_OPCODE_MOVD]			= { 2, 1 },
+	[ASM_OPCODE_PSHUFD0]		= { 1, 1 },
+	[ASM_OPCODE_PADDD]			= { 1, 0 },
+	[ASM_OPCODE_PSUBD]			= { 1, 0 },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		SCHEDULE_find_units				(SCHEDULE_info_t * p_info);
+static void 		SCHEDULE_build_edges			(SCHEDULE_info_t * p_info);
+static void 		SCHEDULE_compute_heights		(SCHEDULE_info_t * p_info);
+static void 		SCHEDULE_list					(SCHEDULE_info_t * p_info, uint32_t u32_max_live, uint32_t * pu32_order);
+static bool 		SCHEDULE_is_ready				(const SCHEDULE_info_t * kp_info, uint32_t u32_unit, uint32_t u32_cycle);
+static int32_t 		SCHEDULE_get_pressure			(const SCHEDULE_info_t * kp_info, uint32_t u32_unit, uint32_t * pu32_started);
+static void 		SCHEDULE_issue					(SCHEDULE_info_t * p_info, uint32_t u32_unit, uint32_t u32_cycle);
+static void 		SCHEDULE_measure_windows		(const SCHEDULE_info_t * kp_info, const uint32_t * kpu32_order, uint32_t * pu32_peaks);
+static uint32_t 	SCHEDULE_estimate				(const SCHEDULE_info_t * kp_info, const uint32_t * kpu32_order);
+static uint32_t 	SCHEDULE_advance				(const SCHEDULE_info_t * kp_info, SCHEDULE_timeline_t * p_timeline, const uint32_t * kpu32_units, uint32_t u32_num_units);
+static void 		SCHEDULE_rewind					(SCHEDULE_timeline_t * p_timeline, const SCHEDULE_timeline_t * kp_snapshot);
+static void 		SCHEDULE_restore_window			(const SCHEDULE_info_t * kp_info, uint32_t * pu32_order, const uint32_t * kpu32_identity, uint32_t u32_window);
+static uint32_t 	SCHEDULE_get_unit_vregs			(const SCHEDULE_info_t * kp_info, const SCHEDULE_unit_t * kp_unit, uint32_t * pu32_vregs);
+static uint32_t 	SCHEDULE_get_interval			(const ASM_instruction_t * kp_instruction);
+static uint32_t 	SCHEDULE_get_accesses			(const SCHEDULE_info_t * kp_info, const ASM_instruction_t * kp_instruction, SCHEDULE_access_t * p_accesses);
+static uint32_t 	SCHEDULE_add_operand			(const SCHEDULE_info_t * kp_info, const ASM_instruction_t * kp_instruction, uint8_t u8_kind, uint32_t u32_value,
+														bool b_write, SCHEDULE_access_t * p_accesses);
+static bool 		SCHEDULE_reads_dst				(const ASM_instruction_t * kp_instruction);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	List scheduling over straight-line code, before register allocation. Units depend on each other
+ *	through every register and variable they read and write; among those whose operands are ready,
+ *	the one furthest from the end of the block by latency goes first, which interleaves independent
+ *	statements so long multiplies and divides overlap with other work. A unit that would start more
+ *	virtual registers than `u32_max_live` allows waits while anything else can go. When nothing can,
+ *	the oldest goes, as selection had it. Windows the new order makes slower are put back
+ */
+void SCHEDULE_run(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_max_live, SCHEDULE_result_t * p_result)
+{
+	SCHEDULE_info_t info = { .kp_buffer = p_buffer, .u32_num_vregs = u32_num_vregs };
+	ASM_instruction_t * p_scheduled;
+	uint32_t * pu32_order;
+	uint32_t * pu32_identity;
+	uint32_t * pu32_peaks_before;
+	uint32_t * pu32_peaks_after;
+	SCHEDULE_timeline_t timeline = { 0 };
+	SCHEDULE_timeline_t snapshot;
+	uint32_t u32_num_windows;
+	uint32_t u32_window_size;
+	uint32_t u32_done_before;
+	uint32_t u32_cycle_before;
+	uint32_t u32_done_after;
+	uint32_t u32_num_out = 0;
+
+	info.p_units = malloc(sizeof(SCHEDULE_unit_t) * (p_buffer->u32_num_instructions + 1));
+	info.pu32_remaining = calloc(u32_num_vregs + 1, sizeof(uint32_t));
+	info.pb_live = calloc(u32_num_vregs + 1, sizeof(bool));
+	pu32_order = calloc(p_buffer->u32_num_instructions + 1, sizeof(uint32_t));
+	pu32_identity = calloc(p_buffer->u32_num_instructions + 1, sizeof(uint32_t));
+	pu32_peaks_before = malloc(sizeof(uint32_t) * (p_buffer->u32_num_instructions / SCHEDULE_WINDOW + 1));
+	pu32_peaks_after = malloc(sizeof(uint32_t) * (p_buffer->u32_num_instructions / SCHEDULE_WINDOW + 1));
+	ASSERT(info.p_units && info.pu32_remaining && info.pb_live && pu32_order && pu32_identity && pu32_peaks_before && pu32_peaks_after);
+
+	SCHEDULE_find_units(&info);
+	SCHEDULE_build_edges(&info);
+	SCHEDULE_compute_heights(&info);
+	u32_num_windows = (info.u32_num_units + SCHEDULE_WINDOW - 1) / SCHEDULE_WINDOW;
+
+	for (uint32_t i = 0; i < info.u32_num_units; i++)
+	{
+		pu32_identity[i] = i;
+	}
+
+	if (info.b_writes_rdx && u32_max_live > 1)
+	{
+		u32_max_live--;
+	}
+
+	SCHEDULE_list(&info, u32_max_live, pu32_order);
+
+	// What's live between windows is the same whatever the order inside them, so any window the
+	// new order leaves needing more registers than there are, and more than before, goes back
+	SCHEDULE_measure_windows(&info, pu32_identity, pu32_peaks_before);
+	SCHEDULE_measure_windows(&info, pu32_order, pu32_peaks_after);
+
+	for (uint32_t i = 0; i < u32_num_windows; i++)
+	{
+		if (pu32_peaks_after[i] > u32_max_live && pu32_peaks_after[i] > pu32_peaks_before[i])
+		{
+			SCHEDULE_restore_window(&info, pu32_order, pu32_identity, i);
+			pu32_peaks_after[i] = pu32_peaks_before[i];
+		}
+	}
+
+	// The priorities are only a guess at what the estimate rewards, so each window's new order is
+	// issued after the windows before it, as they ended up, and so is the old one. The new order
+	// stays only if its results are in sooner, or as soon with it issued sooner, since that's all
+	// the units after it see. Then all of it goes back if the block is still slower
+	p_result->u32_cycles_before = SCHEDULE_estimate(&info, pu32_identity);
+
+	timeline.pu32_ready = calloc(info.u32_num_units + 1, sizeof(uint32_t));
+	timeline.p_saved = malloc(sizeof(SCHEDULE_saved_t) * (info.pu32_edge_starts[info.u32_num_units] + 1));
+	ASSERT(timeline.pu32_ready && timeline.p_saved);
+
+	for (uint32_t i = 0; i < u32_num_windows; i++)
+	{
+		u32_window_size = SCHEDULE_MIN(SCHEDULE_WINDOW, info.u32_num_units - i * SCHEDULE_WINDOW);
+		timeline.u32_num_saved = 0;
+
+		if (memcmp(&pu32_order[i * SCHEDULE_WINDOW], &pu32_identity[i * SCHEDULE_WINDOW], sizeof(uint32_t) * u32_window_size) == 0)
+		{
+			SCHEDULE_advance(&info, &timeline, &pu32_identity[i * SCHEDULE_WINDOW], u32_window_size);
+			continue;
+		}
+
+		snapshot = timeline;
+		u32_done_before = SCHEDULE_advance(&info, &timeline, &pu32_identity[i * SCHEDULE_WINDOW], u32_window_size);
+		u32_cycle_before = timeline.u32_cycle;
+		SCHEDULE_rewind(&timeline, &snapshot);
+		u32_done_after = SCHEDULE_advance(&info, &timeline, &pu32_order[i * SCHEDULE_WINDOW], u32_window_size);
+
+		if (u32_done_after > u32_done_before || (u32_done_after == u32_done_before && timeline.u32_cycle >= u32_cycle_before))
+		{
+			SCHEDULE_rewind(&timeline, &snapshot);
+			SCHEDULE_restore_window(&info, pu32_order, pu32_identity, i);
+			SCHEDULE_advance(&info, &timeline, &pu32_identity[i * SCHEDULE_WINDOW], u32_window_size);
+			pu32_peaks_after[i] = pu32_peaks_before[i];
+		}
+	}
+
+	p_result->u32_cycles_after = timeline.u32_end;
+	free(timeline.pu32_ready);
+	free(timeline.p_saved);
+
+	if (p_result->u32_cycles_after >= p_result->u32_cycles_before)
+	{
+		memcpy(pu32_order, pu32_identity, sizeof(uint32_t) * info.u32_num_units);
+		memcpy(pu32_peaks_after, pu32_peaks_before, sizeof(uint32_t) * u32_num_windows);
+		p_result->u32_cycles_after = p_result->u32_cycles_before;
+	}
+
+	p_result->u32_max_live = 0;
+
+	for (uint32_t i = 0; i < u32_num_windows; i++)
+	{
+		p_result->u32_max_live = SCHEDULE_MAX(p_result->u32_max_live, pu32_peaks_after[i]);
+	}
+
+	p_result->u32_num_units = info.u32_num_units;
+	p_result->u32_num_moved = 0;
+
+	p_scheduled = malloc(sizeof(ASM_instruction_t) * (p_buffer->u32_num_instructions + 1));
+	ASSERT(p_scheduled);
+
+	for (uint32_t i = 0; i < info.u32_num_units; i++)
+	{
+		const SCHEDULE_unit_t * kp_unit = &info.p_units[pu32_order[i]];
+
+		p_result->u32_num_moved += (pu32_order[i] != i) ? 1 : 0;
+		memcpy(&p_scheduled[u32_num_out], &p_buffer->p_instructions[kp_unit->u32_first], sizeof(ASM_instruction_t) * kp_unit->u32_count);
+		u32_num_out += kp_unit->u32_count;
+	}
+
+	ASSERT(u32_num_out == p_buffer->u32_num_instructions);
+	memcpy(p_buffer->p_instructions, p_scheduled, sizeof(ASM_instruction_t) * u32_num_out);
+
+	SCHEDULE_DBG("Moved %u of %u units, %u cycles down to %u, at most %u of %u live\n", p_result->u32_num_moved, info.u32_num_units,
+		p_result->u32_cycles_before, p_result->u32_cycles_after, p_result->u32_max_live, u32_max_live);
+
+	free(p_scheduled);
+	free(info.p_units);
+	free(info.pu32_edge_starts);
+	free(info.p_edges);
+	free(info.pu32_remaining);
+	free(info.pb_live);
+	free(info.pu32_vreg_starts);
+	free(info.pu32_unit_vregs);
+	free(pu32_order);
+	free(pu32_identity);
+	free(pu32_peaks_before);
+	free(pu32_peaks_after);
+}
+
+/*
+ *	Cycles from issue until the result can be used
+ */
+uint32_t SCHEDULE_get_latency(const ASM_instruction_t * kp_instruction)
+{
+	uint32_t u32_latency = pk_timings[kp_instruction->u8_opcode].u8_latency;
+
+	if ((kp_instruction->u8_opcode == ASM_OPCODE_DIV || kp_instruction->u8_opcode == ASM_OPCODE_IDIV) && kp_instruction->u8_width == ASM_WIDTH_64)
+	{
+		u32_latency = SCHEDULE_DIV64_LATENCY;
+	}
+
+	return u32_latency + ((kp_instruction->u8_src_kind == ASM_OPERAND_VARIABLE) ? SCHEDULE_LOAD_LATENCY : 0);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Splits the code wherever neither rax nor rdx holds anything still to be read, found walking
+ *	backwards. Also lists the virtual registers each unit mentions
+ */
+static void SCHEDULE_find_units(SCHEDULE_info_t * p_info)
+{
+	const ASM_instruction_t * kp_instructions = p_info->kp_buffer->p_instructions;
+	uint32_t u32_num_instructions = p_info->kp_buffer->u32_num_instructions;
+	bool * pb_split = malloc(sizeof(bool) * (u32_num_instructions + 1));
+	SCHEDULE_access_t p_accesses[SCHEDULE_MAX_ACCESSES];
+	uint32_t u32_num_accesses;
+	uint32_t u32_resource;
+	bool pb_live[2] = { false, false };
+
+	ASSERT(pb_split);
+
+	for (uint32_t i = u32_num_instructions; i-- > 0;)
+	{
+		u32_num_accesses = SCHEDULE_get_accesses(p_info, &kp_instructions[i], p_accesses);
+
+		// Reads come before writes, so a write then means nothing read here needs the value from before
+		for (uint32_t j = u32_num_accesses; j-- > 0;)
+		{
+			u32_resource = p_accesses[j].u32_resource - SCHEDULE_REGISTER_BASE(p_info->u32_num_vregs);
+
+			if (p_accesses[j].u32_resource >= SCHEDULE_REGISTER_BASE(p_info->u32_num_vregs) &&
+				(u32_resource == ASM_REGISTER_RAX || u32_resource == ASM_REGISTER_RDX))
+			{
+				u32_resource = (u32_resource == ASM_REGISTER_RAX) ? 0 : 1;
+
+				pb_live[u32_resource] = !p_accesses[j].b_write;
+				p_info->b_writes_rdx = p_info->b_writes_rdx || (u32_resource == 1 && p_accesses[j].b_write);
+			}
+		}
+
+		pb_split[i] = !pb_live[0] && !pb_live[1];
+	}
+
+	for (uint32_t i = 0; i < u32_num_instructions; i++)
+	{
+		if (i == 0 || pb_split[i])
+		{
+			p_info->p_units[p_info->u32_num_units++] = (SCHEDULE_unit_t){ .u32_first = i };
+		}
+
+		p_info->p_units[p_info->u32_num_units - 1].u32_count++;
+		p_info->p_units[p_info->u32_num_units - 1].u32_latency += SCHEDULE_get_latency(&kp_instructions[i]);
+	}
+
+	p_info->pu32_vreg_starts = malloc(sizeof(uint32_t) * (p_info->u32_num_units + 1));
+	p_info->pu32_unit_vregs = malloc(sizeof(uint32_t) * (2 * u32_num_instructions + 1));
+	ASSERT(p_info->pu32_vreg_starts && p_info->pu32_unit_vregs);
+	p_info->pu32_vreg_starts[0] = 0;
+
+	for (uint32_t i = 0; i < p_info->u32_num_units; i++)
+	{
+		u32_num_accesses = SCHEDULE_get_unit_vregs(p_info, &p_info->p_units[i], &p_info->pu32_unit_vregs[p_info->pu32_vreg_starts[i]]);
+		p_info->pu32_vreg_starts[i + 1] = p_info->pu32_vreg_starts[i] + u32_num_accesses;
+
+		for (uint32_t j = p_info->pu32_vreg_starts[i]; j < p_info->pu32_vreg_starts[i + 1]; j++)
+		{
+			p_info->pu32_remaining[p_info->pu32_unit_vregs[j]]++;
+		}
+	}
+
+	free(pb_split);
+}
+
+/*
+ *	Read after write waits for the writer's latency; write after read and write after write only
+ *	keep the order
+ */
+static void SCHEDULE_build_edges(SCHEDULE_info_t * p_info)
+{
+	const ASM_instruction_t * kp_instructions = p_info->kp_buffer->p_instructions;
+	uint32_t u32_num_variables = 0;
+	uint32_t u32_num_resources;
+	uint32_t * pu32_last_writer;
+	uint32_t * pu32_readers;
+	SCHEDULE_reader_t * p_readers;
+	uint32_t u32_num_readers = 0;
+	SCHEDULE_access_t p_accesses[SCHEDULE_MAX_ACCESSES];
+	uint32_t u32_num_accesses;
+	uint32_t u32_num_mentions = 0;
+	uint32_t u32_num_edges = 0;
+	uint32_t * pu32_from;
+	SCHEDULE_edge_t * p_edges;
+	uint32_t * pu32_placed;
+	uint32_t u32_resource;
+	uint32_t u32_unit;
+
+	// A read adds at most an edge and a reader, and each reader becomes at most one edge, as does a write
+	for (uint32_t i = 0; i < p_info->kp_buffer->u32_num_instructions; i++)
+	{
+		u32_num_mentions += SCHEDULE_get_accesses(p_info, &kp_instructions[i], p_accesses);
+
+		if (kp_instructions[i].u8_src_kind == ASM_OPERAND_VARIABLE)
+		{
+			u32_num_variables = SCHEDULE_MAX(u32_num_variables, kp_instructions[i].u32_src + (uint32_t)(ASM_VECTOR_SIZE / sizeof(uint32_t)));
+		}
+		if (kp_instructions[i].u8_dst_kind == ASM_OPERAND_VARIABLE)
+		{
+			u32_num_variables = SCHEDULE_MAX(u32_num_variables, kp_instructions[i].u32_dst + (uint32_t)(ASM_VECTOR_SIZE / sizeof(uint32_t)));
+		}
+	}
+
+	u32_num_resources = SCHEDULE_VARIABLE_BASE(p_info->u32_num_vregs) + u32_num_variables;
+	pu32_last_writer = malloc(sizeof(uint32_t) * u32_num_resources);
+	pu32_readers = malloc(sizeof(uint32_t) * u32_num_resources);
+	p_readers = malloc(sizeof(SCHEDULE_reader_t) * (u32_num_mentions + 1));
+	pu32_from = malloc(sizeof(uint32_t) * (2 * u32_num_mentions + 1));
+	p_edges = malloc(sizeof(SCHEDULE_edge_t) * (2 * u32_num_mentions + 1));
+	p_info->pu32_edge_starts = calloc(p_info->u32_num_units + 1, sizeof(uint32_t));
+	ASSERT(pu32_last_writer && pu32_readers && p_readers && pu32_from && p_edges && p_info->pu32_edge_starts);
+
+	for (uint32_t i = 0; i < u32_num_resources; i++)
+	{
+		pu32_last_writer[i] = SCHEDULE_NONE;
+		pu32_readers[i] = SCHEDULE_NONE;
+	}
+
+	for (u32_unit = 0; u32_unit < p_info->u32_num_units; u32_unit++)
+	{
+		const SCHEDULE_unit_t * kp_unit = &p_info->p_units[u32_unit];
+
+		for (uint32_t i = kp_unit->u32_first; i < kp_unit->u32_first + kp_unit->u32_count; i++)
+		{
+			u32_num_accesses = SCHEDULE_get_accesses(p_info, &kp_instructions[i], p_accesses);
+
+			for (uint32_t j = 0; j < u32_num_accesses; j++)
+			{
+				u32_resource = p_accesses[j].u32_resource;
+
+				if (!p_accesses[j].b_write)
+				{
+					// Already a reader since the last write, so already waits on it
+					if (pu32_readers[u32_resource] != SCHEDULE_NONE && p_readers[pu32_readers[u32_resource]].u32_unit == u32_unit)
+					{
+						continue;
+					}
+
+					if (pu32_last_writer[u32_resource] != SCHEDULE_NONE && pu32_last_writer[u32_resource] != u32_unit)
+					{
+						pu32_from[u32_num_edges] = pu32_last_writer[u32_resource];
+						p_edges[u32_num_edges++] = (SCHEDULE_edge_t){ u32_unit, p_info->p_units[pu32_last_writer[u32_resource]].u32_latency };
+					}
+
+					p_readers[u32_num_readers] = (SCHEDULE_reader_t){ u32_unit, pu32_readers[u32_resource] };
+					pu32_readers[u32_resource] = u32_num_readers++;
+					continue;
+				}
+
+				for (uint32_t k = pu32_readers[u32_resource]; k != SCHEDULE_NONE; k = p_readers[k].u32_next)
+				{
+					if (p_readers[k].u32_unit != u32_unit)
+					{
+						pu32_from[u32_num_edges] = p_readers[k].u32_unit;
+						p_edges[u32_num_edges++] = (SCHEDULE_edge_t){ u32_unit, 0 };
+					}
+				}
+
+				if (pu32_last_writer[u32_resource] != SCHEDULE_NONE && pu32_last_writer[u32_resource] != u32_unit)
+				{
+					pu32_from[u32_num_edges] = pu32_last_writer[u32_resource];
+					p_edges[u32_num_edges++] = (SCHEDULE_edge_t){ u32_unit, 1 };
+				}
+
+				pu32_last_writer[u32_resource] = u32_unit;
+				pu32_readers[u32_resource] = SCHEDULE_NONE;
+			}
+		}
+	}
+
+	// Grouped by the unit they leave
+	p_info->p_edges = malloc(sizeof(SCHEDULE_edge_t) * (u32_num_edges + 1));
+	pu32_placed = calloc(p_info->u32_num_units + 1, sizeof(uint32_t));
+	ASSERT(p_info->p_edges && pu32_placed);
+
+	for (uint32_t i = 0; i < u32_num_edges; i++)
+	{
+		p_info->pu32_edge_starts[pu32_from[i] + 1]++;
+		p_info->p_units[p_edges[i].u32_to].u32_num_preds++;
+	}
+	for (uint32_t i = 0; i < p_info->u32_num_units; i++)
+	{
+		p_info->pu32_edge_starts[i + 1] += p_info->pu32_edge_starts[i];
+	}
+	for (uint32_t i = 0; i < u32_num_edges; i++)
+	{
+		p_info->p_edges[p_info->pu32_edge_starts[pu32_from[i]] + pu32_placed[pu32_from[i]]++] = p_edges[i];
+	}
+
+	free(pu32_last_writer);
+	free(pu32_readers);
+	free(p_readers);
+	free(pu32_from);
+	free(p_edges);
+	free(pu32_placed);
+}
+
+/*
+ *	Every edge goes forward, so walking back sees each unit's successors first
+ */
+static void SCHEDULE_compute_heights(SCHEDULE_info_t * p_info)
+{
+	SCHEDULE_unit_t * p_unit;
+	const SCHEDULE_edge_t * kp_edge;
+
+	for (uint32_t i = p_info->u32_num_units; i-- > 0;)
+	{
+		p_unit = &p_info->p_units[i];
+		p_unit->u32_height = p_unit->u32_latency;
+
+		for (uint32_t j = p_info->pu32_edge_starts[i]; j < p_info->pu32_edge_starts[i + 1]; j++)
+		{
+			kp_edge = &p_info->p_edges[j];
+			p_unit->u32_height = SCHEDULE_MAX(p_unit->u32_height, kp_edge->u32_latency + p_info->p_units[kp_edge->u32_to].u32_height);
+		}
+	}
+}
+
+/*
+ *	Cycle by cycle over a window of units at a time. Units are only ever ready once everything
+ *	before their window has gone, so the window's units are all that's looked at
+ */
+static void SCHEDULE_list(SCHEDULE_info_t * p_info, uint32_t u32_max_live, uint32_t * pu32_order)
+{
+	uint32_t pu32_available[SCHEDULE_WINDOW];
+	uint32_t u32_num_available = 0;
+	uint32_t u32_num_scheduled = 0;
+	uint32_t u32_cycle = 0;
+	uint32_t u32_num_issued = 0;
+	uint32_t u32_window_end = 0;
+	uint32_t u32_best;
+	uint32_t u32_fallback;
+	uint32_t u32_next_cycle;
+	uint32_t u32_started;
+	int32_t i32_pressure;
+	int32_t i32_fallback_pressure = 0;
+	const SCHEDULE_unit_t * kp_unit;
+	SCHEDULE_unit_t * p_successor;
+
+	while (u32_num_scheduled < p_info->u32_num_units)
+	{
+		if (u32_num_scheduled == u32_window_end)
+		{
+			u32_window_end = SCHEDULE_MIN(u32_window_end + SCHEDULE_WINDOW, p_info->u32_num_units);
+
+			for (uint32_t i = u32_num_scheduled; i < u32_window_end; i++)
+			{
+				if (p_info->p_units[i].u32_num_preds == 0)
+				{
+					p_info->p_units[i].u32_num_preds = SCHEDULE_NONE;
+					pu32_available[u32_num_available++] = i;
+				}
+			}
+		}
+
+		ASSERT(u32_num_available > 0);
+
+		u32_best = SCHEDULE_NONE;
+		u32_fallback = SCHEDULE_NONE;
+		u32_next_cycle = UINT32_MAX;
+
+		for (uint32_t i = 0; i < u32_num_available; i++)
+		{
+			kp_unit = &p_info->p_units[pu32_available[i]];
+			i32_pressure = SCHEDULE_get_pressure(p_info, pu32_available[i], &u32_started);
+
+			// What goes when nothing fits: whatever frees the most, the oldest of those
+			if (u32_fallback == SCHEDULE_NONE || i32_pressure < i32_fallback_pressure ||
+				(i32_pressure == i32_fallback_pressure && pu32_available[i] < u32_fallback))
+			{
+				u32_fallback = pu32_available[i];
+				i32_fallback_pressure = i32_pressure;
+			}
+
+			if (u32_started > 0 && p_info->u32_num_live + u32_started + ((i32_pressure > 0) ? SCHEDULE_HEADROOM : 0) > u32_max_live)
+			{
+				continue;
+			}
+
+			if (!SCHEDULE_is_ready(p_info, pu32_available[i], u32_cycle))
+			{
+				u32_next_cycle = SCHEDULE_MIN(u32_next_cycle, SCHEDULE_MAX(kp_unit->u32_ready, u32_cycle + 1));
+				continue;
+			}
+
+			// Furthest from the end first, the oldest of those
+			if (u32_best == SCHEDULE_NONE || kp_unit->u32_height > p_info->p_units[u32_best].u32_height ||
+				(kp_unit->u32_height == p_info->p_units[u32_best].u32_height && pu32_available[i] < u32_best))
+			{
+				u32_best = pu32_available[i];
+			}
+		}
+
+		if (u32_best == SCHEDULE_NONE && u32_next_cycle != UINT32_MAX)
+		{
+			// Something fits once its operands arrive
+			u32_cycle = u32_next_cycle;
+			u32_num_issued = 0;
+			continue;
+		}
+
+		if (u32_best == SCHEDULE_NONE)
+		{
+			u32_best = u32_fallback;
+			u32_cycle = SCHEDULE_MAX(u32_cycle, p_info->p_units[u32_best].u32_ready);
+		}
+
+		for (uint32_t i = 0; i < u32_num_available; i++)
+		{
+			if (pu32_available[i] == u32_best)
+			{
+				pu32_available[i] = pu32_available[--u32_num_available];
+				break;
+			}
+		}
+
+		SCHEDULE_issue(p_info, u32_best, u32_cycle);
+		pu32_order[u32_num_scheduled++] = u32_best;
+
+		// Successors in the window join the available ones once they wait on nothing else
+		for (uint32_t i = p_info->pu32_edge_starts[u32_best]; i < p_info->pu32_edge_starts[u32_best + 1]; i++)
+		{
+			p_successor = &p_info->p_units[p_info->p_edges[i].u32_to];
+
+			if (p_successor->u32_num_preds == 0 && p_info->p_edges[i].u32_to < u32_window_end)
+			{
+				p_successor->u32_num_preds = SCHEDULE_NONE;
+				pu32_available[u32_num_available++] = p_info->p_edges[i].u32_to;
+			}
+		}
+
+		if (++u32_num_issued == SCHEDULE_ISSUE_WIDTH)
+		{
+			u32_cycle++;
+			u32_num_issued = 0;
+		}
+	}
+}
+
+/*
+ *	Whether the unit's operands and execution units are there by the cycle
+ */
+static bool SCHEDULE_is_ready(const SCHEDULE_info_t * kp_info, uint32_t u32_unit, uint32_t u32_cycle)
+{
+	const SCHEDULE_unit_t * kp_unit = &kp_info->p_units[u32_unit];
+
+	if (kp_unit->u32_ready > u32_cycle)
+	{
+		return false;
+	}
+
+	for (uint32_t i = kp_unit->u32_first; i < kp_unit->u32_first + kp_unit->u32_count; i++)
+	{
+		if (kp_info->pu32_unit_free[kp_info->kp_buffer->p_instructions[i].u8_opcode] > u32_cycle)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ *	How many more virtual registers are live once the unit has gone, and how many it starts
+ */
+static int32_t SCHEDULE_get_pressure(const SCHEDULE_info_t * kp_info, uint32_t u32_unit, uint32_t * pu32_started)
+{
+	uint32_t u32_vreg;
+	int32_t i32_pressure = 0;
+
+	*pu32_started = 0;
+
+	for (uint32_t i = kp_info->pu32_vreg_starts[u32_unit]; i < kp_info->pu32_vreg_starts[u32_unit + 1]; i++)
+	{
+		u32_vreg = kp_info->pu32_unit_vregs[i];
+
+		if (!kp_info->pb_live[u32_vreg])
+		{
+			(*pu32_started)++;
+			i32_pressure++;
+		}
+		if (kp_info->pu32_remaining[u32_vreg] == 1)
+		{
+			i32_pressure--;
+		}
+	}
+
+	return i32_pressure;
+}
+
+static void SCHEDULE_issue(SCHEDULE_info_t * p_info, uint32_t u32_unit, uint32_t u32_cycle)
+{
+	const SCHEDULE_unit_t * kp_unit = &p_info->p_units[u32_unit];
+	const ASM_instruction_t * kp_instruction;
+	SCHEDULE_unit_t * p_successor;
+	uint32_t u32_vreg;
+
+	for (uint32_t i = kp_unit->u32_first; i < kp_unit->u32_first + kp_unit->u32_count; i++)
+	{
+		kp_instruction = &p_info->kp_buffer->p_instructions[i];
+		p_info->pu32_unit_free[kp_instruction->u8_opcode] = SCHEDULE_MAX(p_info->pu32_unit_free[kp_instruction->u8_opcode],
+			u32_cycle + SCHEDULE_get_interval(kp_instruction));
+	}
+
+	for (uint32_t i = p_info->pu32_vreg_starts[u32_unit]; i < p_info->pu32_vreg_starts[u32_unit + 1]; i++)
+	{
+		u32_vreg = p_info->pu32_unit_vregs[i];
+
+		if (!p_info->pb_live[u32_vreg])
+		{
+			p_info->pb_live[u32_vreg] = true;
+			p_info->u32_num_live++;
+		}
+		if (--p_info->pu32_remaining[u32_vreg] == 0)
+		{
+			p_info->pb_live[u32_vreg] = false;
+			p_info->u32_num_live--;
+		}
+	}
+
+	for (uint32_t i = p_info->pu32_edge_starts[u32_unit]; i < p_info->pu32_edge_starts[u32_unit + 1]; i++)
+	{
+		p_successor = &p_info->p_units[p_info->p_edges[i].u32_to];
+		p_successor->u32_num_preds--;
+		p_successor->u32_ready = SCHEDULE_MAX(p_successor->u32_ready, u32_cycle + p_info->p_edges[i].u32_latency);
+	}
+
+}
+
+/*
+ *	Most virtual registers live at once within each window, going in the given order, counting
+ *	those a unit ends while it runs
+ */
+static void SCHEDULE_measure_windows(const SCHEDULE_info_t * kp_info, const uint32_t * kpu32_order, uint32_t * pu32_peaks)
+{
+	uint32_t * pu32_remaining = calloc(kp_info->u32_num_vregs + 1, sizeof(uint32_t));
+	bool * pb_live = calloc(kp_info->u32_num_vregs + 1, sizeof(bool));
+	uint32_t u32_num_live = 0;
+	uint32_t u32_started;
+	uint32_t u32_vreg;
+	uint32_t u32_unit;
+
+	ASSERT(pu32_remaining && pb_live);
+
+	for (uint32_t i = 0; i < kp_info->pu32_vreg_starts[kp_info->u32_num_units]; i++)
+	{
+		pu32_remaining[kp_info->pu32_unit_vregs[i]]++;
+	}
+
+	for (uint32_t i = 0; i < kp_info->u32_num_units; i++)
+	{
+		u32_unit = kpu32_order[i];
+		u32_started = 0;
+
+		if (i % SCHEDULE_WINDOW == 0)
+		{
+			pu32_peaks[i / SCHEDULE_WINDOW] = 0;
+		}
+
+		for (uint32_t j = kp_info->pu32_vreg_starts[u32_unit]; j < kp_info->pu32_vreg_starts[u32_unit + 1]; j++)
+		{
+			u32_started += pb_live[kp_info->pu32_unit_vregs[j]] ? 0 : 1;
+		}
+
+		pu32_peaks[i / SCHEDULE_WINDOW] = SCHEDULE_MAX(pu32_peaks[i / SCHEDULE_WINDOW], u32_num_live + u32_started);
+
+		for (uint32_t j = kp_info->pu32_vreg_starts[u32_unit]; j < kp_info->pu32_vreg_starts[u32_unit + 1]; j++)
+		{
+			u32_vreg = kp_info->pu32_unit_vregs[j];
+
+			if (!pb_live[u32_vreg])
+			{
+				pb_live[u32_vreg] = true;
+				u32_num_live++;
+			}
+			if (--pu32_remaining[u32_vreg] == 0)
+			{
+				pb_live[u32_vreg] = false;
+				u32_num_live--;
+			}
+		}
+	}
+
+	free(pu32_remaining);
+	free(pb_live);
+}
+
+/*
+ *	Cycles until the last result is in, issuing the units in the given order, in order, as many a
+ *	cycle as the issue width allows once their operands are ready
+ */
+static uint32_t SCHEDULE_estimate(const SCHEDULE_info_t * kp_info, const uint32_t * kpu32_order)
+{
+	SCHEDULE_timeline_t timeline = { 0 };
+
+	timeline.pu32_ready = calloc(kp_info->u32_num_units + 1, sizeof(uint32_t));
+	ASSERT(timeline.pu32_ready);
+
+	SCHEDULE_advance(kp_info, &timeline, kpu32_order, kp_info->u32_num_units);
+	free(timeline.pu32_ready);
+
+	return timeline.u32_end;
+}
+
+/*
+ *	Issues the units after what the timeline has issued so far. Returns the cycle their own
+ *	results are all in
+ */
+static uint32_t SCHEDULE_advance(const SCHEDULE_info_t * kp_info, SCHEDULE_timeline_t * p_timeline, const uint32_t * kpu32_units, uint32_t u32_num_units)
+{
+	const ASM_instruction_t * kp_instruction;
+	const SCHEDULE_unit_t * kp_unit;
+	const SCHEDULE_edge_t * kp_edge;
+	uint32_t u32_issue;
+	uint32_t u32_done = 0;
+
+	for (uint32_t i = 0; i < u32_num_units; i++)
+	{
+		kp_unit = &kp_info->p_units[kpu32_units[i]];
+		u32_issue = SCHEDULE_MAX(p_timeline->u32_cycle, p_timeline->pu32_ready[kpu32_units[i]]);
+
+		for (uint32_t j = kp_unit->u32_first; j < kp_unit->u32_first + kp_unit->u32_count; j++)
+		{
+			u32_issue = SCHEDULE_MAX(u32_issue, p_timeline->pu32_unit_free[kp_info->kp_buffer->p_instructions[j].u8_opcode]);
+		}
+
+		if (u32_issue > p_timeline->u32_cycle || p_timeline->u32_num_issued == SCHEDULE_ISSUE_WIDTH)
+		{
+			p_timeline->u32_cycle = SCHEDULE_MAX(u32_issue, p_timeline->u32_cycle + 1);
+			p_timeline->u32_num_issued = 0;
+		}
+
+		p_timeline->u32_num_issued++;
+		u32_done = SCHEDULE_MAX(u32_done, p_timeline->u32_cycle + kp_unit->u32_latency);
+
+		for (uint32_t j = kp_unit->u32_first; j < kp_unit->u32_first + kp_unit->u32_count; j++)
+		{
+			kp_instruction = &kp_info->kp_buffer->p_instructions[j];
+			p_timeline->pu32_unit_free[kp_instruction->u8_opcode] = SCHEDULE_MAX(p_timeline->pu32_unit_free[kp_instruction->u8_opcode],
+				p_timeline->u32_cycle + SCHEDULE_get_interval(kp_instruction));
+		}
+
+		for (uint32_t j = kp_info->pu32_edge_starts[kpu32_units[i]]; j < kp_info->pu32_edge_starts[kpu32_units[i] + 1]; j++)
+		{
+			kp_edge = &kp_info->p_edges[j];
+
+			if (p_timeline->p_saved != NULL)
+			{
+				p_timeline->p_saved[p_timeline->u32_num_saved].u32_unit = kp_edge->u32_to;
+				p_timeline->p_saved[p_timeline->u32_num_saved++].u32_ready = p_timeline->pu32_ready[kp_edge->u32_to];
+			}
+
+			p_timeline->pu32_ready[kp_edge->u32_to] = SCHEDULE_MAX(p_timeline->pu32_ready[kp_edge->u32_to], p_timeline->u32_cycle + kp_edge->u32_latency);
+		}
+	}
+
+	p_timeline->u32_end = SCHEDULE_MAX(p_timeline->u32_end, u32_done);
+
+	return u32_done;
+}
+
+/*
+ *	Takes the timeline back to the snapshot, undoing the ready cycles changed since, latest first
+ */
+static void SCHEDULE_rewind(SCHEDULE_timeline_t * p_timeline, const SCHEDULE_timeline_t * kp_snapshot)
+{
+	while (p_timeline->u32_num_saved > kp_snapshot->u32_num_saved)
+	{
+		p_timeline->u32_num_saved--;
+		p_timeline->pu32_ready[p_timeline->p_saved[p_timeline->u32_num_saved].u32_unit] = p_timeline->p_saved[p_timeline->u32_num_saved].u32_ready;
+	}
+
+	*p_timeline = *kp_snapshot;
+}
+
+/*
+ *	Puts a window back in the order selection gave it
+ */
+static void SCHEDULE_restore_window(const SCHEDULE_info_t * kp_info, uint32_t * pu32_order, const uint32_t * kpu32_identity, uint32_t u32_window)
+{
+	memcpy(&pu32_order[u32_window * SCHEDULE_WINDOW], &kpu32_identity[u32_window * SCHEDULE_WINDOW],
+		sizeof(uint32_t) * SCHEDULE_MIN(SCHEDULE_WINDOW, kp_info->u32_num_units - u32_window * SCHEDULE_WINDOW));
+}
+
+/*
+ *	Each virtual register the unit mentions, once
+ */
+static uint32_t SCHEDULE_get_unit_vregs(const SCHEDULE_info_t * kp_info, const SCHEDULE_unit_t * kp_unit, uint32_t * pu32_vregs)
+{
+	const ASM_instruction_t * kp_instruction;
+	uint32_t pu32_operands[2];
+	uint32_t u32_num_vregs = 0;
+	uint32_t u32_num_operands;
+	bool b_seen;
+
+	for (uint32_t i = kp_unit->u32_first; i < kp_unit->u32_first + kp_unit->u32_count; i++)
+	{
+		kp_instruction = &kp_info->kp_buffer->p_instructions[i];
+		u32_num_operands = 0;
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_operands[u32_num_operands++] = kp_instruction->u32_src;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VIRTUAL)
+		{
+			pu32_operands[u32_num_operands++] = kp_instruction->u32_dst;
+		}
+
+		for (uint32_t j = 0; j < u32_num_operands; j++)
+		{
+			b_seen = false;
+
+			for (uint32_t k = 0; k < u32_num_vregs && !b_seen; k++)
+			{
+				b_seen = (pu32_vregs[k] == pu32_operands[j]);
+			}
+			if (!b_seen)
+			{
+				pu32_vregs[u32_num_vregs++] = pu32_operands[j];
+			}
+		}
+	}
+
+	return u32_num_vregs;
+}
+
+static uint32_t SCHEDULE_get_interval(const ASM_instruction_t * kp_instruction)
+{
+	if ((kp_instruction->u8_opcode == ASM_OPCODE_DIV || kp_instruction->u8_opcode == ASM_OPCODE_IDIV) && kp_instruction->u8_width == ASM_WIDTH_64)
+	{
+		return SCHEDULE_DIV64_INTERVAL;
+	}
+
+	return pk_timings[kp_instruction->u8_opcode].u8_interval;
+}
+
+/*
+ *	Every resource the instruction reads, then every one it writes, including the registers divides
+ *	use without naming them. A 128-bit variable operand is its four lanes
+ */
+static uint32_t SCHEDULE_get_accesses(const SCHEDULE_info_t * kp_info, const ASM_instruction_t * kp_instruction, SCHEDULE_access_t * p_accesses)
+{
+	uint32_t u32_num_accesses = 0;
+	bool b_implicit = (kp_instruction->u8_opcode == ASM_OPCODE_DIV || kp_instruction->u8_opcode == ASM_OPCODE_IDIV ||
+						kp_instruction->u8_opcode == ASM_OPCODE_CDQ);
+
+	if (SCHEDULE_reads_dst(kp_instruction))
+	{
+		u32_num_accesses += SCHEDULE_add_operand(kp_info, kp_instruction, kp_instruction->u8_src_kind, kp_instruction->u32_src, false, &p_accesses[u32_num_accesses]);
+		u32_num_accesses += SCHEDULE_add_operand(kp_info, kp_instruction, kp_instruction->u8_dst_kind, kp_instruction->u32_dst, false, &p_accesses[u32_num_accesses]);
+	}
+	else if (kp_instruction->u8_opcode != ASM_OPCODE_XOR)
+	{
+		u32_num_accesses += SCHEDULE_add_operand(kp_info, kp_instruction, kp_instruction->u8_src_kind, kp_instruction->u32_src, false, &p_accesses[u32_num_accesses]);
+	}
+	if (b_implicit)
+	{
+		p_accesses[u32_num_accesses++] = (SCHEDULE_access_t){ SCHEDULE_REGISTER_BASE(kp_info->u32_num_vregs) + ASM_REGISTER_RAX, false };
+
+		if (kp_instruction->u8_opcode != ASM_OPCODE_CDQ)
+		{
+			p_accesses[u32_num_accesses++] = (SCHEDULE_access_t){ SCHEDULE_REGISTER_BASE(kp_info->u32_num_vregs) + ASM_REGISTER_RDX, false };
+			p_accesses[u32_num_accesses++] = (SCHEDULE_access_t){ SCHEDULE_REGISTER_BASE(kp_info->u32_num_vregs) + ASM_REGISTER_RAX, true };
+		}
+
+		p_accesses[u32_num_accesses++] = (SCHEDULE_access_t){ SCHEDULE_REGISTER_BASE(kp_info->u32_num_vregs) + ASM_REGISTER_RDX, true };
+	}
+
+	u32_num_accesses += SCHEDULE_add_operand(kp_info, kp_instruction, kp_instruction->u8_dst_kind, kp_instruction->u32_dst, true, &p_accesses[u32_num_accesses]);
+
+	ASSERT(u32_num_accesses <= SCHEDULE_MAX_ACCESSES);
+
+	return u32_num_accesses;
+}
+
+static uint32_t SCHEDULE_add_operand(const SCHEDULE_info_t * kp_info, const ASM_instruction_t * kp_instruction, uint8_t u8_kind, uint32_t u32_value,
+										bool b_write, SCHEDULE_access_t * p_accesses)
+{
+	uint32_t u32_num_lanes;
+
+	switch (u8_kind)
+	{
+		case ASM_OPERAND_VIRTUAL:
+		{
+			p_accesses[0] = (SCHEDULE_access_t){ u32_value, b_write };
+			return 1;
+		}
+		case ASM_OPERAND_REGISTER:
+		{
+			p_accesses[0] = (SCHEDULE_access_t){ SCHEDULE_REGISTER_BASE(kp_info->u32_num_vregs) + u32_value, b_write };
+			return 1;
+		}
+		case ASM_OPERAND_XMM:
+		{
+			p_accesses[0] = (SCHEDULE_access_t){ SCHEDULE_XMM_BASE(kp_info->u32_num_vregs) + u32_value, b_write };
+			return 1;
+		}
+		case ASM_OPERAND_VARIABLE:
+		{
+			u32_num_lanes = (kp_instruction->u8_width == ASM_WIDTH_128) ? (uint32_t)(ASM_VECTOR_SIZE / sizeof(uint32_t)) : 1;
+
+			for (uint32_t i = 0; i < u32_num_lanes; i++)
+			{
+				p_accesses[i] = (SCHEDULE_access_t){ SCHEDULE_VARIABLE_BASE(kp_info->u32_num_vregs) + u32_value + i, b_write };
+			}
+			return u32_num_lanes;
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+/*
+ *	Moves, extensions, the multiply-by-constant leas and xor of a register with itself overwrite
+ *	their destination without reading it. The xor doesn't really read its source either
+ */
+static bool SCHEDULE_reads_dst(const ASM_instruction_t * kp_instruction)
+{
+	switch (kp_instruction->u8_opcode)
+	{
+		case ASM_OPCODE_MOV:
+		case ASM_OPCODE_LEA3:
+		case ASM_OPCODE_LEA5:
+		case ASM_OPCODE_LEA9:
+		case ASM_OPCODE_MOVZB:
+		case ASM_OPCODE_MOVZW:
+		case ASM_OPCODE_MOVZL:
+		case ASM_OPCODE_MOVSB:
+		case ASM_OPCODE_MOVSW:
+		case ASM_OPCODE_MOVSL:
+		case ASM_OPCODE_MOVDQU:
+		case ASM_OPCODE_MOVD:
+		case ASM_OPCODE_PSHUFD0:
+		case ASM_OPCODE_POP:
+		{
+			return false;
+		}
+		case ASM_OPCODE_XOR:
+		{
+			return kp_instruction->u8_src_kind != kp_instruction->u8_dst_kind || kp_instruction->u32_src != kp_instruction->u32_dst;
+		}
+		default:
+		{
+			return true;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include "common.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _SCHEDULE_result
+{
+	uint32_t	u32_num_units;			// Instructions, or runs that keep rax/rdx live, moved as one
+	uint32_t	u32_num_moved;			// Units now somewhere other than where selection put them
+	uint32_t	u32_cycles_before;		// Estimated by the latency table, issuing in order
+	uint32_t	u32_cycles_after;
+	uint32_t	u32_max_live;			// Most virtual registers live at once in the new order
+} SCHEDULE_result_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			SCHEDULE_run					(ASM_buffer_t * p_buffer, uint32_t u32_num_vregs, uint32_t u32_max_live, SCHEDULE_result_t * p_result);
+uint32_t 		SCHEDULE_get_latency			(const ASM_instruction_t * kp_instruction);
+
+#endif
@@ -0,0 +1,474 @@
+#include "slp.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_SLP
+#define SLP_DBG(fmt, ...)				printf(BOLD("SLP:\t")fmt, ##__VA_ARGS__)
+#define SLP_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("SLP:\t"))fmt, ##__VA_ARGS__)
+#define SLP_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("SLP:\t"))fmt, ##__VA_ARGS__)
+#define SLP_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("SLP:\t"))fmt, ##__VA_ARGS__)
+#else
+#define SLP_DBG(fmt, ...)
+#define SLP_GREEN(fmt, ...)
+#define SLP_WARN(fmt, ...)
+#define SLP_ERR(fmt, ...)
+#endif
+
+#define SLP_NONE						(UINT32_MAX)
+
+/*
+ *	Instructions a statement may compute its value in. A tree that size has at most 8 leaves, so
+ *	evaluating it left first never needs more than 8 of the 16 xmm registers
+ */
+#define SLP_MAX_TREE_SIZE				(15)
+
+/*
+ *	Rough cycles, as the tiler counts them. A splat is mov $c, r; movd r, x; pshufd $0, x, x
+ */
+#define SLP_SPLAT_COST					(3)
+
+/*
+ *	A vector load of lanes that were stored separately can't be forwarded from the store buffer,
+ *	and waits for the stores to reach the cache. Stores more than the window of statements back
+ *	have already drained
+ */
+#define SLP_FORWARD_PENALTY				(12)
+#define SLP_FORWARD_WINDOW				(8)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	A statement is every instruction after the previous store up to its own
+ */
+typedef struct
+{
+	uint32_t	u32_start;
+	uint32_t	u32_store;
+} SLP_statement_t;
+
+typedef struct
+{
+	const IR_program_t *	kp_program;
+	IR_def_use_t			def_use;
+	SLP_statement_t *		p_statements;
+	uint32_t				u32_num_statements;
+	uint32_t *				pu32_last_store;		// Per variable: the statement that last stored it, or SLP_NONE
+	uint32_t *				pu32_vector_base;		// Per variable: first lane of the vector store that did, or SLP_NONE
+	uint32_t				u32_first;				// Statement the group being matched starts at
+	uint32_t				u32_first_store;		// Variable its lane 0 stores, so lane i stores the i-th after it
+	uint32_t				u32_num_nodes;			// Instructions matched so far in each lane
+	uint32_t				u32_scalar_cost;		// Of the group as it is
+	uint32_t				u32_vector_cost;		// Of the group as vector code
+	IR_instruction_t *		p_out;					// The rewritten program
+	uint32_t				u32_num_out;
+	uint32_t				u32_num_values;
+} SLP_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 		SLP_find_statements				(SLP_info_t * p_info);
+static bool 		SLP_match_group					(SLP_info_t * p_info, uint32_t u32_first);
+static bool 		SLP_match_tree					(SLP_info_t * p_info, const uint32_t * kpu32_values, bool b_root);
+static bool 		SLP_is_lane						(uint32_t u32_first_variable, uint32_t u32_lane, uint32_t u32_variable);
+static bool 		SLP_stalls_forwarding			(const SLP_info_t * kp_info, uint32_t u32_first_variable);
+static uint32_t 	SLP_emit_tree					(SLP_info_t * p_info, uint32_t u32_value);
+static void 		SLP_copy_statement				(SLP_info_t * p_info, uint32_t u32_statement);
+static void 		SLP_reload_roots				(SLP_info_t * p_info);
+static uint32_t 	SLP_append						(SLP_info_t * p_info, IR_opcode_t opcode, uint32_t u32_left, uint32_t u32_right, uint32_t u32_immediate);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Superword-level parallelism over straight-line code. Runs of IR_VECTOR_LANES consecutive u32
+ *	statements that compute the same tree of adds and subtracts, lane i over the variables declared
+ *	i after lane 0's, with the same constants, become one vector tree: a load per variable leaf, a
+ *	splat per constant and a single store. A statement's instructions must be only its own tree, and
+ *	no lane may read a variable an earlier lane writes, since every lane is loaded before any is
+ *	stored. A lane's result that later statements reuse is loaded back after the store. Runs only
+ *	become vector code when the cost model says it's cheaper
+ */
+void SLP_run(IR_program_t * p_program, uint32_t u32_num_variables, SLP_report_t * p_report)
+{
+	SLP_info_t info = { .kp_program = p_program, .u32_num_values = p_program->u32_num_values };
+	const IR_instruction_t * kp_store;
+	uint32_t u32_copied;
+	uint32_t u32_first_variable;
+	uint32_t u32_vector;
+	uint32_t k = 0;
+
+	info.p_statements = malloc(sizeof(SLP_statement_t) * (p_program->u32_num_instructions + 1));
+	info.pu32_last_store = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	info.pu32_vector_base = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	info.p_out = malloc(sizeof(IR_instruction_t) * (p_program->u32_num_instructions + 1));
+	ASSERT(info.p_statements && info.pu32_last_store && info.pu32_vector_base && info.p_out);
+
+	p_report->u32_num_groups = 0;
+	p_report->u32_num_unprofitable = 0;
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		info.pu32_last_store[i] = SLP_NONE;
+		info.pu32_vector_base[i] = SLP_NONE;
+	}
+
+	IR_build_def_use(p_program, &info.def_use);
+	SLP_find_statements(&info);
+
+	while (k < info.u32_num_statements)
+	{
+		if (k + IR_VECTOR_LANES <= info.u32_num_statements && SLP_match_group(&info, k))
+		{
+			if (info.u32_vector_cost < info.u32_scalar_cost)
+			{
+				kp_store = &p_program->p_instructions[info.p_statements[k].u32_store];
+				u32_first_variable = kp_store->u32_immediate;
+
+				u32_vector = SLP_emit_tree(&info, kp_store->pu32_operands[0]);
+				SLP_append(&info, IR_OPCODE_VSTORE, u32_vector, IR_VALUE_NONE, u32_first_variable);
+				SLP_reload_roots(&info);
+
+				for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+				{
+					info.pu32_last_store[u32_first_variable + j] = k + j;
+					info.pu32_vector_base[u32_first_variable + j] = u32_first_variable;
+				}
+
+				SLP_DBG("Statements %u to %u are one vector tree, %u cycles instead of %u\n",
+					k, k + IR_VECTOR_LANES - 1, info.u32_vector_cost, info.u32_scalar_cost);
+
+				p_report->u32_num_groups++;
+				k += IR_VECTOR_LANES;
+				continue;
+			}
+
+			// Left as it is, all of it: a run starting a statement later would mostly be the same run
+			p_report->u32_num_unprofitable++;
+
+			for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+			{
+				SLP_copy_statement(&info, k++);
+			}
+			continue;
+		}
+
+		SLP_copy_statement(&info, k++);
+	}
+
+	// Anything after the last store
+	u32_copied = (info.u32_num_statements > 0) ? info.p_statements[info.u32_num_statements - 1].u32_store + 1 : 0;
+
+	for (uint32_t i = u32_copied; i < p_program->u32_num_instructions; i++)
+	{
+		info.p_out[info.u32_num_out++] = p_program->p_instructions[i];
+	}
+
+	free(p_program->p_instructions);
+	p_program->p_instructions = info.p_out;
+	p_program->u32_capacity = p_program->u32_num_instructions + 1;
+	p_program->u32_num_instructions = info.u32_num_out;
+	p_program->u32_num_values = info.u32_num_values;
+
+	SLP_DBG("Vectorized %u groups of statements, kept %u unprofitable ones scalar\n", p_report->u32_num_groups, p_report->u32_num_unprofitable);
+
+	IR_deinit_def_use(&info.def_use);
+	free(info.p_statements);
+	free(info.pu32_last_store);
+	free(info.pu32_vector_base);
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static void SLP_find_statements(SLP_info_t * p_info)
+{
+	uint32_t u32_start = 0;
+
+	for (uint32_t i = 0; i < p_info->kp_program->u32_num_instructions; i++)
+	{
+		if (p_info->kp_program->p_instructions[i].u8_opcode == IR_OPCODE_STORE)
+		{
+			p_info->p_statements[p_info->u32_num_statements++] = (SLP_statement_t){ .u32_start = u32_start, .u32_store = i };
+			u32_start = i + 1;
+		}
+	}
+}
+
+/*
+ *	Whether statements [u32_first, u32_first + IR_VECTOR_LANES) can be one vector tree, and if so
+ *	what it and the scalar code cost
+ */
+static bool SLP_match_group(SLP_info_t * p_info, uint32_t u32_first)
+{
+	const IR_instruction_t * kp_instructions = p_info->kp_program->p_instructions;
+	const SLP_statement_t * kp_statements = &p_info->p_statements[u32_first];
+	uint32_t u32_first_variable = kp_instructions[kp_statements[0].u32_store].u32_immediate;
+	uint32_t u32_size = kp_statements[0].u32_store - kp_statements[0].u32_start;
+	uint32_t pu32_roots[IR_VECTOR_LANES];
+	const IR_instruction_t * kp_store;
+
+	if (u32_size == 0 || u32_size > SLP_MAX_TREE_SIZE)
+	{
+		return false;
+	}
+
+	for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+	{
+		kp_store = &kp_instructions[kp_statements[j].u32_store];
+
+		if (kp_statements[j].u32_store - kp_statements[j].u32_start != u32_size || kp_store->u8_type != BUILTINS_TYPE_U32 ||
+			!SLP_is_lane(u32_first_variable, j, kp_store->u32_immediate))
+		{
+			return false;
+		}
+
+		pu32_roots[j] = kp_store->pu32_operands[0];
+	}
+
+	p_info->u32_first = u32_first;
+	p_info->u32_first_store = u32_first_variable;
+	p_info->u32_num_nodes = 0;
+	p_info->u32_scalar_cost = IR_VECTOR_LANES;
+	p_info->u32_vector_cost = 1;
+
+	// Every instruction matched is used once, in its own statement, so matching as many as there are covers them all
+	return SLP_match_tree(p_info, pu32_roots, true) && p_info->u32_num_nodes == u32_size;
+}
+
+/*
+ *	Matches the trees rooted at the values, one per lane, and adds up what they cost. Below the roots
+ *	every value is used once, by its parent
+ */
+static bool SLP_match_tree(SLP_info_t * p_info, const uint32_t * kpu32_values, bool b_root)
+{
+	const IR_instruction_t * kp_instructions = p_info->kp_program->p_instructions;
+	const IR_instruction_t * kp_lanes[IR_VECTOR_LANES];
+	const SLP_statement_t * kp_statement;
+	uint32_t pu32_operands[IR_VECTOR_LANES];
+	uint32_t u32_def;
+
+	for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+	{
+		kp_statement = &p_info->p_statements[p_info->u32_first + j];
+		u32_def = p_info->def_use.pu32_def[kpu32_values[j]];
+		kp_lanes[j] = &kp_instructions[u32_def];
+
+		if (u32_def < kp_statement->u32_start || u32_def >= kp_statement->u32_store || (!b_root && IR_get_num_uses(&p_info->def_use, kpu32_values[j]) != 1) ||
+			kp_lanes[j]->u8_opcode != kp_lanes[0]->u8_opcode || kp_lanes[j]->u8_type != BUILTINS_TYPE_U32)
+		{
+			return false;
+		}
+
+		// The store is one use, anything else needs it reloaded
+		if (b_root && IR_get_num_uses(&p_info->def_use, kpu32_values[j]) != 1)
+		{
+			p_info->u32_vector_cost++;
+		}
+	}
+
+	if (++p_info->u32_num_nodes > SLP_MAX_TREE_SIZE)
+	{
+		return false;
+	}
+
+	switch (kp_lanes[0]->u8_opcode)
+	{
+		case IR_OPCODE_CONST:
+		{
+			for (uint32_t j = 1; j < IR_VECTOR_LANES; j++)
+			{
+				if (kp_lanes[j]->u32_immediate != kp_lanes[0]->u32_immediate)
+				{
+					return false;
+				}
+			}
+
+			// The scalar code takes it as an immediate
+			p_info->u32_vector_cost += SLP_SPLAT_COST;
+			return true;
+		}
+		case IR_OPCODE_LOAD:
+		{
+			for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+			{
+				// A lane reading what an earlier lane stored would see the value from before it instead
+				if (!SLP_is_lane(kp_lanes[0]->u32_immediate, j, kp_lanes[j]->u32_immediate) || kp_lanes[j]->u8_variable_type != BUILTINS_TYPE_U32 ||
+					(kp_lanes[j]->u32_immediate >= p_info->u32_first_store && kp_lanes[j]->u32_immediate < p_info->u32_first_store + j))
+				{
+					return false;
+				}
+			}
+
+			p_info->u32_scalar_cost += IR_VECTOR_LANES;
+			p_info->u32_vector_cost += 1 + (SLP_stalls_forwarding(p_info, kp_lanes[0]->u32_immediate) ? SLP_FORWARD_PENALTY : 0);
+			return true;
+		}
+		case IR_OPCODE_ADD:
+		case IR_OPCODE_SUB:
+		{
+			p_info->u32_scalar_cost += IR_VECTOR_LANES;
+			p_info->u32_vector_cost += 1;
+
+			for (uint32_t i = 0; i < IR_MAX_OPERANDS; i++)
+			{
+				for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+				{
+					// x + x would be one value matched twice
+					if (kp_lanes[j]->pu32_operands[0] == kp_lanes[j]->pu32_operands[1])
+					{
+						return false;
+					}
+
+					pu32_operands[j] = kp_lanes[j]->pu32_operands[i];
+				}
+
+				if (!SLP_match_tree(p_info, pu32_operands, false))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+		default:
+		{
+			// SSE2 has no 32-bit multiply that keeps the low halves, nor any divide
+			return false;
+		}
+	}
+}
+
+/*
+ *	Whether the variable is lane `u32_lane` of a vector starting at the first: a u32 declared that
+ *	many after it, and so stored that many u32s after it
+ */
+static bool SLP_is_lane(uint32_t u32_first_variable, uint32_t u32_lane, uint32_t u32_variable)
+{
+	return u32_variable == u32_first_variable + u32_lane &&
+			SYMBOL_TABLE_get_symbol_table()[u32_variable].builtin_type == BUILTINS_TYPE_U32 &&
+			SYMBOL_TABLE_get_offset(u32_variable) == SYMBOL_TABLE_get_offset(u32_first_variable) + (u32_lane * sizeof(uint32_t));
+}
+
+/*
+ *	Whether loading the lanes from the first would wait on recent stores it can't be forwarded from:
+ *	any lane stored lately by scalar code, or by a vector store of different lanes
+ */
+static bool SLP_stalls_forwarding(const SLP_info_t * kp_info, uint32_t u32_first_variable)
+{
+	uint32_t u32_last_store;
+
+	for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+	{
+		u32_last_store = kp_info->pu32_last_store[u32_first_variable + j];
+
+		if (u32_last_store != SLP_NONE && kp_info->u32_first - u32_last_store <= SLP_FORWARD_WINDOW &&
+			kp_info->pu32_vector_base[u32_first_variable + j] != u32_first_variable)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ *	Emits lane 0's tree as vector instructions, left operands first, and returns its value
+ */
+static uint32_t SLP_emit_tree(SLP_info_t * p_info, uint32_t u32_value)
+{
+	const IR_instruction_t * kp_instruction = &p_info->kp_program->p_instructions[p_info->def_use.pu32_def[u32_value]];
+	uint32_t u32_left;
+	uint32_t u32_right;
+
+	switch (kp_instruction->u8_opcode)
+	{
+		case IR_OPCODE_CONST:
+		{
+			return SLP_append(p_info, IR_OPCODE_VSPLAT, IR_VALUE_NONE, IR_VALUE_NONE, kp_instruction->u32_immediate);
+		}
+		case IR_OPCODE_LOAD:
+		{
+			return SLP_append(p_info, IR_OPCODE_VLOAD, IR_VALUE_NONE, IR_VALUE_NONE, kp_instruction->u32_immediate);
+		}
+		default:
+		{
+			u32_left = SLP_emit_tree(p_info, kp_instruction->pu32_operands[0]);
+			u32_right = SLP_emit_tree(p_info, kp_instruction->pu32_operands[1]);
+
+			return SLP_append(p_info, (kp_instruction->u8_opcode == IR_OPCODE_ADD) ? IR_OPCODE_VADD : IR_OPCODE_VSUB, u32_left, u32_right, 0);
+		}
+	}
+}
+
+/*
+ *	Keeps a statement as it is
+ */
+static void SLP_copy_statement(SLP_info_t * p_info, uint32_t u32_statement)
+{
+	const SLP_statement_t * kp_statement = &p_info->p_statements[u32_statement];
+	const IR_instruction_t * kp_store = &p_info->kp_program->p_instructions[kp_statement->u32_store];
+
+	for (uint32_t i = kp_statement->u32_start; i <= kp_statement->u32_store; i++)
+	{
+		p_info->p_out[p_info->u32_num_out++] = p_info->kp_program->p_instructions[i];
+	}
+
+	p_info->pu32_last_store[kp_store->u32_immediate] = u32_statement;
+	p_info->pu32_vector_base[kp_store->u32_immediate] = SLP_NONE;
+}
+
+/*
+ *	Loads back each lane of the group just stored that later statements still use, under the value it
+ *	had, so they need no rewriting. Store forwarding serves a narrow load from inside a wider store
+ */
+static void SLP_reload_roots(SLP_info_t * p_info)
+{
+	const SLP_statement_t * kp_statement;
+	const IR_instruction_t * kp_store;
+	IR_instruction_t * p_load;
+
+	for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+	{
+		kp_statement = &p_info->p_statements[p_info->u32_first + j];
+		kp_store = &p_info->kp_program->p_instructions[kp_statement->u32_store];
+
+		if (IR_get_num_uses(&p_info->def_use, kp_store->pu32_operands[0]) != 1)
+		{
+			p_load = &p_info->p_out[p_info->u32_num_out++];
+			p_load->u8_opcode = IR_OPCODE_LOAD;
+			p_load->u8_type = BUILTINS_TYPE_U32;
+			p_load->u8_variable_type = BUILTINS_TYPE_U32;
+			p_load->u32_result = kp_store->pu32_operands[0];
+			p_load->pu32_operands[0] = IR_VALUE_NONE;
+			p_load->pu32_operands[1] = IR_VALUE_NONE;
+			p_load->u32_immediate = kp_store->u32_immediate;
+		}
+	}
+}
+
+/*
+ *	A vector group is always shorter than the statements it replaces, so the output never outgrows the input
+ */
+static uint32_t SLP_append(SLP_info_t * p_info, IR_opcode_t opcode, uint32_t u32_left, uint32_t u32_right, uint32_t u32_immediate)
+{
+	IR_instruction_t * p_instruction = &p_info->p_out[p_info->u32_num_out++];
+
+	p_instruction->u8_opcode = (uint8_t)opcode;
+	p_instruction->u8_type = BUILTINS_TYPE_U32;
+	p_instruction->u8_variable_type = BUILTINS_TYPE_U32;
+	p_instruction->u32_result = (opcode == IR_OPCODE_VSTORE) ? IR_VALUE_NONE : p_info->u32_num_values++;
+	p_instruction->pu32_operands[0] = u32_left;
+	p_instruction->pu32_operands[1] = u32_right;
+	p_instruction->u32_immediate = u32_immediate;
+
+	return p_instruction->u32_result;
+}
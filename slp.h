@@ -0,0 +1,23 @@
+#ifndef SLP_H
+#define SLP_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct _SLP_report
+{
+	uint32_t	u32_num_groups;					// Runs of IR_VECTOR_LANES statements turned into vector code
+	uint32_t	u32_num_unprofitable;			// Runs that could have been, but the cost model kept scalar
+} SLP_report_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			SLP_run							(IR_program_t * p_program, uint32_t u32_num_variables, SLP_report_t * p_report);
+
+#endif
@@ -0,0 +1,346 @@
+#include "strength.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_STRENGTH
+#define STRENGTH_DBG(fmt, ...)			printf(BOLD("STRENGTH:\t")fmt, ##__VA_ARGS__)
+#define STRENGTH_GREEN(fmt, ...)		printf(BOLD(BRIGHT_GREEN("STRENGTH:\t"))fmt, ##__VA_ARGS__)
+#define STRENGTH_WARN(fmt, ...)			printf(BOLD(BRIGHT_YELLOW("STRENGTH:\t"))fmt, ##__VA_ARGS__)
+#define STRENGTH_ERR(fmt, ...)			printf(BOLD(BRIGHT_RED("STRENGTH:\t"))fmt, ##__VA_ARGS__)
+#else
+#define STRENGTH_DBG(fmt, ...)
+#define STRENGTH_GREEN(fmt, ...)
+#define STRENGTH_WARN(fmt, ...)
+#define STRENGTH_ERR(fmt, ...)
+#endif
+
+#define STRENGTH_IS_POWER_OF_TWO(u32_value)		(((u32_value) & ((u32_value) - 1)) == 0)
+#define STRENGTH_WORD_BITS						(32)
+
+#define STRENGTH_VREG(u32_vreg)					ASM_OPERAND_VIRTUAL, (u32_vreg)
+#define STRENGTH_HW_REG(asm_register)			ASM_OPERAND_REGISTER, (asm_register)
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	What one lea can multiply by, and how
+ */
+static const struct
+{
+	uint8_t			u8_factor;
+	ASM_opcode_t	opcode;
+} pk_lea_factors[] =
+{
+	{ 3, ASM_OPCODE_LEA3 },
+	{ 5, ASM_OPCODE_LEA5 },
+	{ 9, ASM_OPCODE_LEA9 },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static uint8_t 			STRENGTH_ceil_log2				(uint32_t u32_value);
+static ASM_opcode_t 	STRENGTH_get_lea_opcode			(uint8_t u8_factor);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Finds the cheapest way to multiply by a constant: a shift for powers of two, an lea for 3, 5
+ *	and 9, and a pair of those for their products with each other and with powers of two.
+ *	Anything else stays an imul
+ */
+void STRENGTH_plan_multiply(uint32_t u32_multiplier, STRENGTH_multiply_t * p_plan)
+{
+	uint32_t u32_rest;
+
+	p_plan->u32_multiplier = u32_multiplier;
+	p_plan->b_imul = false;
+	p_plan->u8_num_steps = 0;
+
+	if (u32_multiplier <= 1)
+	{
+		return;
+	}
+
+	if (STRENGTH_IS_POWER_OF_TWO(u32_multiplier))
+	{
+		p_plan->p_steps[p_plan->u8_num_steps++] = (STRENGTH_step_t){ .u8_kind = STRENGTH_STEP_SHIFT, .u8_amount = STRENGTH_ceil_log2(u32_multiplier) };
+		return;
+	}
+
+	for (uint32_t i = 0; i < sizeof(pk_lea_factors) / sizeof(pk_lea_factors[0]); i++)
+	{
+		if (u32_multiplier % pk_lea_factors[i].u8_factor != 0)
+		{
+			continue;
+		}
+
+		u32_rest = u32_multiplier / pk_lea_factors[i].u8_factor;
+
+		if (STRENGTH_IS_POWER_OF_TWO(u32_rest))
+		{
+			p_plan->p_steps[p_plan->u8_num_steps++] = (STRENGTH_step_t){ .u8_kind = STRENGTH_STEP_LEA, .u8_amount = pk_lea_factors[i].u8_factor };
+
+			if (u32_rest > 1)
+			{
+				p_plan->p_steps[p_plan->u8_num_steps++] = (STRENGTH_step_t){ .u8_kind = STRENGTH_STEP_SHIFT, .u8_amount = STRENGTH_ceil_log2(u32_rest) };
+			}
+			return;
+		}
+
+		for (uint32_t j = 0; j < sizeof(pk_lea_factors) / sizeof(pk_lea_factors[0]); j++)
+		{
+			if (u32_rest == pk_lea_factors[j].u8_factor)
+			{
+				p_plan->p_steps[p_plan->u8_num_steps++] = (STRENGTH_step_t){ .u8_kind = STRENGTH_STEP_LEA, .u8_amount = pk_lea_factors[i].u8_factor };
+				p_plan->p_steps[p_plan->u8_num_steps++] = (STRENGTH_step_t){ .u8_kind = STRENGTH_STEP_LEA, .u8_amount = pk_lea_factors[j].u8_factor };
+				return;
+			}
+		}
+	}
+
+	p_plan->b_imul = true;
+}
+
+/*
+ *	Powers of two are a shift. Anything else multiplies by a reciprocal m / 2^(32 + p) rounded up,
+ *	which gives the exact quotient for every 32-bit dividend as long as m * divisor overshoots
+ *	2^(32 + p) by no more than 2^p. The smallest such p with m in 32 bits wins; if there is none,
+ *	p = ceil(log2(divisor)) always works but m takes 33 bits, and its top bit is added back in
+ *	without overflowing 32 bits. The divisor can't be 0
+ */
+void STRENGTH_plan_divide(uint32_t u32_divisor, STRENGTH_divide_t * p_plan)
+{
+	uint8_t u8_log = STRENGTH_ceil_log2(u32_divisor);
+	uint64_t u64_numerator;
+	uint64_t u64_multiplier;
+
+	ASSERT(u32_divisor != 0);
+
+	if (STRENGTH_IS_POWER_OF_TWO(u32_divisor))
+	{
+		*p_plan = (STRENGTH_divide_t){ .u8_kind = STRENGTH_DIVIDE_SHIFT, .u8_shift = u8_log, .u32_multiplier = 0 };
+		return;
+	}
+
+	for (uint8_t p = 0; p < u8_log; p++)
+	{
+		u64_numerator = 1ull << (STRENGTH_WORD_BITS + p);
+		u64_multiplier = (u64_numerator + u32_divisor - 1) / u32_divisor;
+
+		if (u64_multiplier <= UINT32_MAX && (u64_multiplier * u32_divisor) - u64_numerator <= (1ull << p))
+		{
+			*p_plan = (STRENGTH_divide_t)
+			{
+				.u8_kind		= STRENGTH_DIVIDE_MULTIPLY,
+				.u8_shift		= (uint8_t)(STRENGTH_WORD_BITS + p),
+				.u32_multiplier	= (uint32_t)u64_multiplier,
+			};
+			STRENGTH_DBG("x / %u = (x * %u) >> %u\n", u32_divisor, p_plan->u32_multiplier, p_plan->u8_shift);
+			return;
+		}
+	}
+
+	// Not a power of two, so rounding 2^(32 + log) - 1 down and adding one rounds 2^(32 + log) up
+	u64_numerator = (u8_log == STRENGTH_WORD_BITS) ? UINT64_MAX : ((1ull << (STRENGTH_WORD_BITS + u8_log)) - 1);
+	u64_multiplier = (u64_numerator / u32_divisor) + 1;
+
+	*p_plan = (STRENGTH_divide_t)
+	{
+		.u8_kind		= STRENGTH_DIVIDE_MULTIPLY_ADD,
+		.u8_shift		= (uint8_t)(u8_log - 1),
+		.u32_multiplier	= (uint32_t)(u64_multiplier - (1ull << STRENGTH_WORD_BITS)),
+	};
+	STRENGTH_DBG("x / %u = (x * (2^32 + %u)) >> %u\n", u32_divisor, p_plan->u32_multiplier, STRENGTH_WORD_BITS + u8_log);
+}
+
+/*
+ *	What the instructions STRENGTH_emit_multiply picks compute, step by step
+ */
+uint32_t STRENGTH_evaluate_multiply(const STRENGTH_multiply_t * kp_plan, uint32_t u32_value)
+{
+	if (kp_plan->b_imul)
+	{
+		return u32_value * kp_plan->u32_multiplier;
+	}
+
+	if (kp_plan->u32_multiplier == 0)
+	{
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < kp_plan->u8_num_steps; i++)
+	{
+		if (kp_plan->p_steps[i].u8_kind == STRENGTH_STEP_SHIFT)
+		{
+			u32_value <<= kp_plan->p_steps[i].u8_amount;
+		}
+		else
+		{
+			u32_value *= kp_plan->p_steps[i].u8_amount;
+		}
+	}
+
+	return u32_value;
+}
+
+/*
+ *	What the instructions STRENGTH_emit_divide picks compute, at the widths they compute it in
+ */
+uint32_t STRENGTH_evaluate_divide(const STRENGTH_divide_t * kp_plan, uint32_t u32_value)
+{
+	uint32_t u32_high;
+
+	switch (kp_plan->u8_kind)
+	{
+		case STRENGTH_DIVIDE_SHIFT:
+		{
+			return u32_value >> kp_plan->u8_shift;
+		}
+		case STRENGTH_DIVIDE_MULTIPLY:
+		{
+			return (uint32_t)(((uint64_t)u32_value * kp_plan->u32_multiplier) >> kp_plan->u8_shift);
+		}
+		case STRENGTH_DIVIDE_MULTIPLY_ADD:
+		{
+			u32_high = (uint32_t)(((uint64_t)u32_value * kp_plan->u32_multiplier) >> STRENGTH_WORD_BITS);
+			return (((u32_value - u32_high) >> 1) + u32_high) >> kp_plan->u8_shift;
+		}
+		default:
+		{
+			ASSERT(0);
+			return 0;
+		}
+	}
+}
+
+/*
+ *	Emits src * multiplier into dst, which may be src itself when src has no other use. Every step is
+ *	exact, so it holds at either width
+ */
+void STRENGTH_emit_multiply(ASM_buffer_t * p_buffer, const STRENGTH_multiply_t * kp_plan, ASM_width_t width, uint32_t u32_src_vreg, uint32_t u32_dst_vreg)
+{
+	uint32_t u32_vreg = u32_src_vreg;
+	const STRENGTH_step_t * kp_step;
+
+	if (!kp_plan->b_imul && kp_plan->u32_multiplier == 0)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, width, ASM_OPERAND_IMMEDIATE, 0, STRENGTH_VREG(u32_dst_vreg));
+		return;
+	}
+
+	// lea writes a register other than the one it reads, so a leading one saves the copy
+	if (u32_src_vreg != u32_dst_vreg && (kp_plan->u8_num_steps == 0 || kp_plan->p_steps[0].u8_kind != STRENGTH_STEP_LEA))
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, width, STRENGTH_VREG(u32_src_vreg), STRENGTH_VREG(u32_dst_vreg));
+		u32_vreg = u32_dst_vreg;
+	}
+
+	if (kp_plan->b_imul)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_IMUL, width, ASM_OPERAND_IMMEDIATE, kp_plan->u32_multiplier, STRENGTH_VREG(u32_dst_vreg));
+		return;
+	}
+
+	for (uint8_t i = 0; i < kp_plan->u8_num_steps; i++)
+	{
+		kp_step = &kp_plan->p_steps[i];
+
+		if (kp_step->u8_kind == STRENGTH_STEP_SHIFT)
+		{
+			ASM_emit(p_buffer, ASM_OPCODE_SHL, width, ASM_OPERAND_IMMEDIATE, kp_step->u8_amount, STRENGTH_VREG(u32_dst_vreg));
+		}
+		else
+		{
+			ASM_emit(p_buffer, STRENGTH_get_lea_opcode(kp_step->u8_amount), width, STRENGTH_VREG(u32_vreg), STRENGTH_VREG(u32_dst_vreg));
+		}
+
+		u32_vreg = u32_dst_vreg;
+	}
+}
+
+/*
+ *	Emits src / divisor into dst, which may be src itself when src has no other use. The wide
+ *	multiply runs in rax and rdx, which the allocator keeps clear as it does for div
+ */
+void STRENGTH_emit_divide(ASM_buffer_t * p_buffer, const STRENGTH_divide_t * kp_plan, uint32_t u32_src_vreg, uint32_t u32_dst_vreg)
+{
+	if (kp_plan->u8_kind == STRENGTH_DIVIDE_SHIFT)
+	{
+		if (u32_src_vreg != u32_dst_vreg)
+		{
+			ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, STRENGTH_VREG(u32_src_vreg), STRENGTH_VREG(u32_dst_vreg));
+		}
+		if (kp_plan->u8_shift > 0)
+		{
+			ASM_emit(p_buffer, ASM_OPCODE_SHR, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, kp_plan->u8_shift, STRENGTH_VREG(u32_dst_vreg));
+		}
+		return;
+	}
+
+	// 32-bit moves zero the top halves, so the 64-bit product is exact
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, STRENGTH_VREG(u32_src_vreg), STRENGTH_HW_REG(ASM_REGISTER_RAX));
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, kp_plan->u32_multiplier, STRENGTH_HW_REG(ASM_REGISTER_RDX));
+	ASM_emit(p_buffer, ASM_OPCODE_IMUL, ASM_WIDTH_64, STRENGTH_HW_REG(ASM_REGISTER_RDX), STRENGTH_HW_REG(ASM_REGISTER_RAX));
+
+	if (kp_plan->u8_kind == STRENGTH_DIVIDE_MULTIPLY)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_SHR, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, kp_plan->u8_shift, STRENGTH_HW_REG(ASM_REGISTER_RAX));
+	}
+	else
+	{
+		// (x + t) >> 1 without the carry out of 32 bits: ((x - t) >> 1) + t
+		ASM_emit(p_buffer, ASM_OPCODE_SHR, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, STRENGTH_WORD_BITS, STRENGTH_HW_REG(ASM_REGISTER_RAX));
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, STRENGTH_VREG(u32_src_vreg), STRENGTH_HW_REG(ASM_REGISTER_RDX));
+		ASM_emit(p_buffer, ASM_OPCODE_SUB, ASM_WIDTH_32, STRENGTH_HW_REG(ASM_REGISTER_RAX), STRENGTH_HW_REG(ASM_REGISTER_RDX));
+		ASM_emit(p_buffer, ASM_OPCODE_SHR, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 1, STRENGTH_HW_REG(ASM_REGISTER_RDX));
+		ASM_emit(p_buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, STRENGTH_HW_REG(ASM_REGISTER_RDX), STRENGTH_HW_REG(ASM_REGISTER_RAX));
+
+		if (kp_plan->u8_shift > 0)
+		{
+			ASM_emit(p_buffer, ASM_OPCODE_SHR, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, kp_plan->u8_shift, STRENGTH_HW_REG(ASM_REGISTER_RAX));
+		}
+	}
+
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, STRENGTH_HW_REG(ASM_REGISTER_RAX), STRENGTH_VREG(u32_dst_vreg));
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Smallest l with 2^l >= value
+ */
+static uint8_t STRENGTH_ceil_log2(uint32_t u32_value)
+{
+	uint8_t u8_log = 0;
+
+	while (u8_log < STRENGTH_WORD_BITS && (1ull << u8_log) < u32_value)
+	{
+		u8_log++;
+	}
+
+	return u8_log;
+}
+
+static ASM_opcode_t STRENGTH_get_lea_opcode(uint8_t u8_factor)
+{
+	for (uint32_t i = 0; i < sizeof(pk_lea_factors) / sizeof(pk_lea_factors[0]); i++)
+	{
+		if (pk_lea_factors[i].u8_factor == u8_factor)
+		{
+			return pk_lea_factors[i].opcode;
+		}
+	}
+
+	ASSERT(0);
+	return ASM_OPCODE_NUM_OPCODES;
+}
@@ -0,0 +1,72 @@
+#ifndef STRENGTH_H
+#define STRENGTH_H
+
+#include "common.h"
+#include "asm.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	Past two steps a multiply by an immediate is as fast, at 3 cycles of latency
+ */
+#define STRENGTH_MAX_MULTIPLY_STEPS		(2)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef enum
+{
+	STRENGTH_STEP_SHIFT = 0,		// x << u8_amount
+	STRENGTH_STEP_LEA,				// x * u8_amount, for 3, 5 or 9
+} STRENGTH_step_kind_t;
+
+typedef struct
+{
+	uint8_t		u8_kind;			// STRENGTH_step_kind_t
+	uint8_t		u8_amount;
+} STRENGTH_step_t;
+
+/*
+ *	x * u32_multiplier as a chain of steps, each applied to the last one's result.
+ *	No steps at all is either a copy (by 1) or a zero (by 0)
+ */
+typedef struct _STRENGTH_multiply
+{
+	uint32_t			u32_multiplier;
+	bool				b_imul;								// Nothing cheaper: imul by the immediate
+	uint8_t				u8_num_steps;
+	STRENGTH_step_t		p_steps[STRENGTH_MAX_MULTIPLY_STEPS];
+} STRENGTH_multiply_t;
+
+typedef enum
+{
+	STRENGTH_DIVIDE_SHIFT = 0,		// x >> u8_shift, for powers of two
+	STRENGTH_DIVIDE_MULTIPLY,		// (x * u32_multiplier) >> u8_shift, in 64 bits
+	STRENGTH_DIVIDE_MULTIPLY_ADD,	// The multiplier needs 33 bits: t = (x * u32_multiplier) >> 32, then (((x - t) >> 1) + t) >> u8_shift
+} STRENGTH_divide_kind_t;
+
+/*
+ *	Unsigned 32-bit x / divisor without a div (Granlund & Montgomery)
+ */
+typedef struct _STRENGTH_divide
+{
+	uint8_t		u8_kind;			// STRENGTH_divide_kind_t
+	uint8_t		u8_shift;
+	uint32_t	u32_multiplier;		// Low 32 bits of the reciprocal, rounded up
+} STRENGTH_divide_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			STRENGTH_plan_multiply			(uint32_t u32_multiplier, STRENGTH_multiply_t * p_plan);
+void 			STRENGTH_plan_divide			(uint32_t u32_divisor, STRENGTH_divide_t * p_plan);
+uint32_t 		STRENGTH_evaluate_multiply		(const STRENGTH_multiply_t * kp_plan, uint32_t u32_value);
+uint32_t 		STRENGTH_evaluate_divide		(const STRENGTH_divide_t * kp_plan, uint32_t u32_value);
+void 			STRENGTH_emit_multiply			(ASM_buffer_t * p_buffer, const STRENGTH_multiply_t * kp_plan, ASM_width_t width, uint32_t u32_src_vreg, uint32_t u32_dst_vreg);
+void 			STRENGTH_emit_divide			(ASM_buffer_t * p_buffer, const STRENGTH_divide_t * kp_plan, uint32_t u32_src_vreg, uint32_t u32_dst_vreg);
+
+#endif
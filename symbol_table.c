@@ -0,0 +1,246 @@
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define SYMBOL_TABLE_INITIAL_CAPACITY	(16)	// Must be a power of two, the hash index relies on it
+
+/*
+ *	Where variables no symbol describes would be, as if every variable were a u32
+ */
+#define SYMBOL_TABLE_DEFAULT_SIZE		(sizeof(uint32_t))
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	SYMBOL_TABLE_entry_t *	p_entries;			// Symbols, in the order they were appended
+	uint32_t				u32_num_symbols;
+	uint32_t				u32_capacity;		// Room in `p_entries`, and half the size of `pu32_index`
+	uint32_t *				pu32_index;			// Open-addressed hash index into `p_entries`
+	uint32_t *				pu32_offsets;		// Per symbol, its byte offset in the variable storage
+	uint32_t				u32_storage_size;	// Bytes of variable storage every symbol so far needs
+} SYMBOL_TABLE_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+static SYMBOL_TABLE_info_t symbol_table_info;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static uint32_t 	SYMBOL_TABLE_hash			(const char * kpc_lexeme);
+static uint32_t 	SYMBOL_TABLE_find_slot		(const char * kpc_lexeme);
+static void 		SYMBOL_TABLE_grow			(void);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Initializes the module, dropping any symbols from a previous run
+ */
+void SYMBOL_TABLE_init(void)
+{
+	SYMBOL_TABLE_deinit();
+
+	symbol_table_info.u32_capacity = SYMBOL_TABLE_INITIAL_CAPACITY;
+	symbol_table_info.p_entries = malloc(sizeof(SYMBOL_TABLE_entry_t) * symbol_table_info.u32_capacity);
+	symbol_table_info.pu32_index = malloc(sizeof(uint32_t) * symbol_table_info.u32_capacity * 2);
+	symbol_table_info.pu32_offsets = malloc(sizeof(uint32_t) * symbol_table_info.u32_capacity);
+	ASSERT(symbol_table_info.p_entries && symbol_table_info.pu32_index && symbol_table_info.pu32_offsets);
+
+	memset(symbol_table_info.pu32_index, 0xFF, sizeof(uint32_t) * symbol_table_info.u32_capacity * 2);
+}
+
+/*
+ *	Deinitializes the module
+ */
+void SYMBOL_TABLE_deinit(void)
+{
+	free(symbol_table_info.p_entries);
+	free(symbol_table_info.pu32_index);
+	free(symbol_table_info.pu32_offsets);
+	symbol_table_info.p_entries = NULL;
+	symbol_table_info.pu32_index = NULL;
+	symbol_table_info.pu32_offsets = NULL;
+	symbol_table_info.u32_num_symbols = 0;
+	symbol_table_info.u32_storage_size = 0;
+	symbol_table_info.u32_capacity = 0;
+}
+
+/*
+ *	Retrieves all symbols. Index i of the returned array is symbol index i
+ */
+const SYMBOL_TABLE_entry_t * SYMBOL_TABLE_get_symbol_table(void)
+{
+	return symbol_table_info.p_entries;
+}
+
+/*
+ *	Retrieves the symbol count
+ */
+uint32_t SYMBOL_TABLE_get_num_symbols(void)
+{
+	return symbol_table_info.u32_num_symbols;
+}
+
+/*
+ *	Appends a symbol, and places it in the variable storage after the last one, aligned to its size.
+ *	Appending a lexeme that's already present is a no-op
+ */
+STATUS_t SYMBOL_TABLE_append_symbol(const SYMBOL_TABLE_entry_t * kp_symbol)
+{
+	uint32_t u32_slot;
+	uint32_t u32_size;
+
+	if (kp_symbol == NULL || kp_symbol->p_token == NULL)
+	{
+		return STATUS_FAILED;
+	}
+
+	if (symbol_table_info.p_entries == NULL)
+	{
+		SYMBOL_TABLE_init();
+	}
+
+	u32_slot = SYMBOL_TABLE_find_slot(kp_symbol->p_token->pc_lexeme);
+
+	if (symbol_table_info.pu32_index[u32_slot] != SYMBOL_TABLE_INDEX_NONE)
+	{
+		return STATUS_OK;
+	}
+
+	if (symbol_table_info.u32_num_symbols == symbol_table_info.u32_capacity)
+	{
+		SYMBOL_TABLE_grow();
+		u32_slot = SYMBOL_TABLE_find_slot(kp_symbol->p_token->pc_lexeme);
+	}
+
+	// Entries have const members, so they're copied in wholesale
+	memcpy(&symbol_table_info.p_entries[symbol_table_info.u32_num_symbols], kp_symbol, sizeof(SYMBOL_TABLE_entry_t));
+
+	u32_size = BUILTINS_get_size(kp_symbol->builtin_type);
+	symbol_table_info.u32_storage_size = (symbol_table_info.u32_storage_size + u32_size - 1) & ~(u32_size - 1);
+	symbol_table_info.pu32_offsets[symbol_table_info.u32_num_symbols] = symbol_table_info.u32_storage_size;
+	symbol_table_info.u32_storage_size += u32_size;
+
+	symbol_table_info.pu32_index[u32_slot] = symbol_table_info.u32_num_symbols++;
+
+	return STATUS_OK;
+}
+
+/*
+ *	Finds the index of the symbol named `kpc_lexeme`, or SYMBOL_TABLE_INDEX_NONE
+ */
+uint32_t SYMBOL_TABLE_lookup(const char * kpc_lexeme)
+{
+	if (symbol_table_info.pu32_index == NULL || kpc_lexeme == NULL)
+	{
+		return SYMBOL_TABLE_INDEX_NONE;
+	}
+
+	return symbol_table_info.pu32_index[SYMBOL_TABLE_find_slot(kpc_lexeme)];
+}
+
+/*
+ *	Byte offset of a variable in the storage generated code runs over. Variables past the last symbol
+ *	(hand-built code refers to some) sit where they would if every variable were a u32
+ */
+uint32_t SYMBOL_TABLE_get_offset(uint32_t u32_symbol)
+{
+	if (u32_symbol >= symbol_table_info.u32_num_symbols)
+	{
+		return u32_symbol * SYMBOL_TABLE_DEFAULT_SIZE;
+	}
+
+	return symbol_table_info.pu32_offsets[u32_symbol];
+}
+
+/*
+ *	Bytes of storage every variable needs, padding included
+ */
+uint32_t SYMBOL_TABLE_get_storage_size(void)
+{
+	return symbol_table_info.u32_storage_size;
+}
+
+/*
+ *	Moves every symbol to a new offset, one per symbol in index order, replacing the order they were
+ *	appended in. Later appends go after the new end
+ */
+void SYMBOL_TABLE_set_layout(const uint32_t * kpu32_offsets, uint32_t u32_storage_size)
+{
+	memcpy(symbol_table_info.pu32_offsets, kpu32_offsets, sizeof(uint32_t) * symbol_table_info.u32_num_symbols);
+	symbol_table_info.u32_storage_size = u32_storage_size;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	FNV-1a
+ */
+static uint32_t SYMBOL_TABLE_hash(const char * kpc_lexeme)
+{
+	uint32_t u32_hash = 2166136261u;
+
+	while (*kpc_lexeme)
+	{
+		u32_hash ^= (uint8_t)*kpc_lexeme++;
+		u32_hash *= 16777619u;
+	}
+
+	return u32_hash;
+}
+
+/*
+ *	Linear probe for either the slot holding `kpc_lexeme` or the empty slot it would go in.
+ *	The index is kept at most half full, so this always terminates
+ */
+static uint32_t SYMBOL_TABLE_find_slot(const char * kpc_lexeme)
+{
+	uint32_t u32_mask = (symbol_table_info.u32_capacity * 2) - 1;
+	uint32_t u32_slot = SYMBOL_TABLE_hash(kpc_lexeme) & u32_mask;
+	uint32_t u32_symbol;
+
+	while ((u32_symbol = symbol_table_info.pu32_index[u32_slot]) != SYMBOL_TABLE_INDEX_NONE)
+	{
+		if (strcmp(symbol_table_info.p_entries[u32_symbol].p_token->pc_lexeme, kpc_lexeme) == 0)
+		{
+			break;
+		}
+		u32_slot = (u32_slot + 1) & u32_mask;
+	}
+
+	return u32_slot;
+}
+
+/*
+ *	Doubles the entry storage and rebuilds the hash index to match
+ */
+static void SYMBOL_TABLE_grow(void)
+{
+	uint32_t u32_slot;
+
+	symbol_table_info.u32_capacity *= 2;
+	symbol_table_info.p_entries = realloc(symbol_table_info.p_entries, sizeof(SYMBOL_TABLE_entry_t) * symbol_table_info.u32_capacity);
+	symbol_table_info.pu32_index = realloc(symbol_table_info.pu32_index, sizeof(uint32_t) * symbol_table_info.u32_capacity * 2);
+	symbol_table_info.pu32_offsets = realloc(symbol_table_info.pu32_offsets, sizeof(uint32_t) * symbol_table_info.u32_capacity);
+	ASSERT(symbol_table_info.p_entries && symbol_table_info.pu32_index && symbol_table_info.pu32_offsets);
+
+	memset(symbol_table_info.pu32_index, 0xFF, sizeof(uint32_t) * symbol_table_info.u32_capacity * 2);
+
+	for (uint32_t i = 0; i < symbol_table_info.u32_num_symbols; i++)
+	{
+		u32_slot = SYMBOL_TABLE_find_slot(symbol_table_info.p_entries[i].p_token->pc_lexeme);
+		symbol_table_info.pu32_index[u32_slot] = i;
+	}
+}
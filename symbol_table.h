@@ -4,6 +4,16 @@
 #include "lex.h"
 #include "builtins.h"
 
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define SYMBOL_TABLE_INDEX_NONE			(UINT32_MAX)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
 typedef struct _SYMBOL_TABLE_entry
 {
 	const LEX_token_t * 		p_token;
@@ -11,7 +21,18 @@ typedef struct _SYMBOL_TABLE_entry
 	const uint32_t				u32_scope_id;
 } SYMBOL_TABLE_entry_t;
 
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 							SYMBOL_TABLE_init				(void);
+void 							SYMBOL_TABLE_deinit				(void);
 const SYMBOL_TABLE_entry_t * 	SYMBOL_TABLE_get_symbol_table	(void);
+uint32_t 						SYMBOL_TABLE_get_num_symbols	(void);
 STATUS_t 						SYMBOL_TABLE_append_symbol		(const SYMBOL_TABLE_entry_t * kp_symbol);
+uint32_t 						SYMBOL_TABLE_lookup				(const char * kpc_lexeme);
+uint32_t 						SYMBOL_TABLE_get_offset			(uint32_t u32_symbol);
+uint32_t 						SYMBOL_TABLE_get_storage_size	(void);
+void 							SYMBOL_TABLE_set_layout			(const uint32_t * kpu32_offsets, uint32_t u32_storage_size);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,135 @@
+#include <time.h>
+#include "front_end_cost.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static uint64_t 	FRONT_END_COST_now_ns			(void);
+static uint32_t 	FRONT_END_COST_base_repeats		(size_t size);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Pushes one input through IO_HANDLER -> LEX -> PARSE and tears everything down again
+ */
+void FRONT_END_COST_run(const uint8_t * kpu8_data, size_t size)
+{
+	if (IO_HANDLER_load_source_buffer((const char *)kpu8_data, (uint32_t)size) != STATUS_OK)
+	{
+		return;
+	}
+
+	LEX_init();
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Times the front end on `u32_repeats` back-to-back copies of the input.
+ *	Returns the cheapest of FRONT_END_COST_NUM_SAMPLES runs, in nanoseconds of thread CPU time
+ */
+uint64_t FRONT_END_COST_measure(const uint8_t * kpu8_data, size_t size, uint32_t u32_repeats)
+{
+	uint8_t * pu8_input = malloc(size * u32_repeats);
+	uint64_t u64_best = UINT64_MAX;
+	uint64_t u64_start;
+	uint64_t u64_elapsed;
+
+	ASSERT(pu8_input);
+
+	for (uint32_t i = 0; i < u32_repeats; i++)
+	{
+		memcpy(pu8_input + (i * size), kpu8_data, size);
+	}
+
+	for (uint32_t i = 0; i < FRONT_END_COST_NUM_SAMPLES; i++)
+	{
+		u64_start = FRONT_END_COST_now_ns();
+		FRONT_END_COST_run(pu8_input, size * u32_repeats);
+		u64_elapsed = FRONT_END_COST_now_ns() - u64_start;
+
+		if (u64_elapsed < u64_best)
+		{
+			u64_best = u64_elapsed;
+		}
+	}
+
+	free(pu8_input);
+
+	return u64_best;
+}
+
+/*
+ *	The quantity the fuzzer maximizes. Measured on the input repeated up to FRONT_END_COST_BASE_SIZE
+ *	so that fixed setup costs don't dominate short inputs
+ */
+double FRONT_END_COST_per_byte(const uint8_t * kpu8_data, size_t size)
+{
+	uint32_t u32_repeats = FRONT_END_COST_base_repeats(size);
+
+	return (double)FRONT_END_COST_measure(kpu8_data, size, u32_repeats) / (double)(size * u32_repeats);
+}
+
+/*
+ *	Compares the cost of the base-sized input against FRONT_END_COST_SCALE_FACTOR times as much of it.
+ *	`p_growth` receives how much faster than linear the cost grew (1.0 is perfectly linear).
+ *	Returns false if that exceeds FRONT_END_COST_MAX_GROWTH
+ */
+bool FRONT_END_COST_check_scaling(const uint8_t * kpu8_data, size_t size, double * p_growth)
+{
+	uint32_t u32_repeats = FRONT_END_COST_base_repeats(size);
+	uint64_t u64_base_cost;
+	uint64_t u64_scaled_cost;
+	double growth;
+
+	if (size == 0)
+	{
+		*p_growth = 1.0;
+		return true;
+	}
+
+	u64_base_cost = FRONT_END_COST_measure(kpu8_data, size, u32_repeats);
+	u64_scaled_cost = FRONT_END_COST_measure(kpu8_data, size, u32_repeats * FRONT_END_COST_SCALE_FACTOR);
+
+	if (u64_base_cost == 0)
+	{
+		u64_base_cost = 1;
+	}
+
+	growth = ((double)u64_scaled_cost / (double)u64_base_cost) / FRONT_END_COST_SCALE_FACTOR;
+	*p_growth = growth;
+
+	return growth <= FRONT_END_COST_MAX_GROWTH;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static uint64_t FRONT_END_COST_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t FRONT_END_COST_base_repeats(size_t size)
+{
+	if (size == 0 || size >= FRONT_END_COST_BASE_SIZE)
+	{
+		return 1;
+	}
+
+	return (uint32_t)((FRONT_END_COST_BASE_SIZE + size - 1) / size);
+}
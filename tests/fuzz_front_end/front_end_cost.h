@@ -0,0 +1,24 @@
+#ifndef FRONT_END_COST_H
+#define FRONT_END_COST_H
+
+#include "common.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define FRONT_END_COST_NUM_SAMPLES		(5)		// Each measurement keeps the cheapest of this many runs
+#define FRONT_END_COST_BASE_SIZE		(2048)	// Inputs are repeated up to at least this many bytes before timing
+#define FRONT_END_COST_SCALE_FACTOR		(8)		// The scaling check compares the base input against this many copies
+#define FRONT_END_COST_MAX_GROWTH		(2.0)	// Cost may grow at most this much faster than the input does
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 		FRONT_END_COST_run					(const uint8_t * kpu8_data, size_t size);
+uint64_t 	FRONT_END_COST_measure				(const uint8_t * kpu8_data, size_t size, uint32_t u32_repeats);
+double 		FRONT_END_COST_per_byte				(const uint8_t * kpu8_data, size_t size);
+bool 		FRONT_END_COST_check_scaling		(const uint8_t * kpu8_data, size_t size, double * p_growth);
+
+#endif
@@ -0,0 +1,327 @@
+#include <dirent.h>
+#include "common.h"
+#include "front_end_cost.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define FUZZ_DBG(fmt, ...)					printf(BOLD("FUZZ:\t")fmt, ##__VA_ARGS__)
+#define FUZZ_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("FUZZ:\t"))fmt, ##__VA_ARGS__)
+#define FUZZ_WARN(fmt, ...)					printf(BOLD(BRIGHT_YELLOW("FUZZ:\t"))fmt, ##__VA_ARGS__)
+#define FUZZ_ERR(fmt, ...)					printf(BOLD(BRIGHT_RED("FUZZ:\t"))fmt, ##__VA_ARGS__)
+
+#define FUZZ_DEFAULT_CORPUS_DIR				"corpus"
+#define FUZZ_CORPUS_DIR_ENV					"FUZZ_FRONT_END_CORPUS"
+#define FUZZ_MAX_PATH_LENGTH				(512)
+
+#define FUZZ_MIN_INPUT_SIZE					(8)		// Below this, cost per byte is all setup noise
+#define FUZZ_MAX_INPUT_SIZE					(4096)
+#define FUZZ_RECORD_MARGIN					(1.10)	// A new worst case must beat the old one by this much
+
+#ifdef FUZZ_FRONT_END_STANDALONE
+#define FUZZ_DEFAULT_ITERATIONS				(20000)
+#define FUZZ_MAX_POOL_SIZE					(1024)
+#define FUZZ_MAX_MUTATIONS					(8)
+#endif
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	The worst cost per input byte seen so far. Beating it by FUZZ_RECORD_MARGIN
+ *	puts the input into the regression corpus
+ */
+static double fuzz_worst_cost_per_byte;
+
+/*
+ *	Set when the most recent input became a new worst case
+ */
+static bool fuzz_b_new_record;
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static const char * FUZZ_get_corpus_dir(void)
+{
+	const char * kpc_dir = getenv(FUZZ_CORPUS_DIR_ENV);
+
+	return (kpc_dir != NULL) ? kpc_dir : FUZZ_DEFAULT_CORPUS_DIR;
+}
+
+/*
+ *	FNV-1a, just to give corpus entries stable, content-derived names
+ */
+static uint32_t FUZZ_hash(const uint8_t * kpu8_data, size_t size)
+{
+	uint32_t u32_hash = 2166136261u;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		u32_hash ^= kpu8_data[i];
+		u32_hash *= 16777619u;
+	}
+
+	return u32_hash;
+}
+
+static void FUZZ_save_to_corpus(const uint8_t * kpu8_data, size_t size, double cost_per_byte)
+{
+	char pc_path[FUZZ_MAX_PATH_LENGTH];
+	FILE * file;
+
+	snprintf(pc_path, sizeof(pc_path), "%s/slow_%08x.rep", FUZZ_get_corpus_dir(), FUZZ_hash(kpu8_data, size));
+
+	file = fopen(pc_path, "wb");
+
+	if (file == NULL)
+	{
+		FUZZ_ERR("Could not write %s\n", pc_path);
+		return;
+	}
+
+	fwrite(kpu8_data, 1, size, file);
+	fclose(file);
+
+	FUZZ_GREEN("New worst case: %.2f ns/byte (%zu bytes) -> %s\n", cost_per_byte, size, pc_path);
+}
+
+/****************************************************************************************************
+ *	F U Z Z   T A R G E T
+ ****************************************************************************************************/
+
+/*
+ *	libFuzzer entry point. Coverage still guides exploration, but every input is also costed,
+ *	and inputs that set a new cost-per-byte record are kept and checked for super-linear scaling
+ */
+int LLVMFuzzerTestOneInput(const uint8_t * kpu8_data, size_t size)
+{
+	double cost_per_byte;
+	double growth;
+
+	fuzz_b_new_record = false;
+
+	if (size < FUZZ_MIN_INPUT_SIZE || size > FUZZ_MAX_INPUT_SIZE)
+	{
+		FRONT_END_COST_run(kpu8_data, size);
+		return 0;
+	}
+
+	cost_per_byte = FRONT_END_COST_per_byte(kpu8_data, size);
+
+	if (cost_per_byte <= fuzz_worst_cost_per_byte * FUZZ_RECORD_MARGIN)
+	{
+		return 0;
+	}
+
+	fuzz_worst_cost_per_byte = cost_per_byte;
+	fuzz_b_new_record = true;
+
+	FUZZ_save_to_corpus(kpu8_data, size, cost_per_byte);
+
+	if (!FRONT_END_COST_check_scaling(kpu8_data, size, &growth))
+	{
+		FUZZ_ERR("Super-linear input: cost grew %.2fx faster than input size\n", growth);
+		abort();
+	}
+
+	return 0;
+}
+
+/****************************************************************************************************
+ *	S T A N D A L O N E   D R I V E R
+ ****************************************************************************************************/
+
+/*
+ *	Without libFuzzer (no clang around) this is a small cost-guided mutator: it mutates inputs from
+ *	the corpus and keeps the ones that push cost per byte up, so the search still climbs toward
+ *	the slowest inputs per byte
+ */
+#ifdef FUZZ_FRONT_END_STANDALONE
+
+typedef struct
+{
+	uint8_t *	pu8_data;
+	size_t		size;
+} FUZZ_input_t;
+
+static const char * const pk_fuzz_dictionary[] =
+{
+	"(", ")", "+", "-", "*", "/", "=", ";", " ", "\n", "a", "_b", "1", "42", "a = ", "(a + 1)", "a * b", "((",
+};
+
+static FUZZ_input_t fuzz_pool[FUZZ_MAX_POOL_SIZE];
+static uint32_t fuzz_pool_size;
+
+static void FUZZ_pool_add(const uint8_t * kpu8_data, size_t size)
+{
+	uint32_t u32_slot = fuzz_pool_size;
+
+	// Once full, recycle a random slot (but never the seeds at the front)
+	if (fuzz_pool_size == FUZZ_MAX_POOL_SIZE)
+	{
+		u32_slot = (FUZZ_MAX_POOL_SIZE / 2) + ((uint32_t)rand() % (FUZZ_MAX_POOL_SIZE / 2));
+		free(fuzz_pool[u32_slot].pu8_data);
+	}
+	else
+	{
+		fuzz_pool_size++;
+	}
+
+	fuzz_pool[u32_slot].pu8_data = malloc(size);
+	ASSERT(fuzz_pool[u32_slot].pu8_data);
+	memcpy(fuzz_pool[u32_slot].pu8_data, kpu8_data, size);
+	fuzz_pool[u32_slot].size = size;
+}
+
+static void FUZZ_load_corpus(void)
+{
+	char pc_path[FUZZ_MAX_PATH_LENGTH];
+	uint8_t pu8_buffer[FUZZ_MAX_INPUT_SIZE];
+	DIR * dir = opendir(FUZZ_get_corpus_dir());
+	struct dirent * p_entry;
+	FILE * file;
+	size_t size;
+
+	if (dir == NULL)
+	{
+		FUZZ_WARN("No corpus at %s\n", FUZZ_get_corpus_dir());
+		return;
+	}
+
+	while ((p_entry = readdir(dir)) != NULL && fuzz_pool_size < FUZZ_MAX_POOL_SIZE)
+	{
+		if (p_entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		snprintf(pc_path, sizeof(pc_path), "%s/%s", FUZZ_get_corpus_dir(), p_entry->d_name);
+		file = fopen(pc_path, "rb");
+
+		if (file == NULL)
+		{
+			continue;
+		}
+
+		size = fread(pu8_buffer, 1, sizeof(pu8_buffer), file);
+		fclose(file);
+
+		if (size > 0)
+		{
+			FUZZ_pool_add(pu8_buffer, size);
+		}
+	}
+
+	closedir(dir);
+}
+
+/*
+ *	Applies one random edit in place, returning the new size
+ */
+static size_t FUZZ_mutate(uint8_t * pu8_data, size_t size)
+{
+	const char * kpc_word;
+	size_t word_length;
+	size_t offset = (size > 0) ? ((size_t)rand() % size) : 0;
+	size_t length;
+
+	switch (rand() % 4)
+	{
+		// Overwrite a byte with something from the dictionary
+		case 0:
+		{
+			if (size > 0)
+			{
+				pu8_data[offset] = (uint8_t)pk_fuzz_dictionary[(size_t)rand() % (sizeof(pk_fuzz_dictionary) / sizeof(pk_fuzz_dictionary[0]))][0];
+			}
+			break;
+		}
+		// Insert a dictionary word
+		case 1:
+		{
+			kpc_word = pk_fuzz_dictionary[(size_t)rand() % (sizeof(pk_fuzz_dictionary) / sizeof(pk_fuzz_dictionary[0]))];
+			word_length = strlen(kpc_word);
+
+			if (size + word_length <= FUZZ_MAX_INPUT_SIZE)
+			{
+				memmove(pu8_data + offset + word_length, pu8_data + offset, size - offset);
+				memcpy(pu8_data + offset, kpc_word, word_length);
+				size += word_length;
+			}
+			break;
+		}
+		// Delete a run of bytes
+		case 2:
+		{
+			length = (size > offset) ? 1 + ((size_t)rand() % (size - offset)) : 0;
+			length = (length > 16) ? 16 : length;
+			memmove(pu8_data + offset, pu8_data + offset + length, size - offset - length);
+			size -= length;
+			break;
+		}
+		// Duplicate a run of bytes, which is what grows nesting and chains
+		case 3:
+		{
+			length = (size > offset) ? 1 + ((size_t)rand() % (size - offset)) : 0;
+
+			if (size + length <= FUZZ_MAX_INPUT_SIZE)
+			{
+				memmove(pu8_data + offset + length, pu8_data + offset, size - offset);
+				size += length;
+			}
+			break;
+		}
+	}
+
+	return size;
+}
+
+int main(int argc, char ** argv)
+{
+	uint8_t pu8_buffer[FUZZ_MAX_INPUT_SIZE];
+	uint32_t u32_iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : FUZZ_DEFAULT_ITERATIONS;
+	uint32_t u32_seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+	uint32_t u32_num_mutations;
+	size_t size;
+	FUZZ_input_t * p_parent;
+
+	srand(u32_seed);
+	FUZZ_load_corpus();
+
+	if (fuzz_pool_size == 0)
+	{
+		FUZZ_pool_add((const uint8_t *)"a = 60 + 9;\n", 12);
+	}
+
+	FUZZ_DBG("Fuzzing for %u iterations from %u inputs (seed %u)\n", u32_iterations, fuzz_pool_size, u32_seed);
+
+	for (uint32_t i = 0; i < u32_iterations; i++)
+	{
+		p_parent = &fuzz_pool[(uint32_t)rand() % fuzz_pool_size];
+		size = p_parent->size;
+		memcpy(pu8_buffer, p_parent->pu8_data, size);
+
+		u32_num_mutations = 1 + ((uint32_t)rand() % FUZZ_MAX_MUTATIONS);
+
+		for (uint32_t j = 0; j < u32_num_mutations; j++)
+		{
+			size = FUZZ_mutate(pu8_buffer, size);
+		}
+
+		LLVMFuzzerTestOneInput(pu8_buffer, size);
+
+		if (fuzz_b_new_record)
+		{
+			FUZZ_pool_add(pu8_buffer, size);
+		}
+	}
+
+	FUZZ_DBG("Worst cost per byte: %.2f ns\n", fuzz_worst_cost_per_byte);
+
+	return 0;
+}
+
+#endif // FUZZ_FRONT_END_STANDALONE
@@ -0,0 +1,157 @@
+#include <dlfcn.h>
+#include <time.h>
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+#include "c_backend.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PERF_SOURCE_FILE			"perf_c_backend.rep"
+#define PERF_OBJECT_FILE			"perf_c_backend_output.o"
+#define PERF_LIBRARY_FILE			"perf_c_backend_output.so"
+#define PERF_NUM_STATEMENTS			(5000)
+#define PERF_NUM_VARIABLES			(64)
+#define PERF_NUM_RUNS				(20)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+static double elapsed_us(const struct timespec * kp_start, const struct timespec * kp_end)
+{
+	return ((double)(kp_end->tv_sec - kp_start->tv_sec) * 1e6) + ((double)(kp_end->tv_nsec - kp_start->tv_nsec) / 1e3);
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(perf_c_backend);
+
+TEST_SETUP(perf_c_backend)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(perf_c_backend)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	remove(PERF_SOURCE_FILE);
+	remove(PERF_OBJECT_FILE);
+	remove(PERF_LIBRARY_FILE);
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	gcc -O2 on the C back end's output against the native backend on the same trees: how long
+ *	each takes to get ready, how long each takes to run, and after how many runs the faster
+ *	code pays for the slower compile
+ */
+TEST(perf_c_backend, test_compare_with_native)
+{
+	static uint32_t pu32_gcc[PERF_NUM_VARIABLES];
+	static uint32_t pu32_native[PERF_NUM_VARIABLES];
+	struct timespec start, end;
+	double gcc_compile_us, gcc_run_us = 0.0;
+	double native_compile_us, native_run_us = 0.0;
+	double run_us;
+	void (*p_rep_main)(uint32_t *);
+	void * p_library;
+	JIT_program_t native;
+
+	if (!C_BACKEND_compiler_available())
+	{
+		TEST_IGNORE_MESSAGE("gcc is not installed");
+	}
+
+	write_source(PERF_SOURCE_FILE, PERF_NUM_STATEMENTS, PERF_NUM_VARIABLES);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file(PERF_SOURCE_FILE));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	TEST_ASSERT_EQUAL(PERF_NUM_VARIABLES, SYMBOL_TABLE_get_num_symbols());
+
+	// Through to code loaded and ready to call, as for native code
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_ASSERT_EQUAL(STATUS_OK, C_BACKEND_compile_object(PARSE_get_tree_list(), PERF_OBJECT_FILE));
+	TEST_ASSERT_EQUAL(0, system("cc -shared -o " PERF_LIBRARY_FILE " " PERF_OBJECT_FILE));
+	p_library = dlopen("./" PERF_LIBRARY_FILE, RTLD_NOW | RTLD_LOCAL);
+	TEST_ASSERT_NOT_NULL_MESSAGE(p_library, dlerror());
+	*(void **)&p_rep_main = dlsym(p_library, "rep_main");
+	TEST_ASSERT_NOT_NULL(p_rep_main);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	gcc_compile_us = elapsed_us(&start, &end);
+
+	// Where the variables were declared, which is where the C reads them from
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &native));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	native_compile_us = elapsed_us(&start, &end);
+
+	// Best of several runs each
+	for (uint32_t i = 0; i < PERF_NUM_RUNS; i++)
+	{
+		fill_inputs(pu32_gcc, PERF_NUM_VARIABLES);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		p_rep_main(pu32_gcc);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		run_us = elapsed_us(&start, &end);
+		gcc_run_us = (i == 0 || run_us < gcc_run_us) ? run_us : gcc_run_us;
+
+		fill_inputs(pu32_native, PERF_NUM_VARIABLES);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		JIT_run(&native, pu32_native);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		run_us = elapsed_us(&start, &end);
+		native_run_us = (i == 0 || run_us < native_run_us) ? run_us : native_run_us;
+	}
+
+	printf("%u statements over %u variables\n", PERF_NUM_STATEMENTS, PERF_NUM_VARIABLES);
+	printf("%-12s compile %10.1f us    run %10.1f us\n", "gcc -O2", gcc_compile_us, gcc_run_us);
+	printf("%-12s compile %10.1f us    run %10.1f us\n", "native", native_compile_us, native_run_us);
+
+	if (native_run_us > gcc_run_us)
+	{
+		printf("gcc pays for its compile time after %.0f runs\n", (gcc_compile_us - native_compile_us) / (native_run_us - gcc_run_us));
+	}
+
+	TEST_ASSERT_EQUAL_UINT32_ARRAY(pu32_native, pu32_gcc, PERF_NUM_VARIABLES);
+
+	JIT_release(&native);
+	dlclose(p_library);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(perf_c_backend, test_compare_with_native);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,95 @@
+#include <dirent.h>
+#include "unity.h"
+#include "unity_fixture.h"
+#include "front_end_cost.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PERF_CORPUS_DIR				"../fuzz_front_end/corpus"
+#define PERF_MAX_PATH_LENGTH		(512)
+#define PERF_MAX_INPUT_SIZE			(4096)
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(perf_front_end);
+
+TEST_SETUP(perf_front_end)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(perf_front_end)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Every input in the fuzzer's regression corpus must scale (at most) linearly
+ */
+TEST(perf_front_end, test_corpus_scales_linearly)
+{
+	char pc_path[PERF_MAX_PATH_LENGTH];
+	uint8_t pu8_buffer[PERF_MAX_INPUT_SIZE];
+	DIR * dir = opendir(PERF_CORPUS_DIR);
+	struct dirent * p_entry;
+	FILE * file;
+	size_t size;
+	double growth;
+	uint32_t u32_num_checked = 0;
+	uint32_t u32_num_failed = 0;
+
+	TEST_ASSERT_NOT_NULL(dir);
+
+	while ((p_entry = readdir(dir)) != NULL)
+	{
+		if (p_entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		snprintf(pc_path, sizeof(pc_path), "%s/%s", PERF_CORPUS_DIR, p_entry->d_name);
+		file = fopen(pc_path, "rb");
+		TEST_ASSERT_NOT_NULL(file);
+		size = fread(pu8_buffer, 1, sizeof(pu8_buffer), file);
+		fclose(file);
+
+		if (FRONT_END_COST_check_scaling(pu8_buffer, size, &growth))
+		{
+			printf("%-40s growth %.2f\n", p_entry->d_name, growth);
+		}
+		else
+		{
+			printf("%-40s growth %.2f " BOLD(BRIGHT_RED("(super-linear)")) "\n", p_entry->d_name, growth);
+			u32_num_failed++;
+		}
+
+		u32_num_checked++;
+	}
+
+	closedir(dir);
+
+	TEST_ASSERT_GREATER_THAN(0, u32_num_checked);
+	TEST_ASSERT_EQUAL(0, u32_num_failed);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(perf_front_end, test_corpus_scales_linearly);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,139 @@
+#include <time.h>
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+#include "vm.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PERF_SOURCE_FILE			"perf_vm.rep"
+#define PERF_NUM_STATEMENTS			(20000)
+#define PERF_NUM_VARIABLES			(64)
+#define PERF_NUM_RUNS				(20)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+static double elapsed_us(const struct timespec * kp_start, const struct timespec * kp_end)
+{
+	return ((double)(kp_end->tv_sec - kp_start->tv_sec) * 1e6) + ((double)(kp_end->tv_nsec - kp_start->tv_nsec) / 1e3);
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(perf_vm);
+
+TEST_SETUP(perf_vm)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(perf_vm)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	The interpreter against the native backend on the same trees: how long each takes to get
+ *	ready, how long each takes to run, and after how many runs native code pays for itself
+ */
+TEST(perf_vm, test_compare_with_native)
+{
+	static uint32_t pu32_interpreted[PERF_NUM_VARIABLES + 1];
+	static uint32_t pu32_native[PERF_NUM_VARIABLES + 1];
+	struct timespec start, end;
+	double vm_compile_us, vm_run_us = 0.0;
+	double native_compile_us, native_run_us = 0.0;
+	double run_us;
+	VM_program_t program;
+	JIT_program_t native;
+
+	write_source(PERF_SOURCE_FILE, PERF_NUM_STATEMENTS, PERF_NUM_VARIABLES);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file(PERF_SOURCE_FILE));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	TEST_ASSERT_EQUAL(PERF_NUM_VARIABLES, SYMBOL_TABLE_get_num_symbols());
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	vm_compile_us = elapsed_us(&start, &end);
+
+	// Variables where they were declared, which is where the interpreter keeps them
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &native));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	native_compile_us = elapsed_us(&start, &end);
+
+	// Best of several runs each
+	for (uint32_t i = 0; i < PERF_NUM_RUNS; i++)
+	{
+		fill_inputs(pu32_interpreted, PERF_NUM_VARIABLES);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		TEST_ASSERT_EQUAL(STATUS_OK, VM_run(&program, pu32_interpreted));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		run_us = elapsed_us(&start, &end);
+		vm_run_us = (i == 0 || run_us < vm_run_us) ? run_us : vm_run_us;
+
+		fill_inputs(pu32_native, PERF_NUM_VARIABLES);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		JIT_run(&native, pu32_native);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		run_us = elapsed_us(&start, &end);
+		native_run_us = (i == 0 || run_us < native_run_us) ? run_us : native_run_us;
+	}
+
+	printf("%u statements, %u bytecode instructions\n", PERF_NUM_STATEMENTS, program.u32_num_instructions);
+	printf("%-12s compile %10.1f us    run %10.1f us\n", "bytecode", vm_compile_us, vm_run_us);
+	printf("%-12s compile %10.1f us    run %10.1f us\n", "native", native_compile_us, native_run_us);
+
+	if (vm_run_us > native_run_us)
+	{
+		printf("Native code pays for its compile time after %.0f runs\n", (native_compile_us - vm_compile_us) / (vm_run_us - native_run_us));
+	}
+
+	TEST_ASSERT_EQUAL_UINT32_ARRAY(pu32_native, pu32_interpreted, PERF_NUM_VARIABLES + 1);
+
+	JIT_release(&native);
+	VM_release(&program);
+	remove(PERF_SOURCE_FILE);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(perf_vm, test_compare_with_native);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
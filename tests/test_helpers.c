@@ -0,0 +1,158 @@
+#include <dlfcn.h>
+#include "unity.h"
+#include "test_helpers.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define TEST_HELPERS_MAX_COMMAND_LENGTH	(1024)
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Loads, lexes and parses the file. The tree list and symbol table are left for the caller
+ */
+void parse_file(const char * kpc_fname)
+{
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file(kpc_fname));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, PARSE_run_rdp());
+}
+
+/*
+ *	Parses the file and generates code for it, with the pass named left out, or none if NULL
+ */
+void compile_file(const char * kpc_fname, const char * kpc_disabled_pass)
+{
+	parse_file(kpc_fname);
+	CODE_GEN_init();
+
+	if (kpc_disabled_pass != NULL)
+	{
+		TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled(kpc_disabled_pass, false));
+	}
+
+	CODE_GEN_run(PARSE_get_tree_list());
+}
+
+/*
+ *	Compiles the parsed file to an object with the back end given, and natively, runs both over
+ *	the same inputs, and checks they leave the storage the same
+ */
+void assert_matches_native(STATUS_t (*p_compile_object)(const PARSE_tree_list_t *, const char *), const char * kpc_object_fname,
+							const char * kpc_library_fname, const char * const * kpkpc_inputs, const uint32_t * kpu32_values,
+							uint32_t u32_num_inputs)
+{
+	uint64_t pu64_compiled[TEST_HELPERS_MAX_VARIABLES] = { 0 };
+	uint64_t pu64_native[TEST_HELPERS_MAX_VARIABLES] = { 0 };
+	char pc_command[TEST_HELPERS_MAX_COMMAND_LENGTH];
+	void (*p_rep_main)(uint32_t *);
+	const uint32_t * kpu32_num_variables;
+	JIT_program_t program;
+	void * p_library;
+	uint32_t u32_offset;
+	int length;
+
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(pu64_compiled), SYMBOL_TABLE_get_storage_size());
+
+	for (uint32_t i = 0; i < u32_num_inputs; i++)
+	{
+		u32_offset = SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup(kpkpc_inputs[i]));
+		memcpy((uint8_t *)pu64_compiled + u32_offset, &kpu32_values[i], sizeof(uint32_t));
+		memcpy((uint8_t *)pu64_native + u32_offset, &kpu32_values[i], sizeof(uint32_t));
+	}
+
+	TEST_ASSERT_EQUAL(STATUS_OK, p_compile_object(PARSE_get_tree_list(), kpc_object_fname));
+	length = snprintf(pc_command, sizeof(pc_command), "cc -shared -o %s %s", kpc_library_fname, kpc_object_fname);
+	TEST_ASSERT_TRUE(length > 0 && (size_t)length < sizeof(pc_command));
+	TEST_ASSERT_EQUAL(0, system(pc_command));
+
+	length = snprintf(pc_command, sizeof(pc_command), "./%s", kpc_library_fname);
+	TEST_ASSERT_TRUE(length > 0 && (size_t)length < sizeof(pc_command));
+	p_library = dlopen(pc_command, RTLD_NOW | RTLD_LOCAL);
+	TEST_ASSERT_NOT_NULL_MESSAGE(p_library, dlerror());
+	*(void **)&p_rep_main = dlsym(p_library, "rep_main");
+	kpu32_num_variables = dlsym(p_library, "rep_num_variables");
+	TEST_ASSERT_NOT_NULL(p_rep_main);
+	TEST_ASSERT_NOT_NULL(kpu32_num_variables);
+	TEST_ASSERT_EQUAL_UINT32(SYMBOL_TABLE_get_num_symbols(), *kpu32_num_variables);
+
+	p_rep_main((uint32_t *)pu64_compiled);
+	dlclose(p_library);
+
+	// Where the variables were declared, which is where the other back ends put them
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_native);
+	JIT_release(&program);
+	CODE_GEN_deinit();
+
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(pu64_native, pu64_compiled, sizeof(pu64_compiled));
+}
+
+/*
+ *	Straight-line arithmetic over a few variables. None is given a value in the source, so no
+ *	compiler can fold the program away: it all depends on what's in storage when it runs.
+ *	Divisors are nonzero literals, so nothing can trap
+ */
+void write_source(const char * kpc_fname, uint32_t u32_num_statements, uint32_t u32_num_variables)
+{
+	FILE * file = fopen(kpc_fname, "w");
+	uint32_t u32_random = 2463534242u;
+	uint32_t pu32_picks[4];
+
+	TEST_ASSERT_NOT_NULL(file);
+
+	for (uint32_t i = 0; i < u32_num_statements; i++)
+	{
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			// xorshift32
+			u32_random ^= u32_random << 13;
+			u32_random ^= u32_random >> 17;
+			u32_random ^= u32_random << 5;
+			pu32_picks[j] = u32_random % u32_num_variables;
+		}
+
+		switch (u32_random % 4)
+		{
+			case 0:
+				fprintf(file, "v%u = v%u * 4 + v%u;\n", pu32_picks[0], pu32_picks[1], pu32_picks[2]);
+				break;
+			case 1:
+				fprintf(file, "v%u = v%u + %u - v%u * v%u;\n", pu32_picks[0], pu32_picks[1], u32_random % 1000, pu32_picks[2], pu32_picks[3]);
+				break;
+			case 2:
+				fprintf(file, "v%u = v%u / %u + v%u;\n", pu32_picks[0], pu32_picks[1], 1 + (u32_random % 13), pu32_picks[2]);
+				break;
+			default:
+				fprintf(file, "v%u = (v%u - v%u) * (v%u + 3);\n", pu32_picks[0], pu32_picks[1], pu32_picks[2], pu32_picks[3]);
+				break;
+		}
+	}
+
+	fclose(file);
+}
+
+/*
+ *	The inputs write_source's programs start from, one per variable in declaration order
+ */
+void fill_inputs(uint32_t * p_variables, uint32_t u32_num_variables)
+{
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		p_variables[i] = i * 2654435761u;
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "common.h"
+#include "status.h"
+#include "parse.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define TEST_HELPERS_MAX_VARIABLES		(16)	// Storage, in u64s, a program checked against native code may use
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			parse_file						(const char * kpc_fname);
+void 			compile_file					(const char * kpc_fname, const char * kpc_disabled_pass);
+void 			assert_matches_native			(STATUS_t (*p_compile_object)(const PARSE_tree_list_t *, const char *), const char * kpc_object_fname,
+													const char * kpc_library_fname, const char * const * kpkpc_inputs, const uint32_t * kpu32_values,
+													uint32_t u32_num_inputs);
+void 			write_source					(const char * kpc_fname, uint32_t u32_num_statements, uint32_t u32_num_variables);
+void 			fill_inputs						(uint32_t * p_variables, uint32_t u32_num_variables);
+
+#endif
@@ -0,0 +1,246 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "c_backend.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define C_BACKEND_OUTPUT_FILE			"test_files/unit_c_backend_output.c"
+#define C_BACKEND_OBJECT_FILE			"test_files/unit_c_backend_output.o"
+#define C_BACKEND_LIBRARY_FILE			"test_files/unit_c_backend_output.so"
+#define C_BACKEND_MAX_OUTPUT_SIZE		(8192)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the parsed file out as C and checks every snippet is somewhere in it
+ */
+static void assert_lowers_to(const char * const * kpkpc_snippets, uint32_t u32_num_snippets)
+{
+	static char pc_text[C_BACKEND_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, C_BACKEND_write_program(PARSE_get_tree_list(), C_BACKEND_OUTPUT_FILE));
+
+	file = fopen(C_BACKEND_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	pc_text[size] = '\0';
+
+	for (uint32_t i = 0; i < u32_num_snippets; i++)
+	{
+		TEST_ASSERT_NOT_NULL_MESSAGE(strstr(pc_text, kpkpc_snippets[i]), kpkpc_snippets[i]);
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_c_backend);
+
+TEST_SETUP(unit_c_backend)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_c_backend)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	remove(C_BACKEND_OUTPUT_FILE);
+	remove(C_BACKEND_OBJECT_FILE);
+	remove(C_BACKEND_LIBRARY_FILE);
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Every arithmetic node, in u32 arithmetic, and divides through the helper that checks the divisor
+ */
+TEST(unit_c_backend, test_format_arithmetic)
+{
+	static const char * const kpkpc_snippets[] =
+	{
+		"const uint32_t rep_num_variables = 9;\n",
+		"const uint32_t rep_variable_offsets[] = { 0, 4, 8, 12, 16, 20, 24, 28, 32, 0 };\n",
+		"const char rep_variable_names[] = \"d\\000a\\000b\\000e\\000f\\000g\\000h\\000c\\000k\\000\";\n",
+		"void rep_main(uint32_t * p_variables)\n",
+		"\tuint32_t rep_var_a;\n",
+		"\tmemcpy(&rep_var_a, pu8_storage + 4, sizeof(rep_var_a));\n",
+		"\trep_var_d = (uint32_t)((uint32_t)rep_var_a + (uint32_t)rep_var_b);\n",
+		"\trep_var_e = (uint32_t)((uint32_t)rep_var_a - (uint32_t)rep_var_b);\n",
+		"\trep_var_f = (uint32_t)((uint32_t)rep_var_a * (uint32_t)rep_var_b);\n",
+		"\trep_var_g = (uint32_t)rep_udiv32((uint32_t)rep_var_b, (uint32_t)rep_var_a);\n",
+		"(4294967295u + ((uint32_t)rep_var_h * ((uint32_t)rep_var_c - 7u)))",
+		"\tmemcpy(pu8_storage + 32, &rep_var_k, sizeof(rep_var_k));\n",
+	};
+
+	// 	test file reads:
+	//		d = a + b;
+	//		e = a - b;
+	//		f = a * b;
+	//		g = b / a;
+	//		h = d * e - f / c + g;
+	//		k = 4294967295 + h * (c - 7);
+	parse_file("test_files/unit_c_backend_0.rep");
+
+	assert_lowers_to(kpkpc_snippets, sizeof(kpkpc_snippets) / sizeof(kpkpc_snippets[0]));
+}
+
+/*
+ *	Variables are locals of their own C type, so converting them widens by their signedness.
+ *	Statements compute in the unsigned type of their width, and the result is cut down as it's stored
+ */
+TEST(unit_c_backend, test_format_typed)
+{
+	static const char * const kpkpc_snippets[] =
+	{
+		"const uint8_t rep_variable_types[] = { 129, 1, 130, 2, 132, 136, 8, 132, 1, 132, 0 };\n",
+		"\tint8_t rep_var_s;\n",
+		"\tuint16_t rep_var_x;\n",
+		"\tint64_t rep_var_z;\n",
+		"\trep_var_s = (int8_t)(0u - 100u);\n",
+		"\trep_var_w = (int16_t)((uint32_t)rep_var_s * 300u);\n",
+		"\trep_var_z = (int64_t)(((uint64_t)rep_var_y * (uint64_t)100000u) - (uint64_t)7u);\n",
+		"\trep_var_q = (uint64_t)rep_udiv64((uint64_t)rep_var_z, (uint64_t)3u);\n",
+		"\trep_var_r = (int32_t)rep_sdiv32((uint32_t)rep_var_y, (0u - 6u));\n",
+		"\trep_var_m = (int32_t)rep_sdiv64((uint64_t)rep_var_z, (uint64_t)1000u);\n",
+		"\tmemcpy(pu8_storage + 36, &rep_var_n, sizeof(rep_var_n));\n",
+	};
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		u8 t = 200;
+	//		i16 w = s * 300;
+	//		u16 x = t * t + w;
+	//		i32 y = w / s - x;
+	//		i64 z = y * 100000 - 7;
+	//		u64 q = z / 3;
+	//		i32 r = y / (0 - 6);
+	//		u8 n = t + t;
+	//		i32 m = z / 1000;
+	parse_file("test_files/unit_c_backend_1.rep");
+
+	assert_lowers_to(kpkpc_snippets, sizeof(kpkpc_snippets) / sizeof(kpkpc_snippets[0]));
+}
+
+/*
+ *	A program with no statements still gets the tables and an empty rep_main
+ */
+TEST(unit_c_backend, test_format_empty)
+{
+	static const char * const kpkpc_snippets[] =
+	{
+		"const uint32_t rep_num_variables = 0;\n",
+		"const uint32_t rep_variable_offsets[] = { 0 };\n",
+		"const char rep_variable_names[] = \"\";\n",
+		"void rep_main(uint32_t * p_variables)\n",
+	};
+
+	// 	test file is a blank line
+	parse_file("test_files/unit_c_backend_2.rep");
+
+	assert_lowers_to(kpkpc_snippets, sizeof(kpkpc_snippets) / sizeof(kpkpc_snippets[0]));
+}
+
+/*
+ *	Only variables assigned are written back, so inputs nothing assigns are left alone
+ */
+TEST(unit_c_backend, test_format_writes_back_assigned)
+{
+	static char pc_text[C_BACKEND_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	// 	test file reads:
+	//		d = a + b;
+	//		...
+	parse_file("test_files/unit_c_backend_0.rep");
+	TEST_ASSERT_EQUAL(STATUS_OK, C_BACKEND_write_program(PARSE_get_tree_list(), C_BACKEND_OUTPUT_FILE));
+
+	file = fopen(C_BACKEND_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	pc_text[size] = '\0';
+
+	TEST_ASSERT_NULL(strstr(pc_text, "&rep_var_a, sizeof"));
+	TEST_ASSERT_NULL(strstr(pc_text, "&rep_var_b, sizeof"));
+	TEST_ASSERT_NULL(strstr(pc_text, "&rep_var_c, sizeof"));
+}
+
+/*
+ *	What gcc compiles computes what native code does, in every type
+ */
+TEST(unit_c_backend, test_compile_matches_native)
+{
+	static const char * const kpkpc_inputs[] = { "a", "b", "c" };
+	static const uint32_t ku32_values[] = { 123456789, 3987654321u, 42 };
+
+	if (!C_BACKEND_compiler_available())
+	{
+		TEST_IGNORE_MESSAGE("gcc is not installed");
+	}
+
+	// 	test file reads:
+	//		d = a + b;
+	//		...
+	parse_file("test_files/unit_c_backend_0.rep");
+	assert_matches_native(C_BACKEND_compile_object, C_BACKEND_OBJECT_FILE, C_BACKEND_LIBRARY_FILE, kpkpc_inputs, ku32_values, 3);
+	PARSE_deinit();
+	LEX_deinit();
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		...
+	parse_file("test_files/unit_c_backend_1.rep");
+	assert_matches_native(C_BACKEND_compile_object, C_BACKEND_OBJECT_FILE, C_BACKEND_LIBRARY_FILE, NULL, NULL, 0);
+}
+
+/*
+ *	An output path too long for the command is an error, not a crash
+ */
+TEST(unit_c_backend, test_long_path_fails)
+{
+	static char pc_fname[2048];
+
+	memset(pc_fname, 'x', sizeof(pc_fname) - 1);
+	memcpy(pc_fname, "test_files/", strlen("test_files/"));
+	pc_fname[sizeof(pc_fname) - 1] = '\0';
+
+	parse_file("test_files/unit_c_backend_0.rep");
+	TEST_ASSERT_EQUAL(STATUS_FAILED, C_BACKEND_compile_object(PARSE_get_tree_list(), pc_fname));
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_c_backend, test_format_arithmetic);
+	RUN_TEST_CASE(unit_c_backend, test_format_typed);
+	RUN_TEST_CASE(unit_c_backend, test_format_empty);
+	RUN_TEST_CASE(unit_c_backend, test_format_writes_back_assigned);
+	RUN_TEST_CASE(unit_c_backend, test_compile_matches_native);
+	RUN_TEST_CASE(unit_c_backend, test_long_path_fails);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
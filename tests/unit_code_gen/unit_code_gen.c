@@ -0,0 +1,314 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define CODE_GEN_OUTPUT_FILE		"test_files/unit_code_gen_output.s"
+#define CODE_GEN_MAX_OUTPUT_SIZE	(4096)
+#define CODE_GEN_MAX_VARIABLES		(16)
+
+#define CODE_GEN_PARALLEL_SOURCE	"test_files/unit_code_gen_parallel.rep"
+#define CODE_GEN_PARALLEL_SERIAL	"test_files/unit_code_gen_serial_output.s"
+#define CODE_GEN_PARALLEL_OUTPUT	"test_files/unit_code_gen_parallel_output.s"
+#define CODE_GEN_NUM_STATEMENTS		(40000)
+#define CODE_GEN_COMPARE_CHUNK		(65536)
+#define CODE_GEN_DISABLED_PASS		"schedule"	// The asserts spell out registers as selection orders the code
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the program out and returns the body of rep_main from it. Points into a static buffer
+ */
+static const char * get_function_body(void)
+{
+	static char pc_text[CODE_GEN_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+	char * pc_start;
+	char * pc_end;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(CODE_GEN_OUTPUT_FILE));
+
+	file = fopen(CODE_GEN_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(CODE_GEN_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	pc_start = strstr(pc_text, ASM_ENTRY_SYMBOL ":\n");
+	TEST_ASSERT_NOT_NULL(pc_start);
+	pc_start += strlen(ASM_ENTRY_SYMBOL ":\n");
+
+	pc_end = strstr(pc_start, "\t.size");
+	TEST_ASSERT_NOT_NULL(pc_end);
+	*pc_end = '\0';
+
+	return pc_start;
+}
+
+/*
+ *	Enough statements to split between several threads, each a mix of tiles
+ */
+static void write_large_source(const char * kpc_fname)
+{
+	FILE * file = fopen(kpc_fname, "w");
+	uint32_t u32_random = 2463534242u;
+
+	TEST_ASSERT_NOT_NULL(file);
+
+	for (uint32_t i = 0; i < CODE_GEN_NUM_STATEMENTS; i++)
+	{
+		// xorshift32
+		u32_random ^= u32_random << 13;
+		u32_random ^= u32_random >> 17;
+		u32_random ^= u32_random << 5;
+
+		fprintf(file, "v%u = v%u * 4 + v%u / %u - v%u * v%u;\n",
+			u32_random % 97, (u32_random >> 7) % 97, (u32_random >> 14) % 97, 1 + ((u32_random >> 21) % 13), (u32_random >> 3) % 97, (u32_random >> 11) % 97);
+	}
+
+	fclose(file);
+}
+
+static bool files_equal(const char * kpc_first, const char * kpc_second)
+{
+	static char pc_first[CODE_GEN_COMPARE_CHUNK];
+	static char pc_second[CODE_GEN_COMPARE_CHUNK];
+	FILE * p_first = fopen(kpc_first, "r");
+	FILE * p_second = fopen(kpc_second, "r");
+	size_t first_size;
+	size_t second_size;
+	bool b_equal = true;
+
+	TEST_ASSERT_NOT_NULL(p_first);
+	TEST_ASSERT_NOT_NULL(p_second);
+
+	do
+	{
+		first_size = fread(pc_first, 1, sizeof(pc_first), p_first);
+		second_size = fread(pc_second, 1, sizeof(pc_second), p_second);
+		b_equal = (first_size == second_size) && (memcmp(pc_first, pc_second, first_size) == 0);
+	} while (b_equal && first_size > 0);
+
+	fclose(p_first);
+	fclose(p_second);
+
+	return b_equal;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_code_gen);
+
+TEST_SETUP(unit_code_gen)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_code_gen)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+TEST(unit_code_gen, test_every_statement_nominal)
+{
+	const char * kpc_body;
+
+	// 	test file reads:
+	//		a = 60 + 9;
+	//		b = a - 2 * 3;
+	//		c = b / a;
+	//		a + 1;				(unused, so eliminated)
+	compile_file("test_files/unit_code_gen_0.rep", CODE_GEN_DISABLED_PASS);
+
+	kpc_body = get_function_body();
+
+	// Everything is known, so all that's left is storing it
+	TEST_ASSERT_EQUAL_STRING(
+		"\tmovl\t$69, rep_var_a(%rdi)\n"
+		"\tmovl\t$63, rep_var_b(%rdi)\n"
+		"\tmovl\t$0, rep_var_c(%rdi)\n"
+		"\tret\n",
+		kpc_body);
+}
+
+TEST(unit_code_gen, test_malformed_statement_skipped)
+{
+	const char * kpc_body;
+
+	// 	test file reads:
+	//		= 1;
+	//		d = 7;
+	// The parse fails, but the tree it leaves for the first statement is still there to skip
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_code_gen_1.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	TEST_ASSERT_EQUAL(STATUS_FAILED, PARSE_run_rdp());
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled(CODE_GEN_DISABLED_PASS, false));
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	kpc_body = get_function_body();
+
+	TEST_ASSERT_EQUAL_STRING(
+		"\tmovl\t$7, rep_var_d(%rdi)\n"
+		"\tret\n",
+		kpc_body);
+}
+
+TEST(unit_code_gen, test_write_assembly)
+{
+	FILE * file;
+	char pc_line[64];
+	bool b_found_names = false;
+
+	compile_file("test_files/unit_code_gen_0.rep", CODE_GEN_DISABLED_PASS);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(CODE_GEN_OUTPUT_FILE));
+
+	file = fopen(CODE_GEN_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+
+	while (fgets(pc_line, sizeof(pc_line), file) != NULL)
+	{
+		if (strcmp(pc_line, ASM_VARIABLE_NAMES_SYMBOL ":\n") == 0)
+		{
+			b_found_names = true;
+			TEST_ASSERT_NOT_NULL(fgets(pc_line, sizeof(pc_line), file));
+			TEST_ASSERT_EQUAL_STRING("\t.asciz\t\"a\"\n", pc_line);
+			TEST_ASSERT_NOT_NULL(fgets(pc_line, sizeof(pc_line), file));
+			TEST_ASSERT_EQUAL_STRING("\t.asciz\t\"b\"\n", pc_line);
+			TEST_ASSERT_NOT_NULL(fgets(pc_line, sizeof(pc_line), file));
+			TEST_ASSERT_EQUAL_STRING("\t.asciz\t\"c\"\n", pc_line);
+		}
+	}
+
+	fclose(file);
+	remove(CODE_GEN_OUTPUT_FILE);
+
+	TEST_ASSERT_TRUE(b_found_names);
+}
+
+/*
+ *	Right-leaning trees evaluated left first would hold every operand live at once. Heavier side
+ *	first, two registers do
+ */
+TEST(unit_code_gen, test_heavier_operand_first)
+{
+	uint32_t pu32_variables[CODE_GEN_MAX_VARIABLES] = { 0 };
+	bool pb_used[ASM_REGISTER_NUM_REGISTERS] = { false };
+	const ASM_buffer_t * kp_buffer;
+	uint32_t u32_num_used = 0;
+	JIT_program_t program;
+
+	// 	test file reads, with the innermost operands read from variables so nothing folds:
+	//		s = 1 + (2 + (3 + ... + (19 + x)...));
+	//		d = 1000 - (100 - (10 - y));
+	//		q = 1000 / (100 / (10 / z));
+	//		r = 7 - 2 * w;
+	compile_file("test_files/unit_code_gen_2.rep", CODE_GEN_DISABLED_PASS);
+
+	kp_buffer = CODE_GEN_get_buffer();
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		if (kp_buffer->p_instructions[i].u8_dst_kind == ASM_OPERAND_REGISTER &&
+			kp_buffer->p_instructions[i].u32_dst != ASM_REGISTER_RAX &&
+			kp_buffer->p_instructions[i].u32_dst != ASM_REGISTER_RDX &&
+			!pb_used[kp_buffer->p_instructions[i].u32_dst])
+		{
+			pb_used[kp_buffer->p_instructions[i].u32_dst] = true;
+			u32_num_used++;
+		}
+	}
+
+	TEST_ASSERT_EQUAL(2, u32_num_used);
+
+	pu32_variables[SYMBOL_TABLE_lookup("x")] = 20;
+	pu32_variables[SYMBOL_TABLE_lookup("y")] = 1;
+	pu32_variables[SYMBOL_TABLE_lookup("z")] = 3;
+	pu32_variables[SYMBOL_TABLE_lookup("w")] = 3;
+
+	// Subtract and divide still take their operands the right way round
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(kp_buffer, &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(210, pu32_variables[SYMBOL_TABLE_lookup("s")]);
+	TEST_ASSERT_EQUAL_UINT32(909, pu32_variables[SYMBOL_TABLE_lookup("d")]);
+	TEST_ASSERT_EQUAL_UINT32(30, pu32_variables[SYMBOL_TABLE_lookup("q")]);
+	TEST_ASSERT_EQUAL_UINT32(1, pu32_variables[SYMBOL_TABLE_lookup("r")]);
+
+	JIT_release(&program);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+/*
+ *	Statements split across threads come back joined in source order, exactly as one thread
+ *	would have generated them
+ */
+TEST(unit_code_gen, test_parallel_matches_serial)
+{
+	write_large_source(CODE_GEN_PARALLEL_SOURCE);
+
+	CODE_GEN_set_num_threads(1);
+	compile_file(CODE_GEN_PARALLEL_SOURCE, CODE_GEN_DISABLED_PASS);
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(CODE_GEN_PARALLEL_SERIAL));
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+
+	CODE_GEN_set_num_threads(8);
+	compile_file(CODE_GEN_PARALLEL_SOURCE, CODE_GEN_DISABLED_PASS);
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(CODE_GEN_PARALLEL_OUTPUT));
+	CODE_GEN_set_num_threads(0);
+
+	TEST_ASSERT_TRUE(files_equal(CODE_GEN_PARALLEL_SERIAL, CODE_GEN_PARALLEL_OUTPUT));
+
+	remove(CODE_GEN_PARALLEL_SOURCE);
+	remove(CODE_GEN_PARALLEL_SERIAL);
+	remove(CODE_GEN_PARALLEL_OUTPUT);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_code_gen, test_every_statement_nominal);
+	RUN_TEST_CASE(unit_code_gen, test_malformed_statement_skipped);
+	RUN_TEST_CASE(unit_code_gen, test_write_assembly);
+	RUN_TEST_CASE(unit_code_gen, test_heavier_operand_first);
+	RUN_TEST_CASE(unit_code_gen, test_parallel_matches_serial);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,226 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "dce.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define DCE_OUTPUT_FILE				"test_files/unit_dce_output.ir"
+#define DCE_MAX_OUTPUT_SIZE			(4096)
+#define DCE_MAX_VARIABLES			(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file, eliminates dead code and returns what's left as text. Points into a static buffer
+ */
+static const char * eliminate(DCE_report_t * p_report)
+{
+	static char pc_text[DCE_MAX_OUTPUT_SIZE];
+	IR_program_t program;
+	FILE * file;
+	size_t size;
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+	DCE_run(&program, SYMBOL_TABLE_get_num_symbols(), p_report);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(&program, DCE_OUTPUT_FILE));
+	IR_deinit_program(&program);
+
+	file = fopen(DCE_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(DCE_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_dce);
+
+TEST_SETUP(unit_dce)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_dce)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	A store overwritten before any load goes, along with what computed it
+ */
+TEST(unit_dce, test_overwritten_store)
+{
+	DCE_report_t report;
+
+	// 	test file reads:
+	//		x = 1;
+	//		y = 2;
+	//		x = 3;
+	//		z = x + y;
+	parse_file("test_files/unit_dce_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%1 = const 2\n"
+		"store y, %1\n"
+		"%2 = const 3\n"
+		"store x, %2\n"
+		"%3 = load x\n"
+		"%4 = load y\n"
+		"%5 = add %3, %4\n"
+		"store z, %5\n",
+		eliminate(&report));
+
+	TEST_ASSERT_EQUAL(1, report.u32_num_dead_stores);
+	TEST_ASSERT_EQUAL(1, report.u32_num_dead_instructions);
+	TEST_ASSERT_EQUAL(8, report.u32_num_live_instructions);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	A load between two stores keeps the first; a bare expression goes entirely
+ */
+TEST(unit_dce, test_loads_keep_stores)
+{
+	DCE_report_t report;
+
+	// 	test file reads:
+	//		x = 1;
+	//		y = x;
+	//		x = 2;
+	//		a + b * c;
+	parse_file("test_files/unit_dce_1.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = const 1\n"
+		"store x, %0\n"
+		"%1 = load x\n"
+		"store y, %1\n"
+		"%2 = const 2\n"
+		"store x, %2\n",
+		eliminate(&report));
+
+	TEST_ASSERT_EQUAL(0, report.u32_num_dead_stores);
+	TEST_ASSERT_EQUAL(5, report.u32_num_dead_instructions);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	A division nothing uses stays if it can fault; one by a nonzero constant goes
+ */
+TEST(unit_dce, test_faulting_division_kept)
+{
+	DCE_report_t report;
+
+	// 	test file reads:
+	//		y = 0;
+	//		x = 5 / y;
+	//		x = 1;
+	//		z = 5 / 3;			(dead)
+	//		z = 2;
+	parse_file("test_files/unit_dce_3.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = const 0\n"
+		"store y, %0\n"
+		"%1 = const 5\n"
+		"%2 = load y\n"
+		"%3 = div %1, %2\n"
+		"%4 = const 1\n"
+		"store x, %4\n"
+		"%8 = const 2\n"
+		"store z, %8\n",
+		eliminate(&report));
+
+	TEST_ASSERT_EQUAL(2, report.u32_num_dead_stores);
+	TEST_ASSERT_EQUAL(3, report.u32_num_dead_instructions);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Every variable still ends up with the value it would have had
+ */
+TEST(unit_dce, test_program_unchanged)
+{
+	uint32_t pu32_variables[DCE_MAX_VARIABLES] = { 0 };
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		t = 5;
+	//		t = t * 7;
+	//		u = t + 1;
+	//		t = 9;
+	//		u = u + t;
+	//		v = 100;			(dead)
+	//		v = u - 2;
+	//		t + u + v;			(dead)
+	//		w = 4;				(dead)
+	//		w = 6;
+	parse_file("test_files/unit_dce_2.rep");
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	// Folding leaves every load unused, so only each variable's last store survives
+	TEST_ASSERT_EQUAL(5, CODE_GEN_get_dce_report()->u32_num_dead_stores);
+	TEST_ASSERT_EQUAL(8, CODE_GEN_get_dce_report()->u32_num_live_instructions);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(9, pu32_variables[SYMBOL_TABLE_lookup("t")]);
+	TEST_ASSERT_EQUAL_UINT32(45, pu32_variables[SYMBOL_TABLE_lookup("u")]);
+	TEST_ASSERT_EQUAL_UINT32(43, pu32_variables[SYMBOL_TABLE_lookup("v")]);
+	TEST_ASSERT_EQUAL_UINT32(6, pu32_variables[SYMBOL_TABLE_lookup("w")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_dce, test_overwritten_store);
+	RUN_TEST_CASE(unit_dce, test_loads_keep_stores);
+	RUN_TEST_CASE(unit_dce, test_faulting_division_kept);
+	RUN_TEST_CASE(unit_dce, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *	Links against a rep object and prints every variable after running it
+ */
+extern void rep_main(uint32_t * p_variables);
+extern const uint32_t rep_num_variables;
+extern const char rep_variable_names[];
+
+int main(void)
+{
+	static uint32_t pu32_variables[1024];
+	const char * kpc_name = rep_variable_names;
+
+	rep_main(pu32_variables);
+
+	for (uint32_t i = 0; i < rep_num_variables; i++)
+	{
+		printf("%s = %u\n", kpc_name, pu32_variables[i]);
+		kpc_name += strlen(kpc_name) + 1;
+	}
+
+	return 0;
+}
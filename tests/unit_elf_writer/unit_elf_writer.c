@@ -0,0 +1,277 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "encoder.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define ELF_WRITER_OBJECT_FILE			"test_files/unit_elf_writer_output.o"
+#define ELF_WRITER_ASSEMBLY_FILE		"test_files/unit_elf_writer_output.s"
+#define ELF_WRITER_AS_OBJECT_FILE		"test_files/unit_elf_writer_output_as.o"
+#define ELF_WRITER_EXECUTABLE_FILE		"test_files/unit_elf_writer_output"
+#define ELF_WRITER_DRIVER_FILE			"test_files/driver.c"
+#define ELF_WRITER_MAX_OUTPUT_SIZE		(4096)
+
+/*
+ *	Encodes one instruction on its own and checks the bytes
+ */
+#define ASSERT_ENCODES_TO(kpu8_expected, opcode, width, src_kind, u32_src, dst_kind, u32_dst) \
+	do \
+	{ \
+		ASM_buffer_t buffer; \
+		ENCODER_code_t code; \
+		ASM_init_buffer(&buffer); \
+		ENCODER_init_code(&code); \
+		ASM_emit(&buffer, opcode, width, src_kind, u32_src, dst_kind, u32_dst); \
+		TEST_ASSERT_EQUAL(STATUS_OK, ENCODER_encode_program(&buffer, &code)); \
+		TEST_ASSERT_EQUAL(sizeof(kpu8_expected), code.u32_size); \
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(kpu8_expected, code.pu8_bytes, sizeof(kpu8_expected)); \
+		ENCODER_deinit_code(&code); \
+		ASM_deinit_buffer(&buffer); \
+	} \
+	while(0)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Runs a shell command and returns what it printed. Points into a static buffer
+ */
+static const char * run_command(const char * kpc_command)
+{
+	static char pc_output[ELF_WRITER_MAX_OUTPUT_SIZE];
+	FILE * pipe = popen(kpc_command, "r");
+	size_t size;
+
+	TEST_ASSERT_NOT_NULL(pipe);
+	size = fread(pc_output, 1, sizeof(pc_output) - 1, pipe);
+	pc_output[size] = '\0';
+	TEST_ASSERT_EQUAL(0, pclose(pipe));
+
+	return pc_output;
+}
+
+/*
+ *	Writes the compiled program both ways and compares the .text sections, and the .rodata
+ *	sections holding the variable tables
+ */
+static void check_text_matches_assembler(void)
+{
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_object(ELF_WRITER_OBJECT_FILE));
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(ELF_WRITER_ASSEMBLY_FILE));
+
+	run_command("as " ELF_WRITER_ASSEMBLY_FILE " -o " ELF_WRITER_AS_OBJECT_FILE);
+	run_command("objcopy -O binary -j .text " ELF_WRITER_OBJECT_FILE " " ELF_WRITER_OBJECT_FILE ".bin && "
+				"objcopy -O binary -j .text " ELF_WRITER_AS_OBJECT_FILE " " ELF_WRITER_AS_OBJECT_FILE ".bin && "
+				"cmp " ELF_WRITER_OBJECT_FILE ".bin " ELF_WRITER_AS_OBJECT_FILE ".bin");
+	run_command("objcopy -O binary -j .rodata " ELF_WRITER_OBJECT_FILE " " ELF_WRITER_OBJECT_FILE ".bin && "
+				"objcopy -O binary -j .rodata " ELF_WRITER_AS_OBJECT_FILE " " ELF_WRITER_AS_OBJECT_FILE ".bin && "
+				"cmp " ELF_WRITER_OBJECT_FILE ".bin " ELF_WRITER_AS_OBJECT_FILE ".bin");
+
+	remove(ELF_WRITER_OBJECT_FILE ".bin");
+	remove(ELF_WRITER_AS_OBJECT_FILE ".bin");
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_elf_writer);
+
+TEST_SETUP(unit_elf_writer)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_elf_writer)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	remove(ELF_WRITER_OBJECT_FILE);
+	remove(ELF_WRITER_ASSEMBLY_FILE);
+	remove(ELF_WRITER_AS_OBJECT_FILE);
+	remove(ELF_WRITER_EXECUTABLE_FILE);
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Forms code generation doesn't reach yet, checked against the bytes `as` produces
+ */
+TEST(unit_elf_writer, test_encode_instruction_forms)
+{
+	static const uint8_t ku8_add_imm8[] = { 0x83, 0xC3, 0xFF };								// addl $-1, %ebx
+	static const uint8_t ku8_add_eax_imm32[] = { 0x05, 0xE8, 0x03, 0x00, 0x00 };			// addl $1000, %eax
+	static const uint8_t ku8_sub_imm32[] = { 0x41, 0x81, 0xEC, 0xE8, 0x03, 0x00, 0x00 };	// subl $1000, %r12d
+	static const uint8_t ku8_imul_imm8[] = { 0x45, 0x6B, 0xD2, 0x03 };						// imull $3, %r10d
+	static const uint8_t ku8_mov_disp32[] = { 0x44, 0x8B, 0xA7, 0xC8, 0x00, 0x00, 0x00 };	// movl 200(%rdi), %r12d
+	static const uint8_t ku8_mov_store_imm[] = { 0xC7, 0x47, 0x04, 0x07, 0x00, 0x00, 0x00 };	// movl $7, 4(%rdi)
+	static const uint8_t ku8_add_from_memory[] = { 0x03, 0x1F };							// addl 0(%rdi), %ebx
+	static const uint8_t ku8_mov_64[] = { 0x4C, 0x89, 0xE0 };								// movq %r12, %rax
+	static const uint8_t ku8_div_memory[] = { 0xF7, 0x77, 0x08 };							// divl 8(%rdi)
+	static const uint8_t ku8_pop_r15[] = { 0x41, 0x5F };									// popq %r15
+	static const uint8_t ku8_shl_one[] = { 0xD1, 0xE1 };									// shll $1, %ecx
+	static const uint8_t ku8_shl_imm8[] = { 0x41, 0xC1, 0xE1, 0x03 };						// shll $3, %r9d
+	static const uint8_t ku8_shr_64[] = { 0x48, 0xC1, 0xE8, 0x20 };							// shrq $32, %rax
+	static const uint8_t ku8_shr_stack[] = { 0xC1, 0x6C, 0x24, 0x08, 0x05 };				// shrl $5, 8(%rsp)
+	static const uint8_t ku8_lea3[] = { 0x8D, 0x34, 0x49 };									// leal (%rcx,%rcx,2), %esi
+	static const uint8_t ku8_lea5_rbp[] = { 0x44, 0x8D, 0x64, 0xAD, 0x00 };					// leal (%rbp,%rbp,4), %r12d
+	static const uint8_t ku8_lea9_r13[] = { 0x43, 0x8D, 0x44, 0xED, 0x00 };					// leal (%r13,%r13,8), %eax
+	static const uint8_t ku8_add_scaled4[] = { 0x8D, 0x34, 0x8E };							// leal (%rsi,%rcx,4), %esi
+	static const uint8_t ku8_add_scaled2_r13[] = { 0x47, 0x8D, 0x6C, 0x45, 0x00 };			// leal (%r13,%r8,2), %r13d
+	static const uint8_t ku8_add_scaled8_rbp[] = { 0x8D, 0x6C, 0xC5, 0x00 };				// leal (%rbp,%rax,8), %ebp
+	static const uint8_t ku8_imul_64[] = { 0x48, 0x0F, 0xAF, 0xC2 };						// imulq %rdx, %rax
+
+	ASSERT_ENCODES_TO(ku8_add_imm8, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, UINT32_MAX, ASM_OPERAND_REGISTER, ASM_REGISTER_RBX);
+	ASSERT_ENCODES_TO(ku8_add_eax_imm32, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 1000, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_sub_imm32, ASM_OPCODE_SUB, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 1000, ASM_OPERAND_REGISTER, ASM_REGISTER_R12);
+	ASSERT_ENCODES_TO(ku8_imul_imm8, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 3, ASM_OPERAND_REGISTER, ASM_REGISTER_R10);
+	ASSERT_ENCODES_TO(ku8_mov_disp32, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 50, ASM_OPERAND_REGISTER, ASM_REGISTER_R12);
+	ASSERT_ENCODES_TO(ku8_mov_store_imm, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 7, ASM_OPERAND_VARIABLE, 1);
+	ASSERT_ENCODES_TO(ku8_add_from_memory, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RBX);
+	ASSERT_ENCODES_TO(ku8_mov_64, ASM_OPCODE_MOV, ASM_WIDTH_64, ASM_OPERAND_REGISTER, ASM_REGISTER_R12, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_div_memory, ASM_OPCODE_DIV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 2, ASM_OPERAND_NONE, 0);
+	ASSERT_ENCODES_TO(ku8_pop_r15, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R15);
+	ASSERT_ENCODES_TO(ku8_shl_one, ASM_OPCODE_SHL, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 1, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASSERT_ENCODES_TO(ku8_shl_imm8, ASM_OPCODE_SHL, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 3, ASM_OPERAND_REGISTER, ASM_REGISTER_R9);
+	ASSERT_ENCODES_TO(ku8_shr_64, ASM_OPCODE_SHR, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, 32, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_shr_stack, ASM_OPCODE_SHR, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 5, ASM_OPERAND_STACK, 8);
+	ASSERT_ENCODES_TO(ku8_lea3, ASM_OPCODE_LEA3, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI);
+	ASSERT_ENCODES_TO(ku8_lea5_rbp, ASM_OPCODE_LEA5, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RBP, ASM_OPERAND_REGISTER, ASM_REGISTER_R12);
+	ASSERT_ENCODES_TO(ku8_lea9_r13, ASM_OPCODE_LEA9, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_R13, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_add_scaled4, ASM_OPCODE_ADD_SCALED4, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI);
+	ASSERT_ENCODES_TO(ku8_add_scaled2_r13, ASM_OPCODE_ADD_SCALED2, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_R8, ASM_OPERAND_REGISTER, ASM_REGISTER_R13);
+	ASSERT_ENCODES_TO(ku8_add_scaled8_rbp, ASM_OPCODE_ADD_SCALED8, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX, ASM_OPERAND_REGISTER, ASM_REGISTER_RBP);
+	ASSERT_ENCODES_TO(ku8_imul_64, ASM_OPCODE_IMUL, ASM_WIDTH_64, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+}
+
+/*
+ *	Narrow stores, the 16-bit prefix, byte registers that need a bare REX, and the extending loads
+ */
+TEST(unit_elf_writer, test_encode_width_forms)
+{
+	static const uint8_t ku8_movb_sil[] = { 0x40, 0x88, 0x77, 0x04 };						// movb %sil, 4(%rdi)
+	static const uint8_t ku8_movb_imm[] = { 0xC6, 0x47, 0x04, 0xC8 };						// movb $200, 4(%rdi)
+	static const uint8_t ku8_movw_r9w[] = { 0x66, 0x44, 0x89, 0x4F, 0x08 };				// movw %r9w, 8(%rdi)
+	static const uint8_t ku8_movw_imm[] = { 0x66, 0xB9, 0xFF, 0xFF };						// movw $65535, %cx
+	static const uint8_t ku8_movb_dil_imm[] = { 0x40, 0xB7, 0x05 };							// movb $5, %dil
+	static const uint8_t ku8_movb_from_stack[] = { 0x8A, 0x44, 0x24, 0x08 };				// movb 8(%rsp), %al
+	static const uint8_t ku8_movzbl[] = { 0x44, 0x0F, 0xB6, 0x57, 0x04 };					// movzbl 4(%rdi), %r10d
+	static const uint8_t ku8_movswq[] = { 0x48, 0x0F, 0xBF, 0x47, 0x08 };					// movswq 8(%rdi), %rax
+	static const uint8_t ku8_movsbl_sil[] = { 0x40, 0x0F, 0xBE, 0xCE };					// movsbl %sil, %ecx
+	static const uint8_t ku8_movslq[] = { 0x4C, 0x63, 0x5F, 0x04 };						// movslq 4(%rdi), %r11
+	static const uint8_t ku8_movzl_imm[] = { 0xB9, 0x00, 0x28, 0x6B, 0xEE };				// movl $4000000000, %ecx
+	static const uint8_t ku8_cltd[] = { 0x99 };												// cltd
+	static const uint8_t ku8_cqto[] = { 0x48, 0x99 };										// cqto
+	static const uint8_t ku8_idivq[] = { 0x48, 0xF7, 0xFE };								// idivq %rsi
+
+	ASSERT_ENCODES_TO(ku8_movb_sil, ASM_OPCODE_MOV, ASM_WIDTH_8, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI, ASM_OPERAND_VARIABLE, 1);
+	ASSERT_ENCODES_TO(ku8_movb_imm, ASM_OPCODE_MOV, ASM_WIDTH_8, ASM_OPERAND_IMMEDIATE, 200, ASM_OPERAND_VARIABLE, 1);
+	ASSERT_ENCODES_TO(ku8_movw_r9w, ASM_OPCODE_MOV, ASM_WIDTH_16, ASM_OPERAND_REGISTER, ASM_REGISTER_R9, ASM_OPERAND_VARIABLE, 2);
+	ASSERT_ENCODES_TO(ku8_movw_imm, ASM_OPCODE_MOV, ASM_WIDTH_16, ASM_OPERAND_IMMEDIATE, 65535, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASSERT_ENCODES_TO(ku8_movb_dil_imm, ASM_OPCODE_MOV, ASM_WIDTH_8, ASM_OPERAND_IMMEDIATE, 5, ASM_OPERAND_REGISTER, ASM_REGISTER_RDI);
+	ASSERT_ENCODES_TO(ku8_movb_from_stack, ASM_OPCODE_MOV, ASM_WIDTH_8, ASM_OPERAND_STACK, 8, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_movzbl, ASM_OPCODE_MOVZB, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 1, ASM_OPERAND_REGISTER, ASM_REGISTER_R10);
+	ASSERT_ENCODES_TO(ku8_movswq, ASM_OPCODE_MOVSW, ASM_WIDTH_64, ASM_OPERAND_VARIABLE, 2, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASSERT_ENCODES_TO(ku8_movsbl_sil, ASM_OPCODE_MOVSB, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASSERT_ENCODES_TO(ku8_movslq, ASM_OPCODE_MOVSL, ASM_WIDTH_64, ASM_OPERAND_VARIABLE, 1, ASM_OPERAND_REGISTER, ASM_REGISTER_R11);
+	ASSERT_ENCODES_TO(ku8_movzl_imm, ASM_OPCODE_MOVZL, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, 4000000000u, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASSERT_ENCODES_TO(ku8_cltd, ASM_OPCODE_CDQ, ASM_WIDTH_32, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+	ASSERT_ENCODES_TO(ku8_cqto, ASM_OPCODE_CDQ, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+	ASSERT_ENCODES_TO(ku8_idivq, ASM_OPCODE_IDIV, ASM_WIDTH_64, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI, ASM_OPERAND_NONE, 0);
+}
+
+/*
+ *	Memory to memory has no encoding, and must be refused rather than mis-encoded
+ */
+TEST(unit_elf_writer, test_encode_invalid_instruction)
+{
+	ASM_buffer_t buffer;
+	ENCODER_code_t code;
+
+	ASM_init_buffer(&buffer);
+	ENCODER_init_code(&code);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 0, ASM_OPERAND_VARIABLE, 1);
+
+	TEST_ASSERT_EQUAL(STATUS_FAILED, ENCODER_encode_program(&buffer, &code));
+
+	ENCODER_deinit_code(&code);
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	The directly encoded .text must be byte for byte what `as` makes of the assembly backend's output
+ */
+TEST(unit_elf_writer, test_text_matches_assembler)
+{
+	compile_file("test_files/unit_elf_writer_0.rep", NULL);
+	check_text_matches_assembler();
+}
+
+/*
+ *	Likewise with every type, so narrow, extending and 64-bit forms are all in there
+ */
+TEST(unit_elf_writer, test_typed_text_matches_assembler)
+{
+	compile_file("test_files/unit_elf_writer_1.rep", NULL);
+	check_text_matches_assembler();
+}
+
+/*
+ *	Links the object with the system linker and runs it
+ */
+TEST(unit_elf_writer, test_link_and_run)
+{
+	// 	test file reads:
+	//		x = 5;
+	//		y = 7;
+	//		q = 4294967295;
+	//		z = (x + 2) * y - 3;
+	//		w = q / y + 4000000000;
+	//		m = z * z * z * 1000;
+	compile_file("test_files/unit_elf_writer_0.rep", NULL);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_object(ELF_WRITER_OBJECT_FILE));
+
+	run_command("cc " ELF_WRITER_DRIVER_FILE " " ELF_WRITER_OBJECT_FILE " -o " ELF_WRITER_EXECUTABLE_FILE);
+
+	TEST_ASSERT_EQUAL_STRING(
+		"x = 5\n"
+		"y = 7\n"
+		"q = 4294967295\n"
+		"z = 46\n"
+		"w = 318599460\n"
+		"m = 97336000\n",
+		run_command("./" ELF_WRITER_EXECUTABLE_FILE));
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_elf_writer, test_encode_instruction_forms);
+	RUN_TEST_CASE(unit_elf_writer, test_encode_width_forms);
+	RUN_TEST_CASE(unit_elf_writer, test_encode_invalid_instruction);
+	RUN_TEST_CASE(unit_elf_writer, test_text_matches_assembler);
+	RUN_TEST_CASE(unit_elf_writer, test_typed_text_matches_assembler);
+	RUN_TEST_CASE(unit_elf_writer, test_link_and_run);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,187 @@
+#include <elf.h>
+#include <sys/wait.h>
+#include "unity.h"
+#include "unity_fixture.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "executable.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define EXECUTABLE_OBJECT_FILE			"test_files/unit_executable_output.o"
+#define EXECUTABLE_OUTPUT_FILE			"test_files/unit_executable_output"
+#define EXECUTABLE_MAX_OUTPUT_SIZE		(4096)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Compiles a file natively to an object and links it with the runtime
+ */
+static void build_file(const char * kpc_fname)
+{
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file(kpc_fname));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_object(EXECUTABLE_OBJECT_FILE));
+	TEST_ASSERT_EQUAL(STATUS_OK, EXECUTABLE_link(EXECUTABLE_OBJECT_FILE, EXECUTABLE_OUTPUT_FILE));
+}
+
+/*
+ *	Runs the executable and returns what it printed, and how it exited. Points into a static buffer
+ */
+static const char * run_executable(int * p_status)
+{
+	static char pc_output[EXECUTABLE_MAX_OUTPUT_SIZE];
+	FILE * pipe = popen("./" EXECUTABLE_OUTPUT_FILE " 2> /dev/null", "r");
+	size_t size;
+
+	TEST_ASSERT_NOT_NULL(pipe);
+	size = fread(pc_output, 1, sizeof(pc_output) - 1, pipe);
+	pc_output[size] = '\0';
+	*p_status = pclose(pipe);
+
+	return pc_output;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_executable);
+
+TEST_SETUP(unit_executable)
+{
+	if (!EXECUTABLE_linker_available())
+	{
+		TEST_IGNORE_MESSAGE("ld is not installed");
+	}
+}
+
+TEST_TEAR_DOWN(unit_executable)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	remove(EXECUTABLE_OBJECT_FILE);
+	remove(EXECUTABLE_OUTPUT_FILE);
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	The runtime prints every variable as its type reads, as `rep --jit` does, and exits cleanly
+ */
+TEST(unit_executable, test_link_and_run)
+{
+	int status;
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		a = 7 * 6;
+	//		u64 q = a * 4294967295;
+	//		i64 z = 0 - q;
+	//		i32 m = 0 - 2147483647 - 1;
+	//		u16 x = 65535 + 3;
+	build_file("test_files/unit_executable_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"s = -100\n"
+		"a = 42\n"
+		"q = 180388626390\n"
+		"z = -180388626390\n"
+		"m = -2147483648\n"
+		"x = 2\n",
+		run_executable(&status));
+	TEST_ASSERT_TRUE(WIFEXITED(status));
+	TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+}
+
+/*
+ *	Statically linked with nothing for a dynamic loader to do: no interpreter and no dynamic section
+ */
+TEST(unit_executable, test_freestanding)
+{
+	Elf64_Ehdr header;
+	Elf64_Phdr program_header;
+	FILE * file;
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		...
+	build_file("test_files/unit_executable_0.rep");
+
+	file = fopen(EXECUTABLE_OUTPUT_FILE, "rb");
+	TEST_ASSERT_NOT_NULL(file);
+	TEST_ASSERT_EQUAL(1, fread(&header, sizeof(header), 1, file));
+	TEST_ASSERT_EQUAL_MEMORY(ELFMAG, header.e_ident, SELFMAG);
+	TEST_ASSERT_EQUAL(ET_EXEC, header.e_type);
+
+	for (uint32_t i = 0; i < header.e_phnum; i++)
+	{
+		TEST_ASSERT_EQUAL(0, fseek(file, (long)(header.e_phoff + (i * header.e_phentsize)), SEEK_SET));
+		TEST_ASSERT_EQUAL(1, fread(&program_header, sizeof(program_header), 1, file));
+		TEST_ASSERT_NOT_EQUAL(PT_INTERP, program_header.p_type);
+		TEST_ASSERT_NOT_EQUAL(PT_DYNAMIC, program_header.p_type);
+	}
+
+	fclose(file);
+}
+
+/*
+ *	Dividing by zero still traps, before anything is printed
+ */
+TEST(unit_executable, test_trap)
+{
+	const char * kpc_output;
+	int status;
+
+	// 	test file reads:
+	//		x = 5;
+	//		y = 0;
+	//		z = x / y;
+	build_file("test_files/unit_executable_1.rep");
+
+	kpc_output = run_executable(&status);
+	TEST_ASSERT_EQUAL_STRING("", kpc_output);
+	TEST_ASSERT_FALSE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/*
+ *	A missing object is reported, not linked around
+ */
+TEST(unit_executable, test_link_missing_object)
+{
+	TEST_ASSERT_EQUAL(STATUS_FAILED, EXECUTABLE_link("test_files/no_such_object.o", EXECUTABLE_OUTPUT_FILE));
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_executable, test_link_and_run);
+	RUN_TEST_CASE(unit_executable, test_freestanding);
+	RUN_TEST_CASE(unit_executable, test_trap);
+	RUN_TEST_CASE(unit_executable, test_link_missing_object);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,290 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "fold.h"
+#include "dce.h"
+#include "jit.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define FOLD_OUTPUT_FILE			"test_files/unit_fold_output.ir"
+#define FOLD_MAX_OUTPUT_SIZE		(4096)
+#define FOLD_MAX_VARIABLES			(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file, folds it and eliminates what that left dead, and returns what's left
+ *	as text. Points into a static buffer
+ */
+static const char * fold(FOLD_report_t * p_report)
+{
+	static char pc_text[FOLD_MAX_OUTPUT_SIZE];
+	DCE_report_t dce_report;
+	IR_program_t program;
+	FILE * file;
+	size_t size;
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+	FOLD_run(&program, SYMBOL_TABLE_get_num_symbols(), p_report);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	DCE_run(&program, SYMBOL_TABLE_get_num_symbols(), &dce_report);
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(&program, FOLD_OUTPUT_FILE));
+	IR_deinit_program(&program);
+
+	file = fopen(FOLD_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(FOLD_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+/*
+ *	Reads a variable at its offset in the storage, extended as its type is
+ */
+static int64_t read_variable(const uint64_t * kpu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return (int64_t)BUILTINS_read(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type,
+		(const uint8_t *)kpu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_fold);
+
+TEST_SETUP(unit_fold)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_fold)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	A program that reads nothing in is all constants, through every variable it assigns
+ */
+TEST(unit_fold, test_constant_program)
+{
+	FOLD_report_t report;
+
+	// 	test file reads:
+	//		a = 60 + 9;
+	//		b = a - 2 * 3;
+	//		c = b / a;
+	//		a + 1;
+	parse_file("test_files/unit_fold_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%2 = const 69\n"
+		"store a, %2\n"
+		"%7 = const 63\n"
+		"store b, %7\n"
+		"%10 = const 0\n"
+		"store c, %10\n",
+		fold(&report));
+
+	TEST_ASSERT_EQUAL(5, report.u32_num_folded);
+	TEST_ASSERT_EQUAL(0, report.u32_num_simplified);
+	TEST_ASSERT_EQUAL(4, report.u32_num_propagated);
+}
+
+/*
+ *	Identities drop the arithmetic. A statement loads each variable once, but reusing values
+ *	across statements is left to value numbering
+ */
+TEST(unit_fold, test_identities)
+{
+	FOLD_report_t report;
+
+	// 	test file reads:
+	//		m = x + 0;
+	//		n = 1 * x;
+	//		o = x * 0;
+	//		p = x - x;
+	//		q = y / 1;
+	//		r = q + q;
+	parse_file("test_files/unit_fold_1.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = load x\n"
+		"store m, %0\n"
+		"%4 = load x\n"
+		"store n, %4\n"
+		"%8 = const 0\n"
+		"store o, %8\n"
+		"%11 = const 0\n"
+		"store p, %11\n"
+		"%12 = load y\n"
+		"store q, %12\n"
+		"%15 = load q\n"
+		"%17 = add %15, %15\n"
+		"store r, %17\n",
+		fold(&report));
+
+	TEST_ASSERT_EQUAL(0, report.u32_num_folded);
+	TEST_ASSERT_EQUAL(5, report.u32_num_simplified);
+}
+
+/*
+ *	Constants wrap as their statement's type does, and stores truncate them to their variable's
+ */
+TEST(unit_fold, test_wraparound)
+{
+	FOLD_report_t report;
+
+	// 	test file reads:
+	//		a = 4294967295 + 2;
+	//		b = 0 - 1;
+	//		i32 c = 0 - 7;
+	//		i32 d = c / 2;
+	//		u8 e = 250;
+	//		f = e + 10;
+	//		u8 g = 300;
+	//		h = g;
+	//		i64 k = 4000000000 * 3;
+	//		l = k / 4000000000;
+	parse_file("test_files/unit_fold_2.rep");
+
+	// k doesn't fit an immediate, so is still computed, but l is known from it
+	TEST_ASSERT_EQUAL_STRING(
+		"%2 = const 1\n"
+		"store a, %2\n"
+		"%5 = const 4294967295\n"
+		"store b, %5\n"
+		"%8 = const.i32 4294967289\n"
+		"store.i32 c, %8\n"
+		"%11 = const.i32 4294967293\n"
+		"store.i32 d, %11\n"
+		"%12 = const 250\n"
+		"store e, %12\n"
+		"%15 = const 260\n"
+		"store f, %15\n"
+		"%16 = const 300\n"
+		"store g, %16\n"
+		"%17 = const 44\n"
+		"store h, %17\n"
+		"%18 = const.i64 4000000000\n"
+		"%19 = const.i64 3\n"
+		"%20 = mul.i64 %18, %19\n"
+		"store.i64 k, %20\n"
+		"%23 = const.i64 3\n"
+		"store.i64 l, %23\n",
+		fold(&report));
+}
+
+/*
+ *	Divisions that fault at run time are left to
+ */
+TEST(unit_fold, test_faulting_division_kept)
+{
+	FOLD_report_t report;
+
+	// 	test file reads:
+	//		a = 5 / 0;
+	//		i32 b = 0 - 2147483647 - 1;
+	//		i32 c = b / (0 - 1);
+	parse_file("test_files/unit_fold_3.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = const 5\n"
+		"%1 = const 0\n"
+		"%2 = div %0, %1\n"
+		"store a, %2\n"
+		"%7 = const.i32 2147483648\n"
+		"store.i32 b, %7\n"
+		"%10 = const.i32 4294967295\n"
+		"%11 = const.i32 2147483648\n"
+		"%12 = div.i32 %11, %10\n"
+		"store.i32 c, %12\n",
+		fold(&report));
+}
+
+/*
+ *	Every variable still ends up with the value it would have had
+ */
+TEST(unit_fold, test_program_unchanged)
+{
+	uint64_t pu64_variables[FOLD_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_x = 0x55555556u;
+	JIT_program_t program;
+
+	// 	test file reads, with x set before it runs:
+	//		t = x * 3;
+	//		u = t + 0;
+	//		u8 v = t;
+	//		w = v + 1;
+	//		x = 10;
+	//		y = x * x - t;
+	//		z = y / 1 + u * 0;
+	parse_file("test_files/unit_fold_4.rep");
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_EQUAL(1, CODE_GEN_get_fold_report()->u32_num_folded);
+	TEST_ASSERT_EQUAL(4, CODE_GEN_get_fold_report()->u32_num_simplified);
+
+	memcpy((uint8_t *)pu64_variables + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("x")), &ku32_x, sizeof(ku32_x));
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_variables);
+
+	// x * 3 wraps to 2
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "t"));
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "u"));
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "v"));
+	TEST_ASSERT_EQUAL_INT64(3, read_variable(pu64_variables, "w"));
+	TEST_ASSERT_EQUAL_INT64(10, read_variable(pu64_variables, "x"));
+	TEST_ASSERT_EQUAL_INT64(98, read_variable(pu64_variables, "y"));
+	TEST_ASSERT_EQUAL_INT64(98, read_variable(pu64_variables, "z"));
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_fold, test_constant_program);
+	RUN_TEST_CASE(unit_fold, test_identities);
+	RUN_TEST_CASE(unit_fold, test_wraparound);
+	RUN_TEST_CASE(unit_fold, test_faulting_division_kept);
+	RUN_TEST_CASE(unit_fold, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,251 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "fold.h"
+#include "gvn.h"
+#include "dce.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define GVN_OUTPUT_FILE				"test_files/unit_gvn_output.ir"
+#define GVN_MAX_OUTPUT_SIZE			(4096)
+#define GVN_MAX_VARIABLES			(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file, folds and numbers it, eliminates what that left dead, and returns
+ *	what's left as text. Points into a static buffer
+ */
+static const char * number(uint32_t u32_budget, GVN_report_t * p_report)
+{
+	static char pc_text[GVN_MAX_OUTPUT_SIZE];
+	FOLD_report_t fold_report;
+	DCE_report_t dce_report;
+	IR_program_t program;
+	FILE * file;
+	size_t size;
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+	FOLD_run(&program, SYMBOL_TABLE_get_num_symbols(), &fold_report);
+	GVN_run(&program, SYMBOL_TABLE_get_num_symbols(), u32_budget, p_report);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	DCE_run(&program, SYMBOL_TABLE_get_num_symbols(), &dce_report);
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(&program, GVN_OUTPUT_FILE));
+	IR_deinit_program(&program);
+
+	file = fopen(GVN_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(GVN_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+/*
+ *	Compiles the parsed file with the budget given, runs it on the inputs and checks what it computed
+ */
+static void run_budget(uint32_t u32_budget)
+{
+	uint32_t pu32_variables[GVN_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_w = 0x9E3779B9u;
+	const uint32_t ku32_x = 0x7F4A7C15u;
+	const uint32_t ku32_y = 12345;
+	const uint32_t ku32_z = 4000000000u;
+	JIT_program_t program;
+
+	CODE_GEN_init();
+	CODE_GEN_set_gvn_budget(u32_budget);
+	// Variables are indexed as they were declared
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	CODE_GEN_run(PARSE_get_tree_list());
+	CODE_GEN_set_gvn_budget(0);
+
+	pu32_variables[SYMBOL_TABLE_lookup("w")] = ku32_w;
+	pu32_variables[SYMBOL_TABLE_lookup("x")] = ku32_x;
+	pu32_variables[SYMBOL_TABLE_lookup("y")] = ku32_y;
+	pu32_variables[SYMBOL_TABLE_lookup("z")] = ku32_z;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(ku32_w * ku32_x, pu32_variables[SYMBOL_TABLE_lookup("a")]);
+	TEST_ASSERT_EQUAL_UINT32((ku32_w + 1) * (ku32_x + 2) * (ku32_y + 3) * (ku32_z + 4), pu32_variables[SYMBOL_TABLE_lookup("b")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_w * ku32_x, pu32_variables[SYMBOL_TABLE_lookup("c")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_gvn);
+
+TEST_SETUP(unit_gvn)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_gvn)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Equal computations in later statements reuse the first, operands either way round, until
+ *	something they read is assigned
+ */
+TEST(unit_gvn, test_common_subexpressions)
+{
+	GVN_report_t report;
+
+	// 	test file reads:
+	//		a = x * y + z;
+	//		b = x * y + z;
+	//		c = y * x - 4;
+	//		x = 5;
+	//		d = x * y + z;
+	//		e = a + b;
+	parse_file("test_files/unit_gvn_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = load x\n"
+		"%1 = load y\n"
+		"%2 = mul %0, %1\n"
+		"%3 = load z\n"
+		"%4 = add %2, %3\n"
+		"store a, %4\n"
+		"store b, %4\n"
+		"%13 = const 4\n"
+		"%14 = sub %2, %13\n"
+		"store c, %14\n"
+		"%15 = const 5\n"
+		"store x, %15\n"
+		"%16 = const 5\n"
+		"%18 = mul %16, %1\n"
+		"%20 = add %18, %3\n"
+		"store d, %20\n"
+		"%23 = add %4, %4\n"
+		"store e, %23\n",
+		number(GVN_DEFAULT_BUDGET, &report));
+
+	TEST_ASSERT_EQUAL(12, report.u32_num_reused);
+	TEST_ASSERT_EQUAL(0, report.u32_num_over_budget);
+}
+
+/*
+ *	A load after a store is the value stored, unless the store truncated it
+ */
+TEST(unit_gvn, test_stored_values)
+{
+	GVN_report_t report;
+
+	// 	test file reads:
+	//		a = x + 1;
+	//		x = y;
+	//		b = x + 1;
+	//		c = y + 1;
+	//		u8 s = y;
+	//		d = s + 1;
+	parse_file("test_files/unit_gvn_1.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = load x\n"
+		"%1 = const 1\n"
+		"%2 = add %0, %1\n"
+		"store a, %2\n"
+		"%3 = load y\n"
+		"store x, %3\n"
+		"%5 = const 1\n"
+		"%6 = add %3, %5\n"
+		"store b, %6\n"
+		"store c, %6\n"
+		"store s, %3\n"
+		"%11 = load s\n"
+		"%12 = const 1\n"
+		"%13 = add %11, %12\n"
+		"store d, %13\n",
+		number(GVN_DEFAULT_BUDGET, &report));
+}
+
+/*
+ *	Holding w * x across b needs a register more than b does alone: within the budget it's
+ *	reused, past it it's computed again
+ */
+TEST(unit_gvn, test_register_budget)
+{
+	GVN_report_t report;
+	const char * kpc_text;
+
+	// 	test file reads:
+	//		a = w * x;
+	//		b = (w + 1) * ((x + 2) * ((y + 3) * (z + 4)));
+	//		c = w * x;
+	parse_file("test_files/unit_gvn_2.rep");
+
+	kpc_text = number(GVN_DEFAULT_BUDGET, &report);
+	TEST_ASSERT_NOT_NULL(strstr(kpc_text, "store c, %2\n"));
+	TEST_ASSERT_EQUAL(0, report.u32_num_over_budget);
+
+	kpc_text = number(3, &report);
+	TEST_ASSERT_NOT_NULL(strstr(kpc_text,
+		"%18 = load w\n"
+		"%19 = load x\n"
+		"%20 = mul %18, %19\n"
+		"store c, %20\n"));
+	TEST_ASSERT_EQUAL(0, report.u32_num_reused);
+	TEST_ASSERT_EQUAL(5, report.u32_num_over_budget);
+}
+
+/*
+ *	Every variable still ends up with the value it would have had, whatever the budget
+ */
+TEST(unit_gvn, test_program_unchanged)
+{
+	parse_file("test_files/unit_gvn_2.rep");
+
+	run_budget(1);
+	run_budget(3);
+	run_budget(GVN_DEFAULT_BUDGET);
+	run_budget(64);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_gvn, test_common_subexpressions);
+	RUN_TEST_CASE(unit_gvn, test_stored_values);
+	RUN_TEST_CASE(unit_gvn, test_register_budget);
+	RUN_TEST_CASE(unit_gvn, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,228 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define IR_OUTPUT_FILE				"test_files/unit_ir_output.ir"
+#define IR_MAX_OUTPUT_SIZE			(4096)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the program out and reads it back. Points into a static buffer
+ */
+static const char * get_program_text(const IR_program_t * kp_program)
+{
+	static char pc_text[IR_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(kp_program, IR_OUTPUT_FILE));
+
+	file = fopen(IR_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(IR_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+static void assert_uses(const IR_def_use_t * kp_def_use, uint32_t u32_value, const uint32_t * kpu32_expected, uint32_t u32_num_expected)
+{
+	TEST_ASSERT_EQUAL(u32_num_expected, IR_get_num_uses(kp_def_use, u32_value));
+
+	for (uint32_t i = 0; i < u32_num_expected; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(kpu32_expected[i], kp_def_use->pu32_uses[kp_def_use->pu32_use_start[u32_value] + i]);
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_ir);
+
+TEST_SETUP(unit_ir)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_ir)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Every statement lowers to SSA, heavier operands first, with stores for assignments
+ */
+TEST(unit_ir, test_lower_nominal)
+{
+	IR_program_t program;
+
+	// 	test file reads:
+	//		a = 60 + 9;
+	//		b = a - 2 * 3;
+	//		c = b / a;
+	//		a + 1;
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_ir_0.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = const 60\n"
+		"%1 = const 9\n"
+		"%2 = add %0, %1\n"
+		"store a, %2\n"
+		"%3 = const 2\n"
+		"%4 = const 3\n"
+		"%5 = mul %3, %4\n"
+		"%6 = load a\n"
+		"%7 = sub %6, %5\n"
+		"store b, %7\n"
+		"%8 = load b\n"
+		"%9 = load a\n"
+		"%10 = div %8, %9\n"
+		"store c, %10\n"
+		"%11 = load a\n"
+		"%12 = const 1\n"
+		"%13 = add %11, %12\n",
+		get_program_text(&program));
+
+	IR_deinit_program(&program);
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	A literal too big for an immediate is built from its halves in a 64-bit statement, and only
+ *	its low half is kept in a 32-bit one
+ */
+TEST(unit_ir, test_lower_wide_literal)
+{
+	IR_program_t program;
+
+	TEST_ASSERT_EQUAL_UINT64(5000000000ull, IR_literal_value("5000000000"));
+	TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, IR_literal_value("18446744073709551615"));
+
+	// 	test file reads:
+	//		u64 a = 5000000000;
+	//		b = 5000000000;
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_ir_1.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = const.u64 65536\n"
+		"%1 = const.u64 1\n"
+		"%2 = mul.u64 %1, %0\n"
+		"%3 = mul.u64 %2, %0\n"
+		"%4 = const.u64 705032704\n"
+		"%5 = add.u64 %3, %4\n"
+		"store.u64 a, %5\n"
+		"%6 = const 705032704\n"
+		"store b, %6\n",
+		get_program_text(&program));
+
+	IR_deinit_program(&program);
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Chains list each use once per instruction, in program order
+ */
+TEST(unit_ir, test_def_use_chains)
+{
+	IR_program_t program;
+	IR_def_use_t def_use;
+	uint32_t u32_five, u32_sum, u32_product;
+
+	IR_init_program(&program);
+
+	u32_five = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 5);
+	u32_sum = IR_emit(&program, IR_OPCODE_ADD, u32_five, u32_five, 0);
+	u32_product = IR_emit(&program, IR_OPCODE_MUL, u32_sum, u32_five, 0);
+	TEST_ASSERT_EQUAL_UINT32(IR_VALUE_NONE, IR_emit(&program, IR_OPCODE_STORE, u32_product, IR_VALUE_NONE, 0));
+
+	TEST_ASSERT_EQUAL(3, program.u32_num_values);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+
+	IR_build_def_use(&program, &def_use);
+
+	TEST_ASSERT_EQUAL_UINT32(0, def_use.pu32_def[u32_five]);
+	TEST_ASSERT_EQUAL_UINT32(1, def_use.pu32_def[u32_sum]);
+	TEST_ASSERT_EQUAL_UINT32(2, def_use.pu32_def[u32_product]);
+	assert_uses(&def_use, u32_five, (const uint32_t[]){ 1, 2 }, 2);
+	assert_uses(&def_use, u32_sum, (const uint32_t[]){ 2 }, 1);
+	assert_uses(&def_use, u32_product, (const uint32_t[]){ 3 }, 1);
+
+	IR_deinit_def_use(&def_use);
+	IR_deinit_program(&program);
+}
+
+/*
+ *	Uses before definitions and second definitions are both caught
+ */
+TEST(unit_ir, test_verify_rejects_non_ssa)
+{
+	IR_program_t program;
+	uint32_t u32_value;
+
+	IR_init_program(&program);
+	u32_value = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 1);
+	IR_emit(&program, IR_OPCODE_ADD, u32_value, u32_value + 1, 0);
+	TEST_ASSERT_FALSE(IR_verify(&program));
+	IR_deinit_program(&program);
+
+	IR_init_program(&program);
+	u32_value = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 1);
+	IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 2);
+	program.p_instructions[1].u32_result = u32_value;
+	TEST_ASSERT_FALSE(IR_verify(&program));
+	IR_deinit_program(&program);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_ir, test_lower_nominal);
+	RUN_TEST_CASE(unit_ir, test_lower_wide_literal);
+	RUN_TEST_CASE(unit_ir, test_def_use_chains);
+	RUN_TEST_CASE(unit_ir, test_verify_rejects_non_ssa);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,210 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define JIT_MAX_VARIABLES				(64)
+#define JIT_MAX_MAPS_LINE_LENGTH		(512)
+#define JIT_DISABLED_PASS				"layout"	// The asserts index variables, and check offsets, as they were declared
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	A variable as its type reads it, out of the storage the program ran over
+ */
+static int64_t read_variable(const uint64_t * kpu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return (int64_t)BUILTINS_read(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type,
+		(const uint8_t *)kpu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/*
+ *	Looks the mapping holding `kp_address` up in /proc/self/maps and copies out its permissions
+ */
+static void get_mapping_permissions(const void * kp_address, char * pc_permissions)
+{
+	char pc_line[JIT_MAX_MAPS_LINE_LENGTH];
+	unsigned long start, end;
+	bool b_found = false;
+	FILE * file = fopen("/proc/self/maps", "r");
+
+	TEST_ASSERT_NOT_NULL(file);
+
+	while (!b_found && fgets(pc_line, sizeof(pc_line), file) != NULL)
+	{
+		if (sscanf(pc_line, "%lx-%lx %4s", &start, &end, pc_permissions) == 3 &&
+			(unsigned long)kp_address >= start && (unsigned long)kp_address < end)
+		{
+			b_found = true;
+		}
+	}
+
+	fclose(file);
+	TEST_ASSERT_TRUE(b_found);
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_jit);
+
+TEST_SETUP(unit_jit)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_jit)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+TEST(unit_jit, test_run_nominal)
+{
+	uint32_t pu32_variables[JIT_MAX_VARIABLES] = { 0 };
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		x = 5;
+	//		y = 7;
+	//		q = 4294967295;
+	//		z = (x + 2) * y - 3;
+	//		w = q / y + 4000000000;
+	//		m = z * z * z * 1000;
+	compile_file("test_files/unit_jit_0.rep", JIT_DISABLED_PASS);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	TEST_ASSERT_EQUAL(6, SYMBOL_TABLE_get_num_symbols());
+
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(5, pu32_variables[SYMBOL_TABLE_lookup("x")]);
+	TEST_ASSERT_EQUAL_UINT32(7, pu32_variables[SYMBOL_TABLE_lookup("y")]);
+	TEST_ASSERT_EQUAL_UINT32(4294967295u, pu32_variables[SYMBOL_TABLE_lookup("q")]);
+	TEST_ASSERT_EQUAL_UINT32(46, pu32_variables[SYMBOL_TABLE_lookup("z")]);
+	TEST_ASSERT_EQUAL_UINT32(318599460, pu32_variables[SYMBOL_TABLE_lookup("w")]);
+	TEST_ASSERT_EQUAL_UINT32(97336000, pu32_variables[SYMBOL_TABLE_lookup("m")]);
+
+	// Nothing past the last variable is touched
+	TEST_ASSERT_EQUAL_UINT32(0, pu32_variables[6]);
+
+	JIT_release(&program);
+	TEST_ASSERT_NULL(program.p_memory);
+}
+
+/*
+ *	Every type: narrow variables wrap when stored and widen by their own signedness when loaded,
+ *	signed division truncates towards zero, and 64-bit statements keep all 64 bits
+ */
+TEST(unit_jit, test_run_typed)
+{
+	uint64_t pu64_variables[JIT_MAX_VARIABLES] = { 0 };
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		u8 a = 250;
+	//		b = a + 10;
+	//		u8 c = a + 10;
+	//		i8 d = 0 - 3;
+	//		i32 e = d * 1000;
+	//		i32 f = e / 7;
+	//		i64 g = e * 100000;
+	//		u64 h = 4000000000 * 3;
+	//		u16 k = 65535;
+	//		l = k * 2;
+	//		i16 m = 0 - 30000;
+	//		i64 n = m / 2 - g;
+	//		u64 o = h / 7;
+	//		u64 p = o / b;
+	//		i32 q = f / d;
+	compile_file("test_files/unit_jit_1.rep", JIT_DISABLED_PASS);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(pu64_variables), SYMBOL_TABLE_get_storage_size());
+
+	JIT_run(&program, (uint32_t *)pu64_variables);
+
+	TEST_ASSERT_EQUAL_INT64(250, read_variable(pu64_variables, "a"));
+	TEST_ASSERT_EQUAL_INT64(260, read_variable(pu64_variables, "b"));
+	TEST_ASSERT_EQUAL_INT64(4, read_variable(pu64_variables, "c"));
+	TEST_ASSERT_EQUAL_INT64(-3, read_variable(pu64_variables, "d"));
+	TEST_ASSERT_EQUAL_INT64(-3000, read_variable(pu64_variables, "e"));
+	TEST_ASSERT_EQUAL_INT64(-428, read_variable(pu64_variables, "f"));
+	TEST_ASSERT_EQUAL_INT64(-300000000, read_variable(pu64_variables, "g"));
+	TEST_ASSERT_EQUAL_INT64(12000000000, read_variable(pu64_variables, "h"));
+	TEST_ASSERT_EQUAL_INT64(65535, read_variable(pu64_variables, "k"));
+	TEST_ASSERT_EQUAL_INT64(131070, read_variable(pu64_variables, "l"));
+	TEST_ASSERT_EQUAL_INT64(-30000, read_variable(pu64_variables, "m"));
+	TEST_ASSERT_EQUAL_INT64(299985000, read_variable(pu64_variables, "n"));
+	TEST_ASSERT_EQUAL_INT64(1714285714, read_variable(pu64_variables, "o"));
+	TEST_ASSERT_EQUAL_INT64(6593406, read_variable(pu64_variables, "p"));
+	TEST_ASSERT_EQUAL_INT64(142, read_variable(pu64_variables, "q"));
+
+	// Each variable is aligned to its own size: the bytes c and d pack in after b, and g skips to 24
+	TEST_ASSERT_EQUAL_UINT32(0, SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("a")));
+	TEST_ASSERT_EQUAL_UINT32(4, SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("b")));
+	TEST_ASSERT_EQUAL_UINT32(9, SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("d")));
+	TEST_ASSERT_EQUAL_UINT32(12, SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("e")));
+	TEST_ASSERT_EQUAL_UINT32(24, SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("g")));
+
+	JIT_release(&program);
+}
+
+/*
+ *	The code mapping must never be writable and executable at the same time
+ */
+TEST(unit_jit, test_mapping_is_not_writable)
+{
+	char pc_permissions[5];
+	JIT_program_t program;
+
+	compile_file("test_files/unit_jit_0.rep", JIT_DISABLED_PASS);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+
+	get_mapping_permissions(program.p_memory, pc_permissions);
+	TEST_ASSERT_EQUAL_CHAR('r', pc_permissions[0]);
+	TEST_ASSERT_EQUAL_CHAR('-', pc_permissions[1]);
+	TEST_ASSERT_EQUAL_CHAR('x', pc_permissions[2]);
+
+	JIT_release(&program);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_jit, test_run_nominal);
+	RUN_TEST_CASE(unit_jit, test_run_typed);
+	RUN_TEST_CASE(unit_jit, test_mapping_is_not_writable);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,298 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "slp.h"
+#include "layout.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define LAYOUT_MAX_VARIABLES			(64)
+#define LAYOUT_NUM_HOT					(4)
+#define LAYOUT_MAP_FILE					"test_files/unit_layout_output.map"
+#define LAYOUT_MAX_MAP_SIZE				(1024)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file, vectorizing it first if asked, and lays its variables out
+ */
+static void lay_out(IR_program_t * p_program, bool b_vectorize, LAYOUT_report_t * p_report)
+{
+	SLP_report_t slp_report;
+
+	IR_init_program(p_program);
+	IR_lower(PARSE_get_tree_list(), p_program);
+
+	if (b_vectorize)
+	{
+		SLP_run(p_program, SYMBOL_TABLE_get_num_symbols(), &slp_report);
+		TEST_ASSERT_EQUAL(1, slp_report.u32_num_groups);
+	}
+
+	LAYOUT_run(p_program, SYMBOL_TABLE_get_num_symbols(), p_report);
+}
+
+static uint32_t offset_of(const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return SYMBOL_TABLE_get_offset(u32_symbol);
+}
+
+/*
+ *	Every variable aligned to its size, inside the storage, and overlapping no other
+ */
+static void assert_packed(void)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	uint8_t pu8_owners[LAYOUT_MAX_VARIABLES * sizeof(uint64_t)] = { 0 };
+	uint32_t u32_offset;
+	uint32_t u32_size;
+
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(pu8_owners), SYMBOL_TABLE_get_storage_size());
+
+	for (uint32_t i = 0; i < SYMBOL_TABLE_get_num_symbols(); i++)
+	{
+		u32_offset = SYMBOL_TABLE_get_offset(i);
+		u32_size = BUILTINS_get_size(kp_symbols[i].builtin_type);
+
+		TEST_ASSERT_EQUAL_UINT32(0, u32_offset % u32_size);
+		TEST_ASSERT_LESS_OR_EQUAL(SYMBOL_TABLE_get_storage_size(), u32_offset + u32_size);
+
+		for (uint32_t j = u32_offset; j < u32_offset + u32_size; j++)
+		{
+			TEST_ASSERT_EQUAL_UINT8(0, pu8_owners[j]);
+			pu8_owners[j] = 1;
+		}
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_layout);
+
+TEST_SETUP(unit_layout)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_layout)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Variables the busy statements share end up in one cache line, however far apart they were declared
+ */
+TEST(unit_layout, test_hot_packed)
+{
+	IR_program_t program;
+	LAYOUT_report_t report;
+	char pc_name[4];
+
+	// 	test file reads, with h1 to h3 declared 16 u32s after the one before:
+	//		h0 = h0 + 1;
+	//		c0 = c0 + 1;
+	//		...
+	//		c47 = c47 + 1;
+	//		h0 = h1 + h2 + h3;
+	//		h1 = h0 + h2 + h3;
+	//		...
+	parse_file("test_files/unit_layout_0.rep");
+	TEST_ASSERT_EQUAL_UINT32(LAYOUT_CACHE_LINE_SIZE + sizeof(uint32_t), offset_of("h1"));
+
+	lay_out(&program, false, &report);
+
+	TEST_ASSERT_EQUAL(SYMBOL_TABLE_get_num_symbols(), report.u32_num_blocks);
+	TEST_ASSERT_EQUAL(4, report.u32_num_lines);
+	TEST_ASSERT_LESS_THAN(report.u32_hot_lines_before, report.u32_hot_lines_after);
+
+	for (uint32_t i = 0; i < LAYOUT_NUM_HOT; i++)
+	{
+		sprintf(pc_name, "h%u", i);
+		TEST_ASSERT_LESS_THAN(LAYOUT_CACHE_LINE_SIZE, offset_of(pc_name));
+	}
+	assert_packed();
+
+	IR_deinit_program(&program);
+}
+
+/*
+ *	Smaller variables fill the gaps larger ones' alignment leaves
+ */
+TEST(unit_layout, test_gaps_filled)
+{
+	IR_program_t program;
+	LAYOUT_report_t report;
+
+	// 	test file reads:
+	//		u8 a = 1;
+	//		u64 b = 2;
+	//		u16 c = 3;
+	//		u32 d = 4;
+	//		u8 e = 5;
+	parse_file("test_files/unit_layout_1.rep");
+	TEST_ASSERT_EQUAL_UINT32(25, SYMBOL_TABLE_get_storage_size());
+
+	lay_out(&program, false, &report);
+
+	TEST_ASSERT_EQUAL_UINT32(16, SYMBOL_TABLE_get_storage_size());
+	TEST_ASSERT_EQUAL_UINT32(8, offset_of("b"));
+	assert_packed();
+
+	IR_deinit_program(&program);
+}
+
+/*
+ *	Lanes a vector instruction accesses stay consecutive and in order, and don't straddle a line
+ */
+TEST(unit_layout, test_vector_kept)
+{
+	IR_program_t program;
+	LAYOUT_report_t report;
+
+	// 	test file reads:
+	//		y = y + 1;
+	//		x0 = x0 + 7;
+	//		...
+	//		x3 = x3 + 7;
+	//		y = y * 3;
+	//		z = z + y;
+	parse_file("test_files/unit_layout_2.rep");
+
+	lay_out(&program, true, &report);
+
+	TEST_ASSERT_EQUAL(3, report.u32_num_blocks);
+	TEST_ASSERT_EQUAL_UINT32(0, offset_of("x0") % (IR_VECTOR_LANES * sizeof(uint32_t)));
+	TEST_ASSERT_EQUAL_UINT32(offset_of("x0") + 4, offset_of("x1"));
+	TEST_ASSERT_EQUAL_UINT32(offset_of("x0") + 8, offset_of("x2"));
+	TEST_ASSERT_EQUAL_UINT32(offset_of("x0") + 12, offset_of("x3"));
+	assert_packed();
+
+	IR_deinit_program(&program);
+}
+
+/*
+ *	The map lists every variable by offset, with its line, size, accesses and type
+ */
+TEST(unit_layout, test_map)
+{
+	char pc_map[LAYOUT_MAX_MAP_SIZE];
+	IR_program_t program;
+	LAYOUT_report_t report;
+	FILE * file;
+	size_t size;
+
+	// 	test file reads:
+	//		u8 a = 1;
+	//		...
+	parse_file("test_files/unit_layout_1.rep");
+
+	lay_out(&program, false, &report);
+	TEST_ASSERT_EQUAL(STATUS_OK, LAYOUT_write_map(&program, SYMBOL_TABLE_get_num_symbols(), LAYOUT_MAP_FILE));
+
+	file = fopen(LAYOUT_MAP_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_map, 1, sizeof(pc_map) - 1, file);
+	fclose(file);
+	remove(LAYOUT_MAP_FILE);
+	pc_map[size] = '\0';
+
+	TEST_ASSERT_EQUAL_STRING(
+		"# 5 variables in 16 bytes, 1 cache lines of 64 bytes\n"
+		"# offset     line  size   accesses  type name\n"
+		"0x00000000      0     1          1  u8   a\n"
+		"0x00000001      0     1          1  u8   e\n"
+		"0x00000002      0     2          1  u16  c\n"
+		"0x00000004      0     4          1  u32  d\n"
+		"0x00000008      0     8          1  u64  b\n",
+		pc_map);
+
+	IR_deinit_program(&program);
+}
+
+/*
+ *	Through the whole pipeline, the program computes the same with the variables moved
+ */
+TEST(unit_layout, test_program_unchanged)
+{
+	uint64_t pu64_declared[LAYOUT_MAX_VARIABLES] = { 0 };
+	uint64_t pu64_moved[LAYOUT_MAX_VARIABLES] = { 0 };
+	uint32_t pu32_declared[LAYOUT_MAX_VARIABLES];
+	const SYMBOL_TABLE_entry_t * kp_symbols;
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		h0 = h0 + 1;
+	//		...
+	parse_file("test_files/unit_layout_0.rep");
+	kp_symbols = SYMBOL_TABLE_get_symbol_table();
+
+	// In declaration order first, since layout moves the variables for good
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_declared);
+	JIT_release(&program);
+
+	for (uint32_t i = 0; i < SYMBOL_TABLE_get_num_symbols(); i++)
+	{
+		pu32_declared[i] = (uint32_t)BUILTINS_read(kp_symbols[i].builtin_type, (const uint8_t *)pu64_declared + SYMBOL_TABLE_get_offset(i));
+	}
+	CODE_GEN_deinit();
+
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_GREATER_THAN(0, CODE_GEN_get_layout_report()->u32_num_moved);
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_moved);
+	JIT_release(&program);
+
+	for (uint32_t i = 0; i < SYMBOL_TABLE_get_num_symbols(); i++)
+	{
+		TEST_ASSERT_EQUAL_HEX32(pu32_declared[i],
+			(uint32_t)BUILTINS_read(kp_symbols[i].builtin_type, (const uint8_t *)pu64_moved + SYMBOL_TABLE_get_offset(i)));
+	}
+	CODE_GEN_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_layout, test_hot_packed);
+	RUN_TEST_CASE(unit_layout, test_gaps_filled);
+	RUN_TEST_CASE(unit_layout, test_vector_kept);
+	RUN_TEST_CASE(unit_layout, test_map);
+	RUN_TEST_CASE(unit_layout, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,201 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "llvm_ir.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define LLVM_IR_OUTPUT_FILE				"test_files/unit_llvm_ir_output.ll"
+#define LLVM_IR_OBJECT_FILE				"test_files/unit_llvm_ir_output.o"
+#define LLVM_IR_LIBRARY_FILE			"test_files/unit_llvm_ir_output.so"
+#define LLVM_IR_MAX_OUTPUT_SIZE			(8192)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the parsed file out as LLVM IR and checks every snippet is somewhere in it
+ */
+static void assert_lowers_to(const char * const * kpkpc_snippets, uint32_t u32_num_snippets)
+{
+	static char pc_text[LLVM_IR_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, LLVM_IR_write_program(PARSE_get_tree_list(), LLVM_IR_OUTPUT_FILE));
+
+	file = fopen(LLVM_IR_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	pc_text[size] = '\0';
+
+	for (uint32_t i = 0; i < u32_num_snippets; i++)
+	{
+		TEST_ASSERT_NOT_NULL_MESSAGE(strstr(pc_text, kpkpc_snippets[i]), kpkpc_snippets[i]);
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_llvm_ir);
+
+TEST_SETUP(unit_llvm_ir)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_llvm_ir)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	remove(LLVM_IR_OUTPUT_FILE);
+	remove(LLVM_IR_OBJECT_FILE);
+	remove(LLVM_IR_LIBRARY_FILE);
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Every arithmetic node, in u32. Divides check their divisor first
+ */
+TEST(unit_llvm_ir, test_format_arithmetic)
+{
+	static const char * const kpkpc_snippets[] =
+	{
+		"@rep_num_variables = constant i32 9\n",
+		"@rep_variable_offsets = constant [9 x i32] [i32 0, i32 4, i32 8, i32 12, i32 16, i32 20, i32 24, i32 28, i32 32]\n",
+		"@rep_variable_names = constant [18 x i8] c\"d\\00a\\00b\\00e\\00f\\00g\\00h\\00c\\00k\\00\"\n",
+		"define void @rep_main(i8* noalias nocapture %vars) nounwind {\n",
+		" = add i32 ",
+		" = sub i32 ",
+		" = mul i32 ",
+		" = udiv i32 ",
+		" = add i32 -1, ",
+		", label %trap, label %b0\n",
+		"trap:\n  call void @llvm.trap()\n  unreachable\n}\n",
+	};
+
+	// 	test file reads:
+	//		d = a + b;
+	//		e = a - b;
+	//		f = a * b;
+	//		g = b / a;
+	//		h = d * e - f / c + g;
+	//		k = 4294967295 + h * (c - 7);
+	parse_file("test_files/unit_llvm_ir_0.rep");
+
+	assert_lowers_to(kpkpc_snippets, sizeof(kpkpc_snippets) / sizeof(kpkpc_snippets[0]));
+}
+
+/*
+ *	Narrow variables are widened by their own signedness, statements compute in the type they
+ *	combine to, and the result is cut down to the variable it's stored in
+ */
+TEST(unit_llvm_ir, test_format_typed)
+{
+	static const char * const kpkpc_snippets[] =
+	{
+		"@rep_variable_types = constant [10 x i8] [i8 129, i8 1, i8 130, i8 2, i8 132, i8 136, i8 8, i8 132, i8 1, i8 132]\n",
+		" = sext i8 ",
+		" = zext i8 ",
+		" = sext i16 ",
+		" = zext i16 ",
+		" = sext i32 ",
+		" = trunc i32 ",
+		" = trunc i64 ",
+		" = sdiv i32 ",
+		" = sdiv i64 ",
+		", -9223372036854775808\n",
+		"store i8 ",
+		"store i16 ",
+		"store i64 ",
+	};
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		u8 t = 200;
+	//		i16 w = s * 300;
+	//		u16 x = t * t + w;
+	//		i32 y = w / s - x;
+	//		i64 z = y * 100000 - 7;
+	//		u64 q = z / 3;
+	//		i32 r = y / (0 - 6);
+	//		u8 n = t + t;
+	//		i32 m = z / 1000;
+	parse_file("test_files/unit_llvm_ir_1.rep");
+
+	assert_lowers_to(kpkpc_snippets, sizeof(kpkpc_snippets) / sizeof(kpkpc_snippets[0]));
+}
+
+/*
+ *	What LLVM compiles computes what native code does, in every type
+ */
+TEST(unit_llvm_ir, test_compile_matches_native)
+{
+	static const char * const kpkpc_inputs[] = { "a", "b", "c" };
+	static const uint32_t ku32_values[] = { 123456789, 3987654321u, 42 };
+
+	if (!LLVM_IR_tools_available())
+	{
+		TEST_IGNORE_MESSAGE("Neither clang nor llc is installed");
+	}
+
+	// 	test file reads:
+	//		d = a + b;
+	//		...
+	parse_file("test_files/unit_llvm_ir_0.rep");
+	assert_matches_native(LLVM_IR_compile_object, LLVM_IR_OBJECT_FILE, LLVM_IR_LIBRARY_FILE, kpkpc_inputs, ku32_values, 3);
+	PARSE_deinit();
+	LEX_deinit();
+
+	// 	test file reads:
+	//		i8 s = 0 - 100;
+	//		...
+	parse_file("test_files/unit_llvm_ir_1.rep");
+	assert_matches_native(LLVM_IR_compile_object, LLVM_IR_OBJECT_FILE, LLVM_IR_LIBRARY_FILE, NULL, NULL, 0);
+}
+
+/*
+ *	An output path too long for the command is an error, not a crash
+ */
+TEST(unit_llvm_ir, test_long_path_fails)
+{
+	static char pc_fname[2048];
+
+	memset(pc_fname, 'x', sizeof(pc_fname) - 1);
+	memcpy(pc_fname, "test_files/", strlen("test_files/"));
+	pc_fname[sizeof(pc_fname) - 1] = '\0';
+
+	parse_file("test_files/unit_llvm_ir_0.rep");
+	TEST_ASSERT_EQUAL(STATUS_FAILED, LLVM_IR_compile_object(PARSE_get_tree_list(), pc_fname));
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_llvm_ir, test_format_arithmetic);
+	RUN_TEST_CASE(unit_llvm_ir, test_format_typed);
+	RUN_TEST_CASE(unit_llvm_ir, test_compile_matches_native);
+	RUN_TEST_CASE(unit_llvm_ir, test_long_path_fails);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -53,6 +53,89 @@ TEST(unit_parse, test_parse_init)
 	}
 }
 
+/*
+ *	A chain of operators is parsed in a loop, however long, and nests to the left
+ */
+TEST(unit_parse, test_long_chain)
+{
+	const PARSE_tree_list_t * p_tree_list;
+	const PARSE_node_t * p_node;
+	uint32_t u32_num_adds = 0;
+
+	// 	test file reads:
+	//		s = 1 + 1 + ... + 1;	(1100 terms)
+	//		t = a * b / c;
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_parse_1.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, PARSE_run_rdp());
+
+	p_tree_list = PARSE_get_tree_list();
+	TEST_ASSERT_EQUAL(2, p_tree_list->u32_num_trees);
+
+	for (p_node = p_tree_list->trees[0]->p_right; p_node->type == PARSE_NODE_TYPE_EXPR_TYPE_ADD; p_node = p_node->p_left)
+	{
+		TEST_ASSERT_EQUAL(PARSE_NODE_TYPE_ID, p_node->p_right->type);
+		u32_num_adds++;
+	}
+
+	TEST_ASSERT_EQUAL(1099, u32_num_adds);
+
+	p_node = p_tree_list->trees[1]->p_right;
+	TEST_ASSERT_EQUAL(PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE, p_node->type);
+	TEST_ASSERT_EQUAL(PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY, p_node->p_left->type);
+	TEST_ASSERT_EQUAL_STRING("c", p_node->p_right->p_token->pc_lexeme);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Parentheses nested past the limit are an error that fails the parse
+ */
+TEST(unit_parse, test_nesting_too_deep)
+{
+	// 	test file reads:
+	//		x = ((( ... 1 ... )));	(1100 deep)
+	//		y = 2;
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_parse_2.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	TEST_ASSERT_EQUAL(STATUS_FAILED, PARSE_run_rdp());
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	A statement the grammar doesn't cover fails the parse, rather than being compiled as nothing
+ */
+TEST(unit_parse, test_malformed_fails)
+{
+	static const char * const kpkpc_files[] =
+	{
+		"test_files/unit_parse_3.rep",		// a = 5 +;
+		"test_files/unit_parse_4.rep",		// a = b c;
+		"test_files/unit_parse_5.rep",		// a = 5		(no ;)
+		"test_files/unit_parse_6.rep",		// = 5;
+		"test_files/unit_parse_7.rep",		// a = (b = 3);
+	};
+
+	for (uint32_t i = 0; i < sizeof(kpkpc_files) / sizeof(kpkpc_files[0]); i++)
+	{
+		TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file(kpkpc_files[i]));
+		TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+		LEX_run_fsm();
+		PARSE_init();
+		TEST_ASSERT_EQUAL_MESSAGE(STATUS_FAILED, PARSE_run_rdp(), kpkpc_files[i]);
+
+		PARSE_deinit();
+		LEX_deinit();
+	}
+}
+
 /****************************************************************************************************
  *	M A I N
  ****************************************************************************************************/
@@ -60,6 +143,9 @@ TEST(unit_parse, test_parse_init)
 static void run_all_tests(void)
 {
 	RUN_TEST_CASE(unit_parse, test_parse_init);
+	RUN_TEST_CASE(unit_parse, test_long_chain);
+	RUN_TEST_CASE(unit_parse, test_nesting_too_deep);
+	RUN_TEST_CASE(unit_parse, test_malformed_fails);
 }
 
 int main(int argc, const char * argv[])
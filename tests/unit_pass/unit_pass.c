@@ -0,0 +1,307 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "pass.h"
+#include "jit.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PASS_MAX_VARIABLES			(16)
+#define PASS_MAX_LOG				(16)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What the stand-in passes run over: which of them ran, in order
+ */
+typedef struct
+{
+	uint32_t	pu32_log[PASS_MAX_LOG];
+	uint32_t	u32_num_logged;
+} test_log_t;
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+static uint32_t pass_a(void * p_context)
+{
+	test_log_t * p_log = (test_log_t *)p_context;
+
+	p_log->pu32_log[p_log->u32_num_logged++] = 0;
+
+	return 10;
+}
+
+static uint32_t pass_b(void * p_context)
+{
+	test_log_t * p_log = (test_log_t *)p_context;
+
+	p_log->pu32_log[p_log->u32_num_logged++] = 1;
+
+	return 20;
+}
+
+static uint32_t pass_c(void * p_context)
+{
+	test_log_t * p_log = (test_log_t *)p_context;
+
+	p_log->pu32_log[p_log->u32_num_logged++] = 2;
+
+	return 30;
+}
+
+static const PASS_t pk_test_passes[] =
+{
+	{ "a",		PASS_LEVEL_O0,	pass_a },
+	{ "b",		PASS_LEVEL_O2,	pass_b },
+	{ "c",		PASS_LEVEL_O1,	pass_c },
+	{ "b",		PASS_LEVEL_O2,	pass_b },
+};
+
+#define PASS_NUM_TEST_PASSES		(sizeof(pk_test_passes) / sizeof(pk_test_passes[0]))
+
+/*
+ *	Runs the stand-in passes and returns how many ran, in `p_log`
+ */
+static uint32_t run_passes(PASS_manager_t * p_manager, test_log_t * p_log)
+{
+	p_log->u32_num_logged = 0;
+	PASS_run(p_manager, p_log);
+
+	return p_log->u32_num_logged;
+}
+
+/*
+ *	Reads a variable at its offset in the storage, extended as its type is
+ */
+static int64_t read_variable(const uint64_t * kpu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return (int64_t)BUILTINS_read(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type,
+		(const uint8_t *)kpu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/*
+ *	Generates code at `level`, runs it and checks every variable. Returns how many instructions
+ *	were emitted
+ */
+static uint32_t run_level(PASS_level_t level, const char * kpc_disabled)
+{
+	uint64_t pu64_variables[PASS_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_x = 0x55555556u;
+	JIT_program_t program;
+	uint32_t u32_num_instructions;
+
+	CODE_GEN_init();
+	CODE_GEN_set_opt_level(level);
+
+	if (kpc_disabled != NULL)
+	{
+		TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled(kpc_disabled, false));
+	}
+
+	CODE_GEN_run(PARSE_get_tree_list());
+	u32_num_instructions = CODE_GEN_get_buffer()->u32_num_instructions;
+
+	memcpy((uint8_t *)pu64_variables + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("x")), &ku32_x, sizeof(ku32_x));
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_variables);
+
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "t"));
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "u"));
+	TEST_ASSERT_EQUAL_INT64(2, read_variable(pu64_variables, "v"));
+	TEST_ASSERT_EQUAL_INT64(3, read_variable(pu64_variables, "w"));
+	TEST_ASSERT_EQUAL_INT64(10, read_variable(pu64_variables, "x"));
+	TEST_ASSERT_EQUAL_INT64(98, read_variable(pu64_variables, "y"));
+	TEST_ASSERT_EQUAL_INT64(98, read_variable(pu64_variables, "z"));
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+
+	return u32_num_instructions;
+}
+
+/*
+ *	Whether the code generator's pass of that name ran the last time
+ */
+static bool pass_ran(const char * kpc_name)
+{
+	const PASS_manager_t * kp_manager = CODE_GEN_get_passes();
+
+	for (uint32_t i = 0; i < kp_manager->u32_num_passes; i++)
+	{
+		if (strcmp(kp_manager->kp_passes[i].kpc_name, kpc_name) == 0)
+		{
+			return kp_manager->p_records[i].b_ran;
+		}
+	}
+
+	TEST_FAIL_MESSAGE("No such pass");
+
+	return false;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_pass);
+
+TEST_SETUP(unit_pass)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_pass)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Each level runs what the one below does and more, always in the pipeline's order
+ */
+TEST(unit_pass, test_levels)
+{
+	PASS_manager_t manager;
+	test_log_t log;
+
+	PASS_init_manager(&manager, pk_test_passes, PASS_NUM_TEST_PASSES);
+
+	PASS_set_level(&manager, PASS_LEVEL_O0);
+	TEST_ASSERT_EQUAL(1, run_passes(&manager, &log));
+	TEST_ASSERT_EQUAL(0, log.pu32_log[0]);
+
+	PASS_set_level(&manager, PASS_LEVEL_O1);
+	TEST_ASSERT_EQUAL(2, run_passes(&manager, &log));
+	TEST_ASSERT_EQUAL(0, log.pu32_log[0]);
+	TEST_ASSERT_EQUAL(2, log.pu32_log[1]);
+
+	PASS_set_level(&manager, PASS_LEVEL_O2);
+	TEST_ASSERT_EQUAL(4, run_passes(&manager, &log));
+	TEST_ASSERT_EQUAL(0, log.pu32_log[0]);
+	TEST_ASSERT_EQUAL(1, log.pu32_log[1]);
+	TEST_ASSERT_EQUAL(2, log.pu32_log[2]);
+	TEST_ASSERT_EQUAL(1, log.pu32_log[3]);
+}
+
+/*
+ *	A pass enabled or disabled by name stays that way whatever the level, and so does every other
+ *	run of it. Required passes can't be disabled
+ */
+TEST(unit_pass, test_overrides)
+{
+	PASS_manager_t manager;
+	test_log_t log;
+
+	PASS_init_manager(&manager, pk_test_passes, PASS_NUM_TEST_PASSES);
+
+	TEST_ASSERT_TRUE(PASS_set_enabled(&manager, "b", false));
+	TEST_ASSERT_EQUAL(2, run_passes(&manager, &log));
+	TEST_ASSERT_EQUAL(0, log.pu32_log[0]);
+	TEST_ASSERT_EQUAL(2, log.pu32_log[1]);
+
+	TEST_ASSERT_TRUE(PASS_set_enabled(&manager, "b", true));
+	PASS_set_level(&manager, PASS_LEVEL_O0);
+	TEST_ASSERT_EQUAL(3, run_passes(&manager, &log));
+	TEST_ASSERT_EQUAL(0, log.pu32_log[0]);
+	TEST_ASSERT_EQUAL(1, log.pu32_log[1]);
+	TEST_ASSERT_EQUAL(1, log.pu32_log[2]);
+
+	TEST_ASSERT_FALSE(PASS_set_enabled(&manager, "a", false));
+	TEST_ASSERT_FALSE(PASS_set_enabled(&manager, "d", true));
+	TEST_ASSERT_TRUE(PASS_is_enabled(&manager, 0));
+}
+
+/*
+ *	Every pass records whether it ran and what it changed, and a skipped one took no time
+ */
+TEST(unit_pass, test_records)
+{
+	PASS_manager_t manager;
+	test_log_t log;
+
+	PASS_init_manager(&manager, pk_test_passes, PASS_NUM_TEST_PASSES);
+	PASS_set_level(&manager, PASS_LEVEL_O1);
+	run_passes(&manager, &log);
+
+	TEST_ASSERT_TRUE(manager.p_records[0].b_ran);
+	TEST_ASSERT_EQUAL(10, manager.p_records[0].u32_changed);
+	TEST_ASSERT_FALSE(manager.p_records[1].b_ran);
+	TEST_ASSERT_EQUAL(0, manager.p_records[1].u32_changed);
+	TEST_ASSERT_EQUAL(0, manager.p_records[1].u64_ns);
+	TEST_ASSERT_TRUE(manager.p_records[2].b_ran);
+	TEST_ASSERT_EQUAL(30, manager.p_records[2].u32_changed);
+	TEST_ASSERT_EQUAL(manager.p_records[0].u64_ns + manager.p_records[2].u64_ns, PASS_get_total_ns(&manager));
+}
+
+/*
+ *	Generated code computes the same at every level, and gets no longer as the level goes up
+ */
+TEST(unit_pass, test_code_gen_levels)
+{
+	uint32_t pu32_num_instructions[PASS_LEVEL_NUM_LEVELS];
+
+	// 	test file reads, with x set before it runs:
+	//		t = x * 3;
+	//		u = t + 0;
+	//		u8 v = t;
+	//		w = v + 1;
+	//		x = 10;
+	//		y = x * x - t;
+	//		z = y / 1 + u * 0;
+	parse_file("test_files/unit_pass_0.rep");
+
+	for (uint32_t i = 0; i < PASS_LEVEL_NUM_LEVELS; i++)
+	{
+		pu32_num_instructions[i] = run_level((PASS_level_t)i, NULL);
+	}
+
+	TEST_ASSERT_LESS_THAN(pu32_num_instructions[PASS_LEVEL_O0], pu32_num_instructions[PASS_LEVEL_O1]);
+	TEST_ASSERT_LESS_OR_EQUAL(pu32_num_instructions[PASS_LEVEL_O1], pu32_num_instructions[PASS_LEVEL_O2]);
+
+	// The last run's records are still there after it's deinitialized
+	run_level(PASS_LEVEL_O2, "fold");
+	TEST_ASSERT_FALSE(pass_ran("fold"));
+	TEST_ASSERT_TRUE(pass_ran("gvn"));
+	TEST_ASSERT_TRUE(pass_ran("select"));
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_pass, test_levels);
+	RUN_TEST_CASE(unit_pass, test_overrides);
+	RUN_TEST_CASE(unit_pass, test_records);
+	RUN_TEST_CASE(unit_pass, test_code_gen_levels);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,214 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "peephole.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PEEPHOLE_MAX_VARIABLES			(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+static void assert_instruction(const ASM_instruction_t * kp_instruction, ASM_opcode_t opcode,
+								ASM_operand_kind_t src_kind, uint32_t u32_src, ASM_operand_kind_t dst_kind, uint32_t u32_dst)
+{
+	TEST_ASSERT_EQUAL(opcode, kp_instruction->u8_opcode);
+	TEST_ASSERT_EQUAL(src_kind, kp_instruction->u8_src_kind);
+	TEST_ASSERT_EQUAL_UINT32(u32_src, kp_instruction->u32_src);
+	TEST_ASSERT_EQUAL(dst_kind, kp_instruction->u8_dst_kind);
+	TEST_ASSERT_EQUAL_UINT32(u32_dst, kp_instruction->u32_dst);
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_peephole);
+
+TEST_SETUP(unit_peephole)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_peephole)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	A constant read once becomes an immediate; one read more than that stays a load
+ */
+TEST(unit_peephole, test_fold_immediate)
+{
+	ASM_buffer_t buffer;
+	PEEPHOLE_result_t result;
+
+	ASM_init_buffer(&buffer);
+	PEEPHOLE_init_result(&result);
+
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 5, ASM_OPERAND_VIRTUAL, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 3, ASM_OPERAND_VIRTUAL, 1);
+	ASM_emit(&buffer, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_VIRTUAL, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+
+	PEEPHOLE_run(&buffer, 2, &result);
+
+	TEST_ASSERT_EQUAL(1, result.u32_num_removed);
+	TEST_ASSERT_EQUAL(3, buffer.u32_num_instructions);
+	assert_instruction(&buffer.p_instructions[0], ASM_OPCODE_MOV, ASM_OPERAND_IMMEDIATE, 5, ASM_OPERAND_VIRTUAL, 0);
+	assert_instruction(&buffer.p_instructions[1], ASM_OPCODE_IMUL, ASM_OPERAND_IMMEDIATE, 3, ASM_OPERAND_VIRTUAL, 0);
+	assert_instruction(&buffer.p_instructions[2], ASM_OPCODE_MOV, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Reloading what was just stored reuses the stored register, unless that register is still in use
+ */
+TEST(unit_peephole, test_forward_store)
+{
+	ASM_buffer_t buffer;
+	PEEPHOLE_result_t result;
+
+	ASM_init_buffer(&buffer);
+	PEEPHOLE_init_result(&result);
+
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 1, ASM_OPERAND_VIRTUAL, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 0, ASM_OPERAND_VIRTUAL, 1);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 4, ASM_OPERAND_VIRTUAL, 2);
+	ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 2, ASM_OPERAND_VIRTUAL, 1);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_VARIABLE, 2);
+
+	PEEPHOLE_run(&buffer, 3, &result);
+
+	TEST_ASSERT_EQUAL(2, result.u32_num_removed);
+	TEST_ASSERT_EQUAL(4, buffer.u32_num_instructions);
+	assert_instruction(&buffer.p_instructions[0], ASM_OPCODE_MOV, ASM_OPERAND_VARIABLE, 1, ASM_OPERAND_VIRTUAL, 0);
+	assert_instruction(&buffer.p_instructions[1], ASM_OPCODE_MOV, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+	assert_instruction(&buffer.p_instructions[2], ASM_OPCODE_ADD, ASM_OPERAND_IMMEDIATE, 4, ASM_OPERAND_VIRTUAL, 0);
+	assert_instruction(&buffer.p_instructions[3], ASM_OPCODE_MOV, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 2);
+
+	ASM_deinit_buffer(&buffer);
+
+	// v0 is read again after the store, so v1 can't share it
+	ASM_init_buffer(&buffer);
+	PEEPHOLE_init_result(&result);
+
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 1, ASM_OPERAND_VIRTUAL, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 0, ASM_OPERAND_VIRTUAL, 1);
+	ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VIRTUAL, 1);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_VARIABLE, 2);
+
+	PEEPHOLE_run(&buffer, 2, &result);
+
+	TEST_ASSERT_EQUAL(0, result.u32_num_removed);
+	TEST_ASSERT_EQUAL(5, buffer.u32_num_instructions);
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Once registers are allocated: identities go, zeroing becomes xor, and a reload of the
+ *	register just stored goes
+ */
+TEST(unit_peephole, test_hardware_registers)
+{
+	ASM_buffer_t buffer;
+	PEEPHOLE_result_t result;
+
+	ASM_init_buffer(&buffer);
+	PEEPHOLE_init_result(&result);
+
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASM_emit(&buffer, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, 1, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_STACK, 8);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_STACK, 8, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_STACK, 8, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI);
+	ASM_emit(&buffer, ASM_OPCODE_RET, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+
+	PEEPHOLE_run(&buffer, 0, &result);
+
+	TEST_ASSERT_EQUAL(4, result.u32_num_removed);
+	TEST_ASSERT_EQUAL(1, result.u32_num_rewritten);
+	TEST_ASSERT_EQUAL(4, buffer.u32_num_instructions);
+	assert_instruction(&buffer.p_instructions[0], ASM_OPCODE_XOR, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX);
+	assert_instruction(&buffer.p_instructions[1], ASM_OPCODE_MOV, ASM_OPERAND_REGISTER, ASM_REGISTER_RCX, ASM_OPERAND_STACK, 8);
+	assert_instruction(&buffer.p_instructions[2], ASM_OPCODE_MOV, ASM_OPERAND_STACK, 8, ASM_OPERAND_REGISTER, ASM_REGISTER_RSI);
+	assert_instruction(&buffer.p_instructions[3], ASM_OPCODE_RET, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	A whole program shrinks and still computes the same values
+ */
+TEST(unit_peephole, test_program_unchanged)
+{
+	uint32_t pu32_variables[PEEPHOLE_MAX_VARIABLES] = { 0 };
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		x = 0;
+	//		y = 7 * 1 + 0;
+	//		z = y * 5 - 3;
+	//		w = z + z / y;
+	//		v = x - (w - 300 + 0);
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_peephole_0.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_GREATER_THAN(0, CODE_GEN_get_peephole_result()->u32_num_removed);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(0, pu32_variables[SYMBOL_TABLE_lookup("x")]);
+	TEST_ASSERT_EQUAL_UINT32(7, pu32_variables[SYMBOL_TABLE_lookup("y")]);
+	TEST_ASSERT_EQUAL_UINT32(32, pu32_variables[SYMBOL_TABLE_lookup("z")]);
+	TEST_ASSERT_EQUAL_UINT32(36, pu32_variables[SYMBOL_TABLE_lookup("w")]);
+	TEST_ASSERT_EQUAL_UINT32(264, pu32_variables[SYMBOL_TABLE_lookup("v")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_peephole, test_fold_immediate);
+	RUN_TEST_CASE(unit_peephole, test_forward_store);
+	RUN_TEST_CASE(unit_peephole, test_hardware_registers);
+	RUN_TEST_CASE(unit_peephole, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,304 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "promote.h"
+#include "regalloc.h"
+#include "jit.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define PROMOTE_MAX_VARIABLES		(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Generates code with or without promotion, value numbering off so that every statement reads
+ *	its variables again
+ */
+static void generate(bool b_promote)
+{
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("gvn", false));
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("promote", b_promote));
+	CODE_GEN_run(PARSE_get_tree_list());
+}
+
+/*
+ *	Operands that read or write a variable's memory, of one variable or of any if it's SYMBOL_TABLE_INDEX_NONE
+ */
+static uint32_t count_memory_operands(const ASM_buffer_t * kp_buffer, uint32_t u32_variable)
+{
+	const ASM_instruction_t * kp_instruction;
+	uint32_t u32_count = 0;
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_VARIABLE && (u32_variable == SYMBOL_TABLE_INDEX_NONE || kp_instruction->u32_src == u32_variable))
+		{
+			u32_count++;
+		}
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_VARIABLE && (u32_variable == SYMBOL_TABLE_INDEX_NONE || kp_instruction->u32_dst == u32_variable))
+		{
+			u32_count++;
+		}
+	}
+
+	return u32_count;
+}
+
+static void write_variable(uint64_t * pu64_storage, const char * kpc_name, uint64_t u64_value)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	memcpy((uint8_t *)pu64_storage + SYMBOL_TABLE_get_offset(u32_symbol), &u64_value,
+		BUILTINS_get_size(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type));
+}
+
+static uint64_t read_variable(const uint64_t * kpu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return BUILTINS_read(SYMBOL_TABLE_get_symbol_table()[u32_symbol].builtin_type,
+		(const uint8_t *)kpu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/*
+ *	Runs the generated code over x and y
+ */
+static void run(uint64_t * pu64_variables, uint32_t u32_x, uint32_t u32_y)
+{
+	JIT_program_t program;
+
+	write_variable(pu64_variables, "x", u32_x);
+
+	if (SYMBOL_TABLE_lookup("y") != SYMBOL_TABLE_INDEX_NONE)
+	{
+		write_variable(pu64_variables, "y", u32_y);
+	}
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_variables);
+	JIT_release(&program);
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_promote);
+
+TEST_SETUP(unit_promote)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_promote)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Variables used in every statement are loaded once and stored once, and hold callee-saved
+ *	registers in between
+ */
+TEST(unit_promote, test_memory_traffic_drops)
+{
+	const PROMOTE_result_t * kp_result;
+	uint32_t u32_unpromoted;
+
+	// 	test file reads:
+	//		s = x + y;
+	//		t = s * x + y;
+	//		s = s + t - x;
+	//		t = t - s * y;
+	//		s = s * t + x;
+	//		t = t + s + y;
+	//		s = s - t;
+	parse_file("test_files/unit_promote_0.rep");
+
+	generate(false);
+	u32_unpromoted = count_memory_operands(CODE_GEN_get_buffer(), SYMBOL_TABLE_INDEX_NONE);
+	TEST_ASSERT_EQUAL(0, CODE_GEN_get_promote_result()->u32_num_promoted);
+	CODE_GEN_deinit();
+
+	generate(true);
+	kp_result = CODE_GEN_get_promote_result();
+
+	// x and y are loaded on entry, s and t stored on exit
+	TEST_ASSERT_EQUAL(4, kp_result->u32_num_promoted);
+	TEST_ASSERT_EQUAL(4, count_memory_operands(CODE_GEN_get_buffer(), SYMBOL_TABLE_INDEX_NONE));
+	TEST_ASSERT_GREATER_OR_EQUAL(5 * 4, u32_unpromoted);
+	TEST_ASSERT_EQUAL((1u << ASM_REGISTER_RBX) | (1u << ASM_REGISTER_R12) | (1u << ASM_REGISTER_R13) | (1u << ASM_REGISTER_R14),
+		kp_result->u32_reserved);
+	TEST_ASSERT_EQUAL(ASM_OPCODE_PUSH, CODE_GEN_get_buffer()->p_instructions[0].u8_opcode);
+	TEST_ASSERT_EQUAL(ASM_REGISTER_RBX, CODE_GEN_get_buffer()->p_instructions[0].u32_src);
+
+	CODE_GEN_deinit();
+}
+
+/*
+ *	Variables whose entry value is read start with it, and every variable ends with its value
+ */
+TEST(unit_promote, test_program_unchanged)
+{
+	uint64_t pu64_variables[PROMOTE_MAX_VARIABLES];
+	const uint32_t ku32_x = 0x9E3779B9u;
+	const uint32_t ku32_y = 77;
+	uint32_t s, t;
+
+	parse_file("test_files/unit_promote_0.rep");
+
+	s = ku32_x + ku32_y;
+	t = s * ku32_x + ku32_y;
+	s = s + t - ku32_x;
+	t = t - s * ku32_y;
+	s = s * t + ku32_x;
+	t = t + s + ku32_y;
+	s = s - t;
+
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		memset(pu64_variables, 0, sizeof(pu64_variables));
+		generate(i == 1);
+		run(pu64_variables, ku32_x, ku32_y);
+
+		TEST_ASSERT_EQUAL_UINT64(s, read_variable(pu64_variables, "s"));
+		TEST_ASSERT_EQUAL_UINT64(t, read_variable(pu64_variables, "t"));
+		TEST_ASSERT_EQUAL_UINT64(ku32_x, read_variable(pu64_variables, "x"));
+		TEST_ASSERT_EQUAL_UINT64(ku32_y, read_variable(pu64_variables, "y"));
+
+		CODE_GEN_deinit();
+	}
+}
+
+/*
+ *	Narrow variables stay in memory; 64-bit ones are promoted whole
+ */
+TEST(unit_promote, test_narrow_variables_stay)
+{
+	uint64_t pu64_variables[PROMOTE_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_x = 0xFFFFFF01u;
+	uint8_t n;
+	int64_t w;
+	uint32_t x;
+
+	// 	test file reads:
+	//		u8 n = x;
+	//		i64 w = x;
+	//		n = n + 1;
+	//		w = w * w + n;
+	//		n = n * 3;
+	//		w = w - n;
+	//		n = n + w;
+	//		w = w + 1;
+	//		x = n + w;
+	parse_file("test_files/unit_promote_1.rep");
+
+	n = (uint8_t)ku32_x;
+	w = (int64_t)ku32_x;
+	n = (uint8_t)(n + 1);
+	w = (int64_t)((uint64_t)w * (uint64_t)w + n);
+	n = (uint8_t)(n * 3);
+	w = w - n;
+	n = (uint8_t)(n + w);
+	w = w + 1;
+	x = (uint32_t)(n + w);
+
+	generate(true);
+
+	TEST_ASSERT_NOT_EQUAL(0, count_memory_operands(CODE_GEN_get_buffer(), SYMBOL_TABLE_lookup("n")));
+	TEST_ASSERT_EQUAL(1, count_memory_operands(CODE_GEN_get_buffer(), SYMBOL_TABLE_lookup("w")));
+
+	run(pu64_variables, ku32_x, 0);
+
+	TEST_ASSERT_EQUAL_UINT64(n, read_variable(pu64_variables, "n"));
+	TEST_ASSERT_EQUAL_UINT64((uint64_t)w, read_variable(pu64_variables, "w"));
+	TEST_ASSERT_EQUAL_UINT64(x, read_variable(pu64_variables, "x"));
+
+	CODE_GEN_deinit();
+}
+
+/*
+ *	Only as many are promoted as leave the allocator a register for everything live at once
+ */
+TEST(unit_promote, test_register_pressure)
+{
+	const uint32_t ku32_num_variables = 4;
+	const uint32_t pku32_num_live[] = { 4, 9, 10, 12 };
+	const uint32_t pku32_num_promoted[] = { 4, 3, 2, 0 };
+	PROMOTE_result_t result;
+	REGALLOC_result_t regalloc_result;
+	ASM_buffer_t buffer;
+	uint32_t u32_num_live;
+
+	// Only for its four u32 variables
+	parse_file("test_files/unit_promote_0.rep");
+
+	for (uint32_t i = 0; i < sizeof(pku32_num_live) / sizeof(pku32_num_live[0]); i++)
+	{
+		u32_num_live = pku32_num_live[i];
+		ASM_init_buffer(&buffer);
+
+		// Every variable read and written six times, then u32_num_live values live at once
+		for (uint32_t j = 0; j < 6 * ku32_num_variables; j++)
+		{
+			ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, j % ku32_num_variables, ASM_OPERAND_VIRTUAL, 0);
+			ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, j % ku32_num_variables);
+		}
+		for (uint32_t j = 0; j < u32_num_live; j++)
+		{
+			ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, j % ku32_num_variables, ASM_OPERAND_VIRTUAL, j + 1);
+		}
+		for (uint32_t j = 1; j < u32_num_live; j++)
+		{
+			ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, j + 1, ASM_OPERAND_VIRTUAL, 1);
+		}
+		ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_VARIABLE, 0);
+
+		PROMOTE_run(&buffer, u32_num_live + 1, ku32_num_variables, &result);
+		TEST_ASSERT_EQUAL(pku32_num_promoted[i], result.u32_num_promoted);
+
+		REGALLOC_run(&buffer, u32_num_live + 1, result.u32_reserved, &regalloc_result);
+		TEST_ASSERT_EQUAL(0, regalloc_result.u32_num_spilled);
+
+		ASM_deinit_buffer(&buffer);
+	}
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_promote, test_memory_traffic_drops);
+	RUN_TEST_CASE(unit_promote, test_program_unchanged);
+	RUN_TEST_CASE(unit_promote, test_narrow_variables_stay);
+	RUN_TEST_CASE(unit_promote, test_register_pressure);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,247 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "reassoc.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define REASSOC_OUTPUT_FILE			"test_files/unit_reassoc_output.ir"
+#define REASSOC_MAX_OUTPUT_SIZE		(4096)
+#define REASSOC_MAX_VARIABLES		(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file, reassociates it if asked to and returns the result as text. Points
+ *	into a static buffer
+ */
+static const char * reassociate(bool b_run, REASSOC_report_t * p_report)
+{
+	static char pc_text[REASSOC_MAX_OUTPUT_SIZE];
+	IR_program_t program;
+	FILE * file;
+	size_t size;
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+
+	if (b_run)
+	{
+		REASSOC_run(&program, p_report);
+	}
+
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(&program, REASSOC_OUTPUT_FILE));
+	IR_deinit_program(&program);
+
+	file = fopen(REASSOC_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(REASSOC_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+/*
+ *	Generates code for the parsed file, with reassociation or without, and runs it over the
+ *	inputs. Layout is left out so both runs keep variables in the same place
+ */
+static void run_program(bool b_reassociate, const uint32_t * kpu32_inputs, const char * const * kppc_names,
+	uint32_t u32_num_inputs, uint64_t * pu64_storage)
+{
+	JIT_program_t program;
+
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("reassoc", b_reassociate));
+	CODE_GEN_run(PARSE_get_tree_list());
+	TEST_ASSERT_EQUAL(b_reassociate ? 5 : 0, CODE_GEN_get_reassoc_report()->u32_num_chains);
+
+	memset(pu64_storage, 0, sizeof(uint64_t) * REASSOC_MAX_VARIABLES);
+
+	for (uint32_t i = 0; i < u32_num_inputs; i++)
+	{
+		memcpy((uint8_t *)pu64_storage + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup(kppc_names[i])), &kpu32_inputs[i], sizeof(uint32_t));
+	}
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_storage);
+	JIT_release(&program);
+	CODE_GEN_deinit();
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_reassoc);
+
+TEST_SETUP(unit_reassoc)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_reassoc)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Eight operands summed one after the other become a tree three adds deep
+ */
+TEST(unit_reassoc, test_sum_balanced)
+{
+	REASSOC_report_t report;
+
+	// 	test file reads:
+	//		x = a + b + c + d + e + f + g + h;
+	parse_file("test_files/unit_reassoc_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%0 = load a\n"
+		"%1 = load b\n"
+		"%3 = load c\n"
+		"%5 = load d\n"
+		"%7 = load e\n"
+		"%9 = load f\n"
+		"%11 = load g\n"
+		"%13 = load h\n"
+		"%2 = add %0, %1\n"
+		"%4 = add %3, %5\n"
+		"%6 = add %7, %9\n"
+		"%8 = add %11, %13\n"
+		"%10 = add %2, %4\n"
+		"%12 = add %6, %8\n"
+		"%14 = add %10, %12\n"
+		"store x, %14\n",
+		reassociate(true, &report));
+
+	TEST_ASSERT_EQUAL(1, report.u32_num_chains);
+	TEST_ASSERT_EQUAL(8, report.u32_num_operands);
+
+	// Loads ready after 5 cycles, then seven adds in a row or three
+	TEST_ASSERT_EQUAL(12, report.u32_height_before);
+	TEST_ASSERT_EQUAL(8, report.u32_height_after);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Constants apart in the source are brought together and folded, and the multiplies balanced
+ */
+TEST(unit_reassoc, test_product_constants_folded)
+{
+	REASSOC_report_t report;
+
+	// 	test file reads:
+	//		y = 3 * a * b * 5 * c * d;
+	parse_file("test_files/unit_reassoc_1.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%1 = load a\n"
+		"%3 = load b\n"
+		"%7 = load c\n"
+		"%9 = load d\n"
+		"%2 = const 15\n"
+		"%4 = mul %1, %2\n"
+		"%6 = mul %3, %7\n"
+		"%8 = mul %9, %4\n"
+		"%10 = mul %6, %8\n"
+		"store y, %10\n",
+		reassociate(true, &report));
+
+	TEST_ASSERT_EQUAL(1, report.u32_num_chains);
+	TEST_ASSERT_EQUAL(6, report.u32_num_operands);
+	TEST_ASSERT_EQUAL(1, report.u32_num_folded);
+	TEST_ASSERT_EQUAL(5 + (5 * 3), report.u32_height_before);
+	TEST_ASSERT_EQUAL(5 + (3 * 3), report.u32_height_after);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Three operands ready together take two steps whatever the order, and an add feeding a
+ *	multiply isn't part of its chain: nothing changes
+ */
+TEST(unit_reassoc, test_short_chains_unchanged)
+{
+	static char pc_lowered[REASSOC_MAX_OUTPUT_SIZE];
+	REASSOC_report_t report;
+
+	// 	test file reads:
+	//		x = a + b + c;
+	//		y = a * (b + c);
+	parse_file("test_files/unit_reassoc_2.rep");
+	strcpy(pc_lowered, reassociate(false, &report));
+
+	TEST_ASSERT_EQUAL_STRING(pc_lowered, reassociate(true, &report));
+	TEST_ASSERT_EQUAL(0, report.u32_num_chains);
+	TEST_ASSERT_EQUAL(0, report.u32_height_before);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Wrapping at 32 or 64 bits, signed or not, every variable ends up with the value it would
+ *	have had
+ */
+TEST(unit_reassoc, test_program_unchanged)
+{
+	static const char * const kppc_names[] = { "a", "b", "c", "d", "e", "f" };
+	static const uint32_t ku32_inputs[] = { 0xDEADBEEFu, 0x9E3779B9u, 7u, 0xFFFFFFFFu, 0x80000001u, 12345u };
+	uint64_t pu64_reassociated[REASSOC_MAX_VARIABLES];
+	uint64_t pu64_original[REASSOC_MAX_VARIABLES];
+
+	// 	test file reads, with a to f set before it runs:
+	//		x = a + b + c + d + e + f;
+	//		u64 w = a * b * c * d * e * f;
+	//		i64 s = a * b * c * d * e * f * 4294967295 + a + b + 9;
+	//		i32 m = (a + b) * (c + d) * (e + f) + 2147483647 + 1;
+	parse_file("test_files/unit_reassoc_3.rep");
+
+	run_program(false, ku32_inputs, kppc_names, 6, pu64_original);
+	run_program(true, ku32_inputs, kppc_names, 6, pu64_reassociated);
+
+	TEST_ASSERT_EQUAL_UINT64_ARRAY(pu64_original, pu64_reassociated, REASSOC_MAX_VARIABLES);
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_reassoc, test_sum_balanced);
+	RUN_TEST_CASE(unit_reassoc, test_product_constants_folded);
+	RUN_TEST_CASE(unit_reassoc, test_short_chains_unchanged);
+	RUN_TEST_CASE(unit_reassoc, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,281 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "regalloc.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define REGALLOC_NUM_HARDWARE_REGISTERS		(13)	// Everything but rsp, rdi and rax
+#define REGALLOC_MAX_VARIABLES				(64)
+#define REGALLOC_IS_MEMORY_KIND(kind)		((kind) == ASM_OPERAND_VARIABLE || (kind) == ASM_OPERAND_STACK)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	`u32_num_live` constants that are all live at once, then summed into the first
+ */
+static void emit_wide_sum(ASM_buffer_t * p_buffer, uint32_t u32_num_live)
+{
+	for (uint32_t i = 0; i < u32_num_live; i++)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, i, ASM_OPERAND_VIRTUAL, i);
+	}
+
+	for (uint32_t i = 1; i < u32_num_live; i++)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VIRTUAL, 0);
+	}
+
+	ASM_emit(p_buffer, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_VIRTUAL, 0);
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_VARIABLE, 0);
+}
+
+/*
+ *	Every operand is a real location, and every instruction is one x86 can encode
+ */
+static void assert_rewritten_legally(const ASM_buffer_t * kp_buffer)
+{
+	const ASM_instruction_t * kp_instruction;
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		kp_instruction = &kp_buffer->p_instructions[i];
+
+		TEST_ASSERT_NOT_EQUAL(ASM_OPERAND_VIRTUAL, kp_instruction->u8_src_kind);
+		TEST_ASSERT_NOT_EQUAL(ASM_OPERAND_VIRTUAL, kp_instruction->u8_dst_kind);
+		TEST_ASSERT_FALSE(REGALLOC_IS_MEMORY_KIND(kp_instruction->u8_src_kind) && REGALLOC_IS_MEMORY_KIND(kp_instruction->u8_dst_kind));
+
+		if (kp_instruction->u8_opcode == ASM_OPCODE_IMUL)
+		{
+			TEST_ASSERT_EQUAL(ASM_OPERAND_REGISTER, kp_instruction->u8_dst_kind);
+		}
+
+		if (kp_instruction->u8_src_kind == ASM_OPERAND_REGISTER)
+		{
+			TEST_ASSERT_NOT_EQUAL(ASM_REGISTER_RSP, kp_instruction->u32_src);
+			TEST_ASSERT_NOT_EQUAL(ASM_VARIABLE_BASE_REGISTER, kp_instruction->u32_src);
+		}
+	}
+}
+
+/*
+ *	Allocatable registers written anywhere in the buffer
+ */
+static uint32_t count_distinct_registers(const ASM_buffer_t * kp_buffer)
+{
+	bool pb_seen[ASM_REGISTER_NUM_REGISTERS] = { false };
+	uint32_t u32_count = 0;
+
+	for (uint32_t i = 0; i < kp_buffer->u32_num_instructions; i++)
+	{
+		if (kp_buffer->p_instructions[i].u8_dst_kind == ASM_OPERAND_REGISTER && kp_buffer->p_instructions[i].u32_dst != REGALLOC_SPILL_REGISTER &&
+			!pb_seen[kp_buffer->p_instructions[i].u32_dst])
+		{
+			pb_seen[kp_buffer->p_instructions[i].u32_dst] = true;
+			u32_count++;
+		}
+	}
+
+	return u32_count;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_regalloc);
+
+TEST_SETUP(unit_regalloc)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_regalloc)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	As many values as there are registers fit without touching the stack
+ */
+TEST(unit_regalloc, test_no_spill_within_register_count)
+{
+	ASM_buffer_t buffer;
+	REGALLOC_result_t result;
+
+	ASM_init_buffer(&buffer);
+	emit_wide_sum(&buffer, REGALLOC_NUM_HARDWARE_REGISTERS);
+
+	REGALLOC_run(&buffer, REGALLOC_NUM_HARDWARE_REGISTERS, 0, &result);
+
+	TEST_ASSERT_EQUAL(0, result.u32_num_spilled);
+	TEST_ASSERT_EQUAL(0, result.u32_frame_size);
+	TEST_ASSERT_EQUAL(REGALLOC_NUM_HARDWARE_REGISTERS, count_distinct_registers(&buffer));
+	assert_rewritten_legally(&buffer);
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Eight more than that spill exactly eight values, and keep every register busy
+ */
+TEST(unit_regalloc, test_spill_when_out_of_registers)
+{
+	ASM_buffer_t buffer;
+	REGALLOC_result_t result;
+	const uint32_t ku32_num_live = REGALLOC_NUM_HARDWARE_REGISTERS + 8;
+
+	ASM_init_buffer(&buffer);
+	emit_wide_sum(&buffer, ku32_num_live);
+
+	REGALLOC_run(&buffer, ku32_num_live, 0, &result);
+
+	TEST_ASSERT_EQUAL(8, result.u32_num_spilled);
+	TEST_ASSERT_EQUAL(8 * REGALLOC_SLOT_SIZE, result.u32_frame_size);
+	TEST_ASSERT_EQUAL(REGALLOC_NUM_HARDWARE_REGISTERS, count_distinct_registers(&buffer));
+	assert_rewritten_legally(&buffer);
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Reserved registers are never handed out, so what no longer fits spills
+ */
+TEST(unit_regalloc, test_reserved_registers_left_alone)
+{
+	ASM_buffer_t buffer;
+	REGALLOC_result_t result;
+	const uint32_t ku32_reserved = (1u << ASM_REGISTER_RBX) | (1u << ASM_REGISTER_R12);
+	const ASM_instruction_t * kp_instruction;
+
+	ASM_init_buffer(&buffer);
+	emit_wide_sum(&buffer, REGALLOC_NUM_HARDWARE_REGISTERS);
+
+	REGALLOC_run(&buffer, REGALLOC_NUM_HARDWARE_REGISTERS, ku32_reserved, &result);
+
+	TEST_ASSERT_EQUAL(2, result.u32_num_spilled);
+	TEST_ASSERT_EQUAL(REGALLOC_NUM_HARDWARE_REGISTERS - 2, count_distinct_registers(&buffer));
+	assert_rewritten_legally(&buffer);
+
+	for (uint32_t i = 0; i < buffer.u32_num_instructions; i++)
+	{
+		kp_instruction = &buffer.p_instructions[i];
+
+		if (kp_instruction->u8_dst_kind == ASM_OPERAND_REGISTER)
+		{
+			TEST_ASSERT_EQUAL(0, ku32_reserved & (1u << kp_instruction->u32_dst));
+		}
+	}
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Nothing live across a div may sit in edx, which the div sequence clobbers
+ */
+TEST(unit_regalloc, test_rdx_avoided_across_div)
+{
+	ASM_buffer_t buffer;
+	REGALLOC_result_t result;
+	const uint32_t ku32_num_live = 8;
+	const ASM_instruction_t * kp_instruction;
+
+	ASM_init_buffer(&buffer);
+
+	for (uint32_t i = 0; i < ku32_num_live; i++)
+	{
+		ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_IMMEDIATE, i + 1, ASM_OPERAND_VIRTUAL, i);
+	}
+
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASM_emit(&buffer, ASM_OPCODE_XOR, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX);
+	ASM_emit(&buffer, ASM_OPCODE_DIV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, 1, ASM_OPERAND_NONE, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX, ASM_OPERAND_VIRTUAL, 0);
+
+	for (uint32_t i = 1; i < ku32_num_live; i++)
+	{
+		ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VIRTUAL, 0);
+	}
+
+	REGALLOC_run(&buffer, ku32_num_live, 0, &result);
+
+	TEST_ASSERT_EQUAL(0, result.u32_num_spilled);
+
+	for (uint32_t i = 0; i < buffer.u32_num_instructions; i++)
+	{
+		kp_instruction = &buffer.p_instructions[i];
+
+		if (kp_instruction->u8_opcode == ASM_OPCODE_ADD)
+		{
+			TEST_ASSERT_NOT_EQUAL(ASM_REGISTER_RDX, kp_instruction->u32_src);
+			TEST_ASSERT_NOT_EQUAL(ASM_REGISTER_RDX, kp_instruction->u32_dst);
+		}
+	}
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	Expressions far wider than the register file compile and compute the right values
+ */
+TEST(unit_regalloc, test_wide_expressions_run)
+{
+	uint32_t pu32_variables[REGALLOC_MAX_VARIABLES] = { 0 };
+	JIT_program_t program;
+
+	// 	test file reads:
+	//		a = 1 + 2 + ... + 40;
+	//		b = a / 3 + (a / 1) + (a / 2) + ... + (a / 24);
+	//		c = (b - 1) * (b - 2) * ... * (b - 30);
+	TEST_ASSERT_EQUAL(STATUS_OK, IO_HANDLER_load_source_file("test_files/unit_regalloc_0.rep"));
+	TEST_ASSERT_EQUAL(STATUS_OK, LEX_init());
+	LEX_run_fsm();
+	PARSE_init();
+	PARSE_run_rdp();
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(820, pu32_variables[SYMBOL_TABLE_lookup("a")]);
+	TEST_ASSERT_EQUAL_UINT32(3363, pu32_variables[SYMBOL_TABLE_lookup("b")]);
+	TEST_ASSERT_EQUAL_UINT32(536870912, pu32_variables[SYMBOL_TABLE_lookup("c")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_regalloc, test_no_spill_within_register_count);
+	RUN_TEST_CASE(unit_regalloc, test_spill_when_out_of_registers);
+	RUN_TEST_CASE(unit_regalloc, test_reserved_registers_left_alone);
+	RUN_TEST_CASE(unit_regalloc, test_rdx_avoided_across_div);
+	RUN_TEST_CASE(unit_regalloc, test_wide_expressions_run);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,254 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "schedule.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define SCHEDULE_MAX_VARIABLES			(32)
+#define SCHEDULE_NUM_CHAINS				(6)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+static uint32_t * variable(uint64_t * pu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return (uint32_t *)((uint8_t *)pu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/*
+ *	Compiles the parsed file, with or without scheduling, and runs it with the inputs given
+ */
+static void compile_and_run(bool b_schedule, uint64_t * pu64_variables, const char * const * kpkpc_names, const uint32_t * kpu32_values,
+							uint32_t u32_num_inputs)
+{
+	JIT_program_t program;
+
+	CODE_GEN_init();
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("schedule", b_schedule));
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	if (b_schedule)
+	{
+		TEST_ASSERT_GREATER_THAN(0, CODE_GEN_get_schedule_result()->u32_num_moved);
+	}
+
+	// Layout has placed the variables by now
+	for (uint32_t i = 0; i < u32_num_inputs; i++)
+	{
+		*variable(pu64_variables, kpkpc_names[i]) = kpu32_values[i];
+	}
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_variables);
+	JIT_release(&program);
+}
+
+/*
+ *	Independent chains, each loading a variable, multiplying it by itself and storing it elsewhere
+ */
+static void emit_chains(ASM_buffer_t * p_buffer)
+{
+	for (uint32_t i = 0; i < SCHEDULE_NUM_CHAINS; i++)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, i, ASM_OPERAND_VIRTUAL, i);
+		ASM_emit(p_buffer, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VIRTUAL, i);
+		ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VARIABLE, i + SCHEDULE_NUM_CHAINS);
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_schedule);
+
+TEST_SETUP(unit_schedule)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_schedule)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Independent chains overlap, each chain keeps its order, and a divide's run through rax and rdx
+ *	stays in one piece
+ */
+TEST(unit_schedule, test_chains_overlap)
+{
+	ASM_buffer_t buffer;
+	SCHEDULE_result_t result;
+	uint32_t u32_div;
+
+	ASM_init_buffer(&buffer);
+	emit_chains(&buffer);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 20, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	ASM_emit(&buffer, ASM_OPCODE_XOR, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX);
+	ASM_emit(&buffer, ASM_OPCODE_DIV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, 21, ASM_OPERAND_NONE, 0);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX, ASM_OPERAND_VARIABLE, 22);
+
+	SCHEDULE_run(&buffer, SCHEDULE_NUM_CHAINS, 16, &result);
+
+	TEST_ASSERT_EQUAL(SCHEDULE_NUM_CHAINS * 3 + 1, result.u32_num_units);
+	TEST_ASSERT_GREATER_THAN(0, result.u32_num_moved);
+	TEST_ASSERT_LESS_THAN(result.u32_cycles_before, result.u32_cycles_after);
+	TEST_ASSERT_GREATER_THAN(1, result.u32_max_live);
+
+	// The divide is the longest, so it goes first
+	TEST_ASSERT_EQUAL(ASM_OPCODE_MOV, buffer.p_instructions[0].u8_opcode);
+	TEST_ASSERT_EQUAL(ASM_OPERAND_REGISTER, buffer.p_instructions[0].u8_dst_kind);
+	for (u32_div = 0; buffer.p_instructions[u32_div].u8_opcode != ASM_OPCODE_DIV; u32_div++);
+	TEST_ASSERT_EQUAL(ASM_OPCODE_XOR, buffer.p_instructions[u32_div - 1].u8_opcode);
+	TEST_ASSERT_EQUAL(ASM_OPCODE_MOV, buffer.p_instructions[u32_div + 1].u8_opcode);
+	TEST_ASSERT_EQUAL(22, buffer.p_instructions[u32_div + 1].u32_dst);
+
+	for (uint32_t i = 0; i < SCHEDULE_NUM_CHAINS; i++)
+	{
+		uint32_t u32_load = UINT32_MAX;
+		uint32_t u32_store = UINT32_MAX;
+
+		for (uint32_t j = 0; j < buffer.u32_num_instructions; j++)
+		{
+			if (buffer.p_instructions[j].u8_src_kind == ASM_OPERAND_VARIABLE && buffer.p_instructions[j].u32_src == i)
+			{
+				u32_load = j;
+			}
+			if (buffer.p_instructions[j].u8_dst_kind == ASM_OPERAND_VARIABLE && buffer.p_instructions[j].u32_dst == i + SCHEDULE_NUM_CHAINS)
+			{
+				u32_store = j;
+			}
+		}
+		TEST_ASSERT_LESS_THAN(u32_store, u32_load);
+	}
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	With registers for only one chain at a time, the chains don't overlap at all
+ */
+TEST(unit_schedule, test_pressure_kept)
+{
+	ASM_buffer_t buffer;
+	SCHEDULE_result_t result;
+
+	ASM_init_buffer(&buffer);
+	emit_chains(&buffer);
+
+	SCHEDULE_run(&buffer, SCHEDULE_NUM_CHAINS, 1, &result);
+
+	TEST_ASSERT_EQUAL(1, result.u32_max_live);
+
+	for (uint32_t i = 0; i < SCHEDULE_NUM_CHAINS; i++)
+	{
+		TEST_ASSERT_EQUAL(ASM_OPCODE_IMUL, buffer.p_instructions[3 * i + 1].u8_opcode);
+		TEST_ASSERT_EQUAL(buffer.p_instructions[3 * i].u32_dst, buffer.p_instructions[3 * i + 1].u32_dst);
+		TEST_ASSERT_EQUAL(buffer.p_instructions[3 * i].u32_dst, buffer.p_instructions[3 * i + 2].u32_src);
+	}
+
+	ASM_deinit_buffer(&buffer);
+}
+
+/*
+ *	A long product and a long sum, balanced, where the priorities would pick an order the
+ *	estimate says is slower: it is not kept
+ */
+TEST(unit_schedule, test_slower_order_dropped)
+{
+	const SCHEDULE_result_t * kp_result;
+
+	// 	test file reads:
+	//		p = a0 * a1 * ... * a39;
+	//		s = b0 + b1 + ... + b39;
+	parse_file("test_files/unit_schedule_1.rep");
+
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	kp_result = CODE_GEN_get_schedule_result();
+	TEST_ASSERT_LESS_OR_EQUAL(kp_result->u32_cycles_before, kp_result->u32_cycles_after);
+
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/*
+ *	Through the whole pipeline, the scheduled code computes what the code in selection order does
+ */
+TEST(unit_schedule, test_program_unchanged)
+{
+	uint64_t pu64_scheduled[SCHEDULE_MAX_VARIABLES] = { 0 };
+	uint64_t pu64_in_order[SCHEDULE_MAX_VARIABLES] = { 0 };
+	const char * const kpkpc_names[] = { "x", "y", "z", "p", "q", "r", "s", "m", "n", "o" };
+	const uint32_t ku32_values[] = { 0xFFFFFFF0u, 3, 5, 7, 0x10001u, 11, 13, 0x80000000u, 0x7FFFFFFFu, 17 };
+	const char * const kpkpc_outputs[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+	uint32_t pu32_scheduled[sizeof(kpkpc_outputs) / sizeof(kpkpc_outputs[0])];
+	uint32_t u32_num_inputs = sizeof(ku32_values) / sizeof(ku32_values[0]);
+
+	// 	test file reads:
+	//		a = x / y;
+	//		b = a / z;
+	//		c = p * q * r * s;
+	//		...
+	parse_file("test_files/unit_schedule_0.rep");
+
+	// Read back before the next run lays the variables out again
+	compile_and_run(true, pu64_scheduled, kpkpc_names, ku32_values, u32_num_inputs);
+	TEST_ASSERT_EQUAL_HEX32(0xFFFFFFF0u / 3 / 5, *variable(pu64_scheduled, "b"));
+
+	for (uint32_t i = 0; i < sizeof(kpkpc_outputs) / sizeof(kpkpc_outputs[0]); i++)
+	{
+		pu32_scheduled[i] = *variable(pu64_scheduled, kpkpc_outputs[i]);
+	}
+	CODE_GEN_deinit();
+
+	compile_and_run(false, pu64_in_order, kpkpc_names, ku32_values, u32_num_inputs);
+
+	for (uint32_t i = 0; i < sizeof(kpkpc_outputs) / sizeof(kpkpc_outputs[0]); i++)
+	{
+		TEST_ASSERT_EQUAL_HEX32(*variable(pu64_in_order, kpkpc_outputs[i]), pu32_scheduled[i]);
+	}
+	CODE_GEN_deinit();
+
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_schedule, test_chains_overlap);
+	RUN_TEST_CASE(unit_schedule, test_pressure_kept);
+	RUN_TEST_CASE(unit_schedule, test_slower_order_dropped);
+	RUN_TEST_CASE(unit_schedule, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,230 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "ir.h"
+#include "slp.h"
+#include "jit.h"
+#include "builtins.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define SLP_OUTPUT_FILE				"test_files/unit_slp_output.ir"
+#define SLP_MAX_OUTPUT_SIZE			(4096)
+#define SLP_MAX_VARIABLES			(16)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers the parsed file and vectorizes it straight away, and returns what's left as text. Points
+ *	into a static buffer
+ */
+static const char * vectorize(SLP_report_t * p_report)
+{
+	static char pc_text[SLP_MAX_OUTPUT_SIZE];
+	IR_program_t program;
+	FILE * file;
+	size_t size;
+
+	IR_init_program(&program);
+	IR_lower(PARSE_get_tree_list(), &program);
+	SLP_run(&program, SYMBOL_TABLE_get_num_symbols(), p_report);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+	TEST_ASSERT_EQUAL(STATUS_OK, IR_write_program(&program, SLP_OUTPUT_FILE));
+	IR_deinit_program(&program);
+
+	file = fopen(SLP_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(SLP_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+static uint32_t * variable(uint64_t * pu64_storage, const char * kpc_name)
+{
+	uint32_t u32_symbol = SYMBOL_TABLE_lookup(kpc_name);
+
+	TEST_ASSERT_NOT_EQUAL(SYMBOL_TABLE_INDEX_NONE, u32_symbol);
+
+	return (uint32_t *)((uint8_t *)pu64_storage + SYMBOL_TABLE_get_offset(u32_symbol));
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_slp);
+
+TEST_SETUP(unit_slp)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_slp)
+{
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Four statements over consecutive variables become a load, a splat, an add and a store
+ */
+TEST(unit_slp, test_group_vectorized)
+{
+	SLP_report_t report;
+
+	// 	test file reads:
+	//		x0 = x0 + 7;
+	//		x1 = x1 + 7;
+	//		x2 = x2 + 7;
+	//		x3 = x3 + 7;
+	parse_file("test_files/unit_slp_0.rep");
+
+	TEST_ASSERT_EQUAL_STRING(
+		"%12 = vload x0\n"
+		"%13 = vsplat 7\n"
+		"%14 = vadd %12, %13\n"
+		"vstore x0, %14\n",
+		vectorize(&report));
+
+	TEST_ASSERT_EQUAL(1, report.u32_num_groups);
+	TEST_ASSERT_EQUAL(0, report.u32_num_unprofitable);
+}
+
+/*
+ *	Loading lanes just stored one at a time waits on the stores, which costs more than the vector
+ *	code saves
+ */
+TEST(unit_slp, test_unprofitable_kept)
+{
+	SLP_report_t report;
+
+	// 	test file reads:
+	//		x0 = 1;
+	//		x1 = 2;
+	//		x2 = 3;
+	//		x3 = 4;
+	//		y0 = x0 + y0;
+	//		y1 = x1 + y1;
+	//		y2 = x2 + y2;
+	//		y3 = x3 + y3;
+	parse_file("test_files/unit_slp_2.rep");
+
+	TEST_ASSERT_NULL(strstr(vectorize(&report), "vload"));
+	TEST_ASSERT_EQUAL(0, report.u32_num_groups);
+	TEST_ASSERT_EQUAL(1, report.u32_num_unprofitable);
+}
+
+/*
+ *	Multiplies, lanes reading what an earlier lane stored, and lanes that don't all do the same thing
+ *	stay scalar
+ */
+TEST(unit_slp, test_not_vectorized)
+{
+	SLP_report_t report;
+
+	// 	test file reads:
+	//		m0 = m0 * 3;
+	//		...
+	//		m3 = m3 * 3;
+	//		e0 = 1;
+	//		...
+	//		e4 = 5;
+	//		e1 = e0 + 1;
+	//		e2 = e1 + 1;
+	//		e3 = e2 + 1;
+	//		e4 = e3 + 1;
+	//		n0 = n0 + 1;
+	//		n1 = n1 - 1;
+	//		n2 = n2 + 1;
+	//		n3 = n3 - 1;
+	parse_file("test_files/unit_slp_3.rep");
+
+	TEST_ASSERT_NULL(strstr(vectorize(&report), "vstore"));
+	TEST_ASSERT_EQUAL(0, report.u32_num_groups);
+	TEST_ASSERT_EQUAL(0, report.u32_num_unprofitable);
+}
+
+/*
+ *	Through the whole pipeline, the vector code computes what the scalar code would have, including
+ *	for later statements that reuse a lane's result
+ */
+TEST(unit_slp, test_program_unchanged)
+{
+	uint64_t pu64_variables[SLP_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_a[IR_VECTOR_LANES] = { 10, 0xFFFFFFFFu, 300, 4000 };
+	const uint32_t ku32_b[IR_VECTOR_LANES] = { 1, 2, 0x80000000u, 5000 };
+	char pc_name[4];
+	JIT_program_t program;
+
+	// 	test file reads, with a and b set before it runs:
+	//		a0 = a0 + 1;
+	//		...
+	//		b0 = b0 - a0;
+	//		...
+	//		c0 = a0 + b0 - 100;
+	//		...
+	parse_file("test_files/unit_slp_1.rep");
+	CODE_GEN_init();
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_GREATER_OR_EQUAL(1, CODE_GEN_get_slp_report()->u32_num_groups);
+
+	for (uint32_t i = 0; i < IR_VECTOR_LANES; i++)
+	{
+		sprintf(pc_name, "a%u", i);
+		*variable(pu64_variables, pc_name) = ku32_a[i];
+		sprintf(pc_name, "b%u", i);
+		*variable(pu64_variables, pc_name) = ku32_b[i];
+	}
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, (uint32_t *)pu64_variables);
+
+	for (uint32_t i = 0; i < IR_VECTOR_LANES; i++)
+	{
+		sprintf(pc_name, "a%u", i);
+		TEST_ASSERT_EQUAL_HEX32(ku32_a[i] + 1, *variable(pu64_variables, pc_name));
+		sprintf(pc_name, "b%u", i);
+		TEST_ASSERT_EQUAL_HEX32(ku32_b[i] - (ku32_a[i] + 1), *variable(pu64_variables, pc_name));
+		sprintf(pc_name, "c%u", i);
+		TEST_ASSERT_EQUAL_HEX32(ku32_b[i] - 100, *variable(pu64_variables, pc_name));
+	}
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_slp, test_group_vectorized);
+	RUN_TEST_CASE(unit_slp, test_unprofitable_kept);
+	RUN_TEST_CASE(unit_slp, test_not_vectorized);
+	RUN_TEST_CASE(unit_slp, test_program_unchanged);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
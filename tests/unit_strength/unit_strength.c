@@ -0,0 +1,467 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "regalloc.h"
+#include "strength.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define STRENGTH_OUTPUT_FILE			"test_files/unit_strength_output.s"
+#define STRENGTH_MAX_OUTPUT_SIZE		(8192)
+#define STRENGTH_MAX_VARIABLES			(16)
+#define STRENGTH_NUM_RANDOM_VALUES		(32)
+#define STRENGTH_EXHAUSTIVE_RANGE		(1u << 20)
+
+/*
+ *	Variables of the hand-built programs: the operand, the result and the constant
+ */
+#define STRENGTH_VAR_OPERAND			(0)
+#define STRENGTH_VAR_RESULT				(1)
+#define STRENGTH_VAR_CONSTANT			(2)
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the assembly out and reads it back. Points into a static buffer
+ */
+static const char * get_assembly(void)
+{
+	static char pc_text[STRENGTH_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(STRENGTH_OUTPUT_FILE));
+
+	file = fopen(STRENGTH_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(STRENGTH_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+/*
+ *	Largest dividend one short of a multiple of the divisor
+ */
+static uint32_t get_last_boundary(uint32_t u32_divisor)
+{
+	return UINT32_MAX - ((UINT32_MAX - (u32_divisor - 1)) % u32_divisor);
+}
+
+/*
+ *	variable[1] = variable[0] op constant, through the strength reduced sequence. The result
+ *	overwrites the operand's register when b_in_place
+ */
+static void build_reduced(ASM_buffer_t * p_buffer, bool b_divide, uint32_t u32_constant, bool b_in_place)
+{
+	uint32_t u32_dst = b_in_place ? 0 : 1;
+	STRENGTH_multiply_t multiply;
+	STRENGTH_divide_t divide;
+	REGALLOC_result_t result;
+
+	ASM_init_buffer(p_buffer);
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, STRENGTH_VAR_OPERAND, ASM_OPERAND_VIRTUAL, 0);
+
+	if (b_divide)
+	{
+		STRENGTH_plan_divide(u32_constant, &divide);
+		STRENGTH_emit_divide(p_buffer, &divide, 0, u32_dst);
+	}
+	else
+	{
+		STRENGTH_plan_multiply(u32_constant, &multiply);
+		STRENGTH_emit_multiply(p_buffer, &multiply, ASM_WIDTH_32, 0, u32_dst);
+	}
+
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, u32_dst, ASM_OPERAND_VARIABLE, STRENGTH_VAR_RESULT);
+	REGALLOC_run(p_buffer, 2, 0, &result);
+	ASM_emit(p_buffer, ASM_OPCODE_RET, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+
+	// Two values fit in caller-saved registers, so there's nothing to save and no frame
+	TEST_ASSERT_EQUAL(0, result.u32_frame_size);
+}
+
+/*
+ *	variable[1] = variable[0] op variable[2], lowered the way it was before strength reduction
+ */
+static void build_generic(ASM_buffer_t * p_buffer, bool b_divide)
+{
+	ASM_init_buffer(p_buffer);
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, STRENGTH_VAR_OPERAND, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+
+	if (b_divide)
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_XOR, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX, ASM_OPERAND_REGISTER, ASM_REGISTER_RDX);
+		ASM_emit(p_buffer, ASM_OPCODE_DIV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, STRENGTH_VAR_CONSTANT, ASM_OPERAND_NONE, 0);
+	}
+	else
+	{
+		ASM_emit(p_buffer, ASM_OPCODE_IMUL, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, STRENGTH_VAR_CONSTANT, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX);
+	}
+
+	ASM_emit(p_buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_REGISTER, ASM_REGISTER_RAX, ASM_OPERAND_VARIABLE, STRENGTH_VAR_RESULT);
+	ASM_emit(p_buffer, ASM_OPCODE_RET, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+}
+
+/*
+ *	Runs the reduced sequences, in place and not, next to the generic one on edge cases and a
+ *	spread of other operands, and checks they all agree
+ */
+static void assert_matches_generic(bool b_divide, uint32_t u32_constant)
+{
+	static uint32_t u32_random = 2463534242u;
+	uint32_t pu32_operands[STRENGTH_NUM_RANDOM_VALUES + 10];
+	uint32_t pu32_variables[STRENGTH_MAX_VARIABLES];
+	uint32_t u32_num_operands = 0;
+	JIT_program_t pp_programs[3];
+	ASM_buffer_t buffer;
+	uint32_t u32_expected;
+
+	build_generic(&buffer, b_divide);
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(&buffer, &pp_programs[0]));
+	ASM_deinit_buffer(&buffer);
+
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		build_reduced(&buffer, b_divide, u32_constant, i == 1);
+		TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(&buffer, &pp_programs[i + 1]));
+		ASM_deinit_buffer(&buffer);
+	}
+
+	pu32_operands[u32_num_operands++] = 0;
+	pu32_operands[u32_num_operands++] = 1;
+	pu32_operands[u32_num_operands++] = UINT32_MAX;
+	pu32_operands[u32_num_operands++] = UINT32_MAX - 1;
+	pu32_operands[u32_num_operands++] = 0x80000000u;
+	pu32_operands[u32_num_operands++] = 0x7FFFFFFFu;
+	pu32_operands[u32_num_operands++] = u32_constant - 1;
+	pu32_operands[u32_num_operands++] = u32_constant;
+	pu32_operands[u32_num_operands++] = u32_constant + 1;
+	pu32_operands[u32_num_operands++] = (u32_constant != 0) ? get_last_boundary(u32_constant) : 2;
+
+	// xorshift32
+	for (uint32_t i = 0; i < STRENGTH_NUM_RANDOM_VALUES; i++)
+	{
+		u32_random ^= u32_random << 13;
+		u32_random ^= u32_random >> 17;
+		u32_random ^= u32_random << 5;
+		pu32_operands[u32_num_operands++] = u32_random;
+	}
+
+	for (uint32_t i = 0; i < u32_num_operands; i++)
+	{
+		memset(pu32_variables, 0, sizeof(pu32_variables));
+		pu32_variables[STRENGTH_VAR_OPERAND] = pu32_operands[i];
+		pu32_variables[STRENGTH_VAR_CONSTANT] = u32_constant;
+		JIT_run(&pp_programs[0], pu32_variables);
+		u32_expected = pu32_variables[STRENGTH_VAR_RESULT];
+
+		for (uint32_t j = 1; j < 3; j++)
+		{
+			pu32_variables[STRENGTH_VAR_RESULT] = 0;
+			JIT_run(&pp_programs[j], pu32_variables);
+
+			if (pu32_variables[STRENGTH_VAR_RESULT] != u32_expected)
+			{
+				TEST_PRINTF("%u %s %u: expected %u, got %u", pu32_operands[i], b_divide ? "/" : "*", u32_constant, u32_expected, pu32_variables[STRENGTH_VAR_RESULT]);
+				TEST_FAIL();
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		JIT_release(&pp_programs[i]);
+	}
+}
+
+static void assert_divide_plan(uint32_t u32_divisor)
+{
+	STRENGTH_divide_t plan;
+	uint32_t u32_boundary = get_last_boundary(u32_divisor);
+
+	STRENGTH_plan_divide(u32_divisor, &plan);
+
+	if (STRENGTH_evaluate_divide(&plan, u32_boundary) != u32_boundary / u32_divisor ||
+		STRENGTH_evaluate_divide(&plan, UINT32_MAX) != UINT32_MAX / u32_divisor)
+	{
+		TEST_PRINTF("Divisor %u: kind %u, multiplier %u, shift %u", u32_divisor, plan.u8_kind, plan.u32_multiplier, plan.u8_shift);
+		TEST_FAIL();
+	}
+}
+
+static void assert_multiply_plan(uint32_t u32_multiplier)
+{
+	static const uint32_t ku32_operands[] = { 1, 3, 0x9E3779B9u, 0x80000000u, UINT32_MAX };
+	STRENGTH_multiply_t plan;
+
+	STRENGTH_plan_multiply(u32_multiplier, &plan);
+	TEST_ASSERT_TRUE(plan.u8_num_steps <= STRENGTH_MAX_MULTIPLY_STEPS);
+	TEST_ASSERT_TRUE(!plan.b_imul || plan.u8_num_steps == 0);
+
+	for (uint32_t i = 0; i < sizeof(ku32_operands) / sizeof(ku32_operands[0]); i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(ku32_operands[i] * u32_multiplier, STRENGTH_evaluate_multiply(&plan, ku32_operands[i]));
+	}
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_strength);
+
+TEST_SETUP(unit_strength)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_strength)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	Every plan divides by multiplying by a reciprocal rounded up (a shift is an exact one), so it
+ *	can only overshoot, and by more the larger the dividend. The first dividend it gets wrong would
+ *	be the largest one just short of a multiple of the divisor, or else UINT32_MAX, in the last
+ *	partial run. Checking both covers every dividend, so this is exhaustive over the dividends for
+ *	every divisor below 2^20, every one above 2^32 - 2^20, and every power of two and its neighbours
+ */
+TEST(unit_strength, test_divide_every_divisor)
+{
+	for (uint32_t i = 1; i <= STRENGTH_EXHAUSTIVE_RANGE; i++)
+	{
+		assert_divide_plan(i);
+		assert_divide_plan(UINT32_MAX - i + 1);
+	}
+
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		assert_divide_plan((1u << i) + 1);
+		assert_divide_plan(1u << i);
+		assert_divide_plan((1u << i) - 1 + (i == 0));
+	}
+}
+
+/*
+ *	Steps are exact factors, so a handful of operands per multiplier is enough
+ */
+TEST(unit_strength, test_multiply_every_constant)
+{
+	STRENGTH_multiply_t plan;
+
+	for (uint32_t i = 0; i < STRENGTH_EXHAUSTIVE_RANGE; i++)
+	{
+		assert_multiply_plan(i);
+		assert_multiply_plan(UINT32_MAX - i);
+	}
+
+	// Shifts, lea and pairs of them, but never more than two steps
+	STRENGTH_plan_multiply(1u << 31, &plan);
+	TEST_ASSERT_EQUAL(1, plan.u8_num_steps);
+	TEST_ASSERT_EQUAL(STRENGTH_STEP_SHIFT, plan.p_steps[0].u8_kind);
+	TEST_ASSERT_EQUAL(31, plan.p_steps[0].u8_amount);
+
+	STRENGTH_plan_multiply(40, &plan);
+	TEST_ASSERT_EQUAL(2, plan.u8_num_steps);
+	TEST_ASSERT_EQUAL(STRENGTH_STEP_LEA, plan.p_steps[0].u8_kind);
+	TEST_ASSERT_EQUAL(5, plan.p_steps[0].u8_amount);
+	TEST_ASSERT_EQUAL(STRENGTH_STEP_SHIFT, plan.p_steps[1].u8_kind);
+	TEST_ASSERT_EQUAL(3, plan.p_steps[1].u8_amount);
+
+	STRENGTH_plan_multiply(45, &plan);
+	TEST_ASSERT_EQUAL(2, plan.u8_num_steps);
+	TEST_ASSERT_EQUAL(STRENGTH_STEP_LEA, plan.p_steps[1].u8_kind);
+
+	STRENGTH_plan_multiply(7, &plan);
+	TEST_ASSERT_TRUE(plan.b_imul);
+
+	STRENGTH_plan_multiply(3 * 9 * 2, &plan);
+	TEST_ASSERT_TRUE(plan.b_imul);
+}
+
+/*
+ *	The machine code for every kind of plan, against div and imul on the same operands
+ */
+TEST(unit_strength, test_jit_matches_generic)
+{
+	static const uint32_t ku32_constants[] =
+	{
+		641, 1000, 6700417, 1000000007, 0x55555555u, 0x7FFFFFFFu, 0x80000001u, 0xFFFFFFF0u, UINT32_MAX - 1, UINT32_MAX,
+	};
+
+	for (uint32_t i = 0; i <= 300; i++)
+	{
+		assert_matches_generic(false, i);
+
+		if (i > 0)
+		{
+			assert_matches_generic(true, i);
+		}
+	}
+
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		assert_matches_generic(false, 1u << i);
+		assert_matches_generic(true, 1u << i);
+		assert_matches_generic(true, (1u << i) + 1);
+	}
+
+	for (uint32_t i = 0; i < sizeof(ku32_constants) / sizeof(ku32_constants[0]); i++)
+	{
+		assert_matches_generic(false, ku32_constants[i]);
+		assert_matches_generic(true, ku32_constants[i]);
+	}
+}
+
+/*
+ *	With every register taken, lea's operands end up on the stack and go through the spill register
+ */
+TEST(unit_strength, test_spilled_lea)
+{
+	uint32_t pu32_variables[STRENGTH_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_num_values = STRENGTH_MAX_VARIABLES - 1;
+	STRENGTH_multiply_t plan;
+	REGALLOC_result_t result;
+	JIT_program_t program;
+	ASM_buffer_t buffer;
+
+	// Keeps 15 values live at once, then multiplies the last by 45 into the last variable
+	ASM_init_buffer(&buffer);
+
+	for (uint32_t i = 0; i < ku32_num_values; i++)
+	{
+		pu32_variables[i] = 1000 + i;
+		ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, i, ASM_OPERAND_VIRTUAL, i);
+	}
+
+	STRENGTH_plan_multiply(45, &plan);
+	STRENGTH_emit_multiply(&buffer, &plan, ASM_WIDTH_32, 0, ku32_num_values);
+	ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, ku32_num_values, ASM_OPERAND_VARIABLE, ku32_num_values);
+
+	for (uint32_t i = 0; i < ku32_num_values; i++)
+	{
+		ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VARIABLE, ku32_num_values);
+	}
+
+	REGALLOC_run(&buffer, ku32_num_values + 1, 0, &result);
+	TEST_ASSERT_TRUE(result.u32_num_spilled > 0);
+
+	// rep_main isn't wrapped here, so make the frame and save what's callee-saved by hand
+	ASM_insert_instructions(&buffer, 0, (ASM_instruction_t[])
+	{
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_RBX },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_RBP },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R12 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R13 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R14 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R15 },
+		{ .u8_opcode = ASM_OPCODE_SUB, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_IMMEDIATE, .u32_src = result.u32_frame_size,
+			.u8_dst_kind = ASM_OPERAND_REGISTER, .u32_dst = ASM_REGISTER_RSP },
+	}, 7);
+	ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, result.u32_frame_size, ASM_OPERAND_REGISTER, ASM_REGISTER_RSP);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R15);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R14);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R13);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R12);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RBP);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RBX);
+	ASM_emit(&buffer, ASM_OPCODE_RET, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(&buffer, &program));
+	ASM_deinit_buffer(&buffer);
+
+	JIT_run(&program, pu32_variables);
+
+	// 1000 * 45 plus the sum of 1000..1014
+	TEST_ASSERT_EQUAL_UINT32((1000 * 45) + (15 * 1000) + 105, pu32_variables[ku32_num_values]);
+
+	JIT_release(&program);
+}
+
+/*
+ *	Through the whole compiler: no div and only the one imul that has no cheaper form
+ */
+TEST(unit_strength, test_code_gen_nominal)
+{
+	uint32_t pu32_variables[STRENGTH_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_a = 1000000007u;
+	const char * kpc_assembly;
+	const char * kpc_imul;
+	JIT_program_t program;
+
+	// 	test file reads, with a set before it runs:
+	//		b = a * 10;
+	//		c = a * 45;
+	//		d = a * 7;
+	//		e = a / 7;
+	//		f = a / 10;
+	//		g = a / 16;
+	//		h = a / 4294967295;
+	//		i = 3 * a;
+	//		j = a * 0 + a / 1;
+	compile_file("test_files/unit_strength_0.rep", NULL);
+
+	kpc_assembly = get_assembly();
+	TEST_ASSERT_NULL(strstr(kpc_assembly, "div"));
+	kpc_imul = strstr(kpc_assembly, "imull");
+	TEST_ASSERT_NOT_NULL(kpc_imul);
+	TEST_ASSERT_NULL(strstr(kpc_imul + 1, "imull"));
+
+	pu32_variables[SYMBOL_TABLE_lookup("a")] = ku32_a;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	TEST_ASSERT_EQUAL_UINT32(ku32_a, pu32_variables[SYMBOL_TABLE_lookup("a")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a * 10, pu32_variables[SYMBOL_TABLE_lookup("b")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a * 45, pu32_variables[SYMBOL_TABLE_lookup("c")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a * 7, pu32_variables[SYMBOL_TABLE_lookup("d")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a / 7, pu32_variables[SYMBOL_TABLE_lookup("e")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a / 10, pu32_variables[SYMBOL_TABLE_lookup("f")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a / 16, pu32_variables[SYMBOL_TABLE_lookup("g")]);
+	TEST_ASSERT_EQUAL_UINT32(0, pu32_variables[SYMBOL_TABLE_lookup("h")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a * 3, pu32_variables[SYMBOL_TABLE_lookup("i")]);
+	TEST_ASSERT_EQUAL_UINT32(ku32_a, pu32_variables[SYMBOL_TABLE_lookup("j")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_strength, test_divide_every_divisor);
+	RUN_TEST_CASE(unit_strength, test_multiply_every_constant);
+	RUN_TEST_CASE(unit_strength, test_jit_matches_generic);
+	RUN_TEST_CASE(unit_strength, test_spilled_lea);
+	RUN_TEST_CASE(unit_strength, test_code_gen_nominal);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
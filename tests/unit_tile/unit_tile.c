@@ -0,0 +1,395 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "symbol_table.h"
+#include "code_gen.h"
+#include "regalloc.h"
+#include "ir.h"
+#include "tile.h"
+#include "jit.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define TILE_OUTPUT_FILE				"test_files/unit_tile_output.s"
+#define TILE_MAX_OUTPUT_SIZE			(8192)
+#define TILE_MAX_VARIABLES				(16)
+#define TILE_DISABLED_PASS				"schedule"	// The asserts spell out registers as selection orders the code
+
+/****************************************************************************************************
+ *	H E L P E R S
+ ****************************************************************************************************/
+
+/*
+ *	Writes the assembly out and reads it back. Points into a static buffer
+ */
+static const char * get_assembly(void)
+{
+	static char pc_text[TILE_MAX_OUTPUT_SIZE];
+	FILE * file;
+	size_t size;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, CODE_GEN_write_assembly(TILE_OUTPUT_FILE));
+
+	file = fopen(TILE_OUTPUT_FILE, "r");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(pc_text, 1, sizeof(pc_text) - 1, file);
+	fclose(file);
+	remove(TILE_OUTPUT_FILE);
+	pc_text[size] = '\0';
+
+	return pc_text;
+}
+
+static uint32_t count_occurrences(const char * kpc_text, const char * kpc_needle)
+{
+	uint32_t u32_count = 0;
+
+	for (const char * kpc_match = strstr(kpc_text, kpc_needle); kpc_match != NULL; kpc_match = strstr(kpc_match + 1, kpc_needle))
+	{
+		u32_count++;
+	}
+
+	return u32_count;
+}
+
+/*
+ *	Index of the first instruction with `opcode`, at or after `u32_start`
+ */
+static uint32_t find_instruction(const IR_program_t * kp_program, IR_opcode_t opcode, uint32_t u32_start)
+{
+	for (uint32_t i = u32_start; i < kp_program->u32_num_instructions; i++)
+	{
+		if (kp_program->p_instructions[i].u8_opcode == opcode)
+		{
+			return i;
+		}
+	}
+
+	TEST_FAIL_MESSAGE("Instruction not found");
+	return 0;
+}
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_tile);
+
+TEST_SETUP(unit_tile)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_tile)
+{
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+/*
+ *	a * 4 + b is one lea, with the multiply as its index and the constant built in
+ */
+TEST(unit_tile, test_cover_lea)
+{
+	const IR_instruction_t * kp_mul;
+	const IR_instruction_t * kp_add;
+	IR_def_use_t def_use;
+	TILE_cover_t cover;
+	IR_program_t program;
+	uint32_t u32_a;
+	uint32_t u32_b;
+	uint32_t u32_four;
+
+	IR_init_program(&program);
+	u32_a = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 0);
+	u32_four = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 4);
+	IR_emit(&program, IR_OPCODE_MUL, u32_a, u32_four, 0);
+	u32_b = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 1);
+	IR_emit(&program, IR_OPCODE_ADD, program.p_instructions[2].u32_result, u32_b, 0);
+	IR_emit(&program, IR_OPCODE_STORE, program.p_instructions[4].u32_result, IR_VALUE_NONE, 2);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+
+	IR_build_def_use(&program, &def_use);
+	TILE_cover(&program, &def_use, &cover);
+
+	kp_mul = &program.p_instructions[find_instruction(&program, IR_OPCODE_MUL, 0)];
+	kp_add = &program.p_instructions[find_instruction(&program, IR_OPCODE_ADD, 0)];
+
+	// The add's left operand is b, so the rule is swapped
+	TEST_ASSERT_EQUAL(TILE_RULE_LEA | TILE_RULE_SWAPPED, TILE_get_rule(&cover, kp_add->u32_result, TILE_NT_REG));
+	TEST_ASSERT_EQUAL(TILE_RULE_INDEX, TILE_get_rule(&cover, kp_mul->u32_result, TILE_NT_INDEX));
+
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, kp_add->u32_result, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, kp_mul->u32_result, TILE_NT_INDEX));
+	TEST_ASSERT_FALSE(TILE_is_needed(&cover, kp_mul->u32_result, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_a, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_b, TILE_NT_REG));
+
+	// Nothing needs the 4 at all
+	for (uint32_t nt = 0; nt < TILE_NT_NUM_NONTERMINALS; nt++)
+	{
+		TEST_ASSERT_FALSE(TILE_is_needed(&cover, u32_four, nt));
+	}
+
+	// Two loads and the lea
+	TEST_ASSERT_EQUAL(3, cover.u32_cost);
+
+	TILE_deinit_cover(&cover);
+	IR_deinit_def_use(&def_use);
+	IR_deinit_program(&program);
+}
+
+/*
+ *	A load is read in place, unless the variable was stored to between the load and its use, or
+ *	the value has more than one user
+ */
+TEST(unit_tile, test_cover_memory_operands)
+{
+	IR_def_use_t def_use;
+	TILE_cover_t cover;
+	IR_program_t program;
+	uint32_t u32_early;
+	uint32_t u32_late;
+	uint32_t u32_shared;
+	uint32_t u32_blocked;
+	uint32_t u32_folded;
+	uint32_t u32_left;
+
+	// v = load 0; store 0 <- 7; blocked = load 1 + v; v' = load 0; folded = load 1 + v'; shared = load 2; store 3 <- shared + shared
+	IR_init_program(&program);
+	u32_early = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 0);
+	IR_emit(&program, IR_OPCODE_STORE, IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 7), IR_VALUE_NONE, 0);
+	u32_left = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 1);
+	u32_blocked = IR_emit(&program, IR_OPCODE_SUB, u32_left, u32_early, 0);
+	IR_emit(&program, IR_OPCODE_STORE, u32_blocked, IR_VALUE_NONE, 4);
+	u32_late = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 0);
+	u32_left = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 1);
+	u32_folded = IR_emit(&program, IR_OPCODE_SUB, u32_left, u32_late, 0);
+	IR_emit(&program, IR_OPCODE_STORE, u32_folded, IR_VALUE_NONE, 5);
+	u32_shared = IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 2);
+	IR_emit(&program, IR_OPCODE_STORE, IR_emit(&program, IR_OPCODE_ADD, u32_shared, u32_shared, 0), IR_VALUE_NONE, 3);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+
+	IR_build_def_use(&program, &def_use);
+	TILE_cover(&program, &def_use, &cover);
+
+	TEST_ASSERT_EQUAL(TILE_RULE_REG_REG, TILE_get_rule(&cover, u32_blocked, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_early, TILE_NT_REG));
+	TEST_ASSERT_FALSE(TILE_is_needed(&cover, u32_early, TILE_NT_MEM));
+
+	TEST_ASSERT_EQUAL(TILE_RULE_REG_MEM, TILE_get_rule(&cover, u32_folded, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_late, TILE_NT_MEM));
+	TEST_ASSERT_FALSE(TILE_is_needed(&cover, u32_late, TILE_NT_REG));
+
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_shared, TILE_NT_REG));
+	TEST_ASSERT_FALSE(TILE_is_needed(&cover, u32_shared, TILE_NT_MEM));
+
+	TILE_deinit_cover(&cover);
+	IR_deinit_def_use(&def_use);
+	IR_deinit_program(&program);
+}
+
+/*
+ *	Constants are immediates, except a zero divisor, which has to be divided by at run time
+ */
+TEST(unit_tile, test_cover_immediates)
+{
+	IR_def_use_t def_use;
+	TILE_cover_t cover;
+	IR_program_t program;
+	uint32_t u32_zero;
+	uint32_t u32_five;
+	uint32_t u32_sub;
+	uint32_t u32_div;
+
+	IR_init_program(&program);
+	u32_five = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 5);
+	u32_sub = IR_emit(&program, IR_OPCODE_SUB, IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 0), u32_five, 0);
+	IR_emit(&program, IR_OPCODE_STORE, u32_sub, IR_VALUE_NONE, 1);
+	u32_zero = IR_emit(&program, IR_OPCODE_CONST, IR_VALUE_NONE, IR_VALUE_NONE, 0);
+	u32_div = IR_emit(&program, IR_OPCODE_DIV, IR_emit(&program, IR_OPCODE_LOAD, IR_VALUE_NONE, IR_VALUE_NONE, 0), u32_zero, 0);
+	IR_emit(&program, IR_OPCODE_STORE, u32_div, IR_VALUE_NONE, 2);
+	IR_emit(&program, IR_OPCODE_STORE, u32_five, IR_VALUE_NONE, 3);
+	TEST_ASSERT_TRUE(IR_verify(&program));
+
+	IR_build_def_use(&program, &def_use);
+	TILE_cover(&program, &def_use, &cover);
+
+	// The 5 is also stored, so it's wanted both ways
+	TEST_ASSERT_EQUAL(TILE_RULE_REG_IMM, TILE_get_rule(&cover, u32_sub, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_five, TILE_NT_IMM));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_five, TILE_NT_REG));
+
+	TEST_ASSERT_EQUAL(TILE_RULE_REG_REG, TILE_get_rule(&cover, u32_div, TILE_NT_REG));
+	TEST_ASSERT_TRUE(TILE_is_needed(&cover, u32_zero, TILE_NT_REG));
+	TEST_ASSERT_FALSE(TILE_is_needed(&cover, u32_zero, TILE_NT_IMM));
+
+	TILE_deinit_cover(&cover);
+	IR_deinit_def_use(&def_use);
+	IR_deinit_program(&program);
+}
+
+TEST(unit_tile, test_scale)
+{
+	TEST_ASSERT_EQUAL(2, TILE_get_scale(2));
+	TEST_ASSERT_EQUAL(4, TILE_get_scale(4));
+	TEST_ASSERT_EQUAL(8, TILE_get_scale(8));
+	TEST_ASSERT_EQUAL(0, TILE_get_scale(0));
+	TEST_ASSERT_EQUAL(0, TILE_get_scale(1));
+	TEST_ASSERT_EQUAL(0, TILE_get_scale(3));
+	TEST_ASSERT_EQUAL(0, TILE_get_scale(16));
+}
+
+/*
+ *	With every register taken, lea's operands end up on the stack. A spilled destination is added
+ *	to in memory, and a spilled index goes through the spill register
+ */
+TEST(unit_tile, test_spilled_scaled_add)
+{
+	uint32_t pu32_variables[TILE_MAX_VARIABLES] = { 0 };
+	uint32_t pu32_expected[TILE_MAX_VARIABLES] = { 0 };
+	const uint32_t ku32_num_values = TILE_MAX_VARIABLES;
+	static const ASM_opcode_t pk_opcodes[] = { ASM_OPCODE_ADD_SCALED2, ASM_OPCODE_ADD_SCALED4, ASM_OPCODE_ADD_SCALED8 };
+	static const uint32_t ku32_scales[] = { 2, 4, 8 };
+	REGALLOC_result_t result;
+	JIT_program_t program;
+	ASM_buffer_t buffer;
+
+	// Keeps 16 values live at once, then adds each scaled one into the next, back to front
+	ASM_init_buffer(&buffer);
+
+	for (uint32_t i = 0; i < ku32_num_values; i++)
+	{
+		pu32_variables[i] = 0x9E3779B9u * (i + 1);
+		pu32_expected[i] = pu32_variables[i];
+		ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VARIABLE, i, ASM_OPERAND_VIRTUAL, i);
+	}
+
+	for (uint32_t i = ku32_num_values - 1; i > 0; i--)
+	{
+		ASM_emit(&buffer, pk_opcodes[i % 3], ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VIRTUAL, i - 1);
+		pu32_expected[i - 1] += pu32_expected[i] * ku32_scales[i % 3];
+	}
+
+	for (uint32_t i = 0; i < ku32_num_values; i++)
+	{
+		ASM_emit(&buffer, ASM_OPCODE_MOV, ASM_WIDTH_32, ASM_OPERAND_VIRTUAL, i, ASM_OPERAND_VARIABLE, i);
+	}
+
+	REGALLOC_run(&buffer, ku32_num_values, 0, &result);
+	TEST_ASSERT_TRUE(result.u32_num_spilled > 0);
+
+	// rep_main isn't wrapped here, so make the frame and save what's callee-saved by hand
+	ASM_insert_instructions(&buffer, 0, (ASM_instruction_t[])
+	{
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_RBX },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_RBP },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R12 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R13 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R14 },
+		{ .u8_opcode = ASM_OPCODE_PUSH, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_REGISTER, .u32_src = ASM_REGISTER_R15 },
+		{ .u8_opcode = ASM_OPCODE_SUB, .u8_width = ASM_WIDTH_64, .u8_src_kind = ASM_OPERAND_IMMEDIATE, .u32_src = result.u32_frame_size,
+			.u8_dst_kind = ASM_OPERAND_REGISTER, .u32_dst = ASM_REGISTER_RSP },
+	}, 7);
+	ASM_emit(&buffer, ASM_OPCODE_ADD, ASM_WIDTH_64, ASM_OPERAND_IMMEDIATE, result.u32_frame_size, ASM_OPERAND_REGISTER, ASM_REGISTER_RSP);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R15);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R14);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R13);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_R12);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RBP);
+	ASM_emit(&buffer, ASM_OPCODE_POP, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_REGISTER, ASM_REGISTER_RBX);
+	ASM_emit(&buffer, ASM_OPCODE_RET, ASM_WIDTH_64, ASM_OPERAND_NONE, 0, ASM_OPERAND_NONE, 0);
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(&buffer, &program));
+	ASM_deinit_buffer(&buffer);
+
+	JIT_run(&program, pu32_variables);
+	TEST_ASSERT_EQUAL_UINT32_ARRAY(pu32_expected, pu32_variables, ku32_num_values);
+
+	JIT_release(&program);
+}
+
+/*
+ *	Through the whole compiler: lea for scaled adds, immediates, and memory operands
+ */
+TEST(unit_tile, test_code_gen_nominal)
+{
+	uint32_t pu32_variables[TILE_MAX_VARIABLES] = { 0 };
+	const char * kpc_assembly;
+	JIT_program_t program;
+	uint32_t u32_x;
+	uint32_t u32_y;
+
+	// 	test file reads:
+	//		x = a * 4 + b;
+	//		y = c + d * 8;
+	//		z = e - 5;
+	//		w = f / g;
+	//		v = h * 2 + h;
+	//		u = x / 10 + y * 3;
+	compile_file("test_files/unit_tile_0.rep", TILE_DISABLED_PASS);
+
+	kpc_assembly = get_assembly();
+	TEST_ASSERT_NOT_NULL(strstr(kpc_assembly, "\tleal\t(%rsi,%rcx,4), %esi\n"));
+	TEST_ASSERT_NOT_NULL(strstr(kpc_assembly, "\tleal\t(%r8,%rcx,8), %r8d\n"));
+	TEST_ASSERT_NOT_NULL(strstr(kpc_assembly, "\tleal\t(%r9,%rcx,2), %r9d\n"));
+	TEST_ASSERT_NOT_NULL(strstr(kpc_assembly, "\tsubl\t$5, %ecx\n"));
+	TEST_ASSERT_NOT_NULL(strstr(kpc_assembly, "\tdivl\trep_var_g(%rdi)\n"));
+	TEST_ASSERT_EQUAL(4, count_occurrences(kpc_assembly, "leal"));
+	TEST_ASSERT_EQUAL(0, count_occurrences(kpc_assembly, "shll"));
+	TEST_ASSERT_EQUAL(0, count_occurrences(kpc_assembly, "imull"));
+
+	pu32_variables[SYMBOL_TABLE_lookup("a")] = 0x80000001u;
+	pu32_variables[SYMBOL_TABLE_lookup("b")] = 17;
+	pu32_variables[SYMBOL_TABLE_lookup("c")] = UINT32_MAX;
+	pu32_variables[SYMBOL_TABLE_lookup("d")] = 123456789;
+	pu32_variables[SYMBOL_TABLE_lookup("e")] = 3;
+	pu32_variables[SYMBOL_TABLE_lookup("f")] = 1000000;
+	pu32_variables[SYMBOL_TABLE_lookup("g")] = 7;
+	pu32_variables[SYMBOL_TABLE_lookup("h")] = 0x55555556u;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &program));
+	JIT_run(&program, pu32_variables);
+
+	u32_x = (0x80000001u * 4) + 17;
+	u32_y = UINT32_MAX + (123456789u * 8);
+	TEST_ASSERT_EQUAL_UINT32(u32_x, pu32_variables[SYMBOL_TABLE_lookup("x")]);
+	TEST_ASSERT_EQUAL_UINT32(u32_y, pu32_variables[SYMBOL_TABLE_lookup("y")]);
+	TEST_ASSERT_EQUAL_UINT32(3u - 5u, pu32_variables[SYMBOL_TABLE_lookup("z")]);
+	TEST_ASSERT_EQUAL_UINT32(1000000 / 7, pu32_variables[SYMBOL_TABLE_lookup("w")]);
+	TEST_ASSERT_EQUAL_UINT32(0x55555556u * 3, pu32_variables[SYMBOL_TABLE_lookup("v")]);
+	TEST_ASSERT_EQUAL_UINT32((u32_x / 10) + (u32_y * 3), pu32_variables[SYMBOL_TABLE_lookup("u")]);
+
+	JIT_release(&program);
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_tile, test_cover_lea);
+	RUN_TEST_CASE(unit_tile, test_cover_memory_operands);
+	RUN_TEST_CASE(unit_tile, test_cover_immediates);
+	RUN_TEST_CASE(unit_tile, test_scale);
+	RUN_TEST_CASE(unit_tile, test_spilled_scaled_add);
+	RUN_TEST_CASE(unit_tile, test_code_gen_nominal);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,264 @@
+#include "unity.h"
+#include "unity_fixture.h"
+#include "test_helpers.h"
+#include "status.h"
+#include "io_handler.h"
+#include "lex.h"
+#include "parse.h"
+#include "code_gen.h"
+#include "symbol_table.h"
+#include "jit.h"
+#include "vm.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#define VM_MAX_VARIABLES				(64)
+
+/****************************************************************************************************
+ *	S C A F F O L D I N G
+ ****************************************************************************************************/
+
+TEST_GROUP(unit_vm);
+
+TEST_SETUP(unit_vm)
+{
+	// Nothing
+}
+
+TEST_TEAR_DOWN(unit_vm)
+{
+	CODE_GEN_deinit();
+	PARSE_deinit();
+	LEX_deinit();
+	UnityConcludeTest();
+}
+
+/****************************************************************************************************
+ *	U N I T   T E S T S
+ ****************************************************************************************************/
+
+TEST(unit_vm, test_run_nominal)
+{
+	uint32_t pu32_variables[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+
+	// 	test file reads:
+	//		x = 5;
+	//		y = 7;
+	//		q = 4294967295;
+	//		z = (x + 2) * y - 3;
+	//		w = q / y + 4000000000;
+	//		m = z * z * z * 1000;
+	parse_file("test_files/unit_vm_0.rep");
+	CODE_GEN_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_run(&program, pu32_variables));
+
+	TEST_ASSERT_EQUAL_UINT32(5, pu32_variables[SYMBOL_TABLE_lookup("x")]);
+	TEST_ASSERT_EQUAL_UINT32(7, pu32_variables[SYMBOL_TABLE_lookup("y")]);
+	TEST_ASSERT_EQUAL_UINT32(4294967295u, pu32_variables[SYMBOL_TABLE_lookup("q")]);
+	TEST_ASSERT_EQUAL_UINT32(46, pu32_variables[SYMBOL_TABLE_lookup("z")]);
+	TEST_ASSERT_EQUAL_UINT32(318599460, pu32_variables[SYMBOL_TABLE_lookup("w")]);
+	TEST_ASSERT_EQUAL_UINT32(97336000, pu32_variables[SYMBOL_TABLE_lookup("m")]);
+
+	// Nothing past the last variable is touched
+	TEST_ASSERT_EQUAL_UINT32(0, pu32_variables[6]);
+
+	VM_release(&program);
+	TEST_ASSERT_NULL(program.p_instructions);
+}
+
+/*
+ *	Literals become immediates, products feeding adds fuse, and each statement's last
+ *	instruction writes its variable directly
+ */
+TEST(unit_vm, test_superinstructions)
+{
+	const uint8_t ku8_expected[] =
+	{
+		VM_OPCODE_MUL_I_ADD,		// a = b * 4 + c;
+		VM_OPCODE_MUL_I_ADD,		// d = 3 * b + c;
+		VM_OPCODE_ADD_I,			// e = b + 1;
+		VM_OPCODE_SUB_FROM_I,		// f = 7 - b;
+		VM_OPCODE_DIV_FROM_I,		// g = 100 / b;
+		VM_OPCODE_MOV,				// h = b;
+		VM_OPCODE_HALT,
+	};
+	uint32_t pu32_variables[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+
+	parse_file("test_files/unit_vm_1.rep");
+	CODE_GEN_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+
+	TEST_ASSERT_EQUAL_UINT32(sizeof(ku8_expected), program.u32_num_instructions);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(ku8_expected, program.pu8_opcodes, sizeof(ku8_expected));
+	TEST_ASSERT_EQUAL_UINT32(SYMBOL_TABLE_lookup("a"), program.p_instructions[0].u32_dst);
+	TEST_ASSERT_EQUAL_UINT32(4, program.p_instructions[0].u32_right);
+	TEST_ASSERT_EQUAL_UINT32(3, program.p_instructions[1].u32_right);
+	TEST_ASSERT_EQUAL_UINT32(SYMBOL_TABLE_get_num_symbols(), program.u32_num_slots);
+
+	pu32_variables[SYMBOL_TABLE_lookup("b")] = 5;
+	pu32_variables[SYMBOL_TABLE_lookup("c")] = 1;
+
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_run(&program, pu32_variables));
+
+	TEST_ASSERT_EQUAL_UINT32(21, pu32_variables[SYMBOL_TABLE_lookup("a")]);
+	TEST_ASSERT_EQUAL_UINT32(16, pu32_variables[SYMBOL_TABLE_lookup("d")]);
+	TEST_ASSERT_EQUAL_UINT32(6, pu32_variables[SYMBOL_TABLE_lookup("e")]);
+	TEST_ASSERT_EQUAL_UINT32(2, pu32_variables[SYMBOL_TABLE_lookup("f")]);
+	TEST_ASSERT_EQUAL_UINT32(20, pu32_variables[SYMBOL_TABLE_lookup("g")]);
+	TEST_ASSERT_EQUAL_UINT32(5, pu32_variables[SYMBOL_TABLE_lookup("h")]);
+
+	VM_release(&program);
+}
+
+/*
+ *	Dividing by zero stops the program, and the variables are left as they were
+ */
+TEST(unit_vm, test_division_by_zero)
+{
+	uint32_t pu32_variables[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+
+	// 	test file reads:
+	//		x = 10;
+	//		y = x - 10;
+	//		z = 5;
+	//		w = x / y;
+	//		z = 6;
+	parse_file("test_files/unit_vm_2.rep");
+	CODE_GEN_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+
+	TEST_ASSERT_EQUAL(STATUS_FAILED, VM_run(&program, pu32_variables));
+
+	for (uint32_t i = 0; i < SYMBOL_TABLE_get_num_symbols(); i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(0, pu32_variables[i]);
+	}
+
+	VM_release(&program);
+}
+
+/*
+ *	The interpreter and the native backend agree on every variable
+ */
+TEST(unit_vm, test_matches_native)
+{
+	uint32_t pu32_interpreted[VM_MAX_VARIABLES] = { 0 };
+	uint32_t pu32_native[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+	JIT_program_t native;
+
+	parse_file("test_files/unit_vm_3.rep");
+	CODE_GEN_init();
+	// Variables where they were declared, which is where the interpreter finds them
+	TEST_ASSERT_TRUE(CODE_GEN_set_pass_enabled("layout", false));
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+	CODE_GEN_run(PARSE_get_tree_list());
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &native));
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_run(&program, pu32_interpreted));
+	JIT_run(&native, pu32_native);
+
+	TEST_ASSERT_EQUAL_UINT32_ARRAY(pu32_native, pu32_interpreted, VM_MAX_VARIABLES);
+
+	JIT_release(&native);
+	VM_release(&program);
+}
+
+/*
+ *	Every width and sign computes, wraps, divides and converts as native code does
+ */
+TEST(unit_vm, test_typed_matches_native)
+{
+	uint64_t pu64_interpreted[VM_MAX_VARIABLES] = { 0 };
+	uint64_t pu64_native[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+	JIT_program_t native;
+
+	// 	test file reads:
+	//		u8 a = 200;
+	//		i8 b = 0 - 100;
+	//		i16 c = 30000;
+	//		i32 d = 0 - 7;
+	//		u64 w = 5000000000;
+	//		i64 s = 0 - 3;
+	//		a = a + a;
+	//		b = b - 100;
+	//		c = c * 3;
+	//		d = d / 2 + 2147483647 * d;
+	//		e = d / 3;
+	//		w = w * w + a / 3;
+	//		s = s / 2 - 9000000000 * s;
+	//		i32 f = 100 / d;
+	//		u64 g = 18446744073709551615 / w;
+	//		h = w;
+	compile_file("test_files/unit_vm_4.rep", "layout");
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(pu64_native), SYMBOL_TABLE_get_storage_size());
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+
+	TEST_ASSERT_EQUAL(STATUS_OK, JIT_compile(CODE_GEN_get_buffer(), &native));
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_run(&program, (uint32_t *)pu64_interpreted));
+	JIT_run(&native, (uint32_t *)pu64_native);
+
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(pu64_native, pu64_interpreted, sizeof(pu64_native));
+	TEST_ASSERT_EQUAL_UINT8(144, *((uint8_t *)pu64_interpreted + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("a"))));
+	TEST_ASSERT_EQUAL_INT8(56, *((int8_t *)pu64_interpreted + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("b"))));
+	TEST_ASSERT_EQUAL_UINT64(6553255926290448432u, *(uint64_t *)((uint8_t *)pu64_interpreted + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("w"))));
+	TEST_ASSERT_EQUAL_INT64(26999999999, *(int64_t *)((uint8_t *)pu64_interpreted + SYMBOL_TABLE_get_offset(SYMBOL_TABLE_lookup("s"))));
+
+	JIT_release(&native);
+	VM_release(&program);
+}
+
+/*
+ *	The most negative i32 over a literal that wraps to -1 would trap natively, so it stops the
+ *	program as dividing by zero does
+ */
+TEST(unit_vm, test_signed_division_overflow)
+{
+	uint64_t pu64_variables[VM_MAX_VARIABLES] = { 0 };
+	VM_program_t program;
+
+	// 	test file reads:
+	//		x = 3;
+	//		i32 c = 0 - 2147483647 - 1;
+	//		i32 f = c / 4294967295;
+	//		x = 4;
+	parse_file("test_files/unit_vm_5.rep");
+	CODE_GEN_init();
+	TEST_ASSERT_EQUAL(STATUS_OK, VM_compile(PARSE_get_tree_list(), SYMBOL_TABLE_get_num_symbols(), &program));
+
+	TEST_ASSERT_EQUAL(STATUS_FAILED, VM_run(&program, (uint32_t *)pu64_variables));
+
+	for (uint32_t i = 0; i < VM_MAX_VARIABLES; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT64(0, pu64_variables[i]);
+	}
+
+	VM_release(&program);
+}
+
+/****************************************************************************************************
+ *	M A I N
+ ****************************************************************************************************/
+
+static void run_all_tests(void)
+{
+	RUN_TEST_CASE(unit_vm, test_run_nominal);
+	RUN_TEST_CASE(unit_vm, test_superinstructions);
+	RUN_TEST_CASE(unit_vm, test_division_by_zero);
+	RUN_TEST_CASE(unit_vm, test_matches_native);
+	RUN_TEST_CASE(unit_vm, test_typed_matches_native);
+	RUN_TEST_CASE(unit_vm, test_signed_division_overflow);
+}
+
+int main(int argc, const char * argv[])
+{
+	return UnityMain(argc, argv, run_all_tests);
+}
@@ -0,0 +1,539 @@
+#include "tile.h"
+#include "strength.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_TILE
+#define TILE_DBG(fmt, ...)				printf(BOLD("TILE:\t")fmt, ##__VA_ARGS__)
+#define TILE_GREEN(fmt, ...)			printf(BOLD(BRIGHT_GREEN("TILE:\t"))fmt, ##__VA_ARGS__)
+#define TILE_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("TILE:\t"))fmt, ##__VA_ARGS__)
+#define TILE_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("TILE:\t"))fmt, ##__VA_ARGS__)
+#else
+#define TILE_DBG(fmt, ...)
+#define TILE_GREEN(fmt, ...)
+#define TILE_WARN(fmt, ...)
+#define TILE_ERR(fmt, ...)
+#endif
+
+#define TILE_INDEX(u32_value, nonterminal)	(((size_t)(u32_value) * TILE_NT_NUM_NONTERMINALS) + (nonterminal))
+#define TILE_STORE_NONE						(UINT32_MAX)
+
+/*
+ *	Copying the left operand first, when something else still needs it
+ */
+#define TILE_COPY_COST						(1)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+typedef struct
+{
+	const IR_program_t *	kp_program;
+	const IR_def_use_t *	kp_def_use;
+	TILE_cover_t *			p_cover;
+	uint32_t *				pu32_last_store;		// Per variable, the last store seen so far
+	uint32_t				u32_start;				// Instructions covered: [u32_start, u32_end)
+	uint32_t				u32_end;
+	uint32_t				u32_cost;
+} TILE_info_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	Rough cycles each tile adds on top of its operands. Reading a variable in place still costs the
+ *	load, it just saves the register and the instruction, which ties go to. Immediate forms of
+ *	multiply and divide are strength reduced, and cost whatever that comes to
+ */
+static const uint8_t pk_rule_costs[IR_OPCODE_NUM_OPCODES][TILE_RULE_NUM_RULES] =
+{
+	[IR_OPCODE_CONST]	= { [TILE_RULE_CONST] = 1, [TILE_RULE_IMMEDIATE] = 0 },
+	[IR_OPCODE_LOAD]	= { [TILE_RULE_LOAD] = 1, [TILE_RULE_MEMORY] = 1 },
+	[IR_OPCODE_ADD]		= { [TILE_RULE_REG_REG] = 1, [TILE_RULE_REG_IMM] = 1, [TILE_RULE_REG_MEM] = 1, [TILE_RULE_LEA] = 1 },
+	[IR_OPCODE_SUB]		= { [TILE_RULE_REG_REG] = 1, [TILE_RULE_REG_IMM] = 1, [TILE_RULE_REG_MEM] = 1 },
+	[IR_OPCODE_MUL]		= { [TILE_RULE_INDEX] = 0, [TILE_RULE_REG_REG] = 3, [TILE_RULE_REG_MEM] = 3 },
+	[IR_OPCODE_DIV]		= { [TILE_RULE_REG_REG] = 26, [TILE_RULE_REG_MEM] = 26 },
+	[IR_OPCODE_VLOAD]	= { [TILE_RULE_VECTOR] = 1 },
+	[IR_OPCODE_VSPLAT]	= { [TILE_RULE_VECTOR] = 3 },
+	[IR_OPCODE_VADD]	= { [TILE_RULE_VECTOR] = 1 },
+	[IR_OPCODE_VSUB]	= { [TILE_RULE_VECTOR] = 1 },
+};
+
+static const uint8_t pk_divide_costs[] =
+{
+	[STRENGTH_DIVIDE_SHIFT]			= 1,
+	[STRENGTH_DIVIDE_MULTIPLY]		= 5,
+	[STRENGTH_DIVIDE_MULTIPLY_ADD]	= 9,
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 			TILE_label						(TILE_info_t * p_info);
+static void 			TILE_label_binary				(TILE_info_t * p_info, uint32_t u32_index);
+static void 			TILE_label_index				(TILE_info_t * p_info, const IR_instruction_t * kp_instruction);
+static void 			TILE_label_vector				(TILE_info_t * p_info, const IR_instruction_t * kp_instruction);
+static void 			TILE_reduce						(TILE_info_t * p_info);
+static uint32_t 		TILE_get_rule_cost				(const TILE_info_t * kp_info, const IR_instruction_t * kp_instruction, uint8_t u8_rule);
+static uint32_t 		TILE_get_operand_cost			(const TILE_info_t * kp_info, uint32_t u32_value, TILE_nonterminal_t nonterminal);
+static bool 			TILE_takes_immediate			(const IR_instruction_t * kp_instruction, uint32_t u32_immediate);
+static bool 			TILE_is_foldable_load			(const TILE_info_t * kp_info, uint32_t u32_value);
+static const IR_instruction_t * TILE_get_def			(const TILE_info_t * kp_info, uint32_t u32_value);
+static inline void 		TILE_offer						(TILE_info_t * p_info, uint32_t u32_value, TILE_nonterminal_t nonterminal, uint32_t u32_cost, uint8_t u8_rule);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	BURS-style tiling over the expression trees in the IR. A forward pass labels each value with
+ *	the cheapest rule for every nonterminal it could be used as, given what its operands can be;
+ *	a backward pass then starts from the roots (stored values, values with several users and
+ *	divisions kept only to fault), which must be in registers, and records which nonterminal each
+ *	operand is actually taken as
+ */
+void TILE_cover(const IR_program_t * kp_program, const IR_def_use_t * kp_def_use, TILE_cover_t * p_cover)
+{
+	TILE_init_cover(kp_program, p_cover);
+	p_cover->u32_cost = TILE_cover_range(kp_program, kp_def_use, 0, kp_program->u32_num_instructions, p_cover);
+
+	TILE_DBG("Covered %u values at an estimated %u cycles\n", p_cover->u32_num_values, p_cover->u32_cost);
+}
+
+/*
+ *	Sizes a cover for the program, with nothing tiled yet
+ */
+void TILE_init_cover(const IR_program_t * kp_program, TILE_cover_t * p_cover)
+{
+	size_t num_entries = ((size_t)kp_program->u32_num_values * TILE_NT_NUM_NONTERMINALS) + 1;
+
+	p_cover->u32_num_values = kp_program->u32_num_values;
+	p_cover->u32_cost = 0;
+	p_cover->pu8_rules = calloc(num_entries, sizeof(uint8_t));
+	p_cover->pu8_needed = calloc(kp_program->u32_num_values + 1, sizeof(uint8_t));
+	p_cover->pu32_costs = malloc(sizeof(uint32_t) * num_entries);
+	ASSERT(p_cover->pu8_rules && p_cover->pu8_needed && p_cover->pu32_costs);
+}
+
+/*
+ *	Tiles instructions [u32_start, u32_end), which must use no value defined outside them, and
+ *	returns the cost. Disjoint ranges only touch their own values, so they can be tiled at once
+ */
+uint32_t TILE_cover_range(const IR_program_t * kp_program, const IR_def_use_t * kp_def_use, uint32_t u32_start, uint32_t u32_end, TILE_cover_t * p_cover)
+{
+	TILE_info_t info = { .kp_program = kp_program, .kp_def_use = kp_def_use, .p_cover = p_cover, .u32_start = u32_start, .u32_end = u32_end };
+	uint32_t u32_num_variables = 0;
+	const IR_instruction_t * kp_instruction;
+
+	for (uint32_t i = u32_start; i < u32_end; i++)
+	{
+		kp_instruction = &kp_program->p_instructions[i];
+
+		if ((kp_instruction->u8_opcode == IR_OPCODE_LOAD || kp_instruction->u8_opcode == IR_OPCODE_STORE) &&
+			kp_instruction->u32_immediate >= u32_num_variables)
+		{
+			u32_num_variables = kp_instruction->u32_immediate + 1;
+		}
+		else if ((kp_instruction->u8_opcode == IR_OPCODE_VLOAD || kp_instruction->u8_opcode == IR_OPCODE_VSTORE) &&
+			kp_instruction->u32_immediate + IR_VECTOR_LANES > u32_num_variables)
+		{
+			u32_num_variables = kp_instruction->u32_immediate + IR_VECTOR_LANES;
+		}
+	}
+
+	info.pu32_last_store = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	ASSERT(info.pu32_last_store);
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		info.pu32_last_store[i] = TILE_STORE_NONE;
+	}
+
+	TILE_label(&info);
+	TILE_reduce(&info);
+
+	free(info.pu32_last_store);
+
+	return info.u32_cost;
+}
+
+void TILE_deinit_cover(TILE_cover_t * p_cover)
+{
+	free(p_cover->pu8_rules);
+	free(p_cover->pu8_needed);
+	free(p_cover->pu32_costs);
+	p_cover->pu8_rules = NULL;
+	p_cover->pu8_needed = NULL;
+	p_cover->pu32_costs = NULL;
+	p_cover->u32_num_values = 0;
+}
+
+/*
+ *	The rule, swap flag included, that derives `nonterminal` for the value
+ */
+uint8_t TILE_get_rule(const TILE_cover_t * kp_cover, uint32_t u32_value, TILE_nonterminal_t nonterminal)
+{
+	return kp_cover->pu8_rules[TILE_INDEX(u32_value, nonterminal)];
+}
+
+/*
+ *	Whether any user takes the value as `nonterminal`. Values needed as no register are emitted
+ *	by their user, if at all
+ */
+bool TILE_is_needed(const TILE_cover_t * kp_cover, uint32_t u32_value, TILE_nonterminal_t nonterminal)
+{
+	return (kp_cover->pu8_needed[u32_value] & (1u << nonterminal)) != 0;
+}
+
+/*
+ *	The lea index scale a constant multiplier is, or 0 if it isn't one
+ */
+uint8_t TILE_get_scale(uint32_t u32_constant)
+{
+	return (u32_constant == 2 || u32_constant == 4 || u32_constant == 8) ? (uint8_t)u32_constant : 0;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Forward over the range: every value's operands are labeled before it is
+ */
+static void TILE_label(TILE_info_t * p_info)
+{
+	const IR_instruction_t * kp_instruction;
+	uint32_t u32_value;
+
+	for (uint32_t i = p_info->u32_start; i < p_info->u32_end; i++)
+	{
+		kp_instruction = &p_info->kp_program->p_instructions[i];
+		u32_value = kp_instruction->u32_result;
+
+		if (u32_value != IR_VALUE_NONE)
+		{
+			for (uint32_t nt = 0; nt < TILE_NT_NUM_NONTERMINALS; nt++)
+			{
+				p_info->p_cover->pu32_costs[TILE_INDEX(u32_value, nt)] = TILE_COST_INFINITE;
+				p_info->p_cover->pu8_rules[TILE_INDEX(u32_value, nt)] = TILE_RULE_NONE;
+			}
+		}
+
+		switch (kp_instruction->u8_opcode)
+		{
+			case IR_OPCODE_CONST:
+			{
+				TILE_offer(p_info, u32_value, TILE_NT_REG, TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_CONST), TILE_RULE_CONST);
+				TILE_offer(p_info, u32_value, TILE_NT_IMM, TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_IMMEDIATE), TILE_RULE_IMMEDIATE);
+				break;
+			}
+			case IR_OPCODE_LOAD:
+			{
+				TILE_offer(p_info, u32_value, TILE_NT_REG, TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_LOAD), TILE_RULE_LOAD);
+				TILE_offer(p_info, u32_value, TILE_NT_MEM, TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_MEMORY), TILE_RULE_MEMORY);
+				break;
+			}
+			case IR_OPCODE_STORE:
+			{
+				p_info->pu32_last_store[kp_instruction->u32_immediate] = i;
+				break;
+			}
+			case IR_OPCODE_VSTORE:
+			{
+				// Any load of a lane still waiting for its user has to be read before this
+				for (uint32_t j = 0; j < IR_VECTOR_LANES; j++)
+				{
+					p_info->pu32_last_store[kp_instruction->u32_immediate + j] = i;
+				}
+				break;
+			}
+			case IR_OPCODE_VLOAD:
+			case IR_OPCODE_VSPLAT:
+			case IR_OPCODE_VADD:
+			case IR_OPCODE_VSUB:
+			{
+				TILE_label_vector(p_info, kp_instruction);
+				break;
+			}
+			default:
+			{
+				TILE_label_binary(p_info, i);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *	Tries every tile rooted at an arithmetic instruction, both ways round if it commutes
+ */
+static void TILE_label_binary(TILE_info_t * p_info, uint32_t u32_index)
+{
+	const IR_instruction_t * kp_instruction = &p_info->kp_program->p_instructions[u32_index];
+	bool b_commutative = (kp_instruction->u8_opcode == IR_OPCODE_ADD || kp_instruction->u8_opcode == IR_OPCODE_MUL);
+	uint32_t u32_value = kp_instruction->u32_result;
+	const IR_instruction_t * kp_right_def;
+	uint32_t u32_left_cost;
+	uint32_t u32_left;
+	uint32_t u32_right;
+	uint8_t u8_swapped;
+
+	if (kp_instruction->u8_opcode == IR_OPCODE_MUL)
+	{
+		TILE_label_index(p_info, kp_instruction);
+	}
+
+	for (uint32_t i = 0; i < (b_commutative ? 2u : 1u); i++)
+	{
+		u32_left = kp_instruction->pu32_operands[i];
+		u32_right = kp_instruction->pu32_operands[1 - i];
+		u8_swapped = (i == 1) ? TILE_RULE_SWAPPED : 0;
+		kp_right_def = TILE_get_def(p_info, u32_right);
+
+		// Two-address: the result overwrites the left operand, which is copied first if anything else reads it
+		u32_left_cost = TILE_get_operand_cost(p_info, u32_left, TILE_NT_REG) +
+						((IR_get_num_uses(p_info->kp_def_use, u32_left) > 1) ? TILE_COPY_COST : 0);
+
+		// Folded forms first, so they win ties. Nothing folds into an instruction that also reads it as its other operand
+		if (u32_left != u32_right)
+		{
+			if (kp_right_def->u8_opcode == IR_OPCODE_CONST && TILE_takes_immediate(kp_instruction, kp_right_def->u32_immediate))
+			{
+				TILE_offer(p_info, u32_value, TILE_NT_REG,
+					u32_left_cost + TILE_get_operand_cost(p_info, u32_right, TILE_NT_IMM) + TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_REG_IMM | u8_swapped),
+					TILE_RULE_REG_IMM | u8_swapped);
+			}
+
+			if (TILE_is_foldable_load(p_info, u32_right))
+			{
+				TILE_offer(p_info, u32_value, TILE_NT_REG,
+					u32_left_cost + TILE_get_operand_cost(p_info, u32_right, TILE_NT_MEM) + TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_REG_MEM),
+					TILE_RULE_REG_MEM | u8_swapped);
+			}
+
+			if (kp_instruction->u8_opcode == IR_OPCODE_ADD && IR_get_num_uses(p_info->kp_def_use, u32_right) == 1)
+			{
+				TILE_offer(p_info, u32_value, TILE_NT_REG,
+					u32_left_cost + TILE_get_operand_cost(p_info, u32_right, TILE_NT_INDEX) + TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_LEA),
+					TILE_RULE_LEA | u8_swapped);
+			}
+		}
+
+		TILE_offer(p_info, u32_value, TILE_NT_REG,
+			u32_left_cost + TILE_get_operand_cost(p_info, u32_right, TILE_NT_REG) + TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_REG_REG),
+			TILE_RULE_REG_REG | u8_swapped);
+	}
+}
+
+/*
+ *	x * 2, 4 or 8 can be an lea's index, if it has nothing else to be
+ */
+static void TILE_label_index(TILE_info_t * p_info, const IR_instruction_t * kp_instruction)
+{
+	const IR_instruction_t * kp_def;
+	uint32_t u32_other;
+
+	if (kp_instruction->pu32_operands[0] == kp_instruction->pu32_operands[1])
+	{
+		return;
+	}
+
+	for (uint32_t i = IR_MAX_OPERANDS; i > 0; i--)
+	{
+		kp_def = TILE_get_def(p_info, kp_instruction->pu32_operands[i - 1]);
+		u32_other = kp_instruction->pu32_operands[2 - i];
+
+		if (kp_def->u8_opcode == IR_OPCODE_CONST && TILE_get_scale(kp_def->u32_immediate) != 0)
+		{
+			TILE_offer(p_info, kp_instruction->u32_result, TILE_NT_INDEX,
+				TILE_get_operand_cost(p_info, u32_other, TILE_NT_REG) + TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_INDEX),
+				TILE_RULE_INDEX | ((i == 1) ? TILE_RULE_SWAPPED : 0));
+			return;
+		}
+	}
+}
+
+/*
+ *	Vector values only ever live in xmm registers, and nothing folds into vector instructions
+ */
+static void TILE_label_vector(TILE_info_t * p_info, const IR_instruction_t * kp_instruction)
+{
+	uint32_t u32_cost = TILE_get_rule_cost(p_info, kp_instruction, TILE_RULE_VECTOR);
+
+	for (uint32_t i = 0; i < IR_MAX_OPERANDS; i++)
+	{
+		if (kp_instruction->pu32_operands[i] != IR_VALUE_NONE)
+		{
+			u32_cost += TILE_get_operand_cost(p_info, kp_instruction->pu32_operands[i], TILE_NT_REG);
+		}
+	}
+
+	TILE_offer(p_info, kp_instruction->u32_result, TILE_NT_REG, u32_cost, TILE_RULE_VECTOR);
+}
+
+/*
+ *	Walks from the users back to the definitions, deciding what each value is taken as. Roots are
+ *	always registers; the rule that derives a value tells what it needs of its operands
+ */
+static void TILE_reduce(TILE_info_t * p_info)
+{
+	static const uint8_t pk_operand_nonterminals[TILE_RULE_NUM_RULES][IR_MAX_OPERANDS] =
+	{
+		[TILE_RULE_REG_REG]	= { TILE_NT_REG, TILE_NT_REG },
+		[TILE_RULE_REG_IMM]	= { TILE_NT_REG, TILE_NT_IMM },
+		[TILE_RULE_REG_MEM]	= { TILE_NT_REG, TILE_NT_MEM },
+		[TILE_RULE_LEA]		= { TILE_NT_REG, TILE_NT_INDEX },
+		[TILE_RULE_VECTOR]	= { TILE_NT_REG, TILE_NT_REG },
+	};
+	TILE_cover_t * p_cover = p_info->p_cover;
+	const IR_instruction_t * kp_instruction;
+	uint32_t u32_value;
+	uint8_t u8_rule;
+	uint32_t u32_left;
+	uint32_t u32_right;
+
+	for (uint32_t i = p_info->u32_end; i > p_info->u32_start; i--)
+	{
+		kp_instruction = &p_info->kp_program->p_instructions[i - 1];
+		u32_value = kp_instruction->u32_result;
+
+		if (kp_instruction->u8_opcode == IR_OPCODE_STORE || kp_instruction->u8_opcode == IR_OPCODE_VSTORE)
+		{
+			p_cover->pu8_needed[kp_instruction->pu32_operands[0]] |= (1u << TILE_NT_REG);
+			continue;
+		}
+
+		// A division nothing uses is only left in because it can fault, so it still has to run
+		if (kp_instruction->u8_opcode == IR_OPCODE_DIV && IR_get_num_uses(p_info->kp_def_use, u32_value) == 0)
+		{
+			p_cover->pu8_needed[u32_value] |= (1u << TILE_NT_REG);
+		}
+
+		for (uint32_t nt = 0; nt < TILE_NT_NUM_NONTERMINALS; nt++)
+		{
+			if (!TILE_is_needed(p_cover, u32_value, nt))
+			{
+				continue;
+			}
+
+			u8_rule = TILE_get_rule(p_cover, u32_value, nt);
+			ASSERT((u8_rule & TILE_RULE_MASK) != TILE_RULE_NONE);
+			p_info->u32_cost += TILE_get_rule_cost(p_info, kp_instruction, u8_rule);
+
+			if (kp_instruction->u8_opcode == IR_OPCODE_CONST || kp_instruction->u8_opcode == IR_OPCODE_LOAD ||
+				kp_instruction->u8_opcode == IR_OPCODE_VLOAD || kp_instruction->u8_opcode == IR_OPCODE_VSPLAT)
+			{
+				continue;
+			}
+
+			u32_left = kp_instruction->pu32_operands[(u8_rule & TILE_RULE_SWAPPED) ? 1 : 0];
+			u32_right = kp_instruction->pu32_operands[(u8_rule & TILE_RULE_SWAPPED) ? 0 : 1];
+
+			// An index only needs the register it scales; the constant is built into the lea
+			if ((u8_rule & TILE_RULE_MASK) == TILE_RULE_INDEX)
+			{
+				p_cover->pu8_needed[u32_left] |= (1u << TILE_NT_REG);
+				continue;
+			}
+
+			p_cover->pu8_needed[u32_left] |= (1u << pk_operand_nonterminals[u8_rule & TILE_RULE_MASK][0]);
+			p_cover->pu8_needed[u32_right] |= (1u << pk_operand_nonterminals[u8_rule & TILE_RULE_MASK][1]);
+		}
+	}
+}
+
+static uint32_t TILE_get_rule_cost(const TILE_info_t * kp_info, const IR_instruction_t * kp_instruction, uint8_t u8_rule)
+{
+	const IR_instruction_t * kp_constant;
+	STRENGTH_multiply_t multiply;
+	STRENGTH_divide_t divide;
+
+	if ((u8_rule & TILE_RULE_MASK) != TILE_RULE_REG_IMM || kp_instruction->u8_opcode == IR_OPCODE_ADD || kp_instruction->u8_opcode == IR_OPCODE_SUB)
+	{
+		return pk_rule_costs[kp_instruction->u8_opcode][u8_rule & TILE_RULE_MASK];
+	}
+
+	kp_constant = TILE_get_def(kp_info, kp_instruction->pu32_operands[(u8_rule & TILE_RULE_SWAPPED) ? 0 : 1]);
+
+	if (kp_instruction->u8_opcode == IR_OPCODE_MUL)
+	{
+		STRENGTH_plan_multiply(kp_constant->u32_immediate, &multiply);
+		return multiply.b_imul ? 3 : ((multiply.u8_num_steps > 0) ? multiply.u8_num_steps : 1);
+	}
+
+	STRENGTH_plan_divide(kp_constant->u32_immediate, &divide);
+	return pk_divide_costs[divide.u8_kind];
+}
+
+/*
+ *	What using a value as `nonterminal` adds. A register with several users is paid for once, at its
+ *	root, and immediates are free wherever they're used
+ */
+static uint32_t TILE_get_operand_cost(const TILE_info_t * kp_info, uint32_t u32_value, TILE_nonterminal_t nonterminal)
+{
+	if (nonterminal == TILE_NT_REG && IR_get_num_uses(kp_info->kp_def_use, u32_value) > 1)
+	{
+		return 0;
+	}
+
+	return kp_info->p_cover->pu32_costs[TILE_INDEX(u32_value, nonterminal)];
+}
+
+/*
+ *	Whether the constant can be the instruction's immediate. 64-bit instructions sign extend theirs
+ *	from 32 bits, and only unsigned 32-bit divides by nonzero constants have a plan
+ */
+static bool TILE_takes_immediate(const IR_instruction_t * kp_instruction, uint32_t u32_immediate)
+{
+	if (BUILTINS_get_size(kp_instruction->u8_type) == sizeof(uint64_t) && u32_immediate > INT32_MAX)
+	{
+		return false;
+	}
+
+	return kp_instruction->u8_opcode != IR_OPCODE_DIV || (kp_instruction->u8_type == BUILTINS_TYPE_U32 && u32_immediate != 0);
+}
+
+/*
+ *	A load can be read in place by its only user, as long as nothing stored to the variable in between
+ *	and the variable is as wide as what the statement computes in
+ */
+static bool TILE_is_foldable_load(const TILE_info_t * kp_info, uint32_t u32_value)
+{
+	uint32_t u32_def = kp_info->kp_def_use->pu32_def[u32_value];
+	const IR_instruction_t * kp_def = &kp_info->kp_program->p_instructions[u32_def];
+	uint32_t u32_last_store;
+
+	if (kp_def->u8_opcode != IR_OPCODE_LOAD || IR_get_num_uses(kp_info->kp_def_use, u32_value) != 1 ||
+		BUILTINS_get_size(kp_def->u8_variable_type) != BUILTINS_get_size(kp_def->u8_type))
+	{
+		return false;
+	}
+
+	u32_last_store = kp_info->pu32_last_store[kp_def->u32_immediate];
+
+	return u32_last_store == TILE_STORE_NONE || u32_last_store < u32_def;
+}
+
+static const IR_instruction_t * TILE_get_def(const TILE_info_t * kp_info, uint32_t u32_value)
+{
+	return &kp_info->kp_program->p_instructions[kp_info->kp_def_use->pu32_def[u32_value]];
+}
+
+/*
+ *	Keeps the rule if it's cheaper than the best so far
+ */
+static inline void TILE_offer(TILE_info_t * p_info, uint32_t u32_value, TILE_nonterminal_t nonterminal, uint32_t u32_cost, uint8_t u8_rule)
+{
+	size_t index = TILE_INDEX(u32_value, nonterminal);
+
+	if (u32_cost < p_info->p_cover->pu32_costs[index])
+	{
+		p_info->p_cover->pu32_costs[index] = u32_cost;
+		p_info->p_cover->pu8_rules[index] = u8_rule;
+	}
+}
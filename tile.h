@@ -0,0 +1,82 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include "common.h"
+#include "ir.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+/*
+ *	Set in a rule when a commutative instruction's operands are used the other way round, so that
+ *	the folded one is on the right
+ */
+#define TILE_RULE_SWAPPED				(0x80)
+#define TILE_RULE_MASK					(0x7F)
+
+#define TILE_COST_INFINITE				(UINT32_MAX / 4)
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	What an instruction's user can take its value as
+ */
+typedef enum
+{
+	TILE_NT_REG = 0,				// In a register
+	TILE_NT_IMM,					// An immediate: constants only
+	TILE_NT_MEM,					// The variable it was loaded from, read in place
+	TILE_NT_INDEX,					// A register times 2, 4 or 8, as the index of an lea
+	//////////////////////////////
+	TILE_NT_NUM_NONTERMINALS
+} TILE_nonterminal_t;
+
+/*
+ *	Tiles, each covering an instruction and whatever its operands folded into it
+ */
+typedef enum
+{
+	TILE_RULE_NONE = 0,
+	TILE_RULE_CONST,				// reg: CONST						mov $c, r
+	TILE_RULE_IMMEDIATE,			// imm: CONST						(folded)
+	TILE_RULE_LOAD,					// reg: LOAD						mov var, r
+	TILE_RULE_MEMORY,				// mem: LOAD						(folded)
+	TILE_RULE_INDEX,				// index: MUL(reg, CONST 2|4|8)		(folded)
+	TILE_RULE_REG_REG,				// reg: op(reg, reg)
+	TILE_RULE_REG_IMM,				// reg: op(reg, imm)				immediate form, or strength reduced
+	TILE_RULE_REG_MEM,				// reg: op(reg, mem)				memory source operand
+	TILE_RULE_LEA,					// reg: ADD(reg, index)				lea (r, index, scale), r
+	TILE_RULE_VECTOR,				// reg: any vector instruction		in an xmm register, operands too
+	//////////////////////////////
+	TILE_RULE_NUM_RULES
+} TILE_rule_t;
+
+/*
+ *	The cheapest cover of the program's expression trees. Every value is a tree root if more than
+ *	one instruction uses it; otherwise its single user can fold it in
+ */
+typedef struct _TILE_cover
+{
+	uint8_t *	pu8_rules;			// Per value and nonterminal: the cheapest rule deriving it, or TILE_RULE_NONE
+	uint8_t *	pu8_needed;			// Per value: a bit per nonterminal its users ended up taking it as
+	uint32_t *	pu32_costs;			// Per value and nonterminal: the cost of that cheapest rule, operands included
+	uint32_t	u32_num_values;
+	uint32_t	u32_cost;			// Estimated cycles of the whole cover
+} TILE_cover_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+void 			TILE_cover						(const IR_program_t * kp_program, const IR_def_use_t * kp_def_use, TILE_cover_t * p_cover);
+void 			TILE_init_cover					(const IR_program_t * kp_program, TILE_cover_t * p_cover);
+uint32_t 		TILE_cover_range				(const IR_program_t * kp_program, const IR_def_use_t * kp_def_use, uint32_t u32_start, uint32_t u32_end, TILE_cover_t * p_cover);
+void 			TILE_deinit_cover				(TILE_cover_t * p_cover);
+uint8_t 		TILE_get_rule					(const TILE_cover_t * kp_cover, uint32_t u32_value, TILE_nonterminal_t nonterminal);
+bool 			TILE_is_needed					(const TILE_cover_t * kp_cover, uint32_t u32_value, TILE_nonterminal_t nonterminal);
+uint8_t 		TILE_get_scale					(uint32_t u32_constant);
+
+#endif
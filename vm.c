@@ -0,0 +1,690 @@
+#include "vm.h"
+#include "ir.h"
+#include "symbol_table.h"
+
+/****************************************************************************************************
+ *	D E F I N E S
+ ****************************************************************************************************/
+
+#ifdef DEBUG_VM
+#define VM_DBG(fmt, ...)				printf(BOLD("VM:\t")fmt, ##__VA_ARGS__)
+#define VM_GREEN(fmt, ...)				printf(BOLD(BRIGHT_GREEN("VM:\t"))fmt, ##__VA_ARGS__)
+#define VM_WARN(fmt, ...)				printf(BOLD(BRIGHT_YELLOW("VM:\t"))fmt, ##__VA_ARGS__)
+#define VM_ERR(fmt, ...)				printf(BOLD(BRIGHT_RED("VM:\t"))fmt, ##__VA_ARGS__)
+#else
+#define VM_DBG(fmt, ...)
+#define VM_GREEN(fmt, ...)
+#define VM_WARN(fmt, ...)
+#define VM_ERR(fmt, ...)
+#endif
+
+#define VM_INITIAL_PROGRAM_SIZE			(64)
+#define VM_SLOT_NONE					(UINT32_MAX)
+
+/*
+ *	Handlers end by jumping straight to the next instruction's handler
+ */
+#define VM_DISPATCH()					goto *(++kp_instruction)->kp_handler
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Where a lowered subtree left its value: a slot, or an immediate for a literal
+ */
+typedef struct
+{
+	bool		b_immediate;
+	uint32_t	u32_value;
+} VM_operand_t;
+
+/****************************************************************************************************
+ *	S T A T I C   V A R I A B L E S
+ ****************************************************************************************************/
+
+/*
+ *	Per type a statement is computed in, the register-register form of each operator, then the
+ *	immediate-right and immediate-left forms. Immediate-left add and multiply commute to
+ *	immediate-right. Only division cares about sign
+ */
+static const VM_opcode_t pk_binary_opcodes[BUILTINS_TYPE_NUM_TYPES][PARSE_NODE_TYPE_NUM_TYPES][3] =
+{
+	[BUILTINS_TYPE_U32] =
+	{
+		[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= { VM_OPCODE_ADD, VM_OPCODE_ADD_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= { VM_OPCODE_SUB, VM_OPCODE_SUB_I, VM_OPCODE_SUB_FROM_I },
+		[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= { VM_OPCODE_MUL, VM_OPCODE_MUL_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= { VM_OPCODE_DIV, VM_OPCODE_DIV_I, VM_OPCODE_DIV_FROM_I },
+	},
+	[BUILTINS_TYPE_I32] =
+	{
+		[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= { VM_OPCODE_ADD, VM_OPCODE_ADD_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= { VM_OPCODE_SUB, VM_OPCODE_SUB_I, VM_OPCODE_SUB_FROM_I },
+		[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= { VM_OPCODE_MUL, VM_OPCODE_MUL_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= { VM_OPCODE_DIV_S32, VM_OPCODE_DIV_S32_I, VM_OPCODE_DIV_FROM_S32_I },
+	},
+	[BUILTINS_TYPE_U64] =
+	{
+		[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= { VM_OPCODE_ADD64, VM_OPCODE_ADD64_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= { VM_OPCODE_SUB64, VM_OPCODE_SUB64_I, VM_OPCODE_SUB64_FROM_I },
+		[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= { VM_OPCODE_MUL64, VM_OPCODE_MUL64_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= { VM_OPCODE_DIV_U64, VM_OPCODE_DIV_U64_I, VM_OPCODE_DIV_FROM_U64_I },
+	},
+	[BUILTINS_TYPE_I64] =
+	{
+		[PARSE_NODE_TYPE_EXPR_TYPE_ADD]			= { VM_OPCODE_ADD64, VM_OPCODE_ADD64_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_SUBTRACT]	= { VM_OPCODE_SUB64, VM_OPCODE_SUB64_I, VM_OPCODE_SUB64_FROM_I },
+		[PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY]	= { VM_OPCODE_MUL64, VM_OPCODE_MUL64_I, VM_OPCODE_HALT },
+		[PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE]		= { VM_OPCODE_DIV_S64, VM_OPCODE_DIV_S64_I, VM_OPCODE_DIV_FROM_S64_I },
+	},
+};
+
+/*
+ *	Multiply-add with the product's right operand in a slot, then as an immediate
+ */
+static const VM_opcode_t pk_multiply_add_opcodes[BUILTINS_TYPE_NUM_TYPES][2] =
+{
+	[BUILTINS_TYPE_U32]	= { VM_OPCODE_MUL_ADD, VM_OPCODE_MUL_I_ADD },
+	[BUILTINS_TYPE_I32]	= { VM_OPCODE_MUL_ADD, VM_OPCODE_MUL_I_ADD },
+	[BUILTINS_TYPE_U64]	= { VM_OPCODE_MUL64_ADD, VM_OPCODE_MUL64_I_ADD },
+	[BUILTINS_TYPE_I64]	= { VM_OPCODE_MUL64_ADD, VM_OPCODE_MUL64_I_ADD },
+};
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N   P R O T O T Y P E S
+ ****************************************************************************************************/
+
+static void 			VM_emit						(VM_program_t * p_program, VM_opcode_t opcode, uint32_t u32_dst, uint32_t u32_left, uint32_t u32_right, uint32_t u32_addend);
+static VM_operand_t 	VM_lower_expression			(const PARSE_node_t * kp_node, uint32_t u32_dst, uint32_t u32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program);
+static VM_operand_t 	VM_lower_operand			(const PARSE_node_t * kp_node, uint32_t * pu32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program);
+static bool 			VM_lower_multiply_add		(const PARSE_node_t * kp_node, uint32_t u32_dst, uint32_t u32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program);
+static void 			VM_emit_binary				(PARSE_node_type_t type, uint32_t u32_dst, VM_operand_t left, VM_operand_t right, uint32_t u32_temp,
+														BUILTINS_type_t builtin_type, VM_program_t * p_program);
+static STATUS_t 		VM_check_division			(int64_t s64_dividend, int64_t s64_divisor, int64_t s64_min);
+static STATUS_t 		VM_execute					(const VM_instruction_t * kp_instruction, uint64_t * pu64_slots, const void * const ** pppk_handlers);
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+/*
+ *	Lowers every assignment straight from its tree, in the type the statement is computed in, then
+ *	threads the code. Bare expressions are dropped: nothing can observe them. Malformed statements
+ *	are skipped, as IR_lower does. Slots hold each variable as its type reads, sign or zero
+ *	extended, so a variable narrower than what wrote it is converted after
+ */
+STATUS_t VM_compile(const PARSE_tree_list_t * kp_tree_list, uint32_t u32_num_variables, VM_program_t * p_program)
+{
+	const SYMBOL_TABLE_entry_t * kp_symbols = SYMBOL_TABLE_get_symbol_table();
+	const PARSE_node_t * kp_tree;
+	const void * const * kpk_handlers;
+	BUILTINS_type_t builtin_type;
+	BUILTINS_type_t target_type;
+	BUILTINS_type_t written_type;
+	VM_operand_t operand;
+	uint32_t u32_target;
+
+	p_program->u32_num_instructions = 0;
+	p_program->u32_capacity = VM_INITIAL_PROGRAM_SIZE;
+	p_program->u32_num_variables = u32_num_variables;
+	p_program->u32_num_slots = u32_num_variables;
+	p_program->p_instructions = malloc(sizeof(VM_instruction_t) * p_program->u32_capacity);
+	p_program->pu8_opcodes = malloc(sizeof(uint8_t) * p_program->u32_capacity);
+	p_program->pu32_offsets = malloc(sizeof(uint32_t) * (u32_num_variables + 1));
+	p_program->pu8_types = malloc(sizeof(uint8_t) * (u32_num_variables + 1));
+	ASSERT(p_program->p_instructions && p_program->pu8_opcodes && p_program->pu32_offsets && p_program->pu8_types);
+
+	for (uint32_t i = 0; i < u32_num_variables; i++)
+	{
+		p_program->pu32_offsets[i] = SYMBOL_TABLE_get_offset(i);
+		p_program->pu8_types[i] = (uint8_t)kp_symbols[i].builtin_type;
+	}
+
+	for (uint32_t i = 0; i < kp_tree_list->u32_num_trees; i++)
+	{
+		kp_tree = kp_tree_list->trees[i];
+
+		if (!IR_tree_is_valid(kp_tree))
+		{
+			VM_ERR("Skipping malformed statement\n");
+			continue;
+		}
+
+		if (kp_tree->type != PARSE_NODE_TYPE_STATEMENT_TYPE_ASSIGNMENT)
+		{
+			continue;
+		}
+
+		u32_target = SYMBOL_TABLE_lookup(kp_tree->p_left->p_token->pc_lexeme);
+		ASSERT(u32_target < u32_num_variables);
+		target_type = kp_symbols[u32_target].builtin_type;
+		builtin_type = IR_get_statement_type(kp_tree);
+		builtin_type = (builtin_type == BUILTINS_TYPE_NUM_TYPES) ? BUILTINS_TYPE_U32 : builtin_type;
+
+		// 32-bit forms leave their result zero extended, 64-bit ones leave all of it
+		written_type = (BUILTINS_get_size(builtin_type) == sizeof(uint64_t)) ? builtin_type : BUILTINS_TYPE_U32;
+
+		// The operator at the root writes the variable itself. A bare literal or variable is copied in
+		operand = VM_lower_expression(kp_tree->p_right, u32_target, u32_num_variables, builtin_type, p_program);
+
+		if (operand.b_immediate)
+		{
+			VM_emit(p_program, VM_OPCODE_LOADK, u32_target, VM_SLOT_NONE, operand.u32_value, VM_SLOT_NONE);
+		}
+		else if (operand.u32_value != u32_target)
+		{
+			VM_emit(p_program, VM_OPCODE_MOV, u32_target, operand.u32_value, VM_SLOT_NONE, VM_SLOT_NONE);
+			written_type = kp_symbols[operand.u32_value].builtin_type;
+		}
+
+		if (BUILTINS_get_size(target_type) < sizeof(uint64_t) && target_type != written_type)
+		{
+			VM_emit(p_program, VM_OPCODE_CONVERT, u32_target, VM_SLOT_NONE, (uint32_t)target_type, VM_SLOT_NONE);
+		}
+	}
+
+	VM_emit(p_program, VM_OPCODE_HALT, VM_SLOT_NONE, VM_SLOT_NONE, VM_SLOT_NONE, VM_SLOT_NONE);
+
+	VM_execute(NULL, NULL, &kpk_handlers);
+
+	for (uint32_t i = 0; i < p_program->u32_num_instructions; i++)
+	{
+		p_program->p_instructions[i].kp_handler = kpk_handlers[p_program->pu8_opcodes[i]];
+	}
+
+	VM_DBG("Compiled %u statements to %u instructions over %u slots\n", kp_tree_list->u32_num_trees,
+		p_program->u32_num_instructions, p_program->u32_num_slots);
+
+	return STATUS_OK;
+}
+
+/*
+ *	Runs the program over `p_variables`, which must hold the symbol table's storage, laid out as it
+ *	was when the program was compiled. Fails, leaving the variables as they were, if anything
+ *	divides by zero or overflows a signed division
+ */
+STATUS_t VM_run(const VM_program_t * kp_program, uint32_t * p_variables)
+{
+	uint64_t * pu64_slots = malloc(sizeof(uint64_t) * (kp_program->u32_num_slots + 1));
+	uint8_t * pu8_storage = (uint8_t *)p_variables;
+	STATUS_t status;
+
+	ASSERT(pu64_slots);
+
+	for (uint32_t i = 0; i < kp_program->u32_num_variables; i++)
+	{
+		pu64_slots[i] = BUILTINS_read((BUILTINS_type_t)kp_program->pu8_types[i], pu8_storage + kp_program->pu32_offsets[i]);
+	}
+
+	status = VM_execute(kp_program->p_instructions, pu64_slots, NULL);
+
+	if (status == STATUS_OK)
+	{
+		// Little endian: the low bytes are the variable whatever its size
+		for (uint32_t i = 0; i < kp_program->u32_num_variables; i++)
+		{
+			memcpy(pu8_storage + kp_program->pu32_offsets[i], &pu64_slots[i], BUILTINS_get_size((BUILTINS_type_t)kp_program->pu8_types[i]));
+		}
+	}
+
+	free(pu64_slots);
+
+	return status;
+}
+
+void VM_release(VM_program_t * p_program)
+{
+	free(p_program->p_instructions);
+	free(p_program->pu8_opcodes);
+	free(p_program->pu32_offsets);
+	free(p_program->pu8_types);
+	p_program->p_instructions = NULL;
+	p_program->pu8_opcodes = NULL;
+	p_program->pu32_offsets = NULL;
+	p_program->pu8_types = NULL;
+	p_program->u32_num_instructions = 0;
+	p_program->u32_capacity = 0;
+	p_program->u32_num_slots = 0;
+}
+
+/****************************************************************************************************
+ *	S T A T I C   F U N C T I O N S
+ ****************************************************************************************************/
+
+static void VM_emit(VM_program_t * p_program, VM_opcode_t opcode, uint32_t u32_dst, uint32_t u32_left, uint32_t u32_right, uint32_t u32_addend)
+{
+	VM_instruction_t * p_instruction;
+
+	if (p_program->u32_num_instructions == p_program->u32_capacity)
+	{
+		p_program->u32_capacity *= 2;
+		p_program->p_instructions = realloc(p_program->p_instructions, sizeof(VM_instruction_t) * p_program->u32_capacity);
+		p_program->pu8_opcodes = realloc(p_program->pu8_opcodes, sizeof(uint8_t) * p_program->u32_capacity);
+		ASSERT(p_program->p_instructions && p_program->pu8_opcodes);
+	}
+
+	if (u32_dst != VM_SLOT_NONE && u32_dst >= p_program->u32_num_slots)
+	{
+		p_program->u32_num_slots = u32_dst + 1;
+	}
+
+	p_program->pu8_opcodes[p_program->u32_num_instructions] = (uint8_t)opcode;
+	p_instruction = &p_program->p_instructions[p_program->u32_num_instructions++];
+	p_instruction->kp_handler = NULL;
+	p_instruction->u32_dst = u32_dst;
+	p_instruction->u32_left = u32_left;
+	p_instruction->u32_right = u32_right;
+	p_instruction->u32_addend = u32_addend;
+}
+
+/*
+ *	Leaves are operands in place: a variable's slot, or a literal. A literal too wide for an
+ *	immediate, and an operator, write `u32_dst`, and an operator's operands go to temporaries
+ *	from `u32_temp` up. 32-bit statements wrap their literals
+ */
+static VM_operand_t VM_lower_expression(const PARSE_node_t * kp_node, uint32_t u32_dst, uint32_t u32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program)
+{
+	VM_operand_t operand = { .b_immediate = false, .u32_value = u32_dst };
+	VM_operand_t left;
+	VM_operand_t right;
+	uint64_t u64_literal;
+
+	if (kp_node->type == PARSE_NODE_TYPE_ID && kp_node->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+	{
+		u64_literal = IR_literal_value(kp_node->p_token->pc_lexeme);
+		u64_literal = (BUILTINS_get_size(builtin_type) == sizeof(uint64_t)) ? u64_literal : (uint32_t)u64_literal;
+
+		if (u64_literal <= UINT32_MAX)
+		{
+			operand.b_immediate = true;
+			operand.u32_value = (uint32_t)u64_literal;
+		}
+		else
+		{
+			VM_emit(p_program, VM_OPCODE_LOADK64, u32_dst, VM_SLOT_NONE, (uint32_t)u64_literal, (uint32_t)(u64_literal >> 32));
+		}
+	}
+	else if (kp_node->type == PARSE_NODE_TYPE_ID)
+	{
+		operand.u32_value = SYMBOL_TABLE_lookup(kp_node->p_token->pc_lexeme);
+	}
+	else if (!VM_lower_multiply_add(kp_node, u32_dst, u32_temp, builtin_type, p_program))
+	{
+		left = VM_lower_operand(kp_node->p_left, &u32_temp, builtin_type, p_program);
+		right = VM_lower_operand(kp_node->p_right, &u32_temp, builtin_type, p_program);
+		VM_emit_binary(kp_node->type, u32_dst, left, right, u32_temp, builtin_type, p_program);
+	}
+
+	return operand;
+}
+
+/*
+ *	Lowers an operand into the next free temporary, if it needs one
+ */
+static VM_operand_t VM_lower_operand(const PARSE_node_t * kp_node, uint32_t * pu32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program)
+{
+	VM_operand_t operand = VM_lower_expression(kp_node, *pu32_temp, *pu32_temp + 1, builtin_type, p_program);
+
+	if (!operand.b_immediate && operand.u32_value == *pu32_temp)
+	{
+		(*pu32_temp)++;
+	}
+
+	return operand;
+}
+
+/*
+ *	Superinstruction for a product plus a variable or subexpression: x * y + z, or x * 4 + z
+ */
+static bool VM_lower_multiply_add(const PARSE_node_t * kp_node, uint32_t u32_dst, uint32_t u32_temp, BUILTINS_type_t builtin_type, VM_program_t * p_program)
+{
+	const PARSE_node_t * kp_product;
+	const PARSE_node_t * kp_addend;
+	VM_operand_t left;
+	VM_operand_t right;
+	VM_operand_t addend;
+	VM_operand_t swap;
+
+	if (kp_node->type != PARSE_NODE_TYPE_EXPR_TYPE_ADD)
+	{
+		return false;
+	}
+
+	if (kp_node->p_left->type == PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY)
+	{
+		kp_product = kp_node->p_left;
+		kp_addend = kp_node->p_right;
+	}
+	else if (kp_node->p_right->type == PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY)
+	{
+		kp_product = kp_node->p_right;
+		kp_addend = kp_node->p_left;
+	}
+	else
+	{
+		return false;
+	}
+
+	// A literal addend is better folded into the add as an immediate
+	if (kp_addend->type == PARSE_NODE_TYPE_ID && kp_addend->p_token->type == LEX_TOKEN_TYPE_INT_LITERAL)
+	{
+		return false;
+	}
+
+	left = VM_lower_operand(kp_product->p_left, &u32_temp, builtin_type, p_program);
+	right = VM_lower_operand(kp_product->p_right, &u32_temp, builtin_type, p_program);
+	addend = VM_lower_operand(kp_addend, &u32_temp, builtin_type, p_program);
+
+	if (left.b_immediate)
+	{
+		swap = left;
+		left = right;
+		right = swap;
+	}
+
+	if (left.b_immediate)
+	{
+		VM_emit(p_program, VM_OPCODE_LOADK, u32_temp, VM_SLOT_NONE, left.u32_value, VM_SLOT_NONE);
+		left.b_immediate = false;
+		left.u32_value = u32_temp;
+	}
+
+	VM_emit(p_program, pk_multiply_add_opcodes[builtin_type][right.b_immediate ? 1 : 0], u32_dst, left.u32_value, right.u32_value, addend.u32_value);
+
+	return true;
+}
+
+/*
+ *	Picks the form for the operands at hand. Two literals need one of them in a register first,
+ *	which goes to `u32_temp`
+ */
+static void VM_emit_binary(PARSE_node_type_t type, uint32_t u32_dst, VM_operand_t left, VM_operand_t right, uint32_t u32_temp,
+	BUILTINS_type_t builtin_type, VM_program_t * p_program)
+{
+	VM_operand_t swap;
+	bool b_commutative = type == PARSE_NODE_TYPE_EXPR_TYPE_ADD || type == PARSE_NODE_TYPE_EXPR_TYPE_MULTIPLY;
+
+	if (left.b_immediate && right.b_immediate)
+	{
+		VM_emit(p_program, VM_OPCODE_LOADK, u32_temp, VM_SLOT_NONE, left.u32_value, VM_SLOT_NONE);
+		left.b_immediate = false;
+		left.u32_value = u32_temp++;
+	}
+
+	if (left.b_immediate && b_commutative)
+	{
+		swap = left;
+		left = right;
+		right = swap;
+	}
+
+	// The immediate divisions trust their divisor, so dividing by a literal zero, or by one that
+	// wraps to -1 in an i32 statement, goes through the checked form
+	if (type == PARSE_NODE_TYPE_EXPR_TYPE_DIVIDE && right.b_immediate &&
+		(right.u32_value == 0 || (builtin_type == BUILTINS_TYPE_I32 && right.u32_value == UINT32_MAX)))
+	{
+		VM_emit(p_program, VM_OPCODE_LOADK, u32_temp, VM_SLOT_NONE, 0, VM_SLOT_NONE);
+		right.b_immediate = false;
+		right.u32_value = u32_temp;
+	}
+
+	if (left.b_immediate)
+	{
+		VM_emit(p_program, pk_binary_opcodes[builtin_type][type][2], u32_dst, right.u32_value, left.u32_value, VM_SLOT_NONE);
+	}
+	else
+	{
+		VM_emit(p_program, pk_binary_opcodes[builtin_type][type][right.b_immediate ? 1 : 0], u32_dst, left.u32_value, right.u32_value, VM_SLOT_NONE);
+	}
+}
+
+/*
+ *	A signed division the hardware would trap on: by zero, or the most negative value by -1
+ */
+static STATUS_t VM_check_division(int64_t s64_dividend, int64_t s64_divisor, int64_t s64_min)
+{
+	if (s64_divisor == 0)
+	{
+		VM_ERR("Division by zero\n");
+		return STATUS_FAILED;
+	}
+
+	if (s64_divisor == -1 && s64_dividend == s64_min)
+	{
+		VM_ERR("Division overflows\n");
+		return STATUS_FAILED;
+	}
+
+	return STATUS_OK;
+}
+
+/*
+ *	The interpreter. Handler addresses only exist inside this function, so called with
+ *	`pppk_handlers` it hands out its table, for VM_compile to thread the code with, and returns
+ */
+static STATUS_t VM_execute(const VM_instruction_t * kp_instruction, uint64_t * pu64_slots, const void * const ** pppk_handlers)
+{
+	static const void * const pk_handlers[VM_OPCODE_NUM_OPCODES] =
+	{
+		[VM_OPCODE_HALT]			= &&vm_halt,
+		[VM_OPCODE_MOV]				= &&vm_mov,
+		[VM_OPCODE_LOADK]			= &&vm_loadk,
+		[VM_OPCODE_ADD]				= &&vm_add,
+		[VM_OPCODE_ADD_I]			= &&vm_add_i,
+		[VM_OPCODE_SUB]				= &&vm_sub,
+		[VM_OPCODE_SUB_I]			= &&vm_sub_i,
+		[VM_OPCODE_SUB_FROM_I]		= &&vm_sub_from_i,
+		[VM_OPCODE_MUL]				= &&vm_mul,
+		[VM_OPCODE_MUL_I]			= &&vm_mul_i,
+		[VM_OPCODE_DIV]				= &&vm_div,
+		[VM_OPCODE_DIV_I]			= &&vm_div_i,
+		[VM_OPCODE_DIV_FROM_I]		= &&vm_div_from_i,
+		[VM_OPCODE_MUL_ADD]			= &&vm_mul_add,
+		[VM_OPCODE_MUL_I_ADD]		= &&vm_mul_i_add,
+		[VM_OPCODE_DIV_S32]			= &&vm_div_s32,
+		[VM_OPCODE_DIV_S32_I]		= &&vm_div_s32_i,
+		[VM_OPCODE_DIV_FROM_S32_I]	= &&vm_div_from_s32_i,
+		[VM_OPCODE_LOADK64]			= &&vm_loadk64,
+		[VM_OPCODE_ADD64]			= &&vm_add64,
+		[VM_OPCODE_ADD64_I]			= &&vm_add64_i,
+		[VM_OPCODE_SUB64]			= &&vm_sub64,
+		[VM_OPCODE_SUB64_I]			= &&vm_sub64_i,
+		[VM_OPCODE_SUB64_FROM_I]	= &&vm_sub64_from_i,
+		[VM_OPCODE_MUL64]			= &&vm_mul64,
+		[VM_OPCODE_MUL64_I]			= &&vm_mul64_i,
+		[VM_OPCODE_DIV_U64]			= &&vm_div_u64,
+		[VM_OPCODE_DIV_U64_I]		= &&vm_div_u64_i,
+		[VM_OPCODE_DIV_FROM_U64_I]	= &&vm_div_from_u64_i,
+		[VM_OPCODE_DIV_S64]			= &&vm_div_s64,
+		[VM_OPCODE_DIV_S64_I]		= &&vm_div_s64_i,
+		[VM_OPCODE_DIV_FROM_S64_I]	= &&vm_div_from_s64_i,
+		[VM_OPCODE_MUL64_ADD]		= &&vm_mul64_add,
+		[VM_OPCODE_MUL64_I_ADD]		= &&vm_mul64_i_add,
+		[VM_OPCODE_CONVERT]			= &&vm_convert,
+	};
+
+	if (pppk_handlers != NULL)
+	{
+		*pppk_handlers = pk_handlers;
+		return STATUS_OK;
+	}
+
+	goto *kp_instruction->kp_handler;
+
+vm_halt:
+	return STATUS_OK;
+
+vm_mov:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left];
+	VM_DISPATCH();
+
+vm_loadk:
+	pu64_slots[kp_instruction->u32_dst] = kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_add:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] + pu64_slots[kp_instruction->u32_right]);
+	VM_DISPATCH();
+
+vm_add_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] + kp_instruction->u32_right);
+	VM_DISPATCH();
+
+vm_sub:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] - pu64_slots[kp_instruction->u32_right]);
+	VM_DISPATCH();
+
+vm_sub_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] - kp_instruction->u32_right);
+	VM_DISPATCH();
+
+vm_sub_from_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(kp_instruction->u32_right - pu64_slots[kp_instruction->u32_left]);
+	VM_DISPATCH();
+
+vm_mul:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] * pu64_slots[kp_instruction->u32_right]);
+	VM_DISPATCH();
+
+vm_mul_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)(pu64_slots[kp_instruction->u32_left] * kp_instruction->u32_right);
+	VM_DISPATCH();
+
+vm_div:
+	if ((uint32_t)pu64_slots[kp_instruction->u32_right] == 0)
+	{
+		VM_ERR("Division by zero\n");
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)pu64_slots[kp_instruction->u32_left] / (uint32_t)pu64_slots[kp_instruction->u32_right];
+	VM_DISPATCH();
+
+vm_div_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)pu64_slots[kp_instruction->u32_left] / kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_div_from_i:
+	if ((uint32_t)pu64_slots[kp_instruction->u32_left] == 0)
+	{
+		VM_ERR("Division by zero\n");
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = kp_instruction->u32_right / (uint32_t)pu64_slots[kp_instruction->u32_left];
+	VM_DISPATCH();
+
+vm_mul_add:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)((pu64_slots[kp_instruction->u32_left] * pu64_slots[kp_instruction->u32_right]) + pu64_slots[kp_instruction->u32_addend]);
+	VM_DISPATCH();
+
+vm_mul_i_add:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)((pu64_slots[kp_instruction->u32_left] * kp_instruction->u32_right) + pu64_slots[kp_instruction->u32_addend]);
+	VM_DISPATCH();
+
+vm_div_s32:
+	if (VM_check_division((int32_t)pu64_slots[kp_instruction->u32_left], (int32_t)pu64_slots[kp_instruction->u32_right], INT32_MIN) != STATUS_OK)
+	{
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)((int32_t)pu64_slots[kp_instruction->u32_left] / (int32_t)pu64_slots[kp_instruction->u32_right]);
+	VM_DISPATCH();
+
+vm_div_s32_i:
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)((int32_t)pu64_slots[kp_instruction->u32_left] / (int32_t)kp_instruction->u32_right);
+	VM_DISPATCH();
+
+vm_div_from_s32_i:
+	if (VM_check_division((int32_t)kp_instruction->u32_right, (int32_t)pu64_slots[kp_instruction->u32_left], INT32_MIN) != STATUS_OK)
+	{
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = (uint32_t)((int32_t)kp_instruction->u32_right / (int32_t)pu64_slots[kp_instruction->u32_left]);
+	VM_DISPATCH();
+
+vm_loadk64:
+	pu64_slots[kp_instruction->u32_dst] = ((uint64_t)kp_instruction->u32_addend << 32) | kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_add64:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] + pu64_slots[kp_instruction->u32_right];
+	VM_DISPATCH();
+
+vm_add64_i:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] + kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_sub64:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] - pu64_slots[kp_instruction->u32_right];
+	VM_DISPATCH();
+
+vm_sub64_i:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] - kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_sub64_from_i:
+	pu64_slots[kp_instruction->u32_dst] = kp_instruction->u32_right - pu64_slots[kp_instruction->u32_left];
+	VM_DISPATCH();
+
+vm_mul64:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] * pu64_slots[kp_instruction->u32_right];
+	VM_DISPATCH();
+
+vm_mul64_i:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] * kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_div_u64:
+	if (pu64_slots[kp_instruction->u32_right] == 0)
+	{
+		VM_ERR("Division by zero\n");
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] / pu64_slots[kp_instruction->u32_right];
+	VM_DISPATCH();
+
+vm_div_u64_i:
+	pu64_slots[kp_instruction->u32_dst] = pu64_slots[kp_instruction->u32_left] / kp_instruction->u32_right;
+	VM_DISPATCH();
+
+vm_div_from_u64_i:
+	if (pu64_slots[kp_instruction->u32_left] == 0)
+	{
+		VM_ERR("Division by zero\n");
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = kp_instruction->u32_right / pu64_slots[kp_instruction->u32_left];
+	VM_DISPATCH();
+
+vm_div_s64:
+	if (VM_check_division((int64_t)pu64_slots[kp_instruction->u32_left], (int64_t)pu64_slots[kp_instruction->u32_right], INT64_MIN) != STATUS_OK)
+	{
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = (uint64_t)((int64_t)pu64_slots[kp_instruction->u32_left] / (int64_t)pu64_slots[kp_instruction->u32_right]);
+	VM_DISPATCH();
+
+vm_div_s64_i:
+	// 64-bit immediates are zero extended, so the divisor is positive
+	pu64_slots[kp_instruction->u32_dst] = (uint64_t)((int64_t)pu64_slots[kp_instruction->u32_left] / (int64_t)kp_instruction->u32_right);
+	VM_DISPATCH();
+
+vm_div_from_s64_i:
+	if (VM_check_division((int64_t)kp_instruction->u32_right, (int64_t)pu64_slots[kp_instruction->u32_left], INT64_MIN) != STATUS_OK)
+	{
+		return STATUS_FAILED;
+	}
+	pu64_slots[kp_instruction->u32_dst] = (uint64_t)((int64_t)kp_instruction->u32_right / (int64_t)pu64_slots[kp_instruction->u32_left]);
+	VM_DISPATCH();
+
+vm_mul64_add:
+	pu64_slots[kp_instruction->u32_dst] = (pu64_slots[kp_instruction->u32_left] * pu64_slots[kp_instruction->u32_right]) + pu64_slots[kp_instruction->u32_addend];
+	VM_DISPATCH();
+
+vm_mul64_i_add:
+	pu64_slots[kp_instruction->u32_dst] = (pu64_slots[kp_instruction->u32_left] * kp_instruction->u32_right) + pu64_slots[kp_instruction->u32_addend];
+	VM_DISPATCH();
+
+vm_convert:
+	pu64_slots[kp_instruction->u32_dst] = BUILTINS_read((BUILTINS_type_t)kp_instruction->u32_right, &pu64_slots[kp_instruction->u32_dst]);
+	VM_DISPATCH();
+}
@@ -0,0 +1,92 @@
+#ifndef VM_H
+#define VM_H
+
+#include "common.h"
+#include "status.h"
+#include "parse.h"
+
+/****************************************************************************************************
+ *	T Y P E D E F S
+ ****************************************************************************************************/
+
+/*
+ *	Register bytecode. Slots are the variables, at their symbol table indices, then the temporaries
+ *	statements need. "_I" forms take their right operand as an immediate. Each statement is computed
+ *	in its type: the plain forms are 32-bit and leave the result zero extended, "64" forms use the
+ *	whole slot, and division is split by sign too
+ */
+typedef enum
+{
+	VM_OPCODE_HALT = 0,
+	VM_OPCODE_MOV,				// dst = left
+	VM_OPCODE_LOADK,			// dst = right
+	VM_OPCODE_ADD,				// dst = left + right
+	VM_OPCODE_ADD_I,
+	VM_OPCODE_SUB,
+	VM_OPCODE_SUB_I,
+	VM_OPCODE_SUB_FROM_I,		// dst = right - left
+	VM_OPCODE_MUL,
+	VM_OPCODE_MUL_I,
+	VM_OPCODE_DIV,				// Unsigned. Fails on zero
+	VM_OPCODE_DIV_I,			// Never by zero: that is lowered to DIV
+	VM_OPCODE_DIV_FROM_I,		// dst = right / left
+	VM_OPCODE_MUL_ADD,			// dst = left * right + addend
+	VM_OPCODE_MUL_I_ADD,
+	VM_OPCODE_DIV_S32,			// Also fails on INT32_MIN / -1, which traps natively
+	VM_OPCODE_DIV_S32_I,		// Never by zero or -1: those are lowered to DIV_S32
+	VM_OPCODE_DIV_FROM_S32_I,
+	VM_OPCODE_LOADK64,			// dst = addend << 32 | right
+	VM_OPCODE_ADD64,
+	VM_OPCODE_ADD64_I,
+	VM_OPCODE_SUB64,
+	VM_OPCODE_SUB64_I,
+	VM_OPCODE_SUB64_FROM_I,
+	VM_OPCODE_MUL64,
+	VM_OPCODE_MUL64_I,
+	VM_OPCODE_DIV_U64,
+	VM_OPCODE_DIV_U64_I,
+	VM_OPCODE_DIV_FROM_U64_I,
+	VM_OPCODE_DIV_S64,
+	VM_OPCODE_DIV_S64_I,
+	VM_OPCODE_DIV_FROM_S64_I,
+	VM_OPCODE_MUL64_ADD,
+	VM_OPCODE_MUL64_I_ADD,
+	VM_OPCODE_CONVERT,			// dst = dst as the type in right reads it, sign or zero extended
+	//////////////////////////////
+	VM_OPCODE_NUM_OPCODES
+} VM_opcode_t;
+
+/*
+ *	An instruction, threaded: it carries the address of its own handler, so dispatch is one
+ *	indirect jump with no table lookup
+ */
+typedef struct _VM_instruction
+{
+	const void *	kp_handler;
+	uint32_t		u32_dst;
+	uint32_t		u32_left;			// Slot
+	uint32_t		u32_right;			// Slot, or immediate
+	uint32_t		u32_addend;			// Slot, for the multiply-adds
+} VM_instruction_t;
+
+typedef struct _VM_program
+{
+	VM_instruction_t *	p_instructions;
+	uint8_t *			pu8_opcodes;			// VM_opcode_t, per instruction
+	uint32_t			u32_num_instructions;
+	uint32_t			u32_capacity;
+	uint32_t			u32_num_variables;
+	uint32_t			u32_num_slots;			// Variables and temporaries
+	uint32_t *			pu32_offsets;			// Per variable, where it sits in the storage
+	uint8_t *			pu8_types;				// Per variable, BUILTINS_type_t
+} VM_program_t;
+
+/****************************************************************************************************
+ *	F U N C T I O N S
+ ****************************************************************************************************/
+
+STATUS_t 		VM_compile						(const PARSE_tree_list_t * kp_tree_list, uint32_t u32_num_variables, VM_program_t * p_program);
+STATUS_t 		VM_run							(const VM_program_t * kp_program, uint32_t * p_variables);
+void 			VM_release						(VM_program_t * p_program);
+
+#endif